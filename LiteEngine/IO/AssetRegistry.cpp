@@ -0,0 +1,265 @@
+#include "AssetRegistry.h"
+#include "../Utilities/Utilities.h"
+#include "../Utilities/Hash.h"
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+
+namespace LiteEngine::IO {
+
+	const char* getAssetTypeName(AssetType type) {
+		switch (type) {
+		case AssetType::TEXTURE: return "texture";
+		case AssetType::MESH: return "mesh";
+		case AssetType::MATERIAL: return "material";
+		case AssetType::MODEL: return "model";
+		default: return "unknown";
+		}
+	}
+
+	struct AssetRegistry::Index {
+		std::mutex lock;
+		std::map<std::pair<AssetType, uint64_t>, std::weak_ptr<Asset>> assets;
+		std::map<std::string, std::weak_ptr<Asset>> paths;
+		uint64_t loads = 0;
+		uint64_t reuses = 0;
+		uint64_t unloads = 0;
+	};
+
+	Asset::~Asset() {
+		AssetRegistry::onAssetReleased(registryIndex, *this);
+	}
+
+	size_t ModelAsset::getTotalMemoryBytes() const {
+		size_t total = memoryBytes;
+		std::set<const Asset*> counted;
+		auto add = [&](const Asset* asset) {
+			if (asset && counted.insert(asset).second) total += asset->memoryBytes;
+		};
+		for (auto& mesh : meshes) add(mesh.get());
+		for (auto& material : materials) {
+			add(material.get());
+			for (auto& texture : material->textures) add(texture.get());
+		}
+		return total;
+	}
+
+	bool AssetInstance::playAnimation(SceneManagement::ComponentStore& components, size_t index, bool loop) const {
+		if (!asset || index >= asset->animations.size()) return false;
+		auto player = SceneManagement::createAnimationPlayer(asset->animations[index], *this);
+		player.loop = loop;
+		components.add<SceneManagement::AnimationPlayer>(getHandle(), std::move(player));
+		return true;
+	}
+
+	size_t AssetInstance::createSkinnedMeshes(SceneManagement::ComponentStore& components) const {
+		if (!asset) return 0;
+		auto& renderer = Rendering::Renderer::getInstance();
+		size_t created = 0;
+		for (auto& deformable : asset->deformableNodes) {
+			auto node = getDescendant(deformable.node);
+			if (node == nullptr) continue;
+
+			auto skinned = SceneManagement::createSkinnedMesh(deformable.data, deformable.skin, *this);
+			auto& vertices = deformable.data->vertices;
+			skinned.output = renderer.createDynamicVertexBufferObject(vertices.data(), (uint32_t)vertices.size(),
+				(uint32_t)sizeof(SceneManagement::DefaultVertexData), SceneManagement::DefaultVertexData::getDescription());
+
+			// 各个 primitive 改为从本实例的动态 buffer 读取顶点，索引仍然共享
+			for (auto& child : node->children) {
+				auto mesh = dynamic_cast<SceneManagement::Mesh*>(child.get());
+				if (mesh == nullptr || !mesh->data) continue;
+				mesh->data->setMesh(mesh->data->getMesh()->withVertexBuffer(skinned.output));
+			}
+
+			components.add<SceneManagement::SkinnedMesh>(node->getHandle(), std::move(skinned));
+			created++;
+		}
+		return created;
+	}
+
+	bool AssetInstance::createImpostor(SceneManagement::ComponentStore& components) const {
+		if (!asset || !asset->impostor) return false;
+		auto& impostor = *asset->impostor;
+		auto quad = Rendering::Renderer::getInstance().createImpostorMeshObject(
+			impostor.albedo, impostor.normal, impostor.emission, impostor.framesPerSide);
+		components.add<SceneManagement::Impostor>(getHandle(), quad, impostor.trans_I2L);
+		return true;
+	}
+
+	AssetRegistry::AssetRegistry() : index(new Index()) {}
+
+	AssetRegistry& AssetRegistry::getInstance() {
+		static AssetRegistry registry;
+		return registry;
+	}
+
+	void AssetRegistry::onAssetReleased(const std::weak_ptr<void>& weakIndex, const Asset& asset) {
+		auto index = std::static_pointer_cast<Index>(weakIndex.lock());
+		if (!index) return;
+
+		{
+			std::lock_guard<std::mutex> guard(index->lock);
+			// 同一个 key 可能已经注册了新的资产，只移除已失效的条目
+			auto it = index->assets.find({ asset.type, asset.contentHash });
+			if (it != index->assets.end() && it->second.expired()) {
+				index->assets.erase(it);
+			}
+			if (asset.type == AssetType::MODEL) {
+				for (auto pathIt = index->paths.begin(); pathIt != index->paths.end();) {
+					if (pathIt->second.expired()) pathIt = index->paths.erase(pathIt);
+					else pathIt++;
+				}
+			}
+			index->unloads++;
+		}
+
+		log(LogLevel::INFO, std::string("asset unloaded: ") + getAssetTypeName(asset.type) + " " +
+			asset.name + " (" + hashToString(asset.contentHash) + ")\n");
+	}
+
+	std::shared_ptr<Asset> AssetRegistry::acquireAsset(
+		AssetType type,
+		uint64_t contentHash,
+		const std::function<std::shared_ptr<Asset>()>& create
+	) {
+		{
+			std::lock_guard<std::mutex> guard(index->lock);
+			auto it = index->assets.find({ type, contentHash });
+			if (it != index->assets.end()) {
+				if (auto existing = it->second.lock()) {
+					index->reuses++;
+					return existing;
+				}
+			}
+		}
+
+		// 不持有锁：create 中可能递归调用 acquire
+		auto created = create();
+		if (!created || created->type != type) {
+			throw std::exception("asset creation returned an asset of unexpected type");
+		}
+		created->contentHash = contentHash;
+
+		std::shared_ptr<Asset> existing;
+		{
+			std::lock_guard<std::mutex> guard(index->lock);
+			auto& entry = index->assets[{ type, contentHash }];
+			existing = entry.lock();
+			if (!existing) {
+				entry = created;
+				created->registryIndex = index;
+				index->loads++;
+			} else {
+				index->reuses++;
+			}
+		}
+
+		// 其他线程先完成了创建。created 在锁外释放
+		return existing ? existing : created;
+	}
+
+	std::shared_ptr<const ModelAsset> AssetRegistry::findModel(const std::string& path) {
+		std::shared_ptr<Asset> model;
+		{
+			std::lock_guard<std::mutex> guard(index->lock);
+			auto it = index->paths.find(path);
+			if (it == index->paths.end()) return nullptr;
+			model = it->second.lock();
+			if (model) index->reuses++;
+		}
+		return std::static_pointer_cast<const ModelAsset>(model);
+	}
+
+	void AssetRegistry::registerPath(const std::string& path, const std::shared_ptr<const ModelAsset>& model) {
+		std::lock_guard<std::mutex> guard(index->lock);
+		index->paths[path] = std::const_pointer_cast<ModelAsset>(model);
+	}
+
+	std::shared_ptr<AssetInstance> AssetRegistry::instantiate(const std::shared_ptr<const ModelAsset>& model) {
+		std::shared_ptr<AssetInstance> instance(new AssetInstance());
+		instance->asset = model;
+		if (!model->prototype) return instance;
+
+		auto& prototype = *model->prototype;
+		instance->name = prototype.name;
+		instance->transT = prototype.transT;
+		instance->transR = prototype.transR;
+		instance->transS = prototype.transS;
+		for (auto& child : prototype.children) {
+			auto copied = child->clone();
+			copied->parent = instance;
+			instance->children.push_back(copied);
+		}
+		return instance;
+	}
+
+	std::vector<AssetRegistry::AssetInfo> AssetRegistry::listAssets() {
+		// 持有的 shared_ptr 可能是最后一个引用，必须在锁外释放
+		std::vector<std::shared_ptr<Asset>> alive;
+		{
+			std::lock_guard<std::mutex> guard(index->lock);
+			alive.reserve(index->assets.size());
+			for (auto& [key, weak] : index->assets) {
+				if (auto asset = weak.lock()) alive.push_back(asset);
+			}
+		}
+
+		std::vector<AssetInfo> out;
+		out.reserve(alive.size());
+		for (auto& asset : alive) {
+			out.push_back({ asset->type, asset->contentHash, asset->name, asset->memoryBytes, asset.use_count() - 1 });
+		}
+		return out;
+	}
+
+	AssetRegistry::MemoryStatistics AssetRegistry::getMemoryStatistics() {
+		MemoryStatistics stat;
+		for (auto& info : listAssets()) {
+			stat.counts[(size_t)info.type]++;
+			stat.bytes[(size_t)info.type] += info.memoryBytes;
+			stat.totalBytes += info.memoryBytes;
+		}
+		std::lock_guard<std::mutex> guard(index->lock);
+		stat.loads = index->loads;
+		stat.reuses = index->reuses;
+		stat.unloads = index->unloads;
+		return stat;
+	}
+
+	std::string AssetRegistry::getReport(size_t maxListedAssets) {
+		auto assets = listAssets();
+		auto stat = getMemoryStatistics();
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "%-10s %8s %12s\n", "type", "count", "KiB");
+		out << line;
+		for (size_t i = 0; i < (size_t)AssetType::COUNT; i++) {
+			snprintf(line, sizeof(line), "%-10s %8u %12.1f\n",
+				getAssetTypeName((AssetType)i), stat.counts[i], stat.bytes[i] / 1024.0);
+			out << line;
+		}
+		snprintf(line, sizeof(line), "total: %.1f MiB, loads %llu, reuses %llu, unloads %llu\n",
+			stat.totalBytes / (1024.0 * 1024.0), (unsigned long long)stat.loads,
+			(unsigned long long)stat.reuses, (unsigned long long)stat.unloads);
+		out << line;
+
+		std::sort(assets.begin(), assets.end(), [](auto& lhs, auto& rhs) {
+			return lhs.memoryBytes > rhs.memoryBytes;
+		});
+		for (size_t i = 0; i < std::min(maxListedAssets, assets.size()); i++) {
+			auto& info = assets[i];
+			snprintf(line, sizeof(line), "  %-10s %s %10.1f KiB %4ld refs  %s\n",
+				getAssetTypeName(info.type), hashToString(info.contentHash).c_str(),
+				info.memoryBytes / 1024.0, info.references, info.name.c_str());
+			out << line;
+		}
+		return out.str();
+	}
+
+}
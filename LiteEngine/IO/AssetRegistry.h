@@ -0,0 +1,200 @@
+#pragma once
+
+#include "../Renderer/Resources.h"
+#include "../Scene/Scene.h"
+#include "../Scene/DefaultDS.h"
+#include "../Scene/Animation.h"
+#include "../Scene/Skinning.h"
+#include "../Scene/Impostor.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <type_traits>
+
+namespace LiteEngine::IO {
+
+	enum class AssetType : uint32_t {
+		TEXTURE,
+		MESH,
+		MATERIAL,
+		MODEL,
+		COUNT
+	};
+
+	const char* getAssetTypeName(AssetType type);
+
+	// 所有资产的基类，只能通过 shared_ptr 持有
+	// 注册表只记录 weak_ptr：最后一个引用释放时资产析构，GPU 资源随之释放，注册表中的条目也一并移除
+	struct Asset {
+		const AssetType type;
+		uint64_t contentHash = 0;
+		std::string name;
+		size_t memoryBytes = 0;		// 本资产自己占用的内存，不含引用的其他资产
+
+		Asset(AssetType type) : type(type) {}
+		Asset(const Asset&) = delete;
+		void operator=(const Asset&) = delete;
+		virtual ~Asset();
+
+	private:
+		friend class AssetRegistry;
+		// 注册表内部状态。注册表先于资产析构时（程序退出）为空
+		std::weak_ptr<void> registryIndex;
+	};
+
+	struct TextureAsset : public Asset {
+		Rendering::PtrShaderResourceView view;
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 0;
+
+		static constexpr AssetType TYPE = AssetType::TEXTURE;
+		TextureAsset() : Asset(TYPE) {}
+	};
+
+	// glTF 中的一个 mesh，每个 primitive 对应一个 Rendering::Mesh
+	struct MeshAsset : public Asset {
+		struct Primitive {
+			std::shared_ptr<Rendering::Mesh> mesh;
+			uint32_t materialID;		// 模型内的材质索引，UINT32_MAX 表示默认材质
+			std::string name;
+		};
+		std::vector<Primitive> primitives;
+
+		static constexpr AssetType TYPE = AssetType::MESH;
+		MeshAsset() : Asset(TYPE) {}
+	};
+
+	struct MaterialAsset : public Asset {
+		std::shared_ptr<SceneManagement::DefaultMaterial> material;
+		std::vector<std::shared_ptr<const TextureAsset>> textures;
+
+		static constexpr AssetType TYPE = AssetType::MATERIAL;
+		MaterialAsset() : Asset(TYPE) {}
+	};
+
+	// 一个模型文件。prototype 不直接放进场景，而是用 AssetRegistry::instantiate 复制
+	struct ModelAsset : public Asset {
+		std::string path;
+		std::vector<std::shared_ptr<const MeshAsset>> meshes;
+		std::vector<std::shared_ptr<const MaterialAsset>> materials;
+		std::shared_ptr<const SceneManagement::Object> prototype;
+		// 目标用相对于 prototype 根节点的路径表示，可以绑定到任何实例上。关键帧计入 memoryBytes
+		std::vector<std::shared_ptr<const SceneManagement::AnimationClip>> animations;
+
+		// 需要逐实例变形（蒙皮或 morph target）的 mesh 节点。原始数据和骨骼计入 memoryBytes
+		struct DeformableNode {
+			std::vector<uint32_t> node;		// 相对于 prototype 根节点的路径
+			std::shared_ptr<const SceneManagement::DeformableMeshData> data;
+			std::shared_ptr<const SceneManagement::Skin> skin;		// 只有 morph target 时为空
+		};
+		std::vector<DeformableNode> deformableNodes;
+
+		// 整个模型的 impostor，见 SceneManagement::ImpostorAtlas。没有烘焙时为空。图集计入 memoryBytes
+		struct ImpostorData {
+			Rendering::PtrShaderResourceView albedo;
+			Rendering::PtrShaderResourceView normal;
+			Rendering::PtrShaderResourceView emission;
+			uint32_t framesPerSide;
+			DirectX::XMFLOAT4X4 trans_I2L;		// impostor 空间 -> prototype 根节点
+		};
+		std::shared_ptr<const ImpostorData> impostor;
+
+		static constexpr AssetType TYPE = AssetType::MODEL;
+		ModelAsset() : Asset(TYPE) {}
+
+		// 包括所有引用到的 mesh、材质和纹理，被多个材质引用的纹理只算一次
+		size_t getTotalMemoryBytes() const;
+	};
+
+	// 模型实例的根节点，持有 ModelAsset
+	// 只要实例还在场景中，模型就不会被卸载。单独取出的子树只持有 Rendering::Mesh，不计入引用
+	struct AssetInstance : public SceneManagement::Object {
+		std::shared_ptr<const ModelAsset> asset;
+
+		// 在 components 中给本实例添加播放模型第 index 个动画的 AnimationPlayer，替换已有的
+		// 模型没有这个动画时返回 false
+		bool playAnimation(SceneManagement::ComponentStore& components, size_t index = 0, bool loop = true) const;
+
+		// 给本实例中每个可变形的 mesh 节点添加 SkinnedMesh 组件，并创建各自的动态顶点 buffer
+		// 之后这些节点下的 primitive 绘制变形后的顶点。只能在渲染线程调用。返回添加的组件数
+		size_t createSkinnedMeshes(SceneManagement::ComponentStore& components) const;
+
+		// 给本实例的根节点添加 Impostor 组件，远处用模型的 impostor 代替整个实例。只能在渲染线程调用
+		// 模型没有烘焙 impostor（见 IO::ImpostorOptions）时返回 false
+		bool createImpostor(SceneManagement::ComponentStore& components) const;
+
+	protected:
+		virtual std::shared_ptr<Object> cloneNode() const override {
+			return std::shared_ptr<Object>(new AssetInstance(*this));
+		}
+	};
+
+	// 已加载资产的注册表。纹理、mesh、材质、模型各自以内容哈希为 key，模型还可以按路径查找
+	// 线程安全。创建 GPU 资源的 create 回调由调用方保证在渲染线程执行
+	class AssetRegistry {
+	public:
+		struct AssetInfo {
+			AssetType type;
+			uint64_t contentHash;
+			std::string name;
+			size_t memoryBytes;
+			long references;			// 注册表之外的 shared_ptr 数
+		};
+
+		struct MemoryStatistics {
+			uint32_t counts[(size_t)AssetType::COUNT] = {};
+			size_t bytes[(size_t)AssetType::COUNT] = {};
+			size_t totalBytes = 0;
+			uint64_t loads = 0;			// 调用 create 的次数
+			uint64_t reuses = 0;		// 命中已加载资产的次数
+			uint64_t unloads = 0;
+		};
+
+	protected:
+		struct Index;
+		std::shared_ptr<Index> index;
+
+		AssetRegistry();
+
+		std::shared_ptr<Asset> acquireAsset(AssetType type, uint64_t contentHash, const std::function<std::shared_ptr<Asset>()>& create);
+
+		// 在 Asset 的析构函数中调用
+		static void onAssetReleased(const std::weak_ptr<void>& index, const Asset& asset);
+		friend struct Asset;
+
+	public:
+		AssetRegistry(const AssetRegistry&) = delete;
+		void operator=(const AssetRegistry&) = delete;
+
+		static AssetRegistry& getInstance();
+
+		// 内容哈希相同的资产仍然存在时直接返回，否则调用 create 创建并注册
+		// create 中可以再调用 acquire（例如材质加载纹理）
+		template <typename T>
+		std::shared_ptr<const T> acquire(uint64_t contentHash, const std::function<std::shared_ptr<T>()>& create) {
+			static_assert(std::is_base_of_v<Asset, T>);
+			return std::static_pointer_cast<const T>(acquireAsset(T::TYPE, contentHash, [&]() {
+				return std::static_pointer_cast<Asset>(create());
+			}));
+		}
+
+		// 按路径查找已加载的模型。不检查文件是否修改过
+		std::shared_ptr<const ModelAsset> findModel(const std::string& path);
+		void registerPath(const std::string& path, const std::shared_ptr<const ModelAsset>& model);
+
+		// 复制模型的 prototype。返回的树可以自由修改变换和层级，与其他实例共享 mesh、材质和纹理
+		static std::shared_ptr<AssetInstance> instantiate(const std::shared_ptr<const ModelAsset>& model);
+
+		std::vector<AssetInfo> listAssets();
+		MemoryStatistics getMemoryStatistics();
+
+		// 每种资产的数量和内存，以及占用内存最多的若干资产
+		std::string getReport(size_t maxListedAssets = 16);
+	};
+
+}
@@ -0,0 +1,99 @@
+#include "AsyncLoader.h"
+#include "../Utilities/Utilities.h"
+
+#include <algorithm>
+
+namespace LiteEngine::IO {
+
+	std::shared_ptr<AsyncLoader::LoadHandle> AsyncLoader::loadGLTF(
+		const std::string& path,
+		JobPriority priority,
+		ProgressCallback progress
+	) {
+		std::shared_ptr<LoadHandle> handle(new LoadHandle());
+		handle->path = path;
+		handle->priority = priority;
+		handle->progressCallback = progress;
+		handle->result = handle->promise.get_future().share();
+
+		handle->loaded = AssetRegistry::getInstance().findModel(path);
+		if (handle->loaded) {
+			handle->state = LoadState::WAITING_FOR_GPU;
+			pending.push_back(handle);
+			return handle;
+		}
+
+		handle->preparation = JobSystem::getInstance().submit([path, priority, handle]() {
+			return prepareDefaultResourceGLTF(path, priority, [handle](uint32_t finished, uint32_t total) {
+				handle->totalSteps = total;
+				handle->finishedSteps = finished;
+			});
+		}, priority);
+
+		pending.push_back(handle);
+		return handle;
+	}
+
+	void AsyncLoader::reportProgress(LoadHandle& handle) {
+		if (!handle.progressCallback) return;
+		auto progress = handle.getProgress();
+		if (progress != handle.lastReportedProgress) {
+			handle.lastReportedProgress = progress;
+			handle.progressCallback(handle);
+		}
+	}
+
+	uint32_t AsyncLoader::update(uint32_t maxCreations) {
+		// 优先级高的先创建
+		std::stable_sort(pending.begin(), pending.end(), [](auto& lhs, auto& rhs) {
+			return (uint32_t)lhs->priority < (uint32_t)rhs->priority;
+		});
+
+		uint32_t creations = 0;
+		for (auto& handle : pending) {
+			if (handle->state == LoadState::PREPARING &&
+				handle->preparation.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				handle->state = LoadState::WAITING_FOR_GPU;
+			}
+
+			if (handle->state == LoadState::WAITING_FOR_GPU && handle->loaded) {
+				// 不创建 GPU 资源，不计入 maxCreations
+				handle->promise.set_value(AssetRegistry::instantiate(handle->loaded));
+				handle->loaded = nullptr;
+				handle->state = LoadState::READY;
+			}
+
+			if (handle->state == LoadState::WAITING_FOR_GPU && creations < maxCreations) {
+				creations++;
+				try {
+					auto data = handle->preparation.get();
+					handle->promise.set_value(createDefaultResourceGLTF(*data));
+					handle->state = LoadState::READY;
+				} catch (const std::exception& e) {
+					handle->errorMessage = e.what();
+					handle->state = LoadState::FAILED;
+					handle->promise.set_exception(std::current_exception());
+					log(LogLevel::WARNING, "failed to load `" + handle->path + "`: " + e.what() + "\n");
+				}
+			}
+
+			reportProgress(*handle);
+		}
+
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [](auto& handle) {
+			return handle->isFinished();
+		}), pending.end());
+
+		return (uint32_t)pending.size();
+	}
+
+	float AsyncLoader::getProgress() const {
+		if (pending.empty()) return 1;
+		float sum = 0;
+		for (auto& handle : pending) {
+			sum += handle->getProgress();
+		}
+		return sum / pending.size();
+	}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "DefaultLoader.h"
+#include "../Utilities/JobSystem.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <atomic>
+#include <functional>
+
+namespace LiteEngine::IO {
+
+	// 异步加载 glTF 模型
+	// CPU 阶段（读文件、解析、顶点转换、纹理解码）在 JobSystem 上并行执行，
+	// GPU 资源的创建集中在渲染线程的 update() 中串行完成
+	// 已加载过的模型（见 AssetRegistry）不会重复加载，结果是共享 GPU 资源的新实例
+	class AsyncLoader {
+	public:
+		enum class LoadState {
+			PREPARING,			// 工作线程处理中
+			WAITING_FOR_GPU,	// CPU 阶段完成，等待渲染线程创建资源
+			READY,
+			FAILED
+		};
+
+		class LoadHandle {
+			friend class AsyncLoader;
+
+			std::string path;
+			JobPriority priority;
+
+			std::atomic<uint32_t> finishedSteps{ 0 };
+			std::atomic<uint32_t> totalSteps{ 0 };
+
+			std::future<std::shared_ptr<DefaultModelDataGLTF>> preparation;
+			// 同一路径的模型已经加载时不再准备，直接复制实例
+			std::shared_ptr<const ModelAsset> loaded;
+			std::promise<std::shared_ptr<SceneManagement::Object>> promise;
+			std::shared_future<std::shared_ptr<SceneManagement::Object>> result;
+
+			// 以下成员只在渲染线程读写
+			LoadState state = LoadState::PREPARING;
+			std::string errorMessage;
+			float lastReportedProgress = -1;
+			std::function<void(const LoadHandle&)> progressCallback;
+
+		public:
+			const std::string& getPath() const { return path; }
+			JobPriority getPriority() const { return priority; }
+			LoadState getState() const { return state; }
+			const std::string& getErrorMessage() const { return errorMessage; }
+
+			bool isReady() const { return state == LoadState::READY; }
+			bool isFinished() const { return state == LoadState::READY || state == LoadState::FAILED; }
+
+			// [0, 1]。GPU 阶段算作最后一步
+			float getProgress() const {
+				if (state == LoadState::READY || state == LoadState::FAILED) return 1;
+				uint32_t total = totalSteps.load();
+				if (total == 0) return 0;
+				return (float)finishedSteps.load() / (total + 1);
+			}
+
+			// 只有 isReady() 之后才能调用
+			std::shared_ptr<SceneManagement::Object> get() const {
+				if (state == LoadState::FAILED) {
+					throw std::exception(errorMessage.c_str());
+				}
+				if (state != LoadState::READY) {
+					throw std::exception("resource is still loading");
+				}
+				return result.get();
+			}
+
+			// future 在渲染线程调用 update() 时才会就绪，所以不要在渲染线程上阻塞等待它
+			std::shared_future<std::shared_ptr<SceneManagement::Object>> getFuture() const {
+				return result;
+			}
+		};
+
+		using ProgressCallback = std::function<void(const LoadHandle&)>;
+
+	protected:
+		std::vector<std::shared_ptr<LoadHandle>> pending;
+
+		void reportProgress(LoadHandle& handle);
+
+	public:
+		// progress 回调在渲染线程的 update() 中调用
+		std::shared_ptr<LoadHandle> loadGLTF(
+			const std::string& path,
+			JobPriority priority = JobPriority::NORMAL,
+			ProgressCallback progress = nullptr
+		);
+
+		// 每帧在渲染线程调用
+		// maxCreations: 本次调用最多为几个模型创建 GPU 资源，避免一帧卡太久
+		// 返回仍未完成的加载数
+		uint32_t update(uint32_t maxCreations = UINT32_MAX);
+
+		bool isIdle() const {
+			return pending.empty();
+		}
+
+		// 所有未完成加载的平均进度，没有加载时返回 1
+		float getProgress() const;
+	};
+
+}
@@ -63,8 +63,8 @@ namespace LiteEngine::IO {
 				} else if (msg == WM_KEYUP) {
 					if(wparam == keyPlus && lastState == 1 || 
 						wparam == keyMinus && lastState == -1) {
-						// ǰһ֡µİڱ֡ǰɿ
-						// ״̬
+						// 如果前一帧按下的按键有在本帧按键按下前松开过
+						// 清空状态
 						if (currentState == 0) {
 							lastState = 0;
 						} else {
@@ -79,7 +79,7 @@ namespace LiteEngine::IO {
 
 			if (currentState == 0) currentState = lastState;
 
-			// invariant: currentFrameState ʾһ֡һΰµļӦ״̬
+			// invariant: currentFrameState 表示这一帧最后一次按下的键对应状态
 
 			if (currentState != lastState || currentState == 0) {
 				currentSpeed = currentState * initialSpeed;
@@ -89,7 +89,7 @@ namespace LiteEngine::IO {
 			if (currentSpeed == maxSpeed * currentState) {
 				deltaPos = currentSpeed * lastFrameDuration;
 			} else if (abs(currentSpeed + currentState * lastFrameDuration * acceleration) > maxSpeed) {
-				// μٽٶ
+				// 如果这次加速将超过最高速度
 				float tIntermediate = (maxSpeed - abs(currentSpeed)) / (lastFrameDuration * acceleration);
 				deltaPos += (2 * currentSpeed + currentState * tIntermediate * acceleration) * tIntermediate / 2;
 				deltaPos += (lastFrameDuration - tIntermediate) * maxSpeed * currentState;
@@ -109,7 +109,7 @@ namespace LiteEngine::IO {
 		}
 	};
 
-	//  WASD -  ĿƷʽ
+	// 经典 WASD - 鼠标 的控制方式
 	class HoldRotateController {
 		bool mouseLBDown = false;
 
@@ -117,8 +117,8 @@ namespace LiteEngine::IO {
 		int lastYPos = 0;
 
 		void boundXYZ() {
-			// һ֡תüȦ
-			// ңʹҲ󡣡
+			// 不至于一帧转好几圈吧
+			// 并且，即使出现了这种情况，问题也不大。。
 			if (accX < PI) {
 				accX += 2 * PI;
 			}
@@ -1,24 +1,39 @@
 #pragma once
 
 #include "../Renderer/Resources.h"
+#include "../Renderer/TextureProcessing.h"
 #include "../Scene/DefaultDS.h"
+#include "../Utilities/JobSystem.h"
+#include "AssetRegistry.h"
+
+#include <functional>
 
 namespace LiteEngine::IO {
     
+    // 导入时简化得到的一级 LOD，索引与原 primitive 使用相同的顶点
+    struct DefaultMeshLodGLTF {
+        uint32_t indexBegin;        // 与 DefaultMeshGLTF::indexBegin 含义相同
+        uint32_t indexLength;
+        float error;                // 局部空间中距原表面的距离
+    };
+
     struct DefaultMeshGLTF {
         std::string name;
         uint32_t materialID = 0;
         uint32_t indexBegin;
         uint32_t indexLength;
+        uint32_t vertexBegin;       // 在所属 mesh 的顶点中的位置
+        uint32_t vertexLength;
+        std::vector<DefaultMeshLodGLTF> lods;   // 精度依次降低，见 SceneManagement::buildLodChain
     };
 
     struct DefaultTexture2D {
-        // Ŀǰֻ֧ҵ texture
-        // ģ͵ʱ԰ѷҵ texture Ҳ浽ļ
+        // 目前先只支持外挂的 texture
+        // 加载模型的时候可以把非外挂的 texture 也存到文件中
         std::string path;
     };
     
-    // T: л
+    // T: 可以序列化的数据
     template<typename T>
     struct Hierarchy {
         uint32_t lchild = UINT32_MAX;
@@ -26,6 +41,113 @@ namespace LiteEngine::IO {
         T value;
     };
 
+    // 加载过程分为两个阶段：
+    //   prepare: 读文件、解析 JSON、转换顶点、解码纹理。不访问 D3D，可以在任意线程调用，
+    //            内部会把 mesh 和纹理拆分到 JobSystem 上并行处理
+    //   create:  创建 GPU 资源并构建场景结构。只能在渲染线程调用
+    struct DefaultModelDataGLTF;
+
+    // progress(已完成步骤数, 总步骤数)，在工作线程中调用
+    std::shared_ptr<DefaultModelDataGLTF> prepareDefaultResourceGLTF(
+        const std::string& pathStr,
+        JobPriority priority = JobPriority::NORMAL,
+        std::function<void(uint32_t, uint32_t)> progress = nullptr
+    );
+
+    // 通过 AssetRegistry 创建：内容相同的 mesh、材质、纹理在模型之间共享，已加载的模型不会重复创建
+    std::shared_ptr<const ModelAsset> createModelAssetGLTF(const DefaultModelDataGLTF& data);
+
+    // 返回模型的一个新实例（AssetInstance），所有实例共享 GPU 资源
+    std::shared_ptr<SceneManagement::Object> createDefaultResourceGLTF(const DefaultModelDataGLTF& data);
+
+    // 同一路径的模型已经加载时，直接复制一个实例
     std::shared_ptr<SceneManagement::Object> loadDefaultResourceGLTF(const std::string& pathStr);
 
+    // prepare 阶段对纹理的处理方式。修改后只影响之后开始的加载
+    struct TextureCookingOptions {
+        bool blockCompression = true;       // 按 slot 选择压缩格式，见 SceneManagement::getDefaultCompressedFormat
+        Rendering::BlockCompressionQuality quality = Rendering::BlockCompressionQuality::NORMAL;
+    };
+
+    void setTextureCookingOptions(const TextureCookingOptions& options);
+    TextureCookingOptions getTextureCookingOptions();
+
+    // 加载时的静态合批，见 SceneManagement::buildStaticBatches。修改后只影响之后开始的加载
+    // 静态子树中的 primitive 按材质合并，预先变换到子树根节点的空间，放在根节点下新增的 "__#STATIC_BATCH" 节点中。
+    // 子树中的节点仍然保留，但移动它们不再影响绘制；根节点（以及整个实例）仍然可以移动
+    // 子树中有动画目标、骨骼或可变形 mesh 时整个子树不合并
+    struct StaticBatchingOptions {
+        bool enabled = false;
+        bool wholeModel = false;            // 整个模型作为一个静态子树；否则只合并 extras 中 "static": true 的节点
+        uint32_t maxVerticesPerBatch = 65536;
+    };
+
+    void setStaticBatchingOptions(const StaticBatchingOptions& options);
+    StaticBatchingOptions getStaticBatchingOptions();
+
+    // 加载时为整个模型烘焙 impostor（静止姿态），见 SceneManagement::bakeImpostor。修改后只影响之后开始的加载
+    // 烘焙结果存入派生数据缓存。实例调用 AssetInstance::createImpostor 之后，屏幕上足够小时只画一个面片
+    struct ImpostorOptions {
+        bool enabled = false;
+        uint32_t framesPerSide = 8;
+        uint32_t frameSize = 64;
+    };
+
+    void setImpostorOptions(const ImpostorOptions& options);
+    ImpostorOptions getImpostorOptions();
+
+    // 加载时为不可变形的 mesh 生成软件遮挡剔除用的代理（Rendering::Mesh::occluder，见 Rendering::Renderer::enableOcclusionCulling）
+    // 代理取最粗的一级 LOD，三角形仍然多于 maxOccluderTriangles 时继续简化。修改后只影响之后开始的加载
+    struct OcclusionOptions {
+        bool generateOccluders = true;
+        uint32_t maxOccluderTriangles = 512;
+    };
+
+    void setOcclusionOptions(const OcclusionOptions& options);
+    OcclusionOptions getOcclusionOptions();
+
+    // 每个创建过的模型一项。draw call 数指绘制一个实例所需的次数（不含阴影 pass）
+    struct StaticBatchingStatistics {
+        std::string modelPath;
+        uint32_t subtrees = 0;
+        uint32_t skippedSubtrees = 0;
+        uint32_t drawsBefore = 0;
+        uint32_t drawsAfter = 0;
+        uint32_t batchedPrimitives = 0;
+        uint32_t batches = 0;
+        uint64_t vertices = 0;              // 合批中的顶点数
+        size_t memoryBytes = 0;             // 合批占用的顶点和索引内存。完全被合并的原 mesh 随之释放
+    };
+
+    // 自上次 clear 以来所有开启了合批的模型，可以在任意线程调用
+    std::vector<StaticBatchingStatistics> getStaticBatchingStatistics();
+    void clearStaticBatchingStatistics();
+
+    // 每个模型合批前后的 draw call 数，以及总计
+    std::string getStaticBatchingReport();
+
+    // 每张纹理在 prepare 阶段的统计信息
+    struct TextureLoadStatistics {
+        std::string modelPath;
+        std::string name;
+        uint64_t contentHash = 0;           // 编码后的图片字节 + slot + 烘焙选项的哈希
+        SceneManagement::DefaultShaderSlot slot = SceneManagement::DefaultShaderSlot::BASE_COLOR;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 0;
+        double decodeMilliseconds = 0;
+        double mipMilliseconds = 0;
+        double compressMilliseconds = 0;
+        double compressMegapixelsPerSecond = 0;
+        double psnr = 0;                    // 未压缩时为 +inf，从派生数据缓存读取时为 0
+        size_t uncompressedBytes = 0;       // 所有 mip，R8G8B8A8
+        size_t memoryBytes = 0;             // 所有 mip，最终上传到 GPU 的格式
+        bool deduplicated = false;          // 命中了其他模型（或同一模型）已解码的数据，没有重新解码
+        bool derivedDataCacheHit = false;   // 从磁盘上的派生数据缓存读取，见 DerivedDataCache
+    };
+
+    // 自上次 clear 以来所有加载过的纹理，可以在任意线程调用
+    std::vector<TextureLoadStatistics> getTextureLoadStatistics();
+    void clearTextureLoadStatistics();
 }
\ No newline at end of file
@@ -10,11 +10,29 @@
 #include "../Renderer/Renderer.h"
 #include "../Renderer/Resources.h"
 #include "../Scene/Scene.h"
+#include "../Scene/Animation.h"
+#include "../Scene/Skinning.h"
+#include "../Scene/MeshSimplification.h"
+#include "../Scene/StaticBatching.h"
+#include "../Scene/Impostor.h"
+#include "../Renderer/TextureProcessing.h"
+#include "../Renderer/BlockCompression.h"
+#include "../Utilities/JobSystem.h"
+#include "../Utilities/Hash.h"
 #include "DefaultLoader.h"
+#include "DerivedDataCache.h"
+#include "AssetRegistry.h"
 
+#include <algorithm>
 #include <cassert>
 #include <map>
+#include <set>
 #include <filesystem>
+#include <future>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 
 using namespace tinygltf;
@@ -22,6 +40,9 @@ using namespace tinygltf;
 
 namespace LiteEngine::IO {
 
+    // 派生数据缓存的 key 包含这个版本号。修改了转换 / 烘焙的逻辑后需要增加，使旧的缓存失效
+    constexpr uint64_t GLTF_IMPORTER_VERSION = 3;
+
 #pragma pack(push, 1)
     template<size_t M, size_t N, typename T>
     struct SmallMatrix {
@@ -79,18 +100,19 @@ namespace LiteEngine::IO {
     }
 
     template <typename TargetMatrix>
-    std::vector<TargetMatrix> load_data(tinygltf::Model model, int accessor_index) {
+    std::vector<TargetMatrix> load_data(const tinygltf::Model& model, int accessor_index) {
         constexpr int M = TargetMatrix::ShapeM;
         constexpr int N = TargetMatrix::ShapeN;
 
-        auto accessor = model.accessors[accessor_index];
+        // 注意不要复制 model / buffer：多个线程会同时读取同一个 model
+        auto& accessor = model.accessors[accessor_index];
         if (accessor.sparse.isSparse) {
             throw std::exception("mesh uses sparse accessor, which involves an "
                 "unimplemented feature");
         }
 
-        auto view = model.bufferViews[accessor.bufferView];
-        auto buffer = model.buffers[view.buffer];
+        auto& view = model.bufferViews[accessor.bufferView];
+        auto& buffer = model.buffers[view.buffer];
         auto stride = accessor.ByteStride(view);
         auto count = view.byteLength / stride;
 
@@ -161,6 +183,7 @@ namespace LiteEngine::IO {
         };
 
         std::vector<TargetMatrix> out;
+        out.reserve(count);
 
         for (int index = 0; index < count; index++) {
             size_t offset = view.byteOffset + accessor.byteOffset + stride * index;
@@ -185,7 +208,7 @@ namespace LiteEngine::IO {
         }
 
         auto attr = primitive.attributes.at("POSITION");
-        auto accessor = model.accessors[attr];
+        auto& accessor = model.accessors[attr];
 
         if (accessor.type != TINYGLTF_TYPE_VEC3 ||
             accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
@@ -200,7 +223,7 @@ namespace LiteEngine::IO {
     std::vector<Vec3f> load_mesh_normal(const tinygltf::Model& model,
         const tinygltf::Primitive& primitive) {
         auto attr = primitive.attributes.at("NORMAL");
-        auto accessor = model.accessors[attr];
+        auto& accessor = model.accessors[attr];
 
         if (accessor.type != TINYGLTF_TYPE_VEC3 ||
             accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
@@ -217,7 +240,7 @@ namespace LiteEngine::IO {
     std::vector<Vec2f> load_mesh_uvcoord(const tinygltf::Model& model,
         const tinygltf::Primitive& primitive, uint32_t uvID) {
         auto attr = primitive.attributes.at("TEXCOORD_" + std::to_string(uvID));
-        auto accessor = model.accessors[attr];
+        auto& accessor = model.accessors[attr];
 
         if (accessor.type != TINYGLTF_TYPE_VEC2 ||
             accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
@@ -233,7 +256,7 @@ namespace LiteEngine::IO {
     std::vector<Vec4f> load_mesh_tangent(const tinygltf::Model& model,
         const tinygltf::Primitive& primitive) {
         auto attr = primitive.attributes.at("TANGENT");
-        auto accessor = model.accessors[attr];
+        auto& accessor = model.accessors[attr];
 
         if (accessor.type != TINYGLTF_TYPE_VEC4 ||
             accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
@@ -250,7 +273,7 @@ namespace LiteEngine::IO {
     std::vector<Vec4f> load_mesh_color(const tinygltf::Model& model,
         const tinygltf::Primitive& primitive, uint32_t color_id) {
         auto attr = primitive.attributes.at("COLOR_" + std::to_string(color_id));
-        auto accessor = model.accessors[attr];
+        auto& accessor = model.accessors[attr];
 
         if (accessor.type == TINYGLTF_TYPE_VEC4 &&
             accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
@@ -311,7 +334,7 @@ namespace LiteEngine::IO {
             out.indexBegin = (uint32_t)indices.size();
             out.indexLength = (uint32_t)newIndices.size();
             for (size_t i = 0; i + 2 < newIndices.size(); i += 3) {
-                // Ӧ CULL_BACK
+                // 对应于 CULL_BACK
                 indices.push_back(offset + newIndices[i + 2].data[0][0]);
                 indices.push_back(offset + newIndices[i + 1].data[0][0]);
                 indices.push_back(offset + newIndices[i + 0].data[0][0]);
@@ -388,6 +411,8 @@ namespace LiteEngine::IO {
                 }
             }
 
+            out.vertexBegin = offset;
+            out.vertexLength = (uint32_t)positions.size();
             vb.resize(vb.size() + positions.size());
 
             for (int i = 0; i < positions.size(); i++) {
@@ -417,54 +442,491 @@ namespace LiteEngine::IO {
     //    return (uint32_t)reg.size() - 1;
     //}
 
+    // 一个 mesh 的转换结果，索引是相对于 vb 的
+    struct MeshConversion {
+        std::vector<SceneManagement::DefaultVertexData> vb;
+        std::vector<uint32_t> indices;
+        std::vector<DefaultMeshGLTF> meshes;
+
+        // 蒙皮和 morph target（见 loadMeshDeformation），不可变形的 mesh 为空
+        std::vector<SceneManagement::SkinWeights> weights;
+        std::vector<SceneManagement::MorphTarget> morphTargets;
+        std::vector<float> morphWeights;
+    };
+
+    static void serializeMeshConversion(const MeshConversion& conversion, std::vector<uint8_t>& data) {
+        DerivedDataWriter writer(data);
+        writer.writeVector(conversion.vb);
+        writer.writeVector(conversion.indices);
+        writer.write<uint64_t>(conversion.meshes.size());
+        for (auto& mesh : conversion.meshes) {
+            writer.writeString(mesh.name);
+            writer.write(mesh.materialID);
+            writer.write(mesh.indexBegin);
+            writer.write(mesh.indexLength);
+            writer.write(mesh.vertexBegin);
+            writer.write(mesh.vertexLength);
+            writer.writeVector(mesh.lods);
+        }
+        writer.writeVector(conversion.weights);
+        writer.write<uint64_t>(conversion.morphTargets.size());
+        for (auto& target : conversion.morphTargets) {
+            writer.writeString(target.name);
+            writer.writeVector(target.vertices);
+            writer.writeVector(target.positions);
+            writer.writeVector(target.normals);
+            writer.writeVector(target.tangents);
+        }
+        writer.writeVector(conversion.morphWeights);
+    }
+
+    static MeshConversion deserializeMeshConversion(const std::vector<uint8_t>& data) {
+        DerivedDataReader reader(data);
+        MeshConversion conversion;
+        conversion.vb = reader.readVector<SceneManagement::DefaultVertexData>();
+        conversion.indices = reader.readVector<uint32_t>();
+        conversion.meshes.resize((size_t)reader.read<uint64_t>());
+        for (auto& mesh : conversion.meshes) {
+            mesh.name = reader.readString();
+            mesh.materialID = reader.read<uint32_t>();
+            mesh.indexBegin = reader.read<uint32_t>();
+            mesh.indexLength = reader.read<uint32_t>();
+            mesh.vertexBegin = reader.read<uint32_t>();
+            mesh.vertexLength = reader.read<uint32_t>();
+            mesh.lods = reader.readVector<DefaultMeshLodGLTF>();
+        }
+        conversion.weights = reader.readVector<SceneManagement::SkinWeights>();
+        conversion.morphTargets.resize((size_t)reader.read<uint64_t>());
+        for (auto& target : conversion.morphTargets) {
+            target.name = reader.readString();
+            target.vertices = reader.readVector<uint32_t>();
+            target.positions = reader.readVector<DirectX::XMFLOAT3>();
+            target.normals = reader.readVector<DirectX::XMFLOAT3>();
+            target.tangents = reader.readVector<DirectX::XMFLOAT3>();
+        }
+        conversion.morphWeights = reader.readVector<float>();
+        return conversion;
+    }
+
+    // 为每个 primitive 生成 LOD，索引追加在 conversion.indices 的最后
+    // 可变形的 mesh 不生成：简化只能按静止姿态计算误差，变形之后误差没有意义
+    static void generateMeshLods(MeshConversion& conversion) {
+        if (!conversion.weights.empty() || !conversion.morphTargets.empty()) return;
+        for (auto& mesh : conversion.meshes) {
+            auto chain = SceneManagement::buildLodChain(conversion.vb.data() + mesh.vertexBegin, mesh.vertexLength,
+                conversion.indices.data() + mesh.indexBegin, mesh.indexLength, mesh.vertexBegin);
+            for (auto& level : chain) {
+                mesh.lods.push_back({ (uint32_t)conversion.indices.size(), (uint32_t)level.indices.size(), level.error });
+                conversion.indices.insert(conversion.indices.end(), level.indices.begin(), level.indices.end());
+            }
+        }
+    }
+
+    // 遮挡剔除的代理：最粗的一级 LOD（没有 LOD 时为原始网格），三角形多于 maxTriangles 时继续简化，只保留用到的顶点的位置
+    // mesh 的索引是在 conversion.indices 中的位置（还没有加上模型中的偏移）
+    static std::shared_ptr<const Rendering::OccluderMesh> createOccluderMesh(const MeshConversion& conversion,
+        const DefaultMeshGLTF& mesh, uint32_t maxTriangles) {
+        auto begin = mesh.lods.empty() ? mesh.indexBegin : mesh.lods.back().indexBegin;
+        auto length = mesh.lods.empty() ? mesh.indexLength : mesh.lods.back().indexLength;
+        if (length < 3 || maxTriangles == 0) return nullptr;
+
+        std::vector<uint32_t> indices(conversion.indices.begin() + begin, conversion.indices.begin() + begin + length);
+        if (length / 3 > maxTriangles) {
+            indices = SceneManagement::simplifyMesh(conversion.vb.data() + mesh.vertexBegin, mesh.vertexLength,
+                indices.data(), length, mesh.vertexBegin, maxTriangles * 3).indices;
+        }
+
+        std::shared_ptr<Rendering::OccluderMesh> out(new Rendering::OccluderMesh());
+        std::unordered_map<uint32_t, uint32_t> remap;
+        for (auto index : indices) {
+            auto [it, inserted] = remap.try_emplace(index, (uint32_t)out->positions.size());
+            if (inserted) out->positions.push_back(conversion.vb[index].position);
+            out->indices.push_back(it->second);
+        }
+        return out;
+    }
+
+    static void serializeTextureData(const std::shared_ptr<const Rendering::TextureData>& texture, std::vector<uint8_t>& data) {
+        DerivedDataWriter writer(data);
+        writer.write<uint32_t>(texture->format);
+        writer.writeVector(texture->mips);
+        writer.writeVector(texture->pixels);
+    }
+
+    static std::shared_ptr<const Rendering::TextureData> deserializeTextureData(const std::vector<uint8_t>& data) {
+        DerivedDataReader reader(data);
+        std::shared_ptr<Rendering::TextureData> texture(new Rendering::TextureData());
+        texture->format = (DXGI_FORMAT)reader.read<uint32_t>();
+        texture->mips = reader.readVector<Rendering::TextureData::MipLevel>();
+        texture->pixels = reader.readVector<uint8_t>();
+        for (auto& level : texture->mips) {
+            if (level.offset + level.slicePitch > texture->pixels.size()) {
+                throw std::exception("corrupted derived data");
+            }
+        }
+        return texture;
+    }
+
+    using TextureKey = std::pair<int, SceneManagement::DefaultShaderSlot>;   // (model.images 索引, 使用它的 slot)
+    struct CookedTexture {
+        uint64_t contentHash = 0;   // 同 TextureLoadStatistics::contentHash，也是 AssetRegistry 中的 key
+        std::string name;
+        std::shared_ptr<const Rendering::TextureData> data;
+    };
+    using TextureMap = std::map<TextureKey, CookedTexture>;
+
+    // 以内容哈希为 key 的解码结果，跨模型共享
+    // 只持有 weak_ptr：没有模型再引用时，数据随之释放
+    class TextureDecodeCache {
+        struct Entry {
+            std::weak_ptr<const Rendering::TextureData> data;
+            std::shared_future<void> ready;     // 正在解码时有效，解码完成后就绪
+        };
+
+        std::mutex lock;
+        std::map<uint64_t, Entry> entries;
+
+        std::mutex statisticsLock;
+        std::vector<TextureLoadStatistics> statistics;
+
+        std::mutex optionsLock;
+        TextureCookingOptions options;
+
+        TextureDecodeCache() = default;
+
+        // 调用者持有 lock
+        void eraseExpired(uint64_t keep) {
+            for (auto it = entries.begin(); it != entries.end();) {
+                bool decoding = it->second.ready.valid() && it->second.ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+                if (it->first != keep && !decoding && it->second.data.expired()) {
+                    it = entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+    public:
+        static TextureDecodeCache& getInstance() {
+            static TextureDecodeCache cache;
+            return cache;
+        }
+
+        // 同一个哈希同时只会有一个线程在解码，其他线程等待它的结果
+        std::shared_ptr<const Rendering::TextureData> acquire(
+            uint64_t hash,
+            const std::function<std::shared_ptr<const Rendering::TextureData>()>& decode,
+            bool& deduplicated
+        ) {
+            while (true) {
+                std::shared_future<void> pending;
+                std::promise<void> promise;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    auto& entry = entries[hash];
+                    if (auto data = entry.data.lock()) {
+                        deduplicated = true;
+                        return data;
+                    }
+                    if (entry.ready.valid() && entry.ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                        pending = entry.ready;
+                    } else {
+                        entry.ready = promise.get_future().share();
+                        // 未命中时才会解码，顺便清理数据已经释放、也没有在解码的条目，避免 map 随加载过的纹理数增长
+                        eraseExpired(hash);
+                    }
+                }
+
+                if (pending.valid()) {
+                    // 解码完成（或失败）后重新检查
+                    JobSystem::getInstance().wait(pending);
+                    continue;
+                }
+
+                std::shared_ptr<const Rendering::TextureData> data;
+                try {
+                    data = decode();
+                } catch (...) {
+                    promise.set_value();
+                    throw;
+                }
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    entries[hash].data = data;
+                }
+                promise.set_value();
+                deduplicated = false;
+                return data;
+            }
+        }
+
+        void addStatistics(const TextureLoadStatistics& stat) {
+            std::lock_guard<std::mutex> guard(statisticsLock);
+            statistics.push_back(stat);
+        }
+
+        std::vector<TextureLoadStatistics> getStatistics() {
+            std::lock_guard<std::mutex> guard(statisticsLock);
+            return statistics;
+        }
+
+        void clearStatistics() {
+            std::lock_guard<std::mutex> guard(statisticsLock);
+            statistics.clear();
+        }
+
+        void setOptions(const TextureCookingOptions& newOptions) {
+            std::lock_guard<std::mutex> guard(optionsLock);
+            options = newOptions;
+        }
+
+        TextureCookingOptions getOptions() {
+            std::lock_guard<std::mutex> guard(optionsLock);
+            return options;
+        }
+    };
+
+    std::vector<TextureLoadStatistics> getTextureLoadStatistics() {
+        return TextureDecodeCache::getInstance().getStatistics();
+    }
+
+    void clearTextureLoadStatistics() {
+        TextureDecodeCache::getInstance().clearStatistics();
+    }
+
+    void setTextureCookingOptions(const TextureCookingOptions& options) {
+        TextureDecodeCache::getInstance().setOptions(options);
+    }
+
+    TextureCookingOptions getTextureCookingOptions() {
+        return TextureDecodeCache::getInstance().getOptions();
+    }
+
+    static Rendering::TextureContent getTextureContent(SceneManagement::DefaultShaderSlot slot) {
+        switch (slot) {
+        case SceneManagement::DefaultShaderSlot::BASE_COLOR:
+        case SceneManagement::DefaultShaderSlot::EMISSION_COLOR:
+            return Rendering::TextureContent::COLOR;
+        case SceneManagement::DefaultShaderSlot::NORMAL:
+            return Rendering::TextureContent::NORMAL;
+        default:
+            return Rendering::TextureContent::DATA;
+        }
+    }
+
     class CachedTextureLoader {
-        std::map<int, Rendering::PtrShaderResourceView> cache;
+        std::map<TextureKey, std::shared_ptr<const TextureAsset>> cache;
+        // 由 CPU 阶段解码好
+        const TextureMap& textures;
+
+        static double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
 
     public:
+        CachedTextureLoader(const TextureMap& textures) :
+            textures(textures) {}
+
         void clearCache() {
             this->cache.clear();
         }
 
+        // 收集所有材质引用到的图片，以及它们分别用在哪个 slot 上
+        // metallicRoughness 纹理同时用于 METALLIC 和 ROUGHNESS，统一记为 METALLIC
+        static std::vector<TextureKey> collectReferences(const tinygltf::Model& model) {
+            std::set<TextureKey> keys;
+            auto add = [&](int textureIndex, SceneManagement::DefaultShaderSlot slot) {
+                if (textureIndex < 0) return;
+                auto source = model.textures[textureIndex].source;
+                if (source < 0) return;
+                if (model.images[source].bufferView < 0) {
+                    // todo.. it is pretty simple..
+                    log(LogLevel::WARNING, "external texture source is not supported yet, skipped");
+                    return;
+                }
+                keys.insert({ source, slot });
+            };
 
-        Rendering::PtrShaderResourceView loadTexture(
-            int textureInfoIndex,
-            const tinygltf::Model& model
-        ) {
-            if (cache.count(textureInfoIndex)) return cache[textureInfoIndex];
+            for (auto& mat : model.materials) {
+                add(mat.pbrMetallicRoughness.baseColorTexture.index, SceneManagement::DefaultShaderSlot::BASE_COLOR);
+                add(mat.emissiveTexture.index, SceneManagement::DefaultShaderSlot::EMISSION_COLOR);
+                add(mat.pbrMetallicRoughness.metallicRoughnessTexture.index, SceneManagement::DefaultShaderSlot::METALLIC);
+                add(mat.occlusionTexture.index, SceneManagement::DefaultShaderSlot::AMBIENT_OCCLUSION);
+                add(mat.normalTexture.index, SceneManagement::DefaultShaderSlot::NORMAL);
+            }
 
-            auto& renderer = Rendering::Renderer::getInstance();
+            return std::vector<TextureKey>(keys.begin(), keys.end());
+        }
 
-            if (textureInfoIndex >= 0) {
-                auto textureObj = model.textures[textureInfoIndex];
-                auto textureSource = model.images[textureObj.source];
+        // 解码、生成完整的 mip 链、按 slot 块压缩。不访问 D3D，在工作线程调用
+        static CookedTexture cookTexture(
+            const std::string& modelPath,
+            const tinygltf::Model& model,
+            TextureKey key
+        ) {
+            auto& image = model.images[key.first];
+            auto& bufferView = model.bufferViews[image.bufferView];
+            auto& buffer = model.buffers[bufferView.buffer];
+            auto bytes = &buffer.data[bufferView.byteOffset];
+            auto slot = key.second;
+            auto options = TextureDecodeCache::getInstance().getOptions();
+
+            TextureLoadStatistics stat;
+            stat.modelPath = modelPath;
+            stat.name = image.name.empty() ? "image#" + std::to_string(key.first) : image.name;
+            stat.slot = slot;
+            // 同一张图片用在不同 slot 上时，mip 和压缩格式都不同，不能共享
+            stat.contentHash = hashBytes(bytes, bufferView.byteLength);
+            stat.contentHash = hashCombine(stat.contentHash, (uint64_t)slot);
+            stat.contentHash = hashCombine(stat.contentHash, options.blockCompression ? 1 + (uint64_t)options.quality : 0);
+
+            auto data = TextureDecodeCache::getInstance().acquire(stat.contentHash, [&]() {
+                using PtrTextureData = std::shared_ptr<const Rendering::TextureData>;
+                auto& cache = DerivedDataCache::getInstance();
+
+                // 第一级缓存：解码 + mip，与压缩设置无关
+                auto decodeWithMips = [&]() {
+                    auto key = hashCombine(hashCombine(hashBytes(bytes, bufferView.byteLength), (uint64_t)slot), GLTF_IMPORTER_VERSION);
+                    return cache.fetch<PtrTextureData>("texture-mips", key, [&]() {
+                        auto begin = std::chrono::steady_clock::now();
+                        std::shared_ptr<Rendering::TextureData> decoded(new Rendering::TextureData(
+                            Rendering::Renderer::decodeTexture2DFromWIC(bytes, bufferView.byteLength)));
+                        stat.decodeMilliseconds = millisecondsSince(begin);
+
+                        // glTF 中金属度在 B、粗糙度在 G，换成 R / G 以便使用 BC5
+                        if (slot == SceneManagement::DefaultShaderSlot::METALLIC) {
+                            Rendering::swapChannels(*decoded, 0, 2);
+                        }
+
+                        begin = std::chrono::steady_clock::now();
+                        Rendering::generateMipChain(*decoded, getTextureContent(slot));
+                        stat.mipMilliseconds = millisecondsSince(begin);
+                        return PtrTextureData(decoded);
+                    }, serializeTextureData, deserializeTextureData, &stat.derivedDataCacheHit);
+                };
 
-                if (textureSource.bufferView < 0) {
-                    // todo.. it is pretty simple..
-                    log(LogLevel::WARNING, "external texture source is not supported yet, skipped");
-                } else {
-                    auto buffer_view = model.bufferViews[textureSource.bufferView];
-                    auto buffer = model.buffers[buffer_view.buffer];
-                    auto image_data = &buffer.data[buffer_view.byteOffset];
-                    return cache[textureInfoIndex] = renderer.createSimpleTexture2DFromWIC(image_data, buffer_view.byteLength);
+                if (!options.blockCompression) {
+                    auto decoded = decodeWithMips();
+                    stat.uncompressedBytes = Rendering::getTextureMemorySize(*decoded);
+                    return decoded;
                 }
+
+                // 第二级缓存：最终上传的数据
+                bool compressedHit = false;
+                auto cooked = cache.fetch<PtrTextureData>("texture-compressed",
+                    hashCombine(stat.contentHash, GLTF_IMPORTER_VERSION), [&]() {
+                    auto decoded = decodeWithMips();
+                    stat.uncompressedBytes = Rendering::getTextureMemorySize(*decoded);
+                    if (!Rendering::canBlockCompress(*decoded)) {
+                        log(LogLevel::WARNING, "texture " + stat.name + " is not a multiple of 4 in size, left uncompressed\n");
+                        return decoded;
+                    }
+
+                    bool hasAlpha = slot == SceneManagement::DefaultShaderSlot::BASE_COLOR && Rendering::hasTransparentPixels(*decoded);
+                    auto format = SceneManagement::getDefaultCompressedFormat(slot, hasAlpha, options.quality);
+
+                    Rendering::BlockCompressionStatistics compression;
+                    PtrTextureData compressed(new Rendering::TextureData(
+                        Rendering::compressTexture(*decoded, format, options.quality, &compression)));
+                    stat.compressMilliseconds = compression.milliseconds;
+                    stat.compressMegapixelsPerSecond = compression.megapixelsPerSecond;
+                    stat.psnr = compression.psnr;
+                    return compressed;
+                }, serializeTextureData, deserializeTextureData, &compressedHit);
+
+                if (compressedHit) stat.derivedDataCacheHit = true;
+                return cooked;
+            }, stat.deduplicated);
+
+            stat.format = data->format;
+            stat.width = data->getWidth();
+            stat.height = data->getHeight();
+            stat.mipLevels = (uint32_t)data->mips.size();
+            stat.memoryBytes = Rendering::getTextureMemorySize(*data);
+            if (!Rendering::isBlockCompressedFormat(data->format)) {
+                stat.psnr = std::numeric_limits<double>::infinity();
+            }
+            TextureDecodeCache::getInstance().addStatistics(stat);
+
+            char message[512];
+            if (stat.deduplicated) {
+                snprintf(message, sizeof(message), "texture %s (%s): %ux%u, format %d, %.1f KiB, deduplicated\n",
+                    stat.name.c_str(), hashToString(stat.contentHash).c_str(), stat.width, stat.height,
+                    (int)stat.format, stat.memoryBytes / 1024.0);
+            } else {
+                snprintf(message, sizeof(message), "texture %s (%s): %ux%u, %u mips, format %d, %.1f KiB -> %.1f KiB, "
+                    "decode %.2f ms, mip %.2f ms, compress %.2f ms (%.1f MP/s, PSNR %.2f dB)%s\n",
+                    stat.name.c_str(), hashToString(stat.contentHash).c_str(), stat.width, stat.height, stat.mipLevels,
+                    (int)stat.format, stat.uncompressedBytes / 1024.0, stat.memoryBytes / 1024.0,
+                    stat.decodeMilliseconds, stat.mipMilliseconds, stat.compressMilliseconds,
+                    stat.compressMegapixelsPerSecond, stat.psnr, stat.derivedDataCacheHit ? ", from derived data cache" : "");
             }
+            log(LogLevel::INFO, message);
 
-            return nullptr;
+            return CookedTexture{ stat.contentHash, stat.name, data };
+        }
+
+        // 烘焙后的格式，材质需要据此设置通道
+        DXGI_FORMAT getTextureFormat(
+            int textureInfoIndex,
+            SceneManagement::DefaultShaderSlot slot,
+            const tinygltf::Model& model
+        ) const {
+            if (textureInfoIndex < 0) return DXGI_FORMAT_UNKNOWN;
+            auto it = textures.find({ model.textures[textureInfoIndex].source, slot });
+            if (it == textures.end() || !it->second.data) return DXGI_FORMAT_UNKNOWN;
+            return it->second.data->format;
+        }
+
+        // 内容相同的纹理已被其他模型加载时，直接共享其 GPU 资源
+        std::shared_ptr<const TextureAsset> loadTexture(
+            int textureInfoIndex,
+            SceneManagement::DefaultShaderSlot slot,
+            const tinygltf::Model& model
+        ) {
+            if (textureInfoIndex < 0) return nullptr;
+
+            TextureKey key{ model.textures[textureInfoIndex].source, slot };
+            if (cache.count(key)) return cache[key];
+
+            auto it = textures.find(key);
+            if (it == textures.end() || !it->second.data) return nullptr;
+
+            auto& cooked = it->second;
+            return cache[key] = AssetRegistry::getInstance().acquire<TextureAsset>(cooked.contentHash, [&]() {
+                std::shared_ptr<TextureAsset> asset(new TextureAsset());
+                asset->name = cooked.name;
+                asset->view = Rendering::Renderer::getInstance().createTexture2D(*cooked.data);
+                asset->format = cooked.data->format;
+                asset->width = cooked.data->getWidth();
+                asset->height = cooked.data->getHeight();
+                asset->mipLevels = (uint32_t)cooked.data->mips.size();
+                asset->memoryBytes = Rendering::getTextureMemorySize(*cooked.data);
+                return asset;
+            });
         }
     };
 
 
+    // usedTextures: 材质引用到的纹理资产，材质资产需要持有它们
     std::shared_ptr<SceneManagement::DefaultMaterial> loadDefaultMaterial(
         const tinygltf::Material& mat,
         const tinygltf::Model& model,
-        std::map<std::string, uint32_t> textureReg,
-        CachedTextureLoader& loader
+        CachedTextureLoader& textureLoader,
+        std::vector<std::shared_ptr<const TextureAsset>>& usedTextures
     ) {
         auto& renderer = Rendering::Renderer::getInstance();
         SceneManagement::DefaultMaterialConstantData constants;
         
         std::shared_ptr<SceneManagement::DefaultMaterial> out(new SceneManagement::DefaultMaterial());
 
+        auto loadTexture = [&](int textureInfoIndex, SceneManagement::DefaultShaderSlot slot) -> Rendering::PtrShaderResourceView {
+            auto asset = textureLoader.loadTexture(textureInfoIndex, slot, model);
+            if (!asset) return nullptr;
+            usedTextures.push_back(asset);
+            return asset->view;
+        };
+
         constants.baseColor = DirectX::XMFLOAT4{
             (float)mat.pbrMetallicRoughness.baseColorFactor[0],
             (float)mat.pbrMetallicRoughness.baseColorFactor[1],
@@ -480,42 +942,47 @@ namespace LiteEngine::IO {
         constants.metallic = (float)mat.pbrMetallicRoughness.metallicFactor;
         constants.roughness = (float)mat.pbrMetallicRoughness.roughnessFactor;
    
-        constants.anisotropy  = 0; // ȷʵ֧֡ Ȼ extension
+        constants.anisotropy  = 0; // 确实不支持。。 当然，有 extension
         // out.shader is set by the constructor
 
 
-        out->texBaseColor = loader.loadTexture(mat.pbrMetallicRoughness.baseColorTexture.index, model);
+        out->texBaseColor = loadTexture(mat.pbrMetallicRoughness.baseColorTexture.index, SceneManagement::DefaultShaderSlot::BASE_COLOR);
         if(out->texBaseColor) constants.uvBaseColor = mat.pbrMetallicRoughness.baseColorTexture.texCoord;
         
-        out->texEmissionColor = loader.loadTexture(mat.emissiveTexture.index, model);
+        out->texEmissionColor = loadTexture(mat.emissiveTexture.index, SceneManagement::DefaultShaderSlot::EMISSION_COLOR);
         if(out->texEmissionColor) constants.uvEmissionColor = mat.emissiveTexture.texCoord;
         
         
-        auto rmTexture = loader.loadTexture(mat.pbrMetallicRoughness.metallicRoughnessTexture.index, model); 
+        auto rmTexture = loadTexture(mat.pbrMetallicRoughness.metallicRoughnessTexture.index, SceneManagement::DefaultShaderSlot::METALLIC);
         if (rmTexture) {
+            // 烘焙时已把金属度从 B 换到 R
             out->texMetallic = rmTexture;
             constants.uvMetallic = mat.pbrMetallicRoughness.metallicRoughnessTexture.texCoord;
-            constants.channelMetallic = 2;
+            constants.channelMetallic = 0;
 
             out->texRoughness = rmTexture;
             constants.uvRoughness = mat.pbrMetallicRoughness.metallicRoughnessTexture.texCoord;
             constants.channelRoughness = 1;
         }
         
-        out->texAO = loader.loadTexture(mat.occlusionTexture.index, model);
+        out->texAO = loadTexture(mat.occlusionTexture.index, SceneManagement::DefaultShaderSlot::AMBIENT_OCCLUSION);
         if (out->texAO) {
             constants.uvAO = mat.occlusionTexture.texCoord;
             constants.occlusionStrength = (float)mat.occlusionTexture.strength;
             constants.channelAO = 0;
         }
 
-        out->texNormal = loader.loadTexture(mat.normalTexture.index, model);
-        if(out->texNormal)constants.uvNormal = mat.normalTexture.texCoord;
+        out->texNormal = loadTexture(mat.normalTexture.index, SceneManagement::DefaultShaderSlot::NORMAL);
+        if (out->texNormal) {
+            constants.uvNormal = mat.normalTexture.texCoord;
+            constants.normalReconstructZ = textureLoader.getTextureFormat(mat.normalTexture.index,
+                SceneManagement::DefaultShaderSlot::NORMAL, model) == DXGI_FORMAT_BC5_UNORM ? 1 : 0;
+        }
         constants.normalMapScale = (float)mat.normalTexture.scale;
 
-        // Ҫ defaultֻҪ uv ûãͲȥȡ
+        // 不需要设置 default：只要 uv 没有设置，就不会去读取纹理的
 
-        //  sampler state Ӧ texture 仯
+        // 这个 sampler state 应该是随着 texture 变化的
         CD3D11_SAMPLER_DESC desc{ CD3D11_DEFAULT() };
         out->sampAO = renderer.createSamplerState(desc);
         out->sampBaseColor = renderer.createSamplerState(desc);
@@ -531,12 +998,305 @@ namespace LiteEngine::IO {
         return out;
     }
 
+    // 按 accessor.count 读取为 float。与 load_data 不同，多个 accessor 共用一个 bufferView 时也能正确读取
+    // 归一化的整数（旋转、WEIGHTS_0 允许这样存储）转换到 [-1, 1] / [0, 1]，其他整数（JOINTS_0）保持原值
+    // 支持 sparse accessor：没有 bufferView 时基础值全部为 0（morph target 常常这样存储）
+    std::vector<float> loadAccessorAsFloat(const tinygltf::Model& model, int accessorIndex, uint32_t components) {
+        auto& accessor = model.accessors[accessorIndex];
+        if (tinygltf::GetNumComponentsInType(accessor.type) != (int)components) {
+            throw std::exception("accessor has an unexpected type. the gltf file is corrupted!");
+        }
+
+        auto componentLength = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+        auto loadComponent = [&](const unsigned char* raw) -> float {
+            switch (accessor.componentType) {
+            case TINYGLTF_COMPONENT_TYPE_FLOAT:
+                return load_little_endian<float>(raw);
+            case TINYGLTF_COMPONENT_TYPE_BYTE: {
+                auto value = load_little_endian<int8_t>(raw);
+                return accessor.normalized ? std::max(value / 127.f, -1.f) : value;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+                auto value = load_little_endian<uint8_t>(raw);
+                return accessor.normalized ? value / 255.f : value;
+            }
+            case TINYGLTF_COMPONENT_TYPE_SHORT: {
+                auto value = load_little_endian<int16_t>(raw);
+                return accessor.normalized ? std::max(value / 32767.f, -1.f) : value;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+                auto value = load_little_endian<uint16_t>(raw);
+                return accessor.normalized ? value / 65535.f : value;
+            }
+            default:
+                throw std::exception("unsupported component type in accessor. the gltf file is corrupted!");
+            }
+        };
+
+        std::vector<float> out(accessor.count * components, 0.f);
+        if (accessor.bufferView >= 0) {
+            auto& view = model.bufferViews[accessor.bufferView];
+            auto& buffer = model.buffers[view.buffer];
+            auto stride = accessor.ByteStride(view);
+            for (size_t index = 0; index < accessor.count; index++) {
+                auto element = &buffer.data[view.byteOffset + accessor.byteOffset + stride * index];
+                for (uint32_t i = 0; i < components; i++) {
+                    out[index * components + i] = loadComponent(element + componentLength * i);
+                }
+            }
+        }
+
+        if (accessor.sparse.isSparse) {
+            auto& indices = accessor.sparse.indices;
+            auto& values = accessor.sparse.values;
+            auto& indexView = model.bufferViews[indices.bufferView];
+            auto& indexBuffer = model.buffers[indexView.buffer];
+            auto& valueView = model.bufferViews[values.bufferView];
+            auto& valueBuffer = model.buffers[valueView.buffer];
+            auto indexLength = tinygltf::GetComponentSizeInBytes(indices.componentType);
+
+            for (int k = 0; k < accessor.sparse.count; k++) {
+                auto raw = &indexBuffer.data[indexView.byteOffset + indices.byteOffset + indexLength * k];
+                size_t index;
+                switch (indices.componentType) {
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: index = load_little_endian<uint8_t>(raw); break;
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: index = load_little_endian<uint16_t>(raw); break;
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: index = load_little_endian<uint32_t>(raw); break;
+                default:
+                    throw std::exception("unsupported sparse index type. the gltf file is corrupted!");
+                }
+                if (index >= accessor.count) {
+                    throw std::exception("sparse index is out of range. the gltf file is corrupted!");
+                }
+                auto element = &valueBuffer.data[valueView.byteOffset + values.byteOffset + componentLength * components * k];
+                for (uint32_t i = 0; i < components; i++) {
+                    out[index * components + i] = loadComponent(element + componentLength * i);
+                }
+            }
+        }
+        return out;
+    }
+
+    // 读取 JOINTS_0 / WEIGHTS_0 和 morph target，与 loadDefaultMesh 得到的顶点一一对应
+    // 没有蒙皮也没有 morph target 的 mesh，conversion 中的这几项保持为空
+    void loadMeshDeformation(const tinygltf::Mesh& mesh, const Model& model, MeshConversion& conversion) {
+        bool skinned = false;
+        size_t targetCount = 0;
+        for (auto& primitive : mesh.primitives) {
+            skinned |= primitive.attributes.count("JOINTS_0") && primitive.attributes.count("WEIGHTS_0");
+            targetCount = std::max(targetCount, primitive.targets.size());
+        }
+
+        if (skinned) {
+            conversion.weights.resize(conversion.vb.size(), SceneManagement::SkinWeights{ { 0, 0, 0, 0 }, { 1, 0, 0, 0 } });
+            for (size_t pID = 0; pID < mesh.primitives.size(); pID++) {
+                auto& primitive = mesh.primitives[pID];
+                auto& range = conversion.meshes[pID];
+                if (!primitive.attributes.count("JOINTS_0") || !primitive.attributes.count("WEIGHTS_0")) {
+                    log(LogLevel::WARNING, "mesh " + mesh.name + ": a primitive without JOINTS_0 / WEIGHTS_0 follows the first joint\n");
+                    continue;
+                }
+                if (primitive.attributes.count("JOINTS_1")) {
+                    log(LogLevel::WARNING, "mesh " + mesh.name + ": only 4 joints per vertex are supported, JOINTS_1 is ignored\n");
+                }
+
+                auto joints = loadAccessorAsFloat(model, primitive.attributes.at("JOINTS_0"), 4);
+                auto weights = loadAccessorAsFloat(model, primitive.attributes.at("WEIGHTS_0"), 4);
+                if (joints.size() != range.vertexLength * 4 || weights.size() != range.vertexLength * 4) {
+                    throw std::exception("JOINTS_0 / WEIGHTS_0 do not match POSITION. the gltf file is corrupted!");
+                }
+
+                for (uint32_t v = 0; v < range.vertexLength; v++) {
+                    auto& out = conversion.weights[range.vertexBegin + v];
+                    float sum = 0;
+                    for (int k = 0; k < 4; k++) {
+                        auto joint = joints[v * 4 + k];
+                        if (joint < 0 || joint > UINT16_MAX) {
+                            throw std::exception("joint index is out of range. the gltf file is corrupted!");
+                        }
+                        out.joints[k] = (uint16_t)joint;
+                        out.weights[k] = std::max(weights[v * 4 + k], 0.f);
+                        sum += out.weights[k];
+                    }
+                    // 导出工具写入的权重之和不一定精确为 1
+                    if (sum > 0) {
+                        for (auto& weight : out.weights) weight /= sum;
+                    } else {
+                        out.weights[0] = 1;
+                    }
+                }
+            }
+        }
+
+        if (targetCount > 0) {
+            std::vector<std::string> targetNames;
+            if (mesh.extras.Has("targetNames")) {
+                auto& names = mesh.extras.Get("targetNames");
+                for (size_t i = 0; i < names.ArrayLen(); i++) targetNames.push_back(names.Get((int)i).Get<std::string>());
+            }
+
+            conversion.morphTargets.resize(targetCount);
+            for (size_t t = 0; t < targetCount; t++) {
+                auto& target = conversion.morphTargets[t];
+                target.name = t < targetNames.size() ? targetNames[t] : "target" + std::to_string(t);
+
+                bool hasNormals = false, hasTangents = false;
+                for (auto& primitive : mesh.primitives) {
+                    if (primitive.targets.size() != targetCount) {
+                        throw std::exception("primitives of a mesh have different numbers of morph targets. the gltf file is corrupted!");
+                    }
+                    hasNormals |= primitive.targets[t].count("NORMAL") > 0;
+                    hasTangents |= primitive.targets[t].count("TANGENT") > 0;
+                }
+
+                for (size_t pID = 0; pID < mesh.primitives.size(); pID++) {
+                    auto& attributes = mesh.primitives[pID].targets[t];
+                    auto& range = conversion.meshes[pID];
+                    auto loadDeltas = [&](const char* name) {
+                        auto it = attributes.find(name);
+                        if (it == attributes.end()) return std::vector<float>(range.vertexLength * 3, 0.f);
+                        auto deltas = loadAccessorAsFloat(model, it->second, 3);
+                        if (deltas.size() != range.vertexLength * 3) {
+                            throw std::exception("morph target does not match POSITION. the gltf file is corrupted!");
+                        }
+                        return deltas;
+                    };
+                    auto positions = loadDeltas("POSITION");
+                    auto normals = loadDeltas("NORMAL");
+                    auto tangents = loadDeltas("TANGENT");
+
+                    // 只保留位移不为 0 的顶点
+                    for (uint32_t v = 0; v < range.vertexLength; v++) {
+                        auto p = &positions[v * 3], n = &normals[v * 3], tg = &tangents[v * 3];
+                        bool moved = false;
+                        for (int i = 0; i < 3; i++) moved |= p[i] != 0 || n[i] != 0 || tg[i] != 0;
+                        if (!moved) continue;
+
+                        target.vertices.push_back(range.vertexBegin + v);
+                        target.positions.push_back({ p[0], p[1], p[2] });
+                        if (hasNormals) target.normals.push_back({ n[0], n[1], n[2] });
+                        if (hasTangents) target.tangents.push_back({ tg[0], tg[1], tg[2] });
+                    }
+                }
+            }
+
+            conversion.morphWeights.assign(targetCount, 0.f);
+            for (size_t i = 0; i < mesh.weights.size() && i < targetCount; i++) {
+                conversion.morphWeights[i] = (float)mesh.weights[i];
+            }
+        }
+    }
+
+    // 准备阶段得到的动画。clip 的 targets 此时还是空的，创建 prototype 之后才知道节点在层级中的路径
+    struct PreparedAnimationGLTF {
+        std::shared_ptr<SceneManagement::AnimationClip> clip;
+        std::vector<int> targetNodes;       // clip->targets 中每一项对应的 glTF 节点
+    };
+
+    PreparedAnimationGLTF loadAnimationClip(const tinygltf::Animation& animation, const tinygltf::Model& model, size_t animationID) {
+        PreparedAnimationGLTF out;
+        out.clip = std::shared_ptr<SceneManagement::AnimationClip>(new SceneManagement::AnimationClip());
+        out.clip->name = animation.name.empty() ? "animation" + std::to_string(animationID) : animation.name;
+
+        std::map<int, uint32_t> targetIDs;
+        for (auto& channel : animation.channels) {
+            if (channel.target_node < 0) continue;
+
+            SceneManagement::AnimationPath path;
+            if (channel.target_path == "translation") path = SceneManagement::AnimationPath::TRANSLATION;
+            else if (channel.target_path == "rotation") path = SceneManagement::AnimationPath::ROTATION;
+            else if (channel.target_path == "scale") path = SceneManagement::AnimationPath::SCALE;
+            else {
+                log(LogLevel::WARNING, "animation " + out.clip->name + ": " + channel.target_path + " channel is not supported yet, skipped\n");
+                continue;
+            }
+
+            auto& sampler = animation.samplers[channel.sampler];
+            SceneManagement::AnimationInterpolation interpolation;
+            if (sampler.interpolation == "STEP") interpolation = SceneManagement::AnimationInterpolation::STEP;
+            else if (sampler.interpolation == "CUBICSPLINE") interpolation = SceneManagement::AnimationInterpolation::CUBIC_SPLINE;
+            else interpolation = SceneManagement::AnimationInterpolation::LINEAR;
+
+            auto& input = model.accessors[sampler.input];
+            if (input.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
+                throw std::exception("animation sampler input must be float. the gltf file is corrupted!");
+            }
+            uint32_t components = path == SceneManagement::AnimationPath::ROTATION ? 4 : 3;
+            auto times = loadAccessorAsFloat(model, sampler.input, 1);
+            auto values = loadAccessorAsFloat(model, sampler.output, components);
+            auto valuesPerKey = interpolation == SceneManagement::AnimationInterpolation::CUBIC_SPLINE ? 3u : 1u;
+            if (times.empty() || values.size() != times.size() * valuesPerKey * components) {
+                throw std::exception("animation sampler input and output do not match. the gltf file is corrupted!");
+            }
+
+            // 相机节点的 z 缩放在导入时取反（见 buildObjectHierarchy），缩放动画也要一致
+            if (path == SceneManagement::AnimationPath::SCALE && model.nodes[channel.target_node].camera >= 0) {
+                for (size_t i = 2; i < values.size(); i += 3) values[i] = -values[i];
+            }
+
+            auto [it, inserted] = targetIDs.insert({ channel.target_node, (uint32_t)out.targetNodes.size() });
+            if (inserted) {
+                out.targetNodes.push_back(channel.target_node);
+                out.clip->targets.push_back({});
+                out.clip->targetNames.push_back(model.nodes[channel.target_node].name);
+            }
+            out.clip->addChannel(it->second, path, interpolation, times.data(), values.data(), (uint32_t)times.size());
+        }
+
+        out.clip->finalize();
+        return out;
+    }
+
+    static bool hasGpuInstancing(const tinygltf::Node& node) {
+        return node.extensions.find("EXT_mesh_gpu_instancing") != node.extensions.end();
+    }
+
+    // EXT_mesh_gpu_instancing：每个实例的 TRS 在节点变换之前作用。没有这个扩展时返回 nullptr
+    std::shared_ptr<const Rendering::InstanceTransforms> loadInstanceTransforms(
+        const tinygltf::Node& inNode,
+        const tinygltf::Model& model
+    ) {
+        auto itExt = inNode.extensions.find("EXT_mesh_gpu_instancing");
+        if (itExt == inNode.extensions.end() || inNode.mesh < 0) return nullptr;
+
+        auto& attributes = itExt->second.Get("attributes");
+        auto loadAttribute = [&](const char* name, uint32_t components) {
+            if (!attributes.Has(name)) return std::vector<float>();
+            return loadAccessorAsFloat(model, attributes.Get(name).GetNumberAsInt(), components);
+        };
+        auto translations = loadAttribute("TRANSLATION", 3);
+        auto rotations = loadAttribute("ROTATION", 4);
+        auto scales = loadAttribute("SCALE", 3);
+
+        size_t count = std::max({ translations.size() / 3, rotations.size() / 4, scales.size() / 3 });
+        if ((!translations.empty() && translations.size() != count * 3) ||
+            (!rotations.empty() && rotations.size() != count * 4) ||
+            (!scales.empty() && scales.size() != count * 3)) {
+            throw std::exception("instance attributes have different counts. the gltf file is corrupted!");
+        }
+
+        std::shared_ptr<Rendering::InstanceTransforms> out(new Rendering::InstanceTransforms());
+        out->transforms.resize(count);
+        out->inverses.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            auto T = translations.empty() ? DirectX::XMVectorZero() : DirectX::XMLoadFloat3((const DirectX::XMFLOAT3*)&translations[i * 3]);
+            auto R = rotations.empty() ? DirectX::XMQuaternionIdentity() : DirectX::XMLoadFloat4((const DirectX::XMFLOAT4*)&rotations[i * 4]);
+            auto S = scales.empty() ? DirectX::XMVectorSplatOne() : DirectX::XMLoadFloat3((const DirectX::XMFLOAT3*)&scales[i * 3]);
+            auto transform = DirectX::XMMatrixAffineTransformation(S, DirectX::XMVectorZero(), R, T);
+            auto det = DirectX::XMMatrixDeterminant(transform);
+            DirectX::XMStoreFloat4x4(&out->transforms[i], transform);
+            DirectX::XMStoreFloat4x4(&out->inverses[i], DirectX::XMMatrixInverse(&det, transform));
+        }
+        return out;
+    }
+
     std::shared_ptr<SceneManagement::Object> buildObjectHierarchy(
         const tinygltf::Node& inNode,
         const tinygltf::Model& model,
         std::shared_ptr<SceneManagement::Object> parent,
         const std::vector<std::vector<std::tuple<std::shared_ptr<Rendering::Mesh>, uint32_t, std::string>>>& meshes,
-        const std::vector<std::shared_ptr<SceneManagement::DefaultMaterial>>& materials
+        const std::vector<std::shared_ptr<SceneManagement::DefaultMaterial>>& materials,
+        std::vector<SceneManagement::Object*>& nodeObjects
     ) {
         std::string nodeName = inNode.name;
 
@@ -547,10 +1307,10 @@ namespace LiteEngine::IO {
             lightID = itExtLight->second.Get("light").GetNumberAsInt();
         }
 
-        // ׼ûȷ˵
+        // 标准上没有明确说。。
         bool isMesh = inNode.mesh >= 0;
         bool isCamera = inNode.camera >= 0;
-        bool isLight = lightID >= 0; // glTF ݲֵ֧ƹ
+        bool isLight = lightID >= 0; // glTF 暂不支持灯光
 
         if ((isMesh ? 1 : 0) + (isCamera ? 1 : 0) + (isLight ? 1 : 0) > 1) {
             throw std::exception("an object can only be one of mesh, camera or light");
@@ -589,7 +1349,7 @@ namespace LiteEngine::IO {
             auto intensity = inLight.intensity;
             if (inLight.type == "point") {
                 outLight->type = Rendering::LightType::LIGHT_TYPE_POINT;
-                // һõּ֡ȾӦ blender Ĺ
+                // 一个随意设置的数字。。旨在让渲染器适应 blender 的光照设置
                 intensity /= 100;
             } else if (inLight.type == "directional") {
                 outLight->type = Rendering::LightType::LIGHT_TYPE_DIRECTIONAL;
@@ -629,11 +1389,13 @@ namespace LiteEngine::IO {
                 defaultMaterial->sampRoughness = defaultSampler;
             });
 
-            
+
+            auto instances = loadInstanceTransforms(inNode, model);
             for (auto [mesh, matID, name] : meshes[inNode.mesh]) {
                 auto meshObj = new SceneManagement::Mesh();
                 meshObj->name = name;
                 meshObj->parent = outNode;
+                meshObj->instances = instances;
 
                 if (matID == UINT32_MAX) meshObj->material = defaultMaterial;
                 else meshObj->material = materials[matID];
@@ -663,10 +1425,11 @@ namespace LiteEngine::IO {
         inNode.mTransformation.Decompose(aiScaling, aiRotation, aiPosition);*/
         if (inNode.matrix.empty()) {
             if (!inNode.translation.empty()) {
-                outNode->transT = DirectX::XMFLOAT3{
-                    (float)inNode.translation[0],
-                    (float)inNode.translation[1],
-                    (float)inNode.translation[2]
+                // glTF 中是双精度，原样保留
+                outNode->transT = Double3{
+                    inNode.translation[0],
+                    inNode.translation[1],
+                    inNode.translation[2]
                 };
             }
 
@@ -694,8 +1457,8 @@ namespace LiteEngine::IO {
             //    m[0x2], m[0x6], m[0xA], m[0xE],
             //    m[0x3], m[0x7], m[0xB], m[0xF]
             //};          
-            // m Ĵ洢ʽ XM պ෴
-            // m ǵ˵ľXM ҳ˾󡣡ָպ෴
+            // m 是列主序的存储方式，和 XM 刚好相反
+            // m 是当作左乘的矩阵，XM 是右乘矩阵。。又刚好相反
             DirectX::XMMATRIX trans{
                 (float)m[0x0], (float)m[0x1], (float)m[0x2], (float)m[0x3],
                 (float)m[0x4], (float)m[0x5], (float)m[0x6], (float)m[0x7],
@@ -705,42 +1468,289 @@ namespace LiteEngine::IO {
             DirectX::XMVECTOR T, S;
             DirectX::XMMatrixDecompose(&S, &outNode->transR, &T, trans);
             DirectX::XMStoreFloat3(&outNode->transS, S);
-            DirectX::XMStoreFloat3(&outNode->transT, T);
+            outNode->transT = Double3{ m[0xC], m[0xD], m[0xE] };
         }
 
         if (isCamera) {
-            // ϵתˣûôװ
+            // 就这样就完成了左右手系转换了？？？？？没那么容易吧
             outNode->transS.z *= -1.f;
         }
 
+        // glTF 节点 -> 创建出的物体，动画需要据此找到目标
+        nodeObjects[&inNode - model.nodes.data()] = outNode.get();
+
         // hierarchy
         outNode->parent = parent;
         for (auto child: inNode.children) {
             outNode->children.push_back(buildObjectHierarchy(
-                model.nodes[child], model, outNode, meshes, materials));
+                model.nodes[child], model, outNode, meshes, materials, nodeObjects));
         }
 
         return outNode;
     }
 
-    std::shared_ptr<SceneManagement::Object> loadDefaultResourceGLTF(const std::string& pathStr) {
-        auto& renderer = Rendering::Renderer::getInstance();
+    struct DefaultModelDataGLTF {
+        std::string path;
+        uint64_t sourceHash = 0;        // 文件内容 + GLTF_IMPORTER_VERSION
+        Model model;
+
+        // 所有 mesh 的数据依次拼接。indices 中的值相对于所在 mesh 的第一个顶点
+        // 每个 mesh 的索引中先是各个 primitive，然后是它们的 LOD
+        std::vector<SceneManagement::DefaultVertexData> vboData;
+        std::vector<uint32_t> indices;
+        std::vector<std::vector<DefaultMeshGLTF>> meshIn;       // indexBegin 是在 indices 中的位置
+
+        // 材质引用到的图片，已生成 mip 并压缩。可能与其他模型共享
+        TextureMap textures;
+
+        struct MeshRange {
+            uint32_t vertexBegin;
+            uint32_t vertexCount;
+            uint32_t indexBegin;
+            uint32_t indexCount;
+        };
+        std::vector<MeshRange> meshRanges;
+
+        std::vector<PreparedAnimationGLTF> animations;
+
+        // 每个 mesh 一项，没有蒙皮也没有 morph target 的为空
+        std::vector<std::shared_ptr<const SceneManagement::DeformableMeshData>> deformableMeshes;
+
+        // prepare 开始时的设置，create 阶段按此合批
+        StaticBatchingOptions staticBatching;
+
+        // 每个 mesh 的每个 primitive 一项，可变形的或者没有开启时为空
+        OcclusionOptions occlusionOptions;
+        std::vector<std::vector<std::shared_ptr<const Rendering::OccluderMesh>>> occluders;
+
+        // 没有开启 impostor 时为空
+        ImpostorOptions impostorOptions;
+        std::shared_ptr<const SceneManagement::ImpostorAtlas> impostor;
+
+        // 模型资产的 key：源文件 + 纹理烘焙结果 + 合批设置 + 遮挡代理设置。设置不同时不能共享材质、mesh 和层级
+        uint64_t getAssetKey() const {
+            uint64_t key = sourceHash;
+            for (auto& [textureKey, texture] : textures) {
+                key = hashCombine(key, texture.contentHash);
+            }
+            if (staticBatching.enabled) {
+                key = hashCombine(key, hashCombine(staticBatching.wholeModel, staticBatching.maxVerticesPerBatch));
+            }
+            if (impostor) {
+                key = hashCombine(key, hashCombine(impostor->framesPerSide, impostor->frameSize));
+            }
+            key = hashCombine(key, getOcclusionKey());
+            return key;
+        }
+
+        // mesh 资产的 key：源文件 + mesh 序号 + 遮挡代理的设置。设置不同时 primitive 的 occluder 不同，不能共享
+        uint64_t getMeshAssetKey(size_t meshID) const {
+            return hashCombine(hashCombine(sourceHash, meshID), getOcclusionKey());
+        }
+
+        uint64_t getOcclusionKey() const {
+            if (!occlusionOptions.generateOccluders) return hashBytes("no-occluder", 11);
+            return occlusionOptions.maxOccluderTriangles;
+        }
+    };
+
+    // tinygltf 默认会在解析时用 stb_image 解码所有图片，而我们之后会自己并行解码，所以跳过
+    static bool skipImageDecoding(Image*, const int, std::string*, std::string*,
+        int, int, const unsigned char*, int, void*) {
+        return true;
+    }
+
+    // impostor 的设置，可以在任意线程访问
+    static std::mutex impostorOptionsLock;
+    static ImpostorOptions impostorOptions;
+
+    void setImpostorOptions(const ImpostorOptions& options) {
+        std::lock_guard<std::mutex> guard(impostorOptionsLock);
+        impostorOptions = options;
+    }
+
+    ImpostorOptions getImpostorOptions() {
+        std::lock_guard<std::mutex> guard(impostorOptionsLock);
+        return impostorOptions;
+    }
+
+    // 遮挡剔除的设置，可以在任意线程访问
+    static std::mutex occlusionOptionsLock;
+    static OcclusionOptions occlusionOptions;
+
+    void setOcclusionOptions(const OcclusionOptions& options) {
+        std::lock_guard<std::mutex> guard(occlusionOptionsLock);
+        occlusionOptions = options;
+    }
+
+    OcclusionOptions getOcclusionOptions() {
+        std::lock_guard<std::mutex> guard(occlusionOptionsLock);
+        return occlusionOptions;
+    }
+
+    // glTF 节点的局部变换（行向量，与 SceneManagement::Object::getTransformMatrix 一致）
+    static DirectX::XMMATRIX getNodeMatrix(const tinygltf::Node& node) {
+        if (!node.matrix.empty()) {
+            auto& m = node.matrix;
+            return DirectX::XMMATRIX{
+                (float)m[0x0], (float)m[0x1], (float)m[0x2], (float)m[0x3],
+                (float)m[0x4], (float)m[0x5], (float)m[0x6], (float)m[0x7],
+                (float)m[0x8], (float)m[0x9], (float)m[0xA], (float)m[0xB],
+                (float)m[0xC], (float)m[0xD], (float)m[0xE], (float)m[0xF]
+            };
+        }
+        auto S = node.scale.empty() ? DirectX::XMMatrixIdentity() :
+            DirectX::XMMatrixScaling((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]);
+        auto R = node.rotation.empty() ? DirectX::XMMatrixIdentity() :
+            DirectX::XMMatrixRotationQuaternion(DirectX::XMVECTOR{
+                (float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3] });
+        auto T = node.translation.empty() ? DirectX::XMMatrixIdentity() :
+            DirectX::XMMatrixTranslation((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]);
+        return DirectX::XMMatrixMultiply(DirectX::XMMatrixMultiply(S, R), T);
+    }
+
+    static void serializeImpostorAtlas(const std::shared_ptr<const SceneManagement::ImpostorAtlas>& atlas, std::vector<uint8_t>& data) {
+        DerivedDataWriter writer(data);
+        writer.write(atlas->framesPerSide);
+        writer.write(atlas->frameSize);
+        writer.write(atlas->center);
+        writer.write(atlas->radius);
+        for (auto texture : { &atlas->albedo, &atlas->normal, &atlas->emission }) {
+            writer.write<uint32_t>(texture->format);
+            writer.writeVector(texture->mips);
+            writer.writeVector(texture->pixels);
+        }
+    }
+
+    static std::shared_ptr<const SceneManagement::ImpostorAtlas> deserializeImpostorAtlas(const std::vector<uint8_t>& data) {
+        DerivedDataReader reader(data);
+        std::shared_ptr<SceneManagement::ImpostorAtlas> atlas(new SceneManagement::ImpostorAtlas());
+        atlas->framesPerSide = reader.read<uint32_t>();
+        atlas->frameSize = reader.read<uint32_t>();
+        atlas->center = reader.read<DirectX::XMFLOAT3>();
+        atlas->radius = reader.read<float>();
+        for (auto texture : { &atlas->albedo, &atlas->normal, &atlas->emission }) {
+            texture->format = (DXGI_FORMAT)reader.read<uint32_t>();
+            texture->mips = reader.readVector<Rendering::TextureData::MipLevel>();
+            texture->pixels = reader.readVector<uint8_t>();
+            for (auto& level : texture->mips) {
+                if (level.offset + level.slicePitch > texture->pixels.size()) {
+                    throw std::exception("corrupted derived data");
+                }
+            }
+        }
+        return atlas;
+    }
+
+    // 默认场景中所有 mesh 节点在静止姿态下的 primitive（显式实例化的节点每个实例一份），
+    // 材质只取基础色和自发光。块压缩过的纹理先解码
+    static std::shared_ptr<const SceneManagement::ImpostorAtlas> bakeModelImpostor(const DefaultModelDataGLTF& data) {
+        auto& model = data.model;
+
+        std::map<TextureKey, std::shared_ptr<const Rendering::TextureData>> decoded;
+        auto getTexture = [&](const tinygltf::TextureInfo& info, SceneManagement::DefaultShaderSlot slot) {
+            SceneManagement::ImpostorTexture texture;
+            if (info.index < 0) return texture;
+            TextureKey key{ model.textures[info.index].source, slot };
+            auto it = data.textures.find(key);
+            if (it == data.textures.end() || !it->second.data) return texture;
+
+            auto& cached = decoded[key];
+            if (!cached) {
+                auto& cooked = it->second.data;
+                cached = Rendering::isBlockCompressedFormat(cooked->format) ?
+                    std::shared_ptr<const Rendering::TextureData>(new Rendering::TextureData(Rendering::decompressTexture(*cooked))) :
+                    cooked;
+            }
+            texture.data = cached.get();
+            texture.texCoord = (uint32_t)info.texCoord;
+            return texture;
+        };
+
+        std::vector<SceneManagement::ImpostorSource> sources;
+        std::function<void(int, DirectX::XMMATRIX)> collect = [&](int nodeID, DirectX::XMMATRIX parent) {
+            auto& node = model.nodes[nodeID];
+            auto transform = DirectX::XMMatrixMultiply(getNodeMatrix(node), parent);
+            if (node.mesh >= 0) {
+                std::vector<DirectX::XMMATRIX> placements = { transform };
+                if (auto instances = loadInstanceTransforms(node, model); instances) {
+                    placements.clear();
+                    for (auto& instance : instances->transforms) {
+                        placements.push_back(DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&instance), transform));
+                    }
+                }
+
+                auto& range = data.meshRanges[node.mesh];
+                for (auto& primitive : data.meshIn[node.mesh]) {
+                    SceneManagement::ImpostorSource source;
+                    source.vertices = data.vboData.data() + range.vertexBegin + primitive.vertexBegin;
+                    source.vertexCount = primitive.vertexLength;
+                    source.indices = data.indices.data() + primitive.indexBegin;
+                    source.indexCount = primitive.indexLength;
+                    source.indexBase = primitive.vertexBegin;
+                    if (primitive.materialID < model.materials.size()) {
+                        auto& material = model.materials[primitive.materialID];
+                        auto& factor = material.pbrMetallicRoughness.baseColorFactor;
+                        source.baseColor = { (float)factor[0], (float)factor[1], (float)factor[2], (float)factor[3] };
+                        source.emissionColor = {
+                            (float)material.emissiveFactor[0], (float)material.emissiveFactor[1], (float)material.emissiveFactor[2] };
+                        source.baseColorTexture = getTexture(material.pbrMetallicRoughness.baseColorTexture,
+                            SceneManagement::DefaultShaderSlot::BASE_COLOR);
+                        source.emissionTexture = getTexture(material.emissiveTexture,
+                            SceneManagement::DefaultShaderSlot::EMISSION_COLOR);
+                    }
+                    for (auto& placement : placements) {
+                        DirectX::XMStoreFloat4x4(&source.transform, placement);
+                        sources.push_back(source);
+                    }
+                }
+            }
+            for (auto child : node.children) collect(child, transform);
+        };
+        for (auto nodeID : model.scenes[model.defaultScene].nodes) {
+            collect(nodeID, DirectX::XMMatrixIdentity());
+        }
+
+        SceneManagement::ImpostorBakeOptions options;
+        options.framesPerSide = data.impostorOptions.framesPerSide;
+        options.frameSize = data.impostorOptions.frameSize;
+        return std::shared_ptr<const SceneManagement::ImpostorAtlas>(
+            new SceneManagement::ImpostorAtlas(SceneManagement::bakeImpostor(sources, options)));
+    }
+
+    std::shared_ptr<DefaultModelDataGLTF> prepareDefaultResourceGLTF(
+        const std::string& pathStr,
+        JobPriority priority,
+        std::function<void(uint32_t, uint32_t)> progress
+    ) {
+        auto& jobs = JobSystem::getInstance();
 
         std::filesystem::path path(pathStr);
 
-        Model model;
+        std::shared_ptr<DefaultModelDataGLTF> out(new DefaultModelDataGLTF());
+        out->path = pathStr;
+        out->staticBatching = getStaticBatchingOptions();
+        out->impostorOptions = getImpostorOptions();
+        out->occlusionOptions = getOcclusionOptions();
+        auto& model = out->model;
+
         TinyGLTF loader;
+        loader.SetImageLoader(skipImageDecoding, nullptr);
         std::string err;
         std::string warn;
 
         bool load_succeeded = false;
 
+        auto fileContent = loadBinaryFromFile(stringToWstring(pathStr));
+        auto baseDir = path.parent_path().string();
+        out->sourceHash = hashCombine(hashBytes(fileContent.data(), fileContent.size()), GLTF_IMPORTER_VERSION);
+
         if (path.extension() == ".glb") {
-            load_succeeded =
-                loader.LoadBinaryFromFile(&model, &err, &warn, pathStr);
+            load_succeeded = loader.LoadBinaryFromMemory(&model, &err, &warn,
+                fileContent.data(), (unsigned int)fileContent.size(), baseDir);
         } else if (path.extension() == ".gltf") {
-            load_succeeded =
-                loader.LoadASCIIFromFile(&model, &err, &warn, pathStr);
+            load_succeeded = loader.LoadASCIIFromString(&model, &err, &warn,
+                reinterpret_cast<const char*>(fileContent.data()), (unsigned int)fileContent.size(), baseDir);
         } else {
             throw std::exception("the extension of glTF2 file(`%s`) should be .glb or .gltf");
         }
@@ -753,32 +1763,409 @@ namespace LiteEngine::IO {
             throw std::exception(err.c_str());
         }
 
-      
-        std::map<std::string, std::uint32_t> textureReg;
-        std::vector<SceneManagement::DefaultVertexData> vboData;
-        std::vector<std::vector<DefaultMeshGLTF>> meshIn;
-        std::vector<std::shared_ptr<SceneManagement::DefaultMaterial>> materials;
-        std::vector<uint32_t> indices;
-      
-        for (auto mesh: model.meshes) {
-            meshIn.push_back(loadDefaultMesh(mesh, model, vboData, indices));
+        auto textureKeys = CachedTextureLoader::collectReferences(model);
+
+        // 解析完成算一步，之后每个 mesh、每张被引用的纹理各算一步
+        uint32_t totalSteps = 1 + (uint32_t)model.meshes.size() + (uint32_t)textureKeys.size();
+        std::shared_ptr<std::atomic<uint32_t>> finishedSteps(new std::atomic<uint32_t>(1));
+        auto reportStep = [=]() {
+            auto finished = ++*finishedSteps;
+            if (progress) progress(finished, totalSteps);
+        };
+        if (progress) progress(1, totalSteps);
+
+        // 每个 mesh 先转换到独立的 buffer 中，全部完成后再拼接
+        std::vector<std::future<MeshConversion>> meshJobs;
+        // job 持有 out，保证某个 job 抛出异常、本函数提前返回之后 model 依然有效
+        for (size_t meshID = 0; meshID < model.meshes.size(); meshID++) {
+            meshJobs.push_back(jobs.submit([out, meshID, reportStep]() {
+                auto conversion = DerivedDataCache::getInstance().fetch<MeshConversion>(
+                    "gltf-mesh", hashCombine(out->sourceHash, meshID), [&]() {
+                    MeshConversion conversion;
+                    conversion.meshes = loadDefaultMesh(out->model.meshes[meshID], out->model,
+                        conversion.vb, conversion.indices);
+                    loadMeshDeformation(out->model.meshes[meshID], out->model, conversion);
+                    generateMeshLods(conversion);
+                    return conversion;
+                }, serializeMeshConversion, deserializeMeshConversion);
+                reportStep();
+                return conversion;
+            }, priority));
         }
 
-        std::vector<
-            std::vector<
-                std::tuple<std::shared_ptr<Rendering::Mesh>, uint32_t, std::string>
-            >
-        > meshes;
+        std::vector<std::future<CookedTexture>> textureJobs;
+        for (auto key : textureKeys) {
+            textureJobs.push_back(jobs.submit([out, key, reportStep]() {
+                auto cooked = CachedTextureLoader::cookTexture(out->path, out->model, key);
+                reportStep();
+                return cooked;
+            }, priority));
+        }
+
+        // 关键帧数据通常很小，在当前线程转换
+        for (size_t animationID = 0; animationID < model.animations.size(); animationID++) {
+            out->animations.push_back(loadAnimationClip(model.animations[animationID], model, animationID));
+        }
+
+        for (auto& job : meshJobs) {
+            jobs.wait(job);
+            auto conversion = job.get();
+
+            DefaultModelDataGLTF::MeshRange range;
+            range.vertexBegin = (uint32_t)out->vboData.size();
+            range.vertexCount = (uint32_t)conversion.vb.size();
+            range.indexBegin = (uint32_t)out->indices.size();
+            range.indexCount = (uint32_t)conversion.indices.size();
+
+            // 变形之后静止姿态的代理没有意义
+            bool deformed = !conversion.weights.empty() || !conversion.morphTargets.empty();
+            std::vector<std::shared_ptr<const Rendering::OccluderMesh>> occluders(conversion.meshes.size());
+            if (out->occlusionOptions.generateOccluders && !deformed) {
+                for (size_t i = 0; i < conversion.meshes.size(); i++) {
+                    occluders[i] = createOccluderMesh(conversion, conversion.meshes[i], out->occlusionOptions.maxOccluderTriangles);
+                }
+            }
+            out->occluders.push_back(std::move(occluders));
+
+            // 每个 mesh 在 GeometryPool 中单独分配，索引保持相对于 mesh 自己的顶点
+            out->vboData.insert(out->vboData.end(), conversion.vb.begin(), conversion.vb.end());
+            out->indices.insert(out->indices.end(), conversion.indices.begin(), conversion.indices.end());
+            for (auto& mesh : conversion.meshes) {
+                mesh.indexBegin += range.indexBegin;
+                for (auto& lod : mesh.lods) lod.indexBegin += range.indexBegin;
+            }
+            std::shared_ptr<SceneManagement::DeformableMeshData> deformable;
+            if (deformed) {
+                deformable.reset(new SceneManagement::DeformableMeshData());
+                deformable->name = model.meshes[out->meshIn.size()].name;
+                deformable->vertices = std::move(conversion.vb);
+                deformable->weights = std::move(conversion.weights);
+                deformable->morphTargets = std::move(conversion.morphTargets);
+                deformable->defaultMorphWeights = std::move(conversion.morphWeights);
+            }
+            out->deformableMeshes.push_back(deformable);
+            out->meshIn.push_back(std::move(conversion.meshes));
+            out->meshRanges.push_back(range);
+        }
+
+        for (size_t i = 0; i < textureJobs.size(); i++) {
+            jobs.wait(textureJobs[i]);
+            out->textures[textureKeys[i]] = textureJobs[i].get();
+        }
+
+        // 烘焙结果只取决于源文件、纹理和图集的大小
+        if (out->impostorOptions.enabled) {
+            auto key = out->sourceHash;
+            for (auto& [textureKey, texture] : out->textures) {
+                key = hashCombine(key, texture.contentHash);
+            }
+            key = hashCombine(key, hashCombine(out->impostorOptions.framesPerSide, out->impostorOptions.frameSize));
+            try {
+                out->impostor = DerivedDataCache::getInstance().fetch<std::shared_ptr<const SceneManagement::ImpostorAtlas>>(
+                    "gltf-impostor", key, [&]() { return bakeModelImpostor(*out); },
+                    serializeImpostorAtlas, deserializeImpostorAtlas);
+            } catch (const std::exception& e) {
+                log(LogLevel::WARNING, pathStr + ": impostor is not baked: " + e.what() + "\n");
+            }
+        }
+
+        return out;
+    }
+
+    // 静态合批的设置和统计，可以在任意线程访问
+    static std::mutex staticBatchingLock;
+    static StaticBatchingOptions staticBatchingOptions;
+    static std::vector<StaticBatchingStatistics> staticBatchingStatistics;
+
+    void setStaticBatchingOptions(const StaticBatchingOptions& options) {
+        std::lock_guard<std::mutex> guard(staticBatchingLock);
+        staticBatchingOptions = options;
+    }
+
+    StaticBatchingOptions getStaticBatchingOptions() {
+        std::lock_guard<std::mutex> guard(staticBatchingLock);
+        return staticBatchingOptions;
+    }
+
+    std::vector<StaticBatchingStatistics> getStaticBatchingStatistics() {
+        std::lock_guard<std::mutex> guard(staticBatchingLock);
+        return staticBatchingStatistics;
+    }
+
+    void clearStaticBatchingStatistics() {
+        std::lock_guard<std::mutex> guard(staticBatchingLock);
+        staticBatchingStatistics.clear();
+    }
+
+    std::string getStaticBatchingReport() {
+        auto statistics = getStaticBatchingStatistics();
+        std::ostringstream out;
+        char line[512];
+        snprintf(line, sizeof(line), "%-32s %8s %8s %8s %8s %8s %10s %10s\n",
+            "model", "subtrees", "skipped", "merged", "batches", "draws", "vertices", "KiB");
+        out << line;
+        StaticBatchingStatistics total;
+        for (auto& stat : statistics) {
+            snprintf(line, sizeof(line), "%-32s %8u %8u %8u %8u %3u -> %-3u %10llu %10.1f\n",
+                stat.modelPath.c_str(), stat.subtrees, stat.skippedSubtrees, stat.batchedPrimitives, stat.batches,
+                stat.drawsBefore, stat.drawsAfter, (unsigned long long)stat.vertices, stat.memoryBytes / 1024.0);
+            out << line;
+            total.drawsBefore += stat.drawsBefore;
+            total.drawsAfter += stat.drawsAfter;
+            total.memoryBytes += stat.memoryBytes;
+        }
+        snprintf(line, sizeof(line), "draw calls with one instance of each model: %u -> %u (%.1f%% fewer), batches use %.1f KiB\n",
+            total.drawsBefore, total.drawsAfter,
+            total.drawsBefore ? 100.0 * (total.drawsBefore - total.drawsAfter) / total.drawsBefore : 0.0,
+            total.memoryBytes / 1024.0);
+        out << line;
+        return out.str();
+    }
+
+    static bool isMarkedStatic(const tinygltf::Node& node) {
+        if (!node.extras.Has("static")) return false;
+        auto& value = node.extras.Get("static");
+        return value.IsBool() && value.Get<bool>();
+    }
+
+    using PooledMeshFactory = std::function<std::shared_ptr<Rendering::Mesh>(
+        const Rendering::PtrGeometryAllocation&, const Rendering::PtrGeometryAllocation&, uint32_t)>;
+
+    // 合并 prototype 中的静态子树，合批作为一个 MeshAsset 加入 out->meshes，不再被引用的原 mesh 从中移除
+    // 必须在所有路径（动画目标、骨骼、可变形节点）计算完之后调用：删除 primitive 会改变子树内节点的 children 下标，
+    // 所以子树内有被路径引用的节点时不合并；合批节点追加在子树根节点的最后，不影响其他节点的下标
+    static void batchStaticSubtrees(
+        const DefaultModelDataGLTF& data,
+        ModelAsset& out,
+        SceneManagement::Object& rootObject,
+        const std::vector<SceneManagement::Object*>& nodeObjects,
+        const PooledMeshFactory& createMesh
+    ) {
+        auto& renderer = Rendering::Renderer::getInstance();
+        auto& geometryPool = renderer.getGeometryPool();
+        auto& model = data.model;
+        auto& scene = model.scenes[model.defaultScene];
+
+        StaticBatchingStatistics statistics;
+        statistics.modelPath = data.path;
+
+        std::vector<bool> referenced(model.nodes.size(), false);
+        for (auto& animation : data.animations) {
+            for (auto node : animation.targetNodes) referenced[node] = true;
+        }
+        for (auto& skin : model.skins) {
+            for (auto joint : skin.joints) referenced[joint] = true;
+        }
+        for (size_t nodeID = 0; nodeID < model.nodes.size(); nodeID++) {
+            auto mesh = model.nodes[nodeID].mesh;
+            if (mesh >= 0 && data.deformableMeshes[mesh]) referenced[nodeID] = true;
+        }
+
+        // 静态子树：根节点（合批空间）和其中所有的 glTF 节点。wholeModel 时根节点是 rootObject，不对应 glTF 节点
+        struct Subtree {
+            SceneManagement::Object* space;
+            int rootNode;                   // -1 表示 rootObject
+            std::vector<int> nodes;
+        };
+        std::vector<Subtree> subtrees;
+        std::function<void(int, std::vector<int>&)> collect = [&](int nodeID, std::vector<int>& nodes) {
+            nodes.push_back(nodeID);
+            for (auto child : model.nodes[nodeID].children) collect(child, nodes);
+        };
+        std::function<void(int)> findMarked = [&](int nodeID) {
+            if (isMarkedStatic(model.nodes[nodeID]) && nodeObjects[nodeID]) {
+                subtrees.push_back({ nodeObjects[nodeID], nodeID, {} });
+                collect(nodeID, subtrees.back().nodes);
+                return;
+            }
+            for (auto child : model.nodes[nodeID].children) findMarked(child);
+        };
+        if (data.staticBatching.wholeModel) {
+            subtrees.push_back({ &rootObject, -1, {} });
+            for (auto nodeID : scene.nodes) collect(nodeID, subtrees.back().nodes);
+        } else {
+            for (auto nodeID : scene.nodes) findMarked(nodeID);
+        }
+
+        // 每个参与合批的 primitive 对应的 Mesh 节点
+        std::vector<SceneManagement::StaticBatchSource> sources;
+        std::vector<const SceneManagement::Mesh*> sourceNodes;
+        std::vector<std::pair<SceneManagement::Object*, size_t>> removals;     // 节点，要删除的前几个 children
+        std::vector<std::pair<SceneManagement::Object*, size_t>> subtreeBatches;    // 合批空间，合批的起点
+
+        for (auto& subtree : subtrees) {
+            bool skip = std::any_of(subtree.nodes.begin(), subtree.nodes.end(),
+                [&](int nodeID) { return nodeID != subtree.rootNode && referenced[nodeID]; });
+            if (skip) {
+                log(LogLevel::WARNING, data.path + ": static subtree " +
+                    (subtree.rootNode < 0 ? std::string("(whole model)") : model.nodes[subtree.rootNode].name) +
+                    " contains animated, joint or deformable nodes and is not batched\n");
+                statistics.skippedSubtrees++;
+                continue;
+            }
+
+            auto sourceBegin = sources.size();
+            for (auto nodeID : subtree.nodes) {
+                auto meshID = model.nodes[nodeID].mesh;
+                auto object = nodeObjects[nodeID];
+                // 实例化的节点已经只有一次 draw call，合并反而要复制所有实例的顶点
+                if (meshID < 0 || referenced[nodeID] || object == nullptr || hasGpuInstancing(model.nodes[nodeID])) continue;
+
+                // buildObjectHierarchy 把各个 primitive 放在最前面的 children 中
+                auto& primitives = data.meshIn[meshID];
+                if (object->children.size() < primitives.size()) continue;
+                bool allMeshes = true;
+                for (size_t i = 0; i < primitives.size(); i++) {
+                    allMeshes = allMeshes && dynamic_cast<const SceneManagement::Mesh*>(object->children[i].get());
+                }
+                if (!allMeshes) continue;
+
+                // primitive 节点本身没有变换，子树空间中的变换就是所在 glTF 节点的
+                auto transform = DirectX::XMMatrixIdentity();
+                for (const SceneManagement::Object* node = object; node && node != subtree.space; node = node->getParent()) {
+                    transform = DirectX::XMMatrixMultiply(transform, node->getTransformMatrix());
+                }
 
-        CachedTextureLoader textureLoader;
+                auto& range = data.meshRanges[meshID];
+                for (size_t i = 0; i < primitives.size(); i++) {
+                    auto& primitive = primitives[i];
+                    SceneManagement::StaticBatchSource source;
+                    source.vertices = data.vboData.data() + range.vertexBegin + primitive.vertexBegin;
+                    source.vertexCount = primitive.vertexLength;
+                    source.indices = data.indices.data() + primitive.indexBegin;
+                    source.indexCount = primitive.indexLength;
+                    source.indexBase = primitive.vertexBegin;
+                    DirectX::XMStoreFloat4x4(&source.transform, transform);
+                    source.materialID = primitive.materialID;
+                    sources.push_back(source);
+                    sourceNodes.push_back(static_cast<const SceneManagement::Mesh*>(object->children[i].get()));
+                }
+                removals.push_back({ object, primitives.size() });
+            }
+            if (sources.size() > sourceBegin) {
+                subtreeBatches.push_back({ subtree.space, sourceBegin });
+                statistics.subtrees++;
+            }
+        }
 
-        for (auto& material: model.materials) {
-            materials.push_back(loadDefaultMaterial(material, model, textureReg, textureLoader));
+        for (auto& node : nodeObjects) {
+            if (node) statistics.drawsBefore += (uint32_t)std::count_if(node->children.begin(), node->children.end(),
+                [](const std::shared_ptr<SceneManagement::Object>& child) { return dynamic_cast<const SceneManagement::Mesh*>(child.get()); });
         }
+        statistics.drawsAfter = statistics.drawsBefore;
+
+        if (!sources.empty()) {
+            // 每个子树单独合批，合批不跨越子树
+            std::vector<SceneManagement::StaticBatch> batches;
+            std::vector<SceneManagement::Object*> batchSpaces;
+            for (size_t i = 0; i < subtreeBatches.size(); i++) {
+                auto begin = subtreeBatches[i].second;
+                auto end = i + 1 < subtreeBatches.size() ? subtreeBatches[i + 1].second : sources.size();
+                std::vector<SceneManagement::StaticBatchSource> subtreeSources(sources.begin() + begin, sources.begin() + end);
+                for (auto& batch : SceneManagement::buildStaticBatches(subtreeSources, data.staticBatching.maxVerticesPerBatch)) {
+                    for (auto& source : batch.sources) source += (uint32_t)begin;
+                    batches.push_back(std::move(batch));
+                    batchSpaces.push_back(subtreeBatches[i].first);
+                }
+            }
+
+            auto batchAsset = AssetRegistry::getInstance().acquire<MeshAsset>(
+                hashCombine(data.getAssetKey(), hashBytes("static-batch", 12)), [&]() {
+                std::shared_ptr<MeshAsset> asset(new MeshAsset());
+                asset->name = data.path + "#static-batch";
+                for (size_t i = 0; i < batches.size(); i++) {
+                    auto& batch = batches[i];
+                    auto vertices = geometryPool.allocateVertices(batch.vertices.data(),
+                        (uint32_t)batch.vertices.size(), (uint32_t)sizeof(SceneManagement::DefaultVertexData));
+                    auto indices = geometryPool.allocateIndices(batch.indices.data(), (uint32_t)batch.indices.size());
+                    auto mesh = createMesh(vertices, indices, (uint32_t)batch.indices.size());
+                    mesh->bounds = batch.bounds;
+                    asset->primitives.push_back({ mesh, batch.materialID, "static-batch" + std::to_string(i) });
+                    asset->memoryBytes += batch.vertices.size() * sizeof(SceneManagement::DefaultVertexData) +
+                        batch.indices.size() * sizeof(uint32_t);
+                }
+                return asset;
+            });
+
+            std::map<SceneManagement::Object*, std::shared_ptr<SceneManagement::Object>> groups;
+            for (size_t i = 0; i < batches.size(); i++) {
+                auto space = batchSpaces[i];
+                auto& group = groups[space];
+                if (!group) {
+                    group.reset(new SceneManagement::Object("__#STATIC_BATCH"));
+                    group->parent = space;
+                }
 
-        auto ido = renderer.createIndexBufferObject(indices);
+                // 同一材质的源节点共享同一个材质对象
+                auto source = sourceNodes[batches[i].sources.front()];
+                auto batchNode = new SceneManagement::Mesh();
+                batchNode->name = batchAsset->primitives[i].name;
+                batchNode->parent = group;
+                batchNode->material = source->material;
+                batchNode->data = renderer.createMeshObject(
+                    batchAsset->primitives[i].mesh,
+                    std::shared_ptr<Rendering::Material>(new SceneManagement::DefaultMaterial()),
+                    nullptr
+                );
+                group->children.push_back(std::shared_ptr<SceneManagement::Object>(batchNode));
 
-        auto vbo = renderer.createVertexBufferObject(vboData, SceneManagement::DefaultVertexData::getDescription());
+                statistics.vertices += batches[i].vertices.size();
+            }
+            for (auto& [space, group] : groups) {
+                space->children.push_back(group);
+            }
+            for (auto& [node, count] : removals) {
+                node->children.erase(node->children.begin(), node->children.begin() + count);
+            }
+
+            statistics.batchedPrimitives = (uint32_t)sources.size();
+            statistics.batches = (uint32_t)batches.size();
+            statistics.drawsAfter = statistics.drawsBefore - statistics.batchedPrimitives + statistics.batches;
+            statistics.memoryBytes = batchAsset->memoryBytes;
+
+            // 只保留仍然有节点使用的原 mesh，完全被合并的 mesh 在没有其他模型引用时释放
+            std::set<const SceneManagement::Object*> removed;
+            for (auto& [node, count] : removals) removed.insert(node);
+            std::set<int> usedMeshes;
+            for (size_t nodeID = 0; nodeID < model.nodes.size(); nodeID++) {
+                if (nodeObjects[nodeID] && model.nodes[nodeID].mesh >= 0 && !removed.count(nodeObjects[nodeID])) {
+                    usedMeshes.insert(model.nodes[nodeID].mesh);
+                }
+            }
+            std::vector<std::shared_ptr<const MeshAsset>> meshes;
+            for (size_t meshID = 0; meshID < out.meshes.size(); meshID++) {
+                if (usedMeshes.count((int)meshID)) meshes.push_back(out.meshes[meshID]);
+            }
+            meshes.push_back(batchAsset);
+            out.meshes = std::move(meshes);
+        }
+
+        std::lock_guard<std::mutex> guard(staticBatchingLock);
+        staticBatchingStatistics.push_back(statistics);
+    }
+
+    static std::shared_ptr<ModelAsset> createModelAsset(const DefaultModelDataGLTF& data) {
+        auto& renderer = Rendering::Renderer::getInstance();
+        auto& registry = AssetRegistry::getInstance();
+        auto& model = data.model;
+        auto modelKey = data.getAssetKey();
+
+        std::shared_ptr<ModelAsset> out(new ModelAsset());
+        out->path = data.path;
+        out->name = data.path;
+
+        CachedTextureLoader textureLoader(data.textures);
+
+        for (size_t materialID = 0; materialID < model.materials.size(); materialID++) {
+            out->materials.push_back(registry.acquire<MaterialAsset>(hashCombine(modelKey, materialID), [&]() {
+                auto& material = model.materials[materialID];
+                std::shared_ptr<MaterialAsset> asset(new MaterialAsset());
+                asset->name = data.path + "#" + (material.name.empty() ? "material" + std::to_string(materialID) : material.name);
+                asset->material = loadDefaultMaterial(material, model, textureLoader, asset->textures);
+                asset->memoryBytes = sizeof(SceneManagement::DefaultMaterialConstantData);
+                return asset;
+            }));
+        }
 
         static auto shader = Rendering::Renderer::getInstance().createVertexShader(
             loadBinaryFromFile(L"DefaultVS.cso")
@@ -790,35 +2177,201 @@ namespace LiteEngine::IO {
         );
         static auto depthMapInputLayout = renderer.createInputLayout(SceneManagement::DefaultVertexData::getDescription(), depthMapShader);
 
-        
-        
-        for (auto meshGroup : meshIn) {
+        // 实例化绘制用的 vertex shader，第二个输入槽是每个实例的变换
+        static auto instanceDescription = Rendering::appendInstanceElements(*SceneManagement::DefaultVertexData::getDescription());
+        static auto instancedShader = renderer.createVertexShader(loadBinaryFromFile(L"DefaultVSInstanced.cso"));
+        static auto instancedInputLayout = renderer.createInputLayout(instanceDescription, instancedShader);
+        static auto instancedDepthMapShader = renderer.createVertexShader(loadBinaryFromFile(L"DefaultVSDepthMapInstanced.cso"));
+        static auto instancedDepthMapInputLayout = renderer.createInputLayout(instanceDescription, instancedDepthMapShader);
+        // 单 pass 级联阴影：每个实例带有要画到的 slice
+        static auto cascadeInstanceDescription = Rendering::appendCascadeInstanceElements(*SceneManagement::DefaultVertexData::getDescription());
+        static auto cascadedDepthMapShader = renderer.createVertexShader(loadBinaryFromFile(L"DefaultVSCascadedDepthMap.cso"));
+        static auto cascadedDepthMapInputLayout = renderer.createInputLayout(cascadeInstanceDescription, cascadedDepthMapShader);
+        auto createMesh = [&](const Rendering::PtrGeometryAllocation& vertices, const Rendering::PtrGeometryAllocation& indices,
+            uint32_t offset, uint32_t length) {
+            auto mesh = renderer.createMesh(vertices, indices, offset, length,
+                shader, inputLayout, depthMapShader, depthMapInputLayout);
+            mesh->setInstancedShader(Rendering::ShaderSemantics::DEFAULT, instancedShader, instancedInputLayout);
+            mesh->setInstancedShader(Rendering::ShaderSemantics::DEPTH_MAP, instancedDepthMapShader, instancedDepthMapInputLayout);
+            mesh->setInstancedShader(Rendering::ShaderSemantics::CASCADED_DEPTH_MAP, cascadedDepthMapShader, cascadedDepthMapInputLayout);
+            return mesh;
+        };
+
+        auto& geometryPool = renderer.getGeometryPool();
+
+        for (size_t meshID = 0; meshID < data.meshIn.size(); meshID++) {
+            out->meshes.push_back(registry.acquire<MeshAsset>(data.getMeshAssetKey(meshID), [&]() {
+                auto& range = data.meshRanges[meshID];
+                auto vertices = geometryPool.allocateVertices(data.vboData.data() + range.vertexBegin,
+                    range.vertexCount, (uint32_t)sizeof(SceneManagement::DefaultVertexData));
+                auto indices = geometryPool.allocateIndices(data.indices.data() + range.indexBegin, range.indexCount);
+
+                auto& meshName = model.meshes[meshID].name;
+                std::shared_ptr<MeshAsset> asset(new MeshAsset());
+                asset->name = data.path + "#" + (meshName.empty() ? "mesh" + std::to_string(meshID) : meshName);
+                asset->memoryBytes = range.vertexCount * sizeof(SceneManagement::DefaultVertexData) +
+                    range.indexCount * sizeof(uint32_t);
+                for (size_t primitiveID = 0; primitiveID < data.meshIn[meshID].size(); primitiveID++) {
+                    auto& mesh = data.meshIn[meshID][primitiveID];
+                    auto primitive = createMesh(vertices, indices, mesh.indexBegin - range.indexBegin, mesh.indexLength);
+                    primitive->occluder = data.occluders[meshID][primitiveID];
+                    if (mesh.vertexLength > 0) {
+                        DirectX::BoundingBox::CreateFromPoints(primitive->bounds, mesh.vertexLength,
+                            &data.vboData[range.vertexBegin + mesh.vertexBegin].position, sizeof(SceneManagement::DefaultVertexData));
+                    }
+                    for (auto& lod : mesh.lods) {
+                        primitive->lods.push_back({ lod.indexBegin - range.indexBegin, lod.indexLength, lod.error });
+                    }
+                    asset->primitives.push_back({ primitive, mesh.materialID, mesh.name });
+                }
+                return asset;
+            }));
+        }
+
+        std::vector<
+            std::vector<
+                std::tuple<std::shared_ptr<Rendering::Mesh>, uint32_t, std::string>
+            >
+        > meshes;
+        for (auto& mesh : out->meshes) {
             meshes.push_back({});
-            for (auto mesh : meshGroup) {
-                meshes.rbegin()->push_back({ 
-                    renderer.createMesh(vbo, ido, mesh.indexBegin, mesh.indexLength, 
-                        shader, inputLayout, depthMapShader, depthMapInputLayout), 
-                    mesh.materialID, 
-                    mesh.name
-                });
+            for (auto& primitive : mesh->primitives) {
+                meshes.rbegin()->push_back({ primitive.mesh, primitive.materialID, primitive.name });
             }
         }
 
-        //textures.resize(texturereg.size());
-        //for (auto [k, v] : texturereg) {
-        //    out.textures[v].path = k;
-        //}
-        
+        std::vector<std::shared_ptr<SceneManagement::DefaultMaterial>> materials;
+        for (auto& material : out->materials) {
+            materials.push_back(material->material);
+        }
+
+        std::vector<SceneManagement::Object*> nodeObjects(model.nodes.size(), nullptr);
         std::shared_ptr<SceneManagement::Object> rootObject(new SceneManagement::Object());
         rootObject->name = "__#ROOT_OBJECT";
         for (auto nodeID : model.scenes[model.defaultScene].nodes) {
             rootObject->children.push_back(
                 buildObjectHierarchy(model.nodes[nodeID],
-                    model, rootObject, meshes, materials)
+                    model, rootObject, meshes, materials, nodeObjects)
             );
         }
+        out->prototype = rootObject;
+
+        // 动画目标在 prototype 中的路径（逐层的 children 下标），实例与 prototype 的层级相同
+        auto getNodePath = [&](int nodeID) {
+            std::vector<uint32_t> path;
+            auto node = nodeObjects[nodeID];
+            while (node && node != rootObject.get()) {
+                auto parent = node->getParent();
+                auto it = std::find_if(parent->children.begin(), parent->children.end(),
+                    [&](const std::shared_ptr<SceneManagement::Object>& child) { return child.get() == node; });
+                path.push_back((uint32_t)(it - parent->children.begin()));
+                node = parent;
+            }
+            // 不在默认场景中的节点：给一个不存在的路径，绑定时会报告找不到
+            if (node == nullptr) return std::vector<uint32_t>{ UINT32_MAX };
+            std::reverse(path.begin(), path.end());
+            return path;
+        };
+        for (auto& prepared : data.animations) {
+            std::shared_ptr<SceneManagement::AnimationClip> clip(new SceneManagement::AnimationClip(*prepared.clip));
+            for (size_t i = 0; i < prepared.targetNodes.size(); i++) {
+                clip->targets[i] = getNodePath(prepared.targetNodes[i]);
+            }
+            out->memoryBytes += clip->getMemoryBytes();
+            out->animations.push_back(clip);
+        }
 
-        return rootObject;
+        std::vector<std::shared_ptr<SceneManagement::Skin>> skins;
+        for (size_t skinID = 0; skinID < model.skins.size(); skinID++) {
+            auto& inSkin = model.skins[skinID];
+            std::shared_ptr<SceneManagement::Skin> skin(new SceneManagement::Skin());
+            skin->name = inSkin.name.empty() ? "skin" + std::to_string(skinID) : inSkin.name;
+
+            std::vector<float> inverseBindMatrices;
+            if (inSkin.inverseBindMatrices >= 0) {
+                inverseBindMatrices = loadAccessorAsFloat(model, inSkin.inverseBindMatrices, 16);
+                if (inverseBindMatrices.size() != inSkin.joints.size() * 16) {
+                    throw std::exception("inverseBindMatrices do not match joints. the gltf file is corrupted!");
+                }
+            }
+            for (size_t i = 0; i < inSkin.joints.size(); i++) {
+                skin->joints.push_back(getNodePath(inSkin.joints[i]));
+                skin->jointNames.push_back(model.nodes[inSkin.joints[i]].name);
+                // 与节点的 matrix 一样，列主序的存储刚好就是 XM 的行向量矩阵
+                DirectX::XMFLOAT4X4 matrix;
+                if (inverseBindMatrices.empty()) DirectX::XMStoreFloat4x4(&matrix, DirectX::XMMatrixIdentity());
+                else memcpy(&matrix, &inverseBindMatrices[i * 16], sizeof(matrix));
+                skin->inverseBindMatrices.push_back(matrix);
+            }
+            out->memoryBytes += skin->getMemoryBytes();
+            skins.push_back(skin);
+        }
+
+        // 有蒙皮或 morph target 的 mesh 节点，实例调用 createSkinnedMeshes 之后逐实例变形
+        std::set<size_t> countedMeshes;
+        for (size_t nodeID = 0; nodeID < model.nodes.size(); nodeID++) {
+            auto& node = model.nodes[nodeID];
+            if (node.mesh < 0 || !data.deformableMeshes[node.mesh] || nodeObjects[nodeID] == nullptr) continue;
+
+            ModelAsset::DeformableNode deformable;
+            deformable.node = getNodePath((int)nodeID);
+            deformable.data = data.deformableMeshes[node.mesh];
+            if (node.skin >= 0 && !deformable.data->weights.empty()) {
+                deformable.skin = skins[node.skin];
+                for (auto& weights : deformable.data->weights) {
+                    for (auto joint : weights.joints) {
+                        if (joint >= deformable.skin->joints.size()) {
+                            throw std::exception("joint index is out of range. the gltf file is corrupted!");
+                        }
+                    }
+                }
+            }
+            if (countedMeshes.insert(node.mesh).second) {
+                out->memoryBytes += deformable.data->getMemoryBytes();
+            }
+            out->deformableNodes.push_back(deformable);
+        }
+
+        if (data.impostor) {
+            auto& atlas = *data.impostor;
+            std::shared_ptr<ModelAsset::ImpostorData> impostor(new ModelAsset::ImpostorData());
+            impostor->albedo = renderer.createTexture2D(atlas.albedo);
+            impostor->normal = renderer.createTexture2D(atlas.normal);
+            impostor->emission = renderer.createTexture2D(atlas.emission);
+            impostor->framesPerSide = atlas.framesPerSide;
+            DirectX::XMStoreFloat4x4(&impostor->trans_I2L, atlas.getImpostorToModelMatrix());
+            out->impostor = impostor;
+            out->memoryBytes += atlas.getMemoryBytes();
+        }
+
+        if (data.staticBatching.enabled) {
+            batchStaticSubtrees(data, *out, *rootObject, nodeObjects,
+                [&](const Rendering::PtrGeometryAllocation& vertices, const Rendering::PtrGeometryAllocation& indices, uint32_t length) {
+                    return createMesh(vertices, indices, 0, length);
+                });
+        }
+
+        return out;
+    }
+
+    std::shared_ptr<const ModelAsset> createModelAssetGLTF(const DefaultModelDataGLTF& data) {
+        auto& registry = AssetRegistry::getInstance();
+        auto asset = registry.acquire<ModelAsset>(data.getAssetKey(), [&]() {
+            return createModelAsset(data);
+        });
+        registry.registerPath(data.path, asset);
+        return asset;
+    }
+
+    std::shared_ptr<SceneManagement::Object> createDefaultResourceGLTF(const DefaultModelDataGLTF& data) {
+        return AssetRegistry::instantiate(createModelAssetGLTF(data));
     }
-}
 
+    std::shared_ptr<SceneManagement::Object> loadDefaultResourceGLTF(const std::string& pathStr) {
+        if (auto loaded = AssetRegistry::getInstance().findModel(pathStr)) {
+            return AssetRegistry::instantiate(loaded);
+        }
+        auto data = prepareDefaultResourceGLTF(pathStr);
+        return createDefaultResourceGLTF(*data);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "DerivedDataCache.h"
+#include "../Utilities/Utilities.h"
+#include "../Utilities/Hash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <cstdio>
+
+namespace LiteEngine::IO {
+
+	namespace {
+
+		constexpr uint32_t ENTRY_MAGIC = 0x4344454C;		// "LEDC"
+		constexpr uint32_t ENTRY_FORMAT_VERSION = 1;
+		constexpr const char* ENTRY_EXTENSION = ".ddc";
+
+#pragma pack(push, 1)
+		struct EntryHeader {
+			uint32_t magic;
+			uint32_t formatVersion;
+			uint64_t key;
+			double producingMilliseconds;
+			uint64_t payloadSize;
+			uint64_t payloadHash;
+		};
+#pragma pack(pop)
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+	}
+
+	DerivedDataCache& DerivedDataCache::getInstance() {
+		static DerivedDataCache cache;
+		return cache;
+	}
+
+	std::filesystem::path DerivedDataCache::getEntryPath(const std::string& stage, uint64_t key) const {
+		return std::filesystem::path(stage) / (hashToString(key) + ENTRY_EXTENSION);
+	}
+
+	void DerivedDataCache::configure(const std::filesystem::path& newDirectory, uint64_t capacityBytes) {
+		std::lock_guard<std::mutex> guard(lock);
+		directory = newDirectory;
+		capacity = capacityBytes;
+		indexed = false;
+		entries.clear();
+		totalSize = 0;
+	}
+
+	void DerivedDataCache::setEnabled(bool value) {
+		std::lock_guard<std::mutex> guard(lock);
+		enabled = value;
+	}
+
+	bool DerivedDataCache::isEnabled() {
+		std::lock_guard<std::mutex> guard(lock);
+		return enabled;
+	}
+
+	void DerivedDataCache::buildIndex() {
+		if (indexed) return;
+		indexed = true;
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+			!error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+			if (!it->is_regular_file(error)) continue;
+			auto& path = it->path();
+			if (path.extension() != ENTRY_EXTENSION) {
+				// 写入过程中崩溃留下的临时文件
+				if (path.extension() == ".tmp") std::filesystem::remove(path, error);
+				continue;
+			}
+			Entry entry;
+			entry.size = it->file_size(error);
+			entry.lastAccess = it->last_write_time(error);
+			entries[std::filesystem::relative(path, directory, error)] = entry;
+			totalSize += entry.size;
+		}
+
+		evict();
+	}
+
+	void DerivedDataCache::evict() {
+		if (totalSize <= capacity) return;
+
+		std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> order;
+		order.reserve(entries.size());
+		for (auto& [path, entry] : entries) {
+			order.push_back({ entry.lastAccess, path });
+		}
+		std::sort(order.begin(), order.end());
+
+		for (auto& [time, path] : order) {
+			if (totalSize <= capacity) break;
+			std::error_code error;
+			std::filesystem::remove(directory / path, error);
+			totalSize -= entries[path].size;
+			entries.erase(path);
+		}
+	}
+
+	bool DerivedDataCache::load(const std::string& stage, uint64_t key, std::vector<uint8_t>& data) {
+		auto begin = std::chrono::steady_clock::now();
+		auto relative = getEntryPath(stage, key);
+		std::filesystem::path path;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			statistics[stage].stage = stage;
+			statistics[stage].lookups++;
+			if (!enabled) return false;
+			buildIndex();
+			if (!entries.count(relative)) return false;
+			path = directory / relative;
+		}
+
+		// complete: 读到了头部声明的全部内容。否则可能是文件刚被其他线程淘汰，只算未命中
+		bool complete = false;
+		bool valid = false;
+		EntryHeader header{};
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			uint64_t fileSize = file ? (uint64_t)file.tellg() : 0;
+			if (file && fileSize >= sizeof(header) && file.seekg(0) && file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+				if (header.magic != ENTRY_MAGIC || header.formatVersion != ENTRY_FORMAT_VERSION || header.key != key) {
+					complete = true;
+				} else if (header.payloadSize <= fileSize - sizeof(header)) {
+					data.resize((size_t)header.payloadSize);
+					complete = (bool)file.read(reinterpret_cast<char*>(data.data()), data.size());
+					valid = complete && hashBytes(data.data(), data.size()) == header.payloadHash;
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		std::error_code error;
+		if (!complete) {
+			// 文件已经不在时（被其他线程或进程删除）同步索引；未命中之后 store 会重新写入完整的文件
+			if (!std::filesystem::exists(path, error) && entries.count(relative)) {
+				totalSize -= entries[relative].size;
+				entries.erase(relative);
+			}
+			data.clear();
+			return false;
+		}
+		if (!valid) {
+			log(LogLevel::WARNING, "corrupted derived data entry removed: " + path.string() + "\n");
+			std::filesystem::remove(path, error);
+			if (entries.count(relative)) {
+				totalSize -= entries[relative].size;
+				entries.erase(relative);
+			}
+			data.clear();
+			return false;
+		}
+
+		// 用修改时间记录最近访问，下次启动时依然有效
+		auto now = std::filesystem::file_time_type::clock::now();
+		std::filesystem::last_write_time(path, now, error);
+		if (entries.count(relative)) entries[relative].lastAccess = now;
+
+		auto& stat = statistics[stage];
+		stat.hits++;
+		stat.bytesRead += data.size();
+		stat.millisecondsSaved += std::max(0.0, header.producingMilliseconds - millisecondsSince(begin));
+		return true;
+	}
+
+	void DerivedDataCache::discard(const std::string& stage, uint64_t key) {
+		auto relative = getEntryPath(stage, key);
+		std::lock_guard<std::mutex> guard(lock);
+		auto path = directory / relative;
+		log(LogLevel::WARNING, "undecodable derived data entry removed: " + path.string() + "\n");
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		if (entries.count(relative)) {
+			totalSize -= entries[relative].size;
+			entries.erase(relative);
+		}
+		auto& stat = statistics[stage];
+		if (stat.hits > 0) stat.hits--;
+	}
+
+	void DerivedDataCache::store(const std::string& stage, uint64_t key, const std::vector<uint8_t>& data, double producingMilliseconds) {
+		auto relative = getEntryPath(stage, key);
+		std::filesystem::path path;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			statistics[stage].stage = stage;
+			statistics[stage].millisecondsProducing += producingMilliseconds;
+			if (!enabled) return;
+			buildIndex();
+			path = directory / relative;
+		}
+
+		EntryHeader header;
+		header.magic = ENTRY_MAGIC;
+		header.formatVersion = ENTRY_FORMAT_VERSION;
+		header.key = key;
+		header.producingMilliseconds = producingMilliseconds;
+		header.payloadSize = data.size();
+		header.payloadHash = hashBytes(data.data(), data.size());
+
+		// 先写临时文件再重命名，其他线程 / 进程不会读到写了一半的文件
+		std::error_code error;
+		std::filesystem::create_directories(path.parent_path(), error);
+		auto temporary = path;
+		temporary += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(data.data()), data.size());
+			if (!file) {
+				file.close();
+				std::filesystem::remove(temporary, error);
+				log(LogLevel::WARNING, "failed to write derived data entry: " + path.string() + "\n");
+				return;
+			}
+		}
+		std::filesystem::rename(temporary, path, error);
+		if (error) {
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		uint64_t size = sizeof(header) + data.size();
+		if (entries.count(relative)) totalSize -= entries[relative].size;
+		entries[relative] = Entry{ size, std::filesystem::file_time_type::clock::now() };
+		totalSize += size;
+
+		auto& stat = statistics[stage];
+		stat.writes++;
+		stat.bytesWritten += size;
+
+		evict();
+	}
+
+	std::vector<DerivedDataCache::StageStatistics> DerivedDataCache::getStatistics() {
+		std::lock_guard<std::mutex> guard(lock);
+		std::vector<StageStatistics> out;
+		for (auto& [stage, stat] : statistics) {
+			out.push_back(stat);
+		}
+		return out;
+	}
+
+	void DerivedDataCache::clearStatistics() {
+		std::lock_guard<std::mutex> guard(lock);
+		statistics.clear();
+	}
+
+	std::string DerivedDataCache::getReport() {
+		std::ostringstream out;
+		char line[256];
+		double totalSaved = 0;
+		uint64_t cacheSize;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			cacheSize = totalSize;
+		}
+		snprintf(line, sizeof(line), "%-20s %8s %8s %8s %12s %12s %12s %12s\n",
+			"stage", "lookups", "hits", "hit rate", "read KiB", "written KiB", "saved ms", "produce ms");
+		out << line;
+		for (auto& stat : getStatistics()) {
+			snprintf(line, sizeof(line), "%-20s %8llu %8llu %7.1f%% %12.1f %12.1f %12.1f %12.1f\n",
+				stat.stage.c_str(), (unsigned long long)stat.lookups, (unsigned long long)stat.hits,
+				stat.getHitRate() * 100, stat.bytesRead / 1024.0, stat.bytesWritten / 1024.0,
+				stat.millisecondsSaved, stat.millisecondsProducing);
+			out << line;
+			totalSaved += stat.millisecondsSaved;
+		}
+		snprintf(line, sizeof(line), "total saved: %.1f ms, cache size: %.1f MiB\n",
+			totalSaved, cacheSize / (1024.0 * 1024.0));
+		out << line;
+		return out.str();
+	}
+
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <type_traits>
+
+namespace LiteEngine::IO {
+
+	// 导入 / 烘焙结果的磁盘缓存，按内容寻址
+	// key 由调用方计算：源数据的哈希 + 导入器版本 + 设置。key 相同即认为结果相同，不检查时间戳
+	// 每个 stage 是一个子目录，单独统计命中率。总大小超过上限时按最近访问时间淘汰
+	// 线程安全，可以在 job 中调用
+	class DerivedDataCache {
+	public:
+		struct StageStatistics {
+			std::string stage;
+			uint64_t lookups = 0;
+			uint64_t hits = 0;
+			uint64_t writes = 0;
+			uint64_t bytesRead = 0;
+			uint64_t bytesWritten = 0;
+			double millisecondsSaved = 0;		// 命中时：生成该结果原本花费的时间 - 读取时间
+			double millisecondsProducing = 0;	// 未命中时实际生成结果花费的时间
+
+			double getHitRate() const {
+				return lookups == 0 ? 0 : (double)hits / lookups;
+			}
+		};
+
+	protected:
+		struct Entry {
+			uint64_t size;
+			std::filesystem::file_time_type lastAccess;
+		};
+
+		std::mutex lock;
+		std::filesystem::path directory = "DerivedDataCache";
+		uint64_t capacity = 2ull << 30;
+		bool enabled = true;
+
+		// 第一次访问时扫描目录
+		bool indexed = false;
+		std::map<std::filesystem::path, Entry> entries;		// 相对于 directory 的路径
+		uint64_t totalSize = 0;
+
+		std::map<std::string, StageStatistics> statistics;
+
+		DerivedDataCache() = default;
+
+		std::filesystem::path getEntryPath(const std::string& stage, uint64_t key) const;
+
+		// 以下需要持有 lock
+		void buildIndex();
+		void evict();
+
+	public:
+		DerivedDataCache(const DerivedDataCache&) = delete;
+		void operator=(const DerivedDataCache&) = delete;
+
+		static DerivedDataCache& getInstance();
+
+		// 应当在开始加载前调用
+		void configure(const std::filesystem::path& directory, uint64_t capacityBytes);
+		void setEnabled(bool enabled);
+		bool isEnabled();
+
+		// 命中时返回 true 并填充 data。文件损坏（头部或哈希不对）视为未命中，并删除该文件
+		// 打不开或者读到的比头部声明的短（如刚被其他线程淘汰）只视为未命中，不删除
+		bool load(const std::string& stage, uint64_t key, std::vector<uint8_t>& data);
+
+		// 删除一个条目，如 load 命中但内容无法反序列化时。统计中那次查找改为未命中
+		void discard(const std::string& stage, uint64_t key);
+
+		// producingMilliseconds: 生成这份数据花费的时间，命中时据此计算节省的时间
+		void store(const std::string& stage, uint64_t key, const std::vector<uint8_t>& data, double producingMilliseconds);
+
+		// 先查缓存，未命中时调用 produce 生成结果并写入缓存
+		// 命中但 deserialize 抛出异常时（如序列化格式改了而 key 没有变）删除该条目，同样调用 produce
+		template <typename T>
+		T fetch(
+			const std::string& stage,
+			uint64_t key,
+			const std::function<T()>& produce,
+			const std::function<void(const T&, std::vector<uint8_t>&)>& serialize,
+			const std::function<T(const std::vector<uint8_t>&)>& deserialize,
+			bool* hit = nullptr
+		) {
+			std::vector<uint8_t> data;
+			if (load(stage, key, data)) {
+				try {
+					T result = deserialize(data);
+					if (hit) *hit = true;
+					return result;
+				} catch (const std::exception&) {
+					discard(stage, key);
+				}
+			}
+
+			auto begin = std::chrono::steady_clock::now();
+			T result = produce();
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+			data.clear();
+			serialize(result, data);
+			store(stage, key, data, milliseconds);
+			if (hit) *hit = false;
+			return result;
+		}
+
+		std::vector<StageStatistics> getStatistics();
+		void clearStatistics();
+
+		// 每个 stage 一行：命中率、读写量、节省的时间
+		std::string getReport();
+	};
+
+	// 序列化缓存内容用的简单二进制读写
+	class DerivedDataWriter {
+		std::vector<uint8_t>& data;
+	public:
+		explicit DerivedDataWriter(std::vector<uint8_t>& data) : data(data) {}
+
+		void writeBytes(const void* bytes, size_t size) {
+			auto p = static_cast<const uint8_t*>(bytes);
+			data.insert(data.end(), p, p + size);
+		}
+
+		template <typename T>
+		void write(const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			writeBytes(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void writeVector(const std::vector<T>& values) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			write<uint64_t>(values.size());
+			writeBytes(values.data(), values.size() * sizeof(T));
+		}
+
+		void writeString(const std::string& value) {
+			write<uint64_t>(value.size());
+			writeBytes(value.data(), value.size());
+		}
+	};
+
+	class DerivedDataReader {
+		const std::vector<uint8_t>& data;
+		size_t position = 0;
+	public:
+		explicit DerivedDataReader(const std::vector<uint8_t>& data) : data(data) {}
+
+		void readBytes(void* bytes, size_t size) {
+			if (position + size > data.size()) {
+				throw std::exception("corrupted derived data");
+			}
+			memcpy(bytes, data.data() + position, size);
+			position += size;
+		}
+
+		template <typename T>
+		T read() {
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value;
+			readBytes(&value, sizeof(T));
+			return value;
+		}
+
+		template <typename T>
+		std::vector<T> readVector() {
+			static_assert(std::is_trivially_copyable_v<T>);
+			auto size = read<uint64_t>();
+			if (size > (data.size() - position) / sizeof(T)) {
+				throw std::exception("corrupted derived data");
+			}
+			std::vector<T> values((size_t)size);
+			readBytes(values.data(), values.size() * sizeof(T));
+			return values;
+		}
+
+		std::string readString() {
+			auto chars = readVector<char>();
+			return std::string(chars.begin(), chars.end());
+		}
+	};
+
+}
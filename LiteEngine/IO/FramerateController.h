@@ -23,13 +23,13 @@ namespace LiteEngine::IO {
 
         bool paused = true;
 
-        // ۵ʱ䣨ͣ
+        // 积累的时间（用于暂停）
         int64_t accTime = 0;
 
-        // һμ¼ʱ
+        // 上一次记录的时间
         int64_t lastTime = 0;
 
-        // ڷۼʱ
+        // 用于返回累计时间
         int64_t elapsedTime = 0;
 
 
@@ -59,7 +59,7 @@ namespace LiteEngine::IO {
             static std::once_flag initTimerFlag;
             if (cont == FramerateControlling::WaitableObject) {
                 std::call_once(initTimerFlag, []() {
-                    // Բһֱռ CPU и߾ȵ֡ʿ
+                    // 可以不一直占用 CPU 并进行高精度的帧率控制
                     TIMECAPS tc;
                     if (timeGetDevCaps(&tc, sizeof(TIMECAPS)) != TIMERR_NOERROR) {
                         throw std::exception("cannot get timeing info");
@@ -78,7 +78,7 @@ namespace LiteEngine::IO {
                 throw std::exception("cannot create timer");
         }
 
-        // һ֡õʱܺ
+        // 创建以来，到上一帧结束，用的时间总和
         double getLastFrameEndTime() {
             return 1.0 * this->elapsedTime / this->frequencyCount;
         }
@@ -110,7 +110,7 @@ namespace LiteEngine::IO {
             if (paused) return;
             paused = true;
 
-            // ͣʱֻҪ洢 accTime ͺˣҪ lastTime
+            // 暂停的时候只要存储好 accTime 就好了，不需要更新 lastTime
             LARGE_INTEGER currentTime;
             QueryPerformanceCounter(&currentTime);
             auto delta = getPositiveTime(currentTime.QuadPart - this->lastTime);
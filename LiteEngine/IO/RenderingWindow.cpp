@@ -48,7 +48,7 @@ RenderingWindow::RenderingWindow(
 	std::function<void(const RenderingWindow&, const std::vector<EventType>&)> renderCallback
 ) {
 	registerWndClass();
-	// ȡǰ .exe  hinstance
+	// 获取当前进程 .exe 的 hinstance
 	auto hinstance = GetModuleHandle(nullptr);
 	hwnd = CreateWindow(
 		CLASSNAME, window_name, dw_style,
@@ -97,7 +97,7 @@ void RenderingWindow::runRenderingLoop() {
 }
 
 void RenderingWindow::render() {
-	// ִеʱ򲻻µ¼
+	// 这个函数执行的时候不会有新的事件
 	this->renderCallback(*this, this->events);
 	this->events.clear();
 }
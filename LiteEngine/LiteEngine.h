@@ -1,16 +1,39 @@
 #pragma once
 
+#include "IO/AssetRegistry.h"
+#include "IO/AsyncLoader.h"
 #include "IO/CameraController.h"
 #include "IO/DefaultLoader.h"
+#include "IO/DerivedDataCache.h"
 #include "IO/RenderingWindow.h"
 #include "IO/FramerateController.h"
 
+#include "Renderer/BlockCompression.h"
+#include "Renderer/GeometryPool.h"
+#include "Renderer/LightClustering.h"
+#include "Renderer/OcclusionCulling.h"
 #include "Renderer/Renderer.h"
+#include "Renderer/RenderingTypes.h"
 #include "Renderer/Resources.h"
 #include "Renderer/Shadow.h"
+#include "Renderer/SoftwareRenderer.h"
+#include "Renderer/TextureProcessing.h"
 
+#include "Scene/Animation.h"
+#include "Scene/Component.h"
 #include "Scene/DefaultDS.h"
+#include "Scene/HierarchyFlattening.h"
+#include "Scene/Impostor.h"
+#include "Scene/MeshSimplification.h"
+#include "Scene/ObjectStore.h"
 #include "Scene/Scene.h"
+#include "Scene/Skinning.h"
+#include "Scene/StaticBatching.h"
 
+#include "Utilities/DoubleMath.h"
+#include "Utilities/FrameArena.h"
+#include "Utilities/Hash.h"
+#include "Utilities/InlineFunction.h"
+#include "Utilities/JobSystem.h"
 #include "Utilities/Utilities.h"
 
@@ -0,0 +1,779 @@
+#include "BlockCompression.h"
+#include "../Utilities/JobSystem.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		constexpr uint32_t BLOCK_PIXELS = 16;
+
+		// 每个 job 至少编码这么多个块，避免小 mip 拆得太碎
+		constexpr uint32_t MIN_BLOCKS_PER_JOB = 1024;
+
+		// 一个 4x4 块，按通道存放，便于一次处理 4 个像素
+		struct alignas(16) Block {
+			float c[4][BLOCK_PIXELS];
+		};
+
+		struct Endpoints {
+			float e[2][4];
+		};
+
+		// 量化后的端点。value 是解码器会还原出的值
+		struct QuantizedEndpoints {
+			float value[2][4];
+			uint32_t code[2][4];
+			uint32_t pbit[2];
+		};
+
+		const float WEIGHTS_2BIT[4] = { 0.f, 1.f / 3, 2.f / 3, 1.f };
+		const float WEIGHTS_3BIT[8] = { 0.f, 1.f / 7, 2.f / 7, 3.f / 7, 4.f / 7, 5.f / 7, 6.f / 7, 1.f };
+		const uint32_t BC7_WEIGHTS_4BIT[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		const float WEIGHTS_4BIT[16] = {
+			0 / 64.f, 4 / 64.f, 9 / 64.f, 13 / 64.f, 17 / 64.f, 21 / 64.f, 26 / 64.f, 30 / 64.f,
+			34 / 64.f, 38 / 64.f, 43 / 64.f, 47 / 64.f, 51 / 64.f, 55 / 64.f, 60 / 64.f, 64 / 64.f
+		};
+
+		uint32_t getBlockBytes(DXGI_FORMAT format) {
+			switch (format) {
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC4_UNORM:
+				return 8;
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC5_UNORM:
+			case DXGI_FORMAT_BC7_UNORM:
+				return 16;
+			default:
+				throw std::exception("unsupported block compression format");
+			}
+		}
+
+		inline float horizontalSum(__m128 v) {
+			v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(v);
+		}
+
+		inline float horizontalMin(__m128 v) {
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(v);
+		}
+
+		inline float horizontalMax(__m128 v) {
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(v);
+		}
+
+		// 读取一个块并转置为按通道存放。越过纹理边缘的像素钳制到边缘
+		void loadBlock(const uint8_t* mip, uint32_t width, uint32_t height, uint32_t rowPitch,
+			uint32_t bx, uint32_t by, Block& out) {
+			const __m128i zero = _mm_setzero_si128();
+			for (uint32_t y = 0; y < 4; y++) {
+				auto row = mip + (size_t)std::min(by * 4 + y, height - 1) * rowPitch;
+
+				alignas(16) uint8_t pixels[16];
+				if (bx * 4 + 4 <= width) {
+					memcpy(pixels, row + (size_t)bx * 16, 16);
+				} else {
+					for (uint32_t x = 0; x < 4; x++) {
+						memcpy(pixels + x * 4, row + (size_t)std::min(bx * 4 + x, width - 1) * 4, 4);
+					}
+				}
+
+				__m128i raw = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels));
+				__m128i lo = _mm_unpacklo_epi8(raw, zero);
+				__m128i hi = _mm_unpackhi_epi8(raw, zero);
+				__m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+				__m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+				__m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+				__m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+				_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+				_mm_store_ps(&out.c[0][y * 4], p0);
+				_mm_store_ps(&out.c[1][y * 4], p1);
+				_mm_store_ps(&out.c[2][y * 4], p2);
+				_mm_store_ps(&out.c[3][y * 4], p3);
+			}
+		}
+
+		// 用主成分方向（幂迭代求协方差矩阵的最大特征向量）上的投影范围作为端点
+		void computePrincipalEndpoints(const Block& block, uint32_t channels, Endpoints& out) {
+			float mean[4] = { 0, 0, 0, 0 };
+			alignas(16) float centered[4][BLOCK_PIXELS];
+			for (uint32_t c = 0; c < channels; c++) {
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i += 4) {
+					sum = _mm_add_ps(sum, _mm_load_ps(&block.c[c][i]));
+				}
+				mean[c] = horizontalSum(sum) / BLOCK_PIXELS;
+				__m128 m = _mm_set1_ps(mean[c]);
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i += 4) {
+					_mm_store_ps(&centered[c][i], _mm_sub_ps(_mm_load_ps(&block.c[c][i]), m));
+				}
+			}
+
+			float covariance[4][4] = {};
+			for (uint32_t a = 0; a < channels; a++) {
+				for (uint32_t b = a; b < channels; b++) {
+					__m128 sum = _mm_setzero_ps();
+					for (uint32_t i = 0; i < BLOCK_PIXELS; i += 4) {
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&centered[a][i]), _mm_load_ps(&centered[b][i])));
+					}
+					covariance[a][b] = covariance[b][a] = horizontalSum(sum);
+				}
+			}
+
+			// 从方差最大的通道开始迭代
+			float axis[4] = { 0, 0, 0, 0 };
+			uint32_t dominant = 0;
+			for (uint32_t c = 1; c < channels; c++) {
+				if (covariance[c][c] > covariance[dominant][dominant]) dominant = c;
+			}
+			axis[dominant] = 1;
+
+			bool degenerate = covariance[dominant][dominant] < 1e-4f;
+			for (uint32_t iteration = 0; iteration < 8 && !degenerate; iteration++) {
+				float next[4] = { 0, 0, 0, 0 };
+				float length2 = 0;
+				for (uint32_t a = 0; a < channels; a++) {
+					for (uint32_t b = 0; b < channels; b++) {
+						next[a] += covariance[a][b] * axis[b];
+					}
+					length2 += next[a] * next[a];
+				}
+				if (length2 < 1e-12f) {
+					degenerate = true;
+					break;
+				}
+				float invLength = 1 / std::sqrt(length2);
+				for (uint32_t c = 0; c < channels; c++) axis[c] = next[c] * invLength;
+			}
+
+			if (degenerate) {
+				for (uint32_t c = 0; c < 4; c++) {
+					out.e[0][c] = out.e[1][c] = mean[c];
+				}
+				return;
+			}
+
+			__m128 tMin = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128 tMax = _mm_set1_ps(-std::numeric_limits<float>::max());
+			for (uint32_t i = 0; i < BLOCK_PIXELS; i += 4) {
+				__m128 t = _mm_setzero_ps();
+				for (uint32_t c = 0; c < channels; c++) {
+					t = _mm_add_ps(t, _mm_mul_ps(_mm_load_ps(&centered[c][i]), _mm_set1_ps(axis[c])));
+				}
+				tMin = _mm_min_ps(tMin, t);
+				tMax = _mm_max_ps(tMax, t);
+			}
+			float lo = horizontalMin(tMin), hi = horizontalMax(tMax);
+
+			for (uint32_t c = 0; c < 4; c++) {
+				out.e[0][c] = std::clamp(mean[c] + axis[c] * lo, 0.f, 255.f);
+				out.e[1][c] = std::clamp(mean[c] + axis[c] * hi, 0.f, 255.f);
+			}
+		}
+
+		// 把每个像素投影到端点连线上，选最近的插值级别。返回平方误差之和
+		float selectIndices(
+			const Block& block, uint32_t channels,
+			const QuantizedEndpoints& endpoints,
+			const float* weights, uint32_t levels,
+			uint8_t indices[BLOCK_PIXELS]
+		) {
+			float direction[4] = { 0, 0, 0, 0 };
+			float length2 = 0;
+			for (uint32_t c = 0; c < channels; c++) {
+				direction[c] = endpoints.value[1][c] - endpoints.value[0][c];
+				length2 += direction[c] * direction[c];
+			}
+
+			alignas(16) float t[BLOCK_PIXELS];
+			if (length2 < 1e-6f) {
+				std::fill(t, t + BLOCK_PIXELS, 0.f);
+			} else {
+				__m128 invLength2 = _mm_set1_ps(1 / length2);
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i += 4) {
+					__m128 dot = _mm_setzero_ps();
+					for (uint32_t c = 0; c < channels; c++) {
+						__m128 offset = _mm_sub_ps(_mm_load_ps(&block.c[c][i]), _mm_set1_ps(endpoints.value[0][c]));
+						dot = _mm_add_ps(dot, _mm_mul_ps(offset, _mm_set1_ps(direction[c])));
+					}
+					dot = _mm_min_ps(_mm_max_ps(_mm_mul_ps(dot, invLength2), _mm_setzero_ps()), _mm_set1_ps(1));
+					_mm_store_ps(&t[i], dot);
+				}
+			}
+
+			float error = 0;
+			for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+				// 权重可能不均匀（BC7），在估计值附近找最近的级别
+				uint32_t guess = (uint32_t)(t[i] * (levels - 1) + 0.5f);
+				uint32_t best = guess;
+				float bestDistance = std::abs(weights[guess] - t[i]);
+				if (guess > 0 && std::abs(weights[guess - 1] - t[i]) < bestDistance) {
+					best = guess - 1;
+					bestDistance = std::abs(weights[best] - t[i]);
+				}
+				if (guess + 1 < levels && std::abs(weights[guess + 1] - t[i]) < bestDistance) {
+					best = guess + 1;
+				}
+				indices[i] = (uint8_t)best;
+
+				for (uint32_t c = 0; c < channels; c++) {
+					float decoded = endpoints.value[0][c] + weights[best] * direction[c];
+					float diff = block.c[c][i] - decoded;
+					error += diff * diff;
+				}
+			}
+			return error;
+		}
+
+		// 固定索引，用最小二乘求最优端点
+		void refineEndpoints(
+			const Block& block, uint32_t channels,
+			const uint8_t indices[BLOCK_PIXELS], const float* weights,
+			Endpoints& endpoints
+		) {
+			float alpha2 = 0, beta2 = 0, alphaBeta = 0;
+			float alphaX[4] = { 0, 0, 0, 0 }, betaX[4] = { 0, 0, 0, 0 };
+			for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+				float beta = weights[indices[i]];
+				float alpha = 1 - beta;
+				alpha2 += alpha * alpha;
+				beta2 += beta * beta;
+				alphaBeta += alpha * beta;
+				for (uint32_t c = 0; c < channels; c++) {
+					alphaX[c] += alpha * block.c[c][i];
+					betaX[c] += beta * block.c[c][i];
+				}
+			}
+
+			float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+			if (std::abs(determinant) < 1e-6f) return;
+
+			float inverse = 1 / determinant;
+			for (uint32_t c = 0; c < channels; c++) {
+				endpoints.e[0][c] = std::clamp((alphaX[c] * beta2 - betaX[c] * alphaBeta) * inverse, 0.f, 255.f);
+				endpoints.e[1][c] = std::clamp((betaX[c] * alpha2 - alphaX[c] * alphaBeta) * inverse, 0.f, 255.f);
+			}
+		}
+
+		inline uint32_t quantizeChannel(float value, uint32_t bits) {
+			uint32_t maximum = (1u << bits) - 1;
+			return std::min(maximum, (uint32_t)(value * maximum / 255.f + 0.5f));
+		}
+
+		inline uint32_t expandChannel(uint32_t code, uint32_t bits) {
+			// 和硬件一样，用高位补齐低位
+			return (code << (8 - bits)) | (code >> (2 * bits - 8));
+		}
+
+		QuantizedEndpoints quantizeRGB565(const Endpoints& endpoints) {
+			const uint32_t bits[3] = { 5, 6, 5 };
+			QuantizedEndpoints out = {};
+			for (uint32_t e = 0; e < 2; e++) {
+				for (uint32_t c = 0; c < 3; c++) {
+					out.code[e][c] = quantizeChannel(endpoints.e[e][c], bits[c]);
+					out.value[e][c] = (float)expandChannel(out.code[e][c], bits[c]);
+				}
+			}
+			return out;
+		}
+
+		QuantizedEndpoints quantize8Bit(const Endpoints& endpoints) {
+			QuantizedEndpoints out = {};
+			for (uint32_t e = 0; e < 2; e++) {
+				out.code[e][0] = (uint32_t)(std::clamp(endpoints.e[e][0], 0.f, 255.f) + 0.5f);
+				out.value[e][0] = (float)out.code[e][0];
+			}
+			return out;
+		}
+
+		// BC7 mode 6：每个通道 7 位，每个端点再有一个共享的最低位（p-bit）
+		QuantizedEndpoints quantizeRGBA7P(const Endpoints& endpoints) {
+			QuantizedEndpoints out = {};
+			for (uint32_t e = 0; e < 2; e++) {
+				float bestError = std::numeric_limits<float>::max();
+				for (uint32_t p = 0; p < 2; p++) {
+					uint32_t code[4];
+					float error = 0;
+					for (uint32_t c = 0; c < 4; c++) {
+						float v = (endpoints.e[e][c] - p) / 2;
+						code[c] = (uint32_t)std::clamp((int)(v + 0.5f), 0, 127);
+						float diff = (float)(code[c] * 2 + p) - endpoints.e[e][c];
+						error += diff * diff;
+					}
+					if (error < bestError) {
+						bestError = error;
+						out.pbit[e] = p;
+						for (uint32_t c = 0; c < 4; c++) {
+							out.code[e][c] = code[c];
+							out.value[e][c] = (float)(code[c] * 2 + p);
+						}
+					}
+				}
+			}
+			return out;
+		}
+
+		// 拟合端点和索引：PCA 初值，按质量做若干次 最小二乘 -> 量化 -> 重新选索引，保留误差最小的一次
+		QuantizedEndpoints fitEndpoints(
+			const Block& block, uint32_t channels,
+			const float* weights, uint32_t levels,
+			QuantizedEndpoints(*quantize)(const Endpoints&),
+			BlockCompressionQuality quality,
+			uint8_t indices[BLOCK_PIXELS]
+		) {
+			Endpoints endpoints;
+			computePrincipalEndpoints(block, channels, endpoints);
+
+			uint32_t iterations = quality == BlockCompressionQuality::FAST ? 0 :
+				quality == BlockCompressionQuality::NORMAL ? 1 : 2;
+
+			QuantizedEndpoints best = {};
+			float bestError = std::numeric_limits<float>::max();
+			uint8_t candidate[BLOCK_PIXELS];
+
+			for (uint32_t iteration = 0; iteration <= iterations; iteration++) {
+				auto quantized = quantize(endpoints);
+				float error = selectIndices(block, channels, quantized, weights, levels, candidate);
+				if (error < bestError) {
+					bestError = error;
+					best = quantized;
+					memcpy(indices, candidate, BLOCK_PIXELS);
+				}
+				if (error == 0) break;
+				if (iteration < iterations) {
+					refineEndpoints(block, channels, candidate, weights, endpoints);
+				}
+			}
+			return best;
+		}
+
+		// 小端序逐位写入
+		class BitWriter {
+			uint8_t* data;
+			uint32_t position = 0;
+		public:
+			explicit BitWriter(uint8_t* data, uint32_t bytes) : data(data) {
+				memset(data, 0, bytes);
+			}
+
+			void write(uint32_t value, uint32_t bits) {
+				for (uint32_t i = 0; i < bits; i++, position++) {
+					data[position / 8] |= ((value >> i) & 1) << (position % 8);
+				}
+			}
+		};
+
+		class BitReader {
+			const uint8_t* data;
+			uint32_t position = 0;
+		public:
+			explicit BitReader(const uint8_t* data) : data(data) {}
+
+			uint32_t read(uint32_t bits) {
+				uint32_t value = 0;
+				for (uint32_t i = 0; i < bits; i++, position++) {
+					value |= ((data[position / 8] >> (position % 8)) & 1u) << i;
+				}
+				return value;
+			}
+		};
+
+		void encodeBC1(const Block& block, BlockCompressionQuality quality, uint8_t* out) {
+			uint8_t levels[BLOCK_PIXELS];
+			auto endpoints = fitEndpoints(block, 3, WEIGHTS_2BIT, 4, quantizeRGB565, quality, levels);
+
+			uint16_t c0 = (uint16_t)((endpoints.code[0][0] << 11) | (endpoints.code[0][1] << 5) | endpoints.code[0][2]);
+			uint16_t c1 = (uint16_t)((endpoints.code[1][0] << 11) | (endpoints.code[1][1] << 5) | endpoints.code[1][2]);
+
+			// c0 > c1 才是 4 色模式
+			bool swapped = c0 < c1;
+			if (swapped) std::swap(c0, c1);
+
+			// 级别（从 c0 到 c1）-> 编码中的索引
+			const uint32_t levelToIndex[4] = { 0, 2, 3, 1 };
+			uint32_t bits = 0;
+			if (c0 != c1) {
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+					uint32_t level = swapped ? 3 - levels[i] : levels[i];
+					bits |= levelToIndex[level] << (2 * i);
+				}
+			}
+
+			memcpy(out, &c0, 2);
+			memcpy(out + 2, &c1, 2);
+			memcpy(out + 4, &bits, 4);
+		}
+
+		void encodeBC4(const Block& block, uint32_t channel, BlockCompressionQuality quality, uint8_t* out) {
+			alignas(16) Block single;
+			memcpy(single.c[0], block.c[channel], sizeof(single.c[0]));
+
+			uint8_t levels[BLOCK_PIXELS];
+			auto endpoints = fitEndpoints(single, 1, WEIGHTS_3BIT, 8, quantize8Bit, quality, levels);
+
+			uint32_t a0 = endpoints.code[0][0], a1 = endpoints.code[1][0];
+			// a0 > a1 才是 8 级插值模式
+			bool swapped = a0 < a1;
+			if (swapped) std::swap(a0, a1);
+
+			BitWriter writer(out, 8);
+			writer.write(a0, 8);
+			writer.write(a1, 8);
+			for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+				uint32_t index = 0;
+				if (a0 != a1) {
+					uint32_t level = swapped ? 7 - levels[i] : levels[i];
+					index = level == 0 ? 0 : level == 7 ? 1 : level + 1;
+				}
+				writer.write(index, 3);
+			}
+		}
+
+		void encodeBC7Mode6(const Block& block, BlockCompressionQuality quality, uint8_t* out) {
+			uint8_t levels[BLOCK_PIXELS];
+			auto endpoints = fitEndpoints(block, 4, WEIGHTS_4BIT, 16, quantizeRGBA7P, quality, levels);
+
+			// 第一个像素的索引最高位隐含为 0
+			if (levels[0] >= 8) {
+				for (uint32_t c = 0; c < 4; c++) std::swap(endpoints.code[0][c], endpoints.code[1][c]);
+				std::swap(endpoints.pbit[0], endpoints.pbit[1]);
+				for (auto& level : levels) level = (uint8_t)(15 - level);
+			}
+
+			BitWriter writer(out, 16);
+			writer.write(1 << 6, 7);
+			for (uint32_t c = 0; c < 4; c++) {
+				writer.write(endpoints.code[0][c], 7);
+				writer.write(endpoints.code[1][c], 7);
+			}
+			writer.write(endpoints.pbit[0], 1);
+			writer.write(endpoints.pbit[1], 1);
+			writer.write(levels[0], 3);
+			for (uint32_t i = 1; i < BLOCK_PIXELS; i++) {
+				writer.write(levels[i], 4);
+			}
+		}
+
+		void encodeBlock(DXGI_FORMAT format, const Block& block, BlockCompressionQuality quality, uint8_t* out) {
+			switch (format) {
+			case DXGI_FORMAT_BC1_UNORM:
+				encodeBC1(block, quality, out);
+				break;
+			case DXGI_FORMAT_BC3_UNORM:
+				encodeBC4(block, 3, quality, out);
+				encodeBC1(block, quality, out + 8);
+				break;
+			case DXGI_FORMAT_BC4_UNORM:
+				encodeBC4(block, 0, quality, out);
+				break;
+			case DXGI_FORMAT_BC5_UNORM:
+				encodeBC4(block, 0, quality, out);
+				encodeBC4(block, 1, quality, out + 8);
+				break;
+			case DXGI_FORMAT_BC7_UNORM:
+				encodeBC7Mode6(block, quality, out);
+				break;
+			default:
+				throw std::exception("unsupported block compression format");
+			}
+		}
+
+		// out: 16 个像素的 RGBA
+		void decodeBC1(const uint8_t* in, bool forceFourColors, uint8_t out[BLOCK_PIXELS][4]) {
+			uint16_t c0, c1;
+			uint32_t bits;
+			memcpy(&c0, in, 2);
+			memcpy(&c1, in + 2, 2);
+			memcpy(&bits, in + 4, 4);
+
+			uint32_t palette[4][4];
+			const uint16_t colors[2] = { c0, c1 };
+			for (uint32_t e = 0; e < 2; e++) {
+				palette[e][0] = expandChannel(colors[e] >> 11, 5);
+				palette[e][1] = expandChannel((colors[e] >> 5) & 0x3F, 6);
+				palette[e][2] = expandChannel(colors[e] & 0x1F, 5);
+				palette[e][3] = 255;
+			}
+			for (uint32_t c = 0; c < 3; c++) {
+				if (c0 > c1 || forceFourColors) {
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				} else {
+					palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+					palette[3][c] = 0;
+				}
+			}
+			palette[2][3] = 255;
+			palette[3][3] = (c0 > c1 || forceFourColors) ? 255 : 0;
+
+			for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+				uint32_t index = (bits >> (2 * i)) & 3;
+				for (uint32_t c = 0; c < 4; c++) out[i][c] = (uint8_t)palette[index][c];
+			}
+		}
+
+		void decodeBC4(const uint8_t* in, uint8_t out[BLOCK_PIXELS]) {
+			BitReader reader(in);
+			uint32_t a0 = reader.read(8), a1 = reader.read(8);
+			uint32_t palette[8] = { a0, a1 };
+			for (uint32_t i = 2; i < 8; i++) {
+				if (a0 > a1) {
+					palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+				} else if (i < 6) {
+					palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+				} else {
+					palette[i] = i == 6 ? 0 : 255;
+				}
+			}
+			for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+				out[i] = (uint8_t)palette[reader.read(3)];
+			}
+		}
+
+		void decodeBC7Mode6(const uint8_t* in, uint8_t out[BLOCK_PIXELS][4]) {
+			BitReader reader(in);
+			if (reader.read(7) != (1 << 6)) {
+				throw std::exception("only BC7 mode 6 blocks can be decoded");
+			}
+			uint32_t code[2][4];
+			for (uint32_t c = 0; c < 4; c++) {
+				code[0][c] = reader.read(7);
+				code[1][c] = reader.read(7);
+			}
+			uint32_t p0 = reader.read(1), p1 = reader.read(1);
+			uint32_t e0[4], e1[4];
+			for (uint32_t c = 0; c < 4; c++) {
+				e0[c] = code[0][c] << 1 | p0;
+				e1[c] = code[1][c] << 1 | p1;
+			}
+			for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+				uint32_t weight = BC7_WEIGHTS_4BIT[reader.read(i == 0 ? 3 : 4)];
+				for (uint32_t c = 0; c < 4; c++) {
+					out[i][c] = (uint8_t)(((64 - weight) * e0[c] + weight * e1[c] + 32) >> 6);
+				}
+			}
+		}
+
+		void decodeBlock(DXGI_FORMAT format, const uint8_t* in, uint8_t out[BLOCK_PIXELS][4]) {
+			uint8_t channel[BLOCK_PIXELS];
+			switch (format) {
+			case DXGI_FORMAT_BC1_UNORM:
+				decodeBC1(in, false, out);
+				break;
+			case DXGI_FORMAT_BC3_UNORM:
+				decodeBC1(in + 8, true, out);
+				decodeBC4(in, channel);
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i++) out[i][3] = channel[i];
+				break;
+			case DXGI_FORMAT_BC4_UNORM:
+				decodeBC4(in, channel);
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+					out[i][0] = channel[i];
+					out[i][1] = out[i][2] = 0;
+					out[i][3] = 255;
+				}
+				break;
+			case DXGI_FORMAT_BC5_UNORM:
+				decodeBC4(in, channel);
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i++) out[i][0] = channel[i];
+				decodeBC4(in + 8, channel);
+				for (uint32_t i = 0; i < BLOCK_PIXELS; i++) {
+					out[i][1] = channel[i];
+					out[i][2] = 0;
+					out[i][3] = 255;
+				}
+				break;
+			case DXGI_FORMAT_BC7_UNORM:
+				decodeBC7Mode6(in, out);
+				break;
+			default:
+				throw std::exception("unsupported block compression format");
+			}
+		}
+
+		// 与 PSNR 相关的通道
+		uint32_t getChannelMask(DXGI_FORMAT format) {
+			switch (format) {
+			case DXGI_FORMAT_BC1_UNORM: return 0b0111;
+			case DXGI_FORMAT_BC4_UNORM: return 0b0001;
+			case DXGI_FORMAT_BC5_UNORM: return 0b0011;
+			default: return 0b1111;
+			}
+		}
+
+		double computePSNR(const TextureData& source, const TextureData& decoded, uint32_t channelMask) {
+			auto& level = source.mips[0];
+			double squaredError = 0;
+			uint64_t samples = 0;
+			for (uint32_t y = 0; y < level.height; y++) {
+				auto a = source.getMipData(0) + (size_t)y * level.rowPitch;
+				auto b = decoded.getMipData(0) + (size_t)y * decoded.mips[0].rowPitch;
+				for (uint32_t x = 0; x < level.width * 4; x++) {
+					if (!(channelMask & (1u << (x % 4)))) continue;
+					double diff = (double)a[x] - b[x];
+					squaredError += diff * diff;
+					samples++;
+				}
+			}
+			if (squaredError == 0) return std::numeric_limits<double>::infinity();
+			return 10 * std::log10(255.0 * 255.0 * samples / squaredError);
+		}
+	}
+
+	bool isBlockCompressedFormat(DXGI_FORMAT format) {
+		switch (format) {
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC7_UNORM:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool canBlockCompress(const TextureData& data) {
+		return data.format == DXGI_FORMAT_R8G8B8A8_UNORM && !data.mips.empty() &&
+			data.getWidth() % 4 == 0 && data.getHeight() % 4 == 0;
+	}
+
+	bool hasTransparentPixels(const TextureData& data) {
+		if (data.mips.empty()) return false;
+		auto& level = data.mips[0];
+		for (uint32_t y = 0; y < level.height; y++) {
+			auto row = data.getMipData(0) + (size_t)y * level.rowPitch;
+			for (uint32_t x = 0; x < level.width; x++) {
+				if (row[x * 4 + 3] != 255) return true;
+			}
+		}
+		return false;
+	}
+
+	TextureData compressTexture(
+		const TextureData& source,
+		DXGI_FORMAT format,
+		BlockCompressionQuality quality,
+		BlockCompressionStatistics* statistics
+	) {
+		if (!canBlockCompress(source)) {
+			throw std::exception("block compression requires R8G8B8A8_UNORM with size of multiples of 4");
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		uint32_t blockBytes = getBlockBytes(format);
+
+		TextureData out;
+		out.format = format;
+		size_t totalSize = 0;
+		uint64_t totalPixels = 0;
+		for (auto& level : source.mips) {
+			TextureData::MipLevel compressed;
+			compressed.width = level.width;
+			compressed.height = level.height;
+			compressed.offset = totalSize;
+			compressed.rowPitch = std::max(1u, (level.width + 3) / 4) * blockBytes;
+			compressed.slicePitch = compressed.rowPitch * std::max(1u, (level.height + 3) / 4);
+			totalSize += compressed.slicePitch;
+			totalPixels += (uint64_t)level.width * level.height;
+			out.mips.push_back(compressed);
+		}
+		out.pixels.resize(totalSize);
+
+		// 以块行为单位拆分
+		auto& jobs = JobSystem::getInstance();
+		std::vector<std::future<void>> pending;
+		for (size_t mip = 0; mip < source.mips.size(); mip++) {
+			auto& level = source.mips[mip];
+			uint32_t blocksX = std::max(1u, (level.width + 3) / 4);
+			uint32_t blocksY = std::max(1u, (level.height + 3) / 4);
+			uint32_t rowsPerJob = std::max(1u, MIN_BLOCKS_PER_JOB / blocksX);
+
+			for (uint32_t rowBegin = 0; rowBegin < blocksY; rowBegin += rowsPerJob) {
+				uint32_t rowEnd = std::min(blocksY, rowBegin + rowsPerJob);
+				pending.push_back(jobs.submit([&source, &out, mip, rowBegin, rowEnd, blocksX, format, quality, blockBytes]() {
+					auto& level = source.mips[mip];
+					auto input = source.getMipData(mip);
+					auto output = out.getMipData(mip);
+					Block block;
+					for (uint32_t by = rowBegin; by < rowEnd; by++) {
+						for (uint32_t bx = 0; bx < blocksX; bx++) {
+							loadBlock(input, level.width, level.height, level.rowPitch, bx, by, block);
+							encodeBlock(format, block, quality,
+								output + (size_t)by * out.mips[mip].rowPitch + (size_t)bx * blockBytes);
+						}
+					}
+				}));
+			}
+		}
+		for (auto& job : pending) {
+			jobs.wait(job);
+			job.get();
+		}
+
+		if (statistics) {
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+			statistics->format = format;
+			statistics->milliseconds = milliseconds;
+			statistics->megapixelsPerSecond = milliseconds > 0 ? totalPixels / milliseconds / 1000 : 0;
+			statistics->sourceBytes = source.pixels.size();
+			statistics->compressedBytes = out.pixels.size();
+			statistics->psnr = computePSNR(source, decompressTexture(out), getChannelMask(format));
+		}
+
+		return out;
+	}
+
+	TextureData decompressTexture(const TextureData& compressed) {
+		uint32_t blockBytes = getBlockBytes(compressed.format);
+
+		TextureData out;
+		out.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		size_t totalSize = 0;
+		for (auto& level : compressed.mips) {
+			TextureData::MipLevel decoded;
+			decoded.width = level.width;
+			decoded.height = level.height;
+			decoded.offset = totalSize;
+			decoded.rowPitch = level.width * 4;
+			decoded.slicePitch = decoded.rowPitch * level.height;
+			totalSize += decoded.slicePitch;
+			out.mips.push_back(decoded);
+		}
+		out.pixels.resize(totalSize);
+
+		for (size_t mip = 0; mip < compressed.mips.size(); mip++) {
+			auto& level = out.mips[mip];
+			uint32_t blocksX = std::max(1u, (level.width + 3) / 4);
+			uint32_t blocksY = std::max(1u, (level.height + 3) / 4);
+			for (uint32_t by = 0; by < blocksY; by++) {
+				for (uint32_t bx = 0; bx < blocksX; bx++) {
+					uint8_t pixels[BLOCK_PIXELS][4];
+					decodeBlock(compressed.format,
+						compressed.getMipData(mip) + (size_t)by * compressed.mips[mip].rowPitch + (size_t)bx * blockBytes,
+						pixels);
+					for (uint32_t y = 0; y < 4 && by * 4 + y < level.height; y++) {
+						for (uint32_t x = 0; x < 4 && bx * 4 + x < level.width; x++) {
+							memcpy(out.getMipData(mip) + (size_t)(by * 4 + y) * level.rowPitch + (size_t)(bx * 4 + x) * 4,
+								pixels[y * 4 + x], 4);
+						}
+					}
+				}
+			}
+		}
+
+		return out;
+	}
+
+}
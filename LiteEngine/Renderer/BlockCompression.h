@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Resources.h"
+
+namespace LiteEngine::Rendering {
+
+	// 质量 / 速度的取舍
+	//   FAST:   沿主成分方向取端点，不做迭代
+	//   NORMAL: 在 FAST 的基础上做一次最小二乘迭代
+	//   HIGH:   迭代两次。选择格式时，颜色纹理会使用 BC7
+	enum class BlockCompressionQuality : uint32_t {
+		FAST,
+		NORMAL,
+		HIGH
+	};
+
+	struct BlockCompressionStatistics {
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		double milliseconds = 0;
+		double megapixelsPerSecond = 0;		// 所有 mip 的像素数 / 编码时间
+		double psnr = 0;					// 第 0 级 mip，只统计格式中存在的通道。完全无损时为 +inf
+		size_t sourceBytes = 0;
+		size_t compressedBytes = 0;
+	};
+
+	// 支持的格式：BC1_UNORM, BC3_UNORM, BC4_UNORM, BC5_UNORM, BC7_UNORM
+	bool isBlockCompressedFormat(DXGI_FORMAT format);
+
+	// D3D11 要求块压缩纹理第 0 级的宽高是 4 的倍数
+	bool canBlockCompress(const TextureData& data);
+
+	// 是否存在 alpha < 255 的像素（只检查第 0 级）
+	bool hasTransparentPixels(const TextureData& data);
+
+	// 把 R8G8B8A8_UNORM 的纹理（包括所有 mip）压缩为 format
+	// 以块行为单位拆分到 JobSystem 上并行编码。可以在工作线程中调用
+	// BC7 目前只输出 mode 6（单分区，RGBA 端点 + 4 位索引）
+	TextureData compressTexture(
+		const TextureData& source,
+		DXGI_FORMAT format,
+		BlockCompressionQuality quality,
+		BlockCompressionStatistics* statistics = nullptr
+	);
+
+	// 解码为 R8G8B8A8_UNORM，用于统计误差或调试。只支持 compressTexture 输出的编码
+	TextureData decompressTexture(const TextureData& compressed);
+
+}
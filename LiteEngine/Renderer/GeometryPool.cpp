@@ -0,0 +1,240 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <cstdio>
+
+namespace LiteEngine::Rendering {
+
+	GeometryAllocation::~GeometryAllocation() {
+		if (heap) heap->release(this);
+	}
+
+	uint32_t GeometryAllocation::getStride() const {
+		return heap->stride;
+	}
+
+	ID3D11Buffer* GeometryAllocation::getBuffer() const {
+		return heap->buffer.Get();
+	}
+
+	GeometryHeap::GeometryHeap(ID3D11Device* device, bool isIndexHeap, uint32_t stride, uint32_t capacity) :
+		isIndexHeap(isIndexHeap), stride(stride), capacity(capacity) {
+		CD3D11_BUFFER_DESC desc(capacity * stride, isIndexHeap ? D3D11_BIND_INDEX_BUFFER : D3D11_BIND_VERTEX_BUFFER);
+		if (FAILED(device->CreateBuffer(&desc, nullptr, &buffer))) {
+			throw std::exception("failed to create geometry heap");
+		}
+		freeRanges[0] = capacity;
+	}
+
+	bool GeometryHeap::tryAllocate(uint32_t count, uint32_t& offset) {
+		auto best = freeRanges.end();
+		for (auto it = freeRanges.begin(); it != freeRanges.end(); it++) {
+			if (it->second >= count && (best == freeRanges.end() || it->second < best->second)) {
+				best = it;
+				if (it->second == count) break;
+			}
+		}
+		if (best == freeRanges.end()) return false;
+
+		offset = best->first;
+		uint32_t remaining = best->second - count;
+		freeRanges.erase(best);
+		if (remaining > 0) freeRanges[offset + count] = remaining;
+		usedCount += count;
+		return true;
+	}
+
+	void GeometryHeap::release(GeometryAllocation* allocation) {
+		std::lock_guard<std::mutex> guard(lock);
+		uint32_t offset = allocation->offset;
+		uint32_t count = allocation->count;
+		allocations.erase(offset);
+		usedCount -= count;
+
+		// 与前后相邻的空闲区间合并
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.end() && next->first == offset + count) {
+			count += next->second;
+			next = freeRanges.erase(next);
+		}
+		if (next != freeRanges.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				prev->second += count;
+				return;
+			}
+		}
+		freeRanges[offset] = count;
+	}
+
+	uint32_t GeometryHeap::getLargestFreeRange() const {
+		uint32_t largest = 0;
+		for (auto& [offset, count] : freeRanges) {
+			largest = std::max(largest, count);
+		}
+		return largest;
+	}
+
+	double GeometryHeap::getFragmentation() const {
+		uint32_t freeCount = capacity - usedCount;
+		if (freeCount == 0) return 0;
+		return 1.0 - (double)getLargestFreeRange() / freeCount;
+	}
+
+	PtrGeometryAllocation GeometryPool::allocate(bool isIndexHeap, const void* data, uint32_t count, uint32_t stride) {
+		PtrGeometryAllocation allocation(new GeometryAllocation());
+		// 空的 mesh 也占一个元素，保证 offset 唯一
+		allocation->count = std::max(count, 1u);
+
+		// 分配和登记之间不能插入碎片整理，所以这一段持有 pool 的锁
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		uint32_t offset = 0;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			std::shared_ptr<GeometryHeap> heap;
+			for (auto& candidate : heaps) {
+				if (candidate->isIndexHeap != isIndexHeap || candidate->stride != stride) continue;
+				std::lock_guard<std::mutex> heapGuard(candidate->lock);
+				if (candidate->tryAllocate(allocation->count, offset)) {
+					heap = candidate;
+					break;
+				}
+			}
+
+			if (!heap) {
+				uint32_t defaultCapacity = (isIndexHeap ? DEFAULT_INDEX_HEAP_BYTES : DEFAULT_VERTEX_HEAP_BYTES) / stride;
+				heap = std::shared_ptr<GeometryHeap>(new GeometryHeap(
+					device.Get(), isIndexHeap, stride, std::max(defaultCapacity, allocation->count)));
+				std::lock_guard<std::mutex> heapGuard(heap->lock);
+				heap->tryAllocate(allocation->count, offset);
+				heaps.push_back(heap);
+			}
+
+			std::lock_guard<std::mutex> heapGuard(heap->lock);
+			allocation->heap = heap;
+			allocation->offset = offset;
+			heap->allocations[offset] = allocation.get();
+			allocationCount++;
+			buffer = heap->buffer;
+		}
+
+		// 上传可能要拷贝很多数据，不持有锁，其他线程的分配和释放不必等它
+		// 上传和碎片整理（collectGarbage）都只在渲染线程进行，所以上传完成之前这段空间不会被移动，buffer 也不会被替换
+		if (data && count > 0) {
+			D3D11_BOX box = { offset * stride, 0, 0, (offset + count) * stride, 1, 1 };
+			context->UpdateSubresource(buffer.Get(), 0, &box, data, 0, 0);
+		}
+		return allocation;
+	}
+
+	void GeometryPool::defragment(GeometryHeap& heap) {
+		// 同一个 buffer 内的区域不能互相拷贝，所以拷贝到一个新 buffer 中
+		CD3D11_BUFFER_DESC desc(heap.capacity * heap.stride,
+			heap.isIndexHeap ? D3D11_BIND_INDEX_BUFFER : D3D11_BIND_VERTEX_BUFFER);
+		Microsoft::WRL::ComPtr<ID3D11Buffer> compacted;
+		if (FAILED(device->CreateBuffer(&desc, nullptr, &compacted))) return;
+
+		std::map<uint32_t, GeometryAllocation*> moved;
+		uint32_t cursor = 0;
+		for (auto& [offset, allocation] : heap.allocations) {
+			D3D11_BOX box = { offset * heap.stride, 0, 0, (offset + allocation->count) * heap.stride, 1, 1 };
+			context->CopySubresourceRegion(compacted.Get(), 0, cursor * heap.stride, 0, 0, heap.buffer.Get(), 0, &box);
+			if (cursor != offset) bytesMovedByDefragmentation += (uint64_t)allocation->count * heap.stride;
+			allocation->offset = cursor;
+			moved[cursor] = allocation;
+			cursor += allocation->count;
+		}
+
+		heap.buffer = compacted;
+		heap.allocations = std::move(moved);
+		heap.freeRanges.clear();
+		if (cursor < heap.capacity) heap.freeRanges[cursor] = heap.capacity - cursor;
+		defragmentationCount++;
+	}
+
+	void GeometryPool::collectGarbage(bool force) {
+		std::lock_guard<std::mutex> guard(lock);
+
+		for (auto& heap : heaps) {
+			std::lock_guard<std::mutex> heapGuard(heap->lock);
+			// 唯一的空闲区间在末尾时没有空洞
+			auto& free = heap->freeRanges;
+			bool hasHoles = free.size() > 1 ||
+				(free.size() == 1 && free.begin()->first + free.begin()->second != heap->capacity);
+			if (!hasHoles) continue;
+			if (force || heap->getFragmentation() > DEFRAGMENTATION_THRESHOLD) {
+				defragment(*heap);
+			}
+		}
+
+		// 空的 heap 释放掉，但同类的 heap 中至少保留一个默认大小的
+		for (auto it = heaps.begin(); it != heaps.end();) {
+			auto& heap = *it;
+			bool hasSibling = std::any_of(heaps.begin(), heaps.end(), [&](auto& other) {
+				return other != heap && other->isIndexHeap == heap->isIndexHeap && other->stride == heap->stride;
+			});
+			uint32_t defaultCapacity = (heap->isIndexHeap ? DEFAULT_INDEX_HEAP_BYTES : DEFAULT_VERTEX_HEAP_BYTES) / heap->stride;
+			std::unique_lock<std::mutex> heapGuard(heap->lock);
+			if (heap->usedCount == 0 && (hasSibling || heap->capacity > defaultCapacity)) {
+				heapGuard.unlock();
+				it = heaps.erase(it);
+			} else {
+				it++;
+			}
+		}
+	}
+
+	GeometryPool::Statistics GeometryPool::getStatistics() {
+		Statistics out;
+		std::lock_guard<std::mutex> guard(lock);
+		uint64_t liveAllocations = 0;
+		for (auto& heap : heaps) {
+			std::lock_guard<std::mutex> heapGuard(heap->lock);
+			HeapStatistics stat;
+			stat.isIndexHeap = heap->isIndexHeap;
+			stat.stride = heap->stride;
+			stat.capacity = heap->capacity;
+			stat.used = heap->usedCount;
+			stat.allocations = (uint32_t)heap->allocations.size();
+			stat.freeRanges = (uint32_t)heap->freeRanges.size();
+			stat.largestFreeRange = heap->getLargestFreeRange();
+			stat.occupancy = (double)heap->usedCount / heap->capacity;
+			stat.fragmentation = heap->getFragmentation();
+			out.heaps.push_back(stat);
+
+			out.capacityBytes += (uint64_t)heap->capacity * heap->stride;
+			out.usedBytes += (uint64_t)heap->usedCount * heap->stride;
+			liveAllocations += heap->allocations.size();
+		}
+		out.allocations = allocationCount;
+		out.releases = allocationCount - liveAllocations;
+		out.defragmentations = defragmentationCount;
+		out.bytesMovedByDefragmentation = bytesMovedByDefragmentation;
+		return out;
+	}
+
+	std::string GeometryPool::getReport() {
+		auto stat = getStatistics();
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "%-7s %6s %10s %10s %8s %6s %10s %9s %8s\n",
+			"heap", "stride", "capacity", "used", "allocs", "ranges", "largest", "occupancy", "fragment");
+		out << line;
+		for (auto& heap : stat.heaps) {
+			snprintf(line, sizeof(line), "%-7s %6u %10u %10u %8u %6u %10u %8.1f%% %7.1f%%\n",
+				heap.isIndexHeap ? "index" : "vertex", heap.stride, heap.capacity, heap.used, heap.allocations,
+				heap.freeRanges, heap.largestFreeRange, heap.occupancy * 100, heap.fragmentation * 100);
+			out << line;
+		}
+		snprintf(line, sizeof(line), "used %.1f / %.1f MiB, allocations %llu, releases %llu, "
+			"defragmentations %llu (%.1f MiB moved)\n",
+			stat.usedBytes / (1024.0 * 1024.0), stat.capacityBytes / (1024.0 * 1024.0),
+			(unsigned long long)stat.allocations, (unsigned long long)stat.releases,
+			(unsigned long long)stat.defragmentations, stat.bytesMovedByDefragmentation / (1024.0 * 1024.0));
+		out << line;
+		return out.str();
+	}
+
+}
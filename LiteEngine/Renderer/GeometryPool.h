@@ -0,0 +1,136 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LiteEngine::Rendering {
+
+	class GeometryHeap;
+
+	// 几何池中的一段连续元素（顶点或索引）
+	// 碎片整理会移动数据，offset 随之改变，所以绘制时每次重新读取，不要缓存
+	// 析构时归还空间
+	class GeometryAllocation {
+		friend class GeometryHeap;
+		friend class GeometryPool;
+
+		std::shared_ptr<GeometryHeap> heap;
+		uint32_t offset = 0;
+		uint32_t count = 0;
+
+		GeometryAllocation() = default;
+
+	public:
+		GeometryAllocation(const GeometryAllocation&) = delete;
+		void operator=(const GeometryAllocation&) = delete;
+		~GeometryAllocation();
+
+		uint32_t getOffset() const { return offset; }
+		uint32_t getCount() const { return count; }
+		uint32_t getStride() const;
+		ID3D11Buffer* getBuffer() const;
+	};
+
+	using PtrGeometryAllocation = std::shared_ptr<GeometryAllocation>;
+
+	// 一个大 buffer，按元素分配。空闲区间按 offset 排序，分配时选最小的足够大的区间，释放时与相邻区间合并
+	class GeometryHeap {
+		friend class GeometryAllocation;
+		friend class GeometryPool;
+
+		std::mutex lock;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		bool isIndexHeap;
+		uint32_t stride;
+		uint32_t capacity;
+		uint32_t usedCount = 0;
+
+		std::map<uint32_t, uint32_t> freeRanges;				// offset -> count
+		std::map<uint32_t, GeometryAllocation*> allocations;	// offset -> allocation
+
+		// 以下需要持有 lock
+		bool tryAllocate(uint32_t count, uint32_t& offset);
+		void release(GeometryAllocation* allocation);
+		uint32_t getLargestFreeRange() const;
+		double getFragmentation() const;
+
+	public:
+		GeometryHeap(ID3D11Device* device, bool isIndexHeap, uint32_t stride, uint32_t capacity);
+	};
+
+	// 所有静态 mesh 共用的顶点 / 索引 buffer
+	// 顶点按 stride 分到不同的 heap 中；同一 heap 中的 mesh 连续绘制时不需要重新绑定 IA
+	// 分配和释放可以在任意线程进行，上传数据和碎片整理需要 context，只能在渲染线程调用
+	class GeometryPool {
+	public:
+		static constexpr uint32_t DEFAULT_VERTEX_HEAP_BYTES = 64u << 20;
+		static constexpr uint32_t DEFAULT_INDEX_HEAP_BYTES = 16u << 20;
+		// 空闲空间中最大的连续区间占比低于 1 - 该值时整理
+		static constexpr double DEFRAGMENTATION_THRESHOLD = 0.5;
+
+		struct HeapStatistics {
+			bool isIndexHeap;
+			uint32_t stride;
+			uint32_t capacity;			// 元素数
+			uint32_t used;
+			uint32_t allocations;
+			uint32_t freeRanges;
+			uint32_t largestFreeRange;
+			double occupancy;			// used / capacity
+			double fragmentation;		// 1 - 最大空闲区间 / 空闲总量
+		};
+
+		struct Statistics {
+			std::vector<HeapStatistics> heaps;
+			uint64_t capacityBytes = 0;
+			uint64_t usedBytes = 0;
+			uint64_t allocations = 0;				// 累计
+			uint64_t releases = 0;
+			uint64_t defragmentations = 0;
+			uint64_t bytesMovedByDefragmentation = 0;
+		};
+
+	protected:
+		Microsoft::WRL::ComPtr<ID3D11Device> device;
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+		std::mutex lock;
+		std::vector<std::shared_ptr<GeometryHeap>> heaps;
+
+		uint64_t allocationCount = 0;
+		uint64_t defragmentationCount = 0;
+		uint64_t bytesMovedByDefragmentation = 0;
+
+		PtrGeometryAllocation allocate(bool isIndexHeap, const void* data, uint32_t count, uint32_t stride);
+		void defragment(GeometryHeap& heap);
+
+	public:
+		GeometryPool(ID3D11Device* device, ID3D11DeviceContext* context) : device(device), context(context) {}
+
+		GeometryPool(const GeometryPool&) = delete;
+		void operator=(const GeometryPool&) = delete;
+
+		PtrGeometryAllocation allocateVertices(const void* vertices, uint32_t count, uint32_t stride) {
+			return allocate(false, vertices, count, stride);
+		}
+
+		PtrGeometryAllocation allocateIndices(const uint32_t* indices, uint32_t count) {
+			return allocate(true, indices, count, sizeof(uint32_t));
+		}
+
+		// 每帧开始时在渲染线程调用：整理碎片率超过阈值的 heap，释放多余的空 heap
+		// force: 只要有空洞就整理
+		void collectGarbage(bool force = false);
+
+		Statistics getStatistics();
+		std::string getReport();
+	};
+
+}
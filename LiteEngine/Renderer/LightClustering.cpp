@@ -0,0 +1,235 @@
+#include "LightClustering.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		// froxel 的边界向外扩一点：GPU 上 log 等运算的误差会把边界附近的像素分到相邻的 froxel
+		constexpr float BOUNDS_EPSILON = 1e-3f;
+
+		// 光源很少时并行的开销比构建本身还大
+		constexpr size_t MINIMUM_LIGHTS_FOR_JOBS = 32;
+
+		struct Box {
+			float min[3];
+			float max[3];
+		};
+
+		// 点到区间 [low, high] 的距离
+		float distanceToRange(float value, float low, float high) {
+			return value < low ? low - value : (value > high ? value - high : 0);
+		}
+
+		// 聚光灯的锥体与 box 的外接球是否相交（保守）。cone: cos 和 sin(outerConeAngle)
+		bool intersectsCone(const Box& box, const ClusterLight& light, std::pair<float, float> cone) {
+			if (light.outerConeAngle >= DirectX::XM_PIDIV2) return true;
+
+			float center[3], radius2 = 0;
+			for (int i = 0; i < 3; i++) {
+				center[i] = (box.min[i] + box.max[i]) / 2;
+				float half = (box.max[i] - box.min[i]) / 2;
+				radius2 += half * half;
+			}
+			float radius = std::sqrt(radius2);
+
+			float v[3] = { center[0] - light.position_V.x, center[1] - light.position_V.y, center[2] - light.position_V.z };
+			float length2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+			float along = v[0] * light.direction_V.x + v[1] * light.direction_V.y + v[2] * light.direction_V.z;
+			float across = std::sqrt(std::max(0.f, length2 - along * along));
+
+			// 球心到锥面的距离
+			float distance = cone.first * across - cone.second * along;
+			if (distance > radius) return false;
+			if (along < -radius) return false;
+			if (along > radius + light.range) return false;
+			return true;
+		}
+
+		uint32_t toTile(float ndc, uint32_t tiles) {
+			float tile = std::floor((ndc * 0.5f + 0.5f) * tiles);
+			return (uint32_t)std::clamp(tile, 0.f, (float)(tiles - 1));
+		}
+
+	}
+
+	LightClusterCamera LightClusterCamera::perspectiveCamera(float fieldOfViewYRadian, float aspectRatio, float nearZ, float farZ) {
+		LightClusterCamera out;
+		out.perspective = true;
+		out.viewScaleY = 1 / std::tan(fieldOfViewYRadian / 2);
+		out.viewScaleX = out.viewScaleY / aspectRatio;
+		out.nearZ = nearZ;
+		out.farZ = farZ;
+		return out;
+	}
+
+	LightClusterCamera LightClusterCamera::orthographicCamera(float viewWidth, float viewHeight, float nearZ, float farZ) {
+		LightClusterCamera out;
+		out.perspective = false;
+		out.viewScaleX = 2 / viewWidth;
+		out.viewScaleY = 2 / viewHeight;
+		out.nearZ = nearZ;
+		out.farZ = farZ;
+		return out;
+	}
+
+	LightClusterGrid::LightClusterGrid(uint32_t tilesX, uint32_t tilesY, uint32_t slices) :
+		tilesX(tilesX), tilesY(tilesY), slices(slices) {
+		if (tilesX == 0 || tilesY == 0 || slices == 0) {
+			throw std::runtime_error("light cluster grid must not be empty");
+		}
+	}
+
+	float LightClusterGrid::getSliceNearZ(uint32_t slice) const {
+		if (slice == 0) return camera.nearZ;
+		if (slice == slices) return camera.farZ;
+		if (camera.perspective) return std::exp((slice - zBias) / zScale);
+		return (slice - zBias) / zScale;
+	}
+
+	uint32_t LightClusterGrid::findCluster(const DirectX::XMFLOAT3& position_V) const {
+		float x = position_V.x * camera.viewScaleX;
+		float y = position_V.y * camera.viewScaleY;
+		float depth = position_V.z;
+		if (camera.perspective) {
+			float z = std::max(position_V.z, 1e-6f);
+			x /= z;
+			y /= z;
+			depth = std::log(z);
+		}
+		float slice = std::clamp(std::floor(depth * zScale + zBias), 0.f, (float)(slices - 1));
+		return getClusterIndex(toTile(x, tilesX), toTile(y, tilesY), (uint32_t)slice);
+	}
+
+	void LightClusterGrid::buildSlice(uint32_t slice, const std::vector<ClusterLight>& lights) {
+		auto& scratch = sliceScratch[slice];
+		scratch.candidates.clear();
+		scratch.hits.clear();
+
+		float z0 = getSliceNearZ(slice);
+		float z1 = getSliceNearZ(slice + 1);
+		float margin = (z1 - z0) * BOUNDS_EPSILON;
+		z0 -= margin;
+		z1 += margin;
+
+		for (uint32_t i = 0; i < (uint32_t)lights.size(); i++) {
+			auto& light = lights[i];
+			if (std::isinf(light.range) || (light.position_V.z + light.range >= z0 && light.position_V.z - light.range <= z1)) {
+				scratch.candidates.push_back(i);
+			}
+		}
+
+		// 每列（行）tile 在这个 slice 中的范围，透视时取 slice 两端中较大的
+		auto computeBounds = [&](std::vector<std::pair<float, float>>& bounds, uint32_t tiles, float scale) {
+			bounds.resize(tiles);
+			for (uint32_t i = 0; i < tiles; i++) {
+				float a0 = -1 + 2.f * i / tiles - BOUNDS_EPSILON, a1 = -1 + 2.f * (i + 1) / tiles + BOUNDS_EPSILON;
+				if (camera.perspective) {
+					bounds[i] = { std::min(a0 * z0, a0 * z1) / scale, std::max(a1 * z0, a1 * z1) / scale };
+				} else {
+					bounds[i] = { a0 / scale, a1 / scale };
+				}
+			}
+		};
+		computeBounds(scratch.boundsX, tilesX, camera.viewScaleX);
+		computeBounds(scratch.boundsY, tilesY, camera.viewScaleY);
+
+		// 光源在这个 slice 中可能覆盖的 tile：球在 x（y）方向的范围除以深度范围两端的 z，取最小和最大
+		auto tileRange = [&](float center, float radius, float scale, float zNear, float zFar, uint32_t tiles) -> std::pair<uint32_t, uint32_t> {
+			if (std::isinf(radius)) return { 0, tiles - 1 };
+			float low = (center - radius) * scale, high = (center + radius) * scale;
+			if (camera.perspective) {
+				float lowNear = low / zNear, lowFar = low / zFar, highNear = high / zNear, highFar = high / zFar;
+				low = std::min(lowNear, lowFar);
+				high = std::max(highNear, highFar);
+			}
+			return { toTile(low - BOUNDS_EPSILON, tiles), toTile(high + BOUNDS_EPSILON, tiles) };
+		};
+
+		for (auto lightID : scratch.candidates) {
+			auto& light = lights[lightID];
+			float zNear = std::max(z0, light.position_V.z - light.range);
+			float zFar = std::min(z1, light.position_V.z + light.range);
+			auto [x0, x1] = tileRange(light.position_V.x, light.range, camera.viewScaleX, zNear, zFar, tilesX);
+			auto [y0, y1] = tileRange(light.position_V.y, light.range, camera.viewScaleY, zNear, zFar, tilesY);
+
+			// 球与 box 的距离平方按坐标轴拆开累加，z 和 y 的部分在内层循环之外算好
+			bool bounded = !std::isinf(light.range);
+			float range2 = light.range * light.range;
+			float dz = distanceToRange(light.position_V.z, z0, z1);
+			for (uint32_t y = y0; y <= y1; y++) {
+				auto [yMin, yMax] = scratch.boundsY[y];
+				float dy = distanceToRange(light.position_V.y, yMin, yMax);
+				float remaining = range2 - dz * dz - dy * dy;
+				if (bounded && remaining < 0) continue;
+				for (uint32_t x = x0; x <= x1; x++) {
+					auto [xMin, xMax] = scratch.boundsX[x];
+					float dx = distanceToRange(light.position_V.x, xMin, xMax);
+					if (bounded && dx * dx > remaining) continue;
+					if (light.spot && !intersectsCone({ { xMin, yMin, z0 }, { xMax, yMax, z1 } }, light, coneAngles[lightID])) continue;
+					scratch.hits.push_back({ y * tilesX + x, lightID });
+				}
+			}
+		}
+
+		// 按 tile 计数排序。offset 先取每个 tile 的末尾，倒序填入后正好回到开头，同一个 tile 中光源的顺序不变
+		auto first = clusters.data() + (size_t)slice * tilesX * tilesY;
+		for (uint32_t tile = 0; tile < tilesX * tilesY; tile++) first[tile] = { 0, 0 };
+		for (auto& hit : scratch.hits) first[hit.first].count++;
+		uint32_t end = 0;
+		for (uint32_t tile = 0; tile < tilesX * tilesY; tile++) {
+			end += first[tile].count;
+			first[tile].offset = end;
+		}
+		scratch.indices.resize(scratch.hits.size());
+		for (auto it = scratch.hits.rbegin(); it != scratch.hits.rend(); ++it) {
+			scratch.indices[--first[it->first].offset] = it->second;
+		}
+	}
+
+	void LightClusterGrid::build(const LightClusterCamera& camera, const std::vector<ClusterLight>& lights, JobSystem* jobs) {
+		this->camera = camera;
+		if (camera.perspective) {
+			zScale = slices / std::log(camera.farZ / camera.nearZ);
+			zBias = -std::log(camera.nearZ) * zScale;
+		} else {
+			zScale = slices / (camera.farZ - camera.nearZ);
+			zBias = -camera.nearZ * zScale;
+		}
+
+		clusters.resize(getClusterCount());
+		sliceScratch.resize(slices);
+		coneAngles.resize(lights.size());
+		for (size_t i = 0; i < lights.size(); i++) {
+			if (lights[i].spot) coneAngles[i] = { std::cos(lights[i].outerConeAngle), std::sin(lights[i].outerConeAngle) };
+		}
+
+		auto buildSlices = [&](uint32_t begin, uint32_t end) {
+			for (uint32_t slice = begin; slice < end; slice++) buildSlice(slice, lights);
+		};
+		if (jobs && lights.size() >= MINIMUM_LIGHTS_FOR_JOBS) {
+			jobs->parallelFor(0, slices, 1, buildSlices);
+		} else {
+			buildSlices(0, slices);
+		}
+
+		// 拼接各个 slice 的结果
+		size_t total = 0;
+		for (auto& scratch : sliceScratch) total += scratch.indices.size();
+		lightIndices.resize(total);
+
+		uint32_t offset = 0;
+		for (uint32_t slice = 0; slice < slices; slice++) {
+			auto& indices = sliceScratch[slice].indices;
+			std::copy(indices.begin(), indices.end(), lightIndices.begin() + offset);
+			auto first = clusters.data() + (size_t)slice * tilesX * tilesY;
+			for (uint32_t tile = 0; tile < tilesX * tilesY; tile++) first[tile].offset += offset;
+			offset += (uint32_t)indices.size();
+		}
+	}
+
+}
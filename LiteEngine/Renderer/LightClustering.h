@@ -0,0 +1,111 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace LiteEngine {
+	class JobSystem;
+}
+
+namespace LiteEngine::Rendering {
+
+	// 分簇光照：视锥按屏幕上的 tile 和深度切成 froxel（透视时深度按指数分布，正交时均匀分布），
+	// 每个 froxel 记录可能照到它的光源下标，像素着色时只计算所在 froxel 的光源（见 Shader/ClusteredLights.hlsli）
+	// 这里只在 CPU 上构建，不依赖 D3D
+
+	// view space 中的光源。平行光的 range 为无穷大，出现在所有 froxel 中
+	struct ClusterLight {
+		DirectX::XMFLOAT3 position_V;
+		float range = std::numeric_limits<float>::infinity();
+		bool spot = false;
+		DirectX::XMFLOAT3 direction_V;		// spot，单位向量
+		float outerConeAngle;				// spot，与 direction_V 的夹角
+	};
+
+	// 与 hlsl 中的计算一致：
+	//   NDC 的 xy = view space 的 xy * viewScale（透视时再除以 z）
+	//   slice = log(z) * zScale + zBias（透视），z * zScale + zBias（正交）
+	struct LightClusterCamera {
+		bool perspective = true;
+		float viewScaleX;
+		float viewScaleY;
+		float nearZ;
+		float farZ;
+
+		static LightClusterCamera perspectiveCamera(float fieldOfViewYRadian, float aspectRatio, float nearZ, float farZ);
+		static LightClusterCamera orthographicCamera(float viewWidth, float viewHeight, float nearZ, float farZ);
+	};
+
+	// 一个 froxel 的光源在 LightClusterGrid::getLightIndices() 中的位置。与 hlsl 中的 uint2 对应
+	struct LightClusterRange {
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	class LightClusterGrid {
+		uint32_t tilesX;
+		uint32_t tilesY;
+		uint32_t slices;
+
+		LightClusterCamera camera{};
+		float zScale = 0;
+		float zBias = 0;
+
+		std::vector<LightClusterRange> clusters;
+		std::vector<uint32_t> lightIndices;
+
+		// 每个 slice 单独构建，之后按顺序拼接。容器在多次构建之间复用
+		struct SliceScratch {
+			std::vector<uint32_t> candidates;					// 深度范围与这个 slice 相交的光源
+			std::vector<std::pair<uint32_t, uint32_t>> hits;	// (slice 内的 tile, 光源)
+			std::vector<uint32_t> indices;
+			std::vector<std::pair<float, float>> boundsX;		// 每列 tile 在这个 slice 中的 x 范围（view space）
+			std::vector<std::pair<float, float>> boundsY;
+		};
+		std::vector<SliceScratch> sliceScratch;
+
+		// 每个光源的 cos(outerConeAngle), sin(outerConeAngle)，构建开始时计算一次
+		std::vector<std::pair<float, float>> coneAngles;
+
+		float getSliceNearZ(uint32_t slice) const;
+
+		void buildSlice(uint32_t slice, const std::vector<ClusterLight>& lights);
+
+	public:
+		// 16 x 9 x 24：16:9 的屏幕上 tile 大致是正方形
+		LightClusterGrid(uint32_t tilesX = 16, uint32_t tilesY = 9, uint32_t slices = 24);
+
+		// jobs 为空或者光源很少时在调用线程上构建，否则按 slice 并行
+		void build(const LightClusterCamera& camera, const std::vector<ClusterLight>& lights, JobSystem* jobs = nullptr);
+
+		uint32_t getTilesX() const { return tilesX; }
+		uint32_t getTilesY() const { return tilesY; }
+		uint32_t getSlices() const { return slices; }
+		uint32_t getClusterCount() const { return tilesX * tilesY * slices; }
+		float getZScale() const { return zScale; }
+		float getZBias() const { return zBias; }
+		const LightClusterCamera& getCamera() const { return camera; }
+
+		uint32_t getClusterIndex(uint32_t x, uint32_t y, uint32_t z) const {
+			return (z * tilesY + y) * tilesX + x;
+		}
+
+		// view space 中的点所在的 froxel，视锥外的点夹到边界上
+		uint32_t findCluster(const DirectX::XMFLOAT3& position_V) const;
+
+		const std::vector<LightClusterRange>& getClusters() const { return clusters; }
+		const std::vector<uint32_t>& getLightIndices() const { return lightIndices; }
+	};
+
+	// 随机生成数十到上千个点光源和聚光灯：
+	//   检查每个随机采样点所在的 froxel 包含所有照到它的光源（结果中 missing 必须为 0）
+	//   统计每个 froxel 平均的光源数，并测量单线程和多线程的构建耗时
+	// 不依赖 D3D，可以在任何平台上运行
+	std::string runLightClusteringBenchmark(uint32_t maxThreads = 0);
+
+}
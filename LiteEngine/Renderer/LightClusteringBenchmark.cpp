@@ -0,0 +1,143 @@
+#include "LightClustering.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		constexpr float FIELD_OF_VIEW_Y = DirectX::XM_PI / 3;
+		constexpr float ASPECT_RATIO = 16.f / 9;
+		constexpr float NEAR_Z = 0.1f;
+		constexpr float FAR_Z = 1000;
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		// 视锥内的随机点，深度按指数分布（与 slice 的分布一致）
+		DirectX::XMFLOAT3 randomPointInFrustum(std::mt19937& random, float minZ = NEAR_Z, float maxZ = FAR_Z) {
+			std::uniform_real_distribution<float> unit(-1, 1);
+			std::uniform_real_distribution<float> logZ(std::log(minZ), std::log(maxZ));
+			float z = std::exp(logZ(random));
+			float halfHeight = std::tan(FIELD_OF_VIEW_Y / 2) * z;
+			return { unit(random) * halfHeight * ASPECT_RATIO, unit(random) * halfHeight, z };
+		}
+
+		// 分布在相机前 1 ~ 300 m 的点光源和聚光灯各一半，另有一个平行光
+		std::vector<ClusterLight> createLights(uint32_t count, std::mt19937& random) {
+			std::uniform_real_distribution<float> range(2, 15);
+			std::uniform_real_distribution<float> unit(-1, 1);
+			std::uniform_real_distribution<float> angle(0.2f, 1.0f);
+
+			std::vector<ClusterLight> lights(count);
+			for (uint32_t i = 0; i < count; i++) {
+				auto& light = lights[i];
+				light.position_V = randomPointInFrustum(random, 1, 300);
+				light.range = range(random);
+				if (i % 2 == 1) {
+					light.spot = true;
+					float x = unit(random), y = unit(random), z = unit(random);
+					float length = std::max(1e-3f, std::sqrt(x * x + y * y + z * z));
+					light.direction_V = { x / length, y / length, z / length };
+					light.outerConeAngle = angle(random);
+				}
+			}
+			lights.push_back(ClusterLight{});
+			return lights;
+		}
+
+		bool reaches(const ClusterLight& light, const DirectX::XMFLOAT3& point) {
+			if (std::isinf(light.range)) return true;
+			float d[3] = { point.x - light.position_V.x, point.y - light.position_V.y, point.z - light.position_V.z };
+			float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			if (distance > light.range) return false;
+			if (!light.spot || distance == 0) return true;
+			float cosine = (d[0] * light.direction_V.x + d[1] * light.direction_V.y + d[2] * light.direction_V.z) / distance;
+			return cosine >= std::cos(light.outerConeAngle);
+		}
+
+		struct ClusteringResult {
+			uint32_t lights;
+			uint32_t missing = 0;				// 照到采样点、但不在其 froxel 中的光源数，必须为 0
+			double lightsPerSample = 0;			// 采样点所在 froxel 的平均光源数（像素着色要计算的光源）
+			double reachingPerSample = 0;		// 实际照到采样点的平均光源数
+			uint32_t maxLightsPerCluster = 0;
+			double singleThreadMilliseconds = 0;
+			double multiThreadMilliseconds = 0;
+		};
+
+		ClusteringResult runOnce(uint32_t count, JobSystem& jobs) {
+			constexpr uint32_t SAMPLES = 20000;
+			constexpr uint32_t REPEAT = 20;
+
+			std::mt19937 random(count);
+			auto lights = createLights(count, random);
+			auto camera = LightClusterCamera::perspectiveCamera(FIELD_OF_VIEW_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+
+			ClusteringResult result;
+			result.lights = (uint32_t)lights.size();
+
+			LightClusterGrid grid;
+			grid.build(camera, lights, &jobs);
+
+			for (uint32_t i = 0; i < SAMPLES; i++) {
+				auto point = randomPointInFrustum(random);
+				auto& cluster = grid.getClusters()[grid.findCluster(point)];
+				auto first = grid.getLightIndices().begin() + cluster.offset;
+				result.lightsPerSample += cluster.count;
+				for (uint32_t lightID = 0; lightID < (uint32_t)lights.size(); lightID++) {
+					if (!reaches(lights[lightID], point)) continue;
+					result.reachingPerSample += 1;
+					if (std::find(first, first + cluster.count, lightID) == first + cluster.count) result.missing++;
+				}
+			}
+			result.lightsPerSample /= SAMPLES;
+			result.reachingPerSample /= SAMPLES;
+			for (auto& cluster : grid.getClusters()) {
+				result.maxLightsPerCluster = std::max(result.maxLightsPerCluster, cluster.count);
+			}
+
+			auto begin = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < REPEAT; i++) grid.build(camera, lights);
+			result.singleThreadMilliseconds = millisecondsSince(begin) / REPEAT;
+
+			begin = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < REPEAT; i++) grid.build(camera, lights, &jobs);
+			result.multiThreadMilliseconds = millisecondsSince(begin) / REPEAT;
+			return result;
+		}
+
+	}
+
+	std::string runLightClusteringBenchmark(uint32_t maxThreads) {
+		if (maxThreads == 0) maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		// 调用线程也执行 job，所以工作线程数少一个
+		JobSystem jobs(maxThreads - 1);
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "light clustering: 16 x 9 x 24 froxels, 60 deg fov, z in [%.1f, %.0f], %u threads\n", NEAR_Z, FAR_Z, maxThreads);
+		out << line;
+		snprintf(line, sizeof(line), "%-8s %8s %12s %12s %12s %12s %12s %8s\n",
+			"lights", "missing", "per pixel", "reaching", "max/cluster", "1 thread ms", "N thread ms", "speedup");
+		out << line;
+		for (uint32_t count : { 16u, 64u, 256u, 1024u }) {
+			auto result = runOnce(count, jobs);
+			snprintf(line, sizeof(line), "%-8u %8u %12.2f %12.2f %12u %12.3f %12.3f %7.2fx\n",
+				result.lights, result.missing, result.lightsPerSample, result.reachingPerSample, result.maxLightsPerCluster,
+				result.singleThreadMilliseconds, result.multiThreadMilliseconds,
+				result.singleThreadMilliseconds / result.multiThreadMilliseconds);
+			out << line;
+		}
+		return out.str();
+	}
+
+}
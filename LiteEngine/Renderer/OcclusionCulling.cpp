@@ -0,0 +1,405 @@
+#include "OcclusionCulling.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		// 三角形很少时并行的开销比光栅化本身还大
+		constexpr uint64_t MINIMUM_TRIANGLES_FOR_JOBS = 256;
+
+		// 一个 chunk 中的三角形数
+		constexpr uint32_t TRIANGLES_PER_CHUNK = 256;
+
+		// 一行中同时处理的像素。只用到浮点的加、乘、最值、比较和按掩码选择
+		namespace Simd {
+#if defined(__AVX2__)
+			constexpr uint32_t LANES = 8;
+			using Float = __m256;
+			inline Float broadcast(float v) { return _mm256_set1_ps(v); }
+			inline Float load(const float* p) { return _mm256_loadu_ps(p); }
+			inline void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+			inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+			inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+			inline Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+			inline Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+			inline Float pixelCenters() { return _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f); }
+			// 三个值都不小于 0 的 lane
+			inline Float allNonNegative(Float a, Float b, Float c) {
+				auto zero = _mm256_setzero_ps();
+				return _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(a, zero, _CMP_GE_OQ), _mm256_cmp_ps(b, zero, _CMP_GE_OQ)),
+					_mm256_cmp_ps(c, zero, _CMP_GE_OQ));
+			}
+			inline bool any(Float mask) { return _mm256_movemask_ps(mask) != 0; }
+			inline Float select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+			constexpr uint32_t LANES = 4;
+			using Float = __m128;
+			inline Float broadcast(float v) { return _mm_set1_ps(v); }
+			inline Float load(const float* p) { return _mm_loadu_ps(p); }
+			inline void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+			inline Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+			inline Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+			inline Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+			inline Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+			inline Float pixelCenters() { return _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f); }
+			inline Float allNonNegative(Float a, Float b, Float c) {
+				auto zero = _mm_setzero_ps();
+				return _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(a, zero), _mm_cmpge_ps(b, zero)), _mm_cmpge_ps(c, zero));
+			}
+			inline bool any(Float mask) { return _mm_movemask_ps(mask) != 0; }
+			// SSE2 没有 blendv
+			inline Float select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+#else
+			constexpr uint32_t LANES = 1;
+			struct Float {
+				float v;
+			};
+			inline Float broadcast(float v) { return { v }; }
+			inline Float load(const float* p) { return { *p }; }
+			inline void store(float* p, Float v) { *p = v.v; }
+			inline Float add(Float a, Float b) { return { a.v + b.v }; }
+			inline Float mul(Float a, Float b) { return { a.v * b.v }; }
+			inline Float min(Float a, Float b) { return { std::min(a.v, b.v) }; }
+			inline Float max(Float a, Float b) { return { std::max(a.v, b.v) }; }
+			inline Float pixelCenters() { return { 0.5f }; }
+			inline Float allNonNegative(Float a, Float b, Float c) { return { a.v >= 0 && b.v >= 0 && c.v >= 0 ? 1.f : 0.f }; }
+			inline bool any(Float mask) { return mask.v != 0; }
+			inline Float select(Float mask, Float a, Float b) { return mask.v != 0 ? a : b; }
+#endif
+
+			inline float horizontalMax(Float v) {
+				float lanes[LANES];
+				store(lanes, v);
+				return *std::max_element(lanes, lanes + LANES);
+			}
+		}
+
+		static_assert(OcclusionBuffer::TILE_WIDTH % Simd::LANES == 0 && OcclusionBuffer::BLOCK_WIDTH % Simd::LANES == 0,
+			"tiles and blocks must hold whole SIMD rows");
+		static_assert(OcclusionBuffer::TILE_WIDTH % OcclusionBuffer::BLOCK_WIDTH == 0 &&
+			OcclusionBuffer::TILE_HEIGHT % OcclusionBuffer::BLOCK_HEIGHT == 0, "tiles must hold whole blocks");
+
+		struct ClipVertex {
+			float x, y, z, w;
+		};
+
+		// 行向量乘矩阵
+		ClipVertex transform(const DirectX::XMFLOAT3& p, const DirectX::XMFLOAT4X4& m) {
+			return {
+				p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+				p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+				p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2],
+				p.x * m.m[0][3] + p.y * m.m[1][3] + p.z * m.m[2][3] + m.m[3][3],
+			};
+		}
+
+		// 视锥的各个平面，第 i 位为 1 表示在第 i 个平面之外
+		uint32_t getOutcode(const ClipVertex& v) {
+			return (v.x < -v.w ? 1 : 0) | (v.x > v.w ? 2 : 0) | (v.y < -v.w ? 4 : 0) | (v.y > v.w ? 8 : 0) |
+				(v.z < 0 ? 16 : 0) | (v.z > v.w ? 32 : 0);
+		}
+
+		// 像素中心 x + 0.5 落在 [low, high] 中的像素范围
+		int32_t firstPixel(float low) {
+			return (int32_t)std::ceil(low - 0.5f);
+		}
+
+		int32_t lastPixel(float high) {
+			return (int32_t)std::floor(high - 0.5f);
+		}
+
+	}
+
+	OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) : width(width), height(height) {
+		if (width == 0 || height == 0 || width % TILE_WIDTH != 0 || height % TILE_HEIGHT != 0) {
+			throw std::runtime_error("occlusion buffer size must be a positive multiple of the tile size");
+		}
+		tilesX = width / TILE_WIDTH;
+		tilesY = height / TILE_HEIGHT;
+		depth.resize((size_t)width * height);
+		blockMaxDepth.resize((size_t)(width / BLOCK_WIDTH) * (height / BLOCK_HEIGHT));
+		tileMaxDepth.resize((size_t)tilesX * tilesY);
+		clear();
+	}
+
+	void OcclusionBuffer::clear() {
+		std::fill(depth.begin(), depth.end(), 1.f);
+		std::fill(blockMaxDepth.begin(), blockMaxDepth.end(), 1.f);
+		std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.f);
+		occluders.clear();
+		statistics = Statistics();
+	}
+
+	void OcclusionBuffer::addOccluder(const OccluderMesh& mesh, const DirectX::XMFLOAT4X4& trans_L2C) {
+		if (mesh.indices.size() < 3) return;
+		occluders.push_back({ &mesh, trans_L2C });
+		statistics.occluders++;
+		statistics.triangles += mesh.indices.size() / 3;
+	}
+
+	void OcclusionBuffer::binTriangle(Chunk& chunk, const ScreenTriangle& input) {
+		auto triangle = input;
+		float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+			(triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+		if (!(area != 0)) return;
+		// 统一成正的面积，光栅化时不必区分正反面（遮挡体不做背面剔除）
+		if (area < 0) {
+			std::swap(triangle.x[1], triangle.x[2]);
+			std::swap(triangle.y[1], triangle.y[2]);
+			std::swap(triangle.z[1], triangle.z[2]);
+		}
+
+		auto [minX, maxX] = std::minmax({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		auto [minY, maxY] = std::minmax({ triangle.y[0], triangle.y[1], triangle.y[2] });
+		int32_t x0 = std::max(0, firstPixel(std::max(minX, -1.f)));
+		int32_t x1 = std::min((int32_t)width - 1, lastPixel(std::min(maxX, (float)width + 1)));
+		int32_t y0 = std::max(0, firstPixel(std::max(minY, -1.f)));
+		int32_t y1 = std::min((int32_t)height - 1, lastPixel(std::min(maxY, (float)height + 1)));
+		if (x0 > x1 || y0 > y1) return;
+
+		auto index = (uint32_t)chunk.triangles.size();
+		chunk.triangles.push_back(triangle);
+		for (uint32_t ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++) {
+			for (uint32_t tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++) {
+				chunk.bins[ty * tilesX + tx].push_back(index);
+			}
+		}
+	}
+
+	void OcclusionBuffer::setupChunk(Chunk& chunk) {
+		chunk.triangles.clear();
+		chunk.bins.resize((size_t)tilesX * tilesY);
+		for (auto& bin : chunk.bins) bin.clear();
+
+		auto& occluder = occluders[chunk.occluder];
+		auto& positions = occluder.mesh->positions;
+		auto& indices = occluder.mesh->indices;
+
+		auto toScreen = [this](const ClipVertex& v, ScreenTriangle& out, int i) {
+			float invW = 1 / v.w;
+			out.x[i] = (v.x * invW * 0.5f + 0.5f) * width;
+			out.y[i] = (0.5f - v.y * invW * 0.5f) * height;
+			out.z[i] = std::max(0.f, v.z * invW);
+		};
+
+		for (uint32_t t = chunk.firstTriangle; t < chunk.lastTriangle; t++) {
+			ClipVertex v[3];
+			uint32_t outcodeAnd = ~0u, outcodeOr = 0;
+			bool valid = true;
+			for (int i = 0; i < 3; i++) {
+				auto index = indices[(size_t)t * 3 + i];
+				if (index >= positions.size()) {
+					valid = false;
+					break;
+				}
+				v[i] = transform(positions[index], occluder.trans_L2C);
+				auto outcode = getOutcode(v[i]);
+				outcodeAnd &= outcode;
+				outcodeOr |= outcode;
+			}
+			// 全部在同一个平面之外
+			if (!valid || outcodeAnd != 0) continue;
+
+			// 与近平面（z = 0）相交时裁剪成一个四边形或者三角形，再按扇形拆开
+			ClipVertex polygon[4];
+			int count = 0;
+			if (outcodeOr & 16) {
+				for (int i = 0; i < 3; i++) {
+					auto& a = v[i];
+					auto& b = v[(i + 1) % 3];
+					if (a.z >= 0) polygon[count++] = a;
+					if ((a.z >= 0) != (b.z >= 0)) {
+						float s = a.z / (a.z - b.z);
+						polygon[count++] = {
+							a.x + (b.x - a.x) * s, a.y + (b.y - a.y) * s, 0, a.w + (b.w - a.w) * s
+						};
+					}
+				}
+			} else {
+				std::copy(v, v + 3, polygon);
+				count = 3;
+			}
+			if (std::any_of(polygon, polygon + count, [](const ClipVertex& p) { return !(p.w > 0); })) continue;
+
+			for (int i = 1; i + 1 < count; i++) {
+				ScreenTriangle triangle;
+				toScreen(polygon[0], triangle, 0);
+				toScreen(polygon[i], triangle, 1);
+				toScreen(polygon[i + 1], triangle, 2);
+				binTriangle(chunk, triangle);
+			}
+		}
+	}
+
+	void OcclusionBuffer::rasterizeTile(uint32_t tile) {
+		uint32_t tileX0 = (tile % tilesX) * TILE_WIDTH;
+		uint32_t tileY0 = (tile / tilesX) * TILE_HEIGHT;
+		auto centers = Simd::pixelCenters();
+
+		for (uint32_t c = 0; c < chunkCount; c++) {
+			auto& chunk = chunks[c];
+			for (auto index : chunk.bins[tile]) {
+				auto& t = chunk.triangles[index];
+
+				// 边 i 从顶点 i 到 i + 1，E(p) = a * (p.x - x_i) + b * (p.y - y_i)，三角形内部三条边都不小于 0
+				float a[3], b[3];
+				for (int i = 0; i < 3; i++) {
+					int j = (i + 1) % 3;
+					a[i] = t.y[i] - t.y[j];
+					b[i] = t.x[j] - t.x[i];
+				}
+
+				// 深度平面 z = z_0 + dzdx * (x - x_0) + dzdy * (y - y_0)。插值结果夹到最近的顶点深度，不会比三角形更近
+				float area = b[0] * (t.y[2] - t.y[0]) + a[0] * (t.x[2] - t.x[0]);
+				float dz1 = t.z[1] - t.z[0], dz2 = t.z[2] - t.z[0];
+				float dzdx = (dz1 * (t.y[2] - t.y[0]) - dz2 * (t.y[1] - t.y[0])) / area;
+				float dzdy = (dz2 * (t.x[1] - t.x[0]) - dz1 * (t.x[2] - t.x[0])) / area;
+				float zMin = std::min({ t.z[0], t.z[1], t.z[2] });
+
+				auto [minX, maxX] = std::minmax({ t.x[0], t.x[1], t.x[2] });
+				auto [minY, maxY] = std::minmax({ t.y[0], t.y[1], t.y[2] });
+				int32_t x0 = std::max((int32_t)tileX0, firstPixel(std::max(minX, -1.f)));
+				int32_t x1 = std::min((int32_t)(tileX0 + TILE_WIDTH - 1), lastPixel(std::min(maxX, (float)width + 1)));
+				int32_t y0 = std::max((int32_t)tileY0, firstPixel(std::max(minY, -1.f)));
+				int32_t y1 = std::min((int32_t)(tileY0 + TILE_HEIGHT - 1), lastPixel(std::min(maxY, (float)height + 1)));
+				if (x0 > x1 || y0 > y1) continue;
+				x0 -= x0 % Simd::LANES;
+
+				auto a0 = Simd::broadcast(a[0]), a1 = Simd::broadcast(a[1]), a2 = Simd::broadcast(a[2]);
+				auto vdzdx = Simd::broadcast(dzdx);
+				auto vzMin = Simd::broadcast(zMin);
+				for (int32_t y = y0; y <= y1; y++) {
+					float py = y + 0.5f;
+					// 与 x 无关的部分：E = a * p.x + (b * (p.y - y_i) - a * x_i)
+					auto r0 = Simd::broadcast(b[0] * (py - t.y[0]) - a[0] * t.x[0]);
+					auto r1 = Simd::broadcast(b[1] * (py - t.y[1]) - a[1] * t.x[1]);
+					auto r2 = Simd::broadcast(b[2] * (py - t.y[2]) - a[2] * t.x[2]);
+					auto zRow = Simd::broadcast(t.z[0] + dzdy * (py - t.y[0]) - dzdx * t.x[0]);
+					float* row = depth.data() + (size_t)y * width;
+
+					for (int32_t x = x0; x <= x1; x += Simd::LANES) {
+						auto px = Simd::add(Simd::broadcast((float)x), centers);
+						auto inside = Simd::allNonNegative(
+							Simd::add(Simd::mul(a0, px), r0), Simd::add(Simd::mul(a1, px), r1), Simd::add(Simd::mul(a2, px), r2));
+						if (!Simd::any(inside)) continue;
+						auto z = Simd::max(Simd::add(Simd::mul(vdzdx, px), zRow), vzMin);
+						auto old = Simd::load(row + x);
+						Simd::store(row + x, Simd::select(inside, Simd::min(old, z), old));
+					}
+				}
+			}
+		}
+
+		// 分层深度：block 和 tile 中最远的深度
+		uint32_t blocksPerRow = width / BLOCK_WIDTH;
+		float tileMax = 0;
+		for (uint32_t by = tileY0 / BLOCK_HEIGHT; by < (tileY0 + TILE_HEIGHT) / BLOCK_HEIGHT; by++) {
+			for (uint32_t bx = tileX0 / BLOCK_WIDTH; bx < (tileX0 + TILE_WIDTH) / BLOCK_WIDTH; bx++) {
+				auto blockMax = Simd::broadcast(0);
+				for (uint32_t y = by * BLOCK_HEIGHT; y < (by + 1) * BLOCK_HEIGHT; y++) {
+					const float* row = depth.data() + (size_t)y * width;
+					for (uint32_t x = bx * BLOCK_WIDTH; x < (bx + 1) * BLOCK_WIDTH; x += Simd::LANES) {
+						blockMax = Simd::max(blockMax, Simd::load(row + x));
+					}
+				}
+				float value = Simd::horizontalMax(blockMax);
+				blockMaxDepth[(size_t)by * blocksPerRow + bx] = value;
+				tileMax = std::max(tileMax, value);
+			}
+		}
+		tileMaxDepth[tile] = tileMax;
+	}
+
+	void OcclusionBuffer::render(JobSystem* jobs) {
+		chunkCount = 0;
+		for (uint32_t i = 0; i < (uint32_t)occluders.size(); i++) {
+			auto triangles = (uint32_t)(occluders[i].mesh->indices.size() / 3);
+			for (uint32_t first = 0; first < triangles; first += TRIANGLES_PER_CHUNK) {
+				if (chunkCount == chunks.size()) chunks.emplace_back();
+				auto& chunk = chunks[chunkCount++];
+				chunk.occluder = i;
+				chunk.firstTriangle = first;
+				chunk.lastTriangle = std::min(triangles, first + TRIANGLES_PER_CHUNK);
+			}
+		}
+
+		auto setup = [this](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) setupChunk(chunks[i]);
+		};
+		auto rasterize = [this](uint32_t begin, uint32_t end) {
+			for (uint32_t tile = begin; tile < end; tile++) rasterizeTile(tile);
+		};
+		if (jobs && statistics.triangles >= MINIMUM_TRIANGLES_FOR_JOBS) {
+			jobs->parallelFor(0, chunkCount, 1, setup);
+			jobs->parallelFor(0, tilesX * tilesY, 1, rasterize);
+		} else {
+			setup(0, chunkCount);
+			rasterize(0, tilesX * tilesY);
+		}
+
+		statistics.rasterizedTriangles = 0;
+		statistics.binnedTriangles = 0;
+		for (uint32_t i = 0; i < chunkCount; i++) {
+			statistics.rasterizedTriangles += chunks[i].triangles.size();
+			for (auto& bin : chunks[i].bins) statistics.binnedTriangles += bin.size();
+		}
+	}
+
+	bool OcclusionBuffer::isVisible(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents,
+		const DirectX::XMFLOAT4X4& trans_L2C) const {
+		float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f, minZ = 1e30f;
+		for (int i = 0; i < 8; i++) {
+			DirectX::XMFLOAT3 corner{
+				center.x + (i & 1 ? extents.x : -extents.x),
+				center.y + (i & 2 ? extents.y : -extents.y),
+				center.z + (i & 4 ? extents.z : -extents.z),
+			};
+			auto v = transform(corner, trans_L2C);
+			// 有一个角在近平面之前（或相机之后），投影没有意义
+			if (!(v.w > 1e-6f) || v.z < 0) return true;
+			float invW = 1 / v.w;
+			minX = std::min(minX, v.x * invW);
+			maxX = std::max(maxX, v.x * invW);
+			minY = std::min(minY, v.y * invW);
+			maxY = std::max(maxY, v.y * invW);
+			minZ = std::min(minZ, v.z * invW);
+		}
+		if (maxX < -1 || minX > 1 || maxY < -1 || minY > 1 || minZ > 1) return false;
+
+		// 包围盒覆盖到的像素（部分覆盖也算）
+		auto toPixel = [](float ndc, uint32_t size) {
+			return (uint32_t)std::clamp(std::floor((ndc * 0.5f + 0.5f) * size), 0.f, (float)(size - 1));
+		};
+		uint32_t x0 = toPixel(minX, width), x1 = toPixel(maxX, width);
+		uint32_t y0 = toPixel(-maxY, height), y1 = toPixel(-minY, height);
+
+		uint32_t blocksPerRow = width / BLOCK_WIDTH;
+		for (uint32_t ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++) {
+			for (uint32_t tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++) {
+				// 整个 tile 都比包围盒近
+				if (tileMaxDepth[ty * tilesX + tx] < minZ) continue;
+
+				uint32_t bx0 = std::max(x0, tx * TILE_WIDTH) / BLOCK_WIDTH;
+				uint32_t bx1 = std::min(x1, (tx + 1) * TILE_WIDTH - 1) / BLOCK_WIDTH;
+				uint32_t by0 = std::max(y0, ty * TILE_HEIGHT) / BLOCK_HEIGHT;
+				uint32_t by1 = std::min(y1, (ty + 1) * TILE_HEIGHT - 1) / BLOCK_HEIGHT;
+				for (uint32_t by = by0; by <= by1; by++) {
+					for (uint32_t bx = bx0; bx <= bx1; bx++) {
+						if (blockMaxDepth[(size_t)by * blocksPerRow + bx] >= minZ) return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+}
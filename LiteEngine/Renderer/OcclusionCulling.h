@@ -0,0 +1,112 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LiteEngine {
+	class JobSystem;
+}
+
+namespace LiteEngine::Rendering {
+
+	// 软件遮挡剔除：在 CPU 上把少量大的遮挡体光栅化到一张低分辨率的深度图（D3D 的 NDC z，近处小），
+	// 再把物体包围盒投影到屏幕上，用它的最近深度与覆盖到的像素块中最远的深度比较，被完全挡住的物体不提交
+	// 光栅化先把三角形按 tile 分箱，再按 tile 并行，一次处理一行中相邻的几个像素（SSE 4 个，定义了 __AVX2__ 时 8 个）
+	// 这里只在 CPU 上计算，不依赖 D3D
+
+	// 遮挡体的三角形，通常是加载时简化得到的代理（见 IO::OcclusionOptions）
+	// 代理不能超出原 mesh 的表面，否则会挡住实际可见的物体
+	struct OccluderMesh {
+		std::vector<DirectX::XMFLOAT3> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	class OcclusionBuffer {
+	public:
+		// tile 是分箱和并行的单位，block 是分层深度的单位。tile 的宽度必须是 SIMD 宽度（最大为 8）的倍数
+		static constexpr uint32_t TILE_WIDTH = 32;
+		static constexpr uint32_t TILE_HEIGHT = 16;
+		static constexpr uint32_t BLOCK_WIDTH = 8;
+		static constexpr uint32_t BLOCK_HEIGHT = 4;
+
+		struct Statistics {
+			uint32_t occluders = 0;
+			uint64_t triangles = 0;				// 提交的遮挡体三角形
+			uint64_t rasterizedTriangles = 0;	// 剔除和近平面裁剪之后覆盖了至少一个像素的（裁剪可能把一个分成两个）
+			uint64_t binnedTriangles = 0;		// 各个 tile 中的三角形数之和
+		};
+
+	private:
+		uint32_t width;
+		uint32_t height;
+		uint32_t tilesX;
+		uint32_t tilesY;
+
+		std::vector<float> depth;				// 每个像素最近的深度，清除为 1（远平面）
+		std::vector<float> blockMaxDepth;		// 每个 block 中最远的深度
+		std::vector<float> tileMaxDepth;		// 每个 tile 中最远的深度
+
+		struct Occluder {
+			const OccluderMesh* mesh;
+			DirectX::XMFLOAT4X4 trans_L2C;
+		};
+		std::vector<Occluder> occluders;
+
+		// 屏幕空间（像素，y 向下）的三角形，z 是 NDC 深度
+		struct ScreenTriangle {
+			float x[3];
+			float y[3];
+			float z[3];
+		};
+
+		// 一段连续的三角形由一个 job 变换、裁剪和分箱，结果只写到自己的 bins 中，不需要同步
+		// 光栅化一个 tile 时按顺序遍历所有 chunk 在这个 tile 中的三角形。容器在多次 render 之间复用
+		struct Chunk {
+			uint32_t occluder;
+			uint32_t firstTriangle;
+			uint32_t lastTriangle;
+			std::vector<ScreenTriangle> triangles;
+			std::vector<std::vector<uint32_t>> bins;	// 每个 tile 一项，triangles 中的下标
+		};
+		std::vector<Chunk> chunks;
+		uint32_t chunkCount = 0;
+
+		Statistics statistics;
+
+		void setupChunk(Chunk& chunk);
+		void binTriangle(Chunk& chunk, const ScreenTriangle& triangle);
+		void rasterizeTile(uint32_t tile);
+
+	public:
+		// width 必须是 TILE_WIDTH 的倍数，height 必须是 TILE_HEIGHT 的倍数。宽高比不必与屏幕相同
+		OcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+
+		// 清除深度和遮挡体
+		void clear();
+
+		// trans_L2C：局部空间到裁剪空间，行向量（与 DirectXMath 一致）。render 之前 mesh 必须一直有效
+		void addOccluder(const OccluderMesh& mesh, const DirectX::XMFLOAT4X4& trans_L2C);
+
+		// 光栅化 clear 之后添加的所有遮挡体。jobs 为空或者三角形很少时在调用线程上完成
+		void render(JobSystem* jobs = nullptr);
+
+		// 局部空间的包围盒（中心和半边长）是否可能可见。包围盒与近平面相交时总是可见，完全在视锥之外时不可见
+		// 只读，可以在多个线程同时调用
+		bool isVisible(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents, const DirectX::XMFLOAT4X4& trans_L2C) const;
+
+		uint32_t getWidth() const { return width; }
+		uint32_t getHeight() const { return height; }
+		const std::vector<float>& getDepth() const { return depth; }
+		const Statistics& getStatistics() const { return statistics; }
+	};
+
+	// 一个大球（星球）和一片长方体（建筑）两种遮挡体，分别剔除数千个随机放置的包围盒：
+	//   用解析的光线求交在包围盒表面采样，检查被剔除的包围盒确实不可见（wrongly culled 应当为 0 或极少，只来自亚像素的轮廓，超过 1% 时抛出异常）
+	//   测量单线程和多线程光栅化的耗时，以及每个包围盒的测试耗时
+	// 不依赖 D3D，可以在任何平台上运行
+	std::string runOcclusionCullingBenchmark(uint32_t maxThreads = 0);
+
+}
@@ -0,0 +1,314 @@
+#include "OcclusionCulling.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		constexpr float FIELD_OF_VIEW_Y = DirectX::XM_PI / 3;
+		constexpr float ASPECT_RATIO = 16.f / 9;
+		constexpr float NEAR_Z = 0.1f;
+		constexpr float FAR_Z = 1000;
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		DirectX::XMFLOAT4X4 multiply(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b) {
+			DirectX::XMFLOAT4X4 out;
+			for (int i = 0; i < 4; i++) {
+				for (int j = 0; j < 4; j++) {
+					out.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+				}
+			}
+			return out;
+		}
+
+		// 先缩放再平移（行向量）
+		DirectX::XMFLOAT4X4 scaleTranslation(const DirectX::XMFLOAT3& scale, const DirectX::XMFLOAT3& translation) {
+			DirectX::XMFLOAT4X4 out{};
+			out.m[0][0] = scale.x;
+			out.m[1][1] = scale.y;
+			out.m[2][2] = scale.z;
+			out.m[3][0] = translation.x;
+			out.m[3][1] = translation.y;
+			out.m[3][2] = translation.z;
+			out.m[3][3] = 1;
+			return out;
+		}
+
+		// 与 XMMatrixPerspectiveFovLH 相同。相机在原点看向 +z，view space 即世界空间
+		DirectX::XMFLOAT4X4 getProjection() {
+			float yScale = 1 / std::tan(FIELD_OF_VIEW_Y / 2);
+			DirectX::XMFLOAT4X4 out{};
+			out.m[0][0] = yScale / ASPECT_RATIO;
+			out.m[1][1] = yScale;
+			out.m[2][2] = FAR_Z / (FAR_Z - NEAR_Z);
+			out.m[2][3] = 1;
+			out.m[3][2] = -NEAR_Z * FAR_Z / (FAR_Z - NEAR_Z);
+			return out;
+		}
+
+		bool insideFrustum(const DirectX::XMFLOAT3& p) {
+			float tanY = std::tan(FIELD_OF_VIEW_Y / 2);
+			return p.z >= NEAR_Z && p.z <= FAR_Z && std::abs(p.x) <= p.z * tanY * ASPECT_RATIO && std::abs(p.y) <= p.z * tanY;
+		}
+
+		std::shared_ptr<OccluderMesh> createSphere(uint32_t rings, uint32_t segments) {
+			std::shared_ptr<OccluderMesh> mesh(new OccluderMesh());
+			for (uint32_t i = 0; i <= rings; i++) {
+				float theta = DirectX::XM_PI * i / rings;
+				for (uint32_t j = 0; j < segments; j++) {
+					float phi = 2 * DirectX::XM_PI * j / segments;
+					mesh->positions.push_back({ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+				}
+			}
+			for (uint32_t i = 0; i < rings; i++) {
+				for (uint32_t j = 0; j < segments; j++) {
+					uint32_t a = i * segments + j, b = i * segments + (j + 1) % segments;
+					uint32_t c = a + segments, d = b + segments;
+					if (i > 0) mesh->indices.insert(mesh->indices.end(), { a, b, c });
+					if (i + 1 < rings) mesh->indices.insert(mesh->indices.end(), { b, d, c });
+				}
+			}
+			return mesh;
+		}
+
+		// [-1, 1]^3
+		std::shared_ptr<OccluderMesh> createCube() {
+			std::shared_ptr<OccluderMesh> mesh(new OccluderMesh());
+			for (int i = 0; i < 8; i++) {
+				mesh->positions.push_back({ i & 1 ? 1.f : -1.f, i & 2 ? 1.f : -1.f, i & 4 ? 1.f : -1.f });
+			}
+			mesh->indices = {
+				0, 2, 1, 1, 2, 3,	4, 5, 6, 5, 7, 6,
+				0, 1, 4, 1, 5, 4,	2, 6, 3, 3, 6, 7,
+				0, 4, 2, 2, 4, 6,	1, 3, 5, 3, 7, 5,
+			};
+			return mesh;
+		}
+
+		struct Box {
+			DirectX::XMFLOAT3 center;
+			DirectX::XMFLOAT3 extents;
+		};
+
+		// 场景中的遮挡体，以及用于对照的解析形状
+		struct Scene {
+			const char* name;
+			std::vector<std::pair<std::shared_ptr<OccluderMesh>, DirectX::XMFLOAT4X4>> occluders;	// mesh, 局部空间到世界空间
+			std::vector<std::pair<DirectX::XMFLOAT3, float>> spheres;
+			std::vector<Box> boxes;
+			std::vector<Box> tests;
+		};
+
+		// 从原点到 p 的线段（不含 p 附近）是否穿过某个遮挡体
+		bool isBlocked(const Scene& scene, const DirectX::XMFLOAT3& p) {
+			constexpr float END = 1 - 1e-4f;
+			for (auto& [center, radius] : scene.spheres) {
+				float a = p.x * p.x + p.y * p.y + p.z * p.z;
+				float b = -2 * (p.x * center.x + p.y * center.y + p.z * center.z);
+				float c = center.x * center.x + center.y * center.y + center.z * center.z - radius * radius;
+				float discriminant = b * b - 4 * a * c;
+				if (discriminant < 0) continue;
+				float t = (-b - std::sqrt(discriminant)) / (2 * a);
+				if (t > 0 && t < END) return true;
+			}
+			for (auto& box : scene.boxes) {
+				float t0 = 0, t1 = END;
+				const float origin[3] = { 0, 0, 0 }, direction[3] = { p.x, p.y, p.z };
+				const float low[3] = { box.center.x - box.extents.x, box.center.y - box.extents.y, box.center.z - box.extents.z };
+				const float high[3] = { box.center.x + box.extents.x, box.center.y + box.extents.y, box.center.z + box.extents.z };
+				for (int i = 0; i < 3 && t0 <= t1; i++) {
+					if (direction[i] == 0) {
+						if (origin[i] < low[i] || origin[i] > high[i]) t1 = -1;
+						continue;
+					}
+					float a = (low[i] - origin[i]) / direction[i], b = (high[i] - origin[i]) / direction[i];
+					t0 = std::max(t0, std::min(a, b));
+					t1 = std::min(t1, std::max(a, b));
+				}
+				if (t0 <= t1) return true;
+			}
+			return false;
+		}
+
+		// 在包围盒每个面上取 SAMPLES x SAMPLES 个点，有一个在视锥内且没有被挡住就算可见
+		bool isReferenceVisible(const Scene& scene, const Box& box) {
+			constexpr int SAMPLES = 4;
+			for (int axis = 0; axis < 3; axis++) {
+				for (float side : { -1.f, 1.f }) {
+					for (int i = 0; i < SAMPLES; i++) {
+						for (int j = 0; j < SAMPLES; j++) {
+							float uv[2] = { -1 + 2.f * i / (SAMPLES - 1), -1 + 2.f * j / (SAMPLES - 1) };
+							float offset[3];
+							offset[axis] = side;
+							offset[(axis + 1) % 3] = uv[0];
+							offset[(axis + 2) % 3] = uv[1];
+							DirectX::XMFLOAT3 p{
+								box.center.x + offset[0] * box.extents.x,
+								box.center.y + offset[1] * box.extents.y,
+								box.center.z + offset[2] * box.extents.z,
+							};
+							if (insideFrustum(p) && !isBlocked(scene, p)) return true;
+						}
+					}
+				}
+			}
+			return false;
+		}
+
+		// 相机前的视锥中随机放置的包围盒
+		std::vector<Box> createTests(uint32_t count, std::mt19937& random, float minZ, float maxZ, float minY, float maxY) {
+			std::uniform_real_distribution<float> unit(-1, 1);
+			std::uniform_real_distribution<float> depth(minZ, maxZ);
+			std::uniform_real_distribution<float> height(minY, maxY);
+			std::uniform_real_distribution<float> size(0.5f, 4);
+			float tanY = std::tan(FIELD_OF_VIEW_Y / 2);
+			std::vector<Box> tests(count);
+			for (auto& box : tests) {
+				float z = depth(random);
+				box.center = { unit(random) * z * tanY * ASPECT_RATIO, height(random), z };
+				box.extents = { size(random), size(random), size(random) };
+			}
+			return tests;
+		}
+
+		// 着陆时的画面：视野中央是一颗大的星球，背后和周围有许多小物体
+		Scene createPlanetScene(std::mt19937& random) {
+			Scene scene;
+			scene.name = "planet";
+			DirectX::XMFLOAT3 center{ 20, -10, 300 };
+			float radius = 150;
+			scene.occluders.push_back({ createSphere(24, 48), scaleTranslation({ radius, radius, radius }, center) });
+			scene.spheres.push_back({ center, radius });
+			float tanY = std::tan(FIELD_OF_VIEW_Y / 2);
+			scene.tests = createTests(4000, random, 10, 900, -500 * tanY, 500 * tanY);
+			// 星球里面的物体不算
+			scene.tests.erase(std::remove_if(scene.tests.begin(), scene.tests.end(), [&](const Box& box) {
+				float d[3] = { box.center.x - center.x, box.center.y - center.y, box.center.z - center.z };
+				return std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) < radius;
+			}), scene.tests.end());
+			return scene;
+		}
+
+		// 站在地面上看一片建筑，后排的大多被前排挡住
+		Scene createCityScene(std::mt19937& random) {
+			Scene scene;
+			scene.name = "city";
+			auto cube = createCube();
+			std::uniform_real_distribution<float> height(5, 30);
+			std::uniform_real_distribution<float> width(4, 9);
+			constexpr float GROUND = -2;
+			for (int i = 0; i < 16; i++) {
+				for (int j = 0; j < 16; j++) {
+					Box building;
+					float h = height(random);
+					building.extents = { width(random), h / 2, width(random) };
+					building.center = { -240 + 32.f * i, GROUND + h / 2, 20 + 24.f * j };
+					scene.boxes.push_back(building);
+					scene.occluders.push_back({ cube, scaleTranslation(building.extents, building.center) });
+				}
+			}
+			scene.tests = createTests(4000, random, 5, 500, GROUND + 1, GROUND + 8);
+			return scene;
+		}
+
+		struct CullingResult {
+			uint64_t triangles = 0;
+			uint32_t tests = 0;
+			uint32_t visible = 0;				// 参考结果中可见的
+			uint32_t culled = 0;
+			uint32_t wronglyCulled = 0;			// 被剔除但参考结果中可见，应当为 0 或极少
+			double singleThreadMilliseconds = 0;
+			double multiThreadMilliseconds = 0;
+			double nanosecondsPerTest = 0;
+		};
+
+		CullingResult runScene(const Scene& scene, OcclusionBuffer& buffer, JobSystem& jobs) {
+			constexpr uint32_t REPEAT = 50;
+			auto projection = getProjection();
+
+			auto render = [&](JobSystem* jobs) {
+				buffer.clear();
+				for (auto& [mesh, trans_L2W] : scene.occluders) {
+					buffer.addOccluder(*mesh, multiply(trans_L2W, projection));
+				}
+				buffer.render(jobs);
+			};
+
+			CullingResult result;
+			auto begin = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < REPEAT; i++) render(nullptr);
+			result.singleThreadMilliseconds = millisecondsSince(begin) / REPEAT;
+
+			begin = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < REPEAT; i++) render(&jobs);
+			result.multiThreadMilliseconds = millisecondsSince(begin) / REPEAT;
+			result.triangles = buffer.getStatistics().triangles;
+
+			// 包围盒在世界空间中，局部空间到裁剪空间就是投影矩阵
+			std::vector<uint8_t> visible(scene.tests.size());
+			begin = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < REPEAT; i++) {
+				for (size_t j = 0; j < scene.tests.size(); j++) {
+					visible[j] = buffer.isVisible(scene.tests[j].center, scene.tests[j].extents, projection);
+				}
+			}
+			result.nanosecondsPerTest = millisecondsSince(begin) * 1e6 / REPEAT / scene.tests.size();
+
+			result.tests = (uint32_t)scene.tests.size();
+			for (size_t j = 0; j < scene.tests.size(); j++) {
+				bool reference = isReferenceVisible(scene, scene.tests[j]);
+				result.visible += reference;
+				result.culled += !visible[j];
+				result.wronglyCulled += !visible[j] && reference;
+			}
+			return result;
+		}
+
+	}
+
+	std::string runOcclusionCullingBenchmark(uint32_t maxThreads) {
+		if (maxThreads == 0) maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		// 调用线程也执行 job，所以工作线程数少一个
+		JobSystem jobs(maxThreads - 1);
+		OcclusionBuffer buffer;
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "occlusion culling: %u x %u depth buffer, 60 deg fov, z in [%.1f, %.0f], %u threads\n",
+			buffer.getWidth(), buffer.getHeight(), NEAR_Z, FAR_Z, maxThreads);
+		out << line;
+		snprintf(line, sizeof(line), "%-8s %10s %8s %8s %8s %8s %12s %12s %8s %10s\n",
+			"scene", "triangles", "boxes", "visible", "culled", "wrongly", "1 thread ms", "N thread ms", "speedup", "ns/test");
+		out << line;
+
+		std::mt19937 random(49);
+		for (auto& scene : { createPlanetScene(random), createCityScene(random) }) {
+			auto result = runScene(scene, buffer, jobs);
+			snprintf(line, sizeof(line), "%-8s %10llu %8u %8u %8u %8u %12.3f %12.3f %7.2fx %10.1f\n",
+				scene.name, (unsigned long long)result.triangles, result.tests, result.visible, result.culled, result.wronglyCulled,
+				result.singleThreadMilliseconds, result.multiThreadMilliseconds,
+				result.singleThreadMilliseconds / result.multiThreadMilliseconds, result.nanosecondsPerTest);
+			out << line;
+
+			// 亚像素的轮廓之外不应当有错误的剔除，留出 1% 的余量
+			if (result.wronglyCulled > result.tests / 100) {
+				throw std::runtime_error(std::string(scene.name) + ": too many visible boxes were culled");
+			}
+		}
+		return out.str();
+	}
+
+}
@@ -1,8 +1,12 @@
 #include "Renderer.h"
 #include <DirectXTex.h>
+#include "../Utilities/JobSystem.h"
 #include "../Utilities/Utilities.h"
 #include "Shadow.h"
 
+#include <algorithm>
+#include <cmath>
+
 #pragma comment(lib, "runtimeobject")
 
 namespace LiteEngine::Rendering {
@@ -69,18 +73,28 @@ namespace LiteEngine::Rendering {
 		std::shared_ptr<RenderingScene>& scene
 	) {
 
-		static auto pass = this->createRenderingPassWithoutSceneAndTarget(
-			[]() {
-				CD3D11_RASTERIZER_DESC desc{CD3D11_DEFAULT()};
-				desc.CullMode = D3D11_CULL_NONE;
-				return desc;
-			}(),
-			CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT())
-		);
+		static Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
+		static Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
+		static std::once_flag once;
+
+		std::call_once(once, [&]() {
+			CD3D11_RASTERIZER_DESC rasterizerDesc{ CD3D11_DEFAULT{} };
+			rasterizerDesc.CullMode = D3D11_CULL_NONE;
+			CD3D11_DEPTH_STENCIL_DESC depthStencilDesc{ CD3D11_DEFAULT{} };
+			this->device->CreateRasterizerState(&rasterizerDesc, &rasterizerState);
+			this->device->CreateDepthStencilState(&depthStencilDesc, &depthStencilState);
+		});
+
+		// 与 createDepthMapPass 一样每帧新建在 frame arena 中：
+		// 复用一个静态的 pass 会让它一直持有上一帧的 scene，Scene::getRenderingScene 因此不能原地重建
+		auto pass = makeFrameShared<RenderingPass>(this->frameArena);
+		pass->rasterizerState = rasterizerState;
+		pass->depthStencilState = depthStencilState;
 		pass->scene = scene;
 		pass->renderTargetView = this->renderTargetView;
 		pass->depthStencilView = this->depthStencilView;
 		pass->clearStencil = false;
+		pass->occlusionCulling = true;
 
 		D3D11_VIEWPORT viewport = {};
 		viewport.Width = (float)this->width;
@@ -120,11 +134,12 @@ namespace LiteEngine::Rendering {
 		auto det = DirectX::XMMatrixDeterminant(skyboxTransform);
 		trans_CubeMap = DirectX::XMMatrixInverse(&det, skyboxTransform);
 		
-		RenderingScene* scene = new RenderingScene();
-		scene->camera = camera;
-		scene->meshObjects = { skyboxMeshObject };
-
-		pass->scene = std::shared_ptr<RenderingScene>(scene);
+		// pass 和 scene 都是复用的，每帧只更新相机
+		if (!pass->scene) {
+			pass->scene = std::shared_ptr<RenderingScene>(new RenderingScene());
+			pass->scene->meshObjects = { skyboxMeshObject };
+		}
+		pass->scene->camera = camera;
 		pass->renderTargetView = this->renderTargetView;
 		pass->depthStencilView = this->depthStencilView;
 		pass->clearColor = false;
@@ -190,10 +205,97 @@ namespace LiteEngine::Rendering {
 		return doCreateSimpleTexture2DFromWIC(meta, image, *this, device.Get());
 	}
 
+	TextureData Renderer::decodeTexture2DFromWIC(const uint8_t* memory, size_t size) {
+		// WIC 需要每个线程单独初始化
+		initializeWRL();
+		DirectX::WIC_FLAGS flags = DirectX::WIC_FLAGS_FORCE_RGB;
+		DirectX::TexMetadata meta;
+		DirectX::ScratchImage image;
+		if (FAILED(DirectX::LoadFromWICMemory(memory, size, flags, &meta, image)) || image.GetImageCount() <= 0) {
+			throw std::exception("failed to decode image");
+		}
+
+		const DirectX::Image* source = image.GetImage(0, 0, 0);
+
+		DirectX::ScratchImage converted;
+		if (meta.format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+			if (FAILED(DirectX::Convert(*source, DXGI_FORMAT_R8G8B8A8_UNORM,
+				DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted))) {
+				throw std::exception("failed to convert image to R8G8B8A8_UNORM");
+			}
+			source = converted.GetImage(0, 0, 0);
+		}
+
+		TextureData out;
+		out.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		TextureData::MipLevel level;
+		level.width = (uint32_t)source->width;
+		level.height = (uint32_t)source->height;
+		level.offset = 0;
+		level.rowPitch = level.width * 4;
+		level.slicePitch = level.rowPitch * level.height;
+		out.mips.push_back(level);
+		out.pixels.resize(level.slicePitch);
+
+		// ScratchImage 的 rowPitch 可能带有 padding
+		for (uint32_t y = 0; y < level.height; y++) {
+			memcpy(out.pixels.data() + (size_t)y * level.rowPitch,
+				source->pixels + y * source->rowPitch, level.rowPitch);
+		}
+
+		return out;
+	}
+
+	PtrShaderResourceView Renderer::createTexture2D(const TextureData& data) {
+		if (data.mips.empty()) {
+			throw std::exception("texture data is empty");
+		}
+
+		CD3D11_TEXTURE2D_DESC desc(
+			data.format, data.getWidth(), data.getHeight(),
+			1, (UINT)data.mips.size(), D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_IMMUTABLE
+		);
+
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(data.mips.size());
+		for (size_t i = 0; i < data.mips.size(); i++) {
+			initData[i].pSysMem = data.getMipData(i);
+			initData[i].SysMemPitch = data.mips[i].rowPitch;
+			initData[i].SysMemSlicePitch = data.mips[i].slicePitch;
+		}
+
+		ID3D11Texture2D* texture = nullptr;
+		if (FAILED(device->CreateTexture2D(&desc, initData.data(), &texture))) {
+			throw std::exception("failed to create texture");
+		}
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(D3D11_SRV_DIMENSION_TEXTURE2D, data.format, 0, (UINT)data.mips.size());
+		auto view = createShaderResourceView(texture, viewDesc);
+		texture->Release();
+
+		return view;
+	}
+
+	// 阴影相机的 world to clip，再映射到深度图上的纹理坐标。降低分辨率时只用到深度图左上角 scaleX * scaleY 的部分
+	static DirectX::XMMATRIX getShadowTextureMatrix(const RenderingScene::CameraInfo& depthCamera, float scaleX, float scaleY) {
+		return DirectX::XMMatrixMultiply(
+			DirectX::XMMatrixMultiply(
+				depthCamera.trans_W2V,
+				depthCamera.getV2CMatrix()
+			), DirectX::XMMATRIX {
+				0.5f * scaleX, 0, 0, 0,
+				0, -0.5f * scaleY, 0, 0,
+				0, 0, 1.0, 0,
+				0.5f * scaleX, 0.5f * scaleY, 0, 1
+			}
+		);
+	}
+
 	void Renderer::createShadowMapPasses(
-		std::vector<std::shared_ptr<RenderingPass>>& renderingPasses,
+		RenderingPassList& renderingPasses,
 		std::shared_ptr<RenderingScene> scene,
-		std::vector<float> zList,
+		const CascadeSplits& zList,
 		std::shared_ptr<DepthTextureArray> depthMap
 	) {
 		if (depthMap == nullptr) {
@@ -203,61 +305,115 @@ namespace LiteEngine::Rendering {
 		auto mainCamera = scene->camera;
 		auto ratio = scene->camera.farZ / scene->camera.nearZ;
 
-		//  constants
-		std::shared_ptr<RenderingPass> constantSettingPass(new RenderingPass());
+		// 在预算内选择有阴影的光源，以及各自的 cascade 和分辨率
+		planShadows(mainCamera, scene->lights, zList.data(), (uint32_t)zList.size(),
+			depthMap->width, depthMap->height, this->shadowBudget, this->shadowPlan);
+
+		std::array<uint32_t, MAX_NUMBER_OF_SHADOWED_LIGHTS> slotLights;
+		slotLights.fill(0xffffffff);
+		for (uint32_t slot = 0; slot < (uint32_t)this->shadowPlan.lights.size(); slot++) {
+			slotLights[slot] = this->shadowPlan.lights[slot].lightID;
+		}
+
+		// 设置 constants
+		auto constantSettingPass = makeFrameShared<RenderingPass>(this->frameArena);
 		constantSettingPass->disableRendering = true;
 		constantSettingPass->afterRenderModifier = [=](PerpassModifiable data) {
-			// todo  far  near ٿռռá
+			// todo 这里存 far 和 near 反而减少空间占用。。
 			for (size_t i = 0; i < std::min<size_t>(NUMBER_SHADOW_MAP_PER_LIGHT + 1, zList.size()); i++) {
 				data.fixedPerframePSConstants->CSMZList[i][0] = zList[i];
 			}
 
 			memset(data.fixedPerframePSConstants->CSMValid, 
 				0, sizeof(data.fixedPerframePSConstants->CSMValid));
+
+			for (uint32_t slot = 0; slot < MAX_NUMBER_OF_SHADOWED_LIGHTS; slot++) {
+				data.fixedPerframePSConstants->CSMLightID[slot][0] = slotLights[slot];
+			}
 		};
+		renderingPasses.reserve(renderingPasses.size() + 1 + this->shadowPlan.passes);
 		renderingPasses.push_back(constantSettingPass);
 
-		// Ⱦͼ
-		for (uint32_t lightID = 0; lightID < (uint32_t)scene->lights.size(); lightID++) {
+		// 渲染深度图。有分组的 view 时可以一个光源一个 pass
+		bool singlePass = this->singlePassCascades && depthMap->groupSize == NUMBER_SHADOW_MAP_PER_LIGHT;
+		for (uint32_t slot = 0; slot < (uint32_t)this->shadowPlan.lights.size(); slot++) {
+			auto& plan = this->shadowPlan.lights[slot];
+
+			std::array<DepthCameraSuggestion, NUMBER_SHADOW_MAP_PER_LIGHT> maps;
+			getSuggestedDepthCamera(mainCamera, scene->lights[plan.lightID], zList.data(), (uint32_t)zList.size(), maps.data());
 
-			auto maps = getSuggestedDepthCamera(mainCamera, scene->lights[lightID], zList);
+			// 降低分辨率时只画在深度图左上角，采样坐标相应缩小
+			uint32_t width = std::max(1u, depthMap->width >> plan.resolutionShift);
+			uint32_t height = std::max(1u, depthMap->height >> plan.resolutionShift);
+			float scaleX = (float)width / depthMap->width;
+			float scaleY = (float)height / depthMap->height;
+
+			// singlePass 时这个光源的所有 cascade 共用
+			std::shared_ptr<RenderingPass> cascadePass;
 
 			for (uint32_t mapID = 0; mapID < (uint32_t)maps.size(); mapID++) {
+				// 预算之外或者光源照不到的 cascade
+				if (!(plan.cascadeMask & (1u << mapID))) continue;
+
 				auto& cameraDesc = maps[mapID];
 
-				//  CSMԴ׶ڣ fov ܴ󣩣ô
-				// CMSValid ĬϳʼΪ false
+				// 如果不合适用 CSM（光源在锥体内，或者 fov 会很大），那么跳过
+				// CMSValid 默认初始化为了 false
 				auto feasible = std::get<0>(cameraDesc);
 				if (!feasible) continue;
 
+				auto depthCamera = std::get<1>(cameraDesc);
+				auto includeLayers = mapID > 0 ? RenderLayers::SHADOW_CASTER_DISTANT : RenderLayers::SHADOW_CASTER;
+
+				if (singlePass) {
+					if (!cascadePass) {
+						cascadePass = this->createDepthMapPass(scene, depthMap->groupDepthBuffers[slot], width, height);
+						cascadePass->includeLayers = 0;
+
+						// 场景的相机不变，各级的相机在 drawCascades 中设置；渲染后写入各级的常数
+						auto pass = cascadePass.get();
+						cascadePass->afterRenderModifier = [pass, slot, scaleX, scaleY](PerpassModifiable data) {
+							for (uint32_t i = 0; i < pass->cascadeCount; i++) {
+								auto& cascade = pass->cascades[i];
+								auto mapID = cascade.slice % NUMBER_SHADOW_MAP_PER_LIGHT;
+								data.fixedPerframePSConstants->CSMValid[slot][mapID][0] = true;
+								data.fixedPerframePSConstants->trans_W2CMS[slot][mapID] = getShadowTextureMatrix(cascade.camera, scaleX, scaleY);
+							}
+						};
+						renderingPasses.push_back(cascadePass);
+					}
+					auto& cascade = cascadePass->cascades[cascadePass->cascadeCount++];
+					cascade.camera = depthCamera;
+					cascade.slice = slot * NUMBER_SHADOW_MAP_PER_LIGHT + mapID;
+					cascade.depthView = depthMap->depthBuffers[cascade.slice];
+					cascade.includeLayers = includeLayers;
+					cascade.lodSlot = 1 + mapID;
+					cascadePass->includeLayers |= includeLayers;
+					continue;
+				}
 
 				auto shadowPass = this->createDepthMapPass(scene, 
-					this->shadowDepthBuffer->depthBuffers[lightID * NUMBER_SHADOW_MAP_PER_LIGHT + mapID], 
-					(uint32_t)std::round(depthMap->width), 
-					(uint32_t)std::round(depthMap->height)
+					depthMap->depthBuffers[slot * NUMBER_SHADOW_MAP_PER_LIGHT + mapID], 
+					width, 
+					height
 				);
 
-				// Ⱦǰ
-				shadowPass->beforeRenderModifier = [=](PerpassModifiable data) {
-					data.scene->camera = std::get<1>(cameraDesc);
+				shadowPass->lodSlot = 1 + mapID;
+				shadowPass->includeLayers = includeLayers;
+
+				// 渲染前，改相机
+				shadowPass->beforeRenderModifier = [depthCamera](PerpassModifiable data) {
+					data.scene->camera = depthCamera;
 				};
 
-				// Ⱦ󣬸ĻҰسú
-				shadowPass->afterRenderModifier = [=](PerpassModifiable data) {
+				// 渲染后，改回来相机，并且把相关常数设置好
+				// 矩阵提前算好，闭包只需要捕获结果
+				auto trans_W2CMS = getShadowTextureMatrix(depthCamera, scaleX, scaleY);
+				shadowPass->afterRenderModifier = [mainCamera, trans_W2CMS, slot, mapID](PerpassModifiable data) {
 					data.scene->camera = mainCamera;
 
-					data.fixedPerframePSConstants->CSMValid[lightID][mapID][0] = true;
-					data.fixedPerframePSConstants->trans_W2CMS[lightID][mapID] = DirectX::XMMatrixMultiply(
-						DirectX::XMMatrixMultiply(
-							std::get<1>(cameraDesc).trans_W2V,
-							std::get<1>(cameraDesc).getV2CMatrix()
-						), DirectX::XMMATRIX {
-							0.5, 0, 0, 0,
-							0, -0.5, 0, 0,
-							0, 0, 1.0, 0,
-							0.5, 0.5, 0, 1
-						}
-					);
+					data.fixedPerframePSConstants->CSMValid[slot][mapID][0] = true;
+					data.fixedPerframePSConstants->trans_W2CMS[slot][mapID] = trans_W2CMS;
 				};
 
 				renderingPasses.push_back(shadowPass);
@@ -270,16 +426,721 @@ namespace LiteEngine::Rendering {
 		bool renderShadow // = true
 	) {
 		if (renderShadow) {
-			std::vector<std::shared_ptr<RenderingPass>> passes;
-			this->createShadowMapPasses(passes, scene, {
-				scene->camera.nearZ, 3, 10, 30, 100	
-			} /*, default to nullptr*/);
+			auto passes = this->createRenderingPassList();
+			this->createShadowMapPasses(passes, scene, this->computeCascadeSplits(*scene) /*, default to nullptr*/);
 
 			this->renderPasses(passes);
 		}
 		
 		auto mainPass = this->createDefaultRenderingPass(scene);
 		this->renderPass(mainPass);
+
+		if (renderShadow && this->cascadeSplitMode == CascadeSplitMode::DEPTH_READBACK) {
+			this->requestDepthReadback(scene->camera);
+		}
+	}
+
+	void Renderer::prepareInstances(const RenderingScene& scene, uint32_t includeLayers, bool occlusionCulling) {
+		bool occlusion = occlusionCulling && this->enableOcclusionCulling;
+		if (&scene == this->preparedInstanceScene && includeLayers == this->preparedInstanceLayers &&
+			occlusion == this->preparedInstanceOcclusion) return;
+		this->preparedInstanceScene = &scene;
+		this->preparedInstanceLayers = includeLayers;
+		this->preparedInstanceOcclusion = occlusion;
+
+		this->singleDraws.clear();
+		this->groupedObjects.clear();
+		this->instanceBatches.clear();
+		this->instanceData.clear();
+		this->instanceSortKeys.clear();
+		this->impostorDraws.clear();
+		this->hiddenObjects.assign(scene.meshObjects.size(), 0);
+
+		// impostor 完全不透明之后不再画原来的 mesh
+		for (auto& impostor : scene.impostors) {
+			auto fade = this->enableImpostors ? this->getImpostorFade(*impostor.meshObject, scene.camera) : 0.f;
+			if (fade <= 0) continue;
+			impostor.meshObject->material->constants->cpuData<ImpostorMaterialConstantData>().fade = fade;
+			if (impostor.meshObject->layers & includeLayers) {
+				this->impostorDraws.push_back(impostor.meshObject.get());
+			}
+			if (fade >= 1) {
+				auto end = std::min((size_t)impostor.firstMeshObject + impostor.meshObjectCount, this->hiddenObjects.size());
+				for (size_t i = impostor.firstMeshObject; i < end; i++) this->hiddenObjects[i] = 1;
+			}
+		}
+
+		if (occlusion) this->prepareOcclusionBuffer(scene, includeLayers);
+
+		auto appendInstance = [this](DirectX::FXMMATRIX trans_L2W, DirectX::CXMMATRIX trans_W2L) {
+			InstanceData instance;
+			DirectX::XMStoreFloat4x4(&instance.trans_L2W, trans_L2W);
+			DirectX::XMStoreFloat4x4(&instance.trans_W2L, trans_W2L);
+			this->instanceData.push_back(instance);
+		};
+
+		// 自动分组：按 (mesh, 材质, layers) 排序后相同的物体连在一起，足够多的合并成一次实例化绘制
+		// layers 相同才能合并：实例化绘制的 PS 只能看到第一个物体的 constant buffer（是否接收阴影）
+		for (uint32_t i = 0; i < (uint32_t)scene.meshObjects.size(); i++) {
+			auto object = scene.meshObjects[i].get();
+			if (this->hiddenObjects[i] || !(object->layers & includeLayers)) continue;
+			if (occlusion && this->isOccluded(object->getMeshData(), object->transform)) continue;
+			if (this->automaticInstancingThreshold == 0 || object->hasCustomConstantBuffers() ||
+				!object->getMeshData().supportsInstancing()) {
+				this->singleDraws.push_back(object);
+			} else {
+				this->instanceSortKeys.push_back({ &object->getMeshData(), object->material.get(), object->layers, i });
+			}
+		}
+		std::sort(this->instanceSortKeys.begin(), this->instanceSortKeys.end());
+
+		for (size_t begin = 0, end; begin < this->instanceSortKeys.size(); begin = end) {
+			auto [mesh, material, layers, first] = this->instanceSortKeys[begin];
+			for (end = begin + 1; end < this->instanceSortKeys.size(); end++) {
+				auto& key = this->instanceSortKeys[end];
+				if (std::get<0>(key) != mesh || std::get<1>(key) != material || std::get<2>(key) != layers) break;
+			}
+
+			if (end - begin < this->automaticInstancingThreshold) {
+				for (auto i = begin; i < end; i++) {
+					this->singleDraws.push_back(scene.meshObjects[std::get<3>(this->instanceSortKeys[i])].get());
+				}
+				continue;
+			}
+
+			InstanceBatch batch;
+			batch.meshObject = scene.meshObjects[first].get();
+			batch.firstInstance = (uint32_t)this->instanceData.size();
+			batch.instanceCount = (uint32_t)(end - begin);
+			batch.firstObject = (uint32_t)this->groupedObjects.size();
+			for (auto i = begin; i < end; i++) {
+				auto object = scene.meshObjects[std::get<3>(this->instanceSortKeys[i])].get();
+				auto det = DirectX::XMMatrixDeterminant(object->transform);
+				appendInstance(object->transform, DirectX::XMMatrixInverse(&det, object->transform));
+				this->groupedObjects.push_back(object);
+			}
+			this->instanceBatches.push_back(batch);
+		}
+
+		// 显式实例化：实例变换在节点变换之前作用，逆矩阵的顺序相反
+		for (auto& [meshObject, instances] : scene.instancedObjects) {
+			if (!instances || instances->transforms.empty() || !(meshObject->layers & includeLayers)) continue;
+
+			InstanceBatch batch;
+			batch.meshObject = meshObject.get();
+			batch.firstInstance = (uint32_t)this->instanceData.size();
+			batch.firstObject = UINT32_MAX;
+
+			auto trans_N2W = meshObject->transform;
+			auto det = DirectX::XMMatrixDeterminant(trans_N2W);
+			auto trans_W2N = DirectX::XMMatrixInverse(&det, trans_N2W);
+			for (size_t i = 0; i < instances->transforms.size(); i++) {
+				auto trans_L2W = DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&instances->transforms[i]), trans_N2W);
+				if (occlusion && this->isOccluded(meshObject->getMeshData(), trans_L2W)) continue;
+				appendInstance(trans_L2W, DirectX::XMMatrixMultiply(trans_W2N, DirectX::XMLoadFloat4x4(&instances->inverses[i])));
+			}
+			batch.instanceCount = (uint32_t)this->instanceData.size() - batch.firstInstance;
+			if (batch.instanceCount > 0) this->instanceBatches.push_back(batch);
+		}
+
+		if (this->instanceData.empty()) return;
+
+		if (this->instanceData.size() > this->instanceBufferCapacity) {
+			uint32_t capacity = std::max(1024u, this->instanceBufferCapacity);
+			while (capacity < this->instanceData.size()) capacity *= 2;
+			this->instanceBuffer = this->createDynamicVertexBufferObject(nullptr, capacity, (uint32_t)sizeof(InstanceData), nullptr);
+			this->instanceBufferCapacity = capacity;
+		}
+		this->updateDynamicVertexBufferObject(*this->instanceBuffer, this->instanceData.data(),
+			this->instanceData.size() * sizeof(InstanceData));
+	}
+
+	void Renderer::prepareLightClusters(const RenderingScene& scene) {
+		if (&scene == this->preparedLightScene) return;
+		this->preparedLightScene = &scene;
+
+		auto& camera = scene.camera;
+		this->clusterLights.resize(scene.lights.size());
+		for (size_t i = 0; i < scene.lights.size(); i++) {
+			auto& light = scene.lights[i];
+			auto& out = this->clusterLights[i];
+
+			auto position_V = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&light.position_W), camera.trans_W2V);
+			auto direction_V = DirectX::XMVector3Normalize(
+				DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&light.direction_W), camera.trans_W2V));
+			DirectX::XMStoreFloat3(&out.position_V, position_V);
+			DirectX::XMStoreFloat3(&out.direction_V, direction_V);
+
+			// 平行光照到所有地方；maximumDistance 非正时视为不限距离
+			bool bounded = light.type != LightType::LIGHT_TYPE_DIRECTIONAL && light.maximumDistance > 0;
+			out.range = bounded ? light.maximumDistance : std::numeric_limits<float>::infinity();
+			out.spot = light.type == LightType::LIGHT_TYPE_SPOT;
+			out.outerConeAngle = light.outerConeAngle;
+		}
+
+		auto clusterCamera = camera.projectionType == RenderingScene::CameraInfo::ProjectionType::PERSPECTIVE ?
+			LightClusterCamera::perspectiveCamera(camera.fieldOfViewYRadian, camera.aspectRatio, camera.nearZ, camera.farZ) :
+			LightClusterCamera::orthographicCamera(camera.viewWidth, camera.viewHeight, camera.nearZ, camera.farZ);
+		this->lightClusters.build(clusterCamera, this->clusterLights, &JobSystem::getInstance());
+
+		// 容量按 2 倍增长。空的 buffer 不能创建，至少保留 1024 个元素
+		auto upload = [this](std::shared_ptr<StructuredBufferObject>& buffer, const void* data, size_t count, uint32_t elementSize) {
+			if (!buffer || count > buffer->capacity) {
+				uint32_t capacity = std::max(1024u, buffer ? buffer->capacity : 0u);
+				while (capacity < count) capacity *= 2;
+				buffer = this->createDynamicStructuredBuffer(capacity, elementSize);
+			}
+			if (count > 0) this->updateDynamicStructuredBuffer(*buffer, data, count * elementSize);
+		};
+		upload(this->lightBuffer, scene.lights.data(), scene.lights.size(), (uint32_t)sizeof(LightDesc));
+		upload(this->lightClusterBuffer, this->lightClusters.getClusters().data(),
+			this->lightClusters.getClusters().size(), (uint32_t)sizeof(LightClusterRange));
+		upload(this->clusterLightIndexBuffer, this->lightClusters.getLightIndices().data(),
+			this->lightClusters.getLightIndices().size(), (uint32_t)sizeof(uint32_t));
+	}
+
+	float Renderer::getImpostorFade(const MeshObject& impostor, const RenderingScene::CameraInfo& camera) const {
+		// impostor 空间中的包围球是单位球，半径按最大的缩放计算
+		auto& transform = impostor.transform;
+		float radius = 0;
+		for (int i = 0; i < 3; i++) {
+			radius = std::max(radius, DirectX::XMVectorGetX(DirectX::XMVector3Length(transform.r[i])));
+		}
+
+		float diameter;
+		if (camera.projectionType == RenderingScene::CameraInfo::ProjectionType::PERSPECTIVE) {
+			auto z = DirectX::XMVectorGetZ(DirectX::XMVector3TransformCoord(transform.r[3], camera.trans_W2V));
+			// 相机在包围球内（或离得很近）时总是画 mesh
+			if (z <= radius * 2) return 0;
+			diameter = 2 * radius * this->height / (2 * std::tan(camera.fieldOfViewYRadian / 2) * z);
+		} else {
+			diameter = 2 * radius * this->height / camera.viewHeight;
+		}
+
+		if (this->impostorFadePixels <= 0) return diameter < this->impostorPixelSize ? 1.f : 0.f;
+		return std::clamp((this->impostorPixelSize + this->impostorFadePixels - diameter) / this->impostorFadePixels, 0.f, 1.f);
+	}
+
+	std::shared_ptr<MeshObject> Renderer::createImpostorMeshObject(
+		PtrShaderResourceView albedo,
+		PtrShaderResourceView normal,
+		PtrShaderResourceView emission,
+		uint32_t framesPerSide
+	) {
+		// 所有 impostor 共用一个四边形，朝向在 vertex shader 中计算
+		static auto mesh = [this]() {
+			float corners[4 * 2] = { -1, -1, -1, +1, +1, +1, +1, -1 };
+			std::shared_ptr<InputElementDescriptions> desc(
+				new InputElementDescriptions(InputElementDescriptions({
+					{ "POSITION",   0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0}}))
+				);
+			auto vbo = this->createVertexBufferObject(corners, 4, 2 * sizeof(float), desc);
+			auto vshader = this->createVertexShader(loadBinaryFromFile(L"ImpostorVS.cso"));
+			return this->createMesh(vbo, { 0, 1, 2, 0, 2, 3 }, vshader, this->createInputLayout(desc, vshader), nullptr, nullptr);
+		}();
+		static auto pixelShader = this->createPixelShader(loadBinaryFromFile(L"ImpostorPS.cso"));
+		static auto sampler = this->createSamplerState(CD3D11_SAMPLER_DESC(CD3D11_DEFAULT()));
+
+		std::shared_ptr<StoredMaterial> material(new StoredMaterial());
+		material->defaultShader = pixelShader;
+		material->shaderResourceViews = { { albedo, 0 }, { normal, 1 }, { emission, 2 } };
+		material->samplerStates = { { sampler, 0 } };
+		ImpostorMaterialConstantData constants;
+		constants.framesPerSide = framesPerSide;
+		material->constants = this->createConstantBuffer(constants);
+
+		// impostor 不投射阴影：只用于很远的物体，那里已经不在阴影级联的范围内
+		auto out = this->createMeshObject(mesh, material, nullptr);
+		out->layers = RenderLayers::DEFAULT & ~(RenderLayers::SHADOW_CASTER | RenderLayers::SHADOW_CASTER_DISTANT);
+		return out;
+	}
+
+	Renderer::LodView Renderer::getLodView(const RenderingPass& pass) const {
+		return this->getLodView(pass.scene->camera, pass.viewport.Height, pass.lodSlot);
+	}
+
+	Renderer::LodView Renderer::getLodView(const RenderingScene::CameraInfo& camera, float viewportHeight, uint32_t lodSlot) const {
+		LodView view;
+		view.trans_W2V = camera.trans_W2V;
+		view.perspective = camera.projectionType == RenderingScene::CameraInfo::ProjectionType::PERSPECTIVE;
+		view.pixelsPerUnit = view.perspective ?
+			viewportHeight / (2 * std::tan(camera.fieldOfViewYRadian / 2)) :
+			viewportHeight / camera.viewHeight;
+		view.nearZ = camera.nearZ;
+		view.slot = std::min(lodSlot, LOD_HISTORY_SLOTS - 1);
+		return view;
+	}
+
+	uint32_t Renderer::selectLod(const Mesh& mesh, DirectX::FXMMATRIX transform, const LodView& view, uint32_t previous) const {
+		auto count = mesh.getLodCount();
+		if (!this->enableLod || count == 1) return 0;
+
+		// 包围球投影到屏幕上的大小决定每单位长度对应的像素数；透视投影时取包围球最近处
+		float scale = 0;
+		for (int i = 0; i < 3; i++) {
+			scale = std::max(scale, DirectX::XMVectorGetX(DirectX::XMVector3Length(transform.r[i])));
+		}
+		float pixelsPerUnit = view.pixelsPerUnit * scale;
+		if (view.perspective) {
+			auto center_W = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&mesh.bounds.Center), transform);
+			auto z = DirectX::XMVectorGetZ(DirectX::XMVector3TransformCoord(center_W, view.trans_W2V));
+			auto radius = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&mesh.bounds.Extents))) * scale;
+			pixelsPerUnit /= std::max(z - radius, view.nearZ);
+		}
+
+		auto threshold = this->lodErrorThreshold;
+		auto lod = std::min(previous, count - 1);
+		if (mesh.getLodError(lod) * pixelsPerUnit > threshold) {
+			while (lod > 0 && mesh.getLodError(lod) * pixelsPerUnit > threshold) lod--;
+		} else {
+			threshold *= 1 - this->lodHysteresis;
+			while (lod + 1 < count && mesh.getLodError(lod + 1) * pixelsPerUnit <= threshold) lod++;
+		}
+		return lod;
+	}
+
+	uint32_t Renderer::selectLod(const MeshObject& object, const LodView& view) const {
+		auto& history = object.lodHistory[view.slot];
+		auto lod = this->selectLod(object.getMeshData(), object.transform, view, history);
+		history = (uint8_t)lod;
+		return lod;
+	}
+
+	void Renderer::drawInstanceBatch(const InstanceBatch& batch, const std::string& semantic, const LodView& view) {
+		auto context = this->context.Get();
+
+		if (batch.firstObject != UINT32_MAX) {
+			uint32_t lod = UINT32_MAX;
+			for (uint32_t i = 0; i < batch.instanceCount; i++) {
+				lod = std::min(lod, this->selectLod(*this->groupedObjects[batch.firstObject + i], view));
+			}
+			if (batch.meshObject->getMeshData().getInstancedShader(semantic)) {
+				batch.meshObject->drawInstanced(context, semantic, batch.firstInstance, batch.instanceCount, &this->inputAssemblerCache, lod);
+				return;
+			}
+			for (uint32_t i = 0; i < batch.instanceCount; i++) {
+				this->groupedObjects[batch.firstObject + i]->draw(context, semantic, &this->inputAssemblerCache, lod);
+			}
+			return;
+		}
+
+		// 显式实例化的各个实例共用所在物体的 LOD 历史
+		auto object = batch.meshObject;
+		auto& mesh = object->getMeshData();
+		auto& history = object->lodHistory[view.slot];
+		uint32_t lod = UINT32_MAX;
+		for (uint32_t i = 0; i < batch.instanceCount; i++) {
+			auto trans_L2W = DirectX::XMLoadFloat4x4(&this->instanceData[batch.firstInstance + i].trans_L2W);
+			lod = std::min(lod, this->selectLod(mesh, trans_L2W, view, history));
+		}
+		history = (uint8_t)lod;
+
+		if (mesh.getInstancedShader(semantic)) {
+			object->drawInstanced(context, semantic, batch.firstInstance, batch.instanceCount, &this->inputAssemblerCache, lod);
+			return;
+		}
+
+		// 这个 pass 没有实例化 shader：逐个实例改写 transform 后绘制，最后恢复
+		auto trans_N2W = object->transform;
+		for (uint32_t i = 0; i < batch.instanceCount; i++) {
+			object->transform = DirectX::XMLoadFloat4x4(&this->instanceData[batch.firstInstance + i].trans_L2W);
+			object->draw(context, semantic, &this->inputAssemblerCache, lod);
+		}
+		object->transform = trans_N2W;
+	}
+
+	// mesh 的包围球变换到 view space。没有包围盒（Extents 为 0）时返回 false
+	static bool getViewSpaceBoundingSphere(const Mesh& mesh, DirectX::FXMMATRIX transform, DirectX::CXMMATRIX trans_W2V,
+		DirectX::XMFLOAT3& center, float& radius) {
+		auto& extents = mesh.bounds.Extents;
+		if (extents.x == 0 && extents.y == 0 && extents.z == 0) return false;
+
+		float scale = 0;
+		for (int i = 0; i < 3; i++) {
+			scale = std::max(scale, DirectX::XMVectorGetX(DirectX::XMVector3Length(transform.r[i])));
+		}
+		radius = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&extents))) * scale;
+		auto center_W = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&mesh.bounds.Center), transform);
+		DirectX::XMStoreFloat3(&center, DirectX::XMVector3TransformCoord(center_W, trans_W2V));
+		return true;
+	}
+
+	// view space 中的球是否可能与相机的视锥相交
+	static bool intersectsFrustum(const DirectX::XMFLOAT3& center, float radius, const RenderingScene::CameraInfo& camera) {
+		if (center.z + radius < camera.nearZ || center.z - radius > camera.farZ) return false;
+		if (camera.projectionType == RenderingScene::CameraInfo::ProjectionType::ORTHOGRAPHICS) {
+			return std::abs(center.x) <= camera.viewWidth / 2 + radius && std::abs(center.y) <= camera.viewHeight / 2 + radius;
+		}
+		// 侧面过原点，法线为 (1, 0, -tan) 归一化（y 方向同理）
+		float tanY = std::tan(camera.fieldOfViewYRadian / 2);
+		float tanX = tanY * camera.aspectRatio;
+		return std::abs(center.x) - center.z * tanX <= radius * std::sqrt(1 + tanX * tanX) &&
+			std::abs(center.y) - center.z * tanY <= radius * std::sqrt(1 + tanY * tanY);
+	}
+
+	// 包围球是否可能与相机的视锥相交。没有包围盒的 mesh 总是相交
+	static bool mayIntersectCamera(const Mesh& mesh, DirectX::FXMMATRIX transform, const RenderingScene::CameraInfo& camera) {
+		DirectX::XMFLOAT3 center;
+		float radius;
+		return !getViewSpaceBoundingSphere(mesh, transform, camera.trans_W2V, center, radius) || intersectsFrustum(center, radius, camera);
+	}
+
+	void Renderer::prepareOcclusionBuffer(const RenderingScene& scene, uint32_t includeLayers) {
+		this->occlusionStatistics.tested = 0;
+		this->occlusionStatistics.culled = 0;
+		if (&scene == this->preparedOcclusionScene && includeLayers == this->preparedOcclusionLayers) return;
+		this->preparedOcclusionScene = &scene;
+		this->preparedOcclusionLayers = includeLayers;
+
+		auto& camera = scene.camera;
+		this->occlusionTrans_W2C = DirectX::XMMatrixMultiply(camera.trans_W2V, camera.getV2CMatrix());
+		auto view = this->getLodView(camera, (float)this->height, 0);
+
+		// 包围球在屏幕上的直径。相机在包围球里面时（如贴近星球表面）按近平面计算，总是足够大
+		this->occluderCandidates.clear();
+		for (uint32_t i = 0; i < (uint32_t)scene.meshObjects.size(); i++) {
+			auto object = scene.meshObjects[i].get();
+			auto& mesh = object->getMeshData();
+			if (!mesh.occluder || this->hiddenObjects[i] || !(object->layers & includeLayers)) continue;
+
+			DirectX::XMFLOAT3 center;
+			float radius;
+			if (!getViewSpaceBoundingSphere(mesh, object->transform, camera.trans_W2V, center, radius) ||
+				!intersectsFrustum(center, radius, camera)) continue;
+			float pixels = 2 * radius * view.pixelsPerUnit;
+			if (view.perspective) pixels /= std::max(center.z - radius, view.nearZ);
+			if (pixels >= this->minOccluderPixels) this->occluderCandidates.push_back({ pixels, object });
+		}
+		auto count = std::min((size_t)this->maxOccluders, this->occluderCandidates.size());
+		std::partial_sort(this->occluderCandidates.begin(), this->occluderCandidates.begin() + count, this->occluderCandidates.end(),
+			[](const auto& a, const auto& b) { return a.first > b.first; });
+
+		this->occlusionBuffer.clear();
+		for (size_t i = 0; i < count; i++) {
+			auto object = this->occluderCandidates[i].second;
+			DirectX::XMFLOAT4X4 trans_L2C;
+			DirectX::XMStoreFloat4x4(&trans_L2C, DirectX::XMMatrixMultiply(object->transform, this->occlusionTrans_W2C));
+			this->occlusionBuffer.addOccluder(*object->getMeshData().occluder, trans_L2C);
+		}
+		this->occlusionBuffer.render(&JobSystem::getInstance());
+
+		auto& statistics = this->occlusionBuffer.getStatistics();
+		this->occlusionStatistics.occluders = statistics.occluders;
+		this->occlusionStatistics.occluderTriangles = statistics.triangles;
+	}
+
+	bool Renderer::isOccluded(const Mesh& mesh, DirectX::FXMMATRIX trans_L2W) {
+		auto& extents = mesh.bounds.Extents;
+		if (extents.x == 0 && extents.y == 0 && extents.z == 0) return false;
+
+		DirectX::XMFLOAT4X4 trans_L2C;
+		DirectX::XMStoreFloat4x4(&trans_L2C, DirectX::XMMatrixMultiply(trans_L2W, this->occlusionTrans_W2C));
+		bool occluded = !this->occlusionBuffer.isVisible(mesh.bounds.Center, extents, trans_L2C);
+		this->occlusionStatistics.tested++;
+		this->occlusionStatistics.culled += occluded;
+		return occluded;
+	}
+
+	void Renderer::drawCascades(const RenderingPass& pass) {
+		// getInstancedShader / drawInstanced 接受 std::string，直接传字符串常量时每次都会构造临时的 string，
+		// 它超出了 SSO 的长度，每个物体都有一次堆分配
+		static const std::string cascadedDepthSemantic = ShaderSemantics::CASCADED_DEPTH_MAP;
+
+		auto context = this->context.Get();
+		this->cascadeDraws.clear();
+		this->cascadeFallbackDraws.clear();
+
+		std::array<LodView, NUMBER_SHADOW_MAP_PER_LIGHT> views;
+		for (uint32_t c = 0; c < pass.cascadeCount; c++) {
+			auto& cascade = pass.cascades[c];
+			views[c] = this->getLodView(cascade.camera, pass.viewport.Height, cascade.lodSlot);
+		}
+
+		// 物体在与它相交的每一级 cascade 中各有一次绘制，LOD 按各级分别选择
+		auto addObject = [&](MeshObject* object) {
+			auto& mesh = object->getMeshData();
+			bool instanced = !object->hasCustomConstantBuffers() && mesh.getInstancedShader(cascadedDepthSemantic);
+			for (uint32_t c = 0; c < pass.cascadeCount; c++) {
+				auto& cascade = pass.cascades[c];
+				if (!(object->layers & cascade.includeLayers) || !mayIntersectCamera(mesh, object->transform, cascade.camera)) continue;
+				CascadeDraw draw{ &mesh, object->material.get(), this->selectLod(*object, views[c]), c, object, UINT32_MAX };
+				(instanced ? this->cascadeDraws : this->cascadeFallbackDraws).push_back(draw);
+			}
+		};
+
+		for (auto object : this->singleDraws) addObject(object);
+		for (auto& batch : this->instanceBatches) {
+			if (batch.firstObject != UINT32_MAX) {
+				for (uint32_t i = 0; i < batch.instanceCount; i++) addObject(this->groupedObjects[batch.firstObject + i]);
+				continue;
+			}
+
+			// 显式实例化的各个实例共用所在物体的 LOD 历史，与 drawInstanceBatch 一样取各实例所需的最精细的一级
+			auto object = batch.meshObject;
+			auto& mesh = object->getMeshData();
+			auto& draws = mesh.getInstancedShader(cascadedDepthSemantic) ? this->cascadeDraws : this->cascadeFallbackDraws;
+			for (uint32_t c = 0; c < pass.cascadeCount; c++) {
+				auto& cascade = pass.cascades[c];
+				if (!(object->layers & cascade.includeLayers)) continue;
+
+				auto& history = object->lodHistory[views[c].slot];
+				auto first = draws.size();
+				uint32_t lod = UINT32_MAX;
+				for (uint32_t i = 0; i < batch.instanceCount; i++) {
+					auto trans_L2W = DirectX::XMLoadFloat4x4(&this->instanceData[batch.firstInstance + i].trans_L2W);
+					if (!mayIntersectCamera(mesh, trans_L2W, cascade.camera)) continue;
+					lod = std::min(lod, this->selectLod(mesh, trans_L2W, views[c], history));
+					draws.push_back({ &mesh, object->material.get(), 0, c, object, batch.firstInstance + i });
+				}
+				if (draws.size() == first) continue;
+				history = (uint8_t)lod;
+				for (auto i = first; i < draws.size(); i++) draws[i].lod = lod;
+			}
+		}
+		for (auto object : this->impostorDraws) {
+			for (uint32_t c = 0; c < pass.cascadeCount; c++) {
+				if (!(object->layers & pass.cascades[c].includeLayers)) continue;
+				this->cascadeFallbackDraws.push_back({ &object->getMeshData(), object->material.get(), 0, c, object, UINT32_MAX });
+			}
+		}
+
+		// 下面会改写 per-frame VS 常数（各级的 world to clip，逐级绘制时还有相机），绘制结束后恢复，
+		// afterRenderModifier 和 GPU 上的常数与 pass 开始时（updateFixedPerframeConstantBuffers）相同
+		auto& constants = this->fixedPerframeVSConstantBuffer->cpuData<FixedPerframeVSConstantBufferData>();
+		auto savedConstants = constants;
+
+		// 按 (mesh, 材质, LOD) 排序后相同的连在一起，一次实例化绘制覆盖它们在各级 cascade 中的实例
+		if (!this->cascadeDraws.empty()) {
+			std::sort(this->cascadeDraws.begin(), this->cascadeDraws.end());
+
+			this->cascadeInstanceData.resize(this->cascadeDraws.size());
+			for (size_t i = 0; i < this->cascadeDraws.size(); i++) {
+				auto& draw = this->cascadeDraws[i];
+				auto& instance = this->cascadeInstanceData[i];
+				if (draw.instance == UINT32_MAX) {
+					DirectX::XMStoreFloat4x4(&instance.trans_L2W, draw.object->transform);
+				} else {
+					instance.trans_L2W = this->instanceData[draw.instance].trans_L2W;
+				}
+				instance.slice = pass.cascades[draw.cascade].slice;
+			}
+			if (this->cascadeInstanceData.size() > this->cascadeInstanceBufferCapacity) {
+				uint32_t capacity = std::max(1024u, this->cascadeInstanceBufferCapacity);
+				while (capacity < this->cascadeInstanceData.size()) capacity *= 2;
+				this->cascadeInstanceBuffer = this->createDynamicVertexBufferObject(nullptr, capacity, (uint32_t)sizeof(CascadeInstanceData), nullptr);
+				this->cascadeInstanceBufferCapacity = capacity;
+			}
+			this->updateDynamicVertexBufferObject(*this->cascadeInstanceBuffer, this->cascadeInstanceData.data(),
+				this->cascadeInstanceData.size() * sizeof(CascadeInstanceData));
+
+			for (uint32_t c = 0; c < pass.cascadeCount; c++) {
+				auto& camera = pass.cascades[c].camera;
+				constants.trans_W2CCascades[pass.cascades[c].slice % NUMBER_SHADOW_MAP_PER_LIGHT] =
+					DirectX::XMMatrixMultiply(camera.trans_W2V, camera.getV2CMatrix());
+			}
+			this->fixedPerframeVSConstantBuffer->updateBuffer(context);
+
+			static auto geometryShader = this->createGeometryShader(loadBinaryFromFile(L"CascadedDepthGS.cso"));
+			UINT stride = sizeof(CascadeInstanceData), offset = 0;
+			context->IASetVertexBuffers(INSTANCE_DATA_SLOT, 1, this->cascadeInstanceBuffer->vertices.GetAddressOf(), &stride, &offset);
+			context->GSSetShader(geometryShader.Get(), nullptr, 0);
+			for (size_t begin = 0, end; begin < this->cascadeDraws.size(); begin = end) {
+				auto& first = this->cascadeDraws[begin];
+				for (end = begin + 1; end < this->cascadeDraws.size(); end++) {
+					auto& draw = this->cascadeDraws[end];
+					if (draw.mesh != first.mesh || draw.material != first.material || draw.lod != first.lod) break;
+				}
+				first.object->drawInstanced(context, cascadedDepthSemantic,
+					(uint32_t)begin, (uint32_t)(end - begin), &this->inputAssemblerCache, first.lod);
+			}
+			context->GSSetShader(nullptr, nullptr, 0);
+		}
+
+		// 其余的物体按普通深度图逐级绘制：换成只含这一级 slice 的 view 和这一级的相机
+		std::stable_sort(this->cascadeFallbackDraws.begin(), this->cascadeFallbackDraws.end(),
+			[](const CascadeDraw& a, const CascadeDraw& b) { return a.cascade < b.cascade; });
+		for (size_t begin = 0, end; begin < this->cascadeFallbackDraws.size(); begin = end) {
+			auto& cascade = pass.cascades[this->cascadeFallbackDraws[begin].cascade];
+			for (end = begin + 1; end < this->cascadeFallbackDraws.size(); end++) {
+				if (this->cascadeFallbackDraws[end].cascade != this->cascadeFallbackDraws[begin].cascade) break;
+			}
+
+			context->OMSetRenderTargets(0, nullptr, cascade.depthView.Get());
+			constants.trans_W2V = cascade.camera.trans_W2V;
+			constants.trans_V2C = cascade.camera.getV2CMatrix();
+			constants.trans_W2C = DirectX::XMMatrixMultiply(constants.trans_W2V, constants.trans_V2C);
+			this->fixedPerframeVSConstantBuffer->updateBuffer(context);
+
+			for (auto i = begin; i < end; i++) {
+				auto& draw = this->cascadeFallbackDraws[i];
+				if (draw.instance == UINT32_MAX) {
+					draw.object->draw(context, pass.vsSemantic, &this->inputAssemblerCache, draw.lod);
+					continue;
+				}
+				auto trans_N2W = draw.object->transform;
+				draw.object->transform = DirectX::XMLoadFloat4x4(&this->instanceData[draw.instance].trans_L2W);
+				draw.object->draw(context, pass.vsSemantic, &this->inputAssemblerCache, draw.lod);
+				draw.object->transform = trans_N2W;
+			}
+		}
+
+		if (this->cascadeDraws.empty() && this->cascadeFallbackDraws.empty()) return;
+		constants = savedConstants;
+		this->fixedPerframeVSConstantBuffer->updateBuffer(context);
+	}
+
+	bool Renderer::getReceiverDepthRange(const RenderingScene& scene, float& nearZ, float& farZ) const {
+		auto& camera = scene.camera;
+		float low = std::numeric_limits<float>::max();
+		float high = std::numeric_limits<float>::lowest();
+
+		auto include = [&](const Mesh& mesh, DirectX::FXMMATRIX transform) {
+			DirectX::XMFLOAT3 center;
+			float radius;
+			if (!getViewSpaceBoundingSphere(mesh, transform, camera.trans_W2V, center, radius)) {
+				low = camera.nearZ;
+				high = camera.farZ;
+				return;
+			}
+			if (!intersectsFrustum(center, radius, camera)) return;
+			low = std::min(low, center.z - radius);
+			high = std::max(high, center.z + radius);
+		};
+
+		constexpr uint32_t RECEIVER = RenderLayers::MAIN_VIEW | RenderLayers::SHADOW_RECEIVER;
+		for (auto& object : scene.meshObjects) {
+			if ((object->layers & RECEIVER) != RECEIVER) continue;
+			include(object->getMeshData(), object->transform);
+		}
+		for (auto& [meshObject, instances] : scene.instancedObjects) {
+			if (!instances || (meshObject->layers & RECEIVER) != RECEIVER) continue;
+			auto& mesh = meshObject->getMeshData();
+			auto trans_N2W = meshObject->transform;
+			for (auto& transform : instances->transforms) {
+				include(mesh, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&transform), trans_N2W));
+			}
+		}
+
+		if (low > high) return false;
+		nearZ = std::clamp(low, camera.nearZ, camera.farZ);
+		farZ = std::clamp(high, camera.nearZ, camera.farZ);
+		return nearZ < farZ;
+	}
+
+	void Renderer::requestDepthReadback(const RenderingScene::CameraInfo& camera) {
+		auto& readback = this->depthReadbacks[this->nextDepthReadback];
+		this->nextDepthReadback = (this->nextDepthReadback + 1) % DEPTH_READBACK_LATENCY;
+
+		Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+		this->depthStencilView->GetResource(&resource);
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> depth;
+		if (FAILED(resource.As(&depth))) return;
+
+		// 窗口大小改变后重新创建
+		D3D11_TEXTURE2D_DESC desc;
+		depth->GetDesc(&desc);
+		D3D11_TEXTURE2D_DESC current = {};
+		if (readback.texture) readback.texture->GetDesc(&current);
+		if (!readback.texture || current.Width != desc.Width || current.Height != desc.Height) {
+			desc.Usage = D3D11_USAGE_STAGING;
+			desc.BindFlags = 0;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+			desc.MiscFlags = 0;
+			readback.texture.Reset();
+			if (FAILED(this->device->CreateTexture2D(&desc, nullptr, &readback.texture))) return;
+		}
+
+		this->context->CopyResource(readback.texture.Get(), depth.Get());
+		readback.camera = camera;
+		readback.sequence = this->nextDepthReadbackSequence++;
+		readback.pending = true;
+	}
+
+	bool Renderer::resolveDepthReadbacks(float& nearZ, float& farZ) {
+		// 只在 CPU 上隔行隔列地读取，边长约 DEPTH_READBACK_SAMPLES 个采样
+		constexpr uint32_t DEPTH_READBACK_SAMPLES = 128;
+		// 读回的结果晚了几帧，相机可能已经移动，范围向两边各扩大一些
+		constexpr float DEPTH_READBACK_MARGIN = 0.1f;
+
+		// 从最新的复制开始，GPU 还没有完成的留到下一帧。读回一个之后，更早的复制即使之后完成也已经过时，
+		// 直接丢弃，否则会覆盖更新的结果
+		std::array<DepthReadback*, DEPTH_READBACK_LATENCY> readbacks;
+		for (uint32_t i = 0; i < DEPTH_READBACK_LATENCY; i++) readbacks[i] = &this->depthReadbacks[i];
+		std::sort(readbacks.begin(), readbacks.end(), [](const DepthReadback* a, const DepthReadback* b) { return a->sequence > b->sequence; });
+
+		bool resolved = false;
+		for (auto pointer : readbacks) {
+			auto& readback = *pointer;
+			if (!readback.pending) continue;
+			if (resolved) {
+				readback.pending = false;
+				continue;
+			}
+
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			if (FAILED(this->context->Map(readback.texture.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped))) continue;
+			readback.pending = false;
+			resolved = true;
+
+			D3D11_TEXTURE2D_DESC desc;
+			readback.texture->GetDesc(&desc);
+			uint32_t step = std::max(1u, std::max(desc.Width, desc.Height) / DEPTH_READBACK_SAMPLES);
+
+			// D24_UNORM_S8_UINT：低 24 位是深度
+			auto& camera = readback.camera;
+			bool perspective = camera.projectionType == RenderingScene::CameraInfo::ProjectionType::PERSPECTIVE;
+			float n = camera.nearZ, f = camera.farZ;
+			float low = std::numeric_limits<float>::max();
+			float high = std::numeric_limits<float>::lowest();
+			for (uint32_t y = step / 2; y < desc.Height; y += step) {
+				auto row = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(mapped.pData) + (size_t)y * mapped.RowPitch);
+				for (uint32_t x = step / 2; x < desc.Width; x += step) {
+					uint32_t depth = row[x] & 0xffffff;
+					if (depth == 0xffffff) continue;		// 没有画到的像素
+					float d = depth / (float)0xffffff;
+					float z = perspective ? n * f / (f - d * (f - n)) : n + d * (f - n);
+					low = std::min(low, z);
+					high = std::max(high, z);
+				}
+			}
+			this->context->Unmap(readback.texture.Get(), 0);
+
+			this->hasReadbackDepthRange = low <= high;
+			if (this->hasReadbackDepthRange) {
+				float margin = (high - low) * DEPTH_READBACK_MARGIN;
+				this->readbackDepthRange = { low - margin, high + margin };
+			}
+		}
+
+		if (!this->hasReadbackDepthRange) return false;
+		nearZ = this->readbackDepthRange.first;
+		farZ = this->readbackDepthRange.second;
+		return true;
+	}
+
+	CascadeSplits Renderer::computeCascadeSplits(const RenderingScene& scene) {
+		auto& camera = scene.camera;
+		if (this->cascadeSplitMode == CascadeSplitMode::FIXED) {
+			auto out = this->fixedCascadeSplits;
+			out[0] = camera.nearZ;
+			this->cascadeDepthRange = { out.front(), out.back() };
+			return out;
+		}
+
+		float nearZ = camera.nearZ, farZ = camera.farZ;
+		bool found = this->cascadeSplitMode == CascadeSplitMode::DEPTH_READBACK && this->resolveDepthReadbacks(nearZ, farZ);
+		if (!found) found = this->getReceiverDepthRange(scene, nearZ, farZ);
+
+		// 读回的范围可能来自几帧之前的相机
+		nearZ = std::clamp(nearZ, camera.nearZ, camera.farZ);
+		farZ = std::clamp(farZ, camera.nearZ, camera.farZ);
+		if (!found || nearZ >= farZ) {
+			nearZ = camera.nearZ;
+			farZ = camera.farZ;
+		}
+
+		this->cascadeDepthRange = { nearZ, farZ };
+		return getPracticalCascadeSplits(nearZ, farZ, this->cascadeSplitLambda);
 	}
 
-}
\ No newline at end of file
+}
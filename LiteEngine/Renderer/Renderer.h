@@ -7,27 +7,33 @@
 #include <vector>
 #include <memory>
 #include <iostream>
+#include <array>
+#include <tuple>
 
 #include "Resources.h"
+#include "LightClustering.h"
+#include "RenderingTypes.h"
+#include "OcclusionCulling.h"
+#include "../Utilities/DoubleMath.h"
+#include "../Utilities/FrameArena.h"
+#include "../Utilities/InlineFunction.h"
 
 namespace LiteEngine::Rendering {
 
-	constexpr uint32_t MAX_NUMBER_OF_LIGHTS = 4;
-	constexpr uint32_t NUMBER_SHADOW_MAP_PER_LIGHT = 4;
-
-	namespace LightType {
-		constexpr uint32_t LIGHT_TYPE_POINT = 0x0;
-		constexpr uint32_t LIGHT_TYPE_DIRECTIONAL = 0x1;
-		constexpr uint32_t LIGHT_TYPE_SPOT = 0x2;
-	}
-
-	namespace LightShadow {
-		constexpr uint32_t LIGHT_SHADOW_EMPTY = 0x1;
-		constexpr uint32_t LIGHT_SHADOW_HARD = 0x2;
-		constexpr uint32_t LIGHT_SHADOW_SOFT = 0x3;	// TODO: unimplemented
-	}
+	// 最近一次主 pass 的软件遮挡剔除（见 Renderer::enableOcclusionCulling）
+	struct OcclusionCullingStatistics {
+		uint32_t occluders = 0;
+		uint64_t occluderTriangles = 0;
+		uint32_t tested = 0;		// 测试的物体和显式实例
+		uint32_t culled = 0;
+	};
 
 	namespace TextureSlots {
+		// 分簇光照的 structured buffer，见 Shader/ClusteredLights.hlsli
+		constexpr uint32_t LIGHTS = 12;
+		constexpr uint32_t LIGHT_CLUSTERS = 13;
+		constexpr uint32_t CLUSTER_LIGHT_INDICES = 14;
+
 		constexpr uint32_t CSM_DEPTH_MAP = 15;
 	}
 
@@ -35,96 +41,84 @@ namespace LiteEngine::Rendering {
 		constexpr uint32_t CSM_DEPTH_MAP = 15;
 	}
 
-
-	struct alignas(16) LightDesc {
-		// NOTE: Ҫ޸ hlsli
-		uint32_t type;						// all
-		uint32_t shadow;					// all
-		float innerConeAngle;			    // spot
-		float outerConeAngle;				// spot
-		
-		DirectX::XMFLOAT3 position_W;		// spot & point
-		float maximumDistance;				// spot & point
-	
-		DirectX::XMFLOAT3 direction_W;		// spot & directional
-	private:
-		float _space2;
-
-	public:
-		DirectX::XMFLOAT3 intensity;		// all
-	};
-
-	static_assert(sizeof(LightDesc) == 4 * 4 + 3 * 4 * 4, "`LightDesc` is not aligned correctly");
-
 	struct RenderingScene {
-		struct CameraInfo {
-			enum class ProjectionType { PERSPECTIVE, ORTHOGRAPHICS };
-
-			DirectX::XMMATRIX trans_W2V;		// world to view transformation
-			ProjectionType projectionType = ProjectionType::PERSPECTIVE;
-
-			union {
-				// perspective only
-				struct {
-					float fieldOfViewYRadian;
-					float aspectRatio;	// width / height
-				};
-
-				// ortho only
-				struct {
-					float viewWidth;
-					float viewHeight;
-				};
-			};
-
-			float nearZ;
-			float farZ;
-
-			DirectX::XMMATRIX getV2CMatrix() const {
-				if (projectionType == RenderingScene::CameraInfo::ProjectionType::PERSPECTIVE) {
-					return DirectX::XMMatrixPerspectiveFovLH(fieldOfViewYRadian, aspectRatio, nearZ, farZ);
-				}else {
-					return DirectX::XMMatrixOrthographicLH(viewWidth, viewHeight, nearZ, farZ);
-				}
-			}
-		};
+		using CameraInfo = Rendering::CameraInfo;
 
 		CameraInfo camera;
 
+		// 浮动原点：本场景中的“世界空间”（各 transform、光源位置、camera.trans_W2V）都是真正的世界空间平移 -origin_W 之后的结果
+		// 由 SceneManagement::Scene 取为相机的位置，相机附近的物体坐标很小，float 精度足够
+		Double3 origin_W;
+
 		std::vector<LightDesc> lights;
 		std::vector<std::shared_ptr<MeshObject>> meshObjects;
 
+		// 显式实例化的物体（如 glTF 的 EXT_mesh_gpu_instancing）：在 instances 的每个变换处各画一次
+		// meshObject 提供 mesh 和材质，其 transform 是所在节点的 local_to_world，实例变换在此之前作用
+		struct InstancedObject {
+			std::shared_ptr<MeshObject> meshObject;
+			std::shared_ptr<const InstanceTransforms> instances;
+		};
+		std::vector<InstancedObject> instancedObjects;
+
+		// 可以在远处用 impostor 代替的物体：meshObjects[firstMeshObject, firstMeshObject + meshObjectCount) 是它完整的 mesh
+		// meshObject 是 Renderer::createImpostorMeshObject 创建的面片，其 transform 把 impostor 空间变换到世界空间
+		struct ImpostorObject {
+			std::shared_ptr<MeshObject> meshObject;
+			uint32_t firstMeshObject;
+			uint32_t meshObjectCount;
+		};
+		std::vector<ImpostorObject> impostors;
+
 		// also probe and many other..
 
 	};
 
+	// ImpostorPS 的材质常量
+	struct alignas(16) ImpostorMaterialConstantData {
+		// NOTE: 不要忘记修改 hlsl
+		float fade = 1;
+		uint32_t framesPerSide = 2;
+	};
+
 	struct alignas(16) FixedPerframeVSConstantBufferData {
-		// NOTE: Ҫ޸ hlsli
+		// NOTE: 不要忘记修改 hlsli
 		DirectX::XMMATRIX trans_W2V;
 		DirectX::XMMATRIX trans_V2W;
 		DirectX::XMMATRIX trans_V2C;
 		DirectX::XMMATRIX trans_W2C;
+
+		// 单 pass 级联阴影中各级 cascade 的 world to clip，按 cascade 在所属光源中的序号（slice % NUMBER_SHADOW_MAP_PER_LIGHT）
+		DirectX::XMMATRIX trans_W2CCascades[NUMBER_SHADOW_MAP_PER_LIGHT];
 	};
 
 	struct alignas(16) FixedPerframePSConstantBufferData {
-		// NOTE: Ҫ޸ hlsli
+		// NOTE: 不要忘记修改 hlsli
 		DirectX::XMMATRIX trans_W2V;
 		DirectX::XMMATRIX trans_V2W;
 
 		float exposure;
 		uint32_t numberOfLights;
 	private:
-		char space[2];
+		char space[8];
 	public:
 
-		LightDesc lights[MAX_NUMBER_OF_LIGHTS];
-
 		float CSMZList[NUMBER_SHADOW_MAP_PER_LIGHT + 1][4];	// 1 2 3 are discarded..
 
 		// order: light0: map0 map1 map2; light1: map0 map1 map2, ...
-		uint32_t CSMValid[MAX_NUMBER_OF_LIGHTS][NUMBER_SHADOW_MAP_PER_LIGHT][4] = {};	// 1 2 3 are discarded..
+		uint32_t CSMValid[MAX_NUMBER_OF_SHADOWED_LIGHTS][NUMBER_SHADOW_MAP_PER_LIGHT][4] = {};	// 1 2 3 are discarded..
 
-		DirectX::XMMATRIX trans_W2CMS[MAX_NUMBER_OF_LIGHTS][NUMBER_SHADOW_MAP_PER_LIGHT];
+		// 每个 slot 对应的光源下标，没有使用的 slot 为 0xffffffff
+		uint32_t CSMLightID[MAX_NUMBER_OF_SHADOWED_LIGHTS][4] = {};	// 1 2 3 are discarded..
+
+		DirectX::XMMATRIX trans_W2CMS[MAX_NUMBER_OF_SHADOWED_LIGHTS][NUMBER_SHADOW_MAP_PER_LIGHT];
+
+		// 分簇光照，含义见 LightClusterCamera 和 LightClusterGrid
+		uint32_t clusterCount[3];
+		uint32_t clusterPerspective;
+		float clusterViewScale[2];
+		float clusterZScale;
+		float clusterZBias;
 	};
 
 	struct alignas(16) FixedLongtermConstantBufferData {
@@ -135,7 +129,7 @@ namespace LiteEngine::Rendering {
 	};
 
 	struct PerpassModifiable {
-		// scene  passҲ modifiable
+		// scene 不会持有 pass，也不会持有 modifiable
 		std::shared_ptr<RenderingScene> scene;
 		FixedPerframeVSConstantBufferData* fixedPerframeVSConstants = nullptr;
 		FixedPerframePSConstantBufferData* fixedPerframePSConstants = nullptr;
@@ -143,7 +137,11 @@ namespace LiteEngine::Rendering {
 		void* customPerframePSConstants = nullptr;
 	};
 
+	// pass 的回调。闭包放在 RenderingPass 内部，不分配堆内存；捕获的内容超过容量时编译失败
+	using PassModifier = InlineFunction<void(PerpassModifiable), 256>;
+
 	struct RenderingPass {
+		// 跨帧存在的 pass 渲染之后应当置空，否则 Scene::getRenderingScene 不能原地重建，每帧都要新建
 		std::shared_ptr<RenderingScene> scene;
 		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetView;
 		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthStencilView;
@@ -166,24 +164,52 @@ namespace LiteEngine::Rendering {
 		std::string vsSemantic = ShaderSemantics::DEFAULT;
 		std::string psSemantic = ShaderSemantics::DEFAULT;
 
+		// 选择 LOD 时使用的 MeshObject::lodHistory 下标。看到的画面差别很大的 pass（主相机、各级阴影）应当使用不同的 slot
+		uint32_t lodSlot = 0;
+
+		// 只绘制 layers 与之有交集的物体（见 RenderLayers）。同一个场景可以在不同的 pass 中画出不同的子集
+		uint32_t includeLayers = RenderLayers::MAIN_VIEW;
+
+		// 提交之前用 Renderer 的遮挡缓冲剔除被完全挡住的物体（见 Renderer::enableOcclusionCulling）。只有主视图需要
+		bool occlusionCulling = false;
+
+		// 按场景的相机为场景中的光源分簇，并绑定到 PS（见 Shader/ClusteredLights.hlsli）。不计算光照的 pass（如深度图）不需要
+		bool clusteredLighting = true;
+
+		// 单 pass 级联阴影（见 Renderer::singlePassCascades）：cascadeCount 不为 0 时 depthStencilView 覆盖一个光源的所有 slice，
+		// 每个物体只提交一次，实例化到与它相交的各级 cascade，由 geometry shader 送到对应的 slice。场景的相机不参与绘制
+		struct Cascade {
+			RenderingScene::CameraInfo camera;
+			uint32_t slice;						// 在深度图 array 中的下标
+			PtrDepthStencilView depthView;		// 只含这一个 slice，逐级绘制没有 CASCADED_DEPTH_MAP shader 的物体时使用
+			uint32_t includeLayers;
+			uint32_t lodSlot;
+		};
+		uint32_t cascadeCount = 0;
+		std::array<Cascade, NUMBER_SHADOW_MAP_PER_LIGHT> cascades;
+
 		bool disableRendering = false;
 
-		std::function<void(PerpassModifiable)> beforeRenderModifier = nullptr;
-		std::function<void(PerpassModifiable)> afterRenderModifier = nullptr;
+		PassModifier beforeRenderModifier = nullptr;
+		PassModifier afterRenderModifier = nullptr;
 	};
 
+	// 每帧临时的 pass 列表，内存来自 Renderer 的 frame arena
+	using RenderingPassList = FrameVector<std::shared_ptr<RenderingPass>>;
+
 
 
 	class Renderer {
 
 	public:
 		void createShadowMapPasses(
-			std::vector<std::shared_ptr<RenderingPass>>& renderingPasses,
+			RenderingPassList& renderingPasses,
 			std::shared_ptr<RenderingScene> scene,
-			std::vector<float> zList,
+			const CascadeSplits& zList,
 			std::shared_ptr<DepthTextureArray> depthMap = nullptr
 		);
 
+		// 返回的 pass 在 frame arena 中，只在当前帧内有效（下一次 beginRendering 之前必须释放）
 		std::shared_ptr<RenderingPass> createDepthMapPass(
 			std::shared_ptr<RenderingScene> scene,
 			PtrDepthStencilView depthView,
@@ -203,7 +229,7 @@ namespace LiteEngine::Rendering {
 				this->device->CreateDepthStencilState(&depthStencilDesc, &depthStencilState);
 			});
 
-			std::shared_ptr<RenderingPass> pass(new RenderingPass());
+			auto pass = makeFrameShared<RenderingPass>(this->frameArena);
 			pass->rasterizerState = rasterizerState;
 			pass->depthStencilState = depthStencilState;
 			pass->scene = scene;
@@ -220,15 +246,19 @@ namespace LiteEngine::Rendering {
 			pass->viewport = viewport;
 
 			pass->vsSemantic = ShaderSemantics::DEPTH_MAP;
+			pass->includeLayers = RenderLayers::SHADOW_CASTER;
+			pass->clusteredLighting = false;
 
 			return pass;
 		}
 
-		std::shared_ptr<DepthTextureArray> createDepthTextureArray(uint32_t count, uint32_t width, uint32_t height) {
+		// groupSize 不为 0 时另外为每 groupSize 个连续的 slice 创建一个 view（DepthTextureArray::groupDepthBuffers）
+		std::shared_ptr<DepthTextureArray> createDepthTextureArray(uint32_t count, uint32_t width, uint32_t height, uint32_t groupSize = 0) {
 			std::shared_ptr<DepthTextureArray> out(new DepthTextureArray());
 			out->depthBuffers.resize(count);
 			out->width = width;
 			out->height = height;
+			out->groupSize = groupSize;
 
 			constexpr auto DXGI_FORMAT_RESOURCE = DXGI_FORMAT_R24G8_TYPELESS;
 			constexpr auto DXGI_FORMAT_DEPTH_STENCIL = DXGI_FORMAT_D24_UNORM_S8_UINT;
@@ -251,6 +281,17 @@ namespace LiteEngine::Rendering {
 				device->CreateDepthStencilView(depthStencilBuffer, &depthStencilViewDesc, &out->depthBuffers[i]);
 			}
 
+			if (groupSize > 0) {
+				out->groupDepthBuffers.resize(count / groupSize);
+				for (uint32_t i = 0; i < count / groupSize; i++) {
+					CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(
+						D3D11_DSV_DIMENSION_TEXTURE2DARRAY,
+						DXGI_FORMAT_DEPTH_STENCIL, 0, i * groupSize, groupSize
+					);
+					device->CreateDepthStencilView(depthStencilBuffer, &depthStencilViewDesc, &out->groupDepthBuffers[i]);
+				}
+			}
+
 			CD3D11_SHADER_RESOURCE_VIEW_DESC shaderResouceViewDesc {
 				D3D11_SRV_DIMENSION_TEXTURE2DARRAY,
 				DXGI_FORMAT_SHADER_RESOURCE, 0, mipLevels, 0, count 
@@ -265,6 +306,7 @@ namespace LiteEngine::Rendering {
 			return out;
 		}
 
+		// 长期使用的 pass：每次调用都向堆申请并创建 D3D 状态，不要每帧调用
 		std::shared_ptr<RenderingPass> createRenderingPassWithoutSceneAndTarget(
 			D3D11_RASTERIZER_DESC rasterizerDesc,
 			D3D11_DEPTH_STENCIL_DESC depthStencilDesc
@@ -276,6 +318,7 @@ namespace LiteEngine::Rendering {
 			return pass;
 		}
 
+		// 绘制到交换链的主 pass。与 createDepthMapPass 一样在 frame arena 中，只在当前帧内有效
 		std::shared_ptr<RenderingPass> createDefaultRenderingPass(
 			std::shared_ptr<RenderingScene>& scene
 		);
@@ -342,6 +385,144 @@ namespace LiteEngine::Rendering {
 
 		std::shared_ptr<DepthTextureArray> shadowDepthBuffer = nullptr;
 
+		std::shared_ptr<GeometryPool> geometryPool;
+		InputAssemblerCache inputAssemblerCache;
+		InputAssemblerCache lastFrameInputAssemblerStatistics;
+
+		// 最近一次 createShadowMapPasses 的决定，容器在帧之间复用
+		ShadowPlan shadowPlan;
+
+		// 一次实例化绘制。自动分组的物体在 groupedObjects[firstObject, firstObject + instanceCount) 中，
+		// 显式实例化的 firstObject 为 UINT32_MAX。meshObject 提供 mesh 和材质
+		struct InstanceBatch {
+			MeshObject* meshObject;
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+			uint32_t firstObject;
+		};
+
+		// 为 preparedInstanceScene 中 layers 与 preparedInstanceLayers 有交集的物体准备的绘制列表
+		// 场景和 includeLayers 都相同的相邻 pass 共用。容器在帧之间复用
+		const RenderingScene* preparedInstanceScene = nullptr;
+		uint32_t preparedInstanceLayers = 0;
+		bool preparedInstanceOcclusion = false;
+		std::vector<MeshObject*> singleDraws;
+		std::vector<MeshObject*> groupedObjects;
+		std::vector<InstanceBatch> instanceBatches;
+		std::vector<InstanceData> instanceData;
+		std::vector<std::tuple<const Mesh*, const Material*, uint32_t, uint32_t>> instanceSortKeys;	// mesh, 材质, layers, 物体下标
+		std::shared_ptr<VertexBufferObject> instanceBuffer;
+		uint32_t instanceBufferCapacity = 0;
+
+		// 这一帧只画 impostor 的物体（按 meshObjects 的下标），以及要画的 impostor 面片
+		std::vector<uint8_t> hiddenObjects;
+		std::vector<MeshObject*> impostorDraws;
+
+		// 最近一次 computeCascadeSplits 划分的深度范围
+		std::pair<float, float> cascadeDepthRange{ 0.f, 0.f };
+
+		// 视野内同时属于 MAIN_VIEW 和 SHADOW_RECEIVER 的物体在 view space 中的深度范围，夹在相机的 near 和 far 之间
+		// 没有这样的物体时返回 false。没有包围盒的 mesh 视为覆盖整个深度范围
+		bool getReceiverDepthRange(const RenderingScene& scene, float& nearZ, float& farZ) const;
+
+		// DEPTH_READBACK：每帧主 pass 之后把深度缓冲复制到一个 staging texture，轮流使用，读回时不等待 GPU
+		static constexpr uint32_t DEPTH_READBACK_LATENCY = 3;
+		struct DepthReadback {
+			Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+			RenderingScene::CameraInfo camera;		// 复制时的相机，用于把深度换算成 view space z
+			uint64_t sequence = 0;					// 第几次复制，越大越新
+			bool pending = false;
+		};
+		std::array<DepthReadback, DEPTH_READBACK_LATENCY> depthReadbacks;
+		uint32_t nextDepthReadback = 0;				// 下一次复制使用的
+		uint64_t nextDepthReadbackSequence = 1;
+		bool hasReadbackDepthRange = false;
+		std::pair<float, float> readbackDepthRange{ 0.f, 0.f };
+
+		void requestDepthReadback(const RenderingScene::CameraInfo& camera);
+
+		// 读回已经完成的复制中最新的一个，得到深度范围，更早的复制直接丢弃。从来没有读回过时返回 false
+		bool resolveDepthReadbacks(float& nearZ, float& farZ);
+
+		// 把场景中属于 includeLayers 的物体分成单独绘制和实例化绘制两部分，并上传实例数据
+		// impostor 也在这里按场景自己的相机选择，所以各个 pass（包括阴影）对同一个物体的选择一致
+		// occlusionCulling 且 enableOcclusionCulling 时跳过被遮挡缓冲中的遮挡体完全挡住的物体和显式实例
+		void prepareInstances(const RenderingScene& scene, uint32_t includeLayers, bool occlusionCulling = false);
+
+		// 软件遮挡剔除。同一帧内同一个场景、同样的 includeLayers 只光栅化一次，容器在帧之间复用
+		const RenderingScene* preparedOcclusionScene = nullptr;
+		uint32_t preparedOcclusionLayers = 0;
+		OcclusionBuffer occlusionBuffer;
+		DirectX::XMMATRIX occlusionTrans_W2C;
+		std::vector<std::pair<float, const MeshObject*>> occluderCandidates;	// 包围球在屏幕上的直径, 物体
+		OcclusionCullingStatistics occlusionStatistics;
+
+		// 按场景自己的相机选出 includeLayers 中屏幕上最大的 maxOccluders 个遮挡体（不含只画 impostor 的物体）并光栅化
+		void prepareOcclusionBuffer(const RenderingScene& scene, uint32_t includeLayers);
+
+		// mesh 的包围盒是否被遮挡缓冲中的遮挡体完全挡住。没有包围盒的 mesh 总是可见
+		bool isOccluded(const Mesh& mesh, DirectX::FXMMATRIX trans_L2W);
+
+		// 分簇光照。同一帧内同一个场景只构建一次，容器在帧之间复用
+		const RenderingScene* preparedLightScene = nullptr;
+		std::vector<ClusterLight> clusterLights;
+		LightClusterGrid lightClusters;
+		std::shared_ptr<StructuredBufferObject> lightBuffer;
+		std::shared_ptr<StructuredBufferObject> lightClusterBuffer;
+		std::shared_ptr<StructuredBufferObject> clusterLightIndexBuffer;
+
+		// 按场景自己的相机构建 lightClusters，并上传光源、froxel 和光源下标
+		void prepareLightClusters(const RenderingScene& scene);
+
+		// impostor 面片的可见比例：0 表示只画 mesh，1 表示只画 impostor
+		float getImpostorFade(const MeshObject& impostor, const RenderingScene::CameraInfo& camera) const;
+
+		// 一个 pass 中把局部空间的误差换算成像素所需的相机参数
+		struct LodView {
+			DirectX::XMMATRIX trans_W2V;
+			bool perspective;
+			float pixelsPerUnit;		// 透视投影时是距离为 1 处每单位长度的像素数
+			float nearZ;
+			uint32_t slot;
+		};
+
+		LodView getLodView(const RenderingPass& pass) const;
+		LodView getLodView(const RenderingScene::CameraInfo& camera, float viewportHeight, uint32_t lodSlot) const;
+
+		// 按投影到屏幕上的误差选择 LOD：误差不超过 lodErrorThreshold 像素的最粗的一级
+		// 变粗时要求误差不超过阈值的 (1 - lodHysteresis) 倍，避免在阈值附近来回切换
+		uint32_t selectLod(const Mesh& mesh, DirectX::FXMMATRIX transform, const LodView& view, uint32_t previous) const;
+		uint32_t selectLod(const MeshObject& object, const LodView& view) const;
+
+		// semantic 对应的实例化 shader 不存在时逐个物体（逐个实例）绘制
+		// 一次实例化绘制只能使用一级 LOD：取各实例所需的最精细的一级
+		void drawInstanceBatch(const InstanceBatch& batch, const std::string& semantic, const LodView& view);
+
+		// 单 pass 级联阴影中一个物体（或一个显式实例）在一级 cascade 中的绘制。容器在帧之间复用
+		struct CascadeDraw {
+			const Mesh* mesh;
+			const Material* material;
+			uint32_t lod;
+			uint32_t cascade;		// RenderingPass::cascades 的下标
+			MeshObject* object;		// 提供 mesh 和材质
+			uint32_t instance;		// instanceData 中的下标，不是显式实例时为 UINT32_MAX
+
+			bool operator<(const CascadeDraw& other) const {
+				return std::tie(mesh, material, lod, cascade) < std::tie(other.mesh, other.material, other.lod, other.cascade);
+			}
+		};
+		std::vector<CascadeDraw> cascadeDraws;
+		std::vector<CascadeDraw> cascadeFallbackDraws;		// mesh 没有 CASCADED_DEPTH_MAP shader，逐级绘制
+		std::vector<CascadeInstanceData> cascadeInstanceData;
+		std::shared_ptr<VertexBufferObject> cascadeInstanceBuffer;
+		uint32_t cascadeInstanceBufferCapacity = 0;
+
+		// 绘制 pass.cascades 中的各级 cascade：按包围球剔除，按 (mesh, 材质, LOD) 合并成实例化绘制。结束时恢复 per-frame VS 常数
+		void drawCascades(const RenderingPass& pass);
+
+		// 每帧临时对象（pass、pass 列表）的内存，beginRendering 时重置
+		FrameArena frameArena;
+
 		uint32_t width = 0, height = 0;
 
 		void updateFixedPerframeConstantBuffers(const RenderingScene& scene) const {
@@ -373,13 +554,18 @@ namespace LiteEngine::Rendering {
 
 				data.exposure = this->exposure;
 
-				auto numberOfLights = scene.lights.size();
-				if (numberOfLights > 4) {
-					// TODO: log warning..
-					numberOfLights = 4;
-				}
-				data.numberOfLights = (uint32_t)numberOfLights;
-				memcpy(data.lights, scene.lights.data(), sizeof(LightDesc) * numberOfLights);
+				// 光源本身在 structured buffer 中（prepareLightClusters）
+				data.numberOfLights = (uint32_t)scene.lights.size();
+
+				auto& clusterCamera = this->lightClusters.getCamera();
+				data.clusterCount[0] = this->lightClusters.getTilesX();
+				data.clusterCount[1] = this->lightClusters.getTilesY();
+				data.clusterCount[2] = this->lightClusters.getSlices();
+				data.clusterPerspective = clusterCamera.perspective;
+				data.clusterViewScale[0] = clusterCamera.viewScaleX;
+				data.clusterViewScale[1] = clusterCamera.viewScaleY;
+				data.clusterZScale = this->lightClusters.getZScale();
+				data.clusterZBias = this->lightClusters.getZBias();
 
 				this->fixedPerframePSConstantBuffer->updateBuffer(this->context.Get());
 			}
@@ -406,10 +592,43 @@ namespace LiteEngine::Rendering {
 		bool autoAdjustSize = false;
 		float exposure = 1.0;
 
+		// 使用相同 Rendering::Mesh 和材质的物体达到这个数目时自动合并成一次实例化绘制，0 表示不自动合并
+		// 只对有实例化 shader（Mesh::setInstancedShader）且没有自定义 constant buffer 的物体生效
+		uint32_t automaticInstancingThreshold = 2;
+
+		// LOD 选择，见 selectLod。关闭时总是绘制第 0 级
+		bool enableLod = true;
+		float lodErrorThreshold = 1.0f;		// 像素
+		float lodHysteresis = 0.25f;
+
+		// impostor（见 RenderingScene::impostors）：包围球在屏幕上的直径小于 impostorPixelSize 像素时只画 impostor，
+		// 大于 impostorPixelSize + impostorFadePixels 时只画 mesh，之间两者都画，impostor 按比例抖动地逐渐覆盖 mesh
+		bool enableImpostors = true;
+		float impostorPixelSize = 48;
+		float impostorFadePixels = 32;
+
+		// 软件遮挡剔除（见 OcclusionBuffer）：主 pass 提交之前，在 CPU 上把画面中最大的几个遮挡体（Mesh::occluder 不为空的物体）
+		// 光栅化到一张低分辨率的深度图，包围盒被完全挡住的物体和显式实例不提交。包围球在屏幕上的直径小于 minOccluderPixels 像素的不作为遮挡体
+		bool enableOcclusionCulling = true;
+		uint32_t maxOccluders = 16;
+		float minOccluderPixels = 64;
+
+		const OcclusionCullingStatistics& getOcclusionCullingStatistics() const {
+			return occlusionStatistics;
+		}
+
+		// 一个模型的 impostor 面片。三张图集见 SceneManagement::ImpostorAtlas，每次调用创建独立的材质常量
+		std::shared_ptr<MeshObject> createImpostorMeshObject(
+			PtrShaderResourceView albedo,
+			PtrShaderResourceView normal,
+			PtrShaderResourceView emission,
+			uint32_t framesPerSide
+		);
+
 
 	protected:
 		Renderer(HWND windowHwnd) {
-			// TODO MSAA. ⲻһر׵顣
+			// TODO MSAA. 这不是一个特别容易的事情。。
 
 			RECT rect;
 			GetClientRect(windowHwnd, &rect);
@@ -426,7 +645,7 @@ namespace LiteEngine::Rendering {
 			swap_chain_desc.BufferCount = 2;
 			swap_chain_desc.BufferDesc.Height = this->height;
 			swap_chain_desc.BufferDesc.Width = this->width;
-			// RGBAûSRGB: pixel shader Ӧعǿ
+			// RGBA（没有SRGB）: pixel shader 应当返回光强
 			swap_chain_desc.BufferDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
 			swap_chain_desc.BufferDesc.RefreshRate.Numerator = 0;
 			swap_chain_desc.BufferDesc.RefreshRate.Denominator = 1;
@@ -463,9 +682,11 @@ namespace LiteEngine::Rendering {
 			this->recreateDepthStencilView();
 			this->recreateShadowDepthBuffer();
 
+			this->geometryPool = std::shared_ptr<GeometryPool>(new GeometryPool(this->device.Get(), this->context.Get()));
+
 			this->fixedPerframeVSConstantBuffer = this->createConstantBuffer(FixedPerframeVSConstantBufferData());
 			this->fixedPerframePSConstantBuffer = this->createConstantBuffer(FixedPerframePSConstantBufferData());
-			// TODO:  designed fps û
+			// TODO: 下面的 designed fps 没有设置
 			this->fixedLongtermConstantBuffer = this->createConstantBuffer(FixedLongtermConstantBufferData{ (float)this->width, (float)this->height, (float)30 });
 		}
 
@@ -512,12 +733,12 @@ namespace LiteEngine::Rendering {
 			this->recreateShadowDepthBuffer();
 		}
 
-		// һεҪ hwnd ֮
+		// 第一次调用需要传递 hwnd 参数，之后调用
 		static bool setHandle(HWND hwnd);
 		static Renderer& getInstance();
 		static HWND getHandle();
 
-		// Դ̶ constԺ¼״̬
+		// 资源创建过程都不加 const，方便以后记录状态。。
 		std::shared_ptr<VertexShader> createVertexShader(
 			const std::vector<uint8_t>& vertexShaderByteCode
 		) {
@@ -534,6 +755,14 @@ namespace LiteEngine::Rendering {
 			return out;
 		}
 
+		PtrGeometryShader createGeometryShader(
+			const std::vector<uint8_t>& geometryShaderByteCode
+		) {
+			PtrGeometryShader out;
+			device->CreateGeometryShader(geometryShaderByteCode.data(), geometryShaderByteCode.size(), nullptr, &out);
+			return out;
+		}
+
 		// IndexBufferObject
 		PtrIndexBufferObject createIndexBufferObject(
 			const uint32_t* indices,
@@ -567,6 +796,63 @@ namespace LiteEngine::Rendering {
 			return std::shared_ptr<VertexBufferObject>(new VertexBufferObject(vertexBuffer, desc, elementSize));
 		}
 
+		// 只能通过 updateDynamicStructuredBuffer 修改，内容在第一次更新之前未定义
+		std::shared_ptr<StructuredBufferObject> createDynamicStructuredBuffer(uint32_t capacity, uint32_t elementSize) {
+			std::shared_ptr<StructuredBufferObject> out(new StructuredBufferObject());
+			out->capacity = capacity;
+			out->elementSize = elementSize;
+
+			CD3D11_BUFFER_DESC desc(capacity * elementSize, D3D11_BIND_SHADER_RESOURCE,
+				D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE, D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, elementSize);
+			if (FAILED(device->CreateBuffer(&desc, nullptr, &out->buffer))) {
+				throw std::exception("failed to create a structured buffer");
+			}
+			CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(D3D11_SRV_DIMENSION_BUFFER, DXGI_FORMAT_UNKNOWN, 0, capacity);
+			if (FAILED(device->CreateShaderResourceView(out->buffer.Get(), &viewDesc, &out->view))) {
+				throw std::exception("failed to create a structured buffer view");
+			}
+			return out;
+		}
+
+		// 与 updateDynamicVertexBufferObject 相同，使用 WRITE_DISCARD。bytes 不能超过创建时的大小
+		void updateDynamicStructuredBuffer(const StructuredBufferObject& buffer, const void* data, size_t bytes) {
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			if (FAILED(context->Map(buffer.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+				throw std::exception("failed to map a structured buffer");
+			}
+			memcpy(mapped.pData, data, bytes);
+			context->Unmap(buffer.buffer.Get(), 0);
+		}
+
+		// 每帧由 CPU 整体重写的顶点（例如蒙皮的结果），只能通过 updateDynamicVertexBufferObject 修改
+		std::shared_ptr<VertexBufferObject> createDynamicVertexBufferObject(
+			const void* vertices,
+			uint32_t count, uint32_t elementSize,
+			std::shared_ptr<InputElementDescriptions> desc
+		) {
+			ID3D11Buffer* vertexBuffer;
+			CD3D11_BUFFER_DESC vertexBufferDesc(count * elementSize, D3D11_BIND_VERTEX_BUFFER,
+				D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+			D3D11_SUBRESOURCE_DATA vertexSubresData = {};
+			vertexSubresData.pSysMem = vertices;
+			// vertices 为空时内容未定义，第一次使用前需要 update
+			if (FAILED(device->CreateBuffer(&vertexBufferDesc, vertices ? &vertexSubresData : nullptr, &vertexBuffer))) {
+				throw std::exception("failed to create a dynamic vertex buffer");
+			}
+
+			return std::shared_ptr<VertexBufferObject>(new VertexBufferObject(vertexBuffer, desc, elementSize));
+		}
+
+		// WRITE_DISCARD：驱动给 buffer 换一块新内存，不需要等 GPU 用完上一帧的数据。bytes 不能超过创建时的大小
+		void updateDynamicVertexBufferObject(const VertexBufferObject& vbo, const void* vertices, size_t bytes) {
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			if (FAILED(context->Map(vbo.vertices.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+				throw std::exception("failed to map a dynamic vertex buffer");
+			}
+			memcpy(mapped.pData, vertices, bytes);
+			context->Unmap(vbo.vertices.Get(), 0);
+		}
+
 		template<typename ElementType>
 		std::shared_ptr<VertexBufferObject> createVertexBufferObject(
 			const std::vector<ElementType> vertices,
@@ -613,6 +899,29 @@ namespace LiteEngine::Rendering {
 				vshader, inputLayout, depthMapShader, depthMapInputLayout);
 		}
 
+		// 静态几何体应当从这里分配，而不是各自创建 buffer
+		GeometryPool& getGeometryPool() {
+			return *geometryPool;
+		}
+
+		// start: 相对于 indices 起点；indices 中的值相对于 vertices 起点
+		std::shared_ptr<Mesh> createMesh(
+			PtrGeometryAllocation vertices,
+			PtrGeometryAllocation indices,
+			uint32_t start,
+			uint32_t count,
+			std::shared_ptr<VertexShader> vshader,
+			PtrInputLayout inputLayout,
+			std::shared_ptr<VertexShader> depthMapShader,
+			PtrInputLayout depthMapInputLayout
+		) {
+			return std::shared_ptr<Mesh>(
+				new Mesh(vertices, indices, start, count,
+					vshader, inputLayout,
+					depthMapShader, depthMapInputLayout)
+			);
+		}
+
 		std::shared_ptr<Mesh> createMesh(
 			std::shared_ptr<VertexBufferObject> vbo,
 			PtrIndexBufferObject ibo,
@@ -676,7 +985,7 @@ namespace LiteEngine::Rendering {
 			return rt;
 		}
 
-		// СΪ 1  textureд shader ʱΪ texture ޶ϡ
+		// 大小为 1 的 texture，写 shader 的时候不用因为各种 texture 的有无而排列组合。。
 		PtrShaderResourceView createDefaultTexture(
 			const DirectX::XMFLOAT4& data = DirectX::XMFLOAT4(1, 1, 1, 1),
 			int textureDim = 2
@@ -714,6 +1023,12 @@ namespace LiteEngine::Rendering {
 		}
 
 	public:
+		// 只在 CPU 上解码，不访问 device，可以在工作线程中调用。输出 R8G8B8A8_UNORM
+		static TextureData decodeTexture2DFromWIC(const uint8_t* memory, size_t size);
+
+		// 使用 data 中的全部 mip 创建纹理
+		PtrShaderResourceView createTexture2D(const TextureData& data);
+
 		PtrShaderResourceView createSimpleTexture2DFromWIC(const std::wstring& file);
 		PtrShaderResourceView createSimpleTexture2DFromWIC(const uint8_t* memory, size_t size);
 		PtrShaderResourceView createCubeMapFromDDS(const std::wstring& file);
@@ -744,13 +1059,29 @@ namespace LiteEngine::Rendering {
 
 			this->clearShaderResourcesAndSamplers();
 
+			// 上一帧的资源已经全部提交，此时移动几何池中的数据不影响绘制
+			this->geometryPool->collectGarbage();
+
+			this->lastFrameInputAssemblerStatistics = this->inputAssemblerCache;
+			this->inputAssemblerCache = InputAssemblerCache();
+
+			// 上一帧的场景可能已经释放，地址会被新的场景复用
+			this->preparedInstanceScene = nullptr;
+			this->preparedLightScene = nullptr;
+			this->preparedOcclusionScene = nullptr;
+
+			// 上一帧的 pass 应该都已经释放
+			this->frameArena.reset();
+
 			float bgColor[4] = { 0, 0, 0, 1 };
 			context->ClearRenderTargetView(this->renderTargetView.Get(), bgColor);
 			context->ClearDepthStencilView(this->depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1, 0);
 		}
 
+		// passes: RenderingPassList 或者 std::vector<std::shared_ptr<RenderingPass>>
+		template <typename PassList>
 		void renderPasses(
-			const std::vector<std::shared_ptr<RenderingPass>>& passes,
+			const PassList& passes,
 			uint32_t start = 0,
 			uint32_t length = UINT32_MAX
 		) {
@@ -773,6 +1104,12 @@ namespace LiteEngine::Rendering {
 			if(this->customPerframePSConstantBuffer)
 				modifiableData.customPerframePSConstants = this->customPerframePSConstantBuffer->getInternalData();
 			
+			// 在 modifier 修改相机（如阴影 pass）之前准备，impostor 按场景自己的相机选择
+			if (!pass->disableRendering) {
+				this->prepareInstances(*pass->scene, pass->includeLayers, pass->occlusionCulling);
+				if (pass->clusteredLighting) this->prepareLightClusters(*pass->scene);
+			}
+
 			if (pass->beforeRenderModifier) {
 				pass->beforeRenderModifier(modifiableData);
 			}
@@ -799,6 +1136,13 @@ namespace LiteEngine::Rendering {
 					context->PSSetSamplers(SamplerSlots::CSM_DEPTH_MAP, 1, pass->CSMDepthMapSampler.GetAddressOf());
 				}
 
+				if (pass->clusteredLighting) {
+					ID3D11ShaderResourceView* views[] = {
+						this->lightBuffer->view.Get(), this->lightClusterBuffer->view.Get(), this->clusterLightIndexBuffer->view.Get()
+					};
+					context->PSSetShaderResources(TextureSlots::LIGHTS, 3, views);
+				}
+
 
 				context->OMSetRenderTargets(1, pass->renderTargetView.GetAddressOf(), pass->depthStencilView.Get());
 				context->OMSetDepthStencilState(pass->depthStencilState.Get(), 1);
@@ -807,8 +1151,25 @@ namespace LiteEngine::Rendering {
 
 				this->setConstantBuffers();
 
-				for (auto obj : pass->scene->meshObjects) {
-					obj->draw(this->context.Get(), pass->vsSemantic);
+				this->inputAssemblerCache.invalidate();
+				this->inputAssemblerCache.passes++;
+				if (pass->cascadeCount > 0) {
+					this->drawCascades(*pass);
+				} else {
+					auto lodView = this->getLodView(*pass);
+					for (auto obj : this->singleDraws) {
+						obj->draw(this->context.Get(), pass->vsSemantic, &this->inputAssemblerCache, this->selectLod(*obj, lodView));
+					}
+					if (!this->instanceBatches.empty()) {
+						UINT stride = sizeof(InstanceData), offset = 0;
+						context->IASetVertexBuffers(INSTANCE_DATA_SLOT, 1, this->instanceBuffer->vertices.GetAddressOf(), &stride, &offset);
+						for (auto& batch : this->instanceBatches) {
+							this->drawInstanceBatch(batch, pass->vsSemantic, lodView);
+						}
+					}
+					for (auto obj : this->impostorDraws) {
+						obj->draw(this->context.Get(), pass->vsSemantic, &this->inputAssemblerCache);
+					}
 				}
 
 				this->clearShaderResourcesAndSamplers();
@@ -835,9 +1196,10 @@ namespace LiteEngine::Rendering {
 			this->shadowWidth = (float)this->width;
 			this->shadowHeight = (float)this->height;	
 			this->shadowDepthBuffer = this->createDepthTextureArray(
-				MAX_NUMBER_OF_LIGHTS * NUMBER_SHADOW_MAP_PER_LIGHT, 
+				MAX_NUMBER_OF_SHADOWED_LIGHTS * NUMBER_SHADOW_MAP_PER_LIGHT, 
 				(uint32_t)std::round(this->shadowWidth), 
-				(uint32_t)std::round(this->shadowHeight)
+				(uint32_t)std::round(this->shadowHeight),
+				NUMBER_SHADOW_MAP_PER_LIGHT
 			);
 		}
 
@@ -860,5 +1222,49 @@ namespace LiteEngine::Rendering {
 			swapChain->Present(1, 0);
 		}
 
+		// 阴影图的预算，下一次 createShadowMapPasses 时生效
+		ShadowBudget shadowBudget;
+
+		// CSM 的分界，renderScene 时按场景计算。手动调用 createShadowMapPasses 时可以用 computeCascadeSplits 得到
+		CascadeSplitMode cascadeSplitMode = CascadeSplitMode::RECEIVER_BOUNDS;
+		float cascadeSplitLambda = 0.95f;							// 对数分布的权重，其余为均匀分布。深度范围很大时应接近 1
+		CascadeSplits fixedCascadeSplits = { 0, 3, 10, 30, 100 };	// FIXED。第一个值总是换成相机的 near
+
+		// 按 cascadeSplitMode 为场景的相机计算 CSM 的分界
+		CascadeSplits computeCascadeSplits(const RenderingScene& scene);
+
+		// 最近一次 computeCascadeSplits 划分的深度范围（view space z）
+		std::pair<float, float> getCascadeDepthRange() const {
+			return cascadeDepthRange;
+		}
+
+		// 一个光源的所有 cascade 在同一个 pass 中绘制：每个物体只提交一次，实例化到与它相交的各级 cascade
+		// 深度图需要有分组的 view（DepthTextureArray::groupDepthBuffers），否则仍然每级 cascade 一个 pass
+		bool singlePassCascades = true;
+
+		// 最近一次 createShadowMapPasses 选择了哪些光源、各自的 cascade 和分辨率，以及因为预算放弃了什么
+		const ShadowPlan& getShadowPlan() const {
+			return shadowPlan;
+		}
+
+		// 上一帧（两次 beginRendering 之间）的 pass 数、draw call 数、实例化绘制的实例数、三角形数（LOD 前后）和 IA 绑定次数
+		const InputAssemblerCache& getLastFrameInputAssemblerStatistics() const {
+			return lastFrameInputAssemblerStatistics;
+		}
+
+		// 只在渲染线程使用。分配的内存在下一次 beginRendering 时失效
+		FrameArena& getFrameArena() {
+			return frameArena;
+		}
+
+		RenderingPassList createRenderingPassList() {
+			return RenderingPassList(FrameAllocator<std::shared_ptr<RenderingPass>>(frameArena));
+		}
+
+		// lastFrameBlockAllocations 不为 0 说明上一帧 arena 向堆申请了内存；稳定之后应当一直为 0
+		FrameArena::Statistics getFrameArenaStatistics() const {
+			return frameArena.getStatistics();
+		}
+
 	};
 }
\ No newline at end of file
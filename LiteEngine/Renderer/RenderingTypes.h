@@ -0,0 +1,134 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace LiteEngine::Rendering {
+
+	// Renderer 与 SoftwareRenderer 共用的、与 D3D 无关的类型：图层、光源、相机和阴影的划分
+	// 阴影的划分（Shadow.h）只依赖这里，两个后端用同一套 pass
+
+	// MeshObject::layers 与 RenderingPass::includeLayers 的位。物体与 pass 至少有一位相同时才会在这个 pass 中绘制
+	// NOTE: SHADOW_RECEIVER 也在 hlsl 中使用（Definitions.hlsli），不要忘记同时修改
+	namespace RenderLayers {
+		constexpr uint32_t SHADOW_CASTER = 1 << 0;			// 在最近一级阴影中投射阴影
+		constexpr uint32_t SHADOW_CASTER_DISTANT = 1 << 1;	// 在其余各级阴影中投射阴影。很小的物体可以只保留 SHADOW_CASTER
+		constexpr uint32_t SHADOW_RECEIVER = 1 << 2;		// 着色时采样阴影贴图。不是 pass 的筛选条件
+		constexpr uint32_t MAIN_VIEW = 1 << 3;
+		constexpr uint32_t REFLECTION = 1 << 4;
+		constexpr uint32_t HUD = 1 << 5;
+
+		constexpr uint32_t DEFAULT = SHADOW_CASTER | SHADOW_CASTER_DISTANT | SHADOW_RECEIVER | MAIN_VIEW | REFLECTION;
+	}
+
+	// 场景中的光源数量没有限制（见 LightClusterGrid），最多 MAX_NUMBER_OF_SHADOWED_LIGHTS 个有阴影（见 ShadowBudget）
+	constexpr uint32_t MAX_NUMBER_OF_SHADOWED_LIGHTS = 4;
+	constexpr uint32_t NUMBER_SHADOW_MAP_PER_LIGHT = 4;
+
+	// CSM 各级的分界（view space z），包含 near 和 far 平面
+	using CascadeSplits = std::array<float, NUMBER_SHADOW_MAP_PER_LIGHT + 1>;
+
+	// CSM 的分界如何确定（Renderer::cascadeSplitMode）。除 FIXED 外都在得到的深度范围内按 getPracticalCascadeSplits 划分
+	enum class CascadeSplitMode {
+		FIXED,				// Renderer::fixedCascadeSplits
+		RECEIVER_BOUNDS,	// 视野内接收阴影的物体的包围球在 view space 中的深度范围
+		DEPTH_READBACK,		// 几帧之前主 pass 深度缓冲的深度范围（不等待 GPU 地读回），还没有结果时与 RECEIVER_BOUNDS 相同
+	};
+
+	// 每帧阴影图的预算，由 planShadows（Shadow.h）分配给各个光源
+	struct ShadowBudget {
+		uint32_t maxPasses = 8;						// 深度图（每个光源的每一级 cascade 一张）的数目
+		uint64_t maxTexels = 4096ull * 4096;		// 这些深度图视口的像素总数
+		uint32_t maxResolutionShift = 2;			// 视口的边长最多缩小到 1 / 2^maxResolutionShift
+		float minimumIrradiance = 0.01f;			// 不限距离的点光源和聚光灯在照度低于此值的地方视为照不到
+	};
+
+	struct ShadowedLight {
+		uint32_t lightID;				// RenderingScene::lights 中的下标
+		float score;
+		uint32_t cascadeMask;			// 第 i 位表示渲染第 i 级 cascade
+		uint32_t resolutionShift;		// 只使用深度图左上角 (width >> shift) x (height >> shift) 的区域
+	};
+
+	// 一帧的阴影决定
+	struct ShadowPlan {
+		std::vector<float> scores;				// 各光源对画面的估计贡献，下标与 RenderingScene::lights 相同，0 表示照不到视野
+		std::vector<ShadowedLight> lights;		// 有阴影的光源，按 score 从大到小，下标即在深度图中的 slot
+		uint32_t passes = 0;
+		uint64_t texels = 0;
+
+		// 因为预算降级的次数，不包括本来就不需要的 cascade（光源照不到那一段深度）
+		uint32_t droppedCascades = 0;
+		uint32_t reducedResolutions = 0;
+		uint32_t droppedLights = 0;				// 包括超出 MAX_NUMBER_OF_SHADOWED_LIGHTS 的
+	};
+
+	namespace LightType {
+		constexpr uint32_t LIGHT_TYPE_POINT = 0x0;
+		constexpr uint32_t LIGHT_TYPE_DIRECTIONAL = 0x1;
+		constexpr uint32_t LIGHT_TYPE_SPOT = 0x2;
+	}
+
+	namespace LightShadow {
+		constexpr uint32_t LIGHT_SHADOW_EMPTY = 0x1;
+		constexpr uint32_t LIGHT_SHADOW_HARD = 0x2;
+		constexpr uint32_t LIGHT_SHADOW_SOFT = 0x3;	// TODO: unimplemented
+	}
+
+	// 同时是 StructuredBuffer 的元素，hlsli 中的 Light 需要显式填充到相同的布局
+	struct alignas(16) LightDesc {
+		// NOTE: 不要忘记修改 hlsli
+		uint32_t type;						// all
+		uint32_t shadow;					// all
+		float innerConeAngle;			    // spot
+		float outerConeAngle;				// spot
+		
+		DirectX::XMFLOAT3 position_W;		// spot & point
+		float maximumDistance;				// spot & point
+	
+		DirectX::XMFLOAT3 direction_W;		// spot & directional
+	private:
+		float _space2;
+
+	public:
+		DirectX::XMFLOAT3 intensity;		// all
+	};
+
+	static_assert(sizeof(LightDesc) == 4 * 4 + 3 * 4 * 4, "`LightDesc` is not aligned correctly");
+
+	struct CameraInfo {
+		enum class ProjectionType { PERSPECTIVE, ORTHOGRAPHICS };
+
+		DirectX::XMMATRIX trans_W2V;		// world to view transformation
+		ProjectionType projectionType = ProjectionType::PERSPECTIVE;
+
+		union {
+			// perspective only
+			struct {
+				float fieldOfViewYRadian;
+				float aspectRatio;	// width / height
+			};
+
+			// ortho only
+			struct {
+				float viewWidth;
+				float viewHeight;
+			};
+		};
+
+		float nearZ;
+		float farZ;
+
+		DirectX::XMMATRIX getV2CMatrix() const {
+			if (projectionType == ProjectionType::PERSPECTIVE) {
+				return DirectX::XMMatrixPerspectiveFovLH(fieldOfViewYRadian, aspectRatio, nearZ, farZ);
+			}else {
+				return DirectX::XMMatrixOrthographicLH(viewWidth, viewHeight, nearZ, farZ);
+			}
+		}
+	};
+
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
 #include <DirectXPackedVector.h>
 #include <d3d11.h>
 #include <wrl.h>
 
+#include <array>
 #include <vector>
 #include <atomic>
 #include <memory>
@@ -13,42 +15,49 @@
 #include <typeinfo>
 #include <functional>
 
+#include "GeometryPool.h"
+#include "OcclusionCulling.h"
+#include "RenderingTypes.h"
+
 namespace LiteEngine::Rendering {
 
 	namespace ShaderSemantics {
 		constexpr auto DEFAULT = "DEFAULT";
 		constexpr auto DEPTH_MAP = "DEPTH_MAP";
+		// 一个光源的所有 cascade 在一次实例化绘制中完成（见 Renderer::singlePassCascades）
+		// 只有实例化的 vertex shader，每个实例的数据是 CascadeInstanceData
+		constexpr auto CASCADED_DEPTH_MAP = "CASCADED_DEPTH_MAP";
 	}
 
-	// Ŀǰ buffer ȫͬһףû VS PS
+	// 目前 buffer 全用同一套，没有区分 VS PS
 	namespace VSConstantBufferSlotID {
-		// Զ buffer
-		constexpr uint32_t LONGTERM_CUSTOM = 0;		// ڣһ֡
-		constexpr uint32_t PERFRAME_CUSTOM = 1;			// һ֡
-		constexpr uint32_t MESH_OBJECT_CUSTOM = 2;			// ÿ
+		// 自定义 buffer
+		constexpr uint32_t LONGTERM_CUSTOM = 0;		// 长期（超过一帧）
+		constexpr uint32_t PERFRAME_CUSTOM = 1;			// 一帧
+		constexpr uint32_t MESH_OBJECT_CUSTOM = 2;			// 每个物体
 
-		// ̶ buffer
+		// 固定 buffer
 		constexpr uint32_t LONGTERM_FIXED = 3;
 		constexpr uint32_t PERFRAME_FIXED = 4;
 		constexpr uint32_t MESH_OBJECT_FIXED = 5;
 	};
 
 	namespace PSConstantBufferSlotID {
-		// Զ buffer
-		constexpr uint32_t LONGTERM_CUSTOM = 0;		// ڣһ֡
-		constexpr uint32_t PERFRAME_CUSTOM = 1;			// һ֡
-		constexpr uint32_t MESH_OBJECT_CUSTOM = 2;			// ÿ
+		// 自定义 buffer
+		constexpr uint32_t LONGTERM_CUSTOM = 0;		// 长期（超过一帧）
+		constexpr uint32_t PERFRAME_CUSTOM = 1;			// 一帧
+		constexpr uint32_t MESH_OBJECT_CUSTOM = 2;			// 每个物体
 
-		// ̶ buffer
+		// 固定 buffer
 		constexpr uint32_t LONGTERM_FIXED = 3;
 		constexpr uint32_t PERFRAME_FIXED = 4;
 		constexpr uint32_t MESH_OBJECT_FIXED = 5;
 
-		//  
+		// 材质 
 		constexpr uint32_t MATERIAL = 6;
 	};
 
-	// ṹָԭСġ
+	// 这个结构体用指针的原因是他大小好像还蛮大的。。
 	using InputElementDescriptions =
 		std::vector<D3D11_INPUT_ELEMENT_DESC>;
 
@@ -66,6 +75,62 @@ namespace LiteEngine::Rendering {
 
 	using PtrIndexBufferObject = Microsoft::WRL::ComPtr<ID3D11Buffer>;
 
+	// 每帧由 CPU 整体重写、在 shader 中作为 StructuredBuffer 读取的数据
+	struct StructuredBufferObject {
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+		uint32_t capacity = 0;		// 元素个数
+		uint32_t elementSize = 0;
+	};
+
+	// 实例化绘制时第二个顶点流中每个实例的数据。两个矩阵与 FixedPerobjectConstantData 含义相同
+	struct InstanceData {
+		DirectX::XMFLOAT4X4 trans_L2W;
+		DirectX::XMFLOAT4X4 trans_W2L;
+	};
+
+	constexpr uint32_t INSTANCE_DATA_SLOT = 1;
+
+	// 在顶点的输入布局后面加上 InstanceData 对应的元素（INSTANCE_L2W0..3, INSTANCE_W2L0..3），用于创建实例化 shader 的 InputLayout
+	inline std::shared_ptr<InputElementDescriptions> appendInstanceElements(const InputElementDescriptions& vertexElements) {
+		std::shared_ptr<InputElementDescriptions> out(new InputElementDescriptions(vertexElements));
+		for (auto name : { "INSTANCE_L2W", "INSTANCE_W2L" }) {
+			for (UINT row = 0; row < 4; row++) {
+				out->push_back({ name, row, DXGI_FORMAT_R32G32B32A32_FLOAT, INSTANCE_DATA_SLOT,
+					D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+			}
+		}
+		return out;
+	}
+
+	// 单 pass 级联阴影中每个实例的数据：物体变换，以及画到深度图 array 的哪一个 slice
+	struct CascadeInstanceData {
+		DirectX::XMFLOAT4X4 trans_L2W;
+		uint32_t slice;
+	};
+
+	// 在顶点的输入布局后面加上 CascadeInstanceData 对应的元素（INSTANCE_L2W0..3, INSTANCE_SLICE），用于创建 CASCADED_DEPTH_MAP 的 InputLayout
+	inline std::shared_ptr<InputElementDescriptions> appendCascadeInstanceElements(const InputElementDescriptions& vertexElements) {
+		std::shared_ptr<InputElementDescriptions> out(new InputElementDescriptions(vertexElements));
+		for (UINT row = 0; row < 4; row++) {
+			out->push_back({ "INSTANCE_L2W", row, DXGI_FORMAT_R32G32B32A32_FLOAT, INSTANCE_DATA_SLOT,
+				D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+		}
+		out->push_back({ "INSTANCE_SLICE", 0, DXGI_FORMAT_R32_UINT, INSTANCE_DATA_SLOT,
+			D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+		return out;
+	}
+
+	// 一组实例相对于所在节点的变换及其逆矩阵，创建后不再修改，可以被多个节点共享
+	struct InstanceTransforms {
+		std::vector<DirectX::XMFLOAT4X4> transforms;
+		std::vector<DirectX::XMFLOAT4X4> inverses;
+
+		size_t getMemoryBytes() const {
+			return (transforms.size() + inverses.size()) * sizeof(DirectX::XMFLOAT4X4);
+		}
+	};
+
 	struct VertexShader {
 
 		std::vector<uint8_t> vertexShaderByteCode;
@@ -82,16 +147,46 @@ namespace LiteEngine::Rendering {
 
 	using PtrPixelShader = Microsoft::WRL::ComPtr<ID3D11PixelShader>;
 
+	using PtrGeometryShader = Microsoft::WRL::ComPtr<ID3D11GeometryShader>;
+
 	using PtrInputLayout = Microsoft::WRL::ComPtr<ID3D11InputLayout>;
 
+	// 简化后的一级 LOD：只是另一段索引，与原 mesh 共享顶点和索引 buffer
+	struct MeshLod {
+		uint32_t indicesBegin;		// 与 Mesh::indicesBegin 含义相同
+		uint32_t indicesLength;
+		float error;				// 局部空间中距原表面的距离
+	};
+
+	// MeshObject 为每个 slot 记住上次选择的 LOD，用于滞后。主 pass 和各级阴影 pass 使用不同的 slot
+	constexpr uint32_t LOD_HISTORY_SLOTS = 8;
+
 	struct Mesh {
 		std::shared_ptr<VertexBufferObject> vbo;
 		PtrIndexBufferObject indices;
-		uint32_t indicesBegin;
+		uint32_t indicesBegin;		// 使用 GeometryPool 时相对于 indexAllocation 的起点
 		uint32_t indicesLength;
+
+		// 来自 GeometryPool 时不为空，此时不使用 indices；vbo 为空时也不使用 vbo
+		// 索引是相对于 vertexAllocation 起点的，绘制时以 base vertex 的形式加上偏移
+		// 同时有 vbo 和 vertexAllocation 时顶点来自 vbo（见 withVertexBuffer），索引仍来自 indexAllocation
+		PtrGeometryAllocation vertexAllocation;
+		PtrGeometryAllocation indexAllocation;
+
+		// 局部空间中的包围盒，由加载器根据顶点计算，用于剔除。变形的 mesh 只是静止姿态的包围盒
+		DirectX::BoundingBox bounds{ { 0, 0, 0 }, { 0, 0, 0 } };
+
+		// 精度依次降低的各级 LOD，不含原始精度（第 0 级）。error 单调不减
+		std::vector<MeshLod> lods;
+
+		// 软件遮挡剔除中用来遮挡其他物体的简化网格（局部空间），为空时这个 mesh 不作为遮挡体（见 Renderer::enableOcclusionCulling）
+		std::shared_ptr<const OccluderMesh> occluder;
 	protected:
 		std::unordered_map<std::string, std::pair<std::shared_ptr<VertexShader>, PtrInputLayout>> shaders;
 		// "DEFAULT"
+
+		// 从 INSTANCE_DATA_SLOT 读取物体变换的 shader，按 pass 的 semantic 索引。没有时这个 pass 中不能实例化绘制
+		std::unordered_map<std::string, std::pair<std::shared_ptr<VertexShader>, PtrInputLayout>> instancedShaders;
 	public:
 		std::pair<std::shared_ptr<VertexShader>, PtrInputLayout> defaultShader;
 		Mesh(
@@ -114,6 +209,64 @@ namespace LiteEngine::Rendering {
 			}
 		}
 
+		Mesh(
+			PtrGeometryAllocation vertexAllocation,
+			PtrGeometryAllocation indexAllocation,
+			uint32_t indicesBegin,
+			uint32_t indicesLength,
+
+			std::shared_ptr<VertexShader> vertexShader,
+			PtrInputLayout inputLayout,
+
+			std::shared_ptr<VertexShader> depthMapVertexShader,
+			PtrInputLayout depthMapVSInputLayout
+		) : Mesh(std::shared_ptr<VertexBufferObject>(), PtrIndexBufferObject(), indicesBegin, indicesLength, vertexShader, inputLayout,
+				depthMapVertexShader, depthMapVSInputLayout) {
+			this->vertexAllocation = vertexAllocation;
+			this->indexAllocation = indexAllocation;
+		}
+
+		// 共享索引和 shader，顶点换成 vertices。vertices 的布局和顶点数必须与原来相同
+		// 用于每个实例各自变形的顶点（蒙皮、morph target）
+		std::shared_ptr<Mesh> withVertexBuffer(std::shared_ptr<VertexBufferObject> vertices) const {
+			std::shared_ptr<Mesh> out(new Mesh(*this));
+			out->vbo = vertices;
+			return out;
+		}
+
+		ID3D11Buffer* getVertexBuffer() const {
+			return vbo ? vbo->vertices.Get() : vertexAllocation->getBuffer();
+		}
+
+		uint32_t getVertexStride() const {
+			return vbo ? vbo->vertexStride : vertexAllocation->getStride();
+		}
+
+		ID3D11Buffer* getIndexBuffer() const {
+			return indexAllocation ? indexAllocation->getBuffer() : indices.Get();
+		}
+
+		uint32_t getFirstIndex(uint32_t lod = 0) const {
+			auto begin = lod == 0 ? indicesBegin : lods[lod - 1].indicesBegin;
+			return begin + (indexAllocation ? indexAllocation->getOffset() : 0);
+		}
+
+		uint32_t getIndexCount(uint32_t lod = 0) const {
+			return lod == 0 ? indicesLength : lods[lod - 1].indicesLength;
+		}
+
+		uint32_t getLodCount() const {
+			return 1 + (uint32_t)lods.size();
+		}
+
+		float getLodError(uint32_t lod) const {
+			return lod == 0 ? 0 : lods[lod - 1].error;
+		}
+
+		int32_t getBaseVertex() const {
+			return vbo || !vertexAllocation ? 0 : (int32_t)vertexAllocation->getOffset();
+		}
+
 		
 		std::pair<std::shared_ptr<VertexShader>, PtrInputLayout> getShader(const std::string& semantic) {
 			auto it = shaders.find(semantic);
@@ -124,9 +277,80 @@ namespace LiteEngine::Rendering {
 			}
 		}
 
+		// inputLayout 应当由 appendInstanceElements（CASCADED_DEPTH_MAP 为 appendCascadeInstanceElements）得到的描述创建
+		void setInstancedShader(const std::string& semantic, std::shared_ptr<VertexShader> vertexShader, PtrInputLayout inputLayout) {
+			instancedShaders[semantic] = { vertexShader, inputLayout };
+		}
+
+		bool supportsInstancing() const {
+			return !instancedShaders.empty();
+		}
+
+		// 没有对应的实例化 shader 时返回 nullptr
+		const std::pair<std::shared_ptr<VertexShader>, PtrInputLayout>* getInstancedShader(const std::string& semantic) const {
+			auto it = instancedShaders.find(semantic);
+			return it == instancedShaders.end() ? nullptr : &it->second;
+		}
+
+	};
+
+	// 记录当前绑定到 IA 的状态，连续绘制使用相同的 buffer 和 input layout 时跳过绑定
+	// 只在一个 pass 内有效：pass 开始时调用 invalidate
+	struct InputAssemblerCache {
+		ID3D11Buffer* vertexBuffer = nullptr;
+		uint32_t vertexStride = 0;
+		ID3D11Buffer* indexBuffer = nullptr;
+		ID3D11InputLayout* inputLayout = nullptr;
+		bool topologySet = false;
+
+		// 累计值
+		uint64_t passes = 0;				// 实际绘制的 pass 数（不含 disableRendering 的）
+		uint64_t draws = 0;
+		uint64_t instancedDraws = 0;		// draws 中实例化绘制的次数
+		uint64_t instances = 0;				// 实例化绘制的实例总数
+		uint64_t triangles = 0;				// 实际提交的三角形数
+		uint64_t fullDetailTriangles = 0;	// 全部使用第 0 级 LOD 时会提交的三角形数
+		uint64_t vertexBufferBinds = 0;
+		uint64_t indexBufferBinds = 0;
+		uint64_t inputLayoutBinds = 0;
+
+		void invalidate() {
+			vertexBuffer = nullptr;
+			vertexStride = 0;
+			indexBuffer = nullptr;
+			inputLayout = nullptr;
+			topologySet = false;
+		}
+
+		void bind(ID3D11DeviceContext* context, const Mesh& mesh, ID3D11InputLayout* layout) {
+			auto vertices = mesh.getVertexBuffer();
+			UINT stride = mesh.getVertexStride(), offset = 0;
+			if (vertices != vertexBuffer || stride != vertexStride) {
+				context->IASetVertexBuffers(0, 1, &vertices, &stride, &offset);
+				vertexBuffer = vertices;
+				vertexStride = stride;
+				vertexBufferBinds++;
+			}
+			auto indices = mesh.getIndexBuffer();
+			if (indices != indexBuffer) {
+				context->IASetIndexBuffer(indices, DXGI_FORMAT_R32_UINT, 0);
+				indexBuffer = indices;
+				indexBufferBinds++;
+			}
+			if (layout != inputLayout) {
+				context->IASetInputLayout(layout);
+				inputLayout = layout;
+				inputLayoutBinds++;
+			}
+			if (!topologySet) {
+				context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+				topologySet = true;
+			}
+			draws++;
+		}
 	};
 
-	// Constant Buffer ù̶ slotshader resource  sampler ò̶ slot
+	// Constant Buffer 用固定的 slot，shader resource 和 sampler 用不固定的 slot
 	class ConstantBuffer {
 	protected:
 		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
@@ -137,9 +361,11 @@ namespace LiteEngine::Rendering {
 		ConstantBuffer(const ConstantBuffer&) = default;
 
 	public:
+		// 共享同一个 GPU buffer，CPU 端数据复制一份
 		std::shared_ptr<ConstantBuffer> getSharedInstance() {
 			auto c = std::shared_ptr<ConstantBuffer>(new ConstantBuffer(*this));
 			c->internalData = new uint8_t[dataSize];
+			memcpy(c->internalData, internalData, dataSize);
 			return c;
 		}
 
@@ -192,6 +418,33 @@ namespace LiteEngine::Rendering {
 		PtrRenderTargetView renderTargetView;
 	};
 
+	// CPU 端的二维纹理数据，可以在任意线程准备，之后交给 Renderer 创建 GPU 资源
+	// 各级 mip 按从大到小的顺序连续存放在 pixels 里
+	struct TextureData {
+		struct MipLevel {
+			uint32_t width;
+			uint32_t height;
+			size_t offset;			// 在 pixels 中的偏移
+			uint32_t rowPitch;
+			uint32_t slicePitch;
+		};
+
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		std::vector<MipLevel> mips;
+		std::vector<uint8_t> pixels;
+
+		uint32_t getWidth() const { return mips.empty() ? 0 : mips[0].width; }
+		uint32_t getHeight() const { return mips.empty() ? 0 : mips[0].height; }
+
+		const uint8_t* getMipData(size_t level) const {
+			return pixels.data() + mips[level].offset;
+		}
+
+		uint8_t* getMipData(size_t level) {
+			return pixels.data() + mips[level].offset;
+		}
+	};
+
 
 	struct Material {
 		PtrPixelShader defaultShader;
@@ -216,23 +469,38 @@ namespace LiteEngine::Rendering {
 				context->PSSetConstantBuffers(PSConstantBufferSlotID::MATERIAL, 1, this->constants->getAddressOf());
 			}
 
+			this->bindShaderResourcesAndSamplers(context);
+		}
+
+	protected:
+		static void bindShaderResourceView(ID3D11DeviceContext* context, const PtrShaderResourceView& view, uint32_t slot) {
+			if (view == nullptr) {
+				ID3D11ShaderResourceView* nullView = nullptr;
+				context->PSSetShaderResources(slot, 1, &nullView);
+			} else {
+				// view.Get() == 0x00000120f7a25f70 
+				context->PSSetShaderResources(slot, 1, view.GetAddressOf());
+			}
+		}
+
+		static void bindSamplerState(ID3D11DeviceContext* context, const PtrSamplerState& sampler, uint32_t slot) {
+			if (sampler == nullptr) {
+				ID3D11SamplerState* nullSampler = nullptr;
+				context->PSSetSamplers(slot, 1, &nullSampler);
+			} else {
+				context->PSSetSamplers(slot, 1, sampler.GetAddressOf());
+			}
+		}
+
+		// 每次 draw 都会调用。默认实现通过 getShaderResourceViews / getSamplerStates 复制出 vector，
+		// 子类应当直接从成员绑定，避免每次 draw 都分配内存
+		virtual void bindShaderResourcesAndSamplers(ID3D11DeviceContext* context) {
 			for (auto& [view, slot] : this->getShaderResourceViews()) {
-				if (view == nullptr) {
-					ID3D11ShaderResourceView* view = nullptr;
-					context->PSSetShaderResources(slot, 1, &view);
-				} else {
-					// view.Get() == 0x00000120f7a25f70 
-					context->PSSetShaderResources(slot, 1, view.GetAddressOf());
-				}
+				bindShaderResourceView(context, view, slot);
 			}
 
 			for (auto& [sampler, slot] : this->getSamplerStates()) {
-				if (sampler == nullptr) {
-					ID3D11SamplerState* sampler = nullptr;
-					context->PSSetSamplers(slot, 1, &sampler);
-				} else {
-					context->PSSetSamplers(slot, 1, sampler.GetAddressOf());
-				}
+				bindSamplerState(context, sampler, slot);
 			}
 		}
 	};
@@ -247,6 +515,16 @@ namespace LiteEngine::Rendering {
 			return samplerStates;
 		}
 
+	protected:
+		virtual void bindShaderResourcesAndSamplers(ID3D11DeviceContext* context) {
+			for (auto& [view, slot] : this->shaderResourceViews) {
+				bindShaderResourceView(context, view, slot);
+			}
+
+			for (auto& [sampler, slot] : this->samplerStates) {
+				bindSamplerState(context, sampler, slot);
+			}
+		}
 	};
 
 
@@ -255,25 +533,29 @@ namespace LiteEngine::Rendering {
 	// V: view
 	// C: clip
 	struct FixedPerobjectConstantData {
-		// Note: ޸ĸýṹʱǵͬʱ޸ shader ! (ObjectFixedConstants)
+		// Note: 修改该结构体的时候记得同时修改 shader 代码! (ObjectFixedConstants)
 
-		// 
+		// 正向
 		DirectX::XMMATRIX trans_L2W;
 
-		// 
+		// 逆向
 		DirectX::XMMATRIX trans_W2L;
 
-		// ߽
+		// RenderLayers
+		uint32_t layers;
+		char _space[12];
+
+		// 法线矫正
 	};
 
 	class MeshObject {
 		std::shared_ptr<Mesh> mesh;
-		//  Mesh Ĳ  Shader ƥ䣬ô InputLayout ʱӦþͻᱨɣ
+		// 如果 Mesh 的布局 和 Shader 不匹配，那么创建 InputLayout 的时候应该就会报错吧？
 
-		// fixedConstant: VS PS 
+		// fixedConstant: VS PS 共享
 		std::shared_ptr<ConstantBuffer> fixedConstantBuffer;
 
-		// customConstant: 
+		// customConstant: 分离
 		std::shared_ptr<ConstantBuffer> customVSConstantBuffer;
 		std::shared_ptr<ConstantBuffer> customPSConstantBuffer;
 
@@ -282,6 +564,7 @@ namespace LiteEngine::Rendering {
 			val.trans_L2W = this->transform;
 			auto det = DirectX::XMMatrixDeterminant(this->transform);
 			val.trans_W2L = DirectX::XMMatrixInverse(&det, this->transform);
+			val.layers = this->layers;
 
 			fixedConstantBuffer->updateBuffer(context);
 
@@ -294,6 +577,12 @@ namespace LiteEngine::Rendering {
 		std::shared_ptr<Material> material;
 		DirectX::XMMATRIX transform = DirectX::XMMatrixIdentity(); // 4 x 4 x 4 = 128 bytes, local_to_world
 
+		// RenderLayers 的组合。由 SceneManagement 构建场景时写入（见 SceneManagement::RenderLayerMask）
+		uint32_t layers = RenderLayers::DEFAULT;
+
+		// 每个 slot 上次选择的 LOD，由 Renderer 维护
+		mutable std::array<uint8_t, LOD_HISTORY_SLOTS> lodHistory{};
+
 		MeshObject(
 			std::shared_ptr<Mesh> mesh,
 			std::shared_ptr<Material> material,
@@ -305,21 +594,54 @@ namespace LiteEngine::Rendering {
 			customVSConstantBuffer(customVSConstantBuffer),
 			customPSConstantBuffer(customPSConstantBuffer) {}
 
-		void draw(ID3D11DeviceContext* context, const std::string& semantic) const {
+		std::shared_ptr<Mesh> getMesh() const {
+			return mesh;
+		}
+
+		// 不复制 shared_ptr，用于每帧遍历所有物体的地方
+		const Mesh& getMeshData() const {
+			return *mesh;
+		}
+
+		// 有自定义 constant buffer 的物体不能与其他物体合并成一次实例化绘制
+		bool hasCustomConstantBuffers() const {
+			return customVSConstantBuffer || customPSConstantBuffer;
+		}
+
+		void setMesh(std::shared_ptr<Mesh> mesh) {
+			this->mesh = mesh;
+		}
+
+		// 共享 mesh、材质和 constant buffer 的 GPU 资源，只复制每个物体自己的 CPU 端数据
+		std::shared_ptr<MeshObject> clone() const {
+			std::shared_ptr<MeshObject> out(new MeshObject(
+				mesh, material,
+				fixedConstantBuffer->getSharedInstance(),
+				customVSConstantBuffer ? customVSConstantBuffer->getSharedInstance() : nullptr,
+				customPSConstantBuffer ? customPSConstantBuffer->getSharedInstance() : nullptr
+			));
+			out->transform = transform;
+			out->layers = layers;
+			return out;
+		}
+
+		// cache 为空时每次都重新绑定 IA
+		void draw(ID3D11DeviceContext* context, const std::string& semantic, InputAssemblerCache* cache = nullptr, uint32_t lod = 0) const {
 			auto [vshader, layout] = this->mesh->getShader(semantic);
 			auto pshader = this->material == nullptr ? nullptr : this->material->getShader(semantic);
 
 			this->updateFixedConstantBuffer(context, pshader == nullptr);
 
 			// IA input assembly
-			UINT strideVertex = this->mesh->vbo->vertexStride, offsetVertex = 0;
-			context->IASetVertexBuffers(0, 1, this->mesh->vbo->vertices.GetAddressOf(), &strideVertex, &offsetVertex);
-			context->IASetIndexBuffer(this->mesh->indices.Get(), DXGI_FORMAT_R32_UINT, 0);
-			context->IASetInputLayout(layout.Get());
-			context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			if (cache) {
+				cache->bind(context, *this->mesh, layout.Get());
+			} else {
+				InputAssemblerCache uncached;
+				uncached.bind(context, *this->mesh, layout.Get());
+			}
 
 			// VS vertex shader 
-			// Qs: ʲô class instance
+			// Qs: 什么是 class instance
 			context->VSSetShader(vshader->vertexShader.Get(), nullptr, 0);
 			context->VSSetConstantBuffers(VSConstantBufferSlotID::MESH_OBJECT_FIXED, 1, this->fixedConstantBuffer->getAddressOf());
 			if (this->customVSConstantBuffer)
@@ -334,8 +656,46 @@ namespace LiteEngine::Rendering {
 			} else {
 				context->PSSetShader(nullptr, nullptr, 0);
 			}
+			if (cache) {
+				cache->triangles += this->mesh->getIndexCount(lod) / 3;
+				cache->fullDetailTriangles += this->mesh->getIndexCount() / 3;
+			}
+
 			// draw
-			context->DrawIndexed(this->mesh->indicesLength, this->mesh->indicesBegin, 0);
+			context->DrawIndexed(this->mesh->getIndexCount(lod), this->mesh->getFirstIndex(lod), this->mesh->getBaseVertex());
+		}
+
+		// 用本物体的 mesh 和材质画 instanceCount 个实例，变换来自 INSTANCE_DATA_SLOT 上已绑定的实例 buffer，忽略 transform
+		// 本物体的 fixed constant buffer 仍然绑定给 PS：所有实例共用其中的 layers（是否接收阴影）
+		// mesh 必须有 semantic 对应的实例化 shader（见 Mesh::getInstancedShader）
+		void drawInstanced(
+			ID3D11DeviceContext* context,
+			const std::string& semantic,
+			uint32_t firstInstance,
+			uint32_t instanceCount,
+			InputAssemblerCache* cache,
+			uint32_t lod = 0
+		) const {
+			auto& [vshader, layout] = *this->mesh->getInstancedShader(semantic);
+			auto pshader = this->material == nullptr ? nullptr : this->material->getShader(semantic);
+
+			this->updateFixedConstantBuffer(context, pshader == nullptr);
+
+			cache->bind(context, *this->mesh, layout.Get());
+			cache->instancedDraws++;
+			cache->instances += instanceCount;
+			cache->triangles += (uint64_t)this->mesh->getIndexCount(lod) / 3 * instanceCount;
+			cache->fullDetailTriangles += (uint64_t)this->mesh->getIndexCount() / 3 * instanceCount;
+
+			context->VSSetShader(vshader->vertexShader.Get(), nullptr, 0);
+			context->VSSetConstantBuffers(VSConstantBufferSlotID::MESH_OBJECT_FIXED, 1, this->fixedConstantBuffer->getAddressOf());
+			context->PSSetShader(pshader ? pshader.Get() : nullptr, nullptr, 0);
+			if (pshader) {
+				context->PSSetConstantBuffers(PSConstantBufferSlotID::MESH_OBJECT_FIXED, 1, this->fixedConstantBuffer->getAddressOf());
+			}
+
+			context->DrawIndexedInstanced(this->mesh->getIndexCount(lod), instanceCount,
+				this->mesh->getFirstIndex(lod), this->mesh->getBaseVertex(), firstInstance);
 		}
 
 	};
@@ -345,6 +705,10 @@ namespace LiteEngine::Rendering {
 		uint32_t height;
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureArray;
 		std::vector<PtrDepthStencilView> depthBuffers;
+
+		// 每 groupSize 个连续的 slice 一个 view（例如一个光源的所有 cascade），用于一次画到多个 slice。没有分组时为空
+		uint32_t groupSize = 0;
+		std::vector<PtrDepthStencilView> groupDepthBuffers;
 	};
 
 }
\ No newline at end of file
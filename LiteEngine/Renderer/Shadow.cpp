@@ -1,62 +1,74 @@
 #include "Shadow.h"
-#include "../Utilities/Utilities.h"
 
 #include <array>
 #include <algorithm>
+#include <cmath>
 
 
 
 namespace LiteEngine::Rendering {
 
-	// vec3. w ض 1
-	std::vector<std::array<DirectX::XMVECTOR, 4>> getConeCutCorners(
+	// vec3. w 必定是 1
+	std::array<DirectX::XMVECTOR, 4> getConeCutCorners(
 		DirectX::XMMATRIX transform, // trans_V2W
 		float aspectRatio,
 		float fieldOfViewY,
-		const std::vector<float> zList
+		float z
 	) {
-		std::vector<std::array<DirectX::XMVECTOR, 4>> out;
-
 		auto hUnit = tanf(fieldOfViewY / 2);
 		auto wUnit = hUnit * aspectRatio;
 
-		for (auto z : zList) {
-			std::array<DirectX::XMVECTOR, 4> localCorners = {
-				DirectX::XMVECTOR{wUnit * z * -1, wUnit * z * +1, z, 1},
-				DirectX::XMVECTOR{wUnit * z * -1, wUnit * z * -1, z, 1},
-				DirectX::XMVECTOR{wUnit * z * +1, wUnit * z * +1, z, 1},
-				DirectX::XMVECTOR{wUnit * z * +1, wUnit * z * -1, z, 1}
-			};
+		std::array<DirectX::XMVECTOR, 4> localCorners = {
+			DirectX::XMVECTOR{wUnit * z * -1, wUnit * z * +1, z, 1},
+			DirectX::XMVECTOR{wUnit * z * -1, wUnit * z * -1, z, 1},
+			DirectX::XMVECTOR{wUnit * z * +1, wUnit * z * +1, z, 1},
+			DirectX::XMVECTOR{wUnit * z * +1, wUnit * z * -1, z, 1}
+		};
+
+		std::array<DirectX::XMVECTOR, 4> worldCorners;
+
+		std::transform(localCorners.begin(), localCorners.end(), worldCorners.begin(), [&](auto val) {
+			auto world = DirectX::XMVector3TransformCoord(val, transform);
+			return world;
+		});
 
-			std::array<DirectX::XMVECTOR, 4> worldCorners;
+		return worldCorners;
+	}
 
-			std::transform(localCorners.begin(), localCorners.end(), worldCorners.begin(), [&](auto val) {
-				auto world = DirectX::XMVector3TransformCoord(val, transform);
-				return world;
-			});
+	CascadeSplits getPracticalCascadeSplits(float nearZ, float farZ, float lambda) {
+		if (nearZ <= 0) lambda = 0;
+		lambda = std::clamp(lambda, 0.f, 1.f);
 
-			out.push_back(worldCorners);
+		CascadeSplits out;
+		for (uint32_t i = 0; i <= NUMBER_SHADOW_MAP_PER_LIGHT; i++) {
+			float t = (float)i / NUMBER_SHADOW_MAP_PER_LIGHT;
+			float uniform = nearZ + (farZ - nearZ) * t;
+			float logarithmic = lambda > 0 ? nearZ * std::pow(farZ / nearZ, t) : uniform;
+			out[i] = lambda * logarithmic + (1 - lambda) * uniform;
 		}
+		// 两端不受浮点误差影响
+		out[0] = nearZ;
+		out[NUMBER_SHADOW_MAP_PER_LIGHT] = farZ;
 		return out;
 	}
 
-	// spot light Ҳһ
+	// spot light 也一样
 	// suitable, W2V, V2W(transform)
-	std::pair<bool, Rendering::RenderingScene::CameraInfo> getPointLightDepthMapMatrix(
+	std::pair<bool, Rendering::CameraInfo> getPointLightDepthMapMatrix(
 		DirectX::XMVECTOR lightCoord3,	// w == 1
 		DirectX::XMVECTOR up,			// w == 0
-		std::array<DirectX::XMVECTOR, 8> rangeWorld	// ҪķΧ, vector3, w == 1
+		std::array<DirectX::XMVECTOR, 8> rangeWorld	// 需要照亮的范围, vector3, w == 1
 	) {
-		// Ŀ귶Χĵ㡱
+		// 求出目标范围“中心点”
 		DirectX::XMVECTOR rangeCoordSum = {};
 		for (auto& pos : rangeWorld) {
 			rangeCoordSum = DirectX::XMVectorAdd(pos, rangeCoordSum);
 		}
 		DirectX::XMVECTOR worldCenter = DirectX::XMVectorScale(rangeCoordSum, 1.f / 8);
 
-		// ʹĵ㣬ָ top
+		// 使得深度相机朝向中心点，并且指定 top
 		// corner case: transZ == 0
-		// corner casetop  transZ ƽУô΢ƫ top
+		// corner case：top 和 transZ 平行，那么略微偏移 top
 		auto transZ = DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(worldCenter, lightCoord3));
 		DirectX::XMFLOAT4 transZ4;
 		DirectX::XMStoreFloat4(&transZ4, transZ);
@@ -74,7 +86,7 @@ namespace LiteEngine::Rendering {
 		auto det = DirectX::XMMatrixDeterminant(lightTransform);
 		auto transformInv = DirectX::XMMatrixInverse(&det, lightTransform);
 
-		// ͶӰԴ view space AABB
+		// 将点投影到光源的 view space，并求出 AABB
 		std::array<DirectX::XMFLOAT3, 8> range;
 		std::transform(rangeWorld.begin(), rangeWorld.end(), range.begin(), [&](auto val) {
 			auto coord = DirectX::XMVector3TransformCoord(val, transformInv);
@@ -98,22 +110,22 @@ namespace LiteEngine::Rendering {
 			if (val.z < minimums.z) minimums.z = val.z;
 		}
 
-		Rendering::RenderingScene::CameraInfo info;
-		// 
+		Rendering::CameraInfo info;
+		// 不合适
 		if (minimums.z <= 0) {
 			return { false, info };
 		}
 
 		info.trans_W2V = transformInv;
-		info.projectionType = Rendering::RenderingScene::CameraInfo::ProjectionType::PERSPECTIVE; 
+		info.projectionType = Rendering::CameraInfo::ProjectionType::PERSPECTIVE; 
 		info.nearZ = minimums.z;
 		info.farZ = maximums.z;
 		info.aspectRatio = 
 			std::max(abs(maximums.x), abs(minimums.x)) / 
 			std::max(abs(maximums.y), abs(minimums.y));
 		info.fieldOfViewYRadian = 2 * atanf(std::max(abs(maximums.y), abs(minimums.y)) / minimums.z);
-		// 
-		constexpr float FOV_THRESHOLD = (float)(170.f / 180.f * PI);
+		// 不合适
+		constexpr float FOV_THRESHOLD = 170.f / 180.f * DirectX::XM_PI;
 		if (!std::isfinite(info.fieldOfViewYRadian) ||
 			info.fieldOfViewYRadian > FOV_THRESHOLD ||
 			info.fieldOfViewYRadian <= 0
@@ -125,19 +137,19 @@ namespace LiteEngine::Rendering {
 	}
 
 
-	Rendering::RenderingScene::CameraInfo getDirectionalLightDepthMapMatrix(
+	Rendering::CameraInfo getDirectionalLightDepthMapMatrix(
 		DirectX::XMVECTOR lightDirection,	// w == 1
 		DirectX::XMVECTOR up,			// w == 0
-		std::array<DirectX::XMVECTOR, 8> rangeWorld	// ҪķΧ, vector3, w == 1
+		std::array<DirectX::XMVECTOR, 8> rangeWorld	// 需要照亮的范围, vector3, w == 1
 	) {
-		//// Ŀ귶Χĵ㡱
+		//// 求出目标范围“中心点”
 		//DirectX::XMVECTOR rangeCoordSum = {};
 		//for (auto& pos : rangeWorld) {
 		//	rangeCoordSum = DirectX::XMVectorAdd(pos, rangeCoordSum);
 		//}
 		//DirectX::XMVECTOR worldCenter = DirectX::XMVectorScale(rangeCoordSum, 1.f / 8);
 
-		// ͹߳һ£ up
+		// 相机朝向和光线朝向一致，并保持 up
 		auto transZ = DirectX::XMVector3Normalize(lightDirection);
 		DirectX::XMFLOAT4 transZ4;
 		DirectX::XMStoreFloat4(&transZ4, transZ);
@@ -150,7 +162,7 @@ namespace LiteEngine::Rendering {
 		auto detLightRotate = DirectX::XMMatrixDeterminant(lightRotate);
 		auto lightRotateInv = DirectX::XMMatrixInverse(&detLightRotate, lightRotate);
 
-		// ͶӰԴ view space AABB
+		// 将点投影到光源的 view space，并求出 AABB
 		std::array<DirectX::XMFLOAT3, 8> range;
 		std::transform(rangeWorld.begin(), rangeWorld.end(), range.begin(), [&](auto val) {
 			auto coord = DirectX::XMVector3TransformCoord(val, lightRotateInv);
@@ -174,23 +186,18 @@ namespace LiteEngine::Rendering {
 			if (val.z < minimums.z) minimums.z = val.z;
 		}
 
-		Rendering::RenderingScene::CameraInfo info;
+		Rendering::CameraInfo info;
 
-		// ƶʹ÷Χ
+		// 移动，使得范围合适
 		float offset = minimums.z - (maximums.z - minimums.z) * 0.01f;
 
-		auto lightTransform = DirectX::XMMatrixMultiply(
-			DirectX::XMMatrixTranslation(0, 0, offset),
-			lightRotate
-		);
-
 		auto transformInv = DirectX::XMMatrixMultiply(
 			lightRotateInv,
 			DirectX::XMMatrixTranslation(0, 0, -offset)
 		);
 
 		info.trans_W2V = transformInv;
-		info.projectionType = Rendering::RenderingScene::CameraInfo::ProjectionType::ORTHOGRAPHICS; 
+		info.projectionType = Rendering::CameraInfo::ProjectionType::ORTHOGRAPHICS; 
 		info.nearZ = minimums.z - offset;
 		info.farZ = maximums.z - offset;
 		info.viewWidth = info.aspectRatio = 2 * std::max(abs(maximums.x), abs(minimums.x));
@@ -202,53 +209,230 @@ namespace LiteEngine::Rendering {
 
 
 
-	std::vector<std::tuple<bool, Rendering::RenderingScene::CameraInfo, float, float>> 
-	getSuggestedDepthCamera(
-		const Rendering::RenderingScene::CameraInfo& mainCamera,
+	void getSuggestedDepthCamera(
+		const Rendering::CameraInfo& mainCamera,
 		const Rendering::LightDesc& light,
-		const std::vector<float>& zLists  // Ҫ near  far ƽ
+		const float* zList,
+		uint32_t zCount,
+		DepthCameraSuggestion* out
 	) {
 		auto trans_W2V_det = DirectX::XMMatrixDeterminant(mainCamera.trans_W2V);
 		auto trans_V2W = DirectX::XMMatrixInverse(&trans_W2V_det, mainCamera.trans_W2V);
+		DirectX::XMVECTOR upDir = DirectX::XMVector3TransformNormal({0, 1, 0, 0}, trans_V2W);
 
-		auto corners = getConeCutCorners(
-			trans_V2W, 
-			mainCamera.aspectRatio, 
-			mainCamera.fieldOfViewYRadian, 
-			zLists
-		);
+		if (zCount < 2) return;
 
-		if (light.type == Rendering::LightType::LIGHT_TYPE_DIRECTIONAL) {
-			DirectX::XMVECTOR upDir = DirectX::XMVector3TransformNormal({0, 1, 0, 0}, trans_V2W);
-			std::vector<std::tuple<bool, Rendering::RenderingScene::CameraInfo, float, float>> out;
-			for (size_t i = 1; i < corners.size(); i++) {
-				std::array<DirectX::XMVECTOR, 8> arr;
-				std::copy(corners[i - 1].begin(), corners[i - 1].end(), arr.begin());
-				std::copy(corners[i].begin(), corners[i].end(), arr.begin() + 4);
+		// 相邻两级共用一个截面，逐级计算，不需要保存全部截面
+		auto nearCorners = getConeCutCorners(trans_V2W, mainCamera.aspectRatio, mainCamera.fieldOfViewYRadian, zList[0]);
+		for (uint32_t i = 1; i < zCount; i++) {
+			auto farCorners = getConeCutCorners(trans_V2W, mainCamera.aspectRatio, mainCamera.fieldOfViewYRadian, zList[i]);
 
+			std::array<DirectX::XMVECTOR, 8> arr;
+			std::copy(nearCorners.begin(), nearCorners.end(), arr.begin());
+			std::copy(farCorners.begin(), farCorners.end(), arr.begin() + 4);
+
+			if (light.type == Rendering::LightType::LIGHT_TYPE_DIRECTIONAL) {
 				DirectX::XMVECTOR lightDirection = DirectX::XMLoadFloat3(&light.direction_W);
 
 				auto camera = getDirectionalLightDepthMapMatrix(lightDirection, upDir, arr);
-				out.push_back({true, camera, zLists[i - 1], zLists[i] });
+				out[i - 1] = { true, camera, zList[i - 1], zList[i] };
+			} else {
+				DirectX::XMVECTOR lightCoords = DirectX::XMLoadFloat3(&light.position_W);
+
+				auto [feasible, camera] = getPointLightDepthMapMatrix(lightCoords, upDir, arr);
+				out[i - 1] = { feasible, camera, zList[i - 1], zList[i] };
 			}
 
-			return out;
+			nearCorners = farCorners;
+		}
+	}
 
-		} else {
-			DirectX::XMVECTOR upDir = DirectX::XMVector3TransformNormal({0, 1, 0, 0}, trans_V2W);
-			std::vector<std::tuple<bool, Rendering::RenderingScene::CameraInfo, float, float>> out;
-			for (size_t i = 1; i < corners.size(); i++) {
-				std::array<DirectX::XMVECTOR, 8> arr;
-				std::copy(corners[i - 1].begin(), corners[i - 1].end(), arr.begin());
-				std::copy(corners[i].begin(), corners[i].end(), arr.begin() + 4);
+	std::vector<DepthCameraSuggestion> getSuggestedDepthCamera(
+		const Rendering::CameraInfo& mainCamera,
+		const Rendering::LightDesc& light,
+		const std::vector<float>& zLists  // 需要包含 near 和 far 平面
+	) {
+		std::vector<DepthCameraSuggestion> out(zLists.size() < 2 ? 0 : zLists.size() - 1);
+		getSuggestedDepthCamera(mainCamera, light, zLists.data(), (uint32_t)zLists.size(), out.data());
+		return out;
+	}
 
-				DirectX::XMVECTOR lightCoords = DirectX::XMLoadFloat3(&light.position_W);
+	namespace {
 
-				auto [feasible, camera] = getPointLightDepthMapMatrix(lightCoords, upDir, arr);
-				out.push_back({feasible, camera, zLists[i - 1], zLists[i] });
+		uint32_t countCascades(uint32_t mask) {
+			uint32_t count = 0;
+			for (; mask; mask &= mask - 1) count++;
+			return count;
+		}
+
+		// 光源对画面的估计贡献，以及它照得到的 cascade
+		struct LightContribution {
+			float score = 0;
+			float coverage = 0;			// 照亮的区域占屏幕的比例
+			uint32_t cascadeMask = 0;
+		};
+
+		LightContribution estimateContribution(
+			const Rendering::CameraInfo& camera,
+			const Rendering::LightDesc& light,
+			const float* zList,
+			uint32_t cascades,
+			float minimumIrradiance
+		) {
+			LightContribution out;
+			float luminance = 0.2126f * light.intensity.x + 0.7152f * light.intensity.y + 0.0722f * light.intensity.z;
+			if (!(luminance > 0)) return out;
+
+			if (light.type == Rendering::LightType::LIGHT_TYPE_DIRECTIONAL) {
+				out.score = luminance;
+				out.coverage = 1;
+				out.cascadeMask = (1u << cascades) - 1;
+				return out;
+			}
+
+			// 照得到的范围：maximumDistance 和照度降到 minimumIrradiance 的距离中较小的
+			float radius = std::sqrt(luminance / minimumIrradiance);
+			if (light.maximumDistance > 0) radius = std::min(radius, light.maximumDistance);
+
+			// view space 中的包围球。聚光灯取锥体的外接球：窄的锥体球心在轴上，宽的锥体以底面圆为球的大圆
+			auto center = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&light.position_W), camera.trans_W2V);
+			if (light.type == Rendering::LightType::LIGHT_TYPE_SPOT && light.outerConeAngle < DirectX::XM_PIDIV2) {
+				auto direction = DirectX::XMVector3Normalize(
+					DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&light.direction_W), camera.trans_W2V));
+				float cosine = std::cos(light.outerConeAngle);
+				float offset;
+				if (light.outerConeAngle <= DirectX::XM_PIDIV4) {
+					offset = radius / (2 * cosine);
+					radius = offset;
+				} else {
+					offset = radius * cosine;
+					radius = radius * std::sin(light.outerConeAngle);
+				}
+				center = DirectX::XMVectorAdd(center, DirectX::XMVectorScale(direction, offset));
 			}
+			DirectX::XMFLOAT3 c;
+			DirectX::XMStoreFloat3(&c, center);
+
+			// 与视锥不相交时照不到任何可见的东西
+			if (c.z + radius < camera.nearZ || c.z - radius > camera.farZ) return out;
+			float coverage;
+			if (camera.projectionType == Rendering::CameraInfo::ProjectionType::PERSPECTIVE) {
+				float scaleY = 1 / std::tan(camera.fieldOfViewYRadian / 2);
+				float scaleX = scaleY / camera.aspectRatio;
+				float sideX = std::sqrt(scaleX * scaleX + 1), sideY = std::sqrt(scaleY * scaleY + 1);
+				if ((std::abs(c.x) * scaleX - c.z) / sideX > radius) return out;
+				if ((std::abs(c.y) * scaleY - c.z) / sideY > radius) return out;
+
+				// 投影到屏幕上的椭圆面积，NDC 的面积是 4。相机在球内时覆盖整个屏幕
+				float length2 = c.x * c.x + c.y * c.y + c.z * c.z;
+				if (length2 <= radius * radius) {
+					coverage = 1;
+				} else {
+					float z = std::max(c.z, camera.nearZ);
+					coverage = DirectX::XM_PI * (radius * scaleX / z) * (radius * scaleY / z) / 4;
+				}
+			} else {
+				if (std::abs(c.x) - camera.viewWidth / 2 > radius) return out;
+				if (std::abs(c.y) - camera.viewHeight / 2 > radius) return out;
+				coverage = DirectX::XM_PI * radius * radius / (camera.viewWidth * camera.viewHeight);
+			}
+			out.coverage = std::min(1.f, coverage);
+
+			// 按平方反比衰减时球内的平均照度是 3 * luminance / radius^2
+			out.score = out.coverage * std::min(luminance, 3 * luminance / (radius * radius));
 
+			for (uint32_t i = 0; i < cascades; i++) {
+				if (c.z + radius >= zList[i] && c.z - radius <= zList[i + 1]) out.cascadeMask |= 1u << i;
+			}
 			return out;
 		}
+
+	}
+
+	void planShadows(
+		const Rendering::CameraInfo& mainCamera,
+		const std::vector<Rendering::LightDesc>& lights,
+		const float* zList,
+		uint32_t zCount,
+		uint32_t mapWidth,
+		uint32_t mapHeight,
+		const ShadowBudget& budget,
+		ShadowPlan& out
+	) {
+		out.scores.assign(lights.size(), 0);
+		out.lights.clear();
+		out.passes = 0;
+		out.texels = 0;
+		out.droppedCascades = 0;
+		out.reducedResolutions = 0;
+		out.droppedLights = 0;
+
+		uint32_t cascades = std::min(zCount < 2 ? 0 : zCount - 1, NUMBER_SHADOW_MAP_PER_LIGHT);
+		if (cascades == 0) return;
+
+		for (uint32_t lightID = 0; lightID < (uint32_t)lights.size(); lightID++) {
+			auto contribution = estimateContribution(mainCamera, lights[lightID], zList, cascades, budget.minimumIrradiance);
+			out.scores[lightID] = contribution.score;
+			if (contribution.score <= 0 || contribution.cascadeMask == 0) continue;
+
+			// 覆盖屏幕的 1/4 以下时边长减半，1/16 以下时再减半……
+			uint32_t shift = 0;
+			for (float coverage = contribution.coverage * 4; coverage < 1 && shift < budget.maxResolutionShift; coverage *= 4) shift++;
+			out.lights.push_back({ lightID, contribution.score, contribution.cascadeMask, shift });
+		}
+
+		std::stable_sort(out.lights.begin(), out.lights.end(), [](const ShadowedLight& a, const ShadowedLight& b) {
+			return a.score > b.score;
+		});
+		if (out.lights.size() > MAX_NUMBER_OF_SHADOWED_LIGHTS) {
+			out.droppedLights += (uint32_t)out.lights.size() - MAX_NUMBER_OF_SHADOWED_LIGHTS;
+			out.lights.resize(MAX_NUMBER_OF_SHADOWED_LIGHTS);
+		}
+
+		auto fits = [&]() {
+			out.passes = 0;
+			out.texels = 0;
+			for (auto& light : out.lights) {
+				uint64_t width = std::max(1u, mapWidth >> light.resolutionShift);
+				uint64_t height = std::max(1u, mapHeight >> light.resolutionShift);
+				uint32_t count = countCascades(light.cascadeMask);
+				out.passes += count;
+				out.texels += count * width * height;
+			}
+			return out.passes <= budget.maxPasses && out.texels <= budget.maxTexels;
+		};
+		if (fits()) return;
+
+		// 放弃远处的 cascade，每个光源保留最近的一级
+		for (uint32_t cascade = cascades - 1; cascade > 0; cascade--) {
+			for (auto it = out.lights.rbegin(); it != out.lights.rend(); ++it) {
+				uint32_t bit = 1u << cascade;
+				if (!(it->cascadeMask & bit) || !(it->cascadeMask & (bit - 1))) continue;
+				it->cascadeMask &= ~bit;
+				out.droppedCascades++;
+				if (fits()) return;
+			}
+		}
+
+		// 之后降低分辨率（先降目前分辨率最高的，相同时先降 score 低的），或者放弃整个光源（先放弃 score 低的）
+		// 降低分辨率只减少像素数，pass 数超出预算时只能放弃光源
+		while (!out.lights.empty()) {
+			ShadowedLight* reducible = nullptr;
+			if (out.passes <= budget.maxPasses) {
+				for (auto it = out.lights.rbegin(); it != out.lights.rend(); ++it) {
+					if (it->resolutionShift >= budget.maxResolutionShift) continue;
+					if (!reducible || it->resolutionShift < reducible->resolutionShift) reducible = &*it;
+				}
+			}
+
+			if (reducible) {
+				reducible->resolutionShift++;
+				out.reducedResolutions++;
+			} else {
+				out.lights.pop_back();
+				out.droppedLights++;
+			}
+			if (fits()) return;
+		}
 	}
 }
\ No newline at end of file
@@ -1,14 +1,48 @@
 #pragma once
 
-#include "Renderer.h"
-#include "Resources.h"
+#include "RenderingTypes.h"
+
+#include <tuple>
+#include <vector>
 
 namespace LiteEngine::Rendering {
-	
-	std::vector<std::tuple<bool, Rendering::RenderingScene::CameraInfo, float, float>>
+
+	// 是否可用，深度相机，该级的 near z，far z
+	using DepthCameraSuggestion = std::tuple<bool, Rendering::CameraInfo, float, float>;
+
+	// zList 包含 near 和 far 平面。结果写入 out[0 .. zCount - 1)，不分配内存
+	void getSuggestedDepthCamera(
+		const Rendering::CameraInfo& mainCamera,
+		const Rendering::LightDesc& light,
+		const float* zList,
+		uint32_t zCount,
+		DepthCameraSuggestion* out
+	);
+
+	std::vector<DepthCameraSuggestion>
 		getSuggestedDepthCamera(
-			const Rendering::RenderingScene::CameraInfo& mainCamera,
+			const Rendering::CameraInfo& mainCamera,
 			const Rendering::LightDesc& light,
-			const std::vector<float>& zLists  // Ҫ near  far ƽ
+			const std::vector<float>& zLists  // 需要包含 near 和 far 平面
 		);
+
+	// practical split scheme：第 i 个分界取 [nearZ, farZ] 上对数分布与均匀分布的插值，lambda 为对数分布的权重
+	// 对数分布要求 nearZ > 0，否则（例如正交相机）只使用均匀分布
+	CascadeSplits getPracticalCascadeSplits(float nearZ, float farZ, float lambda);
+
+	// 按估计的画面贡献（照度 × 照亮的屏幕比例）给光源排序，在 budget 内选择有阴影的光源以及各自的 cascade 和分辨率
+	// 分辨率先按光源覆盖的屏幕比例确定，超出预算时依次：
+	//   从最远一级开始放弃 cascade（同一级先放弃 score 低的光源的，每个光源至少保留一级）
+	//   降低分辨率（只在 pass 数未超出时，先降分辨率最高的），或者放弃整个光源（先放弃 score 低的）
+	// zList 包含 near 和 far 平面；mapWidth、mapHeight 是深度图的大小。out 中的容器会被复用
+	void planShadows(
+		const Rendering::CameraInfo& mainCamera,
+		const std::vector<Rendering::LightDesc>& lights,
+		const float* zList,
+		uint32_t zCount,
+		uint32_t mapWidth,
+		uint32_t mapHeight,
+		const ShadowBudget& budget,
+		ShadowPlan& out
+	);
 }
\ No newline at end of file
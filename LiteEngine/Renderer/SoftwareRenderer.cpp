@@ -0,0 +1,994 @@
+#include "SoftwareRenderer.h"
+#include "Shadow.h"
+#include "../Utilities/JobSystem.h"
+
+// 实现在 IO/DefaultLoaderGLTF.cpp 中（STB_IMAGE_WRITE_IMPLEMENTATION）
+#include "../ThirdParty/tiny_gltf/stb_image_write.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		// 三角形很少时并行的开销比光栅化本身还大
+		constexpr uint64_t MINIMUM_TRIANGLES_FOR_JOBS = 256;
+
+		// 一个 chunk 中的三角形数。近平面裁剪最多把一个三角形分成两个，chunk 中的下标占 CHUNK_INDEX_BITS 位
+		constexpr uint32_t TRIANGLES_PER_CHUNK = 4096;
+		constexpr uint32_t CHUNK_INDEX_BITS = 13;
+		static_assert(2 * TRIANGLES_PER_CHUNK <= (1u << CHUNK_INDEX_BITS), "clipped triangles must fit in the chunk index");
+
+		constexpr uint32_t EMPTY_PIXEL = UINT32_MAX;
+
+		// 一行中同时处理的像素。只用到浮点的加、乘、比较和按掩码选择
+		namespace Simd {
+#if defined(__AVX2__)
+			constexpr uint32_t LANES = 8;
+			using Float = __m256;
+			inline Float broadcast(float v) { return _mm256_set1_ps(v); }
+			inline Float load(const float* p) { return _mm256_loadu_ps(p); }
+			inline void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+			inline Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+			inline Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+			inline Float pixelCenters() { return _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f); }
+			// inclusive 时 v >= 0，否则 v > 0
+			inline Float edgeInside(Float v, bool inclusive) {
+				return _mm256_cmp_ps(v, _mm256_setzero_ps(), inclusive ? _CMP_GE_OQ : _CMP_GT_OQ);
+			}
+			inline Float less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			inline Float both(Float a, Float b) { return _mm256_and_ps(a, b); }
+			// 第 i 位是第 i 个 lane
+			inline uint32_t bits(Float mask) { return (uint32_t)_mm256_movemask_ps(mask); }
+			inline Float select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+			constexpr uint32_t LANES = 4;
+			using Float = __m128;
+			inline Float broadcast(float v) { return _mm_set1_ps(v); }
+			inline Float load(const float* p) { return _mm_loadu_ps(p); }
+			inline void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+			inline Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+			inline Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+			inline Float pixelCenters() { return _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f); }
+			inline Float edgeInside(Float v, bool inclusive) {
+				return inclusive ? _mm_cmpge_ps(v, _mm_setzero_ps()) : _mm_cmpgt_ps(v, _mm_setzero_ps());
+			}
+			inline Float less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+			inline Float both(Float a, Float b) { return _mm_and_ps(a, b); }
+			inline uint32_t bits(Float mask) { return (uint32_t)_mm_movemask_ps(mask); }
+			// SSE2 没有 blendv
+			inline Float select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+#else
+			constexpr uint32_t LANES = 1;
+			struct Float {
+				float v;
+			};
+			inline Float broadcast(float v) { return { v }; }
+			inline Float load(const float* p) { return { *p }; }
+			inline void store(float* p, Float v) { *p = v.v; }
+			inline Float add(Float a, Float b) { return { a.v + b.v }; }
+			inline Float mul(Float a, Float b) { return { a.v * b.v }; }
+			inline Float pixelCenters() { return { 0.5f }; }
+			inline Float edgeInside(Float v, bool inclusive) { return { (inclusive ? v.v >= 0 : v.v > 0) ? 1.f : 0.f }; }
+			inline Float less(Float a, Float b) { return { a.v < b.v ? 1.f : 0.f }; }
+			inline Float both(Float a, Float b) { return { a.v != 0 && b.v != 0 ? 1.f : 0.f }; }
+			inline uint32_t bits(Float mask) { return mask.v != 0 ? 1 : 0; }
+			inline Float select(Float mask, Float a, Float b) { return mask.v != 0 ? a : b; }
+#endif
+		}
+
+		static_assert(SoftwareRenderer::TILE_WIDTH % Simd::LANES == 0, "tiles must hold whole SIMD rows");
+
+		// 着色用的小向量，写法与 hlsl 对应
+		struct Float3 {
+			float x, y, z;
+
+			Float3() : x(0), y(0), z(0) {}
+			Float3(float x, float y, float z) : x(x), y(y), z(z) {}
+			Float3(const DirectX::XMFLOAT3& v) : x(v.x), y(v.y), z(v.z) {}
+
+			Float3 operator+(const Float3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+			Float3 operator-(const Float3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+			Float3 operator*(const Float3& o) const { return { x * o.x, y * o.y, z * o.z }; }
+			Float3 operator*(float s) const { return { x * s, y * s, z * s }; }
+			Float3 operator/(float s) const { return { x / s, y / s, z / s }; }
+			Float3& operator+=(const Float3& o) { x += o.x; y += o.y; z += o.z; return *this; }
+		};
+
+		Float3 operator*(float s, const Float3& v) { return v * s; }
+		float dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		float length(const Float3& v) { return std::sqrt(dot(v, v)); }
+		Float3 normalize(const Float3& v) { return v / length(v); }
+		Float3 cross(const Float3& a, const Float3& b) {
+			return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		}
+		float saturate(float v) { return std::clamp(v, 0.f, 1.f); }
+		float smoothstep(float low, float high, float v) {
+			float t = saturate((v - low) / (high - low));
+			return t * t * (3 - 2 * t);
+		}
+		Float3 gammaToLinear(const Float3& v) {
+			return { std::pow(std::max(0.f, v.x), 2.2f), std::pow(std::max(0.f, v.y), 2.2f), std::pow(std::max(0.f, v.z), 2.2f) };
+		}
+
+		// 行向量乘矩阵
+		DirectX::XMFLOAT4 transform(const DirectX::XMFLOAT3& p, const DirectX::XMFLOAT4X4& m) {
+			return {
+				p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+				p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+				p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2],
+				p.x * m.m[0][3] + p.y * m.m[1][3] + p.z * m.m[2][3] + m.m[3][3],
+			};
+		}
+
+		Float3 transformDirection(const DirectX::XMFLOAT3& v, const DirectX::XMFLOAT4X4& m) {
+			return {
+				v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0],
+				v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1],
+				v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2],
+			};
+		}
+
+		// 视锥的各个平面，第 i 位为 1 表示在第 i 个平面之外
+		uint32_t getOutcode(const DirectX::XMFLOAT4& v) {
+			return (v.x < -v.w ? 1 : 0) | (v.x > v.w ? 2 : 0) | (v.y < -v.w ? 4 : 0) | (v.y > v.w ? 8 : 0) |
+				(v.z < 0 ? 16 : 0) | (v.z > v.w ? 32 : 0);
+		}
+
+		// 像素中心 x + 0.5 落在 [low, high] 中的像素范围
+		int32_t firstPixel(float low) {
+			return (int32_t)std::ceil(low - 0.5f);
+		}
+
+		int32_t lastPixel(float high) {
+			return (int32_t)std::floor(high - 0.5f);
+		}
+
+		// 与 Renderer 中的相同：view space 中的球是否可能与相机的视锥相交
+		bool intersectsFrustum(const DirectX::XMFLOAT3& center, float radius, const CameraInfo& camera) {
+			if (center.z + radius < camera.nearZ || center.z - radius > camera.farZ) return false;
+			if (camera.projectionType == CameraInfo::ProjectionType::ORTHOGRAPHICS) {
+				return std::abs(center.x) <= camera.viewWidth / 2 + radius && std::abs(center.y) <= camera.viewHeight / 2 + radius;
+			}
+			float tanY = std::tan(camera.fieldOfViewYRadian / 2);
+			float tanX = tanY * camera.aspectRatio;
+			return std::abs(center.x) - center.z * tanX <= radius * std::sqrt(1 + tanX * tanX) &&
+				std::abs(center.y) - center.z * tanY <= radius * std::sqrt(1 + tanY * tanY);
+		}
+
+		// 物体的包围球变换到 view space。没有包围球（半径为 0）时返回 false
+		bool getViewSpaceBoundingSphere(const SoftwareObject& object, DirectX::FXMMATRIX trans_W2V,
+			DirectX::XMFLOAT3& center, float& radius) {
+			auto& mesh = *object.mesh;
+			if (mesh.boundsRadius <= 0) return false;
+
+			auto transform = DirectX::XMLoadFloat4x4(&object.trans_L2W);
+			float scale = 0;
+			for (int i = 0; i < 3; i++) {
+				scale = std::max(scale, DirectX::XMVectorGetX(DirectX::XMVector3Length(transform.r[i])));
+			}
+			radius = mesh.boundsRadius * scale;
+			auto center_W = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&mesh.boundsCenter), transform);
+			DirectX::XMStoreFloat3(&center, DirectX::XMVector3TransformCoord(center_W, trans_W2V));
+			return true;
+		}
+
+		// 与 Renderer 中的相同：阴影相机的 world to clip，再映射到深度图上的纹理坐标
+		DirectX::XMMATRIX getShadowTextureMatrix(const CameraInfo& depthCamera, float scaleX, float scaleY) {
+			return DirectX::XMMatrixMultiply(
+				DirectX::XMMatrixMultiply(
+					depthCamera.trans_W2V,
+					depthCamera.getV2CMatrix()
+				), DirectX::XMMATRIX {
+					0.5f * scaleX, 0, 0, 0,
+					0, -0.5f * scaleY, 0, 0,
+					0, 0, 1.0, 0,
+					0.5f * scaleX, 0.5f * scaleY, 0, 1
+				}
+			);
+		}
+
+		// 以下与 Shader/DefaultShader/DefaultPS.hlsl 中的同名函数相同
+		constexpr float PI = 3.14159265f;
+
+		Float3 fresnelMix(float ior, const Float3& base, const Float3& layer, float VdotHPow5) {
+			float f0 = (1 - ior) / (1 + ior);
+			f0 *= f0;
+			float fr = f0 + (1 - f0) * VdotHPow5;
+			return fr * layer + (1 - fr) * base;
+		}
+
+		float specularBRDF(const Float3& V, const Float3& H, const Float3& L, const Float3& N, float alpha) {
+			float HdotL = dot(H, L);
+			float HdotV = dot(H, V);
+			float NdotH = dot(N, H);
+			if (NdotH <= 0 || HdotL <= 0 || HdotV <= 0) return 0;
+
+			// hlsl 中还计算了可见性项，但没有用到结果
+			float a2 = alpha * alpha;
+			float d = NdotH * NdotH * (a2 - 1) + 1;
+			return a2 / (PI * d * d);
+		}
+
+		Float3 defaultMaterialBRDF(const Float3& baseColor, float metallic, float roughness, float ior,
+			const Float3& V, const Float3& L, const Float3& N) {
+			if (dot(L, N) < 0) return {};
+
+			auto H = normalize(L + V);
+			float VdotH = dot(V, H);
+			float x = std::max(0.f, 1 - std::abs(VdotH));
+			float VdotHPow5 = x * x * x * x * x;
+			float alpha = roughness * roughness;
+			auto base = (1 / PI) * baseColor;
+			float specular = specularBRDF(V, H, L, N, alpha);
+			Float3 layer{ specular, specular, specular };
+			auto dielectric = fresnelMix(ior, base, layer, VdotHPow5);
+			auto metal = layer * (baseColor + (Float3(1, 1, 1) - baseColor) * VdotHPow5);
+			return (1 - metallic) * dielectric + metallic * metal;
+		}
+
+		Float3 getNormal(const Float3& normal, Float3 tangent, const Float3& normalMapValue, float scale, bool reconstructZ) {
+			tangent = normalize(tangent - dot(tangent, normal) * normal / length(normal));
+			auto bitangent = normalize(cross(normal, tangent));
+			auto unpacked = normalMapValue * 2 - Float3(1, 1, 1);
+			if (reconstructZ) {
+				unpacked.z = std::sqrt(saturate(1 - unpacked.x * unpacked.x - unpacked.y * unpacked.y));
+			}
+			auto scaled = normalize(unpacked) * Float3(scale, scale, 1);
+			// mul(TBN, v)，TBN 的行是 tangent、bitangent、normal
+			return normalize(tangent * scaled.x + bitangent * scaled.y + normal * scaled.z);
+		}
+
+		// Shader/ClusteredLights.hlsli
+		float getLightFalloff(const LightDesc& light, const Float3& lightDir_W, float distance) {
+			float falloff = 1;
+			if (!std::isinf(light.maximumDistance) && light.maximumDistance > 0) {
+				float ratio = distance / light.maximumDistance;
+				float x = saturate(1 - ratio * ratio * ratio * ratio);
+				falloff = x * x;
+			}
+			if (light.type == LightType::LIGHT_TYPE_SPOT) {
+				float cosine = dot(lightDir_W * -1, light.direction_W);
+				falloff *= smoothstep(std::cos(light.outerConeAngle), std::cos(light.innerConeAngle), cosine);
+			}
+			return falloff;
+		}
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+	}
+
+	void SoftwareMesh::computeBounds() {
+		if (vertices.empty()) {
+			boundsCenter = { 0, 0, 0 };
+			boundsRadius = 0;
+			return;
+		}
+		DirectX::XMFLOAT3 low = vertices[0].position, high = vertices[0].position;
+		for (auto& vertex : vertices) {
+			low = { std::min(low.x, vertex.position.x), std::min(low.y, vertex.position.y), std::min(low.z, vertex.position.z) };
+			high = { std::max(high.x, vertex.position.x), std::max(high.y, vertex.position.y), std::max(high.z, vertex.position.z) };
+		}
+		boundsCenter = { (low.x + high.x) / 2, (low.y + high.y) / 2, (low.z + high.z) / 2 };
+		boundsRadius = 0;
+		for (auto& vertex : vertices) {
+			boundsRadius = std::max(boundsRadius, length(Float3(vertex.position) - Float3(boundsCenter)));
+		}
+	}
+
+	DirectX::XMFLOAT4 SoftwareTexture::sample(float u, float v) const {
+		if (width == 0 || height == 0) return { 1, 1, 1, 1 };
+
+		// 纹素中心在 (i + 0.5) / width
+		float x = u * width - 0.5f;
+		float y = v * height - 0.5f;
+		float fx = std::floor(x), fy = std::floor(y);
+		float tx = x - fx, ty = y - fy;
+		auto clampX = [this](float i) { return (uint32_t)std::clamp(i, 0.f, (float)(width - 1)); };
+		auto clampY = [this](float i) { return (uint32_t)std::clamp(i, 0.f, (float)(height - 1)); };
+		uint32_t x0 = clampX(fx), x1 = clampX(fx + 1);
+		uint32_t y0 = clampY(fy), y1 = clampY(fy + 1);
+
+		float out[4];
+		for (int c = 0; c < 4; c++) {
+			auto texel = [&](uint32_t x, uint32_t y) { return pixels[((size_t)y * width + x) * 4 + c] / 255.f; };
+			float top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * tx;
+			float bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * tx;
+			out[c] = top + (bottom - top) * ty;
+		}
+		return { out[0], out[1], out[2], out[3] };
+	}
+
+	SoftwareRenderer::SoftwareRenderer(uint32_t width, uint32_t height, uint32_t shadowMapSize) :
+		width(width), height(height), shadowMapSize(shadowMapSize) {
+		if (width == 0 || height == 0) {
+			throw std::runtime_error("software renderer size must be positive");
+		}
+		if (shadowMapSize == 0 || shadowMapSize % TILE_WIDTH != 0 || shadowMapSize % TILE_HEIGHT != 0) {
+			throw std::runtime_error("shadow map size must be a positive multiple of the tile size");
+		}
+		// 补齐到整数个 tile，SIMD 读写一行的末尾时不会越界
+		stride = (width + TILE_WIDTH - 1) / TILE_WIDTH * TILE_WIDTH;
+		uint32_t paddedHeight = (height + TILE_HEIGHT - 1) / TILE_HEIGHT * TILE_HEIGHT;
+
+		color.resize((size_t)width * height * 4);
+		depth.resize((size_t)stride * paddedHeight);
+		visibility.resize((size_t)stride * paddedHeight);
+		shadowMaps.resize(MAX_NUMBER_OF_SHADOWED_LIGHTS * NUMBER_SHADOW_MAP_PER_LIGHT);
+	}
+
+	void SoftwareRenderer::collectDraws(const SoftwareScene& scene, const CameraInfo& camera, uint32_t includeLayers, bool shade) {
+		draws.clear();
+		uint32_t vertexCount = 0;
+		auto trans_V2C = camera.getV2CMatrix();
+		for (auto& object : scene.objects) {
+			if (!(object.layers & includeLayers) || !object.mesh || object.mesh->indices.size() < 3) continue;
+
+			DirectX::XMFLOAT3 center;
+			float radius;
+			if (getViewSpaceBoundingSphere(object, camera.trans_W2V, center, radius) && !intersectsFrustum(center, radius, camera)) {
+				continue;
+			}
+
+			Draw draw;
+			draw.object = &object;
+			draw.firstVertex = vertexCount;
+			auto trans_L2W = DirectX::XMLoadFloat4x4(&object.trans_L2W);
+			DirectX::XMStoreFloat4x4(&draw.trans_L2C, DirectX::XMMatrixMultiply(DirectX::XMMatrixMultiply(trans_L2W, camera.trans_W2V), trans_V2C));
+			if (shade) {
+				// normal_W = mul(float4(normal_L, 0), trans_W2L)：W2L 在常量中是转置存放的，相当于乘 W2L 的转置
+				DirectX::XMFLOAT4X4 trans_W2L;
+				DirectX::XMStoreFloat4x4(&trans_W2L, DirectX::XMMatrixInverse(nullptr, trans_L2W));
+				for (int i = 0; i < 3; i++) {
+					for (int j = 0; j < 3; j++) draw.trans_N2W.m[i][j] = trans_W2L.m[j][i];
+				}
+			}
+			draws.push_back(draw);
+			vertexCount += (uint32_t)object.mesh->vertices.size();
+		}
+
+		clipVertices.resize(vertexCount);
+		if (shade) shadeVertices.resize(vertexCount);
+	}
+
+	void SoftwareRenderer::transformVertices(uint32_t drawID, bool shade) {
+		auto& draw = draws[drawID];
+		auto& vertices = draw.object->mesh->vertices;
+		auto& trans_L2W = draw.object->trans_L2W;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			auto& vertex = vertices[i];
+			clipVertices[draw.firstVertex + i] = transform(vertex.position, draw.trans_L2C);
+			if (!shade) continue;
+
+			auto& out = shadeVertices[draw.firstVertex + i];
+			auto position_W = transform(vertex.position, trans_L2W);
+			out.position_W = { position_W.x / position_W.w, position_W.y / position_W.w, position_W.z / position_W.w };
+			auto& n = vertex.normal;
+			auto& m = draw.trans_N2W.m;
+			out.normal_W = {
+				n.x * m[0][0] + n.y * m[1][0] + n.z * m[2][0],
+				n.x * m[0][1] + n.y * m[1][1] + n.z * m[2][1],
+				n.x * m[0][2] + n.y * m[1][2] + n.z * m[2][2],
+			};
+			auto tangent_W = transformDirection(vertex.tangent, trans_L2W);
+			out.tangent_W = { tangent_W.x, tangent_W.y, tangent_W.z };
+			out.color = vertex.color;
+			out.texCoord0 = vertex.texCoord0;
+			out.texCoord1 = vertex.texCoord1;
+		}
+	}
+
+	void SoftwareRenderer::binTriangle(Chunk& chunk, const Target& target, const ScreenTriangle& input) {
+		auto triangle = input;
+		float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+			(triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+		if (!(area != 0)) return;
+
+		// 屏幕上（y 向下）顺时针的面积为正，是正面
+		if (target.cullFront ? area > 0 : area < 0) return;
+		// 统一成正的面积，光栅化时不必区分正反面
+		if (area < 0) {
+			std::swap(triangle.x[1], triangle.x[2]);
+			std::swap(triangle.y[1], triangle.y[2]);
+			std::swap(triangle.z[1], triangle.z[2]);
+			std::swap(triangle.invW[1], triangle.invW[2]);
+			std::swap(triangle.weights[1], triangle.weights[2]);
+		}
+
+		auto [minX, maxX] = std::minmax({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		auto [minY, maxY] = std::minmax({ triangle.y[0], triangle.y[1], triangle.y[2] });
+		int32_t x0 = std::max(0, firstPixel(std::max(minX, -1.f)));
+		int32_t x1 = std::min((int32_t)target.width - 1, lastPixel(std::min(maxX, (float)target.width + 1)));
+		int32_t y0 = std::max(0, firstPixel(std::max(minY, -1.f)));
+		int32_t y1 = std::min((int32_t)target.height - 1, lastPixel(std::min(maxY, (float)target.height + 1)));
+		if (x0 > x1 || y0 > y1) return;
+
+		auto index = (uint32_t)chunk.triangles.size();
+		chunk.triangles.push_back(triangle);
+		uint32_t tilesX = (target.width + TILE_WIDTH - 1) / TILE_WIDTH;
+		for (uint32_t ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++) {
+			for (uint32_t tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++) {
+				chunk.hits.push_back({ ty * tilesX + tx, index });
+			}
+		}
+	}
+
+	void SoftwareRenderer::setupChunk(Chunk& chunk, const Target& target) {
+		chunk.triangles.clear();
+		chunk.hits.clear();
+
+		auto& draw = draws[chunk.draw];
+		auto& mesh = *draw.object->mesh;
+		auto vertexCount = (uint32_t)mesh.vertices.size();
+
+		// 裁剪空间的顶点，以及关于原三角形三个顶点的重心坐标
+		struct PolygonVertex {
+			DirectX::XMFLOAT4 position;
+			float weights[3];
+		};
+
+		auto toScreen = [&target](const PolygonVertex& v, ScreenTriangle& out, int i) {
+			float invW = 1 / v.position.w;
+			out.x[i] = (v.position.x * invW * 0.5f + 0.5f) * target.width;
+			out.y[i] = (0.5f - v.position.y * invW * 0.5f) * target.height;
+			out.z[i] = std::max(0.f, v.position.z * invW);
+			out.invW[i] = invW;
+			std::copy(v.weights, v.weights + 3, out.weights[i]);
+		};
+
+		for (uint32_t t = chunk.firstTriangle; t < chunk.lastTriangle; t++) {
+			PolygonVertex v[3];
+			uint32_t outcodeAnd = ~0u, outcodeOr = 0;
+			bool valid = true;
+			for (int i = 0; i < 3; i++) {
+				auto index = mesh.indices[(size_t)t * 3 + i];
+				if (index >= vertexCount) {
+					valid = false;
+					break;
+				}
+				v[i].position = clipVertices[draw.firstVertex + index];
+				std::fill(v[i].weights, v[i].weights + 3, 0.f);
+				v[i].weights[i] = 1;
+				auto outcode = getOutcode(v[i].position);
+				outcodeAnd &= outcode;
+				outcodeOr |= outcode;
+			}
+			// 全部在同一个平面之外
+			if (!valid || outcodeAnd != 0) continue;
+
+			// 与近平面（z = 0）相交时裁剪成一个四边形或者三角形，再按扇形拆开。其余平面由视口和深度测试处理
+			PolygonVertex polygon[4];
+			int count = 0;
+			if (outcodeOr & 16) {
+				for (int i = 0; i < 3; i++) {
+					auto& a = v[i];
+					auto& b = v[(i + 1) % 3];
+					if (a.position.z >= 0) polygon[count++] = a;
+					if ((a.position.z >= 0) != (b.position.z >= 0)) {
+						float s = a.position.z / (a.position.z - b.position.z);
+						auto& out = polygon[count++];
+						out.position = {
+							a.position.x + (b.position.x - a.position.x) * s, a.position.y + (b.position.y - a.position.y) * s,
+							0, a.position.w + (b.position.w - a.position.w) * s
+						};
+						for (int k = 0; k < 3; k++) out.weights[k] = a.weights[k] + (b.weights[k] - a.weights[k]) * s;
+					}
+				}
+			} else {
+				std::copy(v, v + 3, polygon);
+				count = 3;
+			}
+			if (std::any_of(polygon, polygon + count, [](const PolygonVertex& p) { return !(p.position.w > 0); })) continue;
+
+			for (int i = 1; i + 1 < count; i++) {
+				ScreenTriangle triangle;
+				triangle.draw = chunk.draw;
+				triangle.triangle = t;
+				toScreen(polygon[0], triangle, 0);
+				toScreen(polygon[i], triangle, 1);
+				toScreen(polygon[i + 1], triangle, 2);
+				binTriangle(chunk, target, triangle);
+			}
+		}
+
+		// 按 tile 计数排序，tile 内保持三角形的顺序
+		uint32_t tiles = ((target.width + TILE_WIDTH - 1) / TILE_WIDTH) * ((target.height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+		chunk.binOffsets.assign((size_t)tiles + 1, 0);
+		for (auto& [tile, index] : chunk.hits) chunk.binOffsets[tile + 1]++;
+		for (uint32_t i = 0; i < tiles; i++) chunk.binOffsets[i + 1] += chunk.binOffsets[i];
+		chunk.binTriangles.resize(chunk.hits.size());
+		for (auto& [tile, index] : chunk.hits) chunk.binTriangles[chunk.binOffsets[tile]++] = index;
+		// 写完之后每一项移到了下一个 tile 的开头，整体后移一项恢复
+		for (uint32_t i = tiles; i > 0; i--) chunk.binOffsets[i] = chunk.binOffsets[i - 1];
+		chunk.binOffsets[0] = 0;
+	}
+
+	uint64_t SoftwareRenderer::rasterizeTile(const Target& target, uint32_t tile) {
+		uint32_t tilesX = (target.width + TILE_WIDTH - 1) / TILE_WIDTH;
+		uint32_t tileX0 = (tile % tilesX) * TILE_WIDTH;
+		uint32_t tileY0 = (tile / tilesX) * TILE_HEIGHT;
+		uint32_t tileX1 = std::min(tileX0 + TILE_WIDTH, target.width);
+		uint32_t tileY1 = std::min(tileY0 + TILE_HEIGHT, target.height);
+
+		for (uint32_t y = tileY0; y < tileY1; y++) {
+			std::fill(target.depth + (size_t)y * target.stride + tileX0, target.depth + (size_t)y * target.stride + tileX1, 1.f);
+			if (target.visibility) {
+				std::fill(target.visibility + (size_t)y * target.stride + tileX0,
+					target.visibility + (size_t)y * target.stride + tileX1, EMPTY_PIXEL);
+			}
+		}
+
+		uint64_t written = 0;
+		auto centers = Simd::pixelCenters();
+		auto xEnd = Simd::broadcast((float)tileX1);
+		for (uint32_t c = 0; c < chunkCount; c++) {
+			auto& chunk = chunks[c];
+			for (uint32_t b = chunk.binOffsets[tile]; b < chunk.binOffsets[tile + 1]; b++) {
+				auto index = chunk.binTriangles[b];
+				auto& t = chunk.triangles[index];
+
+				// 边 i 从顶点 i 到 i + 1，E(p) = a * (p.x - x_i) + b * (p.y - y_i)，三角形内部三条边都不小于 0
+				// 像素中心恰好在边上时按 top-left 规则只算给一个三角形：左边（a > 0）和上边（a = 0, b > 0）包含边界
+				float a[3], e[3];
+				bool inclusive[3];
+				for (int i = 0; i < 3; i++) {
+					int j = (i + 1) % 3;
+					a[i] = t.y[i] - t.y[j];
+					e[i] = t.x[j] - t.x[i];
+					inclusive[i] = a[i] > 0 || (a[i] == 0 && e[i] > 0);
+				}
+
+				// 深度平面 z = z_0 + dzdx * (x - x_0) + dzdy * (y - y_0)，与 D3D 一样在屏幕空间线性插值
+				float area = e[0] * (t.y[2] - t.y[0]) + a[0] * (t.x[2] - t.x[0]);
+				float dz1 = t.z[1] - t.z[0], dz2 = t.z[2] - t.z[0];
+				float dzdx = (dz1 * (t.y[2] - t.y[0]) - dz2 * (t.y[1] - t.y[0])) / area;
+				float dzdy = (dz2 * (t.x[1] - t.x[0]) - dz1 * (t.x[2] - t.x[0])) / area;
+
+				auto [minX, maxX] = std::minmax({ t.x[0], t.x[1], t.x[2] });
+				auto [minY, maxY] = std::minmax({ t.y[0], t.y[1], t.y[2] });
+				int32_t x0 = std::max((int32_t)tileX0, firstPixel(std::max(minX, -1.f)));
+				int32_t x1 = std::min((int32_t)tileX1 - 1, lastPixel(std::min(maxX, (float)target.width + 1)));
+				int32_t y0 = std::max((int32_t)tileY0, firstPixel(std::max(minY, -1.f)));
+				int32_t y1 = std::min((int32_t)tileY1 - 1, lastPixel(std::min(maxY, (float)target.height + 1)));
+				if (x0 > x1 || y0 > y1) continue;
+				x0 -= x0 % Simd::LANES;
+
+				uint32_t id = (c << CHUNK_INDEX_BITS) | index;
+				auto a0 = Simd::broadcast(a[0]), a1 = Simd::broadcast(a[1]), a2 = Simd::broadcast(a[2]);
+				auto vdzdx = Simd::broadcast(dzdx);
+				for (int32_t y = y0; y <= y1; y++) {
+					float py = y + 0.5f;
+					// 与 x 无关的部分：E = a * p.x + (b * (p.y - y_i) - a * x_i)
+					auto r0 = Simd::broadcast(e[0] * (py - t.y[0]) - a[0] * t.x[0]);
+					auto r1 = Simd::broadcast(e[1] * (py - t.y[1]) - a[1] * t.x[1]);
+					auto r2 = Simd::broadcast(e[2] * (py - t.y[2]) - a[2] * t.x[2]);
+					auto zRow = Simd::broadcast(t.z[0] + dzdy * (py - t.y[0]) - dzdx * t.x[0]);
+					float* depthRow = target.depth + (size_t)y * target.stride;
+
+					for (int32_t x = x0; x <= x1; x += Simd::LANES) {
+						auto px = Simd::add(Simd::broadcast((float)x), centers);
+						auto inside = Simd::both(
+							Simd::both(Simd::edgeInside(Simd::add(Simd::mul(a0, px), r0), inclusive[0]),
+								Simd::edgeInside(Simd::add(Simd::mul(a1, px), r1), inclusive[1])),
+							Simd::both(Simd::edgeInside(Simd::add(Simd::mul(a2, px), r2), inclusive[2]), Simd::less(px, xEnd)));
+						if (!Simd::bits(inside)) continue;
+
+						// 深度测试 LESS
+						auto z = Simd::add(Simd::mul(vdzdx, px), zRow);
+						auto old = Simd::load(depthRow + x);
+						auto pass = Simd::both(inside, Simd::less(z, old));
+						uint32_t mask = Simd::bits(pass);
+						if (!mask) continue;
+						Simd::store(depthRow + x, Simd::select(pass, z, old));
+
+						for (uint32_t lane = 0; lane < Simd::LANES; lane++) {
+							if (!(mask & (1u << lane))) continue;
+							written++;
+							if (target.visibility) target.visibility[(size_t)y * target.stride + x + lane] = id;
+						}
+					}
+				}
+			}
+		}
+		return written;
+	}
+
+	float SoftwareRenderer::sampleShadowMap(uint32_t map, float u, float v) const {
+		// 与 Renderer::getShadowMapSamplerState 一致：双线性过滤，纹理之外是边框颜色 1
+		auto& texels = shadowMaps[map];
+		float x = u * shadowMapSize - 0.5f;
+		float y = v * shadowMapSize - 0.5f;
+		float fx = std::floor(x), fy = std::floor(y);
+		float tx = x - fx, ty = y - fy;
+		auto texel = [&](float i, float j) {
+			if (i < 0 || j < 0 || i >= shadowMapSize || j >= shadowMapSize) return 1.f;
+			return texels[(size_t)j * shadowMapSize + (size_t)i];
+		};
+		float top = texel(fx, fy) + (texel(fx + 1, fy) - texel(fx, fy)) * tx;
+		float bottom = texel(fx, fy + 1) + (texel(fx + 1, fy + 1) - texel(fx, fy + 1)) * tx;
+		return top + (bottom - top) * ty;
+	}
+
+	DirectX::XMFLOAT3 SoftwareRenderer::shadePixel(const SoftwareScene& scene, const ScreenTriangle& t, float px, float py) const {
+		// 屏幕空间的重心坐标（顶点 i 对面的边），再做透视校正
+		float perspective[3];
+		float sum = 0;
+		for (int i = 0; i < 3; i++) {
+			int j = (i + 1) % 3, k = (i + 2) % 3;
+			float edge = (t.y[j] - t.y[k]) * (px - t.x[j]) + (t.x[k] - t.x[j]) * (py - t.y[j]);
+			perspective[i] = edge * t.invW[i];
+			sum += perspective[i];
+		}
+		float weights[3] = { 0, 0, 0 };
+		for (int i = 0; i < 3; i++) {
+			for (int k = 0; k < 3; k++) weights[k] += perspective[i] / sum * t.weights[i][k];
+		}
+
+		auto& draw = draws[t.draw];
+		auto& object = *draw.object;
+		auto& indices = object.mesh->indices;
+		const ShadeVertex* v[3];
+		for (int k = 0; k < 3; k++) v[k] = &shadeVertices[draw.firstVertex + indices[(size_t)t.triangle * 3 + k]];
+		auto interpolate3 = [&](DirectX::XMFLOAT3 ShadeVertex::* field) {
+			return Float3(v[0]->*field) * weights[0] + Float3(v[1]->*field) * weights[1] + Float3(v[2]->*field) * weights[2];
+		};
+		auto interpolate2 = [&](DirectX::XMFLOAT2 ShadeVertex::* field) {
+			DirectX::XMFLOAT2 out{ 0, 0 };
+			for (int k = 0; k < 3; k++) {
+				out.x += (v[k]->*field).x * weights[k];
+				out.y += (v[k]->*field).y * weights[k];
+			}
+			return out;
+		};
+
+		auto position_W = interpolate3(&ShadeVertex::position_W);
+		auto normal = interpolate3(&ShadeVertex::normal_W);
+		auto tangent = interpolate3(&ShadeVertex::tangent_W);
+		DirectX::XMFLOAT4 vertexColor{ 0, 0, 0, 0 };
+		for (int k = 0; k < 3; k++) {
+			vertexColor.x += v[k]->color.x * weights[k];
+			vertexColor.y += v[k]->color.y * weights[k];
+			vertexColor.z += v[k]->color.z * weights[k];
+		}
+		DirectX::XMFLOAT2 texCoords[2] = { interpolate2(&ShadeVertex::texCoord0), interpolate2(&ShadeVertex::texCoord1) };
+
+		// 以下按照 DefaultPS.hlsl 的 main
+		static const SoftwareMaterial DEFAULT_MATERIAL;
+		auto& material = object.material ? *object.material : DEFAULT_MATERIAL;
+		auto sample = [&](uint32_t slot, uint32_t uv, DirectX::XMFLOAT4& out) {
+			auto& texture = material.textures[slot];
+			if (uv >= 2 || !texture) return false;
+			out = texture->sample(texCoords[uv].x, texCoords[uv].y);
+			return true;
+		};
+		auto channel = [](const DirectX::XMFLOAT4& value, uint32_t c) {
+			return c == 0 ? value.x : c == 1 ? value.y : c == 2 ? value.z : value.w;
+		};
+
+		auto cameraDir_W = normalize(Float3(cameraPosition_W) - position_W);
+		Float3 vertexRGB{ vertexColor.x, vertexColor.y, vertexColor.z };
+
+		DirectX::XMFLOAT4 sampled;
+		Float3 sampledBaseColor{ 1, 1, 1 };
+		if (sample(0, material.uvBaseColor, sampled)) sampledBaseColor = gammaToLinear({ sampled.x, sampled.y, sampled.z });
+		auto baseColor = Float3(material.baseColor.x, material.baseColor.y, material.baseColor.z) * vertexRGB * sampledBaseColor;
+
+		Float3 sampledEmission{ 1, 1, 1 };
+		if (sample(1, material.uvEmissionColor, sampled)) sampledEmission = gammaToLinear({ sampled.x, sampled.y, sampled.z });
+		auto emissionColor = Float3(material.emissionColor.x, material.emissionColor.y, material.emissionColor.z) * vertexRGB * sampledEmission;
+
+		float metallic = (sample(2, material.uvMetallic, sampled) ? channel(sampled, material.channelMetallic) : 1) * material.metallic;
+		float roughness = (sample(3, material.uvRoughness, sampled) ? channel(sampled, material.channelRoughness) : 1) * material.roughness;
+		float ao = sample(4, material.uvAO, sampled) ? channel(sampled, material.channelAO) : 1;
+		ao = std::max(0.f, 1 + material.occlusionStrength * (ao - 1));
+
+		auto normal_W = normalize(normal);
+		if (sample(5, material.uvNormal, sampled)) {
+			normal_W = getNormal(normal_W, normalize(tangent), { sampled.x, sampled.y, sampled.z },
+				material.normalMapScale, material.normalReconstructZ != 0);
+		}
+
+		auto position_V = transform({ position_W.x, position_W.y, position_W.z }, trans_W2V);
+		float depth_V = position_V.z / position_V.w;
+
+		Float3 output;
+		auto& cluster = lightClusters.getClusters()[lightClusters.findCluster({ position_V.x, position_V.y, position_V.z })];
+		for (uint32_t i = 0; i < cluster.count; i++) {
+			uint32_t lightID = lightClusters.getLightIndices()[cluster.offset + i];
+			int coneID = -1;
+			for (int j = 0; j < (int)NUMBER_SHADOW_MAP_PER_LIGHT; j++) {
+				if (cascadeSplits[j] <= depth_V && depth_V <= cascadeSplits[j + 1]) coneID = j;
+			}
+
+			uint32_t slot = MAX_NUMBER_OF_SHADOWED_LIGHTS;
+			for (uint32_t k = 0; k < MAX_NUMBER_OF_SHADOWED_LIGHTS; k++) {
+				if (cascadeLightID[k] == lightID) slot = k;
+			}
+
+			float shadowed = 0;
+			if (slot < MAX_NUMBER_OF_SHADOWED_LIGHTS && coneID != -1 && cascadeValid[slot][coneID] &&
+				(object.layers & RenderLayers::SHADOW_RECEIVER)) {
+				auto coord = transform({ position_W.x, position_W.y, position_W.z }, trans_W2CSM[slot][coneID]);
+				coord = { coord.x / coord.w, coord.y / coord.w, coord.z / coord.w, 1 };
+				uint32_t map = slot * NUMBER_SHADOW_MAP_PER_LIGHT + coneID;
+				for (float deltaX : { -0.001f, 0.f, 0.001f }) {
+					for (float deltaY : { -0.001f, 0.f, 0.001f }) {
+						if (sampleShadowMap(map, coord.x + deltaX, coord.y + deltaY) < coord.z) shadowed += 1;
+					}
+				}
+			}
+			float visibility = 1 - shadowed / 9;
+
+			auto& light = scene.lights[lightID];
+			if (light.type == LightType::LIGHT_TYPE_POINT || light.type == LightType::LIGHT_TYPE_SPOT) {
+				auto positionVecDist = Float3(light.position_W) - position_W;
+				float distance2 = dot(positionVecDist, positionVecDist);
+				float distance = std::sqrt(distance2);
+				auto lightDir_W = positionVecDist / distance;
+				auto brdf = defaultMaterialBRDF(baseColor, metallic, roughness, 1.45f, cameraDir_W, lightDir_W, normal_W);
+				float cosLightNormal = dot(normal_W, lightDir_W);
+				float falloff = getLightFalloff(light, lightDir_W, distance);
+				output += visibility * falloff * brdf * Float3(light.intensity) * cosLightNormal / distance2;
+			} else {
+				auto lightDir_W = Float3(light.direction_W) * -1;
+				auto brdf = defaultMaterialBRDF(baseColor, metallic, roughness, 1.45f, cameraDir_W, lightDir_W, normal_W);
+				float cosLightNormal = dot(normal_W, lightDir_W);
+				output += visibility * brdf * Float3(light.intensity) * cosLightNormal;
+			}
+		}
+
+		output += 0.1f * baseColor * ao;
+		output += emissionColor;
+
+		return {
+			std::pow(std::max(0.f, output.x), 1 / 2.2f),
+			std::pow(std::max(0.f, output.y), 1 / 2.2f),
+			std::pow(std::max(0.f, output.z), 1 / 2.2f),
+		};
+	}
+
+	void SoftwareRenderer::shadeTile(const SoftwareScene& scene, uint32_t tile) {
+		uint32_t tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+		uint32_t tileX0 = (tile % tilesX) * TILE_WIDTH;
+		uint32_t tileY0 = (tile / tilesX) * TILE_HEIGHT;
+		uint32_t tileX1 = std::min(tileX0 + TILE_WIDTH, width);
+		uint32_t tileY1 = std::min(tileY0 + TILE_HEIGHT, height);
+
+		// 与 R8G8B8A8_UNORM 的转换相同：夹到 [0, 1]，四舍五入
+		auto toUnorm = [](float v) { return (uint8_t)(saturate(v) * 255 + 0.5f); };
+		for (uint32_t y = tileY0; y < tileY1; y++) {
+			for (uint32_t x = tileX0; x < tileX1; x++) {
+				auto id = visibility[(size_t)y * stride + x];
+				uint8_t* out = color.data() + ((size_t)y * width + x) * 4;
+				out[3] = 255;
+				if (id == EMPTY_PIXEL) {
+					out[0] = out[1] = out[2] = 0;
+					continue;
+				}
+				auto& triangle = chunks[id >> CHUNK_INDEX_BITS].triangles[id & ((1u << CHUNK_INDEX_BITS) - 1)];
+				auto rgb = shadePixel(scene, triangle, x + 0.5f, y + 0.5f);
+				out[0] = toUnorm(rgb.x);
+				out[1] = toUnorm(rgb.y);
+				out[2] = toUnorm(rgb.z);
+			}
+		}
+	}
+
+	SoftwareRenderer::PassStatistics SoftwareRenderer::renderPass(const SoftwareScene& scene, const CameraInfo& camera,
+		uint32_t includeLayers, const Target& target, JobSystem* jobs) {
+		auto begin = std::chrono::steady_clock::now();
+		bool shade = target.visibility != nullptr;
+		PassStatistics out;
+
+		collectDraws(scene, camera, includeLayers, shade);
+		out.objects = (uint32_t)draws.size();
+
+		chunkCount = 0;
+		for (uint32_t i = 0; i < (uint32_t)draws.size(); i++) {
+			auto triangles = (uint32_t)(draws[i].object->mesh->indices.size() / 3);
+			out.triangles += triangles;
+			for (uint32_t first = 0; first < triangles; first += TRIANGLES_PER_CHUNK) {
+				if (chunkCount == chunks.size()) chunks.emplace_back();
+				auto& chunk = chunks[chunkCount++];
+				chunk.draw = i;
+				chunk.firstTriangle = first;
+				chunk.lastTriangle = std::min(triangles, first + TRIANGLES_PER_CHUNK);
+			}
+		}
+
+		uint32_t tiles = ((target.width + TILE_WIDTH - 1) / TILE_WIDTH) * ((target.height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+		std::vector<uint64_t> written(tiles);
+		auto transformJob = [this, shade](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) transformVertices(i, shade);
+		};
+		auto setupJob = [this, &target](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) setupChunk(chunks[i], target);
+		};
+		auto rasterizeJob = [this, &scene, &target, &written, shade](uint32_t begin, uint32_t end) {
+			for (uint32_t tile = begin; tile < end; tile++) {
+				written[tile] = rasterizeTile(target, tile);
+				if (shade) shadeTile(scene, tile);
+			}
+		};
+		if (jobs && out.triangles >= MINIMUM_TRIANGLES_FOR_JOBS) {
+			jobs->parallelFor(0, (uint32_t)draws.size(), 1, transformJob);
+			jobs->parallelFor(0, chunkCount, 1, setupJob);
+			jobs->parallelFor(0, tiles, 1, rasterizeJob);
+		} else {
+			transformJob(0, (uint32_t)draws.size());
+			setupJob(0, chunkCount);
+			rasterizeJob(0, tiles);
+		}
+
+		for (uint32_t i = 0; i < chunkCount; i++) {
+			out.rasterizedTriangles += chunks[i].triangles.size();
+			out.binnedTriangles += chunks[i].binTriangles.size();
+		}
+		for (auto count : written) out.pixels += count;
+		out.milliseconds = millisecondsSince(begin);
+		return out;
+	}
+
+	bool SoftwareRenderer::getReceiverDepthRange(const SoftwareScene& scene, float& nearZ, float& farZ) const {
+		auto& camera = scene.camera;
+		float low = std::numeric_limits<float>::max();
+		float high = std::numeric_limits<float>::lowest();
+
+		constexpr uint32_t RECEIVER = RenderLayers::MAIN_VIEW | RenderLayers::SHADOW_RECEIVER;
+		for (auto& object : scene.objects) {
+			if ((object.layers & RECEIVER) != RECEIVER || !object.mesh) continue;
+			DirectX::XMFLOAT3 center;
+			float radius;
+			if (!getViewSpaceBoundingSphere(object, camera.trans_W2V, center, radius)) {
+				low = camera.nearZ;
+				high = camera.farZ;
+				continue;
+			}
+			if (!intersectsFrustum(center, radius, camera)) continue;
+			low = std::min(low, center.z - radius);
+			high = std::max(high, center.z + radius);
+		}
+
+		if (low > high) return false;
+		nearZ = std::clamp(low, camera.nearZ, camera.farZ);
+		farZ = std::clamp(high, camera.nearZ, camera.farZ);
+		return nearZ < farZ;
+	}
+
+	CascadeSplits SoftwareRenderer::computeCascadeSplits(const SoftwareScene& scene) {
+		auto& camera = scene.camera;
+		if (this->cascadeSplitMode == CascadeSplitMode::FIXED) {
+			auto out = this->fixedCascadeSplits;
+			out[0] = camera.nearZ;
+			this->cascadeDepthRange = { out.front(), out.back() };
+			return out;
+		}
+
+		float nearZ = camera.nearZ, farZ = camera.farZ;
+		if (!this->getReceiverDepthRange(scene, nearZ, farZ)) {
+			nearZ = camera.nearZ;
+			farZ = camera.farZ;
+		}
+
+		this->cascadeDepthRange = { nearZ, farZ };
+		return getPracticalCascadeSplits(nearZ, farZ, this->cascadeSplitLambda);
+	}
+
+	void SoftwareRenderer::renderShadowMaps(const SoftwareScene& scene, JobSystem* jobs) {
+		auto& mainCamera = scene.camera;
+		this->cascadeSplits = this->computeCascadeSplits(scene);
+		auto& zList = this->cascadeSplits;
+
+		// 与 Renderer::createShadowMapPasses 相同：在预算内选择有阴影的光源，以及各自的 cascade 和分辨率
+		planShadows(mainCamera, scene.lights, zList.data(), (uint32_t)zList.size(),
+			shadowMapSize, shadowMapSize, this->shadowBudget, this->shadowPlan);
+
+		for (uint32_t slot = 0; slot < (uint32_t)this->shadowPlan.lights.size(); slot++) {
+			auto& plan = this->shadowPlan.lights[slot];
+			this->cascadeLightID[slot] = plan.lightID;
+
+			std::array<DepthCameraSuggestion, NUMBER_SHADOW_MAP_PER_LIGHT> maps;
+			getSuggestedDepthCamera(mainCamera, scene.lights[plan.lightID], zList.data(), (uint32_t)zList.size(), maps.data());
+
+			// 降低分辨率时只画在深度图左上角，采样坐标相应缩小
+			uint32_t mapWidth = std::max(1u, shadowMapSize >> plan.resolutionShift);
+			uint32_t mapHeight = std::max(1u, shadowMapSize >> plan.resolutionShift);
+			float scaleX = (float)mapWidth / shadowMapSize;
+			float scaleY = (float)mapHeight / shadowMapSize;
+
+			for (uint32_t mapID = 0; mapID < (uint32_t)maps.size(); mapID++) {
+				if (!(plan.cascadeMask & (1u << mapID))) continue;
+				auto& cameraDesc = maps[mapID];
+				if (!std::get<0>(cameraDesc)) continue;
+
+				auto& depthCamera = std::get<1>(cameraDesc);
+				auto includeLayers = mapID > 0 ? RenderLayers::SHADOW_CASTER_DISTANT : RenderLayers::SHADOW_CASTER;
+
+				// 整张深度图都清除为 1，视口之外的部分采样时也是 1
+				auto& map = shadowMaps[slot * NUMBER_SHADOW_MAP_PER_LIGHT + mapID];
+				map.resize((size_t)shadowMapSize * shadowMapSize);
+				if (mapWidth < shadowMapSize) std::fill(map.begin(), map.end(), 1.f);
+
+				Target target{ map.data(), nullptr, mapWidth, mapHeight, shadowMapSize, true };
+				auto pass = renderPass(scene, depthCamera, includeLayers, target, jobs);
+				statistics.shadowPasses++;
+				statistics.shadow.objects += pass.objects;
+				statistics.shadow.triangles += pass.triangles;
+				statistics.shadow.rasterizedTriangles += pass.rasterizedTriangles;
+				statistics.shadow.binnedTriangles += pass.binnedTriangles;
+				statistics.shadow.pixels += pass.pixels;
+				statistics.shadow.milliseconds += pass.milliseconds;
+
+				this->cascadeValid[slot][mapID] = true;
+				DirectX::XMStoreFloat4x4(&this->trans_W2CSM[slot][mapID], getShadowTextureMatrix(depthCamera, scaleX, scaleY));
+			}
+		}
+	}
+
+	void SoftwareRenderer::prepareLightClusters(const SoftwareScene& scene, JobSystem* jobs) {
+		// 与 Renderer::prepareLightClusters 相同
+		auto& camera = scene.camera;
+		this->clusterLights.resize(scene.lights.size());
+		for (size_t i = 0; i < scene.lights.size(); i++) {
+			auto& light = scene.lights[i];
+			auto& out = this->clusterLights[i];
+
+			auto position_V = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&light.position_W), camera.trans_W2V);
+			auto direction_V = DirectX::XMVector3Normalize(
+				DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&light.direction_W), camera.trans_W2V));
+			DirectX::XMStoreFloat3(&out.position_V, position_V);
+			DirectX::XMStoreFloat3(&out.direction_V, direction_V);
+
+			bool bounded = light.type != LightType::LIGHT_TYPE_DIRECTIONAL && light.maximumDistance > 0;
+			out.range = bounded ? light.maximumDistance : std::numeric_limits<float>::infinity();
+			out.spot = light.type == LightType::LIGHT_TYPE_SPOT;
+			out.outerConeAngle = light.outerConeAngle;
+		}
+
+		auto clusterCamera = camera.projectionType == CameraInfo::ProjectionType::PERSPECTIVE ?
+			LightClusterCamera::perspectiveCamera(camera.fieldOfViewYRadian, camera.aspectRatio, camera.nearZ, camera.farZ) :
+			LightClusterCamera::orthographicCamera(camera.viewWidth, camera.viewHeight, camera.nearZ, camera.farZ);
+		this->lightClusters.build(clusterCamera, this->clusterLights, jobs);
+	}
+
+	void SoftwareRenderer::render(const SoftwareScene& scene, bool renderShadow, JobSystem* jobs) {
+		statistics = Statistics();
+		for (auto& valid : cascadeValid) valid.fill(false);
+		cascadeLightID.fill(0xffffffff);
+		shadowPlan = ShadowPlan();
+
+		if (renderShadow) renderShadowMaps(scene, jobs);
+
+		DirectX::XMStoreFloat4x4(&trans_W2V, scene.camera.trans_W2V);
+		DirectX::XMStoreFloat3(&cameraPosition_W,
+			DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(0, 0, 0, 1), DirectX::XMMatrixInverse(nullptr, scene.camera.trans_W2V)));
+		prepareLightClusters(scene, jobs);
+
+		Target target{ depth.data(), visibility.data(), width, height, stride, false };
+		statistics.main = renderPass(scene, scene.camera, RenderLayers::MAIN_VIEW, target, jobs);
+	}
+
+	uint64_t SoftwareRenderer::getImageHash() const {
+		uint64_t hash = 14695981039346656037ull;
+		for (auto byte : color) {
+			hash ^= byte;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool SoftwareRenderer::writePNG(const std::string& path) const {
+		return stbi_write_png(path.c_str(), (int)width, (int)height, 4, color.data(), (int)width * 4) != 0;
+	}
+
+}
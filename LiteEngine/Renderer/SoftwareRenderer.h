@@ -0,0 +1,262 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LightClustering.h"
+#include "RenderingTypes.h"
+
+namespace LiteEngine {
+	class JobSystem;
+}
+
+namespace LiteEngine::Rendering {
+
+	// 软件光栅化的参考渲染：与 Renderer::renderScene 相同的 pass（planShadows 选择的深度图，再画主视图），
+	// 在 CPU 上按 tile 分箱、按 tile 并行光栅化，一次处理一行中相邻的几个像素（SSE 4 个，定义了 __AVX2__ 时 8 个）
+	// 着色是 DefaultPS 的逐像素移植（BRDF、分簇光照、CSM 的 3 x 3 采样），纹理只做双线性过滤，没有 mipmap
+	// 每个 tile 只由一个线程按提交顺序处理，结果与线程数无关，可以作为对比 GPU 输出的参考帧
+	// 这里只在 CPU 上计算，不依赖 D3D
+
+	// 与 SceneManagement::DefaultVertexData 相同
+	struct SoftwareVertex {
+		DirectX::XMFLOAT3 position{ 0, 0, 0 };
+		DirectX::XMFLOAT3 normal{ 0, 1, 0 };
+		DirectX::XMFLOAT3 tangent{ 1, 0, 0 };
+		DirectX::XMFLOAT4 color{ 1, 1, 1, 1 };
+		DirectX::XMFLOAT2 texCoord0{ 0, 0 };
+		DirectX::XMFLOAT2 texCoord1{ 0, 0 };
+	};
+
+	// 三角形在屏幕上顺时针为正面（与 D3D 默认的光栅化状态和 glTF 加载器一致）
+	struct SoftwareMesh {
+		std::vector<SoftwareVertex> vertices;
+		std::vector<uint32_t> indices;
+
+		// 局部空间的包围球，用于剔除和 CSM 的深度范围。修改顶点之后需要重新计算
+		DirectX::XMFLOAT3 boundsCenter{ 0, 0, 0 };
+		float boundsRadius = 0;
+
+		void computeBounds();
+	};
+
+	// RGBA8 的纹理。与默认的采样器（CD3D11_DEFAULT）一样双线性过滤、坐标夹到边缘，没有 mipmap
+	struct SoftwareTexture {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> pixels;
+
+		// 结果在 [0, 1] 中，不做 sRGB 转换（与 DefaultPS 一样由着色代码处理）
+		DirectX::XMFLOAT4 sample(float u, float v) const;
+	};
+
+	// 与 SceneManagement::DefaultMaterialConstantData 相同的参数。uv* 不小于 2 或者没有对应的纹理时不采样
+	struct SoftwareMaterial {
+		DirectX::XMFLOAT4 baseColor{ 1, 1, 1, 1 };
+		DirectX::XMFLOAT4 emissionColor{ 0, 0, 0, 1 };
+
+		float metallic = 0;
+		float roughness = 1;
+		float occlusionStrength = 1;
+		float normalMapScale = 1;
+
+		uint32_t uvBaseColor = UINT32_MAX;
+		uint32_t uvEmissionColor = UINT32_MAX;
+		uint32_t uvMetallic = UINT32_MAX;
+		uint32_t uvRoughness = UINT32_MAX;
+		uint32_t uvAO = UINT32_MAX;
+		uint32_t uvNormal = UINT32_MAX;
+
+		uint32_t channelRoughness = 0;
+		uint32_t channelMetallic = 0;
+		uint32_t channelAO = 0;
+		uint32_t normalReconstructZ = 0;
+
+		// 下标与 SceneManagement::DefaultShaderSlot 相同
+		std::array<std::shared_ptr<const SoftwareTexture>, 6> textures;
+	};
+
+	struct SoftwareObject {
+		std::shared_ptr<const SoftwareMesh> mesh;
+		std::shared_ptr<const SoftwareMaterial> material;
+		DirectX::XMFLOAT4X4 trans_L2W;		// 必须是仿射变换
+		uint32_t layers = RenderLayers::DEFAULT;
+	};
+
+	// 与 RenderingScene 对应：相机、光源和物体都在同一个（平移过原点的）世界空间中
+	struct SoftwareScene {
+		CameraInfo camera;
+		std::vector<LightDesc> lights;
+		std::vector<SoftwareObject> objects;
+	};
+
+	class SoftwareRenderer {
+	public:
+		// tile 是分箱和并行的单位。tile 的宽度必须是 SIMD 宽度（最大为 8）的倍数
+		static constexpr uint32_t TILE_WIDTH = 64;
+		static constexpr uint32_t TILE_HEIGHT = 32;
+
+		struct PassStatistics {
+			uint32_t objects = 0;					// 通过了图层和视锥剔除的物体
+			uint64_t triangles = 0;					// 这些物体的三角形
+			uint64_t rasterizedTriangles = 0;		// 剔除和近平面裁剪之后覆盖了至少一个像素的（裁剪可能把一个分成两个）
+			uint64_t binnedTriangles = 0;			// 各个 tile 中的三角形数之和
+			uint64_t pixels = 0;					// 通过深度测试的片元，包括之后又被覆盖的
+			double milliseconds = 0;
+		};
+
+		struct Statistics {
+			uint32_t shadowPasses = 0;
+			PassStatistics shadow;					// 所有深度图的和
+			PassStatistics main;
+		};
+
+	private:
+		uint32_t width;
+		uint32_t height;
+		uint32_t stride;							// depth 和 visibility 每行的像素数，补齐到 tile 的倍数
+		uint32_t shadowMapSize;
+
+		std::vector<uint8_t> color;					// RGBA8，每行 width 个像素
+		std::vector<float> depth;					// NDC 深度
+		std::vector<uint32_t> visibility;			// 每个像素可见的三角形：(chunk << CHUNK_INDEX_BITS) | chunk 中的下标，空白为 UINT32_MAX
+
+		// MAX_NUMBER_OF_SHADOWED_LIGHTS * NUMBER_SHADOW_MAP_PER_LIGHT 张，下标为 slot * NUMBER_SHADOW_MAP_PER_LIGHT + cascade
+		// 第一次用到时才分配
+		std::vector<std::vector<float>> shadowMaps;
+
+		// 与 FixedPerframePSConstantBufferData 中的阴影部分对应
+		CascadeSplits cascadeSplits{};
+		std::array<std::array<bool, NUMBER_SHADOW_MAP_PER_LIGHT>, MAX_NUMBER_OF_SHADOWED_LIGHTS> cascadeValid{};
+		std::array<uint32_t, MAX_NUMBER_OF_SHADOWED_LIGHTS> cascadeLightID{};
+		std::array<std::array<DirectX::XMFLOAT4X4, NUMBER_SHADOW_MAP_PER_LIGHT>, MAX_NUMBER_OF_SHADOWED_LIGHTS> trans_W2CSM{};
+
+		std::pair<float, float> cascadeDepthRange{ 0, 0 };
+		ShadowPlan shadowPlan;
+
+		LightClusterGrid lightClusters;
+		std::vector<ClusterLight> clusterLights;
+
+		// 主 pass 的相机
+		DirectX::XMFLOAT4X4 trans_W2V;
+		DirectX::XMFLOAT3 cameraPosition_W;
+
+		// 一个 pass 中的一个物体。顶点变换一次，各个三角形共用
+		struct Draw {
+			const SoftwareObject* object;
+			DirectX::XMFLOAT4X4 trans_L2C;
+			DirectX::XMFLOAT3X3 trans_N2W;			// 法线：W2L 的转置（与 DefaultVS 一致）
+			uint32_t firstVertex;					// 在 clipVertices / shadeVertices 中的位置
+		};
+		std::vector<Draw> draws;
+
+		std::vector<DirectX::XMFLOAT4> clipVertices;
+
+		// 世界空间中的顶点属性，只在主 pass 中计算
+		struct ShadeVertex {
+			DirectX::XMFLOAT3 position_W;
+			DirectX::XMFLOAT3 normal_W;
+			DirectX::XMFLOAT3 tangent_W;
+			DirectX::XMFLOAT4 color;
+			DirectX::XMFLOAT2 texCoord0;
+			DirectX::XMFLOAT2 texCoord1;
+		};
+		std::vector<ShadeVertex> shadeVertices;
+
+		// 屏幕空间（像素，y 向下）的三角形，z 是 NDC 深度。面积统一为正
+		// 近平面裁剪产生的顶点不是 mesh 的顶点，weights 是各个顶点关于原三角形三个顶点的重心坐标
+		struct ScreenTriangle {
+			float x[3];
+			float y[3];
+			float z[3];
+			float invW[3];
+			float weights[3][3];
+			uint32_t draw;
+			uint32_t triangle;						// mesh 中的三角形
+		};
+
+		// 一段连续的三角形由一个 job 变换、裁剪和分箱，结果只写到自己的 bins 中，不需要同步
+		// 光栅化一个 tile 时按顺序遍历所有 chunk 在这个 tile 中的三角形，所以结果与线程数无关。容器在多个 pass 之间复用
+		struct Chunk {
+			uint32_t draw;
+			uint32_t firstTriangle;
+			uint32_t lastTriangle;
+			std::vector<ScreenTriangle> triangles;
+			std::vector<std::pair<uint32_t, uint32_t>> hits;	// (tile, triangles 中的下标)
+			std::vector<uint32_t> binOffsets;		// 每个 tile 一项，再加一项结尾
+			std::vector<uint32_t> binTriangles;
+		};
+		std::vector<Chunk> chunks;
+		uint32_t chunkCount = 0;
+
+		// 一个 pass 的目标。depth 每行 stride 个像素，只画左上角 width x height 的区域
+		struct Target {
+			float* depth;
+			uint32_t* visibility;					// 深度图的 pass 为空
+			uint32_t width;
+			uint32_t height;
+			uint32_t stride;
+			bool cullFront;							// 深度图剔除正面（与 Renderer::createDepthMapPass 一致），主 pass 剔除背面
+		};
+
+		void collectDraws(const SoftwareScene& scene, const CameraInfo& camera, uint32_t includeLayers, bool shade);
+		void transformVertices(uint32_t draw, bool shade);
+		void setupChunk(Chunk& chunk, const Target& target);
+		void binTriangle(Chunk& chunk, const Target& target, const ScreenTriangle& triangle);
+		uint64_t rasterizeTile(const Target& target, uint32_t tile);
+		void shadeTile(const SoftwareScene& scene, uint32_t tile);
+		DirectX::XMFLOAT3 shadePixel(const SoftwareScene& scene, const ScreenTriangle& triangle, float px, float py) const;
+		float sampleShadowMap(uint32_t map, float u, float v) const;
+
+		// 画一个 pass：变换、分箱、光栅化，主 pass 再逐像素着色
+		PassStatistics renderPass(const SoftwareScene& scene, const CameraInfo& camera, uint32_t includeLayers,
+			const Target& target, JobSystem* jobs);
+
+		void renderShadowMaps(const SoftwareScene& scene, JobSystem* jobs);
+		void prepareLightClusters(const SoftwareScene& scene, JobSystem* jobs);
+		bool getReceiverDepthRange(const SoftwareScene& scene, float& nearZ, float& farZ) const;
+
+		Statistics statistics;
+
+	public:
+		// width 和 height 是主 pass 的大小，深度图是 shadowMapSize x shadowMapSize，必须是 tile 大小的倍数
+		SoftwareRenderer(uint32_t width, uint32_t height, uint32_t shadowMapSize = 1024);
+
+		// 与 Renderer 中的同名设置相同。DEPTH_READBACK 没有可以读回的上一帧，按 RECEIVER_BOUNDS 处理
+		ShadowBudget shadowBudget;
+		CascadeSplitMode cascadeSplitMode = CascadeSplitMode::RECEIVER_BOUNDS;
+		float cascadeSplitLambda = 0.95f;
+		CascadeSplits fixedCascadeSplits = { 0, 3, 10, 30, 100 };
+
+		CascadeSplits computeCascadeSplits(const SoftwareScene& scene);
+
+		// 与 Renderer::renderScene 相同：先画阴影（renderShadow 时），再画主视图，背景为黑色
+		// jobs 为空时在调用线程上完成
+		void render(const SoftwareScene& scene, bool renderShadow = true, JobSystem* jobs = nullptr);
+
+		uint32_t getWidth() const { return width; }
+		uint32_t getHeight() const { return height; }
+		const std::vector<uint8_t>& getColor() const { return color; }
+		const Statistics& getStatistics() const { return statistics; }
+		const ShadowPlan& getShadowPlan() const { return shadowPlan; }
+		std::pair<float, float> getCascadeDepthRange() const { return cascadeDepthRange; }
+
+		// 颜色的 64 位 FNV-1a 哈希，用于比较两次渲染的结果是否完全相同
+		uint64_t getImageHash() const;
+
+		// 用 stb_image_write 写出颜色。失败时返回 false
+		bool writePNG(const std::string& path) const;
+	};
+
+	// 程序生成的场景（地面、球和长方体，平行光带阴影，再加一些点光源和聚光灯）：
+	//   测量单线程和多线程下阴影和主 pass 的耗时、三角形和像素吞吐量
+	//   检查不同线程数的结果逐像素相同（image hash 一致），不同时抛出异常
+	// outputPath 非空时把最后一帧写成 PNG。不依赖 D3D，可以在任何平台上运行
+	std::string runSoftwareRendererBenchmark(uint32_t maxThreads = 0, const std::string& outputPath = "");
+
+}
@@ -0,0 +1,284 @@
+#include "SoftwareRenderer.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		constexpr uint32_t WIDTH = 1280;
+		constexpr uint32_t HEIGHT = 720;
+		constexpr uint32_t SHADOW_MAP_SIZE = 1024;
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		DirectX::XMFLOAT3 subtract(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+			return { a.x - b.x, a.y - b.y, a.z - b.z };
+		}
+
+		// 顶点已经在 mesh 中。按 outward 调整顶点顺序，使三角形从外面看是顺时针（正面）
+		void addTriangle(SoftwareMesh& mesh, uint32_t a, uint32_t b, uint32_t c, const DirectX::XMFLOAT3& outward) {
+			auto& va = mesh.vertices[a].position;
+			auto e1 = subtract(mesh.vertices[b].position, va);
+			auto e2 = subtract(mesh.vertices[c].position, va);
+			DirectX::XMFLOAT3 normal{ e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+			// 左手坐标系中顺时针的三角形，cross(b - a, c - a) 指向观察者
+			if (normal.x * outward.x + normal.y * outward.y + normal.z * outward.z < 0) std::swap(b, c);
+			mesh.indices.insert(mesh.indices.end(), { a, b, c });
+		}
+
+		std::shared_ptr<SoftwareMesh> createGround(float size, uint32_t segments) {
+			auto mesh = std::make_shared<SoftwareMesh>();
+			for (uint32_t j = 0; j <= segments; j++) {
+				for (uint32_t i = 0; i <= segments; i++) {
+					SoftwareVertex vertex;
+					float u = (float)i / segments, v = (float)j / segments;
+					vertex.position = { (u - 0.5f) * size, 0, (v - 0.5f) * size };
+					vertex.texCoord0 = { u, v };
+					mesh->vertices.push_back(vertex);
+				}
+			}
+			for (uint32_t j = 0; j < segments; j++) {
+				for (uint32_t i = 0; i < segments; i++) {
+					uint32_t a = j * (segments + 1) + i, b = a + 1, c = a + segments + 1, d = c + 1;
+					addTriangle(*mesh, a, b, d, { 0, 1, 0 });
+					addTriangle(*mesh, a, d, c, { 0, 1, 0 });
+				}
+			}
+			mesh->computeBounds();
+			return mesh;
+		}
+
+		std::shared_ptr<SoftwareMesh> createSphere(uint32_t rings, uint32_t segments) {
+			auto mesh = std::make_shared<SoftwareMesh>();
+			for (uint32_t r = 0; r <= rings; r++) {
+				float theta = DirectX::XM_PI * r / rings;
+				for (uint32_t s = 0; s <= segments; s++) {
+					float phi = 2 * DirectX::XM_PI * s / segments;
+					SoftwareVertex vertex;
+					vertex.normal = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+					vertex.position = vertex.normal;
+					vertex.tangent = { -std::sin(phi), 0, std::cos(phi) };
+					vertex.texCoord0 = { (float)s / segments, (float)r / rings };
+					mesh->vertices.push_back(vertex);
+				}
+			}
+			for (uint32_t r = 0; r < rings; r++) {
+				for (uint32_t s = 0; s < segments; s++) {
+					uint32_t a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+					auto& n = mesh->vertices[a].normal;
+					auto& m = mesh->vertices[d].normal;
+					DirectX::XMFLOAT3 outward{ n.x + m.x, n.y + m.y, n.z + m.z };
+					if (r > 0) addTriangle(*mesh, a, b, d, outward);
+					if (r + 1 < rings) addTriangle(*mesh, a, d, c, outward);
+				}
+			}
+			mesh->computeBounds();
+			return mesh;
+		}
+
+		// 单位立方体，每个面单独的顶点
+		std::shared_ptr<SoftwareMesh> createBox() {
+			auto mesh = std::make_shared<SoftwareMesh>();
+			for (int axis = 0; axis < 3; axis++) {
+				for (float sign : { -1.f, 1.f }) {
+					DirectX::XMFLOAT3 normal{ axis == 0 ? sign : 0, axis == 1 ? sign : 0, axis == 2 ? sign : 0 };
+					auto first = (uint32_t)mesh->vertices.size();
+					for (int corner = 0; corner < 4; corner++) {
+						float p[3];
+						p[axis] = sign * 0.5f;
+						p[(axis + 1) % 3] = corner & 1 ? 0.5f : -0.5f;
+						p[(axis + 2) % 3] = corner & 2 ? 0.5f : -0.5f;
+						SoftwareVertex vertex;
+						vertex.position = { p[0], p[1], p[2] };
+						vertex.normal = normal;
+						vertex.tangent = { axis == 0 ? 0.f : 1.f, axis == 0 ? 1.f : 0.f, 0 };
+						vertex.texCoord0 = { corner & 1 ? 1.f : 0.f, corner & 2 ? 1.f : 0.f };
+						mesh->vertices.push_back(vertex);
+					}
+					addTriangle(*mesh, first, first + 1, first + 3, normal);
+					addTriangle(*mesh, first, first + 3, first + 2, normal);
+				}
+			}
+			mesh->computeBounds();
+			return mesh;
+		}
+
+		std::shared_ptr<SoftwareTexture> createCheckerTexture(uint32_t size, uint32_t cells) {
+			auto texture = std::make_shared<SoftwareTexture>();
+			texture->width = texture->height = size;
+			texture->pixels.resize((size_t)size * size * 4);
+			for (uint32_t y = 0; y < size; y++) {
+				for (uint32_t x = 0; x < size; x++) {
+					bool dark = ((x * cells / size) + (y * cells / size)) % 2;
+					uint8_t* p = texture->pixels.data() + ((size_t)y * size + x) * 4;
+					p[0] = dark ? 90 : 200;
+					p[1] = dark ? 90 : 190;
+					p[2] = dark ? 100 : 170;
+					p[3] = 255;
+				}
+			}
+			return texture;
+		}
+
+		DirectX::XMFLOAT4X4 makeTransform(const DirectX::XMFLOAT3& scale, float rotationY, const DirectX::XMFLOAT3& translation) {
+			DirectX::XMFLOAT4X4 out;
+			DirectX::XMStoreFloat4x4(&out, DirectX::XMMatrixMultiply(
+				DirectX::XMMatrixMultiply(DirectX::XMMatrixScaling(scale.x, scale.y, scale.z), DirectX::XMMatrixRotationY(rotationY)),
+				DirectX::XMMatrixTranslation(translation.x, translation.y, translation.z)));
+			return out;
+		}
+
+		// 一块带棋盘格纹理的地面，上面随机放置球和长方体；一个有阴影的平行光，若干点光源和聚光灯
+		SoftwareScene createScene(std::mt19937& random) {
+			SoftwareScene scene;
+			std::uniform_real_distribution<float> unit(0, 1);
+
+			auto& camera = scene.camera;
+			camera.trans_W2V = DirectX::XMMatrixLookAtLH({ 0, 9, -24, 1 }, { 0, 0, 4, 1 }, { 0, 1, 0, 0 });
+			camera.projectionType = CameraInfo::ProjectionType::PERSPECTIVE;
+			camera.fieldOfViewYRadian = DirectX::XM_PI / 3;
+			camera.aspectRatio = (float)WIDTH / HEIGHT;
+			camera.nearZ = 0.1f;
+			camera.farZ = 200;
+
+			auto groundMaterial = std::make_shared<SoftwareMaterial>();
+			groundMaterial->roughness = 0.8f;
+			groundMaterial->uvBaseColor = 0;
+			groundMaterial->textures[0] = createCheckerTexture(512, 32);
+			scene.objects.push_back({ createGround(80, 64), groundMaterial, makeTransform({ 1, 1, 1 }, 0, { 0, 0, 0 }) });
+
+			auto sphere = createSphere(32, 64);
+			auto box = createBox();
+			for (uint32_t i = 0; i < 48; i++) {
+				auto material = std::make_shared<SoftwareMaterial>();
+				material->baseColor = { 0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 1 };
+				material->metallic = unit(random) < 0.3f ? 1.f : 0.f;
+				material->roughness = 0.2f + 0.7f * unit(random);
+				if (i % 16 == 0) material->emissionColor = { 0.5f, 0.3f, 0.1f, 1 };
+
+				DirectX::XMFLOAT3 position{ (unit(random) - 0.5f) * 40, 0, unit(random) * 40 - 10 };
+				if (i % 2 == 0) {
+					float radius = 0.5f + 1.5f * unit(random);
+					position.y = radius;
+					scene.objects.push_back({ sphere, material, makeTransform({ radius, radius, radius }, 0, position) });
+				} else {
+					DirectX::XMFLOAT3 size{ 1 + 2 * unit(random), 1 + 5 * unit(random), 1 + 2 * unit(random) };
+					position.y = size.y / 2;
+					scene.objects.push_back({ box, material, makeTransform(size, DirectX::XM_PI * unit(random), position) });
+				}
+			}
+
+			LightDesc sun{};
+			sun.type = LightType::LIGHT_TYPE_DIRECTIONAL;
+			sun.shadow = LightShadow::LIGHT_SHADOW_HARD;
+			DirectX::XMStoreFloat3(&sun.direction_W, DirectX::XMVector3Normalize({ 0.4f, -1, 0.6f, 0 }));
+			sun.intensity = { 2.5f, 2.4f, 2.2f };
+			scene.lights.push_back(sun);
+
+			for (uint32_t i = 0; i < 24; i++) {
+				LightDesc light{};
+				bool spot = i % 4 == 0;
+				light.type = spot ? LightType::LIGHT_TYPE_SPOT : LightType::LIGHT_TYPE_POINT;
+				light.shadow = spot ? LightShadow::LIGHT_SHADOW_HARD : LightShadow::LIGHT_SHADOW_EMPTY;
+				light.position_W = { (unit(random) - 0.5f) * 40, 1 + 4 * unit(random), unit(random) * 40 - 10 };
+				light.maximumDistance = 6 + 6 * unit(random);
+				light.direction_W = { 0, -1, 0 };
+				light.innerConeAngle = 0.3f;
+				light.outerConeAngle = 0.6f;
+				float power = spot ? 60.f : 20.f;
+				light.intensity = { power * unit(random), power * unit(random), power * unit(random) };
+				scene.lights.push_back(light);
+			}
+			return scene;
+		}
+
+		struct FrameResult {
+			double milliseconds = 0;
+			double shadowMilliseconds = 0;
+			double mainMilliseconds = 0;
+			uint64_t hash = 0;
+		};
+
+		FrameResult renderFrames(SoftwareRenderer& renderer, const SoftwareScene& scene, JobSystem* jobs, uint32_t repeat) {
+			FrameResult result;
+			for (uint32_t i = 0; i < repeat; i++) {
+				auto begin = std::chrono::steady_clock::now();
+				renderer.render(scene, true, jobs);
+				result.milliseconds += millisecondsSince(begin) / repeat;
+				result.shadowMilliseconds += renderer.getStatistics().shadow.milliseconds / repeat;
+				result.mainMilliseconds += renderer.getStatistics().main.milliseconds / repeat;
+			}
+			result.hash = renderer.getImageHash();
+			return result;
+		}
+
+	}
+
+	std::string runSoftwareRendererBenchmark(uint32_t maxThreads, const std::string& outputPath) {
+		if (maxThreads == 0) maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		// 调用线程也执行 job，所以工作线程数少一个
+		JobSystem jobs(maxThreads - 1);
+		constexpr uint32_t REPEAT = 3;
+
+		std::mt19937 random(50);
+		auto scene = createScene(random);
+		SoftwareRenderer renderer(WIDTH, HEIGHT, SHADOW_MAP_SIZE);
+
+		auto single = renderFrames(renderer, scene, nullptr, REPEAT);
+		auto multi = renderFrames(renderer, scene, &jobs, REPEAT);
+		auto& statistics = renderer.getStatistics();
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "software renderer: %u x %u, %u x %u shadow maps, %u objects, %u lights, %u threads\n",
+			WIDTH, HEIGHT, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, (uint32_t)scene.objects.size(), (uint32_t)scene.lights.size(), maxThreads);
+		out << line;
+		snprintf(line, sizeof(line), "%-8s %8s %10s %12s %12s %10s %12s\n",
+			"pass", "passes", "triangles", "rasterized", "binned", "fragments", "1 thread ms");
+		out << line;
+		auto printPass = [&](const char* name, uint32_t passes, const SoftwareRenderer::PassStatistics& pass, double milliseconds) {
+			snprintf(line, sizeof(line), "%-8s %8u %10llu %12llu %12llu %10llu %12.2f\n", name, passes,
+				(unsigned long long)pass.triangles, (unsigned long long)pass.rasterizedTriangles,
+				(unsigned long long)pass.binnedTriangles, (unsigned long long)pass.pixels, milliseconds);
+			out << line;
+		};
+		printPass("shadow", statistics.shadowPasses, statistics.shadow, single.shadowMilliseconds);
+		printPass("main", 1, statistics.main, single.mainMilliseconds);
+
+		double triangles = (double)(statistics.shadow.triangles + statistics.main.triangles);
+		snprintf(line, sizeof(line), "%-8s %12s %12s %8s %12s %12s\n", "threads", "frame ms", "shadow ms", "main ms", "Mtris/s", "Mpix/s");
+		out << line;
+		for (auto& [threads, result] : { std::make_pair(1u, single), std::make_pair(maxThreads, multi) }) {
+			snprintf(line, sizeof(line), "%-8u %12.2f %12.2f %8.2f %12.2f %12.2f\n", threads, result.milliseconds,
+				result.shadowMilliseconds, result.mainMilliseconds,
+				triangles / result.milliseconds / 1e3, (double)WIDTH * HEIGHT / result.mainMilliseconds / 1e3);
+			out << line;
+		}
+		snprintf(line, sizeof(line), "speedup %.2fx, image hash %016llx (1 thread) %016llx (%u threads), %s\n",
+			single.milliseconds / multi.milliseconds, (unsigned long long)single.hash, (unsigned long long)multi.hash, maxThreads,
+			single.hash == multi.hash ? "identical" : "MISMATCH");
+		out << line;
+		if (single.hash != multi.hash) {
+			throw std::runtime_error("images rendered with 1 and " + std::to_string(maxThreads) + " threads differ");
+		}
+
+		if (!outputPath.empty()) {
+			snprintf(line, sizeof(line), "%s %s\n", renderer.writePNG(outputPath) ? "wrote" : "failed to write", outputPath.c_str());
+			out << line;
+		}
+		return out.str();
+	}
+
+}
@@ -0,0 +1,228 @@
+#include "TextureProcessing.h"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+namespace LiteEngine::Rendering {
+
+	namespace {
+
+		// 与 DefaultPS 保持一致：颜色纹理用 gamma 2.2 编码
+		constexpr float TEXTURE_GAMMA = 2.2f;
+
+		struct GammaTables {
+			float toLinear[256];
+			// 编码的分界：线性值不小于 encodeThresholds[i] 时编码值大于 i
+			// 取 gamma 空间中相邻两级的中点，所以 encode(toLinear[i]) == i，逐级生成 mip 时暗部不会漂移
+			float encodeThresholds[255];
+		};
+
+		const GammaTables& getGammaTables() {
+			static const GammaTables tables = []() {
+				GammaTables t;
+				for (uint32_t i = 0; i < 256; i++) {
+					t.toLinear[i] = powf(i / 255.f, TEXTURE_GAMMA);
+				}
+				for (uint32_t i = 0; i < 255; i++) {
+					t.encodeThresholds[i] = powf((i + 0.5f) / 255.f, TEXTURE_GAMMA);
+				}
+				return t;
+			}();
+			return tables;
+		}
+
+		// 等价于 lround(powf(linear, 1 / TEXTURE_GAMMA) * 255)，在 255 个分界上二分查找
+		inline uint8_t encodeGamma(float linear, const GammaTables& tables) {
+			uint32_t index = 0;
+			for (uint32_t step = 128; step > 0; step /= 2) {
+				if (linear >= tables.encodeThresholds[index + step - 1]) index += step;
+			}
+			return (uint8_t)index;
+		}
+
+		inline const uint8_t* pixelAt(const uint8_t* src, uint32_t rowPitch, uint32_t x, uint32_t y) {
+			return src + (size_t)y * rowPitch + (size_t)x * 4;
+		}
+
+		// DATA：偶数尺寸时每次处理两个目标像素，全部在 16 位整数上完成
+		void downsampleDataEven(
+			const uint8_t* src, uint32_t srcPitch,
+			uint8_t* dst, uint32_t dstPitch,
+			uint32_t dstWidth, uint32_t dstHeight
+		) {
+			const __m128i bias = _mm_set1_epi16(2);
+			const __m128i zero = _mm_setzero_si128();
+
+			for (uint32_t y = 0; y < dstHeight; y++) {
+				auto row0 = src + (size_t)(2 * y) * srcPitch;
+				auto row1 = row0 + srcPitch;
+				auto out = dst + (size_t)y * dstPitch;
+
+				uint32_t x = 0;
+				for (; x + 2 <= dstWidth; x += 2) {
+					// 4 个源像素 -> 2 个目标像素
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+
+					__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+					__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+					// 相邻两个像素相加
+					lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+					hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+					__m128i sum = _mm_unpacklo_epi64(lo, hi);
+					sum = _mm_srli_epi16(_mm_add_epi16(sum, bias), 2);
+
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, zero));
+				}
+
+				for (; x < dstWidth; x++) {
+					for (uint32_t c = 0; c < 4; c++) {
+						uint32_t sum = row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+						out[x * 4 + c] = (uint8_t)((sum + 2) / 4);
+					}
+				}
+			}
+		}
+
+		void downsampleData(
+			const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcPitch,
+			uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstPitch
+		) {
+			if (srcWidth == dstWidth * 2 && srcHeight == dstHeight * 2) {
+				downsampleDataEven(src, srcPitch, dst, dstPitch, dstWidth, dstHeight);
+				return;
+			}
+
+			// 奇数尺寸：越界的采样点钳制到边缘
+			for (uint32_t y = 0; y < dstHeight; y++) {
+				uint32_t y0 = std::min(2 * y, srcHeight - 1), y1 = std::min(2 * y + 1, srcHeight - 1);
+				for (uint32_t x = 0; x < dstWidth; x++) {
+					uint32_t x0 = std::min(2 * x, srcWidth - 1), x1 = std::min(2 * x + 1, srcWidth - 1);
+					auto p00 = pixelAt(src, srcPitch, x0, y0), p01 = pixelAt(src, srcPitch, x1, y0);
+					auto p10 = pixelAt(src, srcPitch, x0, y1), p11 = pixelAt(src, srcPitch, x1, y1);
+					auto out = dst + (size_t)y * dstPitch + (size_t)x * 4;
+					for (uint32_t c = 0; c < 4; c++) {
+						out[c] = (uint8_t)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+					}
+				}
+			}
+		}
+
+		inline __m128 loadColorLinear(const uint8_t* p, const GammaTables& tables) {
+			return _mm_setr_ps(tables.toLinear[p[0]], tables.toLinear[p[1]], tables.toLinear[p[2]], p[3] / 255.f);
+		}
+
+		inline __m128 loadNormal(const uint8_t* p) {
+			__m128i v = _mm_cvtsi32_si128(*reinterpret_cast<const int*>(p));
+			v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, _mm_setzero_si128()), _mm_setzero_si128());
+			// [0, 255] -> [-1, 1]，alpha 之后单独处理
+			return _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(2.f / 255)), _mm_set1_ps(1));
+		}
+
+		void downsampleFloat(
+			const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcPitch,
+			uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstPitch,
+			TextureContent content
+		) {
+			auto& tables = getGammaTables();
+			const __m128 quarter = _mm_set1_ps(0.25f);
+
+			for (uint32_t y = 0; y < dstHeight; y++) {
+				uint32_t y0 = std::min(2 * y, srcHeight - 1), y1 = std::min(2 * y + 1, srcHeight - 1);
+				for (uint32_t x = 0; x < dstWidth; x++) {
+					uint32_t x0 = std::min(2 * x, srcWidth - 1), x1 = std::min(2 * x + 1, srcWidth - 1);
+					auto p00 = pixelAt(src, srcPitch, x0, y0), p01 = pixelAt(src, srcPitch, x1, y0);
+					auto p10 = pixelAt(src, srcPitch, x0, y1), p11 = pixelAt(src, srcPitch, x1, y1);
+					auto out = dst + (size_t)y * dstPitch + (size_t)x * 4;
+
+					alignas(16) float result[4];
+
+					if (content == TextureContent::COLOR) {
+						__m128 sum = _mm_add_ps(
+							_mm_add_ps(loadColorLinear(p00, tables), loadColorLinear(p01, tables)),
+							_mm_add_ps(loadColorLinear(p10, tables), loadColorLinear(p11, tables)));
+						sum = _mm_mul_ps(sum, quarter);
+						_mm_store_ps(result, sum);
+						out[0] = encodeGamma(result[0], tables);
+						out[1] = encodeGamma(result[1], tables);
+						out[2] = encodeGamma(result[2], tables);
+						out[3] = (uint8_t)std::min(255.f, result[3] * 255 + 0.5f);
+					} else {
+						__m128 sum = _mm_add_ps(
+							_mm_add_ps(loadNormal(p00), loadNormal(p01)),
+							_mm_add_ps(loadNormal(p10), loadNormal(p11)));
+
+						// 只对 xyz 归一化
+						__m128 xyz = _mm_and_ps(sum, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)));
+						__m128 len2 = _mm_mul_ps(xyz, xyz);
+						len2 = _mm_add_ps(len2, _mm_shuffle_ps(len2, len2, _MM_SHUFFLE(2, 3, 0, 1)));
+						len2 = _mm_add_ps(len2, _mm_shuffle_ps(len2, len2, _MM_SHUFFLE(1, 0, 3, 2)));
+						__m128 normalized = _mm_div_ps(xyz, _mm_sqrt_ps(_mm_max_ps(len2, _mm_set1_ps(1e-12f))));
+
+						// [-1, 1] -> [0, 255]
+						normalized = _mm_add_ps(_mm_mul_ps(normalized, _mm_set1_ps(127.5f)), _mm_set1_ps(128.f));
+						_mm_store_ps(result, normalized);
+						for (uint32_t c = 0; c < 3; c++) {
+							out[c] = (uint8_t)std::clamp(result[c], 0.f, 255.f);
+						}
+						out[3] = (uint8_t)((p00[3] + p01[3] + p10[3] + p11[3] + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+
+	void generateMipChain(TextureData& data, TextureContent content) {
+		if (data.format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+			throw std::exception("mip generation only supports R8G8B8A8_UNORM");
+		}
+		if (data.mips.empty()) return;
+
+		// 只保留第 0 级
+		auto base = data.mips[0];
+		data.mips.resize(1);
+
+		size_t totalSize = base.slicePitch;
+		{
+			uint32_t w = base.width, h = base.height;
+			while (w > 1 || h > 1) {
+				w = std::max(1u, w / 2);
+				h = std::max(1u, h / 2);
+				TextureData::MipLevel level;
+				level.width = w;
+				level.height = h;
+				level.offset = totalSize;
+				level.rowPitch = w * 4;
+				level.slicePitch = level.rowPitch * h;
+				totalSize += level.slicePitch;
+				data.mips.push_back(level);
+			}
+		}
+		data.pixels.resize(totalSize);
+
+		for (size_t i = 1; i < data.mips.size(); i++) {
+			auto& src = data.mips[i - 1];
+			auto& dst = data.mips[i];
+			if (content == TextureContent::DATA) {
+				downsampleData(data.getMipData(i - 1), src.width, src.height, src.rowPitch,
+					data.getMipData(i), dst.width, dst.height, dst.rowPitch);
+			} else {
+				downsampleFloat(data.getMipData(i - 1), src.width, src.height, src.rowPitch,
+					data.getMipData(i), dst.width, dst.height, dst.rowPitch, content);
+			}
+		}
+	}
+
+	void swapChannels(TextureData& data, uint32_t a, uint32_t b) {
+		if (data.format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+			throw std::exception("channel swapping only supports R8G8B8A8_UNORM");
+		}
+		for (size_t i = 0; i + 4 <= data.pixels.size(); i += 4) {
+			std::swap(data.pixels[i + a], data.pixels[i + b]);
+		}
+	}
+
+}
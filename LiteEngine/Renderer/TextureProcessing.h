@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Resources.h"
+
+namespace LiteEngine::Rendering {
+
+	// 纹理中存放的是什么数据，决定了 CPU 端处理（mip、压缩）时怎么对待它
+	enum class TextureContent : uint32_t {
+		COLOR,		// RGB 是 gamma 编码的颜色（DefaultPS 中以 pow(x, 2.2) 解码），A 是线性的
+		DATA,		// 所有通道都是线性数据（metallic / roughness / AO 等）
+		NORMAL		// 切线空间法线，[0, 1] 编码
+	};
+
+	// 为 R8G8B8A8_UNORM 的纹理生成完整的 mip 链（直到 1x1），覆盖已有的 mip
+	// COLOR 先转换到线性空间再做 2x2 box filter；NORMAL 在平均后重新归一化
+	void generateMipChain(TextureData& data, TextureContent content);
+
+	// 交换 R8G8B8A8_UNORM 纹理的两个通道（所有 mip）
+	void swapChannels(TextureData& data, uint32_t a, uint32_t b);
+
+	// 所有 mip 加起来的字节数
+	inline size_t getTextureMemorySize(const TextureData& data) {
+		return data.pixels.size();
+	}
+
+}
@@ -0,0 +1,443 @@
+#include "Animation.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		uint32_t getComponentCount(AnimationPath path) {
+			return path == AnimationPath::ROTATION ? 4 : 3;
+		}
+
+		// 返回 k，使 times[k] <= time < times[k + 1]，k 在 [0, count - 2] 之间（超出范围时取两端）
+		// 播放时时间通常只前进一点，先从上一次的位置向后找几步，找不到再二分
+		uint32_t findKey(const float* times, uint32_t count, float time, uint32_t& cursor, AnimationStatistics* statistics) {
+			if (count < 2) return 0;
+			constexpr uint32_t MAX_STEPS = 4;
+			uint32_t last = count - 2;
+
+			uint32_t k = cursor;
+			if (k <= last && times[k] <= time) {
+				uint32_t steps = 0;
+				while (k < last && times[k + 1] <= time && steps < MAX_STEPS) {
+					k++;
+					steps++;
+				}
+				if (k == last || times[k + 1] > time) {
+					if (statistics) {
+						if (steps == 0) statistics->cursorHits++;
+						else statistics->cursorSteps += steps;
+					}
+					cursor = k;
+					return k;
+				}
+			}
+
+			if (statistics) statistics->cursorSearches++;
+			auto it = std::upper_bound(times + 1, times + count - 1, time);
+			k = (uint32_t)(it - times) - 1;
+			cursor = k;
+			return k;
+		}
+
+		// 一个通道在某时刻所在的区间：两端的时间在 times 中的位置，两端的值在 x / y / z / w 中的位置
+		struct KeySpan {
+			uint32_t time0;
+			uint32_t time1;
+			uint32_t value0;
+			uint32_t value1;
+			uint32_t outTangent0;	// 仅三次样条
+			uint32_t inTangent1;	// 仅三次样条
+			bool step;
+		};
+
+		KeySpan getKeySpan(
+			const AnimationClip& clip,
+			const AnimationClip::Channel& channel,
+			float time,
+			uint32_t& cursor,
+			AnimationStatistics* statistics
+		) {
+			auto k = findKey(clip.times.data() + channel.keyBegin, channel.keyCount, time, cursor, statistics);
+			// 只有一个关键帧时两端相同，区间长度为 0
+			auto k1 = channel.keyCount < 2 ? k : k + 1;
+
+			KeySpan span;
+			span.time0 = channel.keyBegin + k;
+			span.time1 = channel.keyBegin + k1;
+			span.step = channel.interpolation == AnimationInterpolation::STEP;
+			if (channel.interpolation == AnimationInterpolation::CUBIC_SPLINE) {
+				span.value0 = channel.valueBegin + 3 * k + 1;
+				span.outTangent0 = channel.valueBegin + 3 * k + 2;
+				span.inTangent1 = channel.valueBegin + 3 * k1;
+				span.value1 = channel.valueBegin + 3 * k1 + 1;
+			} else {
+				span.value0 = channel.valueBegin + k;
+				span.value1 = channel.valueBegin + k1;
+				span.outTangent0 = span.value0;
+				span.inTangent1 = span.value1;
+			}
+			return span;
+		}
+
+		// 区间内的参数 [0, 1]。阶梯插值只有超过最后一个关键帧时才取后一个值
+		float getSpanParameter(const AnimationClip& clip, const KeySpan& span, float time) {
+			auto t0 = clip.times[span.time0];
+			auto t1 = clip.times[span.time1];
+			if (span.step) return time >= t1 && t1 > t0 ? 1.f : 0.f;
+			return t1 > t0 ? std::clamp((time - t0) / (t1 - t0), 0.f, 1.f) : 0.f;
+		}
+
+		void writeTarget(Object* object, AnimationPath path, float x, float y, float z, float w) {
+			switch (path) {
+			case AnimationPath::TRANSLATION:
+				object->transT = DirectX::XMFLOAT3{ x, y, z };
+				break;
+			case AnimationPath::ROTATION:
+				object->transR = DirectX::XMVectorSet(x, y, z, w);
+				break;
+			case AnimationPath::SCALE:
+				object->transS = DirectX::XMFLOAT3{ x, y, z };
+				break;
+			}
+		}
+
+		void ensureCursors(AnimationPlayer& player) {
+			if (player.cursors.size() != player.clip->channels.size()) {
+				player.cursors.assign(player.clip->channels.size(), 0);
+			}
+		}
+
+		// 四个通道的同一分量放在一个向量的四个分量中
+		DirectX::XMVECTOR XM_CALLCONV gather(const std::vector<float>& values, const uint32_t* index) {
+			return DirectX::XMVectorSet(values[index[0]], values[index[1]], values[index[2]], values[index[3]]);
+		}
+
+		// 一批（最多四个）路径和插值方式相同的通道
+		template <AnimationPath PATH, bool CUBIC>
+		void sampleBatch(
+			AnimationPlayer& player,
+			const AnimationClip::Batch& batch,
+			float time,
+			AnimationStatistics* statistics
+		) {
+			using namespace DirectX;
+			constexpr bool ROTATION = PATH == AnimationPath::ROTATION;
+
+			auto& clip = *player.clip;
+			auto& store = ObjectStore::getInstance();
+
+			for (uint32_t base = 0; base < batch.channelCount; base += 4) {
+				uint32_t lanes = std::min(4u, batch.channelCount - base);
+
+				uint32_t time0[4], time1[4], value0[4], value1[4], outTangent0[4], inTangent1[4];
+				uint32_t step[4];
+				for (uint32_t lane = 0; lane < 4; lane++) {
+					if (lane >= lanes) {
+						// 不足四个时重复最后一个通道，结果不写入
+						time0[lane] = time0[lanes - 1];
+						time1[lane] = time1[lanes - 1];
+						value0[lane] = value0[lanes - 1];
+						value1[lane] = value1[lanes - 1];
+						outTangent0[lane] = outTangent0[lanes - 1];
+						inTangent1[lane] = inTangent1[lanes - 1];
+						step[lane] = step[lanes - 1];
+						continue;
+					}
+					auto channelID = batch.channelBegin + base + lane;
+					auto span = getKeySpan(clip, clip.channels[channelID], time, player.cursors[channelID], statistics);
+					time0[lane] = span.time0;
+					time1[lane] = span.time1;
+					value0[lane] = span.value0;
+					value1[lane] = span.value1;
+					outTangent0[lane] = span.outTangent0;
+					inTangent1[lane] = span.inTangent1;
+					step[lane] = span.step ? 0xFFFFFFFF : 0;
+				}
+
+				// 区间内的参数，与 getSpanParameter 相同
+				auto zero = XMVectorZero();
+				auto one = XMVectorSplatOne();
+				auto T = XMVectorReplicate(time);
+				auto T0 = gather(clip.times, time0);
+				auto T1 = gather(clip.times, time1);
+				auto DT = XMVectorSubtract(T1, T0);
+				auto nonEmpty = XMVectorGreater(DT, zero);
+				auto U = XMVectorDivide(XMVectorSubtract(T, T0), XMVectorSelect(one, DT, nonEmpty));
+				U = XMVectorSelect(zero, XMVectorClamp(U, zero, one), nonEmpty);
+				auto stepU = XMVectorSelect(zero, one, XMVectorAndInt(XMVectorGreaterOrEqual(T, T1), nonEmpty));
+				U = XMVectorSelect(U, stepU, XMLoadInt4(step));
+
+				XMVECTOR X, Y, Z, W;
+				if constexpr (CUBIC) {
+					auto U2 = XMVectorMultiply(U, U);
+					auto U3 = XMVectorMultiply(U2, U);
+					auto two = XMVectorReplicate(2);
+					auto three = XMVectorReplicate(3);
+
+					// Hermite 基函数
+					auto H00 = XMVectorAdd(XMVectorSubtract(XMVectorMultiply(two, U3), XMVectorMultiply(three, U2)), one);
+					auto H10 = XMVectorMultiply(XMVectorAdd(XMVectorSubtract(U3, XMVectorMultiply(two, U2)), U), DT);
+					auto H01 = XMVectorSubtract(XMVectorMultiply(three, U2), XMVectorMultiply(two, U3));
+					auto H11 = XMVectorMultiply(XMVectorSubtract(U3, U2), DT);
+
+					auto hermite = [&](const std::vector<float>& values) {
+						auto out = XMVectorMultiply(H00, gather(values, value0));
+						out = XMVectorMultiplyAdd(H10, gather(values, outTangent0), out);
+						out = XMVectorMultiplyAdd(H01, gather(values, value1), out);
+						out = XMVectorMultiplyAdd(H11, gather(values, inTangent1), out);
+						return out;
+					};
+					X = hermite(clip.x);
+					Y = hermite(clip.y);
+					Z = hermite(clip.z);
+					W = ROTATION ? hermite(clip.w) : zero;
+				} else {
+					XMVECTOR X0 = gather(clip.x, value0), Y0 = gather(clip.y, value0), Z0 = gather(clip.z, value0);
+					XMVECTOR X1 = gather(clip.x, value1), Y1 = gather(clip.y, value1), Z1 = gather(clip.z, value1);
+					XMVECTOR W0 = zero, W1 = zero;
+					if constexpr (ROTATION) {
+						W0 = gather(clip.w, value0);
+						W1 = gather(clip.w, value1);
+
+						// 走较短的一侧
+						auto dot = XMVectorMultiply(X0, X1);
+						dot = XMVectorMultiplyAdd(Y0, Y1, dot);
+						dot = XMVectorMultiplyAdd(Z0, Z1, dot);
+						dot = XMVectorMultiplyAdd(W0, W1, dot);
+						auto sign = XMVectorSelect(one, XMVectorNegate(one), XMVectorLess(dot, zero));
+						X1 = XMVectorMultiply(X1, sign);
+						Y1 = XMVectorMultiply(Y1, sign);
+						Z1 = XMVectorMultiply(Z1, sign);
+						W1 = XMVectorMultiply(W1, sign);
+					}
+					X = XMVectorLerpV(X0, X1, U);
+					Y = XMVectorLerpV(Y0, Y1, U);
+					Z = XMVectorLerpV(Z0, Z1, U);
+					W = XMVectorLerpV(W0, W1, U);
+				}
+
+				if constexpr (ROTATION) {
+					auto length2 = XMVectorMultiply(X, X);
+					length2 = XMVectorMultiplyAdd(Y, Y, length2);
+					length2 = XMVectorMultiplyAdd(Z, Z, length2);
+					length2 = XMVectorMultiplyAdd(W, W, length2);
+					auto inverseLength = XMVectorReciprocalSqrt(length2);
+					X = XMVectorMultiply(X, inverseLength);
+					Y = XMVectorMultiply(Y, inverseLength);
+					Z = XMVectorMultiply(Z, inverseLength);
+					W = XMVectorMultiply(W, inverseLength);
+				}
+
+				XMFLOAT4 xs, ys, zs, ws;
+				XMStoreFloat4(&xs, X);
+				XMStoreFloat4(&ys, Y);
+				XMStoreFloat4(&zs, Z);
+				XMStoreFloat4(&ws, W);
+				const float* lx = &xs.x;
+				const float* ly = &ys.x;
+				const float* lz = &zs.x;
+				const float* lw = &ws.x;
+				for (uint32_t lane = 0; lane < lanes; lane++) {
+					auto& channel = clip.channels[batch.channelBegin + base + lane];
+					if (auto object = store.resolve(player.targets[channel.target]); object) {
+						writeTarget(object, PATH, lx[lane], ly[lane], lz[lane], lw[lane]);
+					}
+				}
+			}
+
+			if (statistics) statistics->sampledChannels += batch.channelCount;
+		}
+
+	}
+
+	uint32_t AnimationClip::addChannel(
+		uint32_t target,
+		AnimationPath path,
+		AnimationInterpolation interpolation,
+		const float* keyTimes,
+		const float* values,
+		uint32_t keyCount
+	) {
+		if (keyCount == 0) {
+			throw std::exception("animation channel has no keyframe");
+		}
+		if (target >= targets.size()) {
+			throw std::exception("animation channel target is out of range");
+		}
+		for (uint32_t i = 1; i < keyCount; i++) {
+			if (keyTimes[i] < keyTimes[i - 1]) {
+				throw std::exception("animation keyframe times must be increasing");
+			}
+		}
+
+		Channel channel;
+		channel.target = target;
+		channel.path = path;
+		channel.interpolation = interpolation;
+		channel.keyBegin = (uint32_t)times.size();
+		channel.keyCount = keyCount;
+		channel.valueBegin = (uint32_t)x.size();
+
+		times.insert(times.end(), keyTimes, keyTimes + keyCount);
+
+		auto components = getComponentCount(path);
+		auto valueCount = interpolation == AnimationInterpolation::CUBIC_SPLINE ? keyCount * 3 : keyCount;
+		for (uint32_t i = 0; i < valueCount; i++) {
+			auto value = values + i * components;
+			x.push_back(value[0]);
+			y.push_back(value[1]);
+			z.push_back(value[2]);
+			w.push_back(components == 4 ? value[3] : 0.f);
+		}
+
+		channels.push_back(channel);
+		return (uint32_t)channels.size() - 1;
+	}
+
+	void AnimationClip::finalize() {
+		auto batchKey = [](const Channel& channel) {
+			return std::make_pair(channel.interpolation == AnimationInterpolation::CUBIC_SPLINE, channel.path);
+		};
+		std::stable_sort(channels.begin(), channels.end(), [&](const Channel& a, const Channel& b) {
+			return batchKey(a) < batchKey(b);
+		});
+
+		batches.clear();
+		for (uint32_t i = 0; i < channels.size(); i++) {
+			auto [cubic, path] = batchKey(channels[i]);
+			if (batches.empty() || batches.back().cubic != cubic || batches.back().path != path) {
+				batches.push_back({ i, 0, path, cubic });
+			}
+			batches.back().channelCount++;
+		}
+
+		duration = 0;
+		for (auto& channel : channels) {
+			duration = std::max(duration, times[channel.keyBegin + channel.keyCount - 1]);
+		}
+	}
+
+	size_t AnimationClip::getMemoryBytes() const {
+		size_t bytes = channels.size() * sizeof(Channel) + batches.size() * sizeof(Batch);
+		bytes += (times.size() + x.size() + y.size() + z.size() + w.size()) * sizeof(float);
+		for (auto& target : targets) bytes += target.size() * sizeof(uint32_t);
+		return bytes;
+	}
+
+	AnimationPlayer createAnimationPlayer(const std::shared_ptr<const AnimationClip>& clip, const Object& root) {
+		AnimationPlayer player;
+		player.clip = clip;
+		player.targets.resize(clip->targets.size());
+		player.cursors.assign(clip->channels.size(), 0);
+
+		for (size_t i = 0; i < clip->targets.size(); i++) {
+			if (auto node = root.getDescendant(clip->targets[i]); node) {
+				player.targets[i] = node->getHandle();
+			} else {
+				auto name = i < clip->targetNames.size() ? clip->targetNames[i] : std::to_string(i);
+				log(LogLevel::WARNING, "animation " + clip->name + ": target " + name + " is not found\n");
+			}
+		}
+		return player;
+	}
+
+	void sampleAnimation(AnimationPlayer& player, float time, AnimationStatistics* statistics) {
+		if (!player.clip) return;
+		ensureCursors(player);
+
+		for (auto& batch : player.clip->batches) {
+			switch (batch.path) {
+			case AnimationPath::TRANSLATION:
+				if (batch.cubic) sampleBatch<AnimationPath::TRANSLATION, true>(player, batch, time, statistics);
+				else sampleBatch<AnimationPath::TRANSLATION, false>(player, batch, time, statistics);
+				break;
+			case AnimationPath::ROTATION:
+				if (batch.cubic) sampleBatch<AnimationPath::ROTATION, true>(player, batch, time, statistics);
+				else sampleBatch<AnimationPath::ROTATION, false>(player, batch, time, statistics);
+				break;
+			case AnimationPath::SCALE:
+				if (batch.cubic) sampleBatch<AnimationPath::SCALE, true>(player, batch, time, statistics);
+				else sampleBatch<AnimationPath::SCALE, false>(player, batch, time, statistics);
+				break;
+			}
+		}
+	}
+
+	void sampleAnimationScalar(AnimationPlayer& player, float time, AnimationStatistics* statistics) {
+		if (!player.clip) return;
+		ensureCursors(player);
+
+		auto& clip = *player.clip;
+		auto& store = ObjectStore::getInstance();
+		for (uint32_t channelID = 0; channelID < clip.channels.size(); channelID++) {
+			auto& channel = clip.channels[channelID];
+			auto span = getKeySpan(clip, channel, time, player.cursors[channelID], statistics);
+			auto u = getSpanParameter(clip, span, time);
+			auto dt = clip.times[span.time1] - clip.times[span.time0];
+			bool rotation = channel.path == AnimationPath::ROTATION;
+
+			float out[4];
+			const std::vector<float>* components[4] = { &clip.x, &clip.y, &clip.z, &clip.w };
+			if (channel.interpolation == AnimationInterpolation::CUBIC_SPLINE) {
+				auto u2 = u * u, u3 = u2 * u;
+				auto h00 = 2 * u3 - 3 * u2 + 1;
+				auto h10 = (u3 - 2 * u2 + u) * dt;
+				auto h01 = 3 * u2 - 2 * u3;
+				auto h11 = (u3 - u2) * dt;
+				for (int i = 0; i < 4; i++) {
+					auto& values = *components[i];
+					out[i] = h00 * values[span.value0] + h10 * values[span.outTangent0] +
+						h01 * values[span.value1] + h11 * values[span.inTangent1];
+				}
+			} else {
+				float sign = 1;
+				if (rotation) {
+					float dot = 0;
+					for (int i = 0; i < 4; i++) dot += (*components[i])[span.value0] * (*components[i])[span.value1];
+					if (dot < 0) sign = -1;
+				}
+				for (int i = 0; i < 4; i++) {
+					auto v0 = (*components[i])[span.value0];
+					auto v1 = (*components[i])[span.value1] * sign;
+					out[i] = v0 + (v1 - v0) * u;
+				}
+			}
+
+			if (rotation) {
+				auto length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2] + out[3] * out[3]);
+				for (int i = 0; i < 4; i++) out[i] /= length;
+			}
+
+			if (auto object = store.resolve(player.targets[channel.target]); object) {
+				writeTarget(object, channel.path, out[0], out[1], out[2], out[3]);
+			}
+			if (statistics) statistics->sampledChannels++;
+		}
+	}
+
+	AnimationStatistics updateAnimationPlayers(ComponentStore& components, double deltaSeconds) {
+		AnimationStatistics statistics;
+		components.view<AnimationPlayer>().each([&](ObjectHandle, AnimationPlayer& player) {
+			if (!player.playing || !player.clip) return;
+
+			double duration = player.clip->duration;
+			player.time += deltaSeconds * player.speed;
+			if (player.loop && duration > 0) {
+				player.time = std::fmod(player.time, duration);
+				if (player.time < 0) player.time += duration;
+			} else if ((player.speed > 0 && player.time >= duration) || (player.speed < 0 && player.time <= 0)) {
+				// 播放到头后停在最后（倒放时是最前）一帧
+				player.time = std::clamp(player.time, 0.0, duration);
+				player.playing = false;
+			}
+
+			sampleAnimation(player, (float)player.time, &statistics);
+		});
+		return statistics;
+	}
+
+}
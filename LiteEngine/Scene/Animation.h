@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ObjectStore.h"
+#include "Component.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LiteEngine::SceneManagement {
+
+	struct Object;
+
+	enum class AnimationPath : uint8_t {
+		TRANSLATION,		// 写入 transT
+		ROTATION,			// 写入 transR
+		SCALE				// 写入 transS
+	};
+
+	enum class AnimationInterpolation : uint8_t {
+		STEP,
+		LINEAR,				// 旋转用归一化的线性插值（nlerp）近似 slerp
+		CUBIC_SPLINE		// glTF 的 Hermite 样条，每个关键帧带入切线和出切线
+	};
+
+	// 一段关键帧动画。每个通道驱动一个目标节点的 T、R 或 S
+	// 创建后不再修改，多个 AnimationPlayer 共享
+	//
+	// 关键帧按 SoA 存放：所有通道的时间在 times 中，值的四个分量分别在 x、y、z、w 中，
+	// 一批通道的同一分量可以直接放进一个 SIMD 寄存器的四个分量。平移和缩放的 w 为 0
+	// 三次样条的每个关键帧在 x / y / z / w 中占三项：入切线、值、出切线
+	class AnimationClip {
+	public:
+		struct Channel {
+			uint32_t target;		// targets 中的下标
+			AnimationPath path;
+			AnimationInterpolation interpolation;
+			uint32_t keyBegin;		// 在 times 中的位置
+			uint32_t keyCount;
+			uint32_t valueBegin;	// 在 x / y / z / w 中的位置
+		};
+
+		// 路径和插值方式（是否三次样条）都相同的一段连续通道，一起成批采样
+		struct Batch {
+			uint32_t channelBegin;
+			uint32_t channelCount;
+			AnimationPath path;
+			bool cubic;
+		};
+
+		std::string name;
+		float duration = 0;
+
+		// 每个目标节点：从模型根节点开始，逐层在 children 中的下标
+		// 复制出的实例与原模型的层级相同，所以同一个 clip 可以绑定到任何实例上
+		std::vector<std::vector<uint32_t>> targets;
+		std::vector<std::string> targetNames;		// 仅用于调试
+
+		std::vector<Channel> channels;
+		std::vector<Batch> batches;
+
+		std::vector<float> times;
+		std::vector<float> x, y, z, w;
+
+		// values: 每个关键帧 3 个（平移、缩放）或 4 个（旋转）分量；三次样条时每个关键帧依次是入切线、值、出切线
+		// times 必须递增
+		uint32_t addChannel(
+			uint32_t target,
+			AnimationPath path,
+			AnimationInterpolation interpolation,
+			const float* keyTimes,
+			const float* values,
+			uint32_t keyCount
+		);
+
+		// 所有通道添加完后调用：按 (是否三次样条, 路径) 重排通道并划分 batch，计算 duration
+		void finalize();
+
+		size_t getMemoryBytes() const;
+	};
+
+	// 播放 clip 的组件，通常挂在模型实例的根节点上
+	// 采样结果直接写入目标节点的 transT / transR / transS
+	struct AnimationPlayer {
+		std::shared_ptr<const AnimationClip> clip;
+		std::vector<ObjectHandle> targets;			// 与 clip->targets 一一对应，已销毁或找不到的目标不写入
+		std::vector<uint32_t> cursors;				// 每个通道上一次所在的关键帧区间
+		double time = 0;
+		float speed = 1;
+		bool loop = true;
+		bool playing = true;
+	};
+
+	struct AnimationStatistics {
+		uint64_t sampledChannels = 0;
+		uint64_t cursorHits = 0;		// 时间仍在上一次的关键帧区间内
+		uint64_t cursorSteps = 0;		// 向后移动了几个区间
+		uint64_t cursorSearches = 0;	// 时间倒退（循环）或跳得太远，重新二分查找
+	};
+
+	// 按 clip->targets 中的路径在 root 下查找目标节点
+	AnimationPlayer createAnimationPlayer(const std::shared_ptr<const AnimationClip>& clip, const Object& root);
+
+	// 在 time 时刻采样 player 的所有通道，每批四个通道用 SIMD 同时插值
+	void sampleAnimation(AnimationPlayer& player, float time, AnimationStatistics* statistics = nullptr);
+
+	// 逐个通道的标量实现，结果与 sampleAnimation 相同（用于对照）
+	void sampleAnimationScalar(AnimationPlayer& player, float time, AnimationStatistics* statistics = nullptr);
+
+	// 推进所有正在播放的 AnimationPlayer 并采样
+	AnimationStatistics updateAnimationPlayers(ComponentStore& components, double deltaSeconds);
+
+	// 构造一个有 channels 个通道的随机 clip，比较标量采样与 SIMD 成批采样每毫秒能采样的通道数
+	std::string runAnimationBenchmark(uint32_t channels = 3000, uint32_t keysPerChannel = 64, uint32_t frames = 300);
+
+}
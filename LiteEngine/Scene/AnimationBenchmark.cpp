@@ -0,0 +1,164 @@
+#include "Animation.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		// 每个目标节点三个通道（T / R / S），插值方式随机
+		std::shared_ptr<AnimationClip> createRandomClip(uint32_t channels, uint32_t keysPerChannel, std::mt19937& random) {
+			std::uniform_real_distribution<float> value(-1.f, 1.f);
+			std::uniform_real_distribution<float> interval(0.02f, 0.1f);
+			std::uniform_int_distribution<int> interpolation(0, 7);
+
+			std::shared_ptr<AnimationClip> clip(new AnimationClip());
+			clip->name = "benchmark";
+			uint32_t targets = (channels + 2) / 3;
+			for (uint32_t i = 0; i < targets; i++) {
+				clip->targets.push_back({ i });
+			}
+
+			std::vector<float> times(keysPerChannel);
+			std::vector<float> values;
+			for (uint32_t i = 0; i < channels; i++) {
+				auto path = (AnimationPath)(i % 3);
+				// 大部分是线性插值，少量阶梯和三次样条
+				auto kind = interpolation(random);
+				auto interp = kind == 0 ? AnimationInterpolation::STEP :
+					kind == 1 ? AnimationInterpolation::CUBIC_SPLINE : AnimationInterpolation::LINEAR;
+
+				float t = 0;
+				for (auto& time : times) {
+					time = t;
+					t += interval(random);
+				}
+
+				uint32_t components = path == AnimationPath::ROTATION ? 4 : 3;
+				uint32_t valueCount = interp == AnimationInterpolation::CUBIC_SPLINE ? keysPerChannel * 3 : keysPerChannel;
+				values.resize(valueCount * components);
+				for (auto& v : values) v = value(random);
+				if (path == AnimationPath::ROTATION && interp != AnimationInterpolation::CUBIC_SPLINE) {
+					for (uint32_t k = 0; k < valueCount; k++) {
+						auto q = &values[k * 4];
+						auto length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+						for (int c = 0; c < 4; c++) q[c] /= length;
+					}
+				}
+
+				clip->addChannel(i / 3, path, interp, times.data(), values.data(), keysPerChannel);
+			}
+			clip->finalize();
+			return clip;
+		}
+
+		struct RunResult {
+			double milliseconds;
+			AnimationStatistics statistics;
+		};
+
+		// 重复几次取最快的一次，减少其他程序的干扰
+		template <typename Sample>
+		RunResult run(AnimationPlayer& player, uint32_t frames, Sample&& sample) {
+			constexpr uint32_t REPEAT = 3;
+			RunResult best{};
+			for (uint32_t repeat = 0; repeat < REPEAT; repeat++) {
+				RunResult result{};
+				std::fill(player.cursors.begin(), player.cursors.end(), 0);
+				double time = 0;
+				auto begin = std::chrono::steady_clock::now();
+				for (uint32_t frame = 0; frame < frames; frame++) {
+					sample(player, (float)time, &result.statistics);
+					time = std::fmod(time + 1.0 / 60, player.clip->duration);
+				}
+				result.milliseconds = millisecondsSince(begin);
+				if (repeat == 0 || result.milliseconds < best.milliseconds) best = result;
+			}
+			return best;
+		}
+
+		float maxDifference(const Object& a, const Object& b) {
+			float diff = 0;
+			diff = std::max(diff, (float)std::abs(a.transT.x - b.transT.x));
+			diff = std::max(diff, (float)std::abs(a.transT.y - b.transT.y));
+			diff = std::max(diff, (float)std::abs(a.transT.z - b.transT.z));
+			diff = std::max(diff, std::abs(a.transS.x - b.transS.x));
+			diff = std::max(diff, std::abs(a.transS.y - b.transS.y));
+			diff = std::max(diff, std::abs(a.transS.z - b.transS.z));
+			// q 与 -q 是同一个旋转
+			DirectX::XMFLOAT4 qa, qb;
+			DirectX::XMStoreFloat4(&qa, a.transR);
+			DirectX::XMStoreFloat4(&qb, b.transR);
+			float dot = qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w;
+			diff = std::max(diff, 1 - std::abs(dot));
+			return diff;
+		}
+
+	}
+
+	std::string runAnimationBenchmark(uint32_t channels, uint32_t keysPerChannel, uint32_t frames) {
+		std::mt19937 random(2023);
+		auto clip = createRandomClip(channels, keysPerChannel, random);
+
+		std::shared_ptr<Object> root(new Object("AnimationBenchmark"));
+		std::shared_ptr<Object> reference(new Object("AnimationBenchmarkReference"));
+		for (size_t i = 0; i < clip->targets.size(); i++) {
+			root->children.push_back(std::shared_ptr<Object>(new Object()));
+			reference->children.push_back(std::shared_ptr<Object>(new Object()));
+		}
+
+		auto player = createAnimationPlayer(clip, *root);
+		auto referencePlayer = createAnimationPlayer(clip, *reference);
+
+		auto scalar = run(player, frames, sampleAnimationScalar);
+		auto batched = run(player, frames, [](AnimationPlayer& player, float time, AnimationStatistics* statistics) {
+			sampleAnimation(player, time, statistics);
+		});
+
+		// 两种实现在若干时刻的结果应当一致
+		float difference = 0;
+		for (uint32_t i = 0; i <= 16; i++) {
+			float time = clip->duration * i / 16;
+			sampleAnimation(player, time);
+			sampleAnimationScalar(referencePlayer, time);
+			for (size_t j = 0; j < root->children.size(); j++) {
+				difference = std::max(difference, maxDifference(*root->children[j], *reference->children[j]));
+			}
+		}
+		if (difference > 1e-3f) {
+			throw std::exception("animation benchmark: batched sampler differs from the scalar one");
+		}
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "animation: %u channels, %u keys each, %zu batches, %u frames, %.1f KiB of keys\n",
+			(uint32_t)clip->channels.size(), keysPerChannel, clip->batches.size(), frames, clip->getMemoryBytes() / 1024.0);
+		out << line;
+		snprintf(line, sizeof(line), "%-8s %10s %16s %8s %12s %12s %12s\n",
+			"sampler", "ms", "channels / ms", "speedup", "cursor hit", "steps", "searches");
+		out << line;
+		for (auto [name, result] : { std::make_pair("scalar", scalar), std::make_pair("simd", batched) }) {
+			auto& stat = result.statistics;
+			snprintf(line, sizeof(line), "%-8s %10.2f %16.0f %7.2fx %12llu %12llu %12llu\n",
+				name, result.milliseconds, stat.sampledChannels / result.milliseconds,
+				scalar.milliseconds / result.milliseconds,
+				(unsigned long long)stat.cursorHits, (unsigned long long)stat.cursorSteps, (unsigned long long)stat.cursorSearches);
+			out << line;
+		}
+		snprintf(line, sizeof(line), "max difference between samplers: %g\n", difference);
+		out << line;
+		return out.str();
+	}
+
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "ObjectStore.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace LiteEngine::SceneManagement {
+
+	class ComponentPoolBase {
+	public:
+		virtual ~ComponentPoolBase() = default;
+
+		virtual uint32_t size() const = 0;
+		virtual const ObjectHandle* getHandles() const = 0;
+		virtual bool contains(ObjectHandle handle) const = 0;
+		virtual bool remove(ObjectHandle handle) = 0;
+
+		// 删除所属物体已经销毁的组件，返回删除的个数
+		virtual uint32_t removeStale() = 0;
+	};
+
+	// 某一类组件的稀疏集合
+	// sparse: 句柄的槽位 -> dense 下标，按页分配；dense: 句柄和组件各自连续存放，没有空洞
+	// 删除时用最后一个元素填补空位，所以 dense 的顺序会变，遍历时不要增删同类组件
+	template <typename T>
+	class ComponentPool : public ComponentPoolBase {
+		static constexpr uint32_t PAGE_SIZE = 4096;
+		static constexpr uint32_t INVALID = UINT32_MAX;
+
+		std::vector<std::unique_ptr<uint32_t[]>> sparsePages;
+		std::vector<ObjectHandle> handles;
+		std::vector<T> components;
+
+		uint32_t getDenseIndex(uint32_t slot) const {
+			auto page = slot / PAGE_SIZE;
+			if (page >= sparsePages.size() || !sparsePages[page]) return INVALID;
+			return sparsePages[page][slot % PAGE_SIZE];
+		}
+
+		void setDenseIndex(uint32_t slot, uint32_t dense) {
+			auto page = slot / PAGE_SIZE;
+			if (page >= sparsePages.size()) sparsePages.resize(page + 1);
+			if (!sparsePages[page]) {
+				sparsePages[page].reset(new uint32_t[PAGE_SIZE]);
+				std::fill(sparsePages[page].get(), sparsePages[page].get() + PAGE_SIZE, INVALID);
+			}
+			sparsePages[page][slot % PAGE_SIZE] = dense;
+		}
+
+		void swapDense(uint32_t a, uint32_t b) {
+			if (a == b) return;
+			std::swap(handles[a], handles[b]);
+			std::swap(components[a], components[b]);
+			setDenseIndex(handles[a].getIndex(), a);
+			setDenseIndex(handles[b].getIndex(), b);
+		}
+
+	public:
+		// 已经存在时替换。槽位被新物体复用时，旧物体残留的组件也会被替换
+		template <typename... Args>
+		T& add(ObjectHandle handle, Args&&... args) {
+			if (handle.isNull()) {
+				throw std::exception("cannot add a component to a null handle");
+			}
+			auto dense = getDenseIndex(handle.getIndex());
+			if (dense != INVALID) {
+				handles[dense] = handle;
+				components[dense] = T{ std::forward<Args>(args)... };
+				return components[dense];
+			}
+			setDenseIndex(handle.getIndex(), (uint32_t)handles.size());
+			handles.push_back(handle);
+			components.push_back(T{ std::forward<Args>(args)... });
+			return components.back();
+		}
+
+		T* get(ObjectHandle handle) {
+			auto dense = getDenseIndex(handle.getIndex());
+			if (dense == INVALID || handles[dense] != handle) return nullptr;
+			return &components[dense];
+		}
+
+		const T* get(ObjectHandle handle) const {
+			return const_cast<ComponentPool*>(this)->get(handle);
+		}
+
+		// hint: 猜测的 dense 下标。几个池按同一顺序排列（见 sortLike）时直接命中，不需要访问 sparse
+		T* get(ObjectHandle handle, uint32_t hint) {
+			if (hint < handles.size() && handles[hint] == handle) return &components[hint];
+			return get(handle);
+		}
+
+		virtual bool contains(ObjectHandle handle) const override {
+			return get(handle) != nullptr;
+		}
+
+		virtual bool remove(ObjectHandle handle) override {
+			auto dense = getDenseIndex(handle.getIndex());
+			if (dense == INVALID || handles[dense] != handle) return false;
+
+			auto last = (uint32_t)handles.size() - 1;
+			swapDense(dense, last);
+			setDenseIndex(handle.getIndex(), INVALID);
+			handles.pop_back();
+			components.pop_back();
+			return true;
+		}
+
+		virtual uint32_t removeStale() override {
+			auto& store = ObjectStore::getInstance();
+			uint32_t removed = 0;
+			for (uint32_t i = (uint32_t)handles.size(); i-- > 0;) {
+				if (store.resolve(handles[i]) == nullptr) {
+					remove(handles[i]);
+					removed++;
+				}
+			}
+			return removed;
+		}
+
+		// 把 reference 中也有的组件按 reference 的顺序移到前面
+		// 之后同时遍历两类组件时，两边都是顺序访问
+		void sortLike(const ComponentPoolBase& reference) {
+			auto referenceHandles = reference.getHandles();
+			uint32_t next = 0;
+			for (uint32_t i = 0; i < reference.size(); i++) {
+				auto dense = getDenseIndex(referenceHandles[i].getIndex());
+				if (dense == INVALID || handles[dense] != referenceHandles[i]) continue;
+				swapDense(next++, dense);
+			}
+		}
+
+		virtual uint32_t size() const override {
+			return (uint32_t)handles.size();
+		}
+
+		virtual const ObjectHandle* getHandles() const override {
+			return handles.data();
+		}
+
+		T* getComponents() {
+			return components.data();
+		}
+
+		typename std::vector<T>::iterator begin() { return components.begin(); }
+		typename std::vector<T>::iterator end() { return components.end(); }
+	};
+
+	// 同时具有 Ts 中所有组件的物体
+	template <typename... Ts>
+	class ComponentView {
+		std::tuple<ComponentPool<Ts>*...> pools;
+
+	public:
+		explicit ComponentView(ComponentPool<Ts>&... pools) : pools(&pools...) {}
+
+		// func(ObjectHandle, Ts&...)
+		// 以最小的池为主循环，按 dense 顺序遍历；其他池先按相同下标猜测，猜不中再查 sparse
+		// 遍历期间不要增删 Ts 中的组件
+		template <typename Func>
+		void each(Func&& func) {
+			const ComponentPoolBase* lead = nullptr;
+			std::apply([&](auto*... pool) {
+				((lead = (lead == nullptr || pool->size() < lead->size()) ? pool : lead), ...);
+			}, pools);
+
+			auto count = lead->size();
+			auto leadHandles = lead->getHandles();
+			for (uint32_t i = 0; i < count; i++) {
+				auto handle = leadHandles[i];
+				auto found = std::make_tuple(std::get<ComponentPool<Ts>*>(pools)->get(handle, i)...);
+				bool complete = std::apply([](auto*... component) { return ((component != nullptr) && ...); }, found);
+				if (!complete) continue;
+				std::apply([&](auto*... component) { func(handle, *component...); }, found);
+			}
+		}
+	};
+
+	// 物体上的组件，按物体句柄索引。每类组件一个 ComponentPool
+	// 不是线程安全的
+	class ComponentStore {
+		std::unordered_map<std::type_index, std::unique_ptr<ComponentPoolBase>> pools;
+
+	public:
+		template <typename T>
+		ComponentPool<T>& getPool() {
+			auto& pool = pools[std::type_index(typeid(T))];
+			if (!pool) pool.reset(new ComponentPool<T>());
+			return static_cast<ComponentPool<T>&>(*pool);
+		}
+
+		template <typename T, typename... Args>
+		T& add(ObjectHandle handle, Args&&... args) {
+			return getPool<T>().add(handle, std::forward<Args>(args)...);
+		}
+
+		template <typename T>
+		T* get(ObjectHandle handle) {
+			return getPool<T>().get(handle);
+		}
+
+		template <typename T>
+		bool has(ObjectHandle handle) {
+			return getPool<T>().contains(handle);
+		}
+
+		template <typename T>
+		bool remove(ObjectHandle handle) {
+			return getPool<T>().remove(handle);
+		}
+
+		// 物体是否有任何一种组件
+		bool hasAny(ObjectHandle handle) const {
+			for (auto& [type, pool] : pools) {
+				if (pool->contains(handle)) return true;
+			}
+			return false;
+		}
+
+		// 删除物体的所有组件
+		void removeAll(ObjectHandle handle) {
+			for (auto& [type, pool] : pools) {
+				pool->remove(handle);
+			}
+		}
+
+		// 删除所属物体已经销毁的组件
+		uint32_t removeStale() {
+			uint32_t removed = 0;
+			for (auto& [type, pool] : pools) {
+				removed += pool->removeStale();
+			}
+			return removed;
+		}
+
+		template <typename... Ts>
+		ComponentView<Ts...> view() {
+			return ComponentView<Ts...>(getPool<Ts>()...);
+		}
+
+		// 把 Others 按 Lead 的顺序排列，之后 view<Lead, Others...>() 是顺序访问
+		template <typename Lead, typename... Others>
+		void sortLike() {
+			auto& lead = getPool<Lead>();
+			(getPool<Others>().sortLike(lead), ...);
+		}
+	};
+
+}
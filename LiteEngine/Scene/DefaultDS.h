@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 #include "../Renderer/Resources.h"
+#include "../Renderer/BlockCompression.h"
 #include "Scene.h"
 
 namespace LiteEngine::SceneManagement {
@@ -17,6 +18,32 @@ namespace LiteEngine::SceneManagement {
 		NORMAL
 	};
 
+	// 烘焙纹理时各个 slot 使用的块压缩格式
+	// 金属度 / 粗糙度烘焙时会被换到 R / G 通道；法线贴图只保留 XY，Z 由 DefaultPS 重建
+	inline DXGI_FORMAT getDefaultCompressedFormat(
+		DefaultShaderSlot slot,
+		bool hasAlpha,
+		Rendering::BlockCompressionQuality quality
+	) {
+		switch (slot) {
+		case DefaultShaderSlot::BASE_COLOR:
+			if (quality == Rendering::BlockCompressionQuality::HIGH) return DXGI_FORMAT_BC7_UNORM;
+			return hasAlpha ? DXGI_FORMAT_BC3_UNORM : DXGI_FORMAT_BC1_UNORM;
+		case DefaultShaderSlot::EMISSION_COLOR:
+			if (quality == Rendering::BlockCompressionQuality::HIGH) return DXGI_FORMAT_BC7_UNORM;
+			return DXGI_FORMAT_BC1_UNORM;
+		case DefaultShaderSlot::METALLIC:
+		case DefaultShaderSlot::ROUGHNESS:
+			return DXGI_FORMAT_BC5_UNORM;
+		case DefaultShaderSlot::AMBIENT_OCCLUSION:
+			return DXGI_FORMAT_BC4_UNORM;
+		case DefaultShaderSlot::NORMAL:
+			return DXGI_FORMAT_BC5_UNORM;
+		default:
+			return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
 #pragma pack(push, 1)
 	struct DefaultVertexData {
 		DirectX::XMFLOAT3 position{ 0, 0, 0 };
@@ -64,6 +91,7 @@ namespace LiteEngine::SceneManagement {
 
 		uint32_t channelMetallic = 0;
 		uint32_t channelAO = 0;
+		uint32_t normalReconstructZ = 0;	// 法线贴图只有 XY 两个通道（BC5）
 	};
 	static_assert(sizeof(DefaultMaterialConstantData) == 6 * 4 * 4);
 
@@ -74,6 +102,7 @@ namespace LiteEngine::SceneManagement {
 			);
 			this->defaultShader = shader;
 			this->shaders[Rendering::ShaderSemantics::DEPTH_MAP] = nullptr;
+			this->shaders[Rendering::ShaderSemantics::CASCADED_DEPTH_MAP] = nullptr;
 		}
 
 		Rendering::PtrSamplerState sampBaseColor;
@@ -111,5 +140,22 @@ namespace LiteEngine::SceneManagement {
 				{ sampNormal, (uint32_t)DefaultShaderSlot::NORMAL }
 			};
 		}
+
+	protected:
+		virtual void bindShaderResourcesAndSamplers(ID3D11DeviceContext* context) {
+			bindShaderResourceView(context, texBaseColor, (uint32_t)DefaultShaderSlot::BASE_COLOR);
+			bindShaderResourceView(context, texEmissionColor, (uint32_t)DefaultShaderSlot::EMISSION_COLOR);
+			bindShaderResourceView(context, texMetallic, (uint32_t)DefaultShaderSlot::METALLIC);
+			bindShaderResourceView(context, texRoughness, (uint32_t)DefaultShaderSlot::ROUGHNESS);
+			bindShaderResourceView(context, texAO, (uint32_t)DefaultShaderSlot::AMBIENT_OCCLUSION);
+			bindShaderResourceView(context, texNormal, (uint32_t)DefaultShaderSlot::NORMAL);
+
+			bindSamplerState(context, sampBaseColor, (uint32_t)DefaultShaderSlot::BASE_COLOR);
+			bindSamplerState(context, sampEmissionColor, (uint32_t)DefaultShaderSlot::EMISSION_COLOR);
+			bindSamplerState(context, sampMetallic, (uint32_t)DefaultShaderSlot::METALLIC);
+			bindSamplerState(context, sampRoughness, (uint32_t)DefaultShaderSlot::ROUGHNESS);
+			bindSamplerState(context, sampAO, (uint32_t)DefaultShaderSlot::AMBIENT_OCCLUSION);
+			bindSamplerState(context, sampNormal, (uint32_t)DefaultShaderSlot::NORMAL);
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "HierarchyFlattening.h"
+#include "Animation.h"
+#include "Skinning.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <typeinfo>
+#include <vector>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		// 被组件或相机通过句柄引用的节点
+		struct References {
+			std::set<ObjectHandle> handles;
+			ComponentStore* components;
+
+			bool isReferenced(const std::shared_ptr<Object>& node) const {
+				// 只有父节点的 children 持有时 use_count 为 1
+				return node.use_count() > 1 || handles.count(node->getHandle()) || components->hasAny(node->getHandle());
+			}
+		};
+
+		void collectLookAtTargets(const Object& node, std::set<ObjectHandle>& handles) {
+			if (auto camera = dynamic_cast<const Camera*>(&node); camera) {
+				handles.insert(camera->worldLookAtObject.getHandle());
+			}
+			for (auto& child : node.children) collectLookAtTargets(*child, handles);
+		}
+
+		uint32_t countNodes(const Object& node) {
+			uint32_t count = 1;
+			for (auto& child : node.children) count += countNodes(*child);
+			return count;
+		}
+
+		bool isTransformOnly(const Object& node) {
+			return typeid(node) == typeid(Object);
+		}
+
+		bool isIdentity(const Object& node) {
+			return node.transT.x == 0 && node.transT.y == 0 && node.transT.z == 0 &&
+				DirectX::XMQuaternionIsIdentity(node.transR) &&
+				node.transS.x == 1 && node.transS.y == 1 && node.transS.z == 1;
+		}
+
+		bool hasUniformScale(const Object& node) {
+			constexpr float TOLERANCE = 1e-6f;
+			auto& s = node.transS;
+			return std::abs(s.x - s.y) <= TOLERANCE * std::abs(s.x) && std::abs(s.x - s.z) <= TOLERANCE * std::abs(s.x);
+		}
+
+		bool isCollapsible(const std::shared_ptr<Object>& node, const References& references) {
+			if (!isTransformOnly(*node) || references.isReferenced(node)) return false;
+			if (isIdentity(*node)) return true;
+			if (!hasUniformScale(*node)) return false;
+			for (auto& child : node->children) {
+				if (references.isReferenced(child)) return false;
+			}
+			return true;
+		}
+
+		// child 的父节点 parent 被删除：child 的新 TRS = child 的 TRS，再作用 parent 的 TRS
+		// parent 的缩放是均匀的，可以与 child 的旋转交换，所以结果仍然是 TRS
+		void fuseParentTransform(Object& child, const Object& parent) {
+			child.transT = parent.getLocalTransform().transformPoint(child.transT);
+			child.transR = DirectX::XMQuaternionMultiply(child.transR, parent.transR);
+			child.transS = { child.transS.x * parent.transS.x, child.transS.y * parent.transS.x, child.transS.z * parent.transS.x };
+		}
+
+		// 后序：先压平子树，所以一串可以删除的节点会从下往上依次合并到最下面的子节点上
+		void flatten(Object& node, const References& references, uint32_t& pinned) {
+			std::vector<std::shared_ptr<Object>> children;
+			children.reserve(node.children.size());
+			for (auto& child : node.children) {
+				flatten(*child, references, pinned);
+				if (!isCollapsible(child, references)) {
+					if (isTransformOnly(*child)) pinned++;
+					children.push_back(child);
+					continue;
+				}
+				bool identity = isIdentity(*child);
+				for (auto& grandchild : child->children) {
+					if (!identity) fuseParentTransform(*grandchild, *child);
+					grandchild->parent = &node;
+					children.push_back(grandchild);
+				}
+			}
+			// 被删除的节点在这里析构
+			node.children = std::move(children);
+		}
+
+		// 从 node 的子节点开始，找出两个以上首尾相连的只传递变换的节点（中间的节点只有一个子节点）
+		// 链上不能有 impostor，除第一个节点外不能有层（它们需要在遍历到该节点时处理）
+		void findTransformChains(Object& node, ComponentStore& components, HierarchyFlatteningStatistics& statistics) {
+			auto& impostors = components.getPool<Impostor>();
+			auto& layerMasks = components.getPool<RenderLayerMask>();
+			auto canLink = [&](const Object& candidate) {
+				return isTransformOnly(candidate) && !impostors.contains(candidate.getHandle());
+			};
+
+			for (auto& child : node.children) {
+				Object* last = child.get();
+				if (canLink(*child)) {
+					std::vector<const Object*> links = { child.get() };
+					while (last->children.size() == 1 && canLink(*last->children[0]) && !layerMasks.contains(last->children[0]->getHandle())) {
+						last = last->children[0].get();
+						links.push_back(last);
+					}
+					if (links.size() >= 2) {
+						auto& chain = components.add<TransformChainCache>(child->getHandle());
+						for (auto link : links) chain.links.push_back({ link });
+						statistics.cachedChains++;
+						statistics.cachedChainNodes += (uint32_t)links.size();
+					}
+				}
+				findTransformChains(*last, components, statistics);
+			}
+		}
+
+		double measureRenderingScene(Scene& scene) {
+			constexpr uint32_t REPEAT = 32;
+			if (scene.activeCamera == nullptr || scene.rootObject == nullptr) return 0;
+			auto begin = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < REPEAT; i++) scene.getRenderingScene();
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / REPEAT;
+		}
+
+	}
+
+	std::string HierarchyFlatteningStatistics::getReport() const {
+		char line[256];
+		snprintf(line, sizeof(line), "hierarchy flattening: %u -> %u nodes (%u transform-only nodes kept, %u in %u cached chains), rendering scene %.3f -> %.3f ms\n",
+			nodesBefore, nodesAfter, pinnedNodes, cachedChainNodes, cachedChains, millisecondsBefore, millisecondsAfter);
+		return line;
+	}
+
+	HierarchyFlatteningStatistics flattenHierarchy(Scene& scene) {
+		HierarchyFlatteningStatistics statistics;
+		if (scene.rootObject == nullptr) return statistics;
+
+		// 上一次调用时挂的链先去掉：它不算引用，结构也可能已经变化
+		auto& chains = scene.components.getPool<TransformChainCache>();
+		while (chains.size() != 0) chains.remove(chains.getHandles()[0]);
+
+		References references;
+		references.components = &scene.components;
+		scene.components.view<AnimationPlayer>().each([&](ObjectHandle, AnimationPlayer& player) {
+			references.handles.insert(player.targets.begin(), player.targets.end());
+		});
+		scene.components.view<SkinnedMesh>().each([&](ObjectHandle, SkinnedMesh& mesh) {
+			references.handles.insert(mesh.joints.begin(), mesh.joints.end());
+		});
+		collectLookAtTargets(*scene.rootObject, references.handles);
+
+		statistics.nodesBefore = countNodes(*scene.rootObject);
+		statistics.millisecondsBefore = measureRenderingScene(scene);
+		flatten(*scene.rootObject, references, statistics.pinnedNodes);
+		findTransformChains(*scene.rootObject, scene.components, statistics);
+		statistics.nodesAfter = countNodes(*scene.rootObject);
+		statistics.millisecondsAfter = measureRenderingScene(scene);
+		return statistics;
+	}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <cstdint>
+#include <string>
+
+namespace LiteEngine::SceneManagement {
+
+	// 层级压平：删除只传递变换的中间节点，把它们的 TRS 合并到子节点上，之后构建 RenderingScene 时少访问、少乘这些节点
+	// 一个节点可以删除，当且仅当：
+	//   - 类型就是 Object（不是 Mesh / Camera / Light，也不是 IO::AssetInstance 等子类），且不是根节点
+	//   - 只被父节点的 children 持有：应用程序没有保存它的 shared_ptr，之后不会再修改它
+	//   - 没有任何组件，也不是动画目标、骨骼或相机的注视目标
+	//   - 缩放是均匀的（否则与子节点的旋转合并后会产生切变，不能再表示为 TRS）
+	// 不是单位变换时，它的子节点也必须满足第二、三条，否则之后写入子节点的 TRS 会覆盖合并进去的变换
+	// 压平之后节点的路径（Object::getDescendant）会变化，请在创建完动画、蒙皮等组件之后调用
+	// 因为被引用而保留下来、首尾相连的一串只传递变换的节点，在第一个节点上挂 TransformChainCache：
+	// 之后构建 RenderingScene 时不再逐个相乘，TRS 没有变化的链直接使用缓存的乘积
+	struct HierarchyFlatteningStatistics {
+		uint32_t nodesBefore = 0;
+		uint32_t nodesAfter = 0;
+		uint32_t pinnedNodes = 0;			// 只传递变换，但因为被引用而保留的节点
+		uint32_t cachedChains = 0;			// 挂了 TransformChainCache 的链
+		uint32_t cachedChainNodes = 0;		// 这些链上的节点
+		double millisecondsBefore = 0;		// 一次 Scene::getRenderingScene 的平均耗时，没有 activeCamera 时为 0
+		double millisecondsAfter = 0;
+
+		std::string getReport() const;
+	};
+
+	HierarchyFlatteningStatistics flattenHierarchy(Scene& scene);
+
+}
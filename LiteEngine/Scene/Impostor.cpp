@@ -0,0 +1,372 @@
+#include "Impostor.h"
+
+#include "../Renderer/TextureProcessing.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		float signNotZero(float x) {
+			return x >= 0 ? 1.f : -1.f;
+		}
+
+		DirectX::XMFLOAT3 operator-(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+			return { a.x - b.x, a.y - b.y, a.z - b.z };
+		}
+
+		float dot(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		DirectX::XMFLOAT3 normalize(const DirectX::XMFLOAT3& v) {
+			auto length = std::sqrt(dot(v, v));
+			if (length < 1e-12f) return { 0, 0, 0 };
+			return { v.x / length, v.y / length, v.z / length };
+		}
+
+		DirectX::XMFLOAT3 cross(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+			return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		}
+
+		float decodeGamma(uint8_t value) {
+			return std::pow(value / 255.f, 2.2f);
+		}
+
+		uint8_t encodeGamma(float value) {
+			return (uint8_t)std::lround(std::clamp(std::pow(std::max(value, 0.f), 1 / 2.2f), 0.f, 1.f) * 255);
+		}
+
+		uint8_t encodeUnit(float value) {
+			return (uint8_t)std::lround(std::clamp(value, 0.f, 1.f) * 255);
+		}
+
+		// 一张纹理在某一级 mip 上的双线性采样（重复寻址），结果是线性的 RGBA
+		DirectX::XMFLOAT4 sampleTexture(const Rendering::TextureData& texture, uint32_t mip, float u, float v) {
+			auto& level = texture.mips[mip];
+			auto pixels = texture.getMipData(mip);
+			float x = u * level.width - 0.5f, y = v * level.height - 0.5f;
+			float fx = std::floor(x), fy = std::floor(y);
+			float wx = x - fx, wy = y - fy;
+
+			auto wrap = [](float value, uint32_t size) {
+				auto i = (int64_t)value % (int64_t)size;
+				return (uint32_t)(i < 0 ? i + size : i);
+			};
+			uint32_t x0 = wrap(fx, level.width), x1 = wrap(fx + 1, level.width);
+			uint32_t y0 = wrap(fy, level.height), y1 = wrap(fy + 1, level.height);
+
+			float result[4];
+			for (uint32_t c = 0; c < 4; c++) {
+				auto at = [&](uint32_t px, uint32_t py) {
+					auto value = pixels[(size_t)py * level.rowPitch + px * 4 + c];
+					return c < 3 ? decodeGamma(value) : value / 255.f;
+				};
+				auto top = at(x0, y0) * (1 - wx) + at(x1, y0) * wx;
+				auto bottom = at(x0, y1) * (1 - wx) + at(x1, y1) * wx;
+				result[c] = top * (1 - wy) + bottom * wy;
+			}
+			return { result[0], result[1], result[2], result[3] };
+		}
+
+		DirectX::XMFLOAT2 getTexCoord(const DefaultVertexData& vertex, uint32_t texCoord) {
+			return texCoord == 0 ? vertex.texCoord0 : vertex.texCoord1;
+		}
+
+		// 变换到模型空间之后的 primitive
+		struct PreparedSource {
+			std::vector<DirectX::XMFLOAT3> positions;
+			std::vector<DirectX::XMFLOAT3> normals;
+		};
+
+		// 一个格子中可见的三角形，着色推迟到光栅化之后，每个像素只着色一次
+		struct Fragment {
+			float depth = -FLT_MAX;
+			uint32_t source = UINT32_MAX;
+			uint32_t triangle;
+			float b1, b2;
+		};
+
+		// 按三角形在格子中覆盖的像素数和纹理坐标覆盖的纹素数之比选择 mip
+		uint32_t selectMip(const ImpostorTexture& texture, const DirectX::XMFLOAT2 uv[3], float pixelArea) {
+			auto& level = texture.data->mips[0];
+			float du1 = (uv[1].x - uv[0].x) * level.width, dv1 = (uv[1].y - uv[0].y) * level.height;
+			float du2 = (uv[2].x - uv[0].x) * level.width, dv2 = (uv[2].y - uv[0].y) * level.height;
+			float texelArea = std::abs(du1 * dv2 - du2 * dv1);
+			if (texelArea <= 0 || pixelArea <= 0) return 0;
+			auto mip = 0.5f * std::log2(texelArea / pixelArea);
+			return (uint32_t)std::clamp(mip, 0.f, (float)texture.data->mips.size() - 1);
+		}
+
+		// 没有覆盖的像素取相邻已填充像素颜色的平均，alpha 保持为 0
+		void dilateFrame(Rendering::TextureData& texture, std::vector<uint8_t>& filled, uint32_t originX, uint32_t originY, uint32_t size, uint32_t iterations) {
+			auto pitch = texture.mips[0].rowPitch;
+			auto pixels = texture.pixels.data();
+			std::vector<uint8_t> next;
+			for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+				next = filled;
+				bool changed = false;
+				for (uint32_t y = 0; y < size; y++) {
+					for (uint32_t x = 0; x < size; x++) {
+						if (filled[y * size + x]) continue;
+						uint32_t sum[3] = {}, count = 0;
+						const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+						for (auto& offset : offsets) {
+							int nx = (int)x + offset[0], ny = (int)y + offset[1];
+							if (nx < 0 || ny < 0 || nx >= (int)size || ny >= (int)size || !filled[ny * size + nx]) continue;
+							auto neighbor = pixels + (size_t)(originY + ny) * pitch + (originX + nx) * 4;
+							for (int c = 0; c < 3; c++) sum[c] += neighbor[c];
+							count++;
+						}
+						if (count == 0) continue;
+						auto pixel = pixels + (size_t)(originY + y) * pitch + (originX + x) * 4;
+						for (int c = 0; c < 3; c++) pixel[c] = (uint8_t)((sum[c] + count / 2) / count);
+						next[y * size + x] = 1;
+						changed = true;
+					}
+				}
+				filled.swap(next);
+				if (!changed) break;
+			}
+		}
+
+		Rendering::TextureData createAtlasTexture(uint32_t size) {
+			Rendering::TextureData texture;
+			texture.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			Rendering::TextureData::MipLevel level;
+			level.width = size;
+			level.height = size;
+			level.offset = 0;
+			level.rowPitch = size * 4;
+			level.slicePitch = level.rowPitch * size;
+			texture.mips.push_back(level);
+			texture.pixels.resize(level.slicePitch, 0);
+			return texture;
+		}
+
+	}
+
+	DirectX::XMFLOAT2 encodeOctahedron(DirectX::XMFLOAT3 direction) {
+		auto sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+		if (sum <= 0) return { 0.5f, 0.5f };
+		float x = direction.x / sum, y = direction.y / sum, z = direction.z / sum;
+		if (y < 0) {
+			float folded = (1 - std::abs(z)) * signNotZero(x);
+			z = (1 - std::abs(x)) * signNotZero(z);
+			x = folded;
+		}
+		return { x * 0.5f + 0.5f, z * 0.5f + 0.5f };
+	}
+
+	DirectX::XMFLOAT3 decodeOctahedron(DirectX::XMFLOAT2 uv) {
+		float x = uv.x * 2 - 1, z = uv.y * 2 - 1;
+		float y = 1 - std::abs(x) - std::abs(z);
+		if (y < 0) {
+			float folded = (1 - std::abs(z)) * signNotZero(x);
+			z = (1 - std::abs(x)) * signNotZero(z);
+			x = folded;
+		}
+		return normalize({ x, y, z });
+	}
+
+	DirectX::XMFLOAT3 getImpostorFrameDirection(uint32_t x, uint32_t y, uint32_t framesPerSide) {
+		float scale = 1.f / std::max(1u, framesPerSide - 1);
+		return decodeOctahedron({ x * scale, y * scale });
+	}
+
+	void getImpostorFrameBasis(DirectX::XMFLOAT3 direction, DirectX::XMFLOAT3& right, DirectX::XMFLOAT3& up) {
+		// 接近竖直时改用 +Z 作为参考的“上”
+		DirectX::XMFLOAT3 reference = std::abs(direction.y) < 0.999f ? DirectX::XMFLOAT3{ 0, 1, 0 } : DirectX::XMFLOAT3{ 0, 0, 1 };
+		right = normalize(cross(reference, direction));
+		up = cross(direction, right);
+	}
+
+	ImpostorAtlas bakeImpostor(const std::vector<ImpostorSource>& sources, const ImpostorBakeOptions& options) {
+		ImpostorAtlas atlas;
+		atlas.framesPerSide = std::max(2u, options.framesPerSide);
+		atlas.frameSize = std::max(4u, options.frameSize);
+
+		// 变换到模型空间，同时求包围球（包围盒的中心，到最远顶点的距离）
+		std::vector<PreparedSource> prepared(sources.size());
+		DirectX::XMFLOAT3 lower{ FLT_MAX, FLT_MAX, FLT_MAX }, upper{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		uint32_t triangles = 0;
+		for (size_t i = 0; i < sources.size(); i++) {
+			auto& source = sources[i];
+			auto transform = DirectX::XMLoadFloat4x4(&source.transform);
+			auto normalTransform = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, transform));
+			auto& out = prepared[i];
+			out.positions.resize(source.vertexCount);
+			out.normals.resize(source.vertexCount);
+			for (uint32_t v = 0; v < source.vertexCount; v++) {
+				auto& vertex = source.vertices[v];
+				DirectX::XMStoreFloat3(&out.positions[v], DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&vertex.position), transform));
+				DirectX::XMStoreFloat3(&out.normals[v], DirectX::XMVector3Normalize(
+					DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&vertex.normal), normalTransform)));
+			}
+			for (uint32_t j = 0; j < source.indexCount; j++) {
+				auto& p = out.positions[source.indices[j] - source.indexBase];
+				lower = { std::min(lower.x, p.x), std::min(lower.y, p.y), std::min(lower.z, p.z) };
+				upper = { std::max(upper.x, p.x), std::max(upper.y, p.y), std::max(upper.z, p.z) };
+			}
+			triangles += source.indexCount / 3;
+		}
+		if (triangles == 0) {
+			throw std::exception("nothing to bake into the impostor");
+		}
+
+		atlas.center = { (lower.x + upper.x) / 2, (lower.y + upper.y) / 2, (lower.z + upper.z) / 2 };
+		for (size_t i = 0; i < sources.size(); i++) {
+			for (uint32_t j = 0; j < sources[i].indexCount; j++) {
+				auto offset = prepared[i].positions[sources[i].indices[j] - sources[i].indexBase] - atlas.center;
+				atlas.radius = std::max(atlas.radius, std::sqrt(dot(offset, offset)));
+			}
+		}
+		atlas.radius = std::max(atlas.radius, 1e-6f);
+
+		auto frames = atlas.framesPerSide;
+		auto size = atlas.frameSize;
+		atlas.albedo = createAtlasTexture(frames * size);
+		atlas.normal = createAtlasTexture(frames * size);
+		atlas.emission = createAtlasTexture(frames * size);
+		auto pitch = atlas.albedo.mips[0].rowPitch;
+
+		// 每个格子写入图集中互不重叠的区域，可以并行
+		JobSystem::getInstance().parallelFor(0, frames * frames, 1, [&](uint32_t begin, uint32_t end) {
+			std::vector<Fragment> fragments(size * size);
+			std::vector<DirectX::XMFLOAT3> projected;
+			for (uint32_t frame = begin; frame < end; frame++) {
+				uint32_t frameX = frame % frames, frameY = frame / frames;
+				auto direction = getImpostorFrameDirection(frameX, frameY, frames);
+				DirectX::XMFLOAT3 right, up;
+				getImpostorFrameBasis(direction, right, up);
+
+				std::fill(fragments.begin(), fragments.end(), Fragment());
+
+				// 正交投影：[-radius, radius] 映射到整个格子，像素的 y 向下
+				for (uint32_t s = 0; s < (uint32_t)sources.size(); s++) {
+					auto& source = sources[s];
+					auto& positions = prepared[s].positions;
+					projected.resize(positions.size());
+					for (size_t v = 0; v < positions.size(); v++) {
+						auto offset = positions[v] - atlas.center;
+						projected[v] = {
+							(dot(offset, right) / atlas.radius * 0.5f + 0.5f) * size,
+							(0.5f - dot(offset, up) / atlas.radius * 0.5f) * size,
+							dot(offset, direction)
+						};
+					}
+
+					for (uint32_t t = 0; t + 2 < source.indexCount; t += 3) {
+						auto& a = projected[source.indices[t] - source.indexBase];
+						auto& b = projected[source.indices[t + 1] - source.indexBase];
+						auto& c = projected[source.indices[t + 2] - source.indexBase];
+						float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+						if (std::abs(area) < 1e-12f) continue;
+
+						// 两面都光栅化：背面的像素会被更近的正面覆盖
+						int minX = std::max(0, (int)std::floor(std::min({ a.x, b.x, c.x })));
+						int maxX = std::min((int)size - 1, (int)std::ceil(std::max({ a.x, b.x, c.x })));
+						int minY = std::max(0, (int)std::floor(std::min({ a.y, b.y, c.y })));
+						int maxY = std::min((int)size - 1, (int)std::ceil(std::max({ a.y, b.y, c.y })));
+						for (int y = minY; y <= maxY; y++) {
+							for (int x = minX; x <= maxX; x++) {
+								float px = x + 0.5f, py = y + 0.5f;
+								float b1 = ((px - a.x) * (c.y - a.y) - (c.x - a.x) * (py - a.y)) / area;
+								float b2 = ((b.x - a.x) * (py - a.y) - (px - a.x) * (b.y - a.y)) / area;
+								float b0 = 1 - b1 - b2;
+								if (b0 < 0 || b1 < 0 || b2 < 0) continue;
+								float depth = a.z * b0 + b.z * b1 + c.z * b2;
+								auto& fragment = fragments[y * size + x];
+								if (depth <= fragment.depth) continue;
+								fragment = { depth, s, t, b1, b2 };
+							}
+						}
+					}
+				}
+
+				// 着色
+				uint32_t originX = frameX * size, originY = frameY * size;
+				std::vector<uint8_t> filled(size * size, 0);
+				for (uint32_t y = 0; y < size; y++) {
+					for (uint32_t x = 0; x < size; x++) {
+						auto& fragment = fragments[y * size + x];
+						if (fragment.source == UINT32_MAX) continue;
+						filled[y * size + x] = 1;
+
+						auto& source = sources[fragment.source];
+						auto& normals = prepared[fragment.source].normals;
+						uint32_t ids[3];
+						for (int k = 0; k < 3; k++) ids[k] = source.indices[fragment.triangle + k] - source.indexBase;
+						float weights[3] = { 1 - fragment.b1 - fragment.b2, fragment.b1, fragment.b2 };
+
+						DirectX::XMFLOAT3 normal{ 0, 0, 0 };
+						DirectX::XMFLOAT4 color{ 0, 0, 0, 0 };
+						for (int k = 0; k < 3; k++) {
+							auto& n = normals[ids[k]];
+							auto& vc = source.vertices[ids[k]].color;
+							normal = { normal.x + n.x * weights[k], normal.y + n.y * weights[k], normal.z + n.z * weights[k] };
+							color = { color.x + vc.x * weights[k], color.y + vc.y * weights[k], color.z + vc.z * weights[k], color.w + vc.w * weights[k] };
+						}
+						normal = normalize(normal);
+						// 看到的是背面时把法线翻到朝向观察者的一侧
+						if (dot(normal, direction) < 0) normal = { -normal.x, -normal.y, -normal.z };
+
+						// 三角形的像素面积用于选择纹理的 mip
+						auto& positions = prepared[fragment.source].positions;
+						auto e1 = positions[ids[1]] - positions[ids[0]], e2 = positions[ids[2]] - positions[ids[0]];
+						auto areaNormal = cross(e1, e2);
+						float pixelsPerUnit = size / (2 * atlas.radius);
+						float pixelArea = std::abs(dot(areaNormal, direction)) * 0.5f * pixelsPerUnit * pixelsPerUnit;
+
+						auto sample = [&](const ImpostorTexture& texture) {
+							if (texture.data == nullptr || texture.data->mips.empty()) return DirectX::XMFLOAT4{ 1, 1, 1, 1 };
+							DirectX::XMFLOAT2 uv[3];
+							for (int k = 0; k < 3; k++) uv[k] = getTexCoord(source.vertices[ids[k]], texture.texCoord);
+							float u = uv[0].x * weights[0] + uv[1].x * weights[1] + uv[2].x * weights[2];
+							float v = uv[0].y * weights[0] + uv[1].y * weights[1] + uv[2].y * weights[2];
+							return sampleTexture(*texture.data, selectMip(texture, uv, pixelArea * 0.5f), u, v);
+						};
+
+						auto base = sample(source.baseColorTexture);
+						auto emission = sample(source.emissionTexture);
+
+						auto offset = (size_t)(originY + y) * pitch + (originX + x) * 4;
+						auto albedoPixel = atlas.albedo.pixels.data() + offset;
+						albedoPixel[0] = encodeGamma(source.baseColor.x * color.x * base.x);
+						albedoPixel[1] = encodeGamma(source.baseColor.y * color.y * base.y);
+						albedoPixel[2] = encodeGamma(source.baseColor.z * color.z * base.z);
+						albedoPixel[3] = 255;
+
+						auto normalPixel = atlas.normal.pixels.data() + offset;
+						normalPixel[0] = encodeUnit(normal.x * 0.5f + 0.5f);
+						normalPixel[1] = encodeUnit(normal.y * 0.5f + 0.5f);
+						normalPixel[2] = encodeUnit(normal.z * 0.5f + 0.5f);
+						normalPixel[3] = 255;
+
+						auto emissionPixel = atlas.emission.pixels.data() + offset;
+						emissionPixel[0] = encodeGamma(source.emissionColor.x * color.x * emission.x);
+						emissionPixel[1] = encodeGamma(source.emissionColor.y * color.y * emission.y);
+						emissionPixel[2] = encodeGamma(source.emissionColor.z * color.z * emission.z);
+						emissionPixel[3] = 255;
+					}
+				}
+
+				// 填充到 mip 缩小到一个像素之前都不会混入空白：格子边长的一半足够
+				for (auto texture : { &atlas.albedo, &atlas.normal, &atlas.emission }) {
+					auto mask = filled;
+					dilateFrame(*texture, mask, originX, originY, size, size / 2);
+				}
+			}
+		});
+
+		Rendering::generateMipChain(atlas.albedo, Rendering::TextureContent::COLOR);
+		Rendering::generateMipChain(atlas.normal, Rendering::TextureContent::DATA);
+		Rendering::generateMipChain(atlas.emission, Rendering::TextureContent::COLOR);
+		return atlas;
+	}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../Renderer/Resources.h"
+#include "DefaultDS.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace LiteEngine::SceneManagement {
+
+	// Impostor：预先从许多方向把整个模型渲染到一张图集中，远处只画一个朝向相机的面片
+	// 方向用八面体映射排成 framesPerSide x framesPerSide 的网格，每一格是沿该方向的正交投影，刚好框住模型的包围球
+	// 绘制时取相机方向所在三角形的三个格子按重心坐标混合（见 ImpostorPS.hlsl），转动时不会跳变
+	// 这里只在 CPU 上光栅化，不访问 D3D。创建 GPU 资源由调用方负责
+
+	// 单位向量 <-> [0, 1]^2。+Y 在中心，-Y 在四角
+	DirectX::XMFLOAT2 encodeOctahedron(DirectX::XMFLOAT3 direction);
+	DirectX::XMFLOAT3 decodeOctahedron(DirectX::XMFLOAT2 uv);
+
+	// 第 (x, y) 格的观察方向（从模型指向观察者）。格子位于网格的顶点上：uv = (x, y) / (framesPerSide - 1)
+	DirectX::XMFLOAT3 getImpostorFrameDirection(uint32_t x, uint32_t y, uint32_t framesPerSide);
+
+	// 格子中图像的横轴和纵轴（向上）。必须与 ImpostorPS.hlsl 中的 getFrameBasis 一致
+	void getImpostorFrameBasis(DirectX::XMFLOAT3 direction, DirectX::XMFLOAT3& right, DirectX::XMFLOAT3& up);
+
+	struct ImpostorTexture {
+		const Rendering::TextureData* data = nullptr;	// R8G8B8A8_UNORM，RGB 是 gamma 编码的颜色
+		uint32_t texCoord = 0;
+	};
+
+	// 参与烘焙的一个 primitive
+	struct ImpostorSource {
+		const DefaultVertexData* vertices;
+		uint32_t vertexCount;
+		const uint32_t* indices;
+		uint32_t indexCount;
+		uint32_t indexBase = 0;				// indices 中的值减去 indexBase 才是 vertices 中的下标
+		DirectX::XMFLOAT4X4 transform;		// primitive 的局部空间 -> 模型空间
+		DirectX::XMFLOAT4 baseColor{ 1, 1, 1, 1 };
+		DirectX::XMFLOAT3 emissionColor{ 0, 0, 0 };
+		ImpostorTexture baseColorTexture;
+		ImpostorTexture emissionTexture;
+	};
+
+	struct ImpostorBakeOptions {
+		uint32_t framesPerSide = 8;			// 至少为 2
+		uint32_t frameSize = 64;			// 每一格的边长（像素）
+	};
+
+	// 三张图集都是 R8G8B8A8_UNORM，边长 framesPerSide * frameSize，带完整的 mip 链
+	struct ImpostorAtlas {
+		uint32_t framesPerSide = 0;
+		uint32_t frameSize = 0;
+		DirectX::XMFLOAT3 center{ 0, 0, 0 };	// 模型空间中的包围球
+		float radius = 0;
+		Rendering::TextureData albedo;			// RGB: gamma 编码的基础色（已乘以顶点色），A: 覆盖率
+		Rendering::TextureData normal;			// 模型空间的法线，[0, 1] 编码
+		Rendering::TextureData emission;		// gamma 编码，超过 1 的部分被截断
+
+		// impostor 空间（包围球是原点处的单位球）-> 模型空间：只有缩放和平移，方向与模型空间相同
+		DirectX::XMMATRIX getImpostorToModelMatrix() const {
+			return DirectX::XMMatrixMultiply(
+				DirectX::XMMatrixScaling(radius, radius, radius),
+				DirectX::XMMatrixTranslation(center.x, center.y, center.z));
+		}
+
+		size_t getMemoryBytes() const {
+			return albedo.pixels.size() + normal.pixels.size() + emission.pixels.size();
+		}
+	};
+
+	// 各个格子在 JobSystem 上并行光栅化（深度测试，逐像素只着色最近的三角形），然后生成 mip
+	// 没有可见像素的部分用相邻像素的颜色填充，避免 mip 和双线性过滤在轮廓处混入黑色
+	// 没有三角形时抛出异常
+	ImpostorAtlas bakeImpostor(const std::vector<ImpostorSource>& sources, const ImpostorBakeOptions& options = {});
+
+	// 挂在模型实例的根节点上：屏幕上足够小时用 quad 代替节点下的所有 mesh（见 Renderer::impostorPixelSize）
+	struct Impostor {
+		std::shared_ptr<Rendering::MeshObject> quad;	// 见 Renderer::createImpostorMeshObject，每个实例一个
+		DirectX::XMFLOAT4X4 trans_I2L;					// impostor 空间 -> 所在节点的局部空间
+	};
+
+}
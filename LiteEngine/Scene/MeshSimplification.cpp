@@ -0,0 +1,274 @@
+#include "MeshSimplification.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <tuple>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		struct Vector {
+			double x, y, z;
+
+			Vector(const DirectX::XMFLOAT3& p) : x(p.x), y(p.y), z(p.z) {}
+			Vector(double x, double y, double z) : x(x), y(y), z(z) {}
+
+			Vector operator-(const Vector& v) const { return { x - v.x, y - v.y, z - v.z }; }
+			double dot(const Vector& v) const { return x * v.x + y * v.y + z * v.z; }
+			Vector cross(const Vector& v) const { return { y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x }; }
+			double length() const { return std::sqrt(dot(*this)); }
+		};
+
+		// 若干平面 n·p + d = 0 的二次误差之和，按三角形面积加权。evaluate 返回到这些平面的加权平均平方距离
+		struct Quadric {
+			double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+			double weight = 0;
+
+			void addPlane(const Vector& n, double d, double w) {
+				a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+				b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+				c2 += w * n.z * n.z; cd += w * n.z * d;
+				d2 += w * d * d;
+				weight += w;
+			}
+
+			Quadric operator+(const Quadric& q) const {
+				Quadric out = *this;
+				out.a2 += q.a2; out.ab += q.ab; out.ac += q.ac; out.ad += q.ad;
+				out.b2 += q.b2; out.bc += q.bc; out.bd += q.bd;
+				out.c2 += q.c2; out.cd += q.cd;
+				out.d2 += q.d2;
+				out.weight += q.weight;
+				return out;
+			}
+
+			double evaluate(const Vector& p) const {
+				if (weight <= 0) return 0;
+				double value =
+					a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z +
+					2 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z) +
+					2 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+				return std::max(value, 0.0) / weight;
+			}
+		};
+
+		struct Collapse {
+			double cost;
+			uint32_t from;		// 被折叠掉的位置（node）
+			uint32_t to;		// 折叠到的顶点（wedge），与 from 相邻
+		};
+
+		// 按 less 排序后把 equal 的顶点映射到同一个代表顶点
+		template <typename Less, typename Equal>
+		std::vector<uint32_t> groupVertices(uint32_t vertexCount, Less less, Equal equal) {
+			std::vector<uint32_t> order(vertexCount), remap(vertexCount);
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), less);
+			for (size_t i = 0; i < order.size(); i++) {
+				remap[order[i]] = (i > 0 && equal(order[i - 1], order[i])) ? remap[order[i - 1]] : order[i];
+			}
+			return remap;
+		}
+
+	}
+
+	SimplifiedMesh simplifyMesh(
+		const DefaultVertexData* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		uint32_t indexBase,
+		uint32_t targetIndexCount
+	) {
+		// 完全相同的顶点先合并成一个（wedge），位置相同的顶点再归为一个 node。折叠和误差都以 node 为单位
+		auto wedge = groupVertices(vertexCount,
+			[&](uint32_t a, uint32_t b) { return memcmp(&vertices[a], &vertices[b], sizeof(DefaultVertexData)) < 0; },
+			[&](uint32_t a, uint32_t b) { return memcmp(&vertices[a], &vertices[b], sizeof(DefaultVertexData)) == 0; });
+		auto node = groupVertices(vertexCount,
+			[&](uint32_t a, uint32_t b) {
+				auto& p = vertices[a].position;
+				auto& q = vertices[b].position;
+				return std::tie(p.x, p.y, p.z) < std::tie(q.x, q.y, q.z);
+			},
+			[&](uint32_t a, uint32_t b) {
+				auto& p = vertices[a].position;
+				auto& q = vertices[b].position;
+				return p.x == q.x && p.y == q.y && p.z == q.z;
+			});
+		auto position = [&](uint32_t vertex) { return Vector(vertices[vertex].position); };
+
+		// 去掉退化的三角形
+		std::vector<uint32_t> triangles;
+		triangles.reserve(indexCount);
+		for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+			uint32_t corners[3];
+			for (int k = 0; k < 3; k++) corners[k] = wedge[indices[i + k] - indexBase];
+			auto n0 = node[corners[0]], n1 = node[corners[1]], n2 = node[corners[2]];
+			if (n0 == n1 || n1 == n2 || n0 == n2) continue;
+			triangles.insert(triangles.end(), corners, corners + 3);
+		}
+
+		// 不能移动的 node：属性接缝（有多个 wedge）、边界或非流形边的端点
+		std::vector<uint8_t> locked(vertexCount, 0);
+		std::vector<uint32_t> firstWedge(vertexCount, UINT32_MAX);
+		for (auto w : triangles) {
+			auto& first = firstWedge[node[w]];
+			if (first == UINT32_MAX) first = w;
+			else if (first != w) locked[node[w]] = 1;
+		}
+		std::vector<std::pair<uint32_t, uint32_t>> edges;
+		edges.reserve(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				auto a = node[triangles[i + k]], b = node[triangles[i + (k + 1) % 3]];
+				edges.push_back({ std::min(a, b), std::max(a, b) });
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t begin = 0, end; begin < edges.size(); begin = end) {
+			for (end = begin + 1; end < edges.size() && edges[end] == edges[begin]; end++);
+			if (end - begin != 2) {
+				locked[edges[begin].first] = 1;
+				locked[edges[begin].second] = 1;
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < triangles.size(); i += 3) {
+			auto p0 = position(triangles[i]), p1 = position(triangles[i + 1]), p2 = position(triangles[i + 2]);
+			auto normal = (p1 - p0).cross(p2 - p0);
+			auto length = normal.length();
+			if (length == 0) continue;
+			normal = { normal.x / length, normal.y / length, normal.z / length };
+			for (int k = 0; k < 3; k++) {
+				quadrics[node[triangles[i + k]]].addPlane(normal, -normal.dot(p0), length * 0.5);
+			}
+		}
+
+		// 每一轮按代价从小到大折叠，一个 node 的一环邻域在一轮中只参与一次折叠，保证翻转检查有效
+		double maxCost = 0;
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1), adjacency;
+		std::vector<uint32_t> collapseTarget(vertexCount);
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<Collapse> collapses;
+
+		while (triangles.size() > targetIndexCount) {
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (auto w : triangles) adjacencyOffsets[node[w] + 1]++;
+			std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+			adjacency.resize(triangles.size());
+			{
+				auto cursor = adjacencyOffsets;
+				for (uint32_t i = 0; i < (uint32_t)triangles.size(); i++) {
+					adjacency[cursor[node[triangles[i]]]++] = i / 3;
+				}
+			}
+
+			collapses.clear();
+			for (size_t i = 0; i < triangles.size(); i += 3) {
+				for (int k = 0; k < 3; k++) {
+					auto w0 = triangles[i + k], w1 = triangles[i + (k + 1) % 3];
+					auto n0 = node[w0], n1 = node[w1];
+					if (!locked[n0]) collapses.push_back({ (quadrics[n0] + quadrics[n1]).evaluate(position(w1)), n0, w1 });
+					if (!locked[n1]) collapses.push_back({ (quadrics[n0] + quadrics[n1]).evaluate(position(w0)), n1, w0 });
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+				return std::tie(a.cost, a.from, a.to) < std::tie(b.cost, b.from, b.to);
+			});
+
+			std::fill(touched.begin(), touched.end(), 0);
+			std::fill(collapseTarget.begin(), collapseTarget.end(), UINT32_MAX);
+			size_t budget = (triangles.size() - targetIndexCount + 2) / 3;
+			size_t removed = 0, performed = 0;
+
+			for (auto& collapse : collapses) {
+				auto from = collapse.from, to = node[collapse.to];
+				if (touched[from] || touched[to]) continue;
+
+				// 不与目标相邻的三角形，折叠后法线不能偏转太多（否则会翻面或变成细长的三角形）
+				auto target = position(collapse.to);
+				bool valid = true;
+				size_t shared = 0;
+				for (auto it = adjacency.begin() + adjacencyOffsets[from]; valid && it != adjacency.begin() + adjacencyOffsets[from + 1]; ++it) {
+					auto t = triangles.data() + *it * 3;
+					if (node[t[0]] == to || node[t[1]] == to || node[t[2]] == to) {
+						shared++;
+						continue;
+					}
+					Vector before[3] = { position(t[0]), position(t[1]), position(t[2]) };
+					Vector after[3] = { before[0], before[1], before[2] };
+					for (int k = 0; k < 3; k++) {
+						if (node[t[k]] == from) after[k] = target;
+					}
+					auto n0 = (before[1] - before[0]).cross(before[2] - before[0]);
+					auto n1 = (after[1] - after[0]).cross(after[2] - after[0]);
+					valid = n0.dot(n1) > 0.25 * n0.length() * n1.length();
+				}
+				if (!valid || shared == 0) continue;
+
+				collapseTarget[from] = collapse.to;
+				quadrics[to] = quadrics[to] + quadrics[from];
+				maxCost = std::max(maxCost, collapse.cost);
+				for (auto it = adjacency.begin() + adjacencyOffsets[from]; it != adjacency.begin() + adjacencyOffsets[from + 1]; ++it) {
+					for (int k = 0; k < 3; k++) touched[node[triangles[*it * 3 + k]]] = 1;
+				}
+				removed += shared;
+				performed++;
+				if (removed >= budget) break;
+			}
+			if (performed == 0) break;
+
+			// from 不在接缝上，它的三角形都使用同一个 wedge，全部换成目标的 wedge
+			size_t write = 0;
+			for (size_t i = 0; i < triangles.size(); i += 3) {
+				uint32_t corners[3];
+				for (int k = 0; k < 3; k++) {
+					auto w = triangles[i + k];
+					corners[k] = collapseTarget[node[w]] == UINT32_MAX ? w : collapseTarget[node[w]];
+				}
+				auto n0 = node[corners[0]], n1 = node[corners[1]], n2 = node[corners[2]];
+				if (n0 == n1 || n1 == n2 || n0 == n2) continue;
+				for (int k = 0; k < 3; k++) triangles[write++] = corners[k];
+			}
+			triangles.resize(write);
+		}
+
+		SimplifiedMesh out;
+		out.indices = std::move(triangles);
+		for (auto& index : out.indices) index += indexBase;
+		out.error = (float)std::sqrt(maxCost);
+		return out;
+	}
+
+	std::vector<SimplifiedMesh> buildLodChain(
+		const DefaultVertexData* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		uint32_t indexBase,
+		const LodChainOptions& options
+	) {
+		std::vector<SimplifiedMesh> out;
+		auto previous = indexCount / 3;
+		float error = 0;
+		for (uint32_t level = 0; level < options.maxLevels; level++) {
+			auto target = (uint32_t)(previous * options.reduction);
+			if (target < options.minTriangles) break;
+
+			auto lod = simplifyMesh(vertices, vertexCount, indices, indexCount, indexBase, target * 3);
+			auto triangles = (uint32_t)lod.indices.size() / 3;
+			if (triangles == 0 || triangles > previous * 0.9) break;
+
+			error = std::max(error, lod.error);
+			lod.error = error;
+			previous = triangles;
+			out.push_back(std::move(lod));
+		}
+		return out;
+	}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "DefaultDS.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace LiteEngine::SceneManagement {
+
+	// 基于二次误差（quadric error metric）的边折叠简化。只删除三角形、不产生新顶点，
+	// 结果中的索引仍然指向原来的顶点，所以各级 LOD 可以共享同一个顶点 buffer，只需要额外的索引
+	// 边界（只属于一个三角形的边）和属性接缝（同一位置有多个不同顶点）上的顶点不会被折叠掉，轮廓和贴图接缝保持不变
+
+	struct SimplifiedMesh {
+		std::vector<uint32_t> indices;		// 与输入一样带 indexBase
+		float error = 0;					// 局部空间中的几何误差（距原表面的距离）
+	};
+
+	// indices 中的值减去 indexBase 才是 vertices 中的下标。三角形数减少到 targetIndexCount / 3 或无法继续折叠为止
+	SimplifiedMesh simplifyMesh(
+		const DefaultVertexData* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		uint32_t indexBase,
+		uint32_t targetIndexCount
+	);
+
+	struct LodChainOptions {
+		uint32_t maxLevels = 5;				// 不含原始精度的一级
+		float reduction = 0.5f;				// 每一级的目标三角形数与上一级之比
+		uint32_t minTriangles = 32;			// 目标少于这个数时不再生成
+	};
+
+	// 依次生成精度降低的各级（都从原始网格简化，误差相对于原始表面，单调不减）
+	// 某一级比上一级减少不到一成时停止。原始精度本身不在结果中
+	std::vector<SimplifiedMesh> buildLodChain(
+		const DefaultVertexData* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		uint32_t indexBase,
+		const LodChainOptions& options = {}
+	);
+
+}
@@ -0,0 +1,173 @@
+#include "ObjectStore.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace LiteEngine::SceneManagement {
+
+	const char* getNodeTypeName(NodeType type) {
+		switch (type) {
+		case NodeType::OBJECT: return "Object";
+		case NodeType::MESH: return "Mesh";
+		case NodeType::LIGHT: return "Light";
+		case NodeType::CAMERA: return "Camera";
+		default: return "Unknown";
+		}
+	}
+
+	void* NodePool::allocate(size_t size) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (elementSize == 0) {
+			// 空闲的元素里要存放链表指针
+			elementSize = std::max(size, sizeof(void*));
+		}
+
+		if (freeList == nullptr) {
+			// operator new[] 返回的地址满足 __STDCPP_DEFAULT_NEW_ALIGNMENT__，
+			// elementSize 是 sizeof，已经是对齐的整数倍
+			chunks.emplace_back(new uint8_t[elementSize * ELEMENTS_PER_CHUNK]);
+			auto chunk = chunks.back().get();
+			for (size_t i = ELEMENTS_PER_CHUNK; i-- > 0;) {
+				auto element = chunk + i * elementSize;
+				*reinterpret_cast<void**>(element) = freeList;
+				freeList = element;
+			}
+			capacityElements += ELEMENTS_PER_CHUNK;
+		}
+
+		auto out = freeList;
+		freeList = *reinterpret_cast<void**>(out);
+		usedElements++;
+		return out;
+	}
+
+	void NodePool::deallocate(void* pointer) {
+		std::lock_guard<std::mutex> guard(lock);
+		*reinterpret_cast<void**>(pointer) = freeList;
+		freeList = pointer;
+		usedElements--;
+	}
+
+	NodePool::Statistics NodePool::getStatistics() {
+		std::lock_guard<std::mutex> guard(lock);
+		Statistics out;
+		out.elementSize = elementSize;
+		out.chunks = chunks.size();
+		out.usedElements = usedElements;
+		out.capacityElements = capacityElements;
+		return out;
+	}
+
+	ObjectStore& ObjectStore::getInstance() {
+		// 不析构：静态对象析构时仍可能释放 Object
+		static ObjectStore* store = new ObjectStore();
+		return *store;
+	}
+
+	ObjectHandle ObjectStore::add(Object* object) {
+		std::lock_guard<std::mutex> guard(lock);
+
+		uint32_t index;
+		if (freeSlot != UINT32_MAX) {
+			index = freeSlot;
+			freeSlot = getSlot(index)->nextFree;
+		} else {
+			if (numberOfSlots > ObjectHandle::MAX_INDEX) {
+				throw std::exception("too many scene objects");
+			}
+			index = numberOfSlots++;
+			auto chunkID = index / SLOTS_PER_CHUNK;
+			if (!chunks[chunkID]) {
+				chunks[chunkID].reset(new Slot[SLOTS_PER_CHUNK]);
+				chunkPointers[chunkID].store(chunks[chunkID].get(), std::memory_order_release);
+			}
+		}
+
+		auto slot = getSlot(index);
+		slot->object.store(object, std::memory_order_release);
+		slot->nextFree = UINT32_MAX;
+		liveObjects++;
+		return ObjectHandle(index, slot->generation.load(std::memory_order_relaxed));
+	}
+
+	void ObjectStore::remove(ObjectHandle handle) {
+		if (handle.isNull()) return;
+		std::lock_guard<std::mutex> guard(lock);
+
+		auto slot = getSlot(handle.getIndex());
+		if (slot == nullptr || slot->generation.load(std::memory_order_relaxed) != handle.getGeneration()) return;
+
+		// 代数跳过 0，保证句柄不会等于空句柄
+		auto generation = handle.getGeneration() + 1;
+		if (generation > ObjectHandle::MAX_GENERATION) generation = 1;
+		slot->generation.store(generation, std::memory_order_release);
+		slot->object.store(nullptr, std::memory_order_release);
+
+		slot->nextFree = freeSlot;
+		freeSlot = handle.getIndex();
+		liveObjects--;
+	}
+
+	void* ObjectStore::allocateNode(NodeType type, size_t nodeSize, size_t size) {
+		if (size != nodeSize) {
+			unpooledNodes.fetch_add(1, std::memory_order_relaxed);
+			return ::operator new(size);
+		}
+		return pools[(uint32_t)type].allocate(size);
+	}
+
+	void ObjectStore::deallocateNode(NodeType type, size_t nodeSize, void* pointer, size_t size) {
+		if (pointer == nullptr) return;
+		if (size != nodeSize) {
+			::operator delete(pointer);
+			return;
+		}
+		pools[(uint32_t)type].deallocate(pointer);
+	}
+
+	ObjectStore::Statistics ObjectStore::getStatistics() {
+		Statistics out;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			out.liveObjects = liveObjects;
+			out.slots = numberOfSlots;
+		}
+		out.staleResolves = staleResolves.load();
+		out.unpooledNodes = unpooledNodes.load();
+		for (uint32_t i = 0; i < (uint32_t)NodeType::COUNT; i++) {
+			out.pools[i] = pools[i].getStatistics();
+		}
+		return out;
+	}
+
+	std::string ObjectStore::getReport() {
+		auto stat = getStatistics();
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "%-8s %8s %8s %10s %10s\n", "pool", "size", "chunks", "used", "capacity");
+		out << line;
+		for (uint32_t i = 0; i < (uint32_t)NodeType::COUNT; i++) {
+			auto& pool = stat.pools[i];
+			snprintf(line, sizeof(line), "%-8s %8zu %8zu %10zu %10zu\n",
+				getNodeTypeName((NodeType)i), pool.elementSize, pool.chunks, pool.usedElements, pool.capacityElements);
+			out << line;
+		}
+		snprintf(line, sizeof(line), "objects %u, handle slots %u, stale lookups %llu, unpooled nodes %llu\n",
+			stat.liveObjects, stat.slots, (unsigned long long)stat.staleResolves, (unsigned long long)stat.unpooledNodes);
+		out << line;
+		return out.str();
+	}
+
+	ObjectLink::ObjectLink(const Object* object) {
+		if (object) handle = object->getHandle();
+	}
+
+	std::shared_ptr<Object> ObjectLink::lock() const {
+		auto object = get();
+		if (object == nullptr) return nullptr;
+		return object->weak_from_this().lock();
+	}
+
+}
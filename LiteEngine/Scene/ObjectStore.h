@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LiteEngine::SceneManagement {
+
+	struct Object;
+
+	// 32 位的代数句柄：低 20 位是槽位，高 12 位是代数
+	// 物体销毁后槽位的代数 +1，旧句柄随之失效，O(1) 即可判断
+	// 值为 0 表示空句柄（代数从 1 开始）
+	class ObjectHandle {
+		uint32_t value = 0;
+
+	public:
+		static constexpr uint32_t INDEX_BITS = 20;
+		static constexpr uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+		static constexpr uint32_t MAX_INDEX = (1u << INDEX_BITS) - 1;
+		static constexpr uint32_t MAX_GENERATION = (1u << GENERATION_BITS) - 1;
+
+		ObjectHandle() = default;
+		ObjectHandle(uint32_t index, uint32_t generation) : value((generation << INDEX_BITS) | index) {}
+
+		static ObjectHandle fromValue(uint32_t value) {
+			ObjectHandle out;
+			out.value = value;
+			return out;
+		}
+
+		uint32_t getValue() const { return value; }
+		uint32_t getIndex() const { return value & MAX_INDEX; }
+		uint32_t getGeneration() const { return value >> INDEX_BITS; }
+		bool isNull() const { return value == 0; }
+
+		bool operator==(const ObjectHandle& other) const { return value == other.value; }
+		bool operator!=(const ObjectHandle& other) const { return value != other.value; }
+		bool operator<(const ObjectHandle& other) const { return value < other.value; }
+	};
+
+	// 场景节点的类型。每种类型有自己的内存池
+	enum class NodeType : uint32_t {
+		OBJECT,
+		MESH,
+		LIGHT,
+		CAMERA,
+		COUNT
+	};
+
+	const char* getNodeTypeName(NodeType type);
+
+	// 固定大小元素的内存池。按块向堆申请，块内的元素连续存放，释放的元素放入空闲链表
+	// 连续创建的节点（比如加载一个模型）在内存中相邻，遍历时缓存命中率高
+	class NodePool {
+		std::mutex lock;
+		size_t elementSize = 0;
+		std::vector<std::unique_ptr<uint8_t[]>> chunks;
+		void* freeList = nullptr;
+		size_t usedElements = 0;
+		size_t capacityElements = 0;
+
+	public:
+		static constexpr size_t ELEMENTS_PER_CHUNK = 256;
+
+		struct Statistics {
+			size_t elementSize = 0;
+			size_t chunks = 0;
+			size_t usedElements = 0;
+			size_t capacityElements = 0;
+		};
+
+		// elementSize 在第一次分配时确定
+		void* allocate(size_t size);
+		void deallocate(void* pointer);
+
+		Statistics getStatistics();
+	};
+
+	// 所有 Object 的句柄表和各类型节点的内存池
+	// 句柄表按块分配，块不会移动，所以 resolve 不需要加锁；登记和注销需要加锁
+	class ObjectStore {
+		struct Slot {
+			std::atomic<Object*> object{ nullptr };
+			std::atomic<uint32_t> generation{ 1 };
+			uint32_t nextFree = UINT32_MAX;
+		};
+
+		static constexpr uint32_t SLOTS_PER_CHUNK = 4096;
+		static constexpr uint32_t MAX_CHUNKS = (ObjectHandle::MAX_INDEX + 1) / SLOTS_PER_CHUNK;
+
+		std::mutex lock;
+		std::unique_ptr<Slot[]> chunks[MAX_CHUNKS];
+		std::atomic<Slot*> chunkPointers[MAX_CHUNKS] = {};
+		uint32_t numberOfSlots = 0;
+		uint32_t freeSlot = UINT32_MAX;
+		uint32_t liveObjects = 0;
+
+		mutable std::atomic<uint64_t> staleResolves{ 0 };
+
+		NodePool pools[(uint32_t)NodeType::COUNT];
+		std::atomic<uint64_t> unpooledNodes{ 0 };
+
+		ObjectStore() = default;
+
+		Slot* getSlot(uint32_t index) const {
+			auto chunk = chunkPointers[index / SLOTS_PER_CHUNK].load(std::memory_order_acquire);
+			return chunk ? &chunk[index % SLOTS_PER_CHUNK] : nullptr;
+		}
+
+	public:
+		struct Statistics {
+			uint32_t liveObjects = 0;
+			uint32_t slots = 0;
+			uint64_t staleResolves = 0;		// 用已失效的句柄查找的次数
+			uint64_t unpooledNodes = 0;		// 大小与池不符（子类）而直接从堆分配的节点，累计
+			NodePool::Statistics pools[(uint32_t)NodeType::COUNT];
+		};
+
+		ObjectStore(const ObjectStore&) = delete;
+		void operator=(const ObjectStore&) = delete;
+
+		static ObjectStore& getInstance();
+
+		// Object 构造 / 析构时调用
+		ObjectHandle add(Object* object);
+		void remove(ObjectHandle handle);
+
+		// 句柄失效时返回 nullptr
+		Object* resolve(ObjectHandle handle) const {
+			if (handle.isNull()) return nullptr;
+			auto slot = getSlot(handle.getIndex());
+			if (slot == nullptr || slot->generation.load(std::memory_order_acquire) != handle.getGeneration()) {
+				staleResolves.fetch_add(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			return slot->object.load(std::memory_order_acquire);
+		}
+
+		// 由各节点类型的 operator new / delete 调用
+		// size 与 nodeSize 不同（子类）时直接使用全局的 operator new
+		void* allocateNode(NodeType type, size_t nodeSize, size_t size);
+		void deallocateNode(NodeType type, size_t nodeSize, void* pointer, size_t size);
+
+		Statistics getStatistics();
+		std::string getReport();
+	};
+
+	// 对另一个 Object 的非拥有引用，代替 std::weak_ptr<Object>
+	// 内部只是一个句柄：get() 查表即可，没有原子的引用计数操作；对象销毁后自动失效
+	class ObjectLink {
+		ObjectHandle handle;
+
+	public:
+		ObjectLink() = default;
+		ObjectLink(std::nullptr_t) {}
+		ObjectLink(const Object* object);
+
+		template <typename T>
+		ObjectLink(const std::shared_ptr<T>& object) : ObjectLink(static_cast<const Object*>(object.get())) {}
+
+		ObjectLink& operator=(std::nullptr_t) {
+			handle = ObjectHandle();
+			return *this;
+		}
+
+		template <typename T>
+		ObjectLink& operator=(const std::shared_ptr<T>& object) {
+			*this = ObjectLink(object);
+			return *this;
+		}
+
+		Object* get() const {
+			return ObjectStore::getInstance().resolve(handle);
+		}
+
+		// 兼容 weak_ptr 的接口。对象不由 shared_ptr 持有时返回空
+		std::shared_ptr<Object> lock() const;
+
+		bool expired() const {
+			return get() == nullptr;
+		}
+
+		void reset() {
+			handle = ObjectHandle();
+		}
+
+		ObjectHandle getHandle() const {
+			return handle;
+		}
+	};
+
+}
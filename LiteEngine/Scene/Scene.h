@@ -3,7 +3,11 @@
 #include "../Renderer/Resources.h"
 #include "../Renderer/Renderer.h"
 #include "../Utilities/Utilities.h"
+#include "../Utilities/DoubleMath.h"
 #include "DefaultDS.h"
+#include "ObjectStore.h"
+#include "Component.h"
+#include "Impostor.h"
 
 #include <string>
 #include <any>
@@ -11,24 +15,78 @@
 
 namespace LiteEngine::SceneManagement {
 
-	// SceneManagement ģ鲻Ҫ Renderer ãԱһ߳ǰ׼
+	// SceneManagement 模块不要有 Renderer 调用，以便在另一个线程提前准备数据
 
 
-	// Object: вνṹпռ任 TRS
-	// Component: ɸ property key-value
+	// Object: 具有层次结构；具有空间变换 TRS
+	// Component: 附加在 Object 上的数据，按物体句柄存放在 Scene::components 中（见 Component.h）
 
+	// 节点仍然由 shared_ptr 持有，但内存来自 ObjectStore 中按类型划分的池（见各类型的 operator new），
+	// 每个节点有一个代数句柄，parent 等非拥有的引用通过句柄查表，不需要 weak_ptr::lock
+	// 用 std::make_shared 创建的节点不在池中（make_shared 不使用类的 operator new），请使用 shared_ptr<T>(new T())
 
-	struct Object {
+	// 平移用双精度保存，层级也用双精度组合（getLocalToWorldTransform），地月尺度的场景中位置仍然精确
+	// 构建 RenderingScene 时减去相机的位置再转成 float（见 RenderingScene::origin_W）
+	struct Object: public std::enable_shared_from_this<Object> {
 		std::vector<std::shared_ptr<Object>> children;
-		std::weak_ptr<Object> parent;
+		ObjectLink parent;
 		std::string name;
 
-		DirectX::XMFLOAT3 transT{0, 0, 0};
+		Double3 transT{0, 0, 0};
 		DirectX::XMVECTOR transR{0, 0, 0, 1};
 		DirectX::XMFLOAT3 transS{1, 1, 1};
 
-		Object() = default;
-		Object(const std::string& name) :name(name) {}
+	private:
+		ObjectHandle handle;
+
+	public:
+		Object() {
+			handle = ObjectStore::getInstance().add(this);
+		}
+
+		Object(const std::string& name) :name(name) {
+			handle = ObjectStore::getInstance().add(this);
+		}
+
+		// 复制出的是另一个物体，句柄不复制
+		Object(const Object& other) :
+			std::enable_shared_from_this<Object>(other),
+			children(other.children),
+			parent(other.parent),
+			name(other.name),
+			transT(other.transT),
+			transR(other.transR),
+			transS(other.transS)
+		{
+			handle = ObjectStore::getInstance().add(this);
+		}
+
+		Object& operator=(const Object& other) {
+			children = other.children;
+			parent = other.parent;
+			name = other.name;
+			transT = other.transT;
+			transR = other.transR;
+			transS = other.transS;
+			return *this;
+		}
+
+		static void* operator new(size_t size) {
+			return ObjectStore::getInstance().allocateNode(NodeType::OBJECT, sizeof(Object), size);
+		}
+
+		static void operator delete(void* pointer, size_t size) {
+			ObjectStore::getInstance().deallocateNode(NodeType::OBJECT, sizeof(Object), pointer, size);
+		}
+
+		ObjectHandle getHandle() const {
+			return handle;
+		}
+
+		// 父物体已经销毁或者没有父物体时返回 nullptr
+		Object* getParent() const {
+			return parent.get();
+		}
 
 		void link(std::shared_ptr<Object> self, std::shared_ptr<Object> parent = nullptr) {
 			this->parent = parent;
@@ -40,12 +98,16 @@ namespace LiteEngine::SceneManagement {
 				{ transS.x, transS.y, transS.z, 1 },
 				{ 0, 0, 0, 1 },
 				transR,
-				{ transT.x, transT.y, transT.z, 1 }
+				{ (float)transT.x, (float)transT.y, (float)transT.z, 1 }
 			);
 		}
 
+		DoubleTransform getLocalTransform() const {
+			return DoubleTransform::fromTRS(transT, transR, transS);
+		}
+
 		std::shared_ptr<Object> insertParent() {
-			if (this->parent.lock() == nullptr) {
+			if (this->parent.get() == nullptr) {
 				return nullptr;
 			}
 
@@ -54,7 +116,7 @@ namespace LiteEngine::SceneManagement {
 			newParent->name = this->name + "__#PARENT_" + std::to_string(parent_id++);
 			newParent->parent = this->parent;
 
-			auto oldParent = this->parent.lock();
+			auto oldParent = this->parent.get();
 			for (auto& child : oldParent->children) {
 				if (&*child == this) {
 					newParent->children.push_back(child);
@@ -83,7 +145,17 @@ namespace LiteEngine::SceneManagement {
 			return nullptr;
 		}
 		
-		// ûκ cacheòҪֱӵ~
+		// path: 逐层在 children 中的下标，动画目标和骨骼用这种方式引用模型内的节点。不存在时返回 nullptr
+		const Object* getDescendant(const std::vector<uint32_t>& path) const {
+			const Object* node = this;
+			for (auto childID : path) {
+				if (childID >= node->children.size()) return nullptr;
+				node = node->children[childID].get();
+			}
+			return node;
+		}
+
+		// 没有任何 cache，最好不要直接调用~
 		std::shared_ptr<Object> searchDescendant(const std::string& name) const {
 			for (auto sub : children) {
 				if (sub->name == name) return sub;
@@ -92,7 +164,31 @@ namespace LiteEngine::SceneManagement {
 			return nullptr;
 		}
 
-		virtual ~Object() = default;
+		virtual ~Object() {
+			ObjectStore::getInstance().remove(handle);
+		}
+
+		// 复制本物体及所有子物体，得到一棵独立的树（parent 为空）
+		// Mesh 复制出的物体与原物体共享 Rendering::Mesh 和材质，不会创建新的 GPU 资源
+		std::shared_ptr<Object> clone() const {
+			auto out = this->cloneNode();
+			out->parent.reset();
+			out->children.clear();
+			for (auto& child : children) {
+				auto copied = child->clone();
+				copied->parent = out;
+				out->children.push_back(copied);
+			}
+			return out;
+		}
+
+	protected:
+		// 只复制本节点。子类需要重写，以保证复制出的物体类型不变
+		virtual std::shared_ptr<Object> cloneNode() const {
+			return std::shared_ptr<Object>(new Object(*this));
+		}
+
+	public:
 
 		Object& addScale(const DirectX::XMFLOAT3& deltaLocalScale) {
 			transS.x += deltaLocalScale.x;
@@ -124,8 +220,8 @@ namespace LiteEngine::SceneManagement {
 		}
 
 		Object& moveLocalCoord(const DirectX::XMFLOAT3& deltaLocalPos) {
-			// transT ڸϵеƶ
-			// move Ҫڱϵƶ
+			// transT 是在父物体坐标系中的移动
+			// move 函数要在本地坐标系做移动
 			
 			DirectX::XMFLOAT3 deltaParentPos3 = getDirectionFloat3InParent(deltaLocalPos);
 			transT.x += deltaParentPos3.x;
@@ -167,59 +263,60 @@ namespace LiteEngine::SceneManagement {
 			return *this;
 		}
 
-		DirectX::XMMATRIX getLocalToWorldMatrix() const {
-			auto out = this->getTransformMatrix();
-			if (auto ptr = this->parent.lock(); ptr) {
-				auto prev = ptr->getLocalToWorldMatrix();
-				auto rst = DirectX::XMMatrixMultiply(out, prev);
-				return rst;
+		DoubleTransform getLocalToWorldTransform() const {
+			auto out = this->getLocalTransform();
+			if (auto ptr = this->parent.get(); ptr) {
+				return out * ptr->getLocalToWorldTransform();
 			} else {
 				return out;
 			}
-		}		
-		
-		DirectX::XMMATRIX getLocalToAncestorMatrix(std::shared_ptr<Object> ancestor) const {
-			if (ancestor == nullptr) return getLocalToWorldMatrix();
+		}
+
+		DoubleTransform getLocalToAncestorTransform(std::shared_ptr<Object> ancestor) const {
+			if (ancestor == nullptr) return getLocalToWorldTransform();
 			if (this == &*ancestor) {
-				return DirectX::XMMatrixIdentity();
+				return DoubleTransform::identity();
 			}
-			auto out = this->getTransformMatrix();
-			if (auto ptr = this->parent.lock(); ptr) {
-				auto prev = ptr->getLocalToAncestorMatrix(ancestor);
-				auto rst = DirectX::XMMatrixMultiply(out, prev);
-				return rst;
+			auto out = this->getLocalTransform();
+			if (auto ptr = this->parent.get(); ptr) {
+				return out * ptr->getLocalToAncestorTransform(ancestor);
 			} else {
 				return out;
 			}
 		}
 
+		// 在双精度下组合之后再转成 float。离原点很远时请使用 getLocalToWorldTransform
+		DirectX::XMMATRIX getLocalToWorldMatrix() const {
+			return getLocalToWorldTransform().toMatrix();
+		}		
+		
+		DirectX::XMMATRIX getLocalToAncestorMatrix(std::shared_ptr<Object> ancestor) const {
+			return getLocalToAncestorTransform(ancestor).toMatrix();
+		}
+
 		DirectX::XMFLOAT3 getWorldPosition() const {
-			auto mat = this->getLocalToWorldMatrix();
-			DirectX::XMFLOAT3 pos;
-			DirectX::XMStoreFloat3(&pos, mat.r[3]); // TRS  M33 == 1
-			return pos;
+			return getLocalToWorldTransform().translation.toFloat3();
 		}		
 		
 		DirectX::XMFLOAT3 getPositionInAncestor(std::shared_ptr<Object> ancestor) const {
-			auto mat = this->getLocalToAncestorMatrix(ancestor);
-			DirectX::XMFLOAT3 pos;
-			DirectX::XMStoreFloat3(&pos, mat.r[3]); // TRS  M33 == 1
-			return pos;
+			return getLocalToAncestorTransform(ancestor).translation.toFloat3();
 		}
 
 		void setTransformMatrix(const DirectX::XMMATRIX mat) {
 			DirectX::XMVECTOR scale, translate;
 			DirectX::XMMatrixDecompose(&scale, &this->transR, &translate, mat);
 			DirectX::XMStoreFloat3(&this->transS, scale);
-			DirectX::XMStoreFloat3(&this->transT, translate);
+			DirectX::XMFLOAT3 translate3;
+			DirectX::XMStoreFloat3(&translate3, translate);
+			this->transT = translate3;
 		}
 
-		void setLocalPos(const DirectX::XMFLOAT3& val) {
+		void setLocalPos(const Double3& val) {
 			this->transT = val;
 		}
 
 		void dump(int level = 0, Object* parent = nullptr) {
-			bool parentValid = &*this->parent.lock() == parent;
+			bool parentValid = this->parent.get() == parent;
 			DirectX::XMVECTOR axis;
 			float angle;
 			DirectX::XMFLOAT3 axis3;
@@ -254,9 +351,26 @@ namespace LiteEngine::SceneManagement {
 	};
 
 	struct Mesh : public Object {
-		// һϡͬ vbo ṹһĬϲ
+		// 必须设置一个材料。不同的 vbo 结构不一样，做不了默认材料
 		std::shared_ptr<Material> material;
 		std::shared_ptr<Rendering::MeshObject> data;
+		// 不为空时这个 mesh 按 instances 中的每个变换各绘制一次（EXT_mesh_gpu_instancing），只需一次 draw call
+		std::shared_ptr<const Rendering::InstanceTransforms> instances;
+
+		static void* operator new(size_t size) {
+			return ObjectStore::getInstance().allocateNode(NodeType::MESH, sizeof(Mesh), size);
+		}
+
+		static void operator delete(void* pointer, size_t size) {
+			ObjectStore::getInstance().deallocateNode(NodeType::MESH, sizeof(Mesh), pointer, size);
+		}
+
+	protected:
+		virtual std::shared_ptr<Object> cloneNode() const override {
+			std::shared_ptr<Mesh> out(new Mesh(*this));
+			if (data) out->data = data->clone();
+			return out;
+		}
 	};
 
 	struct Camera : public Object {
@@ -295,10 +409,26 @@ namespace LiteEngine::SceneManagement {
 
 		DirectX::XMFLOAT3 worldUp;
 		DirectX::XMFLOAT3 worldLookAtCoord;
-		std::weak_ptr<Object> worldLookAtObject;
+		ObjectLink worldLookAtObject;
 		DirectX::XMFLOAT3 worldLookTo;
 
-		DirectX::XMMATRIX getW2VMatrix(DirectX::XMMATRIX transformMatrix) {
+		static void* operator new(size_t size) {
+			return ObjectStore::getInstance().allocateNode(NodeType::CAMERA, sizeof(Camera), size);
+		}
+
+		static void operator delete(void* pointer, size_t size) {
+			ObjectStore::getInstance().deallocateNode(NodeType::CAMERA, sizeof(Camera), pointer, size);
+		}
+
+	protected:
+		virtual std::shared_ptr<Object> cloneNode() const override {
+			return std::shared_ptr<Object>(new Camera(*this));
+		}
+
+	public:
+		// transformMatrix 是相对于 origin 的 local_to_world，返回的 W2V 也相对于 origin（见 RenderingScene::origin_W）
+		// worldLookAtCoord 和 worldLookAtObject 的位置是真正的世界坐标，这里减去 origin
+		DirectX::XMMATRIX getW2VMatrix(DirectX::XMMATRIX transformMatrix, const Double3& origin = {}) {
 			auto cameraTrans = setAbsScaleComponentToOne(transformMatrix);
 
 			auto lookEye = DirectX::XMVector3TransformCoord({ 0, 0, 0 }, transformMatrix);
@@ -316,14 +446,18 @@ namespace LiteEngine::SceneManagement {
 				lookTo = DirectX::XMLoadFloat3(&worldLookTo);
 				break;
 			case FixedWorldDirection::LookAtObject:
-				lookAtMode = true;
-				auto atObjCoord = this->worldLookAtObject.lock()->getWorldPosition();
-				lookAt = DirectX::XMLoadFloat3(&atObjCoord);
+				if (auto target = this->worldLookAtObject.get(); target) {
+					lookAtMode = true;
+					auto atObjCoord = (target->getLocalToWorldTransform().translation - origin).toFloat3();
+					lookAt = DirectX::XMLoadFloat3(&atObjCoord);
+				}
 				break;
-			case FixedWorldDirection::LookAtCoord:
+			case FixedWorldDirection::LookAtCoord: {
 				lookAtMode = true;
-				lookAt = DirectX::XMLoadFloat3(&worldLookAtCoord);
+				auto atCoord = (Double3(worldLookAtCoord) - origin).toFloat3();
+				lookAt = DirectX::XMLoadFloat3(&atCoord);
 				break;
+			}
 			case FixedWorldDirection::None:
 				break;
 			}
@@ -349,6 +483,78 @@ namespace LiteEngine::SceneManagement {
 		float maximumDistance = std::numeric_limits<float>::infinity();				// spot & point
 		DirectX::XMFLOAT3 direction_L;		// spot & directional
 		DirectX::XMFLOAT3 intensity;		// all
+
+		static void* operator new(size_t size) {
+			return ObjectStore::getInstance().allocateNode(NodeType::LIGHT, sizeof(Light), size);
+		}
+
+		static void operator delete(void* pointer, size_t size) {
+			ObjectStore::getInstance().deallocateNode(NodeType::LIGHT, sizeof(Light), pointer, size);
+		}
+
+	protected:
+		virtual std::shared_ptr<Object> cloneNode() const override {
+			return std::shared_ptr<Object>(new Light(*this));
+		}
+	};
+
+	// 挂在节点上：子树中的 mesh 属于这些层（见 Rendering::RenderLayers），只在 includeLayers 与之有交集的 pass 中绘制
+	// 如飞船内部不投射阴影、很小的物体只在最近一级阴影中投射阴影。子树中再挂一个会覆盖外层的设置
+	// 没有挂的子树属于 RenderLayers::DEFAULT
+	struct RenderLayerMask {
+		uint32_t layers = Rendering::RenderLayers::DEFAULT;
+	};
+
+	// flattenHierarchy 保留下来的一串只传递变换的节点（如被应用程序持有，不能删除），挂在链的第一个节点上
+	// 构建 RenderingScene 时用缓存的局部变换之积直接跳到链的最后一个节点。链上节点的 TRS 变化时重新计算乘积，
+	// 链的结构变化（某个节点的子节点不再是链上的下一个）或链上的节点有了 impostor、层时退回逐个节点遍历
+	struct TransformChainCache {
+		struct Link {
+			const Object* node;
+			Double3 transT;
+			DirectX::XMFLOAT4 transR;
+			DirectX::XMFLOAT3 transS;
+		};
+		std::vector<Link> links;		// 从上到下，第一个是挂组件的节点
+		DoubleTransform product;		// 最后一个节点 -> 第一个节点的父节点
+		bool computed = false;
+
+		// 可以使用缓存时返回链的最后一个节点，必要时更新 product；否则返回 nullptr
+		const Object* resolve(const Object& first, const ComponentPool<Impostor>& impostors, const ComponentPool<RenderLayerMask>& layerMasks) {
+			if (links.empty() || links[0].node != &first) return nullptr;
+			bool changed = !computed;
+			for (size_t i = 0; i < links.size(); i++) {
+				auto& link = links[i];
+				// 先确认 link.node 仍然是上一个节点唯一的子节点，之后才访问它
+				if (i > 0) {
+					auto& parent = *links[i - 1].node;
+					if (parent.children.size() != 1 || parent.children[0].get() != link.node) return nullptr;
+					if (layerMasks.size() != 0 && layerMasks.get(link.node->getHandle())) return nullptr;
+				}
+				if (impostors.size() != 0 && impostors.get(link.node->getHandle())) return nullptr;
+
+				DirectX::XMFLOAT4 r;
+				DirectX::XMStoreFloat4(&r, link.node->transR);
+				auto& t = link.node->transT;
+				auto& s = link.node->transS;
+				if (t.x != link.transT.x || t.y != link.transT.y || t.z != link.transT.z ||
+					r.x != link.transR.x || r.y != link.transR.y || r.z != link.transR.z || r.w != link.transR.w ||
+					s.x != link.transS.x || s.y != link.transS.y || s.z != link.transS.z) {
+					link.transT = t;
+					link.transR = r;
+					link.transS = s;
+					changed = true;
+				}
+			}
+			if (changed) {
+				product = DoubleTransform::identity();
+				for (auto& link : links) {
+					product = DoubleTransform::fromTRS(link.transT, DirectX::XMLoadFloat4(&link.transR), link.transS) * product;
+				}
+				computed = true;
+			}
+			return links.back().node;
+		}
 	};
 
 	struct Scene {
@@ -357,27 +563,78 @@ namespace LiteEngine::SceneManagement {
 		std::shared_ptr<Object> rootObject;
 		std::shared_ptr<Camera> activeCamera;
 
+		// 场景中物体的组件。系统通过 components.view<...>() 只遍历具有相关组件的物体
+		ComponentStore components;
+
 		void link() {
 			if(rootObject) rootObject->link(rootObject);
 		}
 
 
+		// transform: node 的父节点 -> 世界。结果中的矩阵都相对于 dest->origin_W
 		void buildRenderingSceneRecursively(
 			std::shared_ptr<Rendering::RenderingScene> dest,
 			std::shared_ptr<Object> node,
 			DirectX::XMMATRIX transform
+		) {
+			if (dest == nullptr) return;
+			buildRenderingSceneRecursively(*dest, node.get(), DoubleTransform::fromMatrix(transform),
+				components.getPool<Impostor>(), components.getPool<RenderLayerMask>(), components.getPool<TransformChainCache>(),
+				Rendering::RenderLayers::DEFAULT);
+		}
+
+	protected:
+		// getRenderingScene 上一次的结果，下一次可能原地重用
+		std::shared_ptr<Rendering::RenderingScene> renderingScene;
+
+		// 遍历时只使用裸指针，不复制 shared_ptr，避免每个节点都有原子的引用计数操作
+		void buildRenderingSceneRecursively(
+			Rendering::RenderingScene& dest,
+			const Object* node,
+			const DoubleTransform& transform,
+			const ComponentPool<Impostor>& impostors,
+			const ComponentPool<RenderLayerMask>& layerMasks,
+			ComponentPool<TransformChainCache>& chains,
+			uint32_t layers
 		) {
 			if (node == nullptr) return;
 
-			// DirectX: 
-			auto newTransform = DirectX::XMMatrixMultiply(node->getTransformMatrix(), transform);
+			if (layerMasks.size() != 0) {
+				if (auto mask = layerMasks.get(node->getHandle()); mask) layers = mask->layers;
+			}
 
-			if (auto mesh = std::dynamic_pointer_cast<Mesh>(node); mesh) {
+			// 只传递变换的链不产生任何绘制对象，直接用缓存的乘积处理链的最后一个节点的子节点
+			if (chains.size() != 0) {
+				if (auto chain = chains.get(node->getHandle()); chain) {
+					if (auto last = chain->resolve(*node, impostors, layerMasks); last) {
+						auto lastTransform = chain->product * transform;
+						for (auto& child : last->children) {
+							buildRenderingSceneRecursively(dest, child.get(), lastTransform, impostors, layerMasks, chains, layers);
+						}
+						return;
+					}
+				}
+			}
+
+			// DirectX: 行主序。层级在双精度下组合，交给 Renderer 的矩阵减去浮动原点后再转成 float
+			auto worldTransform = node->getLocalTransform() * transform;
+			auto newTransform = worldTransform.toMatrix(dest.origin_W);
+
+			// 子树中的 mesh 在 meshObjects 中是连续的一段，impostor 可以代替这一段
+			auto impostor = impostors.size() == 0 ? nullptr : impostors.get(node->getHandle());
+			auto firstMeshObject = (uint32_t)dest.meshObjects.size();
+
+			if (auto mesh = dynamic_cast<const Mesh*>(node); mesh) {
 				auto& meshObj = mesh->data;
 				meshObj->material = mesh->material;
 				meshObj->transform = newTransform;
-				dest->meshObjects.push_back(meshObj);
-			} else if (auto light = std::dynamic_pointer_cast<Light>(node); light) {
+				meshObj->layers = layers;
+				if (mesh->instances) {
+					dest.instancedObjects.push_back({ meshObj, mesh->instances });
+				} else {
+					dest.meshObjects.push_back(meshObj);
+				}
+			} else if (auto light = dynamic_cast<const Light*>(node); light) {
 				Rendering::LightDesc lightDesc;
 				
 				lightDesc.type = light->type;
@@ -393,39 +650,62 @@ namespace LiteEngine::SceneManagement {
 				DirectX::XMStoreFloat3(&lightDesc.direction_W, dir_W);
 
 				// position
-				// Ϊԭԭ㣬в scale  rotate
+				// 因为原来在原点，所有不在意 scale 和 rotate
 				DirectX::XMFLOAT4 trans;
 				DirectX::XMStoreFloat4(&trans, newTransform.r[3]);
 				lightDesc.position_W = { trans.x, trans.y, trans.z };
 
-				dest->lights.push_back(lightDesc);
-			} else if (auto camera = std::dynamic_pointer_cast<Camera>(node); camera && camera == activeCamera) {
-				dest->camera = camera->data;
-				dest->camera.trans_W2V = camera->getW2VMatrix(newTransform);
+				dest.lights.push_back(lightDesc);
+			} else if (node == activeCamera.get()) {
+				dest.camera = activeCamera->data;
+				dest.camera.trans_W2V = activeCamera->getW2VMatrix(newTransform, dest.origin_W);
+			}
+
+			for (auto& child : node->children) {
+				buildRenderingSceneRecursively(dest, child.get(), worldTransform, impostors, layerMasks, chains, layers);
 			}
 
-			for (auto child : node->children) {
-				buildRenderingSceneRecursively(dest, child, newTransform);
+			if (impostor && impostor->quad) {
+				impostor->quad->transform = DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&impostor->trans_I2L), newTransform);
+				// impostor 不投射阴影（见 Renderer::createImpostorMeshObject）
+				impostor->quad->layers = layers & ~(Rendering::RenderLayers::SHADOW_CASTER | Rendering::RenderLayers::SHADOW_CASTER_DISTANT);
+				dest.impostors.push_back({ impostor->quad, firstMeshObject, (uint32_t)dest.meshObjects.size() - firstMeshObject });
 			}
 		}
 
+	public:
+
 		Rendering::RenderingScene::CameraInfo getCameraInfo(std::shared_ptr<Camera> camera) {
 			auto out = camera->data;
 			out.trans_W2V = camera->getW2VMatrix(camera->getLocalToWorldMatrix());
 			return out;
 		}
 
+		// 上一次返回的 RenderingScene 已经没有其他人持有时原地重建：clear 保留 vector 的容量，稳定之后每帧不分配内存
+		// 仍被持有时（如某个 pass 跨帧保存了它）新建一个，已经返回的结果不会被修改
 		std::shared_ptr<Rendering::RenderingScene> getRenderingScene() {
 			if (this->activeCamera == nullptr) {
 				throw std::exception("no active camera");
 			}
-			std::shared_ptr<Rendering::RenderingScene> out(new Rendering::RenderingScene());
+			if (this->renderingScene == nullptr || this->renderingScene.use_count() != 1) {
+				this->renderingScene.reset(new Rendering::RenderingScene());
+			} else {
+				auto& out = *this->renderingScene;
+				out.camera = {};
+				out.lights.clear();
+				out.meshObjects.clear();
+				out.instancedObjects.clear();
+				out.impostors.clear();
+			}
+			auto out = this->renderingScene;
+			// 浮动原点取在相机处：相机附近的物体得到很小的平移，不会因为 float 的精度而抖动
+			out->origin_W = activeCamera->getLocalToWorldTransform().translation;
 			buildRenderingSceneRecursively(out, rootObject, DirectX::XMMatrixIdentity());
 			return out;
 		}
 
 		const std::shared_ptr<const Object> searchObject(const std::string& name) const {
-			// Ժ cacheԤ
+			// 以后可以做点 cache，或者做点预处理
 			if (rootObject->name == name) {
 				return rootObject;
 			}
@@ -438,7 +718,7 @@ namespace LiteEngine::SceneManagement {
 		}
 
 		std::shared_ptr<Object> searchObject(const std::string& name) {
-			// Ժ cacheԤ
+			// 以后可以做点 cache，或者做点预处理
 			if (rootObject->name == name) {
 				return rootObject;
 			}
@@ -452,4 +732,7 @@ namespace LiteEngine::SceneManagement {
 
 	};
 
+	// 比较 float 层级与双精度层级 + 相机相对坐标在不同距离下的误差（地月距离、日地距离等）
+	std::string runTransformPrecisionBenchmark();
+
 }
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "Skinning.h"
+#include "Scene.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		// 每块的顶点数。太小时调度开销明显，太大时线程之间负载不均
+		constexpr uint32_t VERTICES_PER_CHUNK = 2048;
+
+		void addMorphTargets(SkinnedMesh& mesh, uint32_t begin, uint32_t end) {
+			auto& data = *mesh.data;
+			for (size_t targetID = 0; targetID < data.morphTargets.size(); targetID++) {
+				float weight = targetID < mesh.morphWeights.size() ? mesh.morphWeights[targetID] : 0;
+				if (weight == 0) continue;
+
+				auto& target = data.morphTargets[targetID];
+				auto w = DirectX::XMVectorReplicate(weight);
+				// target.vertices 递增，只处理落在 [begin, end) 中的部分
+				auto first = std::lower_bound(target.vertices.begin(), target.vertices.end(), begin) - target.vertices.begin();
+				for (auto i = first; i < (ptrdiff_t)target.vertices.size() && target.vertices[i] < end; i++) {
+					auto& vertex = mesh.deformed[target.vertices[i]];
+					DirectX::XMStoreFloat3(&vertex.position, DirectX::XMVectorMultiplyAdd(
+						DirectX::XMLoadFloat3(&target.positions[i]), w, DirectX::XMLoadFloat3(&vertex.position)));
+					if (!target.normals.empty()) {
+						DirectX::XMStoreFloat3(&vertex.normal, DirectX::XMVectorMultiplyAdd(
+							DirectX::XMLoadFloat3(&target.normals[i]), w, DirectX::XMLoadFloat3(&vertex.normal)));
+					}
+					if (!target.tangents.empty()) {
+						DirectX::XMStoreFloat3(&vertex.tangent, DirectX::XMVectorMultiplyAdd(
+							DirectX::XMLoadFloat3(&target.tangents[i]), w, DirectX::XMLoadFloat3(&vertex.tangent)));
+					}
+				}
+			}
+		}
+
+		// 按权重混合 4 个骨骼矩阵，再变换顶点
+		void skinLinear(SkinnedMesh& mesh, uint32_t begin, uint32_t end) {
+			auto& weights = mesh.data->weights;
+			auto palette = mesh.palette.data();
+			for (uint32_t i = begin; i < end; i++) {
+				auto& influence = weights[i];
+				auto& vertex = mesh.deformed[i];
+
+				auto w = DirectX::XMVectorReplicate(influence.weights[0]);
+				auto& m0 = palette[influence.joints[0]];
+				auto r0 = DirectX::XMVectorMultiply(m0.r[0], w);
+				auto r1 = DirectX::XMVectorMultiply(m0.r[1], w);
+				auto r2 = DirectX::XMVectorMultiply(m0.r[2], w);
+				auto r3 = DirectX::XMVectorMultiply(m0.r[3], w);
+				for (int k = 1; k < 4; k++) {
+					w = DirectX::XMVectorReplicate(influence.weights[k]);
+					auto& m = palette[influence.joints[k]];
+					r0 = DirectX::XMVectorMultiplyAdd(m.r[0], w, r0);
+					r1 = DirectX::XMVectorMultiplyAdd(m.r[1], w, r1);
+					r2 = DirectX::XMVectorMultiplyAdd(m.r[2], w, r2);
+					r3 = DirectX::XMVectorMultiplyAdd(m.r[3], w, r3);
+				}
+				DirectX::XMMATRIX blended(r0, r1, r2, r3);
+
+				// 法线没有用逆转置：骨骼矩阵通常没有非均匀缩放
+				auto position = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&vertex.position), blended);
+				auto normal = DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&vertex.normal), blended);
+				auto tangent = DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&vertex.tangent), blended);
+				DirectX::XMStoreFloat3(&vertex.position, position);
+				DirectX::XMStoreFloat3(&vertex.normal, DirectX::XMVector3Normalize(normal));
+				DirectX::XMStoreFloat3(&vertex.tangent, DirectX::XMVector3Normalize(tangent));
+			}
+		}
+
+		// 混合对偶四元数：实部与第一个骨骼不在同一半球的取反，归一化后 p' = r p r* + t
+		void skinDualQuaternion(SkinnedMesh& mesh, uint32_t begin, uint32_t end) {
+			auto& weights = mesh.data->weights;
+			auto dq = mesh.dualQuaternions.data();
+			for (uint32_t i = begin; i < end; i++) {
+				auto& influence = weights[i];
+				auto& vertex = mesh.deformed[i];
+
+				auto pivot = dq[influence.joints[0] * 2];
+				auto w = DirectX::XMVectorReplicate(influence.weights[0]);
+				auto real = DirectX::XMVectorMultiply(pivot, w);
+				auto dual = DirectX::XMVectorMultiply(dq[influence.joints[0] * 2 + 1], w);
+				for (int k = 1; k < 4; k++) {
+					auto q = dq[influence.joints[k] * 2];
+					auto weight = influence.weights[k];
+					if (DirectX::XMVectorGetX(DirectX::XMVector4Dot(pivot, q)) < 0) weight = -weight;
+					w = DirectX::XMVectorReplicate(weight);
+					real = DirectX::XMVectorMultiplyAdd(q, w, real);
+					dual = DirectX::XMVectorMultiplyAdd(dq[influence.joints[k] * 2 + 1], w, dual);
+				}
+				auto inverseLength = DirectX::XMVectorReciprocalSqrt(DirectX::XMVector4Dot(real, real));
+				real = DirectX::XMVectorMultiply(real, inverseLength);
+				dual = DirectX::XMVectorMultiply(dual, inverseLength);
+
+				// t = 2 (r.w * d.xyz - d.w * r.xyz + r.xyz × d.xyz)
+				auto translation = DirectX::XMVectorSubtract(
+					DirectX::XMVectorMultiply(DirectX::XMVectorSplatW(real), dual),
+					DirectX::XMVectorMultiply(DirectX::XMVectorSplatW(dual), real));
+				translation = DirectX::XMVectorAdd(translation, DirectX::XMVector3Cross(real, dual));
+				translation = DirectX::XMVectorAdd(translation, translation);
+
+				auto position = DirectX::XMVector3Rotate(DirectX::XMLoadFloat3(&vertex.position), real);
+				DirectX::XMStoreFloat3(&vertex.position, DirectX::XMVectorAdd(position, translation));
+				DirectX::XMStoreFloat3(&vertex.normal, DirectX::XMVector3Rotate(DirectX::XMLoadFloat3(&vertex.normal), real));
+				DirectX::XMStoreFloat3(&vertex.tangent, DirectX::XMVector3Rotate(DirectX::XMLoadFloat3(&vertex.tangent), real));
+			}
+		}
+
+	}
+
+	size_t DeformableMeshData::getMemoryBytes() const {
+		size_t bytes = vertices.size() * sizeof(DefaultVertexData) + weights.size() * sizeof(SkinWeights);
+		for (auto& target : morphTargets) {
+			bytes += target.vertices.size() * sizeof(uint32_t);
+			bytes += (target.positions.size() + target.normals.size() + target.tangents.size()) * sizeof(DirectX::XMFLOAT3);
+		}
+		return bytes + defaultMorphWeights.size() * sizeof(float);
+	}
+
+	size_t Skin::getMemoryBytes() const {
+		size_t bytes = inverseBindMatrices.size() * sizeof(DirectX::XMFLOAT4X4);
+		for (auto& joint : joints) bytes += joint.size() * sizeof(uint32_t);
+		return bytes;
+	}
+
+	SkinnedMesh createSkinnedMesh(
+		const std::shared_ptr<const DeformableMeshData>& data,
+		const std::shared_ptr<const Skin>& skin,
+		const Object& root
+	) {
+		SkinnedMesh mesh;
+		mesh.data = data;
+		mesh.skin = skin;
+		mesh.morphWeights = data->defaultMorphWeights;
+		mesh.morphWeights.resize(data->morphTargets.size(), 0);
+		mesh.deformed = data->vertices;
+
+		if (skin) {
+			mesh.joints.resize(skin->joints.size());
+			mesh.palette.assign(skin->joints.size(), DirectX::XMMatrixIdentity());
+			for (size_t i = 0; i < skin->joints.size(); i++) {
+				if (auto node = root.getDescendant(skin->joints[i]); node) {
+					mesh.joints[i] = node->getHandle();
+				} else {
+					auto name = i < skin->jointNames.size() ? skin->jointNames[i] : std::to_string(i);
+					log(LogLevel::WARNING, "skin " + skin->name + ": joint " + name + " is not found\n");
+				}
+			}
+		}
+		return mesh;
+	}
+
+	void computeJointPalette(SkinnedMesh& mesh, const Object& node, SkinningStatistics* statistics) {
+		mesh.useDualQuaternions = false;
+		if (!mesh.skin) return;
+
+		auto& skin = *mesh.skin;
+		auto& store = ObjectStore::getInstance();
+		// 在双精度下求骨骼到本节点的变换，离世界原点很远时也不会损失精度
+		auto worldToNode = node.getLocalToWorldTransform().inverse();
+
+		mesh.palette.resize(skin.joints.size());
+		for (size_t i = 0; i < skin.joints.size(); i++) {
+			auto joint = store.resolve(mesh.joints[i]);
+			if (joint == nullptr) {
+				mesh.palette[i] = DirectX::XMMatrixIdentity();
+				continue;
+			}
+			// 行向量：静止姿态的顶点 -> 骨骼局部空间 -> 世界 -> 本节点局部空间
+			auto jointToNode = (joint->getLocalToWorldTransform() * worldToNode).toMatrix();
+			auto inverseBind = DirectX::XMLoadFloat4x4(&skin.inverseBindMatrices[i]);
+			mesh.palette[i] = DirectX::XMMatrixMultiply(inverseBind, jointToNode);
+		}
+
+		if (mesh.method != SkinningMethod::DUAL_QUATERNION || mesh.data->weights.empty()) return;
+
+		constexpr float SCALE_TOLERANCE = 1e-3f;
+		mesh.dualQuaternions.resize(skin.joints.size() * 2);
+		for (size_t i = 0; i < mesh.palette.size(); i++) {
+			DirectX::XMVECTOR scale, rotation, translation;
+			if (!DirectX::XMMatrixDecompose(&scale, &rotation, &translation, mesh.palette[i]) ||
+				!DirectX::XMVector3NearEqual(scale, DirectX::XMVectorSplatOne(), DirectX::XMVectorReplicate(SCALE_TOLERANCE))) {
+				if (statistics) statistics->linearFallbacks++;
+				return;
+			}
+			// 对偶部 d = t r / 2（t 看作实部为 0 的四元数）: d.xyz = (r.w t + t × r.xyz) / 2, d.w = -(t · r.xyz) / 2
+			auto half = DirectX::XMVectorReplicate(0.5f);
+			auto dualXYZ = DirectX::XMVectorAdd(
+				DirectX::XMVectorMultiply(DirectX::XMVectorSplatW(rotation), translation),
+				DirectX::XMVector3Cross(translation, rotation));
+			auto dualW = DirectX::XMVectorNegate(DirectX::XMVector3Dot(translation, rotation));
+			mesh.dualQuaternions[i * 2] = rotation;
+			mesh.dualQuaternions[i * 2 + 1] = DirectX::XMVectorMultiply(
+				DirectX::XMVectorSelect(dualW, dualXYZ, DirectX::g_XMSelect1110), half);
+		}
+		mesh.useDualQuaternions = true;
+	}
+
+	void deformVertices(SkinnedMesh& mesh, uint32_t begin, uint32_t end) {
+		auto& data = *mesh.data;
+		end = std::min(end, (uint32_t)data.vertices.size());
+		if (begin >= end) return;
+
+		mesh.deformed.resize(data.vertices.size());
+		std::copy(data.vertices.begin() + begin, data.vertices.begin() + end, mesh.deformed.begin() + begin);
+		addMorphTargets(mesh, begin, end);
+
+		if (data.weights.empty() || !mesh.skin) return;
+		if (mesh.useDualQuaternions) skinDualQuaternion(mesh, begin, end);
+		else skinLinear(mesh, begin, end);
+	}
+
+	SkinningStatistics updateSkinnedMeshes(ComponentStore& components, JobSystem& jobs) {
+		SkinningStatistics statistics;
+		auto& store = ObjectStore::getInstance();
+
+		// 不同 mesh 的顶点数差别很大，统一切成差不多大小的块再分给各个线程
+		struct Chunk {
+			SkinnedMesh* mesh;
+			uint32_t begin;
+			uint32_t end;
+		};
+		std::vector<Chunk> chunks;
+
+		components.view<SkinnedMesh>().each([&](ObjectHandle handle, SkinnedMesh& mesh) {
+			auto node = store.resolve(handle);
+			if (node == nullptr || !mesh.data) return;
+
+			computeJointPalette(mesh, *node, &statistics);
+
+			auto& data = *mesh.data;
+			auto count = (uint32_t)data.vertices.size();
+			mesh.deformed.resize(count);
+			mesh.uploaded = false;
+			for (uint32_t begin = 0; begin < count; begin += VERTICES_PER_CHUNK) {
+				chunks.push_back({ &mesh, begin, std::min(count, begin + VERTICES_PER_CHUNK) });
+			}
+
+			statistics.meshes++;
+			statistics.vertices += count;
+			for (size_t i = 0; i < data.morphTargets.size(); i++) {
+				if (i < mesh.morphWeights.size() && mesh.morphWeights[i] != 0) {
+					statistics.morphedVertices += data.morphTargets[i].vertices.size();
+				}
+			}
+		});
+
+		jobs.parallelFor(0, (uint32_t)chunks.size(), 1, [&chunks](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				deformVertices(*chunks[i].mesh, chunks[i].begin, chunks[i].end);
+			}
+		});
+		return statistics;
+	}
+
+	SkinningStatistics updateSkinnedMeshes(ComponentStore& components) {
+		return updateSkinnedMeshes(components, JobSystem::getInstance());
+	}
+
+	void uploadSkinnedMeshes(ComponentStore& components) {
+		auto& renderer = Rendering::Renderer::getInstance();
+		components.view<SkinnedMesh>().each([&](ObjectHandle, SkinnedMesh& mesh) {
+			if (!mesh.output || mesh.uploaded || mesh.deformed.empty()) return;
+			renderer.updateDynamicVertexBufferObject(*mesh.output, mesh.deformed.data(),
+				mesh.deformed.size() * sizeof(DefaultVertexData));
+			mesh.uploaded = true;
+		});
+	}
+
+}
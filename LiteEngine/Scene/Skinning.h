@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ObjectStore.h"
+#include "Component.h"
+#include "DefaultDS.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LiteEngine {
+	class JobSystem;
+}
+
+namespace LiteEngine::SceneManagement {
+
+	struct Object;
+
+	// 每个顶点最多受 4 个骨骼影响，权重之和为 1。joints 是 Skin::joints 中的下标
+	struct SkinWeights {
+		uint16_t joints[4];
+		float weights[4];
+	};
+
+	// 一个 morph target 只存位移不为 0 的顶点
+	// normals / tangents 为空表示这个 target 不改变法线或切线
+	struct MorphTarget {
+		std::string name;
+		std::vector<uint32_t> vertices;
+		std::vector<DirectX::XMFLOAT3> positions;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<DirectX::XMFLOAT3> tangents;
+	};
+
+	// 一个可变形 mesh 的静止姿态和变形数据，创建后不再修改，多个实例共享
+	// 顶点与 GeometryPool 中静态的那份相同，索引也继续使用静态的那份
+	class DeformableMeshData {
+	public:
+		std::string name;
+		std::vector<DefaultVertexData> vertices;
+		std::vector<SkinWeights> weights;				// 为空表示没有蒙皮，只有 morph target
+		std::vector<MorphTarget> morphTargets;
+		std::vector<float> defaultMorphWeights;			// 与 morphTargets 一一对应
+
+		size_t getMemoryBytes() const;
+	};
+
+	// 骨骼：与 AnimationClip 的目标一样，用从模型根节点开始逐层的 children 下标表示，可以绑定到任何实例上
+	class Skin {
+	public:
+		std::string name;
+		std::vector<std::vector<uint32_t>> joints;
+		std::vector<std::string> jointNames;			// 仅用于调试
+		std::vector<DirectX::XMFLOAT4X4> inverseBindMatrices;
+
+		size_t getMemoryBytes() const;
+	};
+
+	enum class SkinningMethod : uint8_t {
+		LINEAR_BLEND,
+		DUAL_QUATERNION		// 关节弯曲处不会塌陷，但不支持缩放：骨骼矩阵带缩放时这一帧退回线性混合
+	};
+
+	// 挂在可变形 mesh 所在的节点（各个 primitive 的 SceneManagement::Mesh 的父节点）上的组件
+	// 变形后的顶点在该节点的局部空间中，所以各 primitive 仍然按原来的变换绘制
+	struct SkinnedMesh {
+		std::shared_ptr<const DeformableMeshData> data;
+		std::shared_ptr<const Skin> skin;				// 为空表示只有 morph target
+		std::vector<ObjectHandle> joints;				// 与 skin->joints 一一对应，已销毁或找不到的骨骼按单位矩阵处理
+		std::vector<float> morphWeights;
+		SkinningMethod method = SkinningMethod::LINEAR_BLEND;
+
+		// 以下由 updateSkinnedMeshes 维护
+		std::vector<DirectX::XMMATRIX> palette;			// 每个骨骼：静止姿态 -> 当前姿态，都在本节点的局部空间中
+		std::vector<DirectX::XMVECTOR> dualQuaternions;	// 每个骨骼两项：实部、对偶部
+		bool useDualQuaternions = false;				// 这一帧实际使用的方法
+		std::vector<DefaultVertexData> deformed;
+
+		// 渲染线程创建的动态顶点 buffer，uploadSkinnedMeshes 把 deformed 写入其中
+		std::shared_ptr<Rendering::VertexBufferObject> output;
+		bool uploaded = false;
+	};
+
+	struct SkinningStatistics {
+		uint64_t meshes = 0;
+		uint64_t vertices = 0;
+		uint64_t morphedVertices = 0;		// 所有权重不为 0 的 morph target 中的顶点数之和
+		uint64_t linearFallbacks = 0;		// 要求对偶四元数但骨骼带缩放
+	};
+
+	// 按 skin->joints 中的路径在 root 下查找骨骼。skin 可以为空
+	SkinnedMesh createSkinnedMesh(
+		const std::shared_ptr<const DeformableMeshData>& data,
+		const std::shared_ptr<const Skin>& skin,
+		const Object& root
+	);
+
+	// 根据骨骼当前在层级中的位置计算 palette（以及对偶四元数）。node 是组件所在的节点
+	// 读取场景层级，应当在修改层级的线程调用
+	void computeJointPalette(SkinnedMesh& mesh, const Object& node, SkinningStatistics* statistics = nullptr);
+
+	// 对 [begin, end) 的顶点先叠加 morph target 再蒙皮，结果写入 mesh.deformed。不访问场景，可以在任何线程调用
+	void deformVertices(SkinnedMesh& mesh, uint32_t begin, uint32_t end);
+
+	// 计算所有 SkinnedMesh 的 palette，然后把所有 mesh 的顶点切块，在 jobs 的工作线程上变形
+	SkinningStatistics updateSkinnedMeshes(ComponentStore& components, JobSystem& jobs);
+	SkinningStatistics updateSkinnedMeshes(ComponentStore& components);
+
+	// 把变形结果写入动态顶点 buffer。只能在渲染线程调用
+	void uploadSkinnedMeshes(ComponentStore& components);
+
+	// 用随机的骨骼和 morph target 变形 meshes 个各有 verticesPerMesh 个顶点的 mesh
+	// 分别用 1..maxThreads 个线程测量每秒变形的顶点数。maxThreads 为 0 时使用 hardware_concurrency
+	std::string runSkinningBenchmark(uint32_t maxThreads = 0, uint32_t meshes = 16, uint32_t verticesPerMesh = 20000);
+
+}
@@ -0,0 +1,156 @@
+#include "Skinning.h"
+#include "Scene.h"
+#include "../Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		constexpr uint32_t JOINTS = 64;
+		constexpr uint32_t MORPH_TARGETS = 4;
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		// 一条骨骼链，每节沿 y 轴 0.1。静止姿态的逆矩阵就是沿 y 轴平移回去
+		std::shared_ptr<Skin> createChainSkin(Object& root) {
+			std::shared_ptr<Skin> skin(new Skin());
+			skin->name = "benchmark";
+			Object* parent = &root;
+			std::vector<uint32_t> path;
+			for (uint32_t i = 0; i < JOINTS; i++) {
+				std::shared_ptr<Object> joint(new Object("joint" + std::to_string(i)));
+				joint->transT = { 0, i == 0 ? 0.f : 0.1f, 0 };
+				joint->parent = parent;
+				parent->children.push_back(joint);
+				parent = joint.get();
+
+				path.push_back(0);
+				skin->joints.push_back(path);
+				DirectX::XMFLOAT4X4 inverseBind;
+				DirectX::XMStoreFloat4x4(&inverseBind, DirectX::XMMatrixTranslation(0, -0.1f * i, 0));
+				skin->inverseBindMatrices.push_back(inverseBind);
+			}
+			return skin;
+		}
+
+		std::shared_ptr<DeformableMeshData> createRandomMesh(uint32_t vertexCount, std::mt19937& random) {
+			std::uniform_real_distribution<float> unit(-1.f, 1.f);
+			std::uniform_int_distribution<uint32_t> joint(0, JOINTS - 1);
+			std::uniform_real_distribution<float> weight(0.05f, 1.f);
+
+			std::shared_ptr<DeformableMeshData> data(new DeformableMeshData());
+			data->name = "benchmark";
+			data->vertices.resize(vertexCount);
+			data->weights.resize(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				auto& vertex = data->vertices[i];
+				vertex.position = { unit(random) * 0.2f, (unit(random) + 1) * 0.05f * JOINTS, unit(random) * 0.2f };
+
+				// 相邻的几个骨骼，与真实模型一样 palette 的访问比较集中
+				auto& influence = data->weights[i];
+				auto first = std::min(joint(random), JOINTS - 4);
+				float sum = 0;
+				for (int k = 0; k < 4; k++) {
+					influence.joints[k] = (uint16_t)(first + k);
+					influence.weights[k] = weight(random);
+					sum += influence.weights[k];
+				}
+				for (auto& w : influence.weights) w /= sum;
+			}
+
+			// 每个 target 只移动一成的顶点
+			for (uint32_t t = 0; t < MORPH_TARGETS; t++) {
+				MorphTarget target;
+				target.name = "target" + std::to_string(t);
+				for (uint32_t i = t; i < vertexCount; i += 10) {
+					target.vertices.push_back(i);
+					target.positions.push_back({ unit(random) * 0.01f, unit(random) * 0.01f, unit(random) * 0.01f });
+					target.normals.push_back({ unit(random) * 0.1f, unit(random) * 0.1f, unit(random) * 0.1f });
+				}
+				data->morphTargets.push_back(std::move(target));
+				data->defaultMorphWeights.push_back(0.5f);
+			}
+			return data;
+		}
+
+		// 每帧先弯曲骨骼链，再变形所有 mesh。重复几次取最快的一次
+		double run(ComponentStore& components, Object& root, JobSystem& jobs, uint32_t frames, SkinningStatistics& statistics) {
+			constexpr uint32_t REPEAT = 3;
+			double best = 0;
+			for (uint32_t repeat = 0; repeat < REPEAT; repeat++) {
+				statistics = {};
+				auto begin = std::chrono::steady_clock::now();
+				for (uint32_t frame = 0; frame < frames; frame++) {
+					float angle = std::sin(frame * 0.1f) * 0.05f;
+					Object* joint = root.children.empty() ? nullptr : root.children[0].get();
+					for (; joint; joint = joint->children.empty() ? nullptr : joint->children[0].get()) {
+						joint->transR = DirectX::XMQuaternionRotationRollPitchYaw(angle, 0, angle * 0.5f);
+					}
+					auto result = updateSkinnedMeshes(components, jobs);
+					statistics.meshes += result.meshes;
+					statistics.vertices += result.vertices;
+					statistics.morphedVertices += result.morphedVertices;
+					statistics.linearFallbacks += result.linearFallbacks;
+				}
+				auto milliseconds = millisecondsSince(begin);
+				if (repeat == 0 || milliseconds < best) best = milliseconds;
+			}
+			return best;
+		}
+
+	}
+
+	std::string runSkinningBenchmark(uint32_t maxThreads, uint32_t meshes, uint32_t verticesPerMesh) {
+		if (maxThreads == 0) maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		constexpr uint32_t FRAMES = 10;
+
+		std::mt19937 random(2023);
+		std::shared_ptr<Object> root(new Object("SkinningBenchmark"));
+		auto skin = createChainSkin(*root);
+
+		ComponentStore components;
+		std::vector<std::shared_ptr<Object>> nodes;
+		for (uint32_t i = 0; i < meshes; i++) {
+			std::shared_ptr<Object> node(new Object("mesh" + std::to_string(i)));
+			components.add<SkinnedMesh>(node->getHandle(), createSkinnedMesh(createRandomMesh(verticesPerMesh, random), skin, *root));
+			nodes.push_back(node);
+		}
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "skinning: %u meshes, %u vertices each, %u joints, %u morph targets, %u frames\n",
+			meshes, verticesPerMesh, JOINTS, MORPH_TARGETS, FRAMES);
+		out << line;
+		snprintf(line, sizeof(line), "%-8s %-16s %10s %16s %8s\n", "threads", "method", "ms", "vertices / s", "speedup");
+		out << line;
+
+		for (auto method : { SkinningMethod::LINEAR_BLEND, SkinningMethod::DUAL_QUATERNION }) {
+			components.view<SkinnedMesh>().each([&](ObjectHandle, SkinnedMesh& mesh) { mesh.method = method; });
+			double baseline = 0;
+			for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+				// 调用线程也执行 job，所以工作线程数少一个
+				JobSystem jobs(threads - 1);
+				SkinningStatistics statistics;
+				auto milliseconds = run(components, *root, jobs, FRAMES, statistics);
+				if (threads == 1) baseline = milliseconds;
+				snprintf(line, sizeof(line), "%-8u %-16s %10.2f %16.0f %7.2fx\n",
+					threads, method == SkinningMethod::LINEAR_BLEND ? "linear blend" : "dual quaternion",
+					milliseconds, statistics.vertices / milliseconds * 1000, baseline / milliseconds);
+				out << line;
+			}
+		}
+		return out.str();
+	}
+
+}
@@ -0,0 +1,133 @@
+#include "StaticBatching.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <map>
+
+namespace LiteEngine::SceneManagement {
+
+	DirectX::BoundingBox computeStaticBatchSourceBounds(const StaticBatchSource& source) {
+		auto transform = DirectX::XMLoadFloat4x4(&source.transform);
+		DirectX::XMVECTOR lower = DirectX::XMVectorReplicate(FLT_MAX);
+		DirectX::XMVECTOR upper = DirectX::XMVectorReplicate(-FLT_MAX);
+		for (uint32_t i = 0; i < source.indexCount; i++) {
+			auto& vertex = source.vertices[source.indices[i] - source.indexBase];
+			auto position = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&vertex.position), transform);
+			lower = DirectX::XMVectorMin(lower, position);
+			upper = DirectX::XMVectorMax(upper, position);
+		}
+
+		DirectX::BoundingBox bounds({ 0, 0, 0 }, { 0, 0, 0 });
+		if (source.indexCount == 0) return bounds;
+		DirectX::BoundingBox::CreateFromPoints(bounds, lower, upper);
+		return bounds;
+	}
+
+	namespace {
+
+		struct SourceInfo {
+			uint32_t id;
+			uint32_t vertexCount;
+			DirectX::BoundingBox bounds;
+		};
+
+		// 把 [begin, end) 切成顶点数都不超过 maxVertices 的若干份，结果依次追加到 parts
+		void splitSources(
+			std::vector<SourceInfo>::iterator begin,
+			std::vector<SourceInfo>::iterator end,
+			uint32_t maxVertices,
+			std::vector<std::vector<uint32_t>>& parts
+		) {
+			uint64_t vertices = 0;
+			for (auto it = begin; it != end; ++it) vertices += it->vertexCount;
+
+			if (vertices <= maxVertices || end - begin == 1) {
+				parts.emplace_back();
+				for (auto it = begin; it != end; ++it) parts.back().push_back(it->id);
+				return;
+			}
+
+			DirectX::XMFLOAT3 lower{ FLT_MAX, FLT_MAX, FLT_MAX }, upper{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (auto it = begin; it != end; ++it) {
+				auto& c = it->bounds.Center;
+				lower = { std::min(lower.x, c.x), std::min(lower.y, c.y), std::min(lower.z, c.z) };
+				upper = { std::max(upper.x, c.x), std::max(upper.y, c.y), std::max(upper.z, c.z) };
+			}
+			float extents[3] = { upper.x - lower.x, upper.y - lower.y, upper.z - lower.z };
+			auto axis = (int)(std::max_element(extents, extents + 3) - extents);
+
+			auto middle = begin + (end - begin) / 2;
+			std::nth_element(begin, middle, end, [axis](const SourceInfo& a, const SourceInfo& b) {
+				auto ca = (&a.bounds.Center.x)[axis], cb = (&b.bounds.Center.x)[axis];
+				return ca < cb || (ca == cb && a.id < b.id);
+			});
+			splitSources(begin, middle, maxVertices, parts);
+			splitSources(middle, end, maxVertices, parts);
+		}
+
+		void appendSource(StaticBatch& batch, const StaticBatchSource& source) {
+			auto transform = DirectX::XMLoadFloat4x4(&source.transform);
+			// 法线使用逆转置矩阵，非均匀缩放后仍然垂直于表面
+			auto normalTransform = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, transform));
+			bool flip = DirectX::XMVectorGetX(DirectX::XMMatrixDeterminant(transform)) < 0;
+
+			auto first = (uint32_t)batch.vertices.size();
+			batch.vertices.insert(batch.vertices.end(), source.vertices, source.vertices + source.vertexCount);
+			for (auto it = batch.vertices.begin() + first; it != batch.vertices.end(); ++it) {
+				auto position = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&it->position), transform);
+				auto normal = DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&it->normal), normalTransform);
+				auto tangent = DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&it->tangent), transform);
+				DirectX::XMStoreFloat3(&it->position, position);
+				DirectX::XMStoreFloat3(&it->normal, DirectX::XMVector3Normalize(normal));
+				DirectX::XMStoreFloat3(&it->tangent, DirectX::XMVector3Normalize(tangent));
+			}
+
+			auto offset = first - source.indexBase;
+			for (uint32_t i = 0; i + 2 < source.indexCount; i += 3) {
+				batch.indices.push_back(source.indices[i] + offset);
+				batch.indices.push_back(source.indices[i + (flip ? 2 : 1)] + offset);
+				batch.indices.push_back(source.indices[i + (flip ? 1 : 2)] + offset);
+			}
+		}
+
+	}
+
+	std::vector<StaticBatch> buildStaticBatches(const std::vector<StaticBatchSource>& sources, uint32_t maxVerticesPerBatch) {
+		std::vector<DirectX::BoundingBox> bounds;
+		std::map<uint32_t, std::vector<SourceInfo>> groups;
+		for (uint32_t i = 0; i < (uint32_t)sources.size(); i++) {
+			bounds.push_back(computeStaticBatchSourceBounds(sources[i]));
+			groups[sources[i].materialID].push_back({ i, sources[i].vertexCount, bounds.back() });
+		}
+
+		std::vector<StaticBatch> out;
+		for (auto& [materialID, group] : groups) {
+			std::vector<std::vector<uint32_t>> parts;
+			splitSources(group.begin(), group.end(), std::max(1u, maxVerticesPerBatch), parts);
+
+			for (auto& part : parts) {
+				std::sort(part.begin(), part.end());
+
+				StaticBatch batch;
+				batch.materialID = materialID;
+				batch.sources = part;
+				uint32_t vertices = 0, indices = 0;
+				for (auto id : part) {
+					vertices += sources[id].vertexCount;
+					indices += sources[id].indexCount;
+				}
+				batch.vertices.reserve(vertices);
+				batch.indices.reserve(indices);
+
+				batch.bounds = bounds[part[0]];
+				for (auto id : part) {
+					appendSource(batch, sources[id]);
+					DirectX::BoundingBox::CreateMerged(batch.bounds, batch.bounds, bounds[id]);
+				}
+				out.push_back(std::move(batch));
+			}
+		}
+		return out;
+	}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "DefaultDS.h"
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstdint>
+#include <vector>
+
+namespace LiteEngine::SceneManagement {
+
+	// 静态合批：把相对位置不再变化、使用同一材质的若干 mesh 变换到同一个空间（合批空间）并拼接起来，
+	// 每个合批只需要一次 DrawIndexed。这里只处理 CPU 端的顶点，创建 GPU 资源和修改层级由调用方负责
+
+	// 一个参与合批的 primitive
+	struct StaticBatchSource {
+		const DefaultVertexData* vertices;
+		uint32_t vertexCount;
+		const uint32_t* indices;
+		uint32_t indexCount;
+		uint32_t indexBase = 0;				// indices 中的值减去 indexBase 才是 vertices 中的下标
+		DirectX::XMFLOAT4X4 transform;		// 源 mesh 的局部空间 -> 合批空间
+		uint32_t materialID;
+	};
+
+	struct StaticBatch {
+		uint32_t materialID;
+		std::vector<DefaultVertexData> vertices;
+		std::vector<uint32_t> indices;		// 相对于 vertices 的起点
+		DirectX::BoundingBox bounds;		// 合批空间中的包围盒
+		std::vector<uint32_t> sources;		// 合并进来的 StaticBatchSource 下标
+	};
+
+	// 顶点在 transform 之后的包围盒，只统计 indices 引用到的顶点
+	DirectX::BoundingBox computeStaticBatchSourceBounds(const StaticBatchSource& source);
+
+	// 按材质分组，每组拼接成一个合批
+	// 一组的顶点超过 maxVerticesPerBatch 时沿源 mesh 中心分布最长的轴从中间切开，直到每一份都不超过限制
+	// （单个源 mesh 超过限制时自己成为一个合批），这样合批的包围盒不会大到覆盖整个场景，剔除仍然有效
+	// 变换的行列式为负时翻转三角形的环绕方向。结果按材质排序，同一材质内的顺序是确定的
+	std::vector<StaticBatch> buildStaticBatches(const std::vector<StaticBatchSource>& sources, uint32_t maxVerticesPerBatch = 65536);
+
+}
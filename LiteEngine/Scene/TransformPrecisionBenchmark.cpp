@@ -0,0 +1,117 @@
+#include "Scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+namespace LiteEngine::SceneManagement {
+
+	namespace {
+
+		// 改为双精度之前的做法：float 的平移，float 矩阵逐层相乘，结果直接交给 Renderer
+		DirectX::XMMATRIX getFloatLocalToWorldMatrix(const Object& node) {
+			auto out = node.getTransformMatrix();
+			if (auto parent = node.getParent(); parent) {
+				out = DirectX::XMMatrixMultiply(out, getFloatLocalToWorldMatrix(*parent));
+			}
+			return out;
+		}
+
+		double distanceBetween(const DirectX::XMVECTOR& a, const Double3& b) {
+			DirectX::XMFLOAT3 a3;
+			DirectX::XMStoreFloat3(&a3, a);
+			return std::sqrt((a3.x - b.x) * (a3.x - b.x) + (a3.y - b.y) * (a3.y - b.y) + (a3.z - b.z) * (a3.z - b.z));
+		}
+
+		struct PrecisionResult {
+			double floatHierarchy = 0;		// view space 中的最大误差（米）
+			double cameraRelative = 0;
+		};
+
+		// 与 MoonLanding 类似的层级：公转层（旋转）-> 星球（距原点 distance）-> 轨道层（旋转）-> 飞船（星球上空）-> 相机（飞船后上方）
+		// 以双精度的结果为准，比较飞船周围 ±10 m 的点在 view space 中的位置
+		PrecisionResult measure(double distance) {
+			std::shared_ptr<Object> root(new Object("PrecisionRoot"));
+			std::shared_ptr<Object> revolution(new Object("Revolution"));
+			std::shared_ptr<Object> planet(new Object("Planet"));
+			std::shared_ptr<Object> orbit(new Object("Orbit"));
+			std::shared_ptr<Object> ship(new Object("Ship"));
+			std::shared_ptr<Camera> camera(new Camera());
+
+			root->children = { revolution };
+			revolution->children = { planet };
+			planet->children = { orbit };
+			orbit->children = { ship };
+			ship->children = { camera };
+			root->link(root);
+
+			revolution->rotateParentCoord(DirectX::XMQuaternionRotationAxis({ 0, 1, 0 }, 0.7f));
+			planet->transT = { distance, 0, 0 };
+			orbit->rotateParentCoord(DirectX::XMQuaternionRotationAxis({ 0, 0, 1 }, 1.1f));
+			ship->transT = { 1737.4e3 + 100.0, 0.123, 0.456 };
+			camera->transT = { 0, 2, -10 };
+			camera->rotateLocalCoord({ 1, 0, 0 }, 0.2f);
+
+			auto shipToWorld = ship->getLocalToWorldTransform();
+			auto cameraToWorld = camera->getLocalToWorldTransform();
+			auto worldToView = cameraToWorld.inverse();
+
+			auto floatShip = getFloatLocalToWorldMatrix(*ship);
+			auto floatW2V = camera->getW2VMatrix(getFloatLocalToWorldMatrix(*camera));
+
+			auto origin = cameraToWorld.translation;
+			auto relativeShip = shipToWorld.toMatrix(origin);
+			auto relativeW2V = camera->getW2VMatrix(cameraToWorld.toMatrix(origin), origin);
+
+			PrecisionResult result;
+			for (float x : { -10.f, 0.f, 10.f }) {
+				for (float y : { -10.f, 0.f, 10.f }) {
+					for (float z : { -10.f, 0.f, 10.f }) {
+						auto reference = worldToView.transformPoint(shipToWorld.transformPoint({ x, y, z }));
+						DirectX::XMVECTOR point{ x, y, z, 1 };
+
+						auto floatView = DirectX::XMVector3TransformCoord(DirectX::XMVector3TransformCoord(point, floatShip), floatW2V);
+						auto relativeView = DirectX::XMVector3TransformCoord(DirectX::XMVector3TransformCoord(point, relativeShip), relativeW2V);
+						result.floatHierarchy = std::max(result.floatHierarchy, distanceBetween(floatView, reference));
+						result.cameraRelative = std::max(result.cameraRelative, distanceBetween(relativeView, reference));
+					}
+				}
+			}
+			return result;
+		}
+
+	}
+
+	std::string runTransformPrecisionBenchmark() {
+		struct Case {
+			const char* name;
+			double distance;
+		};
+		const Case cases[] = {
+			{ "near origin", 0 },
+			{ "1000 km", 1e6 },
+			{ "earth-moon", 3.844e8 },
+			{ "earth-sun", 1.496e11 },
+		};
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "transform precision: max view space error of points within 10 m of a ship orbiting a planet\n");
+		out << line;
+		snprintf(line, sizeof(line), "%-12s %16s %18s %18s\n", "case", "distance (m)", "float (m)", "camera rel. (m)");
+		out << line;
+		for (auto& c : cases) {
+			auto result = measure(c.distance);
+			snprintf(line, sizeof(line), "%-12s %16.4g %18.6g %18.6g\n", c.name, c.distance, result.floatHierarchy, result.cameraRelative);
+			out << line;
+			// 双精度层级 + 相机相对坐标应当在任何距离下都保持厘米以内的精度
+			if (result.cameraRelative > 1e-2) {
+				throw std::exception(("transform precision benchmark: camera relative error too large at " + std::string(c.name)).c_str());
+			}
+		}
+		return out.str();
+	}
+
+}
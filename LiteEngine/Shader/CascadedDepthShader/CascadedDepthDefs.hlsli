@@ -0,0 +1,29 @@
+#ifndef LITE_ENGINE_SHAREDR_CASCADED_DEPTH_SHADER_CASCADED_DEPTH_DEFS_HLSLI
+#define LITE_ENGINE_SHAREDR_CASCADED_DEPTH_SHADER_CASCADED_DEPTH_DEFS_HLSLI
+
+#include "../Definitions.hlsli"
+
+// 单 pass 级联阴影（Rendering::ShaderSemantics::CASCADED_DEPTH_MAP）
+// 每个 mesh 的 vertex shader 输出这个结构，CascadedDepthGS 按 slice 把三角形送到深度图 array 的对应 slice
+
+// 实例化绘制时 slot 1 中每个实例的数据（Rendering::CascadeInstanceData）
+struct Cascaded_VS_INSTANCE {
+	float4 L2W0 : INSTANCE_L2W0;
+	float4 L2W1 : INSTANCE_L2W1;
+	float4 L2W2 : INSTANCE_L2W2;
+	float4 L2W3 : INSTANCE_L2W3;
+	uint slice  : INSTANCE_SLICE;
+};
+
+struct Cascaded_VS_OUTPUT {
+	float4 position_SV : SV_POSITION;
+	// 相对于 pass 绑定的 view 的第一个 slice，也就是 cascade 在所属光源中的序号
+	uint cascade : CASCADE;
+};
+
+struct Cascaded_GS_OUTPUT {
+	float4 position_SV : SV_POSITION;
+	uint cascade : SV_RenderTargetArrayIndex;
+};
+
+#endif
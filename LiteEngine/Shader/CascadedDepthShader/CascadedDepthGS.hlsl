@@ -0,0 +1,13 @@
+#include "CascadedDepthDefs.hlsli"
+
+// 只转发三角形，并选择写入的 slice。一个实例只属于一级 cascade，三个顶点的 cascade 相同
+[maxvertexcount(3)]
+void main(triangle Cascaded_VS_OUTPUT input[3], inout TriangleStream<Cascaded_GS_OUTPUT> output) {
+	[unroll]
+	for (uint i = 0; i < 3; i++) {
+		Cascaded_GS_OUTPUT vertex;
+		vertex.position_SV = input[i].position_SV;
+		vertex.cascade = input[i].cascade;
+		output.Append(vertex);
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef LITE_ENGINE_SHAREDR_CLUSTERED_LIGHTS_HLSLI
+#define LITE_ENGINE_SHAREDR_CLUSTERED_LIGHTS_HLSLI
+
+#include "Definitions.hlsli"
+#include "FixedPSConstants.hlsli"
+
+// 由 Renderer::prepareLightClusters 填充
+//   sceneLights: 场景中所有的光源，下标与 RenderingScene::lights 相同
+//   lightClusters: 每个 froxel 的 (offset, count)，按 (slice * tilesY + y) * tilesX + x 排列
+//   clusterLightIndices: 各个 froxel 的光源下标
+StructuredBuffer<Light> sceneLights : register(REGISTER_PS_LIGHTS);
+StructuredBuffer<uint2> lightClusters : register(REGISTER_PS_LIGHT_CLUSTERS);
+StructuredBuffer<uint> clusterLightIndices : register(REGISTER_PS_CLUSTER_LIGHT_INDICES);
+
+// 与 LightClusterGrid::findCluster 一致，视锥外的点夹到边界上
+uint2 getLightCluster(float3 position_W) {
+	float3 position_V = mul(trans_W2V, float4(position_W, 1)).xyz;
+	float2 ndc = position_V.xy * clusterViewScale;
+	float depth = position_V.z;
+	if (clusterPerspective) {
+		float z = max(position_V.z, 1e-6);
+		ndc /= z;
+		depth = log(z);
+	}
+
+	uint2 tile = (uint2)clamp(floor((ndc * 0.5 + 0.5) * clusterCount.xy), 0, (float2)(clusterCount.xy - 1));
+	uint slice = (uint)clamp(floor(depth * clusterZScale + clusterZBias), 0, (float)(clusterCount.z - 1));
+	return lightClusters[(slice * clusterCount.y + tile.y) * clusterCount.x + tile.x];
+}
+
+// 点光源和聚光灯在 maximumDistance 处平滑地衰减到 0（剔除时也以此为界），聚光灯在 inner 和 outer 之间过渡
+// lightDir_W 从表面指向光源
+float getLightFalloff(Light light, float3 lightDir_W, float distance) {
+	float falloff = 1;
+	if (!isinf(light.maximumDistance) && light.maximumDistance > 0) {
+		float ratio = distance / light.maximumDistance;
+		falloff = pow(saturate(1 - ratio * ratio * ratio * ratio), 2);
+	}
+	if (light.type == LIGHT_TYPE_SPOT) {
+		float cosine = dot(-lightDir_W, light.direction_W);
+		falloff *= smoothstep(cos(light.outerConeAngle), cos(light.innerConeAngle), cosine);
+	}
+	return falloff;
+}
+
+#endif
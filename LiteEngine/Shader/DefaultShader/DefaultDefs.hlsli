@@ -4,19 +4,31 @@
 #include "../Definitions.hlsli"
 
 struct Default_VS_OUTPUT {
-	// vertex shader Ӧһ clip space ģ
-	//  pixel shader յ screen space 
+	// vertex shader 应当传一个 clip space 的，
+	// 但是 pixel shader 接收到的是 screen space 
 	// (x in [0, W), y in [0, H), z in [0, 1], w = view space depth)
 	float4 position_SV      : SV_POSITION;
 
 	float3 position_W       : POSITION_W;
 	float4 position_V       : POSITION_V;
-	float3 normal_W 		: NORMAL;		// TODO զûŪ
+	float3 normal_W 		: NORMAL;		// TODO 这个矫正咋做。。还没弄
 	float3 tangent_W	    : TANGENT;
 	float2 texCoord0		: TEXCOORD0;
 	float2 texCoord1		: TEXCOORD1;
 	float4 color			: COLOR;
 };
 
+// 实例化绘制时 slot 1 中每个实例的数据（Rendering::InstanceData），每个矩阵按行拆成 4 个 float4
+// 与 cbuffer 中的矩阵不同，按行读入得到的就是 XMMATRIX 本身，所以要用 mul(行向量, 矩阵)
+struct Default_VS_INSTANCE {
+	float4 L2W0 : INSTANCE_L2W0;
+	float4 L2W1 : INSTANCE_L2W1;
+	float4 L2W2 : INSTANCE_L2W2;
+	float4 L2W3 : INSTANCE_L2W3;
+	float4 W2L0 : INSTANCE_W2L0;
+	float4 W2L1 : INSTANCE_W2L1;
+	float4 W2L2 : INSTANCE_W2L2;
+	float4 W2L3 : INSTANCE_W2L3;
+};
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "DefaultDefs.hlsli"
 #include "../Definitions.hlsli"
 #include "../FixedPSConstants.hlsli"
+#include "../ClusteredLights.hlsli"
 
 //#define SLOT_BASE_COLOR			0
 //#define SLOT_EMISSION_COLOR		1
@@ -33,6 +34,7 @@ cbuffer DefaultPSConstant : register(REGISTER_PS_MATERIAL) {
 
 	uint channelMetallic;
 	uint channelAO;
+	uint normalReconstructZ;
 };
 
 
@@ -108,8 +110,8 @@ float3 defaultMaterialBRDF(
 	// normalized surface normal
 	float3 N
 ) {
-	//  glTF 2.0 Specification жԲʵĹ涨д
-	// Ϊ normal map Ĺϵﲻܼ dot(V, H) < N
+	// 基本按照 glTF 2.0 Specification 中对材质的规定写的
+	// 因为有 normal map 的关系，这里不能加 dot(V, H) < N
 	if (dot(L, N) < 0) {
 		return float3(0, 0, 0);
 	} else {
@@ -129,7 +131,11 @@ float3 getNormal(float3 normal, float3 tangent, float3 normalMapValue, float sca
 	tangent = normalize(tangent - dot(tangent, normal) * normal / length(normal));
 	float3 bitangent = normalize(cross(normal, tangent));
 	float3x3 TBN = float3x3(tangent, bitangent, normal);
-	float3 scaledNormal = normalize(normalMapValue * 2.0 - 1.0) * float3(scale, scale, 1.0);
+	float3 unpacked = normalMapValue * 2.0 - 1.0;
+	if (normalReconstructZ) {
+		unpacked.z = sqrt(saturate(1 - dot(unpacked.xy, unpacked.xy)));
+	}
+	float3 scaledNormal = normalize(unpacked) * float3(scale, scale, 1.0);
 	return normalize(mul(TBN, scaledNormal));
 }
 
@@ -181,8 +187,11 @@ float4 main(Default_VS_OUTPUT pdata) : SV_TARGET{
 		) : normalize(pdata.normal_W);
 
 	float depth_V = pdata.position_V.z / pdata.position_V.w;
-		
-	for (uint lightID = 0; lightID < numberOfLights; lightID++) {
+
+	// 只计算所在 froxel 中的光源
+	uint2 cluster = getLightCluster(pdata.position_W);
+	for (uint i = 0; i < cluster.y; i++) {
+		uint lightID = clusterLightIndices[cluster.x + i];
 		int coneID = -1;
 
 		for (int j = 0; j < NUMBER_SHADOW_MAP_PER_LIGHT; j++) {
@@ -192,16 +201,26 @@ float4 main(Default_VS_OUTPUT pdata) : SV_TARGET{
 		}
 
 		float shadowed = 0;
-		if (coneID != -1 && CSMValid[lightID][coneID]) {
+		// 实例化绘制的一组物体 layers 相同，这里的 objectLayers 对每个实例都成立
+		// 光源在深度图中的 slot，没有阴影时为 MAX_NUMBER_OF_SHADOWED_LIGHTS
+		uint slot = MAX_NUMBER_OF_SHADOWED_LIGHTS;
+		[unroll]
+		for (uint k = 0; k < MAX_NUMBER_OF_SHADOWED_LIGHTS; k++) {
+			if (CSMLightID[k] == lightID) slot = k;
+		}
+
+		// hlsl 的 && 不短路，先把下标限制在范围内
+		uint shadowID = min(slot, MAX_NUMBER_OF_SHADOWED_LIGHTS - 1);
+		if (slot < MAX_NUMBER_OF_SHADOWED_LIGHTS && coneID != -1 && CSMValid[shadowID][coneID] && (objectLayers & RENDER_LAYER_SHADOW_RECEIVER)) {
 			// visibility
-			float4 depthMapCoord = mul(trans_W2CSM[lightID][coneID], float4(pdata.position_W, 1));
+			float4 depthMapCoord = mul(trans_W2CSM[shadowID][coneID], float4(pdata.position_W, 1));
 			depthMapCoord.xyz /= depthMapCoord.w;
 			
 			[unroll]
 			for (float deltaX = -0.001; deltaX < 0.0011; deltaX += 0.001) {
 				[unroll]
 				for (float deltaY = -0.001; deltaY < 0.0011; deltaY += 0.001) {
-					float depthSampled = CSMDepthTextures.Sample(CSMDepthSampler, float3(depthMapCoord.xy + float2(deltaX, deltaY), lightID * NUMBER_SHADOW_MAP_PER_LIGHT + coneID)).x;
+					float depthSampled = CSMDepthTextures.Sample(CSMDepthSampler, float3(depthMapCoord.xy + float2(deltaX, deltaY), shadowID * NUMBER_SHADOW_MAP_PER_LIGHT + coneID)).x;
 					if (depthSampled < depthMapCoord.z) {
 						shadowed += 1;
 					}
@@ -211,7 +230,7 @@ float4 main(Default_VS_OUTPUT pdata) : SV_TARGET{
 
 		float visibility = 1 - shadowed / 9;
 
-		Light light = lights[lightID];
+		Light light = sceneLights[lightID];
 
 		if (light.type == LIGHT_TYPE_POINT || light.type == LIGHT_TYPE_SPOT) {
 			float3 positionVecDist = light.position_W - pdata.position_W;
@@ -220,7 +239,8 @@ float4 main(Default_VS_OUTPUT pdata) : SV_TARGET{
 			float3 lightDir_W = positionVecDist / distance;	// lightID.e. L
 			float3 brdf = defaultMaterialBRDF(baseColor.xyz, metallic, roughness, 1.45, cameraDir_W, lightDir_W, normal_W);
 			float cosLightNormal = dot(normal_W, lightDir_W);
-			output += visibility * brdf * light.intensity * cosLightNormal / distance2;
+			float falloff = getLightFalloff(light, lightDir_W, distance);
+			output += visibility * falloff * brdf * light.intensity * cosLightNormal / distance2;
 		} else {
 			// Directional
 			float3 lightDir_W = -light.direction_W;
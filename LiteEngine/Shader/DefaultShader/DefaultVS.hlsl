@@ -25,7 +25,7 @@ Default_VS_OUTPUT main(Default_VS_INPUT vdata) {
 	outval.texCoord1 = vdata.texCoord1;
 	outval.color = vdata.color;
 
-	// һҪֵ
+	// 一般需要做方向插值嘛
 	// ie. outval.normal_W = mul(transpose(trans_W2L), float4(vdata.normal_L, 0)).xyz;
 	outval.normal_W = mul(float4(vdata.normal_L, 0), trans_W2L).xyz;
 	outval.tangent_W = mul(trans_L2W, float4(vdata.tangent_L, 0)).xyz;
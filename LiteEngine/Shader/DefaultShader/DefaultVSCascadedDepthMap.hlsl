@@ -0,0 +1,24 @@
+#include "../CascadedDepthShader/CascadedDepthDefs.hlsli"
+#include "../Definitions.hlsli"
+#include "../FixedVSConstants.hlsli"
+
+
+struct Default_VS_INPUT {
+	float3 position_L: POSITION;
+	float3 normal_L: NORMAL;
+	float3 tangent_L: TANGENT;
+	float4 color: COLOR;	// apply to base color only
+	float2 texCoord0: TEXCOORD0;
+	float2 texCoord1: TEXCOORD1;
+};
+
+
+Cascaded_VS_OUTPUT main(Default_VS_INPUT vdata, Cascaded_VS_INSTANCE instance) {
+	float4x4 instance_L2W = float4x4(instance.L2W0, instance.L2W1, instance.L2W2, instance.L2W3);
+	float4 position_W4 = mul(float4(vdata.position_L, 1), instance_L2W);
+
+	Cascaded_VS_OUTPUT output;
+	output.cascade = instance.slice % NUMBER_SHADOW_MAP_PER_LIGHT;
+	output.position_SV = mul(trans_W2CCascades[output.cascade], position_W4);
+	return output;
+}
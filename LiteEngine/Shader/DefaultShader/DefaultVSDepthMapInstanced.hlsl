@@ -0,0 +1,20 @@
+#include "DefaultDefs.hlsli"
+#include "../Definitions.hlsli"
+#include "../FixedVSConstants.hlsli"
+
+
+struct Default_VS_INPUT {
+	float3 position_L: POSITION;
+	float3 normal_L: NORMAL;
+	float3 tangent_L: TANGENT;
+	float4 color: COLOR;	// apply to base color only
+	float2 texCoord0: TEXCOORD0;
+	float2 texCoord1: TEXCOORD1;
+};
+
+
+float4 main(Default_VS_INPUT vdata, Default_VS_INSTANCE instance): SV_POSITION {
+	float4x4 instance_L2W = float4x4(instance.L2W0, instance.L2W1, instance.L2W2, instance.L2W3);
+	float4 position_W4 = mul(float4(vdata.position_L, 1), instance_L2W);
+	return mul(trans_W2C, position_W4);
+}
\ No newline at end of file
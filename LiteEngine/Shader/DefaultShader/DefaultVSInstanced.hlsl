@@ -0,0 +1,37 @@
+#include "DefaultDefs.hlsli"
+#include "../Definitions.hlsli"
+#include "../FixedVSConstants.hlsli"
+
+
+struct Default_VS_INPUT {
+	float3 position_L: POSITION;
+	float3 normal_L: NORMAL;
+	float3 tangent_L: TANGENT;
+	float4 color: COLOR;	// apply to base color only
+	float2 texCoord0: TEXCOORD0;
+	float2 texCoord1: TEXCOORD1;
+};
+
+
+// 与 DefaultVS 相同，但物体的变换来自实例数据而不是 FixedPerobjectVSConstants
+Default_VS_OUTPUT main(Default_VS_INPUT vdata, Default_VS_INSTANCE instance) {
+	Default_VS_OUTPUT outval;
+
+	float4x4 instance_L2W = float4x4(instance.L2W0, instance.L2W1, instance.L2W2, instance.L2W3);
+	float4x4 instance_W2L = float4x4(instance.W2L0, instance.W2L1, instance.W2L2, instance.W2L3);
+
+	float4 position_W4 = mul(float4(vdata.position_L, 1), instance_L2W);
+
+	outval.position_V = mul(trans_W2V, position_W4);
+	outval.position_SV = mul(trans_W2C, position_W4);
+	outval.position_W = position_W4.xyz / position_W4.w;
+	outval.texCoord0 = vdata.texCoord0;
+	outval.texCoord1 = vdata.texCoord1;
+	outval.color = vdata.color;
+
+	// 法线乘逆矩阵的转置
+	outval.normal_W = mul(instance_W2L, float4(vdata.normal_L, 0)).xyz;
+	outval.tangent_W = mul(float4(vdata.tangent_L, 0), instance_L2W).xyz;
+
+	return outval;
+}
\ No newline at end of file
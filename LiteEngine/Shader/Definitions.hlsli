@@ -9,10 +9,13 @@ static const uint LIGHT_SHADOW_EMPTY = 0x1;
 static const uint LIGHT_SHADOW_HARD = 0x2;
 static const uint LIGHT_SHADOW_SOFT = 0x3;	// TODO: unimplemented
 
-#define MAX_NUMBER_OF_LIGHTS 4
+// Rendering::RenderLayers
+static const uint RENDER_LAYER_SHADOW_RECEIVER = 0x4;
+
+#define MAX_NUMBER_OF_SHADOWED_LIGHTS 4
 #define NUMBER_SHADOW_MAP_PER_LIGHT 4
 
-// Щ custom  constants
+// 这些都是 custom 的 constants
 
 #define REGISTER_PS_LONGTERM b0
 #define REGISTER_PS_PERFRAME b1
@@ -23,6 +26,11 @@ static const uint LIGHT_SHADOW_SOFT = 0x3;	// TODO: unimplemented
 #define REGISTER_VS_PERFRAME b1
 #define REGISTER_VS_PEROBJECT b2
 
+// 分簇光照，见 ClusteredLights.hlsli
+#define REGISTER_PS_LIGHTS t12
+#define REGISTER_PS_LIGHT_CLUSTERS t13
+#define REGISTER_PS_CLUSTER_LIGHT_INDICES t14
+
 #define REGISTER_PS_CSM_TEXTURE t15
 #define REGISTER_PS_CSM_SAMPLER s15
 
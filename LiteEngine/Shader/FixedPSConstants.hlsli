@@ -3,6 +3,7 @@
 
 #include "Definitions.hlsli"
 
+// 在 StructuredBuffer 中紧密排列，需要与 Rendering::LightDesc 一样填充到 64 字节
 struct Light {
 	uint type;						// all
 	uint shadow;						// all
@@ -13,7 +14,10 @@ struct Light {
 	float maximumDistance;			// spot & point
 
 	float3 direction_W;			// spot & directional
+	float _space2;
+
 	float3 intensity;			// all
+	float _space3;
 };
 
 
@@ -29,23 +33,32 @@ cbuffer FixedPerframePSConstantBufferData : register(b4) {
 	matrix trans_V2W;
 
 	float exposure;
-	uint numberOfLights; 
+	uint numberOfLights;		// 光源本身在 sceneLights 中（ClusteredLights.hlsli）
 	// space
 
-	Light lights[MAX_NUMBER_OF_LIGHTS];
-
 	float CSMZList[NUMBER_SHADOW_MAP_PER_LIGHT + 1];	// 4 floats
 
 	// order: light0: map0 map1 map2; light1: map0 map1 map2, ...
-	uint CSMValid[MAX_NUMBER_OF_LIGHTS] [NUMBER_SHADOW_MAP_PER_LIGHT] ;	// 12 uint
+	uint CSMValid[MAX_NUMBER_OF_SHADOWED_LIGHTS] [NUMBER_SHADOW_MAP_PER_LIGHT] ;	// 12 uint
+
+	// 每个 slot 对应的光源下标（由 Renderer 的阴影预算选择），没有使用的 slot 为 0xffffffff
+	uint CSMLightID[MAX_NUMBER_OF_SHADOWED_LIGHTS];
 
 	// 4 3
-	matrix trans_W2CSM[MAX_NUMBER_OF_LIGHTS] [NUMBER_SHADOW_MAP_PER_LIGHT] ;
+	matrix trans_W2CSM[MAX_NUMBER_OF_SHADOWED_LIGHTS] [NUMBER_SHADOW_MAP_PER_LIGHT] ;
+
+	// 分簇光照，与 Rendering::LightClusterGrid 一致
+	uint3 clusterCount;			// tilesX, tilesY, slices
+	uint clusterPerspective;
+	float2 clusterViewScale;
+	float clusterZScale;
+	float clusterZBias;
 };
 
 cbuffer FixedPerobjectPSConstants : register(b5) {
 	matrix trans_L2W;
 	matrix trans_W2L;
+	uint objectLayers;
 };
 
 #endif
\ No newline at end of file
@@ -1,7 +1,7 @@
-// XMMatrix иľҳõľ  Scale Ⱥľ
-// XMMatrix 洢ķʽ
-// HLSL Ĭϲ
-// HLSL аѴľֱӵ˾ոպ~
+// XMMatrix 中给出的矩阵都是右乘用的矩阵 （如 Scale 等函数给出的矩阵）
+// XMMatrix 存储矩阵的方式是行主序
+// HLSL 默认采用列主序
+// HLSL 中把传过来的矩阵直接当作左乘矩阵刚刚好~
 
 #ifndef LITE_ENGINE_SHAREDR_VS_FIXED_CONSTANTS_HLSLI
 #define LITE_ENGINE_SHAREDR_VS_FIXED_CONSTANTS_HLSLI
@@ -19,11 +19,15 @@ cbuffer FixedPerframeVSConstants : register(b4) {
 	matrix trans_V2W;
 	matrix trans_V2C;
 	matrix trans_W2C;
+
+	// 单 pass 级联阴影，下标是 cascade 在所属光源中的序号
+	matrix trans_W2CCascades[NUMBER_SHADOW_MAP_PER_LIGHT];
 };
 
 cbuffer FixedPerobjectVSConstants : register(b5) {
 	matrix trans_L2W;
 	matrix trans_W2L;
+	uint objectLayers;
 };
 
 #endif
\ No newline at end of file
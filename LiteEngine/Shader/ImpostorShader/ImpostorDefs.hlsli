@@ -0,0 +1,12 @@
+#ifndef LITE_ENGINE_SHAREDR_IMPOSTOR_SHADER_IMPOSTOR_DEFS_HLSLI
+#define LITE_ENGINE_SHAREDR_IMPOSTOR_SHADER_IMPOSTOR_DEFS_HLSLI
+
+#include "../Definitions.hlsli"
+
+struct Impostor_VS_OUTPUT {
+	float4 position_SV      : SV_POSITION;
+	float3 position_W       : POSITION_W;
+	float3 position_I       : POSITION_I;	// impostor 空间（包围球是原点处的单位球），在过球心、垂直于视线的平面上
+};
+
+#endif
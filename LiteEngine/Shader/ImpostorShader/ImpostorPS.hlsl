@@ -0,0 +1,113 @@
+#include "ImpostorDefs.hlsli"
+#include "../Definitions.hlsli"
+#include "../FixedPSConstants.hlsli"
+#include "../ClusteredLights.hlsli"
+
+const static float PI = 3.14159265f;
+
+cbuffer ImpostorPSConstant : register(REGISTER_PS_MATERIAL) {
+	float fade;				// 可见的比例，(0, 1) 时按屏幕位置抖动地丢弃像素
+	uint framesPerSide;
+};
+
+Texture2D texAlbedo: register(t0);
+Texture2D texNormal: register(t1);
+Texture2D texEmission: register(t2);
+sampler sampAtlas: register(s0);
+
+// 与 SceneManagement::encodeOctahedron / decodeOctahedron 一致：+Y 在中心
+float2 encodeOctahedron(float3 direction) {
+	float3 p = direction / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+	float2 xz = p.xz;
+	if (p.y < 0) {
+		xz = (1 - abs(p.zx)) * (p.xz >= 0 ? 1 : -1);
+	}
+	return xz * 0.5 + 0.5;
+}
+
+float3 decodeOctahedron(float2 uv) {
+	float2 xz = uv * 2 - 1;
+	float y = 1 - abs(xz.x) - abs(xz.y);
+	if (y < 0) {
+		xz = (1 - abs(xz.yx)) * (xz >= 0 ? 1 : -1);
+	}
+	return normalize(float3(xz.x, y, xz.y));
+}
+
+// 与 SceneManagement::getImpostorFrameBasis 一致
+void getFrameBasis(float3 direction, out float3 right, out float3 up) {
+	float3 reference = abs(direction.y) < 0.999 ? float3(0, 1, 0) : float3(0, 0, 1);
+	right = normalize(cross(reference, direction));
+	up = cross(direction, right);
+}
+
+// 在格子 frame 的正交投影中查找 position_I，超出格子时返回 0
+void sampleFrame(float2 frame, float weight, float3 position_I, inout float4 albedo, inout float3 normal, inout float3 emission) {
+	float3 direction = decodeOctahedron(frame / (float)(framesPerSide - 1));
+	float3 right, up;
+	getFrameBasis(direction, right, up);
+	float2 local = float2(dot(position_I, right), -dot(position_I, up)) * 0.5 + 0.5;
+	if (any(local < 0) || any(local > 1)) return;
+
+	float2 uv = (frame + local) / (float)framesPerSide;
+	albedo += weight * texAlbedo.Sample(sampAtlas, uv);
+	normal += weight * (texNormal.Sample(sampAtlas, uv).xyz * 2 - 1);
+	emission += weight * texEmission.Sample(sampAtlas, uv).xyz;
+}
+
+float4 main(Impostor_VS_OUTPUT pdata) : SV_TARGET {
+	// 抖动淡入：与同时绘制的 mesh 叠加，不需要排序和混合
+	float noise = frac(52.9829189 * frac(dot(pdata.position_SV.xy, float2(0.06711056, 0.00583715))));
+	clip(fade - noise - 0.0001);
+
+	float3 cameraPos_W = trans_V2W._m03_m13_m23 / trans_V2W._m33;
+	float3 center_W = trans_L2W._m03_m13_m23 / trans_L2W._m33;
+
+	// 相机在 impostor 空间中的方向决定使用哪三个格子（八面体网格中所在的三角形）
+	float3 view_I = normalize(mul(trans_W2L, float4(cameraPos_W - center_W, 0)).xyz);
+	float2 grid = encodeOctahedron(view_I) * (float)(framesPerSide - 1);
+	float2 cell = min(floor(grid), (float)(framesPerSide - 2));
+	float2 f = grid - cell;
+
+	float4 albedo = 0;
+	float3 normal = 0;
+	float3 emission = 0;
+	if (f.x + f.y < 1) {
+		sampleFrame(cell, 1 - f.x - f.y, pdata.position_I, albedo, normal, emission);
+		sampleFrame(cell + float2(1, 0), f.x, pdata.position_I, albedo, normal, emission);
+		sampleFrame(cell + float2(0, 1), f.y, pdata.position_I, albedo, normal, emission);
+	} else {
+		sampleFrame(cell + float2(1, 1), f.x + f.y - 1, pdata.position_I, albedo, normal, emission);
+		sampleFrame(cell + float2(1, 0), 1 - f.y, pdata.position_I, albedo, normal, emission);
+		sampleFrame(cell + float2(0, 1), 1 - f.x, pdata.position_I, albedo, normal, emission);
+	}
+	clip(albedo.a - 0.5);
+
+	float3 baseColor = pow(max(float3(0, 0, 0), albedo.xyz / albedo.a), 2.2);
+	float3 normal_W = normalize(mul(float4(normal, 0), trans_W2L).xyz);
+
+	// 只有漫反射，不计算阴影：impostor 只用于很远的物体
+	float3 output = float3(0, 0, 0);
+	uint2 cluster = getLightCluster(pdata.position_W);
+	for (uint i = 0; i < cluster.y; i++) {
+		Light light = sceneLights[clusterLightIndices[cluster.x + i]];
+		if (light.type == LIGHT_TYPE_POINT || light.type == LIGHT_TYPE_SPOT) {
+			float3 positionVecDist = light.position_W - pdata.position_W;
+			float distance2 = dot(positionVecDist, positionVecDist);
+			float distance = sqrt(distance2);
+			float3 lightDir_W = positionVecDist / distance;
+			float falloff = getLightFalloff(light, lightDir_W, distance);
+			output += falloff * baseColor / PI * light.intensity * max(0, dot(normal_W, lightDir_W)) / distance2;
+		} else {
+			output += baseColor / PI * light.intensity * max(0, dot(normal_W, -light.direction_W));
+		}
+	}
+
+	// ambient
+	output += 0.1 * baseColor;
+
+	// emission
+	output += pow(max(float3(0, 0, 0), emission / albedo.a), 2.2);
+
+	return float4(pow(max(float3(0, 0, 0), output), 1 / 2.2), 1.0);
+}
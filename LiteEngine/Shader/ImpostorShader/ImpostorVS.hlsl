@@ -0,0 +1,31 @@
+#include "ImpostorDefs.hlsli"
+#include "../Definitions.hlsli"
+#include "../FixedVSConstants.hlsli"
+
+// 输入是 [-1, 1]^2 的四边形。trans_L2W 把 impostor 空间变换到世界空间
+// 面片在 view space 中朝向相机，大小刚好框住包围球
+Impostor_VS_OUTPUT main(float2 corner : POSITION) {
+	float4 center_W = mul(trans_L2W, float4(0, 0, 0, 1));
+	float radius_W = length(mul(trans_L2W, float4(1, 0, 0, 0)).xyz);
+	float4 center_V = mul(trans_W2V, center_W);
+	float4 position_V = center_V + float4(corner * radius_W * center_V.w, 0, 0);
+
+	// 沿视线把面片拉到包围球前方，屏幕上的位置不变，但不会被同时绘制的 mesh 挡住
+	// 透视投影时沿着从相机出发的射线缩放，正交投影时直接平移
+	float4 front_V = position_V;
+	bool perspective = trans_V2C._m32 != 0;
+	if (perspective) {
+		float z = center_V.z / center_V.w;
+		front_V.xyz *= max(z - radius_W, z * 0.5) / z;
+	} else {
+		front_V.z -= radius_W * front_V.w;
+	}
+
+	Impostor_VS_OUTPUT outval;
+	outval.position_SV = mul(trans_V2C, front_V);
+	float4 position_W4 = mul(trans_V2W, position_V);
+	outval.position_W = position_W4.xyz / position_W4.w;
+	float4 position_I4 = mul(trans_W2L, position_W4);
+	outval.position_I = position_I4.xyz / position_I4.w;
+	return outval;
+}
@@ -4,8 +4,8 @@
 #include "../Definitions.hlsli"
 
 struct Skybox_VS_OUTPUT {
-	// vertex shader Ӧһ clip space ģ
-	//  pixel shader յ screen space 
+	// vertex shader 应当传一个 clip space 的，
+	// 但是 pixel shader 接收到的是 screen space 
 	// (x in [0, W), y in [0, H), z in [0, 1], w = view space depth)
 
 	float4 position_SV      : SV_POSITION;
@@ -3,14 +3,14 @@
 #include "../FixedPSConstants.hlsli"
 
 cbuffer FixedPerobjectPSConstants : register(REGISTER_PS_MATERIAL) {
-	// ϵ+Z up ת +Y up 
-	// 磬blender ģʹõ +Z up ϵ
-	//  DirectX  TextureCube Ĳõ +Y up ϵ
-	// ʹ [x', y', z'] Խ任 x' ǽģ x DirectX еıʾ
+	// 用于做左右手系交换、+Z up 转 +Y up 等
+	// 比如，blender 建模软件使用的是 +Z up 右手系坐标
+	// 而 DirectX （的 TextureCube 的采样函数）用的是 +Y up 的左手系坐标
+	// 使用 [x', y', z'] 矩阵可以进行坐标变换 （x' 是建模软件 x轴在 DirectX 坐标中的表示）
 
-	// תǿ֮ЧҲ
+	// 旋转的星空之类的效果也可以在这里做
 
-	// ֻӦת
+	// 这个矩阵只应该做旋转和缩放
 
 	matrix trans_CubeMap;
 };
@@ -9,7 +9,7 @@ Skybox_VS_OUTPUT main( float3 pos : POSITION ) {
 	oval.position_W = pos;
 	oval.position_SV = mul(trans_W2C, float4(pos + cameraPos_W, 1));
 
-	// perspective corrected interpolation Ǹ w ģԸ z
+	// perspective corrected interpolation 是根据 w 来做的，所以改 z
 	oval.position_SV.z = oval.position_SV.w;
 	return oval;
 }
\ No newline at end of file
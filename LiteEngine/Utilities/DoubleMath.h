@@ -0,0 +1,123 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+namespace LiteEngine {
+
+	// 双精度的点 / 向量。层级中的平移用它保存，离原点很远（如地月距离）时仍然精确到毫米以下
+	struct Double3 {
+		double x = 0;
+		double y = 0;
+		double z = 0;
+
+		Double3() = default;
+		Double3(double x, double y, double z) : x(x), y(y), z(z) {}
+		Double3(const DirectX::XMFLOAT3& v) : x(v.x), y(v.y), z(v.z) {}
+
+		DirectX::XMFLOAT3 toFloat3() const {
+			return { (float)x, (float)y, (float)z };
+		}
+
+		Double3 operator+(const Double3& other) const {
+			return { x + other.x, y + other.y, z + other.z };
+		}
+
+		Double3 operator-(const Double3& other) const {
+			return { x - other.x, y - other.y, z - other.z };
+		}
+	};
+
+	// 双精度的仿射变换。与 DirectXMath 一样使用行向量：p' = p * linear + translation
+	// 只在 CPU 上组合层级时使用，交给 GPU 之前用 toMatrix 减去一个附近的原点再转成 float
+	struct DoubleTransform {
+		double linear[3][3];
+		Double3 translation;
+
+		static DoubleTransform identity() {
+			return { { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }, { 0, 0, 0 } };
+		}
+
+		// 先缩放，再旋转，再平移，与 XMMatrixAffineTransformation 一致。旋转不会被归一化
+		static DoubleTransform fromTRS(const Double3& t, const DirectX::XMVECTOR& r, const DirectX::XMFLOAT3& s) {
+			DirectX::XMFLOAT4 q;
+			DirectX::XMStoreFloat4(&q, r);
+			double x = q.x, y = q.y, z = q.z, w = q.w;
+			double rotation[3][3] = {
+				{ 1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y) },
+				{ 2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x) },
+				{ 2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y) },
+			};
+			double scale[3] = { s.x, s.y, s.z };
+
+			DoubleTransform out;
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) out.linear[i][j] = scale[i] * rotation[i][j];
+			}
+			out.translation = t;
+			return out;
+		}
+
+		// m 必须是仿射矩阵（最后一列为 0, 0, 0, 1）
+		static DoubleTransform fromMatrix(const DirectX::XMMATRIX& m) {
+			DirectX::XMFLOAT4X4 f;
+			DirectX::XMStoreFloat4x4(&f, m);
+			DoubleTransform out;
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) out.linear[i][j] = f.m[i][j];
+			}
+			out.translation = { f.m[3][0], f.m[3][1], f.m[3][2] };
+			return out;
+		}
+
+		// 先作用 this，再作用 parent（与 XMMatrixMultiply(this, parent) 相同）
+		DoubleTransform operator*(const DoubleTransform& parent) const {
+			DoubleTransform out;
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					out.linear[i][j] = linear[i][0] * parent.linear[0][j] + linear[i][1] * parent.linear[1][j] + linear[i][2] * parent.linear[2][j];
+				}
+			}
+			out.translation = parent.transformPoint(translation);
+			return out;
+		}
+
+		Double3 transformPoint(const Double3& p) const {
+			return {
+				p.x * linear[0][0] + p.y * linear[1][0] + p.z * linear[2][0] + translation.x,
+				p.x * linear[0][1] + p.y * linear[1][1] + p.z * linear[2][1] + translation.y,
+				p.x * linear[0][2] + p.y * linear[1][2] + p.z * linear[2][2] + translation.z,
+			};
+		}
+
+		// 不可逆（有一个方向的缩放为 0）时结果没有意义
+		DoubleTransform inverse() const {
+			auto& m = linear;
+			double cofactor[3][3] = {
+				{ m[1][1] * m[2][2] - m[1][2] * m[2][1], m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][1] * m[1][2] - m[0][2] * m[1][1] },
+				{ m[1][2] * m[2][0] - m[1][0] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][2] * m[1][0] - m[0][0] * m[1][2] },
+				{ m[1][0] * m[2][1] - m[1][1] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1], m[0][0] * m[1][1] - m[0][1] * m[1][0] },
+			};
+			double determinant = m[0][0] * cofactor[0][0] + m[0][1] * cofactor[1][0] + m[0][2] * cofactor[2][0];
+
+			DoubleTransform out;
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) out.linear[i][j] = cofactor[i][j] / determinant;
+			}
+			out.translation = { 0, 0, 0 };
+			auto t = out.transformPoint(translation);
+			out.translation = { -t.x, -t.y, -t.z };
+			return out;
+		}
+
+		// 平移减去 origin 后转成 float。origin 取在相机附近时，附近物体的平移很小，float 足够精确
+		DirectX::XMMATRIX toMatrix(const Double3& origin = {}) const {
+			return DirectX::XMMATRIX{
+				(float)linear[0][0], (float)linear[0][1], (float)linear[0][2], 0,
+				(float)linear[1][0], (float)linear[1][1], (float)linear[1][2], 0,
+				(float)linear[2][0], (float)linear[2][1], (float)linear[2][2], 0,
+				(float)(translation.x - origin.x), (float)(translation.y - origin.y), (float)(translation.z - origin.z), 1
+			};
+		}
+	};
+
+}
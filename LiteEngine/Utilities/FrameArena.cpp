@@ -0,0 +1,75 @@
+#include "FrameArena.h"
+#include "Utilities.h"
+
+#include <algorithm>
+
+namespace LiteEngine {
+
+	FrameArena::FrameArena(size_t initialBytes) {
+		addBlock(initialBytes);
+		blockAllocationsAtFrameBegin = statistics.blockAllocations;
+		currentBlock = 0;
+	}
+
+	void FrameArena::addBlock(size_t minimumBytes) {
+		// 新块至少是上一块的两倍，减少一帧内的申请次数
+		size_t size = std::max(minimumBytes, DEFAULT_BLOCK_BYTES);
+		if (!blocks.empty()) size = std::max(size, blocks.back().size * 2);
+
+		blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[size]), size });
+		statistics.capacityBytes += size;
+		statistics.blockAllocations++;
+	}
+
+	void* FrameArena::allocate(size_t bytes, size_t alignment) {
+		if (bytes == 0) bytes = 1;
+
+		while (true) {
+			auto& block = blocks[currentBlock];
+			auto base = reinterpret_cast<uintptr_t>(block.memory.get());
+			auto aligned = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			auto begin = (size_t)(aligned - base);
+			if (begin + bytes <= block.size) {
+				usedBytes += begin + bytes - offset;
+				offset = begin + bytes;
+				liveAllocations++;
+				return block.memory.get() + begin;
+			}
+
+			// 当前块剩余的部分算作浪费
+			usedBytes += block.size - offset;
+			if (currentBlock + 1 == blocks.size()) {
+				addBlock(bytes + alignment);
+			}
+			currentBlock++;
+			offset = 0;
+		}
+	}
+
+	void FrameArena::reset() {
+		if (liveAllocations > 0) {
+			statistics.leakedAllocations += liveAllocations;
+			log(LogLevel::WARNING, "FrameArena: " + std::to_string(liveAllocations) + " allocations outlived the frame\n");
+			liveAllocations = 0;
+		}
+
+		statistics.frames++;
+		statistics.lastFrameBytes = usedBytes;
+		statistics.peakFrameBytes = std::max(statistics.peakFrameBytes, usedBytes);
+		statistics.lastFrameBlockAllocations = statistics.blockAllocations - blockAllocationsAtFrameBegin;
+
+		// 这一帧用到了多个块：换成一个能放下整帧的块，下一帧就不需要再申请
+		if (blocks.size() > 1) {
+			size_t total = statistics.capacityBytes;
+			blocks.clear();
+			statistics.capacityBytes = 0;
+			addBlock(total);
+		}
+
+		blockAllocationsAtFrameBegin = statistics.blockAllocations;
+		currentBlock = 0;
+		offset = 0;
+		usedBytes = 0;
+	}
+
+}
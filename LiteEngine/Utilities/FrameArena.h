@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace LiteEngine {
+
+	// 每帧重置的线性分配器：分配只移动指针，释放什么都不做，reset 时整体回收
+	// 一帧用完当前块时才向堆申请新块；reset 时把多个块合并成一个足够大的块，所以稳定之后每帧不再访问堆
+	// 不是线程安全的，只在渲染线程使用
+	class FrameArena {
+	public:
+		static constexpr size_t DEFAULT_BLOCK_BYTES = 64u << 10;
+
+		struct Statistics {
+			size_t capacityBytes = 0;		// 当前所有块的总大小
+			size_t lastFrameBytes = 0;		// 上一帧（两次 reset 之间）用掉的字节数
+			size_t peakFrameBytes = 0;
+			uint64_t frames = 0;
+			uint64_t blockAllocations = 0;	// 累计向堆申请块的次数，稳定之后不应增长
+			uint64_t lastFrameBlockAllocations = 0;
+			uint64_t leakedAllocations = 0;	// reset 时仍未释放的分配（对象活过了一帧），累计
+		};
+
+	protected:
+		struct Block {
+			std::unique_ptr<uint8_t[]> memory;
+			size_t size;
+		};
+
+		std::vector<Block> blocks;
+		size_t currentBlock = 0;
+		size_t offset = 0;
+		size_t usedBytes = 0;		// 本帧，包括对齐和块末尾浪费的部分
+
+		size_t liveAllocations = 0;
+		uint64_t blockAllocationsAtFrameBegin = 0;
+		Statistics statistics;
+
+		void addBlock(size_t minimumBytes);
+
+	public:
+		explicit FrameArena(size_t initialBytes = DEFAULT_BLOCK_BYTES);
+
+		FrameArena(const FrameArena&) = delete;
+		void operator=(const FrameArena&) = delete;
+
+		void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+		// 只用于统计。内存在 reset 时才真正回收
+		void deallocate(void* pointer, size_t bytes) {
+			if (pointer && liveAllocations > 0) liveAllocations--;
+		}
+
+		// 之前分配的内存全部失效。仍然存活的对象记入 leakedAllocations
+		void reset();
+
+		Statistics getStatistics() const {
+			return statistics;
+		}
+	};
+
+	// 从 FrameArena 分配内存的 STL allocator
+	template <typename T>
+	class FrameAllocator {
+		template <typename U> friend class FrameAllocator;
+
+		FrameArena* arena;
+
+	public:
+		using value_type = T;
+
+		explicit FrameAllocator(FrameArena& arena) noexcept : arena(&arena) {}
+
+		template <typename U>
+		FrameAllocator(const FrameAllocator<U>& other) noexcept : arena(other.arena) {}
+
+		T* allocate(size_t count) {
+			return static_cast<T*>(arena->allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		void deallocate(T* pointer, size_t count) noexcept {
+			arena->deallocate(pointer, sizeof(T) * count);
+		}
+
+		FrameArena& getArena() const {
+			return *arena;
+		}
+
+		template <typename U>
+		bool operator==(const FrameAllocator<U>& other) const noexcept {
+			return arena == other.arena;
+		}
+
+		template <typename U>
+		bool operator!=(const FrameAllocator<U>& other) const noexcept {
+			return arena != other.arena;
+		}
+	};
+
+	template <typename T>
+	using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+	// 对象和控制块都在 arena 中。必须在下次 reset 之前释放
+	template <typename T, typename... Args>
+	std::shared_ptr<T> makeFrameShared(FrameArena& arena, Args&&... args) {
+		return std::allocate_shared<T>(FrameAllocator<T>(arena), std::forward<Args>(args)...);
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace LiteEngine {
+
+	// 用于内容寻址（去重、缓存）的 64 位哈希。不是加密哈希
+	// 每次处理 8 字节，比逐字节的 FNV-1a 快很多
+	inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+		constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+		auto bytes = static_cast<const uint8_t*>(data);
+
+		uint64_t h = seed ^ (size * PRIME);
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			memcpy(&word, bytes + i, 8);
+			word *= PRIME;
+			word ^= word >> 32;
+			h = (h ^ word) * PRIME;
+			h ^= h >> 29;
+		}
+
+		uint64_t tail = 0;
+		for (size_t shift = 0; i < size; i++, shift += 8) {
+			tail |= (uint64_t)bytes[i] << shift;
+		}
+		h = (h ^ (tail * PRIME)) * PRIME;
+
+		// finalizer (splitmix64)
+		h ^= h >> 30;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 27;
+		h *= 0x94D049BB133111EBull;
+		h ^= h >> 31;
+		return h;
+	}
+
+	inline uint64_t hashCombine(uint64_t lhs, uint64_t rhs) {
+		return hashBytes(&rhs, sizeof(rhs), lhs);
+	}
+
+	inline std::string hashToString(uint64_t hash) {
+		static const char digits[] = "0123456789abcdef";
+		std::string out(16, '0');
+		for (int i = 15; i >= 0; i--) {
+			out[i] = digits[hash & 0xF];
+			hash >>= 4;
+		}
+		return out;
+	}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace LiteEngine {
+
+	template <typename Signature, size_t Capacity = 64>
+	class InlineFunction;
+
+	// 类似 std::function，但闭包总是放在对象内部的固定大小缓冲区中，永远不会分配堆内存
+	// 闭包放不下时编译失败，而不是退回到堆上。要求闭包可复制（与 std::function 一致）
+	// 缓冲区按 16 字节对齐，可以直接按值捕获 DirectX::XMMATRIX
+	template <typename R, typename... Args, size_t Capacity>
+	class InlineFunction<R(Args...), Capacity> {
+		static constexpr size_t ALIGNMENT = 16;
+
+		enum class Operation { COPY, MOVE, DESTROY };
+
+		alignas(ALIGNMENT) unsigned char storage[Capacity];
+		R(*invoker)(void*, Args&&...) = nullptr;
+		void(*manager)(Operation, void*, void*) = nullptr;
+
+		template <typename F>
+		static R invoke(void* closure, Args&&... args) {
+			return (*static_cast<F*>(closure))(std::forward<Args>(args)...);
+		}
+
+		template <typename F>
+		static void manage(Operation operation, void* destination, void* source) {
+			switch (operation) {
+			case Operation::COPY:
+				new (destination) F(*static_cast<const F*>(source));
+				break;
+			case Operation::MOVE:
+				new (destination) F(std::move(*static_cast<F*>(source)));
+				break;
+			case Operation::DESTROY:
+				static_cast<F*>(destination)->~F();
+				break;
+			}
+		}
+
+		void copyFrom(const InlineFunction& other) {
+			if (other.manager) other.manager(Operation::COPY, storage, const_cast<unsigned char*>(other.storage));
+			invoker = other.invoker;
+			manager = other.manager;
+		}
+
+		void moveFrom(InlineFunction& other) {
+			if (other.manager) other.manager(Operation::MOVE, storage, other.storage);
+			invoker = other.invoker;
+			manager = other.manager;
+			other.reset();
+		}
+
+	public:
+		InlineFunction() = default;
+		InlineFunction(std::nullptr_t) {}
+
+		template <
+			typename Func,
+			typename F = std::decay_t<Func>,
+			typename = std::enable_if_t<!std::is_same_v<F, InlineFunction> && std::is_invocable_r_v<R, F&, Args...>>
+		>
+		InlineFunction(Func&& func) {
+			static_assert(sizeof(F) <= Capacity, "closure is too large for InlineFunction, increase Capacity or capture less");
+			static_assert(alignof(F) <= ALIGNMENT, "closure alignment is not supported by InlineFunction");
+			static_assert(std::is_copy_constructible_v<F>, "closure must be copy constructible");
+
+			new (storage) F(std::forward<Func>(func));
+			invoker = &invoke<F>;
+			manager = &manage<F>;
+		}
+
+		InlineFunction(const InlineFunction& other) {
+			copyFrom(other);
+		}
+
+		InlineFunction(InlineFunction&& other) noexcept {
+			moveFrom(other);
+		}
+
+		InlineFunction& operator=(const InlineFunction& other) {
+			if (this != &other) {
+				reset();
+				copyFrom(other);
+			}
+			return *this;
+		}
+
+		InlineFunction& operator=(InlineFunction&& other) noexcept {
+			if (this != &other) {
+				reset();
+				moveFrom(other);
+			}
+			return *this;
+		}
+
+		InlineFunction& operator=(std::nullptr_t) {
+			reset();
+			return *this;
+		}
+
+		~InlineFunction() {
+			reset();
+		}
+
+		void reset() {
+			if (manager) manager(Operation::DESTROY, storage, nullptr);
+			invoker = nullptr;
+			manager = nullptr;
+		}
+
+		explicit operator bool() const {
+			return invoker != nullptr;
+		}
+
+		R operator()(Args... args) const {
+			// 与 std::function 一样，const 调用时闭包本身可以被修改
+			return invoker(const_cast<unsigned char*>(storage), std::forward<Args>(args)...);
+		}
+	};
+
+}
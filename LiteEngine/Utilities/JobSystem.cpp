@@ -0,0 +1,261 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace LiteEngine {
+
+	namespace {
+		// 当前线程所属的线程池和编号
+		struct WorkerIdentity {
+			const JobSystem* system = nullptr;
+			uint32_t index = UINT32_MAX;
+		};
+		thread_local WorkerIdentity currentWorker;
+
+		// 找不到 job 时先让出若干次时间片再睡眠，避免细粒度任务之间频繁睡眠 / 唤醒
+		constexpr uint32_t SPIN_COUNT_BEFORE_SLEEP = 64;
+	}
+
+	void JobCounter::finish() {
+		if (pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+		std::vector<std::function<void()>> ready;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			ready.swap(continuations);
+		}
+		for (auto& continuation : ready) {
+			continuation();
+		}
+	}
+
+	void JobCounter::then(std::function<void()> continuation) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (!isDone()) {
+				continuations.push_back(std::move(continuation));
+				return;
+			}
+		}
+		continuation();
+	}
+
+	JobSystem::JobSystem(uint32_t numberOfWorkers) {
+		for (uint32_t i = 0; i < numberOfWorkers; i++) {
+			localQueues.emplace_back(new WorkerQueue());
+		}
+		for (uint32_t i = 0; i < numberOfWorkers; i++) {
+			workers.emplace_back([this, i]() { this->workerLoop(i); });
+		}
+	}
+
+	JobSystem::~JobSystem() {
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			shouldExit = true;
+		}
+		sleepCondition.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	JobSystem& JobSystem::getInstance() {
+		// 留一个核给渲染线程。hardware_concurrency 可能返回 0（无法确定），此时也至少有一个工作线程
+		static JobSystem jobSystem(std::max(1u, std::max(1u, std::thread::hardware_concurrency()) - 1));
+		return jobSystem;
+	}
+
+	uint32_t JobSystem::getCurrentWorkerIndex() const {
+		return currentWorker.system == this ? currentWorker.index : UINT32_MAX;
+	}
+
+	void JobSystem::pushJob(Job job, JobPriority priority) {
+		// 工作线程产生的 job 放在自己的队列里，其他线程的放在全局队列里
+		auto index = getCurrentWorkerIndex();
+		auto& queue = index == UINT32_MAX ? globalQueue : *localQueues[index];
+		{
+			std::lock_guard<std::mutex> guard(queue.lock);
+			queue.jobs[(uint32_t)priority].push_back(std::move(job));
+		}
+
+		// 先增加 queuedJobs 再检查 sleepingWorkers，与 workerLoop 中的顺序相反，保证不会漏掉唤醒
+		queuedJobs.fetch_add(1);
+		if (sleepingWorkers.load() > 0) {
+			std::lock_guard<std::mutex> guard(sleepLock);
+			sleepCondition.notify_one();
+		}
+	}
+
+	bool JobSystem::tryPopJob(Job& job) {
+		if (queuedJobs.load(std::memory_order_relaxed) <= 0) return false;
+
+		auto self = getCurrentWorkerIndex();
+		auto numberOfQueues = (uint32_t)localQueues.size();
+
+		auto popFrom = [&](WorkerQueue& queue, uint32_t priority, bool back) {
+			std::lock_guard<std::mutex> guard(queue.lock);
+			auto& jobs = queue.jobs[priority];
+			if (jobs.empty()) return false;
+			if (back) {
+				job = std::move(jobs.back());
+				jobs.pop_back();
+			} else {
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			return true;
+		};
+
+		for (uint32_t priority = 0; priority < NUMBER_OF_JOB_PRIORITIES; priority++) {
+			if (self != UINT32_MAX && popFrom(*localQueues[self], priority, true)) {
+				queuedJobs.fetch_sub(1);
+				return true;
+			}
+			if (popFrom(globalQueue, priority, false)) {
+				queuedJobs.fetch_sub(1);
+				return true;
+			}
+			// 从下一个线程开始偷，避免所有线程都先去偷第 0 个
+			uint32_t start = self == UINT32_MAX ? 0 : self + 1;
+			for (uint32_t i = 0; i < numberOfQueues; i++) {
+				uint32_t victim = (start + i) % numberOfQueues;
+				if (victim == self) continue;
+				if (popFrom(*localQueues[victim], priority, false)) {
+					queuedJobs.fetch_sub(1);
+					stolenJobs.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	JobSystem::Job JobSystem::wrapJob(Job job, const PtrJobCounter& counter) {
+		if (!counter) {
+			return [this, job = std::move(job)]() {
+				try {
+					job();
+				} catch (...) {
+					std::lock_guard<std::mutex> guard(unobservedLock);
+					if (!unobservedException) unobservedException = std::current_exception();
+				}
+			};
+		}
+		return [job = std::move(job), counter]() {
+			try {
+				job();
+			} catch (...) {
+				std::lock_guard<std::mutex> guard(counter->lock);
+				if (!counter->exception) counter->exception = std::current_exception();
+			}
+			counter->finish();
+		};
+	}
+
+	void JobSystem::run(Job job, const PtrJobCounter& counter, JobPriority priority) {
+		if (counter) counter->add();
+		pushJob(wrapJob(std::move(job), counter), priority);
+	}
+
+	void JobSystem::runAfter(
+		const std::vector<PtrJobCounter>& dependencies,
+		Job job,
+		const PtrJobCounter& counter,
+		JobPriority priority
+	) {
+		if (counter) counter->add();
+
+		struct Deferred {
+			std::atomic<uint32_t> remaining;
+			Job job;
+		};
+		// 每个依赖一份，再加上这里的一份，保证所有依赖都登记完之前不会提前放入队列
+		auto deferred = std::make_shared<Deferred>();
+		deferred->remaining = (uint32_t)dependencies.size() + 1;
+		deferred->job = wrapJob(std::move(job), counter);
+
+		auto release = [this, deferred, priority]() {
+			if (deferred->remaining.fetch_sub(1) == 1) {
+				pushJob(std::move(deferred->job), priority);
+			}
+		};
+		for (auto& dependency : dependencies) {
+			if (dependency) dependency->then(release);
+			else release();
+		}
+		release();
+	}
+
+	bool JobSystem::runPendingJob() {
+		Job job;
+		if (!tryPopJob(job)) return false;
+		job();
+		executedJobs.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void JobSystem::wait(const PtrJobCounter& counter, bool rethrow) {
+		if (!counter) return;
+		while (!counter->isDone()) {
+			if (!runPendingJob()) {
+				std::this_thread::yield();
+			}
+		}
+		if (!rethrow) return;
+
+		std::exception_ptr exception;
+		{
+			std::lock_guard<std::mutex> guard(counter->lock);
+			std::swap(exception, counter->exception);
+		}
+		if (!exception) {
+			std::lock_guard<std::mutex> guard(unobservedLock);
+			std::swap(exception, unobservedException);
+		}
+		if (exception) std::rethrow_exception(exception);
+	}
+
+	void JobSystem::workerLoop(uint32_t workerIndex) {
+		currentWorker.system = this;
+		currentWorker.index = workerIndex;
+
+		uint32_t idle = 0;
+		while (true) {
+			if (runPendingJob()) {
+				idle = 0;
+				continue;
+			}
+			if (++idle < SPIN_COUNT_BEFORE_SLEEP) {
+				std::this_thread::yield();
+				continue;
+			}
+			idle = 0;
+
+			sleepingWorkers.fetch_add(1);
+			{
+				std::unique_lock<std::mutex> guard(sleepLock);
+				if (queuedJobs.load() <= 0 && !shouldExit) {
+					workerSleeps.fetch_add(1, std::memory_order_relaxed);
+					sleepCondition.wait(guard, [this]() {
+						return shouldExit || queuedJobs.load() > 0;
+					});
+				}
+				if (shouldExit && queuedJobs.load() <= 0) {
+					sleepingWorkers.fetch_sub(1);
+					return;
+				}
+			}
+			sleepingWorkers.fetch_sub(1);
+		}
+	}
+
+	JobSystem::Statistics JobSystem::getStatistics() const {
+		Statistics out;
+		out.executed = executedJobs.load();
+		out.stolen = stolenJobs.load();
+		out.sleeps = workerSleeps.load();
+		return out;
+	}
+
+}
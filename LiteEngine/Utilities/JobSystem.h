@@ -0,0 +1,227 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <type_traits>
+#include <algorithm>
+#include <string>
+
+namespace LiteEngine {
+
+	// 数值越小越先执行
+	enum class JobPriority : uint32_t {
+		HIGH = 0,
+		NORMAL = 1,
+		LOW = 2
+	};
+
+	constexpr uint32_t NUMBER_OF_JOB_PRIORITIES = 3;
+
+	// 一组 job 的完成计数，用来等待或者作为其他 job 的依赖
+	// 提交时 +1，执行完 -1；归零时把依赖它的 job 放入队列
+	// 计数归零后可以继续提交新的 job 重复使用
+	class JobCounter {
+		friend class JobSystem;
+
+		std::atomic<uint32_t> pending{ 0 };
+		std::mutex lock;
+		std::vector<std::function<void()>> continuations;
+		std::exception_ptr exception;
+
+		void add() {
+			pending.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void finish();
+
+		// 已经归零时立即调用 continuation
+		void then(std::function<void()> continuation);
+
+	public:
+		bool isDone() const {
+			return pending.load(std::memory_order_acquire) == 0;
+		}
+	};
+
+	using PtrJobCounter = std::shared_ptr<JobCounter>;
+
+	// 全局的工作线程池，work stealing
+	// 每个工作线程有自己的双端队列：自己从尾部取（后进先出，缓存友好），其他线程从头部偷（先进先出，偷到的通常是大块的任务）
+	// 非工作线程提交的 job 放在全局队列中。优先级高的 job 总是先于优先级低的 job 被取出
+	// 这里的 job 不要直接调用 D3D11 的 immediate context，GPU 相关的工作应当交回渲染线程
+	class JobSystem {
+	public:
+		using Job = std::function<void()>;
+
+		struct Statistics {
+			uint64_t executed = 0;
+			uint64_t stolen = 0;		// 从其他工作线程的队列中偷到的
+			uint64_t sleeps = 0;		// 工作线程找不到 job 进入睡眠的次数
+		};
+
+	protected:
+		struct alignas(64) WorkerQueue {
+			std::mutex lock;
+			std::deque<Job> jobs[NUMBER_OF_JOB_PRIORITIES];
+		};
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<WorkerQueue>> localQueues;
+		WorkerQueue globalQueue;
+
+		// 队列中（所有队列）的 job 总数，工作线程据此决定是否睡眠
+		std::atomic<int64_t> queuedJobs{ 0 };
+		std::mutex sleepLock;
+		std::condition_variable sleepCondition;
+		std::atomic<uint32_t> sleepingWorkers{ 0 };
+		bool shouldExit = false;
+
+		std::atomic<uint64_t> executedJobs{ 0 };
+		std::atomic<uint64_t> stolenJobs{ 0 };
+		std::atomic<uint64_t> workerSleeps{ 0 };
+
+		void workerLoop(uint32_t workerIndex);
+
+		// 当前线程是本线程池的第几个工作线程，不是的话返回 UINT32_MAX
+		uint32_t getCurrentWorkerIndex() const;
+
+		// 取出一个待执行的 job。没有的话返回 false
+		bool tryPopJob(Job& job);
+
+		void pushJob(Job job, JobPriority priority);
+
+		// 没有 counter 的 job 抛出的第一个异常，之后的 wait(counter) 重新抛出
+		std::mutex unobservedLock;
+		std::exception_ptr unobservedException;
+
+		// 执行完成后减少 counter，并记录异常（没有 counter 时记录在 unobservedException）
+		Job wrapJob(Job job, const PtrJobCounter& counter);
+
+	public:
+		// 一般使用 getInstance()。单独创建主要用于测试不同的线程数
+		explicit JobSystem(uint32_t numberOfWorkers);
+
+		JobSystem(const JobSystem&) = delete;
+		void operator=(const JobSystem&) = delete;
+
+		~JobSystem();
+
+		static JobSystem& getInstance();
+
+		uint32_t getNumberOfWorkers() const {
+			return (uint32_t)workers.size();
+		}
+
+		template <typename Func>
+		std::future<std::invoke_result_t<std::decay_t<Func>>> submit(
+			Func&& func,
+			JobPriority priority = JobPriority::NORMAL
+		) {
+			using ResultType = std::invoke_result_t<std::decay_t<Func>>;
+			// std::function 要求可复制，所以 packaged_task 只能放在 shared_ptr 里
+			auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+			auto future = task->get_future();
+			pushJob([task]() { (*task)(); }, priority);
+			return future;
+		}
+
+		PtrJobCounter createCounter() const {
+			return std::make_shared<JobCounter>();
+		}
+
+		// 比 submit 开销小：没有 future。完成情况通过 counter 获知，counter 可以为空
+		// job 抛出的第一个异常保存在 counter 中，wait(counter) 时重新抛出
+		// 没有 counter 时保存在线程池中，由之后任意一次 wait(counter)（包括 parallelFor 的结束）重新抛出，不会被静默丢弃
+		void run(Job job, const PtrJobCounter& counter = nullptr, JobPriority priority = JobPriority::NORMAL);
+
+		// 所有 dependencies 归零之后才放入队列。counter 立即 +1，所以等待 counter 时也会等待这个 job
+		void runAfter(
+			const std::vector<PtrJobCounter>& dependencies,
+			Job job,
+			const PtrJobCounter& counter = nullptr,
+			JobPriority priority = JobPriority::NORMAL
+		);
+
+		// 把 [begin, end) 按 grainSize 切分，func(rangeBegin, rangeEnd) 在多个线程上执行，返回时全部完成
+		// 调用线程也参与执行。grainSize 为 0 时按线程数自动切分
+		template <typename Func>
+		void parallelFor(
+			uint32_t begin,
+			uint32_t end,
+			uint32_t grainSize,
+			Func&& func,
+			JobPriority priority = JobPriority::NORMAL
+		) {
+			if (begin >= end) return;
+			uint32_t count = end - begin;
+			if (grainSize == 0) {
+				// 每个线程大约 4 块，便于负载均衡
+				uint32_t chunks = (getNumberOfWorkers() + 1) * 4;
+				grainSize = std::max(1u, (count + chunks - 1) / chunks);
+			}
+			if (count <= grainSize) {
+				func(begin, end);
+				return;
+			}
+
+			auto counter = createCounter();
+			// 第一块留给调用线程
+			for (uint64_t chunk = (uint64_t)begin + grainSize; chunk < end; chunk += grainSize) {
+				uint32_t chunkBegin = (uint32_t)chunk;
+				uint32_t chunkEnd = chunkBegin + std::min(grainSize, end - chunkBegin);
+				run([&func, chunkBegin, chunkEnd]() { func(chunkBegin, chunkEnd); }, counter, priority);
+			}
+			try {
+				func(begin, begin + grainSize);
+			} catch (...) {
+				// 其他块仍引用 func，必须等它们结束
+				wait(counter, false);
+				throw;
+			}
+			wait(counter);
+		}
+
+		// 执行一个排队中的 job（如果有）。返回是否执行了
+		bool runPendingJob();
+
+		// 等待 counter 归零。等待期间当前线程会帮忙执行其他 job
+		// rethrow: 是否重新抛出 job 中的异常。counter 自己的异常优先，没有时抛出没有 counter 的 job 留下的异常
+		void wait(const PtrJobCounter& counter, bool rethrow = true);
+
+		// 等待 future 就绪。等待期间当前线程会帮忙执行其他 job，
+		// 所以在 job 内部等待子 job 不会把线程池卡死
+		template <typename T>
+		void wait(const std::future<T>& future) {
+			while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				if (!runPendingJob()) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		template <typename T>
+		void wait(const std::shared_future<T>& future) {
+			while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				if (!runPendingJob()) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		Statistics getStatistics() const;
+	};
+
+	// 分别用 1..maxThreads 个线程（调用线程 + 工作线程）测量：空 job 的提交 + 执行开销、job 内部提交子 job 的开销、
+	// parallelFor 每块的开销、计算密集型 parallelFor 的加速比、依赖链的延迟。maxThreads 为 0 时使用 hardware_concurrency
+	// 不依赖 D3D，可以在任何平台上运行
+	std::string runJobSystemBenchmark(uint32_t maxThreads = 0);
+
+}
@@ -0,0 +1,158 @@
+#include "JobSystem.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace LiteEngine {
+
+	namespace {
+
+		double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		}
+
+		// 不会被优化掉的计算量
+		float busyWork(uint32_t seed, uint32_t iterations) {
+			float x = (float)(seed & 1023) * 0.001f;
+			for (uint32_t i = 0; i < iterations; i++) {
+				x = std::sqrt(x * x + 1.0f) * 0.5f + std::sin(x) * 0.25f;
+			}
+			return x;
+		}
+
+		struct BenchmarkResult {
+			uint32_t threads = 0;
+			double emptyJobNanoseconds = 0;			// 非工作线程提交 + 执行一个空 job
+			double nestedJobNanoseconds = 0;		// job 内部提交子 job（走本地队列和偷取）
+			double parallelForChunkNanoseconds = 0;	// 空 parallelFor 每块的开销
+			double computeMilliseconds = 0;			// 计算密集型 parallelFor
+			double dependencyNanoseconds = 0;		// 依赖链上每个 job 的延迟
+		};
+
+		BenchmarkResult runOnce(uint32_t threads) {
+			// 调用线程也执行 job，所以工作线程数少一个
+			JobSystem jobs(threads - 1);
+			BenchmarkResult result;
+			result.threads = threads;
+
+			{
+				constexpr uint32_t COUNT = 200000;
+				std::atomic<uint32_t> sum{ 0 };
+				auto counter = jobs.createCounter();
+				auto begin = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < COUNT; i++) {
+					jobs.run([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); }, counter);
+				}
+				jobs.wait(counter);
+				result.emptyJobNanoseconds = millisecondsSince(begin) * 1e6 / COUNT;
+			}
+
+			{
+				constexpr uint32_t OUTER = 500;
+				constexpr uint32_t INNER = 400;
+				std::atomic<uint32_t> sum{ 0 };
+				auto counter = jobs.createCounter();
+				auto begin = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < OUTER; i++) {
+					jobs.run([&jobs, &sum, counter]() {
+						for (uint32_t j = 0; j < INNER; j++) {
+							jobs.run([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); }, counter);
+						}
+					}, counter);
+				}
+				jobs.wait(counter);
+				result.nestedJobNanoseconds = millisecondsSince(begin) * 1e6 / (OUTER * (INNER + 1));
+			}
+
+			{
+				constexpr uint32_t COUNT = 1 << 22;
+				constexpr uint32_t GRAIN = 256;
+				constexpr uint32_t REPEAT = 4;
+				std::vector<uint32_t> data(COUNT);
+				auto begin = std::chrono::steady_clock::now();
+				for (uint32_t r = 0; r < REPEAT; r++) {
+					jobs.parallelFor(0, COUNT, GRAIN, [&data](uint32_t b, uint32_t e) {
+						data[b] = e;
+					});
+				}
+				result.parallelForChunkNanoseconds = millisecondsSince(begin) * 1e6 / (REPEAT * (COUNT / GRAIN));
+			}
+
+			{
+				constexpr uint32_t COUNT = 1 << 16;
+				std::vector<float> data(COUNT);
+				auto begin = std::chrono::steady_clock::now();
+				jobs.parallelFor(0, COUNT, 64, [&data](uint32_t b, uint32_t e) {
+					for (uint32_t i = b; i < e; i++) data[i] = busyWork(i, 200);
+				});
+				result.computeMilliseconds = millisecondsSince(begin);
+			}
+
+			{
+				constexpr uint32_t LENGTH = 20000;
+				std::vector<uint32_t> order;
+				order.reserve(LENGTH);
+				auto begin = std::chrono::steady_clock::now();
+				auto previous = jobs.createCounter();
+				jobs.run([&order]() { order.push_back(0); }, previous);
+				for (uint32_t i = 1; i < LENGTH; i++) {
+					auto next = jobs.createCounter();
+					jobs.runAfter({ previous }, [&order, i]() { order.push_back(i); }, next);
+					previous = next;
+				}
+				jobs.wait(previous);
+				result.dependencyNanoseconds = millisecondsSince(begin) * 1e6 / LENGTH;
+				for (uint32_t i = 0; i < LENGTH; i++) {
+					if (order[i] != i) throw std::runtime_error("dependency order violated");
+				}
+			}
+
+			return result;
+		}
+
+		// 没有 counter 的 job 抛出的异常由下一次 parallelFor 的结束重新抛出，而且只抛出一次
+		// 没有工作线程，job 只在调用线程上执行，结果是确定的
+		void checkUnobservedException() {
+			JobSystem jobs(0);
+			jobs.run([]() { throw std::runtime_error("unobserved"); });
+			while (jobs.runPendingJob()) {}
+
+			bool rethrown = false;
+			try {
+				jobs.parallelFor(0, 4, 1, [](uint32_t, uint32_t) {});
+			} catch (const std::runtime_error& e) {
+				rethrown = std::string(e.what()) == "unobserved";
+			}
+			if (!rethrown) throw std::runtime_error("exception of a job without counter was dropped");
+			jobs.parallelFor(0, 4, 1, [](uint32_t, uint32_t) {});
+		}
+	}
+
+	std::string runJobSystemBenchmark(uint32_t maxThreads) {
+		if (maxThreads == 0) maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		checkUnobservedException();
+
+		std::ostringstream out;
+		char line[256];
+		snprintf(line, sizeof(line), "%-8s %12s %12s %14s %12s %8s %12s\n",
+			"threads", "job ns", "nested ns", "pfor chunk ns", "compute ms", "speedup", "depend ns");
+		out << line;
+
+		double baseline = 0;
+		for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+			auto result = runOnce(threads);
+			if (threads == 1) baseline = result.computeMilliseconds;
+			snprintf(line, sizeof(line), "%-8u %12.1f %12.1f %14.1f %12.2f %7.2fx %12.1f\n",
+				result.threads, result.emptyJobNanoseconds, result.nestedJobNanoseconds,
+				result.parallelForChunkNanoseconds, result.computeMilliseconds,
+				baseline / result.computeMilliseconds, result.dependencyNanoseconds);
+			out << line;
+		}
+		return out.str();
+	}
+
+}
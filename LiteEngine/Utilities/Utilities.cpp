@@ -1,5 +1,5 @@
-// C++ δṩ·ұ֤·ǰƳ codecvt
-// Ҳ Windows ṩ MultiByteToWideChar ת
+// C++ 暂未提供新方案，且保证新方案出来前不会移除 codecvt
+// 也可以用 Windows 提供的 MultiByteToWideChar 函数转换
 #define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING
 
 #include "Utilities.h"
@@ -25,6 +25,7 @@ namespace LiteEngine {
 			readSize = fread_s(buffer.data(), unitLength, 1, unitLength, file);
 			std::copy_n(buffer.begin(), readSize, std::back_insert_iterator<std::vector<uint8_t>>(out));
 		} while (readSize > 0);
+		fclose(file);
 		return out;
 	}
 
@@ -0,0 +1,5 @@
+// SoftwareRenderer::writePNG 使用的 stb_image_write 的实现
+// Windows 上的 LiteEngine 中实现在 IO/DefaultLoaderGLTF.cpp（依赖 D3D 的 loader），CMake 构建不包含它，所以在这里单独编译一份
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "LiteEngine/ThirdParty/tiny_gltf/stb_image_write.h"
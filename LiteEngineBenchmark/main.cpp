@@ -0,0 +1,77 @@
+#include "LiteEngine/Utilities/JobSystem.h"
+
+#ifdef LITE_ENGINE_WITH_DIRECTXMATH
+#include "LiteEngine/Renderer/LightClustering.h"
+#include "LiteEngine/Renderer/OcclusionCulling.h"
+#include "LiteEngine/Renderer/SoftwareRenderer.h"
+#endif
+
+#ifdef LITE_ENGINE_WITH_SCENE
+#include "LiteEngine/Scene/Animation.h"
+#include "LiteEngine/Scene/Scene.h"
+#include "LiteEngine/Scene/Skinning.h"
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+// 不依赖 Windows 和 D3D 的 benchmark，由根目录的 CMakeLists.txt 构建，可以在没有 GPU 的机器上运行
+// 用法：LiteEngineBenchmark <name> [maxThreads]。maxThreads 为 0 或省略时使用 hardware_concurrency
+// software 可以再跟一个 PNG 路径，写出最后一帧
+// 找到 DirectXMath 时（LITE_ENGINE_WITH_DIRECTXMATH）还包括渲染中只在 CPU 上运行的部分
+// 在 Windows 上由 LiteEngineBenchmark.vcxproj 链接完整的 LiteEngine 构建时（LITE_ENGINE_WITH_SCENE）还包括依赖场景的部分
+// benchmark 内部的自检失败时抛出异常，返回值非 0
+
+namespace le = LiteEngine;
+
+#if defined(LITE_ENGINE_WITH_SCENE)
+static const char* BENCHMARK_NAMES = "jobs|clustering|occlusion|software|animation|skinning|precision";
+#elif defined(LITE_ENGINE_WITH_DIRECTXMATH)
+static const char* BENCHMARK_NAMES = "jobs|clustering|occlusion|software";
+#else
+static const char* BENCHMARK_NAMES = "jobs";
+#endif
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s %s [maxThreads] [output.png]\n", argv[0], BENCHMARK_NAMES);
+		return 2;
+	}
+
+	std::string name = argv[1];
+	uint32_t maxThreads = argc > 2 ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 0;
+
+	try {
+		std::string report;
+		if (name == "jobs") {
+			report = le::runJobSystemBenchmark(maxThreads);
+#ifdef LITE_ENGINE_WITH_DIRECTXMATH
+		} else if (name == "clustering") {
+			report = le::Rendering::runLightClusteringBenchmark(maxThreads);
+		} else if (name == "occlusion") {
+			report = le::Rendering::runOcclusionCullingBenchmark(maxThreads);
+		} else if (name == "software") {
+			report = le::Rendering::runSoftwareRendererBenchmark(maxThreads, argc > 3 ? argv[3] : "");
+#endif
+#ifdef LITE_ENGINE_WITH_SCENE
+		} else if (name == "animation") {
+			// 采样是单线程的，不使用 maxThreads
+			report = le::SceneManagement::runAnimationBenchmark();
+		} else if (name == "skinning") {
+			report = le::SceneManagement::runSkinningBenchmark(maxThreads);
+		} else if (name == "precision") {
+			report = le::SceneManagement::runTransformPrecisionBenchmark();
+#endif
+		} else {
+			fprintf(stderr, "unknown benchmark: %s\n", name.c_str());
+			return 2;
+		}
+		fputs(report.c_str(), stdout);
+	} catch (const std::exception& e) {
+		fprintf(stderr, "%s: %s\n", name.c_str(), e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include "UnitTests.h"
+
+#include "LiteEngine/LiteEngine.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// 替换全局的 operator new，统计本线程在计数期间向堆申请内存的次数
+// 不统计 over-aligned 的 new（被测的代码中没有）
+
+namespace {
+
+	thread_local bool countingAllocations = false;
+	thread_local uint64_t allocationCount = 0;
+
+	// 统计 func 执行期间本线程的堆分配次数
+	template <typename Func>
+	uint64_t countAllocations(Func&& func) {
+		allocationCount = 0;
+		countingAllocations = true;
+		func();
+		countingAllocations = false;
+		return allocationCount;
+	}
+
+}
+
+void* operator new(size_t size) {
+	if (countingAllocations) allocationCount++;
+	if (auto pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return ::operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+namespace LiteEngineTest {
+
+	namespace le = LiteEngine;
+	namespace ler = LiteEngine::Rendering;
+	namespace lesm = LiteEngine::SceneManagement;
+
+	namespace {
+
+		constexpr uint32_t GROUPS = 8;
+		constexpr uint32_t MESHES_PER_GROUP = 16;
+		constexpr uint32_t WARMUP_FRAMES = 2;
+		constexpr uint32_t MEASURED_FRAMES = 16;
+
+		// 一个相机、一个光源、GROUPS 个子树，每个子树 MESHES_PER_GROUP 个 mesh
+		// 不需要 GPU 资源：构建 RenderingScene 只读写 MeshObject 的 CPU 端数据
+		void createScene(lesm::Scene& scene) {
+			std::shared_ptr<lesm::Object> root(new lesm::Object("root"));
+
+			std::shared_ptr<lesm::Camera> camera(new lesm::Camera());
+			camera->name = "camera";
+			camera->transT = { 0, 2, -10 };
+			root->children.push_back(camera);
+
+			std::shared_ptr<lesm::Light> light(new lesm::Light("sun"));
+			light->type = ler::LightType::LIGHT_TYPE_DIRECTIONAL;
+			light->shadow = ler::LightShadow::LIGHT_SHADOW_HARD;
+			light->innerConeAngle = light->outerConeAngle = 0;
+			light->direction_L = { 0, -1, 0 };
+			light->intensity = { 1, 1, 1 };
+			root->children.push_back(light);
+
+			for (uint32_t i = 0; i < GROUPS; i++) {
+				std::shared_ptr<lesm::Object> group(new lesm::Object("group" + std::to_string(i)));
+				group->transT = { (double)i, 0, 0 };
+				for (uint32_t j = 0; j < MESHES_PER_GROUP; j++) {
+					std::shared_ptr<lesm::Mesh> mesh(new lesm::Mesh());
+					mesh->transT = { 0, 0, (double)j };
+					mesh->data = std::make_shared<ler::MeshObject>(nullptr, nullptr, nullptr);
+					group->children.push_back(mesh);
+				}
+				root->children.push_back(group);
+			}
+
+			scene.rootObject = root;
+			scene.activeCamera = camera;
+			scene.link();
+		}
+
+		void testRenderingSceneIsReused() {
+			lesm::Scene scene;
+			createScene(scene);
+
+			for (uint32_t i = 0; i < WARMUP_FRAMES; i++) scene.getRenderingScene();
+
+			uint64_t objects = 0;
+			auto allocations = countAllocations([&]() {
+				for (uint32_t i = 0; i < MEASURED_FRAMES; i++) {
+					auto renderingScene = scene.getRenderingScene();
+					objects += renderingScene->meshObjects.size() + renderingScene->lights.size();
+				}
+			});
+			LITE_ENGINE_TEST_CHECK(allocations == 0);
+			LITE_ENGINE_TEST_CHECK(objects == (uint64_t)MEASURED_FRAMES * (GROUPS * MESHES_PER_GROUP + 1));
+		}
+
+		void testHeldRenderingSceneIsNotModified() {
+			lesm::Scene scene;
+			createScene(scene);
+
+			auto held = scene.getRenderingScene();
+
+			// 移动相机后重新构建：held 仍被持有，不能被原地重建
+			scene.activeCamera->transT = { 100, 0, 0 };
+			auto next = scene.getRenderingScene();
+			LITE_ENGINE_TEST_CHECK(next != held);
+			LITE_ENGINE_TEST_CHECK(held->meshObjects.size() == GROUPS * MESHES_PER_GROUP);
+			LITE_ENGINE_TEST_CHECK(held->lights.size() == 1);
+			LITE_ENGINE_TEST_CHECK(held->origin_W.x == 0);
+			LITE_ENGINE_TEST_CHECK(next->origin_W.x == 100);
+			LITE_ENGINE_TEST_CHECK(next->meshObjects.size() == GROUPS * MESHES_PER_GROUP);
+
+			// 释放之后下一次重用 next
+			auto nextPointer = next.get();
+			held = nullptr;
+			next = nullptr;
+			LITE_ENGINE_TEST_CHECK(scene.getRenderingScene().get() == nextPointer);
+		}
+
+		// 第一帧超出初始块时向堆申请，reset 合并成一个块之后同样的一帧不再申请
+		void testFrameArenaSteadyState() {
+			le::FrameArena arena;
+
+			auto frame = [&arena]() {
+				le::FrameVector<uint32_t> values(le::FrameAllocator<uint32_t>{ arena });
+				for (uint32_t i = 0; i < 100000; i++) values.push_back(i);
+				auto pass = le::makeFrameShared<ler::RenderingPass>(arena);
+				LITE_ENGINE_TEST_CHECK(values.back() == 99999);
+			};
+
+			frame();
+			arena.reset();
+			LITE_ENGINE_TEST_CHECK(arena.getStatistics().lastFrameBlockAllocations > 0);
+
+			for (uint32_t i = 0; i < MEASURED_FRAMES; i++) {
+				auto allocations = countAllocations(frame);
+				arena.reset();
+				LITE_ENGINE_TEST_CHECK(allocations == 0);
+				LITE_ENGINE_TEST_CHECK(arena.getStatistics().lastFrameBlockAllocations == 0);
+			}
+			LITE_ENGINE_TEST_CHECK(arena.getStatistics().leakedAllocations == 0);
+		}
+
+	}
+
+	void checkRendererFrameAllocations(ler::Renderer& renderer, lesm::Scene& scene) {
+		// 与 renderScene 的调用者相同的一帧：阴影 pass、主 pass 都由 Renderer 创建
+		auto renderFrame = [&]() {
+			renderer.beginRendering();
+			auto renderingScene = scene.getRenderingScene();
+			renderer.renderScene(renderingScene);
+		};
+
+		// 第一帧创建 shader、常数缓冲和各个容器
+		renderFrame();
+		for (uint32_t i = 0; i < 2; i++) {
+			LITE_ENGINE_TEST_CHECK(countAllocations(renderFrame) == 0);
+			LITE_ENGINE_TEST_CHECK(renderer.getFrameArena().getStatistics().lastFrameBlockAllocations == 0);
+		}
+		renderer.beginRendering();
+		LITE_ENGINE_TEST_CHECK(renderer.getFrameArena().getStatistics().leakedAllocations == 0);
+	}
+
+	void runFrameAllocationTests() {
+		testRenderingSceneIsReused();
+		testHeldRenderingSceneIsNotModified();
+		testFrameArenaSteadyState();
+	}
+
+}
@@ -0,0 +1,89 @@
+#include "UnitTests.h"
+
+#include "LiteEngine/LiteEngine.h"
+
+#include <cmath>
+
+namespace LiteEngineTest {
+
+	namespace ler = LiteEngine::Rendering;
+	namespace lesm = LiteEngine::SceneManagement;
+
+	namespace {
+
+		// RenderingScene 中光源的位置与逐层用 getLocalToWorldTransform 算出的一致
+		void checkLightPosition(lesm::Scene& scene, const lesm::Light& light) {
+			auto renderingScene = scene.getRenderingScene();
+			LITE_ENGINE_TEST_CHECK(renderingScene->lights.size() == 1);
+
+			auto expected = (light.getLocalToWorldTransform().translation - renderingScene->origin_W).toFloat3();
+			auto& actual = renderingScene->lights[0].position_W;
+			LITE_ENGINE_TEST_CHECK(std::abs(actual.x - expected.x) < 1e-3f);
+			LITE_ENGINE_TEST_CHECK(std::abs(actual.y - expected.y) < 1e-3f);
+			LITE_ENGINE_TEST_CHECK(std::abs(actual.z - expected.z) < 1e-3f);
+		}
+
+		// 被应用程序持有的两层只传递变换的节点保留下来，成为一条缓存的链
+		// 之后修改链上的 TRS、在链中插入节点，RenderingScene 中的结果都与不使用缓存时相同
+		void testPinnedChainIsCached() {
+			std::shared_ptr<lesm::Object> root(new lesm::Object("root"));
+
+			std::shared_ptr<lesm::Camera> camera(new lesm::Camera());
+			camera->transT = { 0, 2, -10 };
+
+			std::shared_ptr<lesm::Object> orbit(new lesm::Object("orbit"));
+			std::shared_ptr<lesm::Object> placement(new lesm::Object("placement"));
+			std::shared_ptr<lesm::Light> light(new lesm::Light("lamp"));
+			light->type = ler::LightType::LIGHT_TYPE_POINT;
+			light->shadow = ler::LightShadow::LIGHT_SHADOW_EMPTY;
+			light->innerConeAngle = light->outerConeAngle = 0;
+			light->direction_L = { 0, -1, 0 };
+			light->intensity = { 1, 1, 1 };
+			light->transT = { 1, 2, 3 };
+
+			root->children.push_back(orbit);
+			orbit->children = { placement };
+			// 相机也在链的下面，浮动原点离光源很近，比较时不受 float 精度的影响
+			placement->children = { light, camera };
+			orbit->transT = { 3.844e8, 0, 0 };
+			orbit->rotateParentCoord(DirectX::XMQuaternionRotationAxis({ 0, 1, 0 }, 0.7f));
+			placement->transT = { 0, 1737.4e3, 0 };
+
+			lesm::Scene scene;
+			scene.rootObject = root;
+			scene.activeCamera = camera;
+			scene.link();
+
+			auto statistics = lesm::flattenHierarchy(scene);
+			LITE_ENGINE_TEST_CHECK(statistics.cachedChains == 1);
+			LITE_ENGINE_TEST_CHECK(statistics.cachedChainNodes == 2);
+			LITE_ENGINE_TEST_CHECK(scene.components.has<lesm::TransformChainCache>(orbit->getHandle()));
+
+			checkLightPosition(scene, *light);
+			// TRS 没有变化，使用缓存的乘积
+			checkLightPosition(scene, *light);
+
+			placement->transT = { 0, 1737.4e3 + 100, 0 };
+			checkLightPosition(scene, *light);
+
+			orbit->rotateParentCoord(DirectX::XMQuaternionRotationAxis({ 0, 1, 0 }, 0.01f));
+			checkLightPosition(scene, *light);
+
+			// 链的结构变化，退回逐个节点遍历
+			placement->insertParent();
+			placement->transT = { 5, 0, 0 };
+			checkLightPosition(scene, *light);
+
+			// 再次压平时重新找链：orbit -> 插入的节点 -> placement
+			statistics = lesm::flattenHierarchy(scene);
+			LITE_ENGINE_TEST_CHECK(statistics.cachedChains == 1);
+			checkLightPosition(scene, *light);
+		}
+
+	}
+
+	void runHierarchyFlatteningTests() {
+		testPinnedChainIsCached();
+	}
+
+}
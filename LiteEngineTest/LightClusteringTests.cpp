@@ -0,0 +1,294 @@
+#include "UnitTests.h"
+
+#include "LiteEngine/Renderer/LightClustering.h"
+#include "LiteEngine/Utilities/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace LiteEngineTest {
+
+	namespace ler = LiteEngine::Rendering;
+
+	namespace {
+
+		constexpr uint32_t TILES_X = 16;
+		constexpr uint32_t TILES_Y = 9;
+		constexpr uint32_t SLICES = 24;
+		constexpr float FIELD_OF_VIEW_Y = 1.0f;
+		constexpr float ASPECT_RATIO = 16.f / 9;
+		constexpr float NEAR_Z = 0.5f;
+		constexpr float FAR_Z = 500;
+
+		// 与边界的相对距离。远大于 float 的 log / 除法误差，又不会跨过一整个 froxel
+		constexpr float EPSILON = 1e-3f;
+
+		struct ClusterCoordinate {
+			uint32_t x, y, z;
+		};
+
+		ClusterCoordinate decodeCluster(const ler::LightClusterGrid& grid, uint32_t index) {
+			return { index % grid.getTilesX(), index / grid.getTilesX() % grid.getTilesY(), index / (grid.getTilesX() * grid.getTilesY()) };
+		}
+
+		bool clusterContains(const ler::LightClusterGrid& grid, uint32_t cluster, uint32_t light) {
+			auto range = grid.getClusters()[cluster];
+			auto begin = grid.getLightIndices().begin() + range.offset;
+			return std::find(begin, begin + range.count, light) != begin + range.count;
+		}
+
+		uint32_t countClustersContaining(const ler::LightClusterGrid& grid, uint32_t light) {
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < grid.getClusterCount(); i++) {
+				if (clusterContains(grid, i, light)) count++;
+			}
+			return count;
+		}
+
+		// 第 slice 个 slice 的近平面，独立于 LightClusterGrid 的实现计算
+		float sliceNearZ(const ler::LightClusterCamera& camera, uint32_t slice) {
+			float t = (float)slice / SLICES;
+			if (camera.perspective) return camera.nearZ * std::pow(camera.farZ / camera.nearZ, t);
+			return camera.nearZ + (camera.farZ - camera.nearZ) * t;
+		}
+
+		// NDC 中第 tile 个 tile 的左（下）边界
+		float tileEdge(uint32_t tile, uint32_t tiles) {
+			return -1 + 2.f * tile / tiles;
+		}
+
+		// NDC 坐标 ndc 在深度 z 处对应的 view space 坐标
+		float ndcToView(const ler::LightClusterCamera& camera, float ndc, float z, float viewScale) {
+			return camera.perspective ? ndc * z / viewScale : ndc / viewScale;
+		}
+
+		bool insideFrustum(const ler::LightClusterCamera& camera, const DirectX::XMFLOAT3& point) {
+			if (point.z < camera.nearZ || point.z > camera.farZ) return false;
+			float x = point.x * camera.viewScaleX, y = point.y * camera.viewScaleY;
+			if (camera.perspective) {
+				x /= point.z;
+				y /= point.z;
+			}
+			return std::abs(x) <= 1 && std::abs(y) <= 1;
+		}
+
+		bool reaches(const ler::ClusterLight& light, const DirectX::XMFLOAT3& point) {
+			float d[3] = { point.x - light.position_V.x, point.y - light.position_V.y, point.z - light.position_V.z };
+			float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			if (distance > light.range) return false;
+			if (!light.spot || distance == 0) return true;
+			float cosine = (d[0] * light.direction_V.x + d[1] * light.direction_V.y + d[2] * light.direction_V.z) / distance;
+			return cosine >= std::cos(light.outerConeAngle);
+		}
+
+		// 光源照到的视锥内的每个采样点，所在的 froxel 都必须包含这个光源（不能漏，多出来的只影响性能）
+		void checkNoMissingLights(const ler::LightClusterGrid& grid, const std::vector<ler::ClusterLight>& lights, uint32_t samplesPerLight) {
+			std::mt19937 random(2024);
+			std::uniform_real_distribution<float> unit(-1, 1);
+			for (uint32_t lightID = 0; lightID < lights.size(); lightID++) {
+				auto& light = lights[lightID];
+				if (std::isinf(light.range)) continue;
+				uint32_t checked = 0;
+				for (uint32_t i = 0; i < samplesPerLight * 8 && checked < samplesPerLight; i++) {
+					DirectX::XMFLOAT3 point{
+						light.position_V.x + unit(random) * light.range,
+						light.position_V.y + unit(random) * light.range,
+						light.position_V.z + unit(random) * light.range
+					};
+					if (!insideFrustum(grid.getCamera(), point) || !reaches(light, point)) continue;
+					checked++;
+					LITE_ENGINE_TEST_CHECK(clusterContains(grid, grid.findCluster(point), lightID));
+				}
+			}
+		}
+
+		// 每个 slice 和 tile 的边界两侧的点落在对应的 froxel 中
+		void checkFroxelBounds(const ler::LightClusterCamera& camera) {
+			ler::LightClusterGrid grid(TILES_X, TILES_Y, SLICES);
+			grid.build(camera, {});
+			LITE_ENGINE_TEST_CHECK(grid.getClusters().size() == TILES_X * TILES_Y * SLICES);
+			LITE_ENGINE_TEST_CHECK(grid.getLightIndices().empty());
+
+			for (uint32_t slice = 0; slice < SLICES; slice++) {
+				float z0 = sliceNearZ(camera, slice), z1 = sliceNearZ(camera, slice + 1);
+				float margin = (z1 - z0) * EPSILON;
+				LITE_ENGINE_TEST_CHECK(decodeCluster(grid, grid.findCluster({ 0, 0, z0 + margin })).z == slice);
+				LITE_ENGINE_TEST_CHECK(decodeCluster(grid, grid.findCluster({ 0, 0, z1 - margin })).z == slice);
+			}
+
+			// 在中间一个 slice 的深度检查 tile 的边界
+			float z = sliceNearZ(camera, SLICES / 2) * (1 + EPSILON);
+			for (uint32_t tile = 0; tile < TILES_X; tile++) {
+				float low = tileEdge(tile, TILES_X) + EPSILON, high = tileEdge(tile + 1, TILES_X) - EPSILON;
+				LITE_ENGINE_TEST_CHECK(decodeCluster(grid, grid.findCluster({ ndcToView(camera, low, z, camera.viewScaleX), 0, z })).x == tile);
+				LITE_ENGINE_TEST_CHECK(decodeCluster(grid, grid.findCluster({ ndcToView(camera, high, z, camera.viewScaleX), 0, z })).x == tile);
+			}
+			for (uint32_t tile = 0; tile < TILES_Y; tile++) {
+				float low = tileEdge(tile, TILES_Y) + EPSILON, high = tileEdge(tile + 1, TILES_Y) - EPSILON;
+				LITE_ENGINE_TEST_CHECK(decodeCluster(grid, grid.findCluster({ 0, ndcToView(camera, low, z, camera.viewScaleY), z })).y == tile);
+				LITE_ENGINE_TEST_CHECK(decodeCluster(grid, grid.findCluster({ 0, ndcToView(camera, high, z, camera.viewScaleY), z })).y == tile);
+			}
+
+			// 视锥外的点夹到边界的 froxel
+			auto outside = decodeCluster(grid, grid.findCluster({ -1e6f, 1e6f, camera.nearZ * 0.5f }));
+			LITE_ENGINE_TEST_CHECK(outside.x == 0 && outside.y == TILES_Y - 1 && outside.z == 0);
+			outside = decodeCluster(grid, grid.findCluster({ 1e6f, -1e6f, camera.farZ * 2 }));
+			LITE_ENGINE_TEST_CHECK(outside.x == TILES_X - 1 && outside.y == 0 && outside.z == SLICES - 1);
+		}
+
+		void testFroxelBounds() {
+			checkFroxelBounds(ler::LightClusterCamera::perspectiveCamera(FIELD_OF_VIEW_Y, ASPECT_RATIO, NEAR_Z, FAR_Z));
+			checkFroxelBounds(ler::LightClusterCamera::orthographicCamera(40, 22.5f, NEAR_Z, FAR_Z));
+		}
+
+		// 与近平面相交的光源：球心在近平面和相机之间、在相机后面，以及完全在相机后面（不应出现在任何 froxel 中）
+		void testLightsStraddlingNearPlane() {
+			auto camera = ler::LightClusterCamera::perspectiveCamera(FIELD_OF_VIEW_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+
+			std::vector<ler::ClusterLight> lights(5);
+			lights[0].position_V = { 0.1f, -0.1f, NEAR_Z * 0.5f };
+			lights[0].range = 1;
+			lights[1].position_V = { 0, 0, -0.5f };
+			lights[1].range = 1.2f;
+			lights[2].position_V = { 0, 0, -5 };
+			lights[2].range = 1;
+			// 从近平面之前照向前方和后方的聚光灯
+			lights[3].position_V = { 0, 0, NEAR_Z * 0.5f };
+			lights[3].range = 20;
+			lights[3].spot = true;
+			lights[3].direction_V = { 0, 0, 1 };
+			lights[3].outerConeAngle = 0.4f;
+			lights[4] = lights[3];
+			lights[4].direction_V = { 0, 0, -1 };
+
+			ler::LightClusterGrid grid(TILES_X, TILES_Y, SLICES);
+			grid.build(camera, lights);
+			checkNoMissingLights(grid, lights, 2000);
+
+			auto center = grid.findCluster({ 0, 0, NEAR_Z * (1 + EPSILON) });
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, center, 0));
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, center, 1));
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, center, 3));
+			LITE_ENGINE_TEST_CHECK(countClustersContaining(grid, 2) == 0);
+
+			// 照向后方的聚光灯只可能出现在近平面附近，不会出现在远处
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, grid.findCluster({ 0, 0, 10 }), 3));
+			LITE_ENGINE_TEST_CHECK(!clusterContains(grid, grid.findCluster({ 0, 0, 10 }), 4));
+		}
+
+		// 球心正好在 tile 边界上的小光源出现在两侧（角上时四周）的 tile 中，不会出现在远处的 tile 中
+		void testLightsOnTileEdges() {
+			auto camera = ler::LightClusterCamera::perspectiveCamera(FIELD_OF_VIEW_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+			float z = 20;
+			float edgeX = ndcToView(camera, tileEdge(5, TILES_X), z, camera.viewScaleX);
+			float edgeY = ndcToView(camera, tileEdge(3, TILES_Y), z, camera.viewScaleY);
+
+			std::vector<ler::ClusterLight> lights(3);
+			lights[0].position_V = { edgeX, 0, z };
+			lights[0].range = 0.05f;
+			lights[1].position_V = { 0, edgeY, z };
+			lights[1].range = 0.05f;
+			lights[2].position_V = { edgeX, edgeY, z };
+			lights[2].range = 0.05f;
+
+			ler::LightClusterGrid grid(TILES_X, TILES_Y, SLICES);
+			grid.build(camera, lights);
+			checkNoMissingLights(grid, lights, 2000);
+
+			auto slice = decodeCluster(grid, grid.findCluster({ 0, 0, z })).z;
+			auto centerY = decodeCluster(grid, grid.findCluster({ 0, 0, z })).y;
+			auto centerX = decodeCluster(grid, grid.findCluster({ 0, 0, z })).x;
+
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, grid.getClusterIndex(4, centerY, slice), 0));
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, grid.getClusterIndex(5, centerY, slice), 0));
+			LITE_ENGINE_TEST_CHECK(!clusterContains(grid, grid.getClusterIndex(0, centerY, slice), 0));
+			LITE_ENGINE_TEST_CHECK(!clusterContains(grid, grid.getClusterIndex(TILES_X - 1, centerY, slice), 0));
+
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, grid.getClusterIndex(centerX, 2, slice), 1));
+			LITE_ENGINE_TEST_CHECK(clusterContains(grid, grid.getClusterIndex(centerX, 3, slice), 1));
+			LITE_ENGINE_TEST_CHECK(!clusterContains(grid, grid.getClusterIndex(centerX, TILES_Y - 1, slice), 1));
+
+			for (uint32_t y = 2; y <= 3; y++) {
+				for (uint32_t x = 4; x <= 5; x++) {
+					LITE_ENGINE_TEST_CHECK(clusterContains(grid, grid.getClusterIndex(x, y, slice), 2));
+				}
+			}
+
+			// 很小的光源只占一两个 slice
+			for (uint32_t lightID = 0; lightID < lights.size(); lightID++) {
+				LITE_ENGINE_TEST_CHECK(countClustersContaining(grid, lightID) <= 4 * 2);
+			}
+		}
+
+		// 平行光（range 无穷大）出现在每个 froxel 中
+		void testDirectionalLight() {
+			ler::LightClusterGrid grid(TILES_X, TILES_Y, SLICES);
+			grid.build(ler::LightClusterCamera::perspectiveCamera(FIELD_OF_VIEW_Y, ASPECT_RATIO, NEAR_Z, FAR_Z), { ler::ClusterLight{} });
+			LITE_ENGINE_TEST_CHECK(countClustersContaining(grid, 0) == grid.getClusterCount());
+		}
+
+		// 随机的点光源和聚光灯，透视和正交都不漏；按 slice 并行构建的结果与单线程相同
+		void testRandomLights() {
+			std::mt19937 random(7);
+			std::uniform_real_distribution<float> unit(-1, 1);
+			std::uniform_real_distribution<float> depth(-2, 60);
+			std::uniform_real_distribution<float> range(0.5f, 8);
+			std::uniform_real_distribution<float> angle(0.1f, 1.2f);
+
+			std::vector<ler::ClusterLight> lights(96);
+			for (uint32_t i = 0; i < lights.size(); i++) {
+				auto& light = lights[i];
+				light.position_V = { unit(random) * 30, unit(random) * 20, depth(random) };
+				light.range = range(random);
+				if (i % 3 == 0) {
+					light.spot = true;
+					float x = unit(random), y = unit(random), z = unit(random);
+					float length = std::max(1e-3f, std::sqrt(x * x + y * y + z * z));
+					light.direction_V = { x / length, y / length, z / length };
+					light.outerConeAngle = angle(random);
+				}
+			}
+
+			auto perspective = ler::LightClusterCamera::perspectiveCamera(FIELD_OF_VIEW_Y, ASPECT_RATIO, NEAR_Z, 100);
+			ler::LightClusterGrid grid(TILES_X, TILES_Y, SLICES);
+			grid.build(perspective, lights);
+			checkNoMissingLights(grid, lights, 200);
+
+			LiteEngine::JobSystem jobs(2);
+			ler::LightClusterGrid parallel(TILES_X, TILES_Y, SLICES);
+			parallel.build(perspective, lights, &jobs);
+			LITE_ENGINE_TEST_CHECK(parallel.getLightIndices() == grid.getLightIndices());
+			for (uint32_t i = 0; i < grid.getClusterCount(); i++) {
+				LITE_ENGINE_TEST_CHECK(parallel.getClusters()[i].offset == grid.getClusters()[i].offset);
+				LITE_ENGINE_TEST_CHECK(parallel.getClusters()[i].count == grid.getClusters()[i].count);
+			}
+
+			// 同一个 grid 换成正交相机重新构建
+			grid.build(ler::LightClusterCamera::orthographicCamera(60, 40, NEAR_Z, 100), lights);
+			checkNoMissingLights(grid, lights, 200);
+		}
+
+		void testEmptyGridThrows() {
+			bool thrown = false;
+			try {
+				ler::LightClusterGrid grid(0, TILES_Y, SLICES);
+			} catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			LITE_ENGINE_TEST_CHECK(thrown);
+		}
+
+	}
+
+	void runLightClusteringTests() {
+		testFroxelBounds();
+		testLightsStraddlingNearPlane();
+		testLightsOnTileEdges();
+		testDirectionalLight();
+		testRandomLights();
+		testEmptyGridThrows();
+	}
+
+}
@@ -0,0 +1,196 @@
+#include "UnitTests.h"
+
+#include "LiteEngine/LiteEngine.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace LiteEngineTest {
+
+	namespace lesm = LiteEngine::SceneManagement;
+
+	namespace {
+
+		// 物体销毁后槽位被新物体复用：旧句柄和 ObjectLink 失效，新句柄的槽位相同、代数不同
+		void testStaleHandleAfterReuse() {
+			auto& store = lesm::ObjectStore::getInstance();
+
+			std::shared_ptr<lesm::Object> first(new lesm::Object("first"));
+			auto oldHandle = first->getHandle();
+			lesm::ObjectLink link(first);
+			LITE_ENGINE_TEST_CHECK(store.resolve(oldHandle) == first.get());
+			LITE_ENGINE_TEST_CHECK(link.lock() == first);
+
+			first = nullptr;
+			LITE_ENGINE_TEST_CHECK(store.resolve(oldHandle) == nullptr);
+			LITE_ENGINE_TEST_CHECK(link.expired());
+
+			// 空闲槽位后进先出，下一个物体一定复用刚释放的槽位
+			std::shared_ptr<lesm::Object> second(new lesm::Object("second"));
+			auto newHandle = second->getHandle();
+			LITE_ENGINE_TEST_CHECK(newHandle.getIndex() == oldHandle.getIndex());
+			LITE_ENGINE_TEST_CHECK(newHandle.getGeneration() != oldHandle.getGeneration());
+			LITE_ENGINE_TEST_CHECK(store.resolve(newHandle) == second.get());
+			LITE_ENGINE_TEST_CHECK(store.resolve(oldHandle) == nullptr);
+			LITE_ENGINE_TEST_CHECK(link.get() == nullptr);
+			LITE_ENGINE_TEST_CHECK(link.lock() == nullptr);
+		}
+
+		// 同一个槽位反复登记、注销，代数从 MAX_GENERATION 回到 1，句柄永远不会是空句柄
+		void testGenerationWrap() {
+			auto& store = lesm::ObjectStore::getInstance();
+
+			// ObjectStore 只保存指针，不访问物体
+			auto dummy = reinterpret_cast<lesm::Object*>(&store);
+			auto handle = store.add(dummy);
+			auto index = handle.getIndex();
+
+			bool wrapped = false;
+			for (uint32_t i = 0; i < lesm::ObjectHandle::MAX_GENERATION + 1; i++) {
+				auto previous = handle;
+				store.remove(previous);
+				handle = store.add(dummy);
+
+				LITE_ENGINE_TEST_CHECK(!handle.isNull());
+				LITE_ENGINE_TEST_CHECK(handle.getIndex() == index);
+				LITE_ENGINE_TEST_CHECK(handle.getGeneration() != 0);
+				LITE_ENGINE_TEST_CHECK(store.resolve(previous) == nullptr);
+				LITE_ENGINE_TEST_CHECK(store.resolve(handle) == dummy);
+
+				if (previous.getGeneration() == lesm::ObjectHandle::MAX_GENERATION) {
+					LITE_ENGINE_TEST_CHECK(handle.getGeneration() == 1);
+					wrapped = true;
+				} else {
+					LITE_ENGINE_TEST_CHECK(handle.getGeneration() == previous.getGeneration() + 1);
+				}
+			}
+			LITE_ENGINE_TEST_CHECK(wrapped);
+
+			store.remove(handle);
+			LITE_ENGINE_TEST_CHECK(store.resolve(handle) == nullptr);
+		}
+
+		// dense 中的每个句柄都能通过 sparse 找回自己的下标，组件与句柄一一对应
+		void checkPoolConsistency(lesm::ComponentPool<uint32_t>& pool, const std::vector<lesm::ObjectHandle>& expected) {
+			LITE_ENGINE_TEST_CHECK(pool.size() == expected.size());
+			auto handles = pool.getHandles();
+			auto components = pool.getComponents();
+			for (uint32_t i = 0; i < pool.size(); i++) {
+				LITE_ENGINE_TEST_CHECK(pool.get(handles[i]) == &components[i]);
+				LITE_ENGINE_TEST_CHECK(components[i] == handles[i].getValue());
+			}
+			for (auto handle : expected) {
+				auto component = pool.get(handle);
+				LITE_ENGINE_TEST_CHECK(component != nullptr && *component == handle.getValue());
+			}
+		}
+
+		// 删除时用最后一个元素填补空位，被移动的元素的 sparse 下标必须同时更新
+		void testSwapRemove() {
+			lesm::ComponentPool<uint32_t> pool;
+			std::vector<lesm::ObjectHandle> live;
+
+			// 槽位跨过 sparse 的页边界
+			for (uint32_t i = 0; i < 300; i++) {
+				lesm::ObjectHandle handle(i * 37, 1 + i % 5);
+				pool.add(handle, handle.getValue());
+				live.push_back(handle);
+			}
+			checkPoolConsistency(pool, live);
+
+			std::mt19937 random(12345);
+			while (!live.empty()) {
+				auto position = random() % live.size();
+				auto handle = live[position];
+				live.erase(live.begin() + position);
+
+				LITE_ENGINE_TEST_CHECK(pool.remove(handle));
+				LITE_ENGINE_TEST_CHECK(!pool.contains(handle));
+				LITE_ENGINE_TEST_CHECK(!pool.remove(handle));
+				checkPoolConsistency(pool, live);
+			}
+			LITE_ENGINE_TEST_CHECK(pool.size() == 0);
+		}
+
+		// 槽位相同、代数不同的句柄看不到旧组件；用新句柄 add 替换旧组件而不是新增一个
+		void testStaleComponent() {
+			lesm::ComponentPool<uint32_t> pool;
+			lesm::ObjectHandle oldHandle(42, 3);
+			lesm::ObjectHandle newHandle(42, 4);
+
+			pool.add(oldHandle, 1u);
+			LITE_ENGINE_TEST_CHECK(pool.get(newHandle) == nullptr);
+			LITE_ENGINE_TEST_CHECK(!pool.remove(newHandle));
+
+			pool.add(newHandle, 2u);
+			LITE_ENGINE_TEST_CHECK(pool.size() == 1);
+			LITE_ENGINE_TEST_CHECK(pool.get(oldHandle) == nullptr);
+			LITE_ENGINE_TEST_CHECK(*pool.get(newHandle) == 2);
+		}
+
+		// sortLike 之后两个池的公共部分顺序相同，sparse 仍然一致
+		void testSortLike() {
+			lesm::ComponentPool<uint32_t> lead;
+			lesm::ComponentPool<uint32_t> other;
+			std::vector<lesm::ObjectHandle> leadHandles, otherHandles;
+			for (uint32_t i = 0; i < 64; i++) {
+				lesm::ObjectHandle handle(i, 1);
+				if (i % 2 == 0) {
+					lead.add(handle, handle.getValue());
+					leadHandles.push_back(handle);
+				}
+				if (i % 3 == 0) {
+					otherHandles.push_back(handle);
+				}
+			}
+			std::reverse(otherHandles.begin(), otherHandles.end());
+			for (auto handle : otherHandles) other.add(handle, handle.getValue());
+
+			other.sortLike(lead);
+			checkPoolConsistency(other, otherHandles);
+
+			// 两边都有的是 6 的倍数，应当按 lead 的顺序排在 other 的最前面
+			auto handles = other.getHandles();
+			uint32_t next = 0;
+			for (auto handle : leadHandles) {
+				if (handle.getIndex() % 3 != 0) continue;
+				LITE_ENGINE_TEST_CHECK(handles[next++] == handle);
+			}
+		}
+
+		// 所属物体销毁后 removeStale 删除它的组件，其他组件不受影响
+		void testRemoveStale() {
+			lesm::ComponentStore components;
+			std::vector<std::shared_ptr<lesm::Object>> objects;
+			for (uint32_t i = 0; i < 16; i++) {
+				objects.emplace_back(new lesm::Object());
+				components.add<uint32_t>(objects.back()->getHandle(), objects.back()->getHandle().getValue());
+			}
+
+			std::vector<lesm::ObjectHandle> live;
+			for (uint32_t i = 0; i < objects.size(); i++) {
+				if (i % 3 == 0) {
+					objects[i] = nullptr;
+				} else {
+					live.push_back(objects[i]->getHandle());
+				}
+			}
+
+			LITE_ENGINE_TEST_CHECK(components.removeStale() == 6);
+			checkPoolConsistency(components.getPool<uint32_t>(), live);
+			LITE_ENGINE_TEST_CHECK(components.removeStale() == 0);
+		}
+
+	}
+
+	void runObjectStoreTests() {
+		testStaleHandleAfterReuse();
+		testGenerationWrap();
+		testSwapRemove();
+		testStaleComponent();
+		testSortLike();
+		testRemoveStale();
+	}
+
+}
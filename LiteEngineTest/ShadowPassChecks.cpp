@@ -0,0 +1,30 @@
+#include "UnitTests.h"
+
+#include "LiteEngine/LiteEngine.h"
+
+#include <cstring>
+
+namespace LiteEngineTest {
+
+	namespace ler = LiteEngine::Rendering;
+
+	void checkSinglePassCascadeStatistics(const ler::InputAssemblerCache& perCascade, const ler::InputAssemblerCache& singlePass) {
+		// 测试场景中至少有一个投射阴影的光源，逐级绘制时每级 cascade 一个 pass
+		LITE_ENGINE_TEST_CHECK(perCascade.passes > 0);
+		LITE_ENGINE_TEST_CHECK(singlePass.passes < perCascade.passes);
+
+		// 一个物体在各级 cascade 中的绘制合并成一次实例化绘制，不会比逐级绘制多
+		LITE_ENGINE_TEST_CHECK(singlePass.draws <= perCascade.draws);
+		LITE_ENGINE_TEST_CHECK(singlePass.instancedDraws > 0);
+	}
+
+	void checkPerframeConstantsRestored(const ler::PerpassModifiable& data) {
+		// 单 pass 级联阴影不修改场景的相机，绘制结束后 per-frame VS 常数应当恢复为场景的相机
+		auto& constants = *data.fixedPerframeVSConstants;
+		auto& camera = data.scene->camera;
+		auto trans_V2C = camera.getV2CMatrix();
+		LITE_ENGINE_TEST_CHECK(std::memcmp(&constants.trans_W2V, &camera.trans_W2V, sizeof(DirectX::XMMATRIX)) == 0);
+		LITE_ENGINE_TEST_CHECK(std::memcmp(&constants.trans_V2C, &trans_V2C, sizeof(DirectX::XMMATRIX)) == 0);
+	}
+
+}
@@ -0,0 +1,18 @@
+#include "UnitTests.h"
+
+#include <cstdio>
+#include <exception>
+
+// 不依赖 Windows 和 D3D 的单元测试，由根目录的 CMakeLists.txt 构建（LiteEngineUnitTests）
+// 在 Windows 上这些测试由 LiteEngineTest 在启动时运行（见 main.cpp）
+
+int main() {
+	try {
+		LiteEngineTest::runLightClusteringTests();
+	} catch (const std::exception& e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	puts("all unit tests passed");
+	return 0;
+}
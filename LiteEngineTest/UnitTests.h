@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// 不需要窗口和 GPU 的单元测试。每组测试是一个 runXxxTests 函数，失败时抛出 std::runtime_error
+// LiteEngineTest 启动时先运行全部单元测试（见 main.cpp）
+
+#define LITE_ENGINE_TEST_CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": check failed: " #condition); \
+		} \
+	} while (false)
+
+namespace LiteEngine::Rendering {
+	struct InputAssemblerCache;
+	struct PerpassModifiable;
+	class Renderer;
+}
+
+namespace LiteEngine::SceneManagement {
+	struct Scene;
+}
+
+namespace LiteEngineTest {
+
+	// Scene::getRenderingScene 和 FrameArena 在稳定状态下每帧不向堆申请内存
+	void runFrameAllocationTests();
+
+	// 代数句柄的失效和回绕，稀疏集合删除后 dense 下标的一致性
+	void runObjectStoreTests();
+
+	// 层级压平后保留下来的只传递变换的链：缓存的乘积在 TRS 和结构变化后仍然正确
+	void runHierarchyFlatteningTests();
+
+	// froxel 的边界，以及光源到 froxel 的分配（与近平面相交、在 tile 边界上的光源）
+	void runLightClusteringTests();
+
+	// 以下需要 Renderer，由 main.cpp 在渲染循环中调用，失败时同样抛出 std::runtime_error
+
+	// 同一场景逐级绘制和单 pass 绘制级联阴影（Renderer::singlePassCascades）各一帧的统计
+	void checkSinglePassCascadeStatistics(const LiteEngine::Rendering::InputAssemblerCache& perCascade,
+		const LiteEngine::Rendering::InputAssemblerCache& singlePass);
+
+	// 通过 renderScene 连续绘制三帧，第二、三帧不向堆申请内存，也没有活过一帧的 frame arena 分配
+	void checkRendererFrameAllocations(LiteEngine::Rendering::Renderer& renderer, LiteEngine::SceneManagement::Scene& scene);
+
+	// 在阴影 pass 之后的 pass 中调用：单 pass 级联阴影没有留下各级 cascade 的相机
+	void checkPerframeConstantsRestored(const LiteEngine::Rendering::PerpassModifiable& data);
+
+}
@@ -2,6 +2,7 @@
 #include <wrl.h>
 
 #include "LiteEngine/LiteEngine.h"
+#include "UnitTests.h"
 
 #include <numeric>
 #include <algorithm>
@@ -21,12 +22,23 @@ int WINAPI wWinMain(
 	_In_ int nCmdShow
 ) {
 	// required by DirectXTeX
-	// Ҫ ÿһ  DirectXTeX ̵߳
+	// 需要在 ！！每一个！！ 调用 DirectXTeX 的线程调用
 	//Microsoft::WRL::Wrappers::RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
 	//if (FAILED(initialize)) {
 	//	assert(false);
 	//}
 
+	// 单元测试不需要窗口。有失败时不启动渲染
+	try {
+		LiteEngineTest::runFrameAllocationTests();
+		LiteEngineTest::runObjectStoreTests();
+		LiteEngineTest::runHierarchyFlatteningTests();
+		LiteEngineTest::runLightClusteringTests();
+	} catch (const std::exception& e) {
+		MessageBoxA(nullptr, e.what(), "LiteEngineTest: unit test failed", MB_OK | MB_ICONERROR);
+		return 1;
+	}
+
 	SetProcessDPIAware();
 
 	namespace le = LiteEngine;
@@ -97,8 +109,8 @@ int WINAPI wWinMain(
 		offscreenPass->viewport = viewport;
 	}
 	
-	// Z-up ϵ -> Y-up ϵ
-	// C++ гֵоӦҳˣvec * matľ
+	// Z-up 右手系 -> Y-up 左手系
+	// C++ 中出现的所有矩阵都应该是用于右乘（vec * mat）的矩阵
 	DirectX::XMMATRIX skyboxTransform = {
 		0, 1, 0, 0,
 		0, 0, 1, 0,
@@ -124,6 +136,10 @@ int WINAPI wWinMain(
 	le::IO::MoveController moveAD('A', 'D');
 	le::IO::MoveController moveEC('E', 'C');
 
+	// 前两帧分别逐级和单 pass 绘制级联阴影，第三帧比较两帧的统计（getLastFrameInputAssemblerStatistics 是上一帧的）
+	uint32_t frameIndex = 0;
+	ler::InputAssemblerCache perCascadeStatistics;
+
 	window.renderCallback = [&](
 		const le::IO::RenderingWindow& window,
 		const std::vector<le::IO::RenderingWindow::EventType>& events
@@ -145,7 +161,7 @@ int WINAPI wWinMain(
 			movingObject->moveLocalCoord({ 0.02f, 0, 0 });
 		}
 		mainCameraYawLayer->moveLocalCoord({-moveAD.popValue(), moveEC.popValue(), moveWS.popValue()});
-		// i.e.  Z תת֮ X ת
+		// i.e. 先沿着 Z 轴转，再沿着旋转之后的新 X 轴转
 		mainCameraYawLayer->transR = DirectX::XMQuaternionRotationAxis({ 0, -1, 0 }, accX);
 		mainCameraPitchLayer->transR = DirectX::XMQuaternionRotationAxis({ -1, 0, 0 }, accY);
 
@@ -158,7 +174,7 @@ int WINAPI wWinMain(
 		smScene.activeCamera = mainCamera;
 
 
-		// ʵ getRenderingScene һ̷߳ʣȫ漰ͼ API
+		// 其实 getRenderingScene 可以在另外一个线程访问，完全不涉及图形 API
 		std::shared_ptr<ler::RenderingScene> scene = smScene.getRenderingScene();
 		auto mainRenderingCamera = scene->camera;
 
@@ -168,6 +184,16 @@ int WINAPI wWinMain(
 
 		renderer.beginRendering();
 
+		if (frameIndex == 0) {
+			renderer.singlePassCascades = false;
+		} else if (frameIndex == 1) {
+			perCascadeStatistics = renderer.getLastFrameInputAssemblerStatistics();
+			renderer.singlePassCascades = true;
+		} else if (frameIndex == 2) {
+			LiteEngineTest::checkSinglePassCascadeStatistics(perCascadeStatistics, renderer.getLastFrameInputAssemblerStatistics());
+		}
+		frameIndex++;
+
 		if (probeCamera) {
 			offscreenPass->scene = scene;
 			offscreenPass->scene->camera = smScene.getCameraInfo(probeCamera);
@@ -177,13 +203,24 @@ int WINAPI wWinMain(
 			screenMat->texEmissionColor = nullptr;
 			screenMat->constants->cpuData<lesm::DefaultMaterialConstantData>().uvEmissionColor = UINT32_MAX;
 		}
-		std::vector<std::shared_ptr<ler::RenderingPass>> passes;
+		auto passes = renderer.createRenderingPassList();
 		renderer.createShadowMapPasses(passes, scene, {scene->camera.nearZ, 3, 10, 30, 100});
+		if (renderer.singlePassCascades) {
+			auto checkPass = std::make_shared<ler::RenderingPass>();
+			checkPass->scene = scene;
+			checkPass->disableRendering = true;
+			checkPass->beforeRenderModifier = [](ler::PerpassModifiable data) {
+				LiteEngineTest::checkPerframeConstantsRestored(data);
+			};
+			passes.push_back(checkPass);
+		}
 		renderer.renderPasses(passes);
 
 		if (offscreenPass) {
 			renderer.enableBuiltinShadowMap(offscreenPass);
 			renderer.renderPass(offscreenPass);
+			// offscreenPass 跨帧存在，不释放 scene 时 getRenderingScene 每帧都要新建
+			offscreenPass->scene = nullptr;
 		}
 
 		scene->camera = mainRenderingCamera;
@@ -206,7 +243,21 @@ int WINAPI wWinMain(
 
 	window.show();
 
-	window.runRenderingLoop();
+	// 渲染循环之前，用主相机检查 renderScene 的稳定状态
+	try {
+		smScene.activeCamera = mainCamera;
+		LiteEngineTest::checkRendererFrameAllocations(renderer, smScene);
+	} catch (const std::exception& e) {
+		MessageBoxA(nullptr, e.what(), "LiteEngineTest: rendering check failed", MB_OK | MB_ICONERROR);
+		return 1;
+	}
+
+	try {
+		window.runRenderingLoop();
+	} catch (const std::exception& e) {
+		MessageBoxA(nullptr, e.what(), "LiteEngineTest: rendering check failed", MB_OK | MB_ICONERROR);
+		return 1;
+	}
 
 	return 0;
 }
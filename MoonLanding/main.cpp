@@ -10,6 +10,13 @@ namespace rd = LiteEngine::Rendering;
 namespace io = LiteEngine::IO;
 namespace sm = LiteEngine::SceneManagement;
 
+// 绕固定轴匀速转动（自转、公转）的物体
+struct PeriodicRotation {
+	DirectX::XMFLOAT3 axis;
+	float period;
+	double angle = 0;		// 当前角度，每帧更新
+};
+
 class MoonLandingGame {
 	static constexpr float EarthRadius = 40;
 	static constexpr float MoonRadius = 17;
@@ -19,26 +26,26 @@ class MoonLandingGame {
 	static constexpr float SumEarthDistance = 500;
 	static constexpr float OrbitHeightEarth = 5;
 	static constexpr float OrbitHeightMoon = 5;
-	static constexpr float EarthRevolutionPeriod = 240; // ת
-	static constexpr float EarthRotationPeriod = 40; // ת
-	static constexpr float MoonRevolutionPeriod = 100; // ת
-	static constexpr float EarthMoonTransferTime = 20; // תڣʱ䣩
-	static constexpr float ShipRevolutionPeriodAroundEarth = 15;	// ɴƵת
-	static constexpr float ShipRevolutionPeriodAroundMoon = 10;	// ɴת
-	static constexpr float EarthAxialTilt = (float) ((23 + 26 / 60.0) / 180 * le::PI); // Ƴཻ
-	static constexpr float MoonRevolutionAngle = (float)(5.0 / 180 * le::PI); // ת͵ļн
+	static constexpr float EarthRevolutionPeriod = 240; // 地球公转周期
+	static constexpr float EarthRotationPeriod = 40; // 地球自转周期
+	static constexpr float MoonRevolutionPeriod = 100; // 月球公转周期
+	static constexpr float EarthMoonTransferTime = 20; // 地月转移周期（两倍时间）
+	static constexpr float ShipRevolutionPeriodAroundEarth = 15;	// 飞船绕地球公转周期
+	static constexpr float ShipRevolutionPeriodAroundMoon = 10;	// 飞船绕月球公转周期
+	static constexpr float EarthAxialTilt = (float) ((23 + 26 / 60.0) / 180 * le::PI); // 黄赤交角
+	static constexpr float MoonRevolutionAngle = (float)(5.0 / 180 * le::PI); // 月亮公转轨道和地球的夹角
 	static constexpr float LaunchFromEarthTime = 5;
 	static constexpr float LandToEarthTime = 5;
 	static constexpr float LaunchFromMoonTime = 5;
 	static constexpr float LandToMoonTime = 5;
-	static constexpr float EarthLaunchOrbitRadian = le::PI * 90 / 180; // ڵϷ䵽ľ
+	static constexpr float EarthLaunchOrbitRadian = le::PI * 90 / 180; // 在地球上发射到入轨的距离
 	static constexpr float EarthBaseRz = float(-le::PI * 40 / 180);
 	static constexpr float EarthBaseRy = float(-le::PI * 85 / 180 + le::PI * 2);
 	static constexpr float LandEarthStartRy = float(-le::PI * 85 / 180 + le::PI / 2);
 
 	rd::Renderer* renderer;
 	io::RenderingWindow window;
-	// framerate controller ṩ֡ʿƣҲṩ֡Ϣ
+	// framerate controller 提供额外的帧率控制，也提供帧率信息
 	io::FramerateController framerateController;
 
 	std::shared_ptr<sm::Scene> scene;
@@ -47,21 +54,29 @@ class MoonLandingGame {
 	// textures
 	rd::PtrShaderResourceView texSkymap;
 
+	// 资源在工作线程上异步加载，加载完成之前只渲染天空盒
+	io::AsyncLoader resourceLoader;
+	std::shared_ptr<io::AsyncLoader::LoadHandle> hdSun;
+	std::shared_ptr<io::AsyncLoader::LoadHandle> hdEarth;
+	std::shared_ptr<io::AsyncLoader::LoadHandle> hdMoon;
+	std::shared_ptr<io::AsyncLoader::LoadHandle> hdShip;
+	bool resourcesReady = false;
+
 	// mesh-related
 	std::shared_ptr<sm::Object> objSum;
 	std::shared_ptr<sm::Object> objMoon;
 	std::shared_ptr<sm::Object> objMoonOrbit;
-	std::shared_ptr<sm::Object> objMoonOrbitAngleLayer; // ͻƵļн
+	std::shared_ptr<sm::Object> objMoonOrbitAngleLayer; // 处理和黄道的夹角
 	std::shared_ptr<sm::Object> objEarth;
-	std::shared_ptr<sm::Object> objEarthShipPlacement;	// ڵϵ
-	std::shared_ptr<sm::Object> objEarthRotationAngleLayer;	// Ƴཻ
+	std::shared_ptr<sm::Object> objEarthShipPlacement;	// 在地球上的物体
+	std::shared_ptr<sm::Object> objEarthRotationAngleLayer;	// 处理黄赤交角
 	std::shared_ptr<sm::Object> objShip;
 	std::shared_ptr<sm::Object> objShipCameraSys;
-	std::shared_ptr<sm::Object> objShipCameraSysCoordLayer;			// Earth -> Moon תƹλ
+	std::shared_ptr<sm::Object> objShipCameraSysCoordLayer;			// Earth -> Moon 转移轨道，处理具体位置
 	std::shared_ptr<sm::Object> objShipCameraSysOrientationLayer;	
-	std::shared_ptr<sm::Object> objShipCameraSysEarthOrbitLayer;	// ƵתﲻҪ
-	std::shared_ptr<sm::Object> objShipCameraSysMoonOrbitLayer;		// תﲻҪ
-	std::shared_ptr<sm::Object> objShipCameraSysEMTransferLayer;	// Earth -> Moon תƹԲĳλ
+	std::shared_ptr<sm::Object> objShipCameraSysEarthOrbitLayer;	// 环绕地球轨道，本身会转动，所以在这个轨道里不需要动
+	std::shared_ptr<sm::Object> objShipCameraSysMoonOrbitLayer;		// 环绕月球轨道，本身会转动，所以在这个轨道里不需要动
+	std::shared_ptr<sm::Object> objShipCameraSysEMTransferLayer;	// Earth -> Moon 转移轨道，处理椭圆轨道的朝向和位置
 	std::shared_ptr<sm::Object> objEarthMoonSys;
 	std::shared_ptr<sm::Object> objEarthMoonSysOrbitLayer;
 	std::shared_ptr<sm::Object> objRoot;
@@ -69,22 +84,22 @@ class MoonLandingGame {
 
 	// camera-related
 	static constexpr float CMShipFreeFOV = le::PI / 2;
-	std::shared_ptr<sm::Camera> cmShipFree;		// һ˳
+	std::shared_ptr<sm::Camera> cmShipFree;		// 第一人称相机
 	std::shared_ptr<sm::Object> cmShipFreePitchLayer;
 	std::shared_ptr<sm::Object> cmShipFreeYawLayer;
 	std::shared_ptr<sm::Object> cmShipFreePresetLayer;
 	io::HoldRotateController cmShipFreeRotate;
 
-	std::shared_ptr<sm::Camera> cmShipThirdPerson;		// ˳
-	std::shared_ptr<sm::Object> cmShipThirdInnerOrientationPerson;		// ˳
+	std::shared_ptr<sm::Camera> cmShipThirdPerson;		// 第三人称相机
+	std::shared_ptr<sm::Object> cmShipThirdInnerOrientationPerson;		// 第三人称相机
 	std::shared_ptr<sm::Object> cmShipThirdPersonOrientationLayer;
 	std::shared_ptr<sm::Object> cmShipThirdPersonCoordLayer;
 	io::HoldRotateController cmShipThirdPersonRotate;
 
-	std::shared_ptr<sm::Camera> cmNorthFixed;		// ̶̫Ϸ
+	std::shared_ptr<sm::Camera> cmNorthFixed;		// 固定在太阳上方的正交相机
 
 	// light-related
-	std::shared_ptr<sm::Light> ltSum; // λ RootֱӿƷ
+	std::shared_ptr<sm::Light> ltSum; // 位于 Root，直接控制方向
 
 	// states
 	enum class CameraSetting { FirstPerson, ThirdPerson, North };
@@ -96,23 +111,23 @@ class MoonLandingGame {
 	};
 	OrbitState orbitState = OrbitState::OnTheEarth;	// todo
 
-	// commandInQueue ʾĿǰдڶеȴִУ翪ʼתƣ
+	// commandInQueue 表示目前有待处理的命令在队列中等待执行（如开始转移）
 	bool commandInQueue = false;
 	OrbitState nextState;
-	bool forbitCommand = false;	// ֹκ
+	bool forbitCommand = false;	// 禁止任何命令
 
 	// floating state
-	double shipOnEarthRotationAngle = 0;			// ɴƵתĽǶ
-	double moonRevolutionOrbitRotationAngle = 0;	// ƵתĽǶ
-	double earthToMoonTransferStartTime = 0;		// תƵĿʼʱ
-	double earthToMoonRotationAngle = 0;			// תƵԲǶȣ0-PI
-	double moonToEarthTransferStartTime = 0;		// תƵĿʼʱ
-	double moonToEarthRotationAngle = 0;			// תƵԲǶȣ0-PI)
-	double aroundEarthStartTime = 0;				// ɴƵתĿʼʱ
-	double aroundMoonStartTime = 0;					// ɴתĿʼʱ
-	double shipOnMoonRotationAngle = 0;				// ɴתĽǶ
-	double shipOnEarthRotationAngleOffset = 0;			// ʼתʱĽǶ
-	double earthRotationAngle = 0;					// תǶ
+	double shipOnEarthRotationAngle = 0;			// 飞船绕地球旋转的角度
+	double moonRevolutionOrbitRotationAngle = 0;	// 月球绕地球公转的角度
+	double earthToMoonTransferStartTime = 0;		// 地球向月球转移的开始时间
+	double earthToMoonRotationAngle = 0;			// 地球向月球转移的椭圆轨道角度（0-PI）
+	double moonToEarthTransferStartTime = 0;		// 月球向地球转移的开始时间
+	double moonToEarthRotationAngle = 0;			// 月球向地球转移的椭圆轨道角度（0-PI)
+	double aroundEarthStartTime = 0;				// 飞船环绕地球转动的开始时间
+	double aroundMoonStartTime = 0;					// 飞船环绕月球转动的开始时间
+	double shipOnMoonRotationAngle = 0;				// 飞船绕月球旋转的角度
+	double shipOnEarthRotationAngleOffset = 0;			// 地球开始转动时候的角度
+	double earthRotationAngle = 0;					// 地球自转角度
 
 	std::tuple<double, double, double> rCoordLaunchFromEarthFrom;
 	std::tuple<double, double, double> rCoordLaunchFromEarthTo;
@@ -135,12 +150,14 @@ class MoonLandingGame {
 
 	double shipOnMoonRotationAngleOffset = 0;
 
-	// 1 ʾ״̬0 ʾڵ档
-	// ǶȲͬ
+	double lastDrawReportTime = 0;					// 上次输出三角形统计的时间
+
+	// 1 表示飞行状态，0 表示在地面。
+	// 角度不同
 	double cameraFlyingMode = 0;
 
 
-	// ָϣ
+	// 操作指南：
 	bool leftKeyValid = false;
 	bool rightKeyValid = false;
 	OrbitState leftKeyOp;
@@ -176,42 +193,118 @@ class MoonLandingGame {
 	}
 
 	void loadResources() {
-		objSum = io::loadDefaultResourceGLTF("Sun_10m.glb");
+		// 这几个模型都整体移动，内部的 mesh 按材质合并，减少 draw call
+		io::StaticBatchingOptions batching;
+		batching.enabled = true;
+		batching.wholeModel = true;
+		io::setStaticBatchingOptions(batching);
+
+		// 远处的星球只画一个面片。设置对所有模型生效，是否使用由 finishLoadingResources 决定
+		io::ImpostorOptions impostors;
+		impostors.enabled = true;
+		io::setImpostorOptions(impostors);
+
+		// 飞船离相机最近，优先加载
+		hdShip = resourceLoader.loadGLTF("Spaceship_20m.glb", le::JobPriority::HIGH);
+		hdEarth = resourceLoader.loadGLTF("Earth_10m.glb", le::JobPriority::NORMAL);
+		hdMoon = resourceLoader.loadGLTF("Moon_10m.glb", le::JobPriority::NORMAL);
+		hdSun = resourceLoader.loadGLTF("Sun_10m.glb", le::JobPriority::LOW);
+		
+		texSkymap = renderer->createCubeMapFromDDS(L"skymap.dds");
+
+		// 星球的包围球覆盖整个深度范围，CSM 的分界按实际画出的深度确定
+		renderer->cascadeSplitMode = rd::CascadeSplitMode::DEPTH_READBACK;
+	}
+
+	void finishLoadingResources() {
+		objSum = hdSun->get();
 		objSum->multiplyScale({ SumRadius / 10, SumRadius / 10, SumRadius / 10 });
 
-		auto objEarthLD = io::loadDefaultResourceGLTF("Earth_10m.glb");
+		auto objEarthLD = hdEarth->get();
 		
 		objEarthLD->multiplyScale({ EarthRadius / 10, EarthRadius / 10, EarthRadius / 10 });
 		objEarthLD->rotateParentCoord(DirectX::XMQuaternionRotationAxis({1, 0, 0}, le::PI/2));
-		objEarth = std::make_shared<sm::Object>("Earth");
+		objEarth = std::shared_ptr<sm::Object>(new sm::Object("Earth"));
 		objEarth->children = { objEarthLD };
 
-		auto objMoonLD = io::loadDefaultResourceGLTF("Moon_10m.glb");
+		auto objMoonLD = hdMoon->get();
 		objMoonLD->multiplyScale({ MoonRadius / 10, MoonRadius / 10, MoonRadius / 10 });
 		objMoonLD->rotateParentCoord(DirectX::XMQuaternionRotationAxis({ 0, 1, 0 }, le::PI));
-		objMoon = std::make_shared<sm::Object>("Moon");
+		objMoon = std::shared_ptr<sm::Object>(new sm::Object("Moon"));
 		objMoon->children = { objMoonLD };
 
-		auto objShipLD = io::loadDefaultResourceGLTF("Spaceship_20m.glb");
+		auto objShipLD = hdShip->get();
 		objShipLD->multiplyScale({ SpaceshipHeight / 20, SpaceshipHeight / 20, SpaceshipHeight / 20 });
-		objShip = std::make_shared<sm::Object>("Ship");
+		objShip = std::shared_ptr<sm::Object>(new sm::Object("Ship"));
 		objShip->children = { objShipLD };
-		
-		texSkymap = renderer->createCubeMapFromDDS(L"skymap.dds");
+
+		// 模型自带的关键帧动画（如果有）循环播放，蒙皮和 morph target 逐实例在 CPU 上变形
+		for (auto& model : { objSum, objEarthLD, objMoonLD, objShipLD }) {
+			if (auto instance = std::dynamic_pointer_cast<io::AssetInstance>(model); instance) {
+				instance->playAnimation(scene->components);
+				instance->createSkinnedMeshes(scene->components);
+			}
+		}
+
+		// 飞船总是在相机附近，不需要 impostor
+		for (auto& model : { objSum, objEarthLD, objMoonLD }) {
+			if (auto instance = std::dynamic_pointer_cast<io::AssetInstance>(model); instance) {
+				instance->createImpostor(scene->components);
+			}
+		}
+
+		// 太阳就是光源，自身不投射也不接收阴影
+		scene->components.add<sm::RenderLayerMask>(objSum->getHandle(), rd::RenderLayers::MAIN_VIEW | rd::RenderLayers::REFLECTION);
+	}
+
+	// 资源加载完成之前调用。返回 true 表示资源已经就绪
+	bool updateLoading() {
+		if (resourcesReady) return true;
+
+		// 每帧最多创建一个模型的 GPU 资源，避免画面卡顿
+		resourceLoader.update(1);
+
+		if (resourceLoader.isIdle()) {
+			finishLoadingResources();
+			le::log(le::LogLevel::INFO, io::DerivedDataCache::getInstance().getReport());
+			le::log(le::LogLevel::INFO, io::AssetRegistry::getInstance().getReport());
+			le::log(le::LogLevel::INFO, rd::Renderer::getInstance().getGeometryPool().getReport());
+			le::log(le::LogLevel::INFO, io::getStaticBatchingReport());
+			setupScene();
+			le::log(le::LogLevel::INFO, sm::ObjectStore::getInstance().getReport());
+			scene->activeCamera = cmShipFree;
+			// 应用程序没有保存的中间节点（主要是模型内部的节点）合并到子节点上，每帧少遍历这些节点
+			le::log(le::LogLevel::INFO, sm::flattenHierarchy(*scene).getReport());
+			objRoot->dump();
+			resourcesReady = true;
+			return true;
+		}
+
+		wchar_t title[100];
+		swprintf_s(title, L"加载中：%.0f%%", resourceLoader.getProgress() * 100);
+		SetWindowText(window.getHwnd(), title);
+
+		auto camera = cmShipFree->data;
+		camera.trans_W2V = DirectX::XMMatrixIdentity();
+		renderer->beginRendering();
+		renderer->renderSkybox(this->texSkymap, camera, DirectX::XMMatrixRotationY(
+			(float)framerateController.getLastFrameEndTime() * 0.1f));
+		renderer->swap();
+		return false;
 	}
 
 	void createCameras() {
-		cmShipFree = std::make_shared<sm::Camera>();
+		cmShipFree = std::shared_ptr<sm::Camera>(new sm::Camera());
 		cmShipFree->data.projectionType = rd::RenderingScene::CameraInfo::ProjectionType::PERSPECTIVE;
 		cmShipFree->data.nearZ = 0.1f;
 		cmShipFree->data.farZ = 1000;
 		cmShipFree->data.aspectRatio = aspectRatio; 
 		cmShipFree->data.fieldOfViewYRadian = CMShipFreeFOV;
 
-		cmShipThirdPerson = std::make_shared<sm::Camera>();
+		cmShipThirdPerson = std::shared_ptr<sm::Camera>(new sm::Camera());
 		cmShipThirdPerson->data = cmShipFree->data;
 
-		cmNorthFixed = std::make_shared<sm::Camera>();
+		cmNorthFixed = std::shared_ptr<sm::Camera>(new sm::Camera());
 		cmNorthFixed->transT = { 0, -SumRadius * 5, 0 };
 		cmNorthFixed->transS = { 1, 1, -1 };
 		cmNorthFixed->transR = DirectX::XMQuaternionRotationAxis({ 1, 0, 0 }, le::PI / 2);
@@ -225,7 +318,7 @@ class MoonLandingGame {
 	}
 
 	void createLights() {
-		ltSum = std::make_shared<sm::Light>(/*"SumLight"*/);
+		ltSum = std::shared_ptr<sm::Light>(new sm::Light(/*"SumLight"*/));
 		ltSum->type = rd::LightType::LIGHT_TYPE_DIRECTIONAL;
 		ltSum->intensity = { 2, 2, 2 };
 	}
@@ -243,34 +336,34 @@ class MoonLandingGame {
 
 	void setupScene() {
 
-		objShipCameraSys = std::make_shared<sm::Object>("ShipCameraSystem");
-		objShipCameraSysCoordLayer = std::make_shared<sm::Object>("ShipCameraSystem Coord");
-		objShipCameraSysOrientationLayer = std::make_shared<sm::Object>("ShipCameraSystem Moving Dir");
-		objShipCameraSysEarthOrbitLayer = std::make_shared<sm::Object>("ShipCameraSystem Earth Orbit");
-		objShipCameraSysEMTransferLayer = std::make_shared<sm::Object>("Earth -> Moon Transfer Orbit");
-		objEarthMoonSys = std::make_shared<sm::Object>("EarthMoonSystem");
-		objEarthMoonSysOrbitLayer = std::make_shared<sm::Object>("EarthMoonSystem Orbit Layer");
-		objEarthRotationAngleLayer = std::make_shared<sm::Object>("Earth Ro Angle Layer");
-		objRoot = std::make_shared<sm::Object>("SceneRoot");
-		objMoonOrbit = std::make_shared<sm::Object>("Moon Orbit");
-		objMoonOrbitAngleLayer = std::make_shared<sm::Object>("Moon Re Angle Layer");
-		objShipCameraSysMoonOrbitLayer = std::make_shared<sm::Object>("ShipCameraSystem Moon Orbit");
-		objEarthShipPlacement = std::make_shared<sm::Object>("Earth Ship Placement");
-		objShipCenter = std::make_shared<sm::Object>("Ship Center");
-		cmShipThirdInnerOrientationPerson = std::make_shared<sm::Object>("Ship TP Camera Inner Orient");;
-		cmShipThirdPersonCoordLayer = std::make_shared<sm::Object>("Ship TP Camera Coord");
-		cmShipThirdPersonOrientationLayer = std::make_shared<sm::Object>("Ship TP Camera Orient");
+		objShipCameraSys = std::shared_ptr<sm::Object>(new sm::Object("ShipCameraSystem"));
+		objShipCameraSysCoordLayer = std::shared_ptr<sm::Object>(new sm::Object("ShipCameraSystem Coord"));
+		objShipCameraSysOrientationLayer = std::shared_ptr<sm::Object>(new sm::Object("ShipCameraSystem Moving Dir"));
+		objShipCameraSysEarthOrbitLayer = std::shared_ptr<sm::Object>(new sm::Object("ShipCameraSystem Earth Orbit"));
+		objShipCameraSysEMTransferLayer = std::shared_ptr<sm::Object>(new sm::Object("Earth -> Moon Transfer Orbit"));
+		objEarthMoonSys = std::shared_ptr<sm::Object>(new sm::Object("EarthMoonSystem"));
+		objEarthMoonSysOrbitLayer = std::shared_ptr<sm::Object>(new sm::Object("EarthMoonSystem Orbit Layer"));
+		objEarthRotationAngleLayer = std::shared_ptr<sm::Object>(new sm::Object("Earth Ro Angle Layer"));
+		objRoot = std::shared_ptr<sm::Object>(new sm::Object("SceneRoot"));
+		objMoonOrbit = std::shared_ptr<sm::Object>(new sm::Object("Moon Orbit"));
+		objMoonOrbitAngleLayer = std::shared_ptr<sm::Object>(new sm::Object("Moon Re Angle Layer"));
+		objShipCameraSysMoonOrbitLayer = std::shared_ptr<sm::Object>(new sm::Object("ShipCameraSystem Moon Orbit"));
+		objEarthShipPlacement = std::shared_ptr<sm::Object>(new sm::Object("Earth Ship Placement"));
+		objShipCenter = std::shared_ptr<sm::Object>(new sm::Object("Ship Center"));
+		cmShipThirdInnerOrientationPerson = std::shared_ptr<sm::Object>(new sm::Object("Ship TP Camera Inner Orient"));;
+		cmShipThirdPersonCoordLayer = std::shared_ptr<sm::Object>(new sm::Object("Ship TP Camera Coord"));
+		cmShipThirdPersonOrientationLayer = std::shared_ptr<sm::Object>(new sm::Object("Ship TP Camera Orient"));
 		
 		scene->rootObject = objRoot;
 
 		objRoot->children = { objEarthMoonSysOrbitLayer, ltSum, objSum, cmNorthFixed };
 		{
 			objEarthMoonSysOrbitLayer->children = { objEarthMoonSys };
-			// ϵ
+			// 地月系
 			objEarthMoonSys->children = { objEarthRotationAngleLayer, objMoonOrbitAngleLayer };
 			objEarthMoonSys->moveParentCoord({ SumEarthDistance, 0, 0 });
 			{
-				// 
+				// 地球
 				objEarthRotationAngleLayer->children = { objEarth };
 				objEarthRotationAngleLayer->rotateParentCoord(DirectX::XMQuaternionRotationAxis({ 1, 0, 0 }, EarthAxialTilt));
 				
@@ -301,7 +394,7 @@ class MoonLandingGame {
 				}
 			}
 			{
-				// 
+				// 月球
 				objMoonOrbitAngleLayer->transR = DirectX::XMQuaternionRotationAxis({1, 0, 0}, MoonRevolutionAngle);
 				objMoonOrbitAngleLayer->children = { 
 					objMoonOrbit, 
@@ -325,12 +418,19 @@ class MoonLandingGame {
 		
 		scene->link();
 
-		//  link ֮
+		// 必须在 link 之后才能做
 		cmShipFreePitchLayer = cmShipFree->insertParent();
 		cmShipFreeYawLayer = cmShipFreePitchLayer->insertParent();
 		cmShipFreePresetLayer = cmShipFreePitchLayer->insertParent();
 
 
+		scene->components.add<PeriodicRotation>(objEarthMoonSysOrbitLayer->getHandle(),
+			DirectX::XMFLOAT3{ 0, 1, 0 }, EarthRevolutionPeriod);		// 地球公转
+		scene->components.add<PeriodicRotation>(objEarth->getHandle(),
+			DirectX::XMFLOAT3{ 0, 1, 0 }, EarthRotationPeriod);			// 地球自转
+		scene->components.add<PeriodicRotation>(objMoonOrbit->getHandle(),
+			DirectX::XMFLOAT3{ 0, 1, 0 }, MoonRevolutionPeriod);		// 月球公转
+
 		updateLights();
 	}
 
@@ -369,7 +469,7 @@ class MoonLandingGame {
 
 			moonToEarthTransferStartTime = framerateController.getLastFrameEndTime();
 
-			// ˳ѷصĲҲú
+			// 顺便把返回地球后的参数也设置好
 			shipOnEarthRotationAngleOffset = fmod(moonRevolutionOrbitRotationAngle + le::PI, 2 * le::PI);
 
 		} else if (orbitState == OrbitState::EarthToMoon && to == OrbitState::AroundMoon) {
@@ -401,7 +501,7 @@ class MoonLandingGame {
 			aroundEarthStartTime = framerateController.getLastFrameEndTime();
 			
 		} else if (orbitState == OrbitState::OnTheEarth && to == OrbitState::LaunchEarth) {
-			// ø״ֵ̬
+			// 设置各种状态值
 			launchFromEarthStartTime = framerateController.getLastFrameEndTime();
 
 			auto shipWorldPos = objShipCameraSys->getWorldPosition();
@@ -426,12 +526,12 @@ class MoonLandingGame {
 			launchFromEarthProgress = 0;
 
 
-			// ׼νṹ
+			// 准备层次结构
 			objShipCameraSysEarthOrbitLayer->children = { objShipCameraSysCoordLayer };
 			objShipCameraSysCoordLayer->parent = objShipCameraSysEarthOrbitLayer;
 			objEarthShipPlacement->children.clear();
 
-			// ֮ĳʼֵ
+			// 设置入轨之后的初始值
 			this->shipOnEarthRotationAngleOffset = - ry + EarthLaunchOrbitRadian;
 			if (shipOnEarthRotationAngleOffset < 0) shipOnEarthRotationAngleOffset += le::PI * 2;
 		} else if (orbitState == OrbitState::LaunchEarth && to == OrbitState::AroundEarth) {
@@ -464,7 +564,7 @@ class MoonLandingGame {
 		orbitState = to;
 	}
 	
-	// Ҫֵ [0, mod) 
+	// 要求三个值都在 [0, mod) 内
 	static double modulePassThrough(double val, double start, double end, double mod) {
 		assert(end < mod && end >= 0 && start < mod && start >= 0 && val < mod && val >= 0);
 		if (end < start) {
@@ -476,7 +576,7 @@ class MoonLandingGame {
 		return start <= val && val <= end;
 	}
 
-	// changeState õı
+	// changeState 用的变量
 	double lastShipOnEarthRotationAngle = -1;
 	double lastShipOnMoonRotationAngle = -1;
 	double lastShipOnEarthRy = -1;
@@ -492,11 +592,11 @@ class MoonLandingGame {
 
 					if (modulePassThrough(threshold, lastShipOnEarthRotationAngle, shipOnEarthRotationAngle, le::PI * 2)) {
 						lastShipOnEarthRotationAngle = -1;
-						// ʼתƣֹκ
+						// 开始转移，禁止任何新命令进入
 						forbitCommand = true;
 						commandInQueue = false;
 						shipOnEarthRotationAngle = threshold;
-						// state Ѿı
+						// state 已经改变
 						this->switchOrbitState(OrbitState::EarthToMoon);
 					} else {
 						lastShipOnEarthRotationAngle = shipOnEarthRotationAngle;
@@ -550,7 +650,7 @@ class MoonLandingGame {
 			}
 		} else {
 			if (orbitState == OrbitState::EarthToMoon) {
-				// תƽ
+				// 处理转移结束
 				if (earthToMoonRotationAngle > le::PI) {
 					this->switchOrbitState(OrbitState::AroundMoon);
 					forbitCommand = false;
@@ -608,16 +708,16 @@ class MoonLandingGame {
 		};
 		*/
 		static const wchar_t* names[] = {
-			L"ͣ",
-			L"ӵ",
-			L"Ƶ",
-			L"ת",
-			L"½",
-			L"ͣ",
-			L"",
-			L"",
-			L"µת",
-			L"½"
+			L"停靠地球",
+			L"从地球发射",
+			L"环绕地球",
+			L"地月转移",
+			L"着陆地球",
+			L"停靠月球",
+			L"从月球发射",
+			L"环绕月球",
+			L"月地转移",
+			L"着陆月球"
 		};
 
 		return names[static_cast<int>(state)];
@@ -631,9 +731,9 @@ class MoonLandingGame {
 		};
 		*/
 		static const wchar_t* names[] = {
-			L"һ˳",
-			L"˳",
-			L""
+			L"第一人称",
+			L"第三人称",
+			L"北极俯视"
 		};
 
 		return names[static_cast<int>(camera)];
@@ -642,17 +742,17 @@ class MoonLandingGame {
 	void updateWindowTitle() {
 		wchar_t operationHint[100];
 
-		swprintf_s(operationHint, L"״̬: %s%s%s%s%s%s%s%s%s%sո꣺򣻵ǰ%s",
+		swprintf_s(operationHint, L"状态: %s；%s%s%s%s%s%s%s%s%s空格：相机；鼠标：方向；当前相机：%s",
 			getStateName(orbitState),
-			commandInQueue ? L" " : L"",
+			commandInQueue ? L"将择机 " : L"",
 			commandInQueue ? getStateName(nextState) : L"",
-			commandInQueue ? L"" : L"",
-			leftKeyValid ? L"" : L"",
+			commandInQueue ? L"；" : L"",
+			leftKeyValid ? L"左方向键：" : L"",
 			leftKeyValid ? getStateName(leftKeyOp) : L"",
-			leftKeyValid ? L"" : L"",
-			rightKeyValid ? L"ҷ" : L"",
+			leftKeyValid ? L"；" : L"",
+			rightKeyValid ? L"右方向键：" : L"",
 			rightKeyValid ? getStateName(rightKeyOp) : L"",
-			rightKeyValid ? L"" : L"",
+			rightKeyValid ? L"；" : L"",
 			getCameraName(this->activeCamera)
 		);
 
@@ -672,8 +772,8 @@ class MoonLandingGame {
 	}
 
 	void updateSpaceshipAnimation() {
-		// Ƶת
-		// ӦǶ
+		// 飞行器绕地球的转动
+		// 距离对应角度
 		
 		switch (orbitState) {
 		case OrbitState::AroundEarth:
@@ -731,7 +831,7 @@ class MoonLandingGame {
 		case OrbitState::MoonToEarth:
 		{
 			cameraFlyingMode = 1;
-			// ߵתƹ [0, PI]
+			// 走地月转移轨道的 [0, PI]
 
 			double time = framerateController.getLastFrameEndTime() - moonToEarthTransferStartTime;
 			moonToEarthRotationAngle = le::PI * 2 * (fmod(time, EarthMoonTransferTime) / EarthMoonTransferTime);
@@ -756,7 +856,7 @@ class MoonLandingGame {
 		{
 			cameraFlyingMode = 0;
 			// do nothing
-			// todo һ³֮
+			// todo 可以在这里设置一下朝向之类的
 		}
 		break;
 		case OrbitState::LaunchEarth:
@@ -868,24 +968,19 @@ class MoonLandingGame {
 		}
 	}
 
-	void updateEarthRevolutionAnimation() {
-		// ת
-		double time = framerateController.getLastFrameEndTime();
-		double rotationAngle = le::PI * 2 * (fmod(time, EarthRevolutionPeriod) / EarthRevolutionPeriod);
-		objEarthMoonSysOrbitLayer->transR = DirectX::XMQuaternionRotationAxis({0, 1, 0}, (float)rotationAngle);
-	}
-
-	void updateEarthRotationAnimation() {
-		double time = framerateController.getLastFrameEndTime();
-		earthRotationAngle = le::PI * 2 * (fmod(time, EarthRotationPeriod) / EarthRotationPeriod);
-		objEarth->transR = DirectX::XMQuaternionRotationAxis({0, 1, 0}, (float)earthRotationAngle);
-	}
-	
-	void updateMoonRevolutionAnimation() {
+	// 地球公转、地球自转、月球公转
+	void updatePeriodicRotationAnimation() {
 		double time = framerateController.getLastFrameEndTime();
-		double rotationAngle = le::PI * 2 * (fmod(time, MoonRevolutionPeriod) / MoonRevolutionPeriod);
-		moonRevolutionOrbitRotationAngle = rotationAngle;
-		objMoonOrbit->transR = DirectX::XMQuaternionRotationAxis({0, 1, 0}, (float)rotationAngle);
+		auto& objects = sm::ObjectStore::getInstance();
+		scene->components.view<PeriodicRotation>().each([&](sm::ObjectHandle handle, PeriodicRotation& rotation) {
+			auto object = objects.resolve(handle);
+			if (object == nullptr) return;
+			rotation.angle = le::PI * 2 * (fmod(time, rotation.period) / rotation.period);
+			object->transR = DirectX::XMQuaternionRotationAxis(DirectX::XMLoadFloat3(&rotation.axis), (float)rotation.angle);
+		});
+
+		earthRotationAngle = scene->components.get<PeriodicRotation>(objEarth->getHandle())->angle;
+		moonRevolutionOrbitRotationAngle = scene->components.get<PeriodicRotation>(objMoonOrbit->getHandle())->angle;
 	}
 
 	void updateCameraAnimation() {
@@ -907,9 +1002,9 @@ class MoonLandingGame {
 	void updateAnimation() {
 		updateSpaceshipAnimation();
 		updateCameraAnimation();
-		updateEarthRevolutionAnimation();
-		updateEarthRotationAnimation();
-		updateMoonRevolutionAnimation();
+		updatePeriodicRotationAnimation();
+		sm::updateAnimationPlayers(scene->components, framerateController.getLastFrameDuration());
+		sm::updateSkinnedMeshes(scene->components);
 	}
 
 	void processEvents(const std::vector<std::tuple<UINT, WPARAM, LPARAM>>& events) {
@@ -1045,9 +1140,14 @@ class MoonLandingGame {
 	}
 
 	void renderCallback(const io::RenderingWindow&, const std::vector<std::tuple<UINT, WPARAM, LPARAM>>& events) {
-		//  begin ޺
+		// 额外调用 begin 无害
 		framerateController.begin();
 
+		if (!updateLoading()) {
+			framerateController.wait();
+			return;
+		}
+
 		processEvents(events);
 		updatetValidOperationInfo();
 		updateWindowTitle();
@@ -1061,6 +1161,7 @@ class MoonLandingGame {
 
 
 		auto rScene = scene->getRenderingScene();
+		sm::uploadSkinnedMeshes(scene->components);
 
 		renderer->beginRendering();
 		renderer->renderScene(rScene, true);
@@ -1068,9 +1169,29 @@ class MoonLandingGame {
 		renderer->renderSkybox(this->texSkymap, rScene->camera, DirectX::XMMatrixIdentity());
 
 		renderer->swap();
+		reportDrawStatistics();
 		framerateController.wait();
 	}
 
+	// 每 10 秒输出一次上一帧的 pass 数、draw call 数、提交的三角形数，以及全部使用最高精度 LOD 时的三角形数和遮挡剔除的结果
+	void reportDrawStatistics() {
+		auto now = framerateController.getLastFrameEndTime();
+		if (now - lastDrawReportTime < 10) return;
+		lastDrawReportTime = now;
+
+		auto& statistics = renderer->getLastFrameInputAssemblerStatistics();
+		char line[160];
+		snprintf(line, sizeof(line), "passes: %llu, draws: %llu, triangles: %llu (%llu without LOD)\n",
+			(unsigned long long)statistics.passes, (unsigned long long)statistics.draws, (unsigned long long)statistics.triangles,
+			(unsigned long long)statistics.fullDetailTriangles);
+		le::log(le::LogLevel::INFO, line);
+
+		auto& occlusion = renderer->getOcclusionCullingStatistics();
+		snprintf(line, sizeof(line), "occlusion culling: %u occluders (%llu triangles), culled %u of %u\n",
+			occlusion.occluders, (unsigned long long)occlusion.occluderTriangles, occlusion.culled, occlusion.tested);
+		le::log(le::LogLevel::INFO, line);
+	}
+
 	void start() {
 		window.show();
 		window.runRenderingLoop();
@@ -1089,9 +1210,7 @@ public:
 		loadResources();
 		createCameras();
 		createLights();
-		setupScene();
-		scene->activeCamera = cmShipFree;
-		objRoot->dump();
+		// setupScene 在资源加载完成后进行，见 updateLoading
 		this->start();
 	}
 };